@@ -55,6 +55,9 @@
 #define PLD(code...)
 #endif
 
+/* bytes added to the preload distance of the copy loops */
+#define PLD_EXTRA	(CONFIG_ARM_PLD_EXTRA_LINES << CONFIG_ARM_L1_CACHE_SHIFT)
+
 /*
  * This can be used to enable code to cacheline align the destination
  * pointer when bulk writing to memory.  Experiments on StrongARM and
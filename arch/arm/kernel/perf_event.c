@@ -27,6 +27,9 @@
 #include <asm/irq_regs.h>
 #include <asm/pmu.h>
 #include <asm/stacktrace.h>
+#include <asm/vfp.h>
+
+#include "../vfp/vfpinstr.h"
 
 static struct platform_device *pmu_device;
 
@@ -77,6 +80,7 @@ static const char *arm_pmu_names[] = {
 	[ARM_PERF_PMU_ID_V6MP]	  = "v6mpcore",
 	[ARM_PERF_PMU_ID_CA8]	  = "ARMv7 Cortex-A8",
 	[ARM_PERF_PMU_ID_CA9]	  = "ARMv7 Cortex-A9",
+	[ARM_PERF_PMU_ID_SCORPION] = "Qualcomm Scorpion",
 };
 
 struct arm_pmu {
@@ -88,6 +92,8 @@ struct arm_pmu {
 	u64		(*raw_event)(u64);
 	int		(*get_event_idx)(struct cpu_hw_events *cpuc,
 					 struct hw_perf_event *hwc);
+	void		(*put_event_idx)(struct cpu_hw_events *cpuc,
+					 struct hw_perf_event *hwc);
 	u32		(*read_counter)(int idx);
 	void		(*write_counter)(int idx, u32 val);
 	void		(*start)(void);
@@ -237,6 +243,8 @@ armpmu_disable(struct perf_event *event)
 	armpmu_event_update(event, hwc, idx);
 	cpuc->events[idx] = NULL;
 	clear_bit(idx, cpuc->used_mask);
+	if (armpmu->put_event_idx)
+		armpmu->put_event_idx(cpuc, hwc);
 
 	perf_event_update_userpage(event);
 }
@@ -2122,6 +2130,419 @@ static u32 __init armv7_reset_read_pmnc(void)
 	return nb_cnt + 1;
 }
 
+/*
+ * Qualcomm Scorpion Performance counter handling code.
+ *
+ * Scorpion implements the ARMv7 PMU (4 event counters and the cycle
+ * counter), so the counters themselves are driven by the ARMv7 code above.
+ * On top of the architected events it has a set of region registers that
+ * select implementation defined events: LPM0-2 for the CPU, L2LPM for the
+ * L2 and VLPM for the VFP/NEON unit. Each region register holds four
+ * groups of one event code each; an event counter then counts a group by
+ * selecting the region's group event (0x4c + 4 * region + group) in its
+ * EVTSEL.
+ *
+ * Event encoding for the region events, 0xNRCCG:
+ *   N  = 1 for a CPU region (LPMn, L2LPM), 2 for the VFP region (VLPM)
+ *   R  = region register
+ *   CC = event code within the group
+ *   G  = group
+ * e.g. 0x12021 is code 0x02 in group 1 of LPM2.
+ */
+
+#define SCORPION_EVENT		(1 << 16)
+#define VENUM_EVENT		(2 << 16)
+#define SCORPION_EVENT_MASK	(SCORPION_EVENT | VENUM_EVENT)
+#define SCORPION_PMRESR_EN	(1 << 31)
+
+#define SCORPION_EVENT_REGION(event)	(((event) >> 12) & 0xf)
+#define SCORPION_EVENT_CODE(event)	(((event) >> 4) & 0xff)
+#define SCORPION_EVENT_GROUP(event)	((event) & 0xf)
+
+/* Scorpion specific event types */
+enum scorpion_perf_types {
+	SCORPION_LPM0_GROUP0			= 0x4c,
+	SCORPION_LPM1_GROUP0			= 0x50,
+	SCORPION_LPM2_GROUP0			= 0x54,
+	SCORPION_L2LPM_GROUP0			= 0x58,
+	SCORPION_VLPM_GROUP0			= 0x5c,
+
+	SCORPION_ICACHE_ACCESS			= 0x10053,
+	SCORPION_ICACHE_MISS			= 0x10052,
+
+	SCORPION_DTLB_ACCESS			= 0x12013,
+	SCORPION_DTLB_MISS			= 0x12012,
+
+	SCORPION_ITLB_MISS			= 0x12021,
+};
+
+/*
+ * Bits of cpu_hw_events.used_mask above the counters claim a region
+ * group, as a group can only count one event code at a time.
+ */
+#define SCORPION_GROUP_BIT0	(ARMPMU_MAX_HWEVENTS - \
+				 (SCORPION_VLPM_GROUP0 + 4 - SCORPION_LPM0_GROUP0))
+
+static const unsigned scorpion_perf_map[PERF_COUNT_HW_MAX] = {
+	[PERF_COUNT_HW_CPU_CYCLES]	    = ARMV7_PERFCTR_CPU_CYCLES,
+	[PERF_COUNT_HW_INSTRUCTIONS]	    = ARMV7_PERFCTR_INSTR_EXECUTED,
+	[PERF_COUNT_HW_CACHE_REFERENCES]    = HW_OP_UNSUPPORTED,
+	[PERF_COUNT_HW_CACHE_MISSES]	    = HW_OP_UNSUPPORTED,
+	[PERF_COUNT_HW_BRANCH_INSTRUCTIONS] = ARMV7_PERFCTR_PC_WRITE,
+	[PERF_COUNT_HW_BRANCH_MISSES]	    = ARMV7_PERFCTR_PC_BRANCH_MIS_PRED,
+	[PERF_COUNT_HW_BUS_CYCLES]	    = ARMV7_PERFCTR_CLOCK_CYCLES,
+};
+
+static const unsigned scorpion_perf_cache_map[PERF_COUNT_HW_CACHE_MAX]
+					  [PERF_COUNT_HW_CACHE_OP_MAX]
+					  [PERF_COUNT_HW_CACHE_RESULT_MAX] = {
+	[C(L1D)] = {
+		/*
+		 * The performance counters don't differentiate between read
+		 * and write accesses/misses so this isn't strictly correct,
+		 * but it's the best we can do. Writes and reads get
+		 * combined.
+		 */
+		[C(OP_READ)] = {
+			[C(RESULT_ACCESS)]	= ARMV7_PERFCTR_DCACHE_ACCESS,
+			[C(RESULT_MISS)]	= ARMV7_PERFCTR_DCACHE_REFILL,
+		},
+		[C(OP_WRITE)] = {
+			[C(RESULT_ACCESS)]	= ARMV7_PERFCTR_DCACHE_ACCESS,
+			[C(RESULT_MISS)]	= ARMV7_PERFCTR_DCACHE_REFILL,
+		},
+		[C(OP_PREFETCH)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= CACHE_OP_UNSUPPORTED,
+		},
+	},
+	[C(L1I)] = {
+		[C(OP_READ)] = {
+			[C(RESULT_ACCESS)]	= SCORPION_ICACHE_ACCESS,
+			[C(RESULT_MISS)]	= SCORPION_ICACHE_MISS,
+		},
+		[C(OP_WRITE)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= CACHE_OP_UNSUPPORTED,
+		},
+		[C(OP_PREFETCH)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= CACHE_OP_UNSUPPORTED,
+		},
+	},
+	[C(LL)] = {
+		[C(OP_READ)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= CACHE_OP_UNSUPPORTED,
+		},
+		[C(OP_WRITE)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= CACHE_OP_UNSUPPORTED,
+		},
+		[C(OP_PREFETCH)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= CACHE_OP_UNSUPPORTED,
+		},
+	},
+	[C(DTLB)] = {
+		[C(OP_READ)] = {
+			[C(RESULT_ACCESS)]	= SCORPION_DTLB_ACCESS,
+			[C(RESULT_MISS)]	= SCORPION_DTLB_MISS,
+		},
+		[C(OP_WRITE)] = {
+			[C(RESULT_ACCESS)]	= SCORPION_DTLB_ACCESS,
+			[C(RESULT_MISS)]	= SCORPION_DTLB_MISS,
+		},
+		[C(OP_PREFETCH)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= CACHE_OP_UNSUPPORTED,
+		},
+	},
+	[C(ITLB)] = {
+		[C(OP_READ)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= SCORPION_ITLB_MISS,
+		},
+		[C(OP_WRITE)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= SCORPION_ITLB_MISS,
+		},
+		[C(OP_PREFETCH)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= CACHE_OP_UNSUPPORTED,
+		},
+	},
+	[C(BPU)] = {
+		[C(OP_READ)] = {
+			[C(RESULT_ACCESS)]	= ARMV7_PERFCTR_PC_WRITE,
+			[C(RESULT_MISS)]	= ARMV7_PERFCTR_PC_BRANCH_MIS_PRED,
+		},
+		[C(OP_WRITE)] = {
+			[C(RESULT_ACCESS)]	= ARMV7_PERFCTR_PC_WRITE,
+			[C(RESULT_MISS)]	= ARMV7_PERFCTR_PC_BRANCH_MIS_PRED,
+		},
+		[C(OP_PREFETCH)] = {
+			[C(RESULT_ACCESS)]	= CACHE_OP_UNSUPPORTED,
+			[C(RESULT_MISS)]	= CACHE_OP_UNSUPPORTED,
+		},
+	},
+};
+
+static u32 scorpion_read_pmresr(unsigned int region)
+{
+	u32 val = 0;
+
+	switch (region) {
+	case 0:
+		asm volatile("mrc p15, 0, %0, c15, c0, 0" : "=r" (val));
+		break;
+	case 1:
+		asm volatile("mrc p15, 1, %0, c15, c0, 0" : "=r" (val));
+		break;
+	case 2:
+		asm volatile("mrc p15, 2, %0, c15, c0, 0" : "=r" (val));
+		break;
+	case 3:
+		asm volatile("mrc p15, 3, %0, c15, c2, 0" : "=r" (val));
+		break;
+	}
+
+	return val;
+}
+
+static void scorpion_write_pmresr(unsigned int region, u32 val)
+{
+	switch (region) {
+	case 0:
+		asm volatile("mcr p15, 0, %0, c15, c0, 0" : : "r" (val));
+		break;
+	case 1:
+		asm volatile("mcr p15, 1, %0, c15, c0, 0" : : "r" (val));
+		break;
+	case 2:
+		asm volatile("mcr p15, 2, %0, c15, c0, 0" : : "r" (val));
+		break;
+	case 3:
+		asm volatile("mcr p15, 3, %0, c15, c2, 0" : : "r" (val));
+		break;
+	}
+}
+
+/*
+ * VLPM lives in the VFP coprocessor space, which must be accessible and
+ * enabled while it is touched. Called with pmu_lock held.
+ */
+static void venum_pre_pmresr(u32 *cpacr, u32 *fpexc)
+{
+	*cpacr = get_copro_access();
+	set_copro_access(*cpacr | CPACC_SVC(10) | CPACC_SVC(11));
+
+	*fpexc = fmrx(FPEXC);
+	fmxr(FPEXC, *fpexc | FPEXC_EN);
+}
+
+static void venum_post_pmresr(u32 cpacr, u32 fpexc)
+{
+	fmxr(FPEXC, fpexc);
+	set_copro_access(cpacr);
+}
+
+static u32 venum_read_pmresr(void)
+{
+	u32 val;
+
+	asm volatile("mrc p10, 7, %0, c11, c0, 0" : "=r" (val));
+	return val;
+}
+
+static void venum_write_pmresr(u32 val)
+{
+	asm volatile("mcr p10, 7, %0, c11, c0, 0" : : "r" (val));
+}
+
+/* The EVTSEL value that counts the group of a region event */
+static u32 scorpion_group_event(unsigned long config)
+{
+	if (config & VENUM_EVENT)
+		return SCORPION_VLPM_GROUP0 + SCORPION_EVENT_GROUP(config);
+
+	return SCORPION_LPM0_GROUP0 + 4 * SCORPION_EVENT_REGION(config) +
+	       SCORPION_EVENT_GROUP(config);
+}
+
+static u32 scorpion_set_group(u32 val, unsigned long config)
+{
+	unsigned int shift = SCORPION_EVENT_GROUP(config) * 8;
+
+	val &= ~(0xff << shift);
+	val |= SCORPION_EVENT_CODE(config) << shift;
+	return val | SCORPION_PMRESR_EN;
+}
+
+static u32 scorpion_clear_group(u32 val, unsigned long config)
+{
+	unsigned int shift = SCORPION_EVENT_GROUP(config) * 8;
+
+	val &= ~(0xff << shift);
+
+	/* Keep the region enabled while other groups still use it */
+	if (val & ~SCORPION_PMRESR_EN)
+		return val | SCORPION_PMRESR_EN;
+	return 0;
+}
+
+static void scorpion_update_pmresr(unsigned long config,
+				   u32 (*update)(u32, unsigned long))
+{
+	u32 cpacr, fpexc;
+
+	if (config & VENUM_EVENT) {
+		venum_pre_pmresr(&cpacr, &fpexc);
+		venum_write_pmresr(update(venum_read_pmresr(), config));
+		venum_post_pmresr(cpacr, fpexc);
+	} else {
+		unsigned int region = SCORPION_EVENT_REGION(config);
+
+		scorpion_write_pmresr(region,
+				update(scorpion_read_pmresr(region), config));
+	}
+}
+
+static void scorpion_pmu_enable_event(struct hw_perf_event *hwc, int idx)
+{
+	unsigned long flags;
+
+	if (!(hwc->config_base & SCORPION_EVENT_MASK)) {
+		armv7pmu_enable_event(hwc, idx);
+		return;
+	}
+
+	spin_lock_irqsave(&pmu_lock, flags);
+
+	armv7_pmnc_disable_counter(idx);
+
+	/*
+	 * Point the counter at the group and program the event code into
+	 * the region register. PMxEVCNTCR is cleared so that the counter
+	 * counts in every mode.
+	 */
+	armv7_pmnc_write_evtsel(idx, scorpion_group_event(hwc->config_base));
+	asm volatile("mcr p15, 0, %0, c9, c15, 0" : : "r" (0));
+	scorpion_update_pmresr(hwc->config_base, scorpion_set_group);
+
+	armv7_pmnc_enable_intens(idx);
+	armv7_pmnc_enable_counter(idx);
+
+	spin_unlock_irqrestore(&pmu_lock, flags);
+}
+
+static void scorpion_pmu_disable_event(struct hw_perf_event *hwc, int idx)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pmu_lock, flags);
+
+	armv7_pmnc_disable_counter(idx);
+	if (hwc->config_base & SCORPION_EVENT_MASK)
+		scorpion_update_pmresr(hwc->config_base, scorpion_clear_group);
+	armv7_pmnc_disable_intens(idx);
+
+	spin_unlock_irqrestore(&pmu_lock, flags);
+}
+
+static inline int scorpion_pmu_event_map(int config)
+{
+	int mapping = scorpion_perf_map[config];
+	if (HW_OP_UNSUPPORTED == mapping)
+		mapping = -EOPNOTSUPP;
+	return mapping;
+}
+
+static u64 scorpion_pmu_raw_event(u64 config)
+{
+	if (config & SCORPION_EVENT_MASK)
+		return config & (SCORPION_EVENT_MASK | 0xffff);
+
+	return config & 0xff;
+}
+
+static int scorpion_group_bit(unsigned long config)
+{
+	return SCORPION_GROUP_BIT0 + scorpion_group_event(config) -
+	       SCORPION_LPM0_GROUP0;
+}
+
+static int scorpion_pmu_get_event_idx(struct cpu_hw_events *cpuc,
+				      struct hw_perf_event *event)
+{
+	unsigned long config = event->config_base;
+	unsigned int region = SCORPION_EVENT_REGION(config);
+	int bit, idx;
+
+	if (!(config & SCORPION_EVENT_MASK))
+		return armv7pmu_get_event_idx(cpuc, event);
+
+	/* LPM0-2 and L2LPM are regions 0-3, VLPM is the only VFP region */
+	if ((config & SCORPION_EVENT_MASK) == SCORPION_EVENT_MASK ||
+	    SCORPION_EVENT_GROUP(config) > 3 ||
+	    region > ((config & VENUM_EVENT) ? 0 : 3))
+		return -EINVAL;
+
+	bit = scorpion_group_bit(config);
+	if (test_and_set_bit(bit, cpuc->used_mask))
+		return -EAGAIN;
+
+	idx = armv7pmu_get_event_idx(cpuc, event);
+	if (idx < 0)
+		clear_bit(bit, cpuc->used_mask);
+
+	return idx;
+}
+
+static void scorpion_pmu_put_event_idx(struct cpu_hw_events *cpuc,
+				       struct hw_perf_event *event)
+{
+	if (event->config_base & SCORPION_EVENT_MASK)
+		clear_bit(scorpion_group_bit(event->config_base),
+			  cpuc->used_mask);
+}
+
+static struct arm_pmu scorpion_pmu = {
+	.id			= ARM_PERF_PMU_ID_SCORPION,
+	.handle_irq		= armv7pmu_handle_irq,
+	.enable			= scorpion_pmu_enable_event,
+	.disable		= scorpion_pmu_disable_event,
+	.event_map		= scorpion_pmu_event_map,
+	.raw_event		= scorpion_pmu_raw_event,
+	.read_counter		= armv7pmu_read_counter,
+	.write_counter		= armv7pmu_write_counter,
+	.get_event_idx		= scorpion_pmu_get_event_idx,
+	.put_event_idx		= scorpion_pmu_put_event_idx,
+	.start			= armv7pmu_start,
+	.stop			= armv7pmu_stop,
+	.max_period		= (1LLU << 32) - 1,
+};
+
+static void __init scorpion_reset_pmresr(void)
+{
+	u32 cpacr, fpexc;
+	unsigned int region;
+	int idx;
+
+	/* Clear the region registers and the per-counter mode filters */
+	for (region = 0; region < 4; region++)
+		scorpion_write_pmresr(region, 0);
+
+	venum_pre_pmresr(&cpacr, &fpexc);
+	venum_write_pmresr(0);
+	venum_post_pmresr(cpacr, fpexc);
+
+	for (idx = ARMV7_COUNTER0; idx <= armpmu->num_events; idx++) {
+		armv7_pmnc_select_counter(idx);
+		asm volatile("mcr p15, 0, %0, c9, c15, 0" : : "r" (0));
+	}
+}
+
 /*
  * ARMv5 [xscale] Performance counter handling code.
  *
@@ -2986,6 +3407,21 @@ init_hw_perf_events(void)
 			perf_max_events	= xscale2pmu.num_events;
 			break;
 		}
+	/* Qualcomm CPUs. */
+	} else if (0x51 == implementor) {
+		switch (part_number) {
+		case 0x00F0:	/* Scorpion */
+			memcpy(armpmu_perf_cache_map, scorpion_perf_cache_map,
+				sizeof(scorpion_perf_cache_map));
+			armpmu = &scorpion_pmu;
+
+			/* Reset PMNC and the region registers, and read the
+			    nb of CNTx counters supported */
+			scorpion_pmu.num_events = armv7_reset_read_pmnc();
+			scorpion_reset_pmresr();
+			perf_max_events = scorpion_pmu.num_events;
+			break;
+		}
 	}
 
 	if (armpmu) {
@@ -25,6 +25,7 @@
 #include <linux/mutex.h>
 #include <linux/io.h>
 #include <linux/sort.h>
+#include <linux/hrtimer.h>
 #include <mach/board.h>
 #include <mach/msm_iomap.h>
 #include <asm/mach-types.h>
@@ -34,6 +35,9 @@
 #include "acpuclock.h"
 #include "spm.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/acpuclock.h>
+
 #define SCSS_CLK_CTL_ADDR	(MSM_ACC_BASE + 0x04)
 #define SCSS_CLK_SEL_ADDR	(MSM_ACC_BASE + 0x08)
 
@@ -192,11 +196,19 @@ static void acpuclk_set_src(const struct clkctl_acpu_speed *s)
 	mb();
 }
 
+/* Only cpufreq switches are timed, SWFI and power collapse stay cheap */
+static inline s64 acpuclk_stamp(enum setrate_reason reason)
+{
+	return reason == SETRATE_CPUFREQ ? ktime_to_us(ktime_get()) : 0;
+}
+
 static int acpuclk_7x30_set_rate(int cpu, unsigned long rate,
 				 enum setrate_reason reason)
 {
 	struct clkctl_acpu_speed *tgt_s, *strt_s;
 	int res, rc = 0;
+	s64 start, t;
+	u32 vdd_us = 0, pll_us, src_us;
 
 	if (reason == SETRATE_CPUFREQ)
 		mutex_lock(&drv_state.lock);
@@ -215,10 +227,13 @@ static int acpuclk_7x30_set_rate(int cpu, unsigned long rate,
 		goto out;
 	}
 
+	start = acpuclk_stamp(reason);
+
 	if (reason == SETRATE_CPUFREQ) {
 		/* Increase VDD if needed. */
 		if (tgt_s->vdd_mv > strt_s->vdd_mv) {
 			rc = acpuclk_set_acpu_vdd(tgt_s);
+			vdd_us = acpuclk_stamp(reason) - start;
 			if (rc < 0) {
 				pr_err("ACPU VDD increase to %d mV failed "
 					"(%d)\n", tgt_s->vdd_mv, rc);
@@ -242,6 +257,8 @@ static int acpuclk_7x30_set_rate(int cpu, unsigned long rate,
 		}
 	}
 
+	t = acpuclk_stamp(reason);
+
 	/* Move off of PLL2 if we're reprogramming it */
 	if (tgt_s->src == PLL_2 && strt_s->src == PLL_2) {
 		clk_enable(acpuclk_sources[backup_s->src]);
@@ -260,6 +277,9 @@ static int acpuclk_7x30_set_rate(int cpu, unsigned long rate,
 		clk_enable(acpuclk_sources[tgt_s->src]);
 	}
 
+	pll_us = acpuclk_stamp(reason) - t;
+	t += pll_us;
+
 	/* Perform the frequency switch */
 	acpuclk_set_src(tgt_s);
 	drv_state.current_speed = tgt_s;
@@ -268,6 +288,8 @@ static int acpuclk_7x30_set_rate(int cpu, unsigned long rate,
 	if (tgt_s->src == PLL_2 && strt_s->src == PLL_2)
 		clk_disable(acpuclk_sources[backup_s->src]);
 
+	src_us = acpuclk_stamp(reason) - t;
+
 	/* Nothing else to do for SWFI. */
 	if (reason == SETRATE_SWFI)
 		goto out;
@@ -292,12 +314,19 @@ static int acpuclk_7x30_set_rate(int cpu, unsigned long rate,
 
 	/* Drop VDD level if we can. */
 	if (tgt_s->vdd_mv < strt_s->vdd_mv) {
+		t = acpuclk_stamp(reason);
 		res = acpuclk_set_acpu_vdd(tgt_s);
 		if (res)
 			pr_warning("ACPU VDD decrease to %d mV failed (%d)\n",
 					tgt_s->vdd_mv, res);
+		vdd_us += acpuclk_stamp(reason) - t;
 	}
 
+	if (reason == SETRATE_CPUFREQ)
+		trace_acpuclk_set_rate(strt_s->acpu_clk_khz,
+				       tgt_s->acpu_clk_khz, vdd_us, pll_us,
+				       src_us, acpuclk_stamp(reason) - start);
+
 	dprintk("ACPU speed change complete\n");
 out:
 	if (reason == SETRATE_CPUFREQ)
@@ -412,6 +441,24 @@ static void __init lpj_init(void)
 
 #ifdef CONFIG_CPU_FREQ_MSM
 static struct cpufreq_frequency_table cpufreq_tbl[ARRAY_SIZE(acpu_freq_tbl)];
+static struct cpufreq_energy_state energy_tbl[ARRAY_SIZE(acpu_freq_tbl)];
+
+/*
+ * PLL2 runs for the ACPU alone, so its own draw is charged as if the
+ * core ran this much faster. Leakage and the AXI vote are left out.
+ */
+#define ENERGY_PLL2_KHZ 100000
+
+/* Dynamic power goes with V^2 * f, mV^2 / 1000 * MHz fits in 32 bits */
+static unsigned int acpuclk_power(const struct clkctl_acpu_speed *s)
+{
+	unsigned int khz = s->acpu_clk_khz;
+
+	if (s->src == PLL_2)
+		khz += ENERGY_PLL2_KHZ;
+
+	return (s->vdd_mv * s->vdd_mv / 1000) * (khz / 1000);
+}
 
 static void setup_cpufreq_table(void)
 {
@@ -422,11 +469,14 @@ static void setup_cpufreq_table(void)
 		if (speed->use_for_scaling) {
 			cpufreq_tbl[i].index = i;
 			cpufreq_tbl[i].frequency = speed->acpu_clk_khz;
+			energy_tbl[i].frequency = speed->acpu_clk_khz;
+			energy_tbl[i].power = acpuclk_power(speed);
 			i++;
 		}
 	cpufreq_tbl[i].frequency = CPUFREQ_TABLE_END;
 
 	cpufreq_frequency_table_get_attr(cpufreq_tbl, smp_processor_id());
+	cpufreq_energy_register(cpu_possible_mask, energy_tbl, i);
 }
 #else
 static inline void setup_cpufreq_table(void) { }
@@ -27,6 +27,8 @@
 #include <linux/lightsensor.h>
 #include <linux/irq.h>
 #include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
 #include <asm/uaccess.h>
 #include "proc_comm.h"
 
@@ -55,94 +57,203 @@ static char *hex2string(uint8_t *data, int len)
 	return buf;
 }
 
-static int i2c_read_block(struct i2c_client *client, uint8_t addr,
-	uint8_t *data, int length)
+/*
+ * Bus accounting per microP command, so the clients sharing the chip can
+ * be told apart. Updated with microp_i2c_rw_mutex held.
+ */
+struct microp_cmd_stat {
+	uint32_t count;
+	uint64_t bus_ns;
+};
+static struct microp_cmd_stat microp_cmd_stats[256];
+
+static atomic_t microp_normal_waiters = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(microp_prio_wq);
+
+/* Background requests stand aside while a normal one is waiting */
+static void microp_bus_lock(struct microp_i2c_client_data *cdata, int prio)
 {
-	int retry;
-	struct microp_i2c_client_data *cdata;
-	struct i2c_msg msgs[] = {
-		{
-			.addr = client->addr,
-			.flags = 0,
-			.len = 1,
-			.buf = &addr,
-		},
-		{
-			.addr = client->addr,
-			.flags = I2C_M_RD,
-			.len = length,
-			.buf = data,
-		}
-	};
+	if (prio == MICROP_PRIO_BACKGROUND) {
+		wait_event(microp_prio_wq,
+			   !atomic_read(&microp_normal_waiters));
+		mutex_lock(&cdata->microp_i2c_rw_mutex);
+		return;
+	}
 
-	cdata = i2c_get_clientdata(client);
+	atomic_inc(&microp_normal_waiters);
 	mutex_lock(&cdata->microp_i2c_rw_mutex);
+	if (atomic_dec_and_test(&microp_normal_waiters))
+		wake_up(&microp_prio_wq);
+}
+
+static void microp_bus_unlock(struct microp_i2c_client_data *cdata)
+{
+	mutex_unlock(&cdata->microp_i2c_rw_mutex);
+}
+
+static int microp_i2c_xfer(struct i2c_client *client,
+	struct i2c_msg *msgs, int num, int retries)
+{
+	int retry;
+
 	hr_msleep(1);
-	for (retry = 0; retry <= I2C_READ_RETRY_TIMES; retry++) {
-		if (i2c_transfer(client->adapter, msgs, 2) == 2)
-			break;
+	for (retry = 0; retry <= retries; retry++) {
+		if (i2c_transfer(client->adapter, msgs, num) == num)
+			return 0;
 		msleep(microp_rw_delay);
 	}
-	mutex_unlock(&cdata->microp_i2c_rw_mutex);
-	dev_dbg(&client->dev, "R [%02X] = %s\n",
-			addr, hex2string(data, length));
+	return -EIO;
+}
 
-	if (retry > I2C_READ_RETRY_TIMES) {
-		dev_err(&client->dev, "[MP_I2C_ERR] i2c_read_block retry over %d\n",
-			I2C_READ_RETRY_TIMES);
-		return -EIO;
+/*
+ * Run ops back to back with the bus held. Consecutive writes go out as
+ * one combined transfer; each read is a transfer of its own, since the
+ * microP needs its settle time before it can answer. Must hold
+ * microp_i2c_rw_mutex.
+ */
+static int microp_i2c_run(struct i2c_client *client,
+	struct microp_i2c_op *ops, int n)
+{
+	uint8_t wbuf[MICROP_I2C_BATCH_MAX][MICROP_I2C_WRITE_BLOCK_SIZE];
+	struct i2c_msg msgs[MICROP_I2C_BATCH_MAX];
+	unsigned long long t;
+	int i, j, first, num, burst;
+
+	for (i = 0; i < n; i++)
+		if (!ops[i].read && ops[i].length + 1 > MICROP_I2C_WRITE_BLOCK_SIZE) {
+			dev_err(&client->dev,
+				"[MP_I2C_ERR] i2c_write_block length too long\n");
+			return -E2BIG;
+		}
+
+	for (i = 0; i < n; i = first + num) {
+		first = i;
+		num = 0;
+		burst = 0;
+		t = sched_clock();
+
+		if (ops[i].read) {
+			msgs[0].addr = client->addr;
+			msgs[0].flags = 0;
+			msgs[0].len = 1;
+			msgs[0].buf = &ops[i].addr;
+			msgs[1].addr = client->addr;
+			msgs[1].flags = I2C_M_RD;
+			msgs[1].len = ops[i].length;
+			msgs[1].buf = ops[i].data;
+			num = 1;
+			if (microp_i2c_xfer(client, msgs, 2,
+					    I2C_READ_RETRY_TIMES) < 0) {
+				dev_err(&client->dev, "[MP_I2C_ERR] i2c_read_block retry over %d\n",
+					I2C_READ_RETRY_TIMES);
+				return -EIO;
+			}
+			dev_dbg(&client->dev, "R [%02X] = %s\n",
+				ops[i].addr, hex2string(ops[i].data, ops[i].length));
+		} else {
+			while (first + num < n && !ops[first + num].read) {
+				struct microp_i2c_op *op = &ops[first + num];
+
+				dev_dbg(&client->dev, "W [%02X] = %s\n",
+					op->addr, hex2string(op->data, op->length));
+				wbuf[num][0] = op->addr;
+				memcpy(&wbuf[num][1], op->data, op->length);
+				msgs[num].addr = client->addr;
+				msgs[num].flags = 0;
+				msgs[num].len = op->length + 1;
+				msgs[num].buf = wbuf[num];
+				if (op->addr == MICROP_I2C_WCMD_LCM_BURST_EN)
+					burst = 1;
+				num++;
+			}
+			if (microp_i2c_xfer(client, msgs, num,
+					    I2C_WRITE_RETRY_TIMES) < 0) {
+				dev_err(&client->dev, "[MP_I2C_ERR] i2c_write_block retry over %d\n",
+					I2C_WRITE_RETRY_TIMES);
+				return -EIO;
+			}
+			if (burst)
+				udelay(500);/*1.5ms for microp SPI write */
+		}
+
+		/* a combined transfer is charged to its commands evenly */
+		t = div_u64(sched_clock() - t, num);
+		for (j = first; j < first + num; j++) {
+			microp_cmd_stats[ops[j].addr].count++;
+			microp_cmd_stats[ops[j].addr].bus_ns += t;
+		}
 	}
 
 	return 0;
 }
 
-static int i2c_write_block(struct i2c_client *client, uint8_t addr,
-	uint8_t *data, int length)
+/**
+ * microp_i2c_batch - run several microP commands in one go
+ * @ops: the commands, executed in order
+ * @n: number of commands, at most MICROP_I2C_BATCH_MAX
+ * @prio: MICROP_PRIO_BACKGROUND for requests nobody is waiting on
+ *
+ * The bus is held across all of @ops, so no other client slips in
+ * between, and runs of writes share one transfer.
+ */
+int microp_i2c_batch(struct microp_i2c_op *ops, int n, int prio)
 {
-	int retry;
-	uint8_t buf[MICROP_I2C_WRITE_BLOCK_SIZE];
-	int i;
+	struct i2c_client *client = private_microp_client;
 	struct microp_i2c_client_data *cdata;
-	struct i2c_msg msg[] = {
-		{
-			.addr = client->addr,
-			.flags = 0,
-			.len = length + 1,
-			.buf = buf,
-		}
-	};
+	int ret;
 
-	dev_dbg(&client->dev, "W [%02X] = %s\n",
-			addr, hex2string(data, length));
+	if (!client) {
+		printk(KERN_ERR "[MP_I2C_ERR] %s: dataset: client is empty\n", __func__);
+		return -EIO;
+	}
+	if (n <= 0 || n > MICROP_I2C_BATCH_MAX)
+		return -EINVAL;
 
 	cdata = i2c_get_clientdata(client);
-	if (length + 1 > MICROP_I2C_WRITE_BLOCK_SIZE) {
-		dev_err(&client->dev, "[MP_I2C_ERR] i2c_write_block length too long\n");
-		return -E2BIG;
-	}
+	microp_bus_lock(cdata, prio);
+	ret = microp_i2c_run(client, ops, n);
+	microp_bus_unlock(cdata);
+
+	return ret;
+}
+EXPORT_SYMBOL(microp_i2c_batch);
 
-	buf[0] = addr;
-	for (i = 0; i < length; i++)
-		buf[i+1] = data[i];
+static int i2c_read_block(struct i2c_client *client, uint8_t addr,
+	uint8_t *data, int length)
+{
+	struct microp_i2c_client_data *cdata = i2c_get_clientdata(client);
+	struct microp_i2c_op op = {
+		.addr = addr,
+		.read = 1,
+		.data = data,
+		.length = length,
+	};
+	int ret;
 
-	mutex_lock(&cdata->microp_i2c_rw_mutex);
-	hr_msleep(1);
-	for (retry = 0; retry <= I2C_WRITE_RETRY_TIMES; retry++) {
-		if (i2c_transfer(client->adapter, msg, 1) == 1)
-			break;
-		msleep(microp_rw_delay);
-	}
-	if (retry > I2C_WRITE_RETRY_TIMES) {
-		dev_err(&client->dev, "[MP_I2C_ERR] i2c_write_block retry over %d\n",
-			I2C_WRITE_RETRY_TIMES);
-		mutex_unlock(&cdata->microp_i2c_rw_mutex);
-		return -EIO;
-	}
-	if (addr == MICROP_I2C_WCMD_LCM_BURST_EN)
-		udelay(500);/*1.5ms for microp SPI write */
-	mutex_unlock(&cdata->microp_i2c_rw_mutex);
+	microp_bus_lock(cdata, MICROP_PRIO_NORMAL);
+	ret = microp_i2c_run(client, &op, 1);
+	microp_bus_unlock(cdata);
 
-	return 0;
+	return ret;
+}
+
+static int i2c_write_block(struct i2c_client *client, uint8_t addr,
+	uint8_t *data, int length)
+{
+	struct microp_i2c_client_data *cdata = i2c_get_clientdata(client);
+	struct microp_i2c_op op = {
+		.addr = addr,
+		.read = 0,
+		.data = data,
+		.length = length,
+	};
+	int ret;
+
+	microp_bus_lock(cdata, MICROP_PRIO_NORMAL);
+	ret = microp_i2c_run(client, &op, 1);
+	microp_bus_unlock(cdata);
+
+	return ret;
 }
 
 int microp_i2c_read(uint8_t addr, uint8_t *data, int length)
@@ -235,35 +346,53 @@ int microp_write_interrupt(struct i2c_client *client,
 	return ret;
 }
 
-int microp_read_adc(uint8_t *data)
+/* The request and the read of the result hold the bus together */
+static int __microp_read_adc(uint8_t *data, int prio)
 {
 	struct i2c_client *client;
 	struct microp_i2c_client_data *cdata;
+	uint8_t req[2];
+	struct microp_i2c_op ops[] = {
+		{
+			.addr = MICROP_I2C_WCMD_READ_ADC_VALUE_REQ,
+			.data = req,
+			.length = 2,
+		},
+		{
+			.addr = MICROP_I2C_RCMD_ADC_VALUE,
+			.read = 1,
+			.data = data,
+			.length = 2,
+		}
+	};
 	int ret = 0;
 
 	client = private_microp_client;
 	cdata = i2c_get_clientdata(client);
 
 	mutex_lock(&cdata->microp_adc_mutex);
-	if (i2c_write_block(client, MICROP_I2C_WCMD_READ_ADC_VALUE_REQ,
-			data, 2) < 0) {
-		dev_err(&client->dev, "[MP_ADC_ERR] %s: request adc fail\n", __func__);
-		ret = -EIO;
-		goto exit;
-	}
+	memcpy(req, data, 2);
 	memset(data, 0x00, 2);
-	if (i2c_read_block(client, MICROP_I2C_RCMD_ADC_VALUE, data, 2) < 0) {
+	if (microp_i2c_batch(ops, ARRAY_SIZE(ops), prio) < 0) {
 		dev_err(&client->dev, "[MP_ADC_ERR] %s: read adc fail\n", __func__);
 		ret = -EIO;
-		goto exit;
 	}
-exit:
 	mutex_unlock(&cdata->microp_adc_mutex);
 	return ret;
 }
 
+int microp_read_adc(uint8_t *data)
+{
+	return __microp_read_adc(data, MICROP_PRIO_NORMAL);
+}
 EXPORT_SYMBOL(microp_read_adc);
 
+int microp_read_adc_background(uint8_t *data)
+{
+	return __microp_read_adc(data, MICROP_PRIO_BACKGROUND);
+}
+EXPORT_SYMBOL(microp_read_adc_background);
+
 int microp_read_gpio_status(uint8_t *data)
 {
 	struct i2c_client *client;
@@ -460,6 +589,29 @@ static ssize_t microp_gpio_store(struct device *dev,
 	return count;
 }
 
+static ssize_t microp_bus_stats_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct microp_i2c_client_data *cdata = dev_get_drvdata(dev);
+	char *s = buf;
+	int i;
+
+	mutex_lock(&cdata->microp_i2c_rw_mutex);
+	for (i = 0; i < ARRAY_SIZE(microp_cmd_stats); i++) {
+		if (!microp_cmd_stats[i].count)
+			continue;
+		if (s - buf > PAGE_SIZE - 40)
+			break;
+		s += sprintf(s, "%02X: %u cmds, %llu us\n", i,
+			microp_cmd_stats[i].count,
+			div_u64(microp_cmd_stats[i].bus_ns, NSEC_PER_USEC));
+	}
+	mutex_unlock(&cdata->microp_i2c_rw_mutex);
+
+	return s - buf;
+}
+static DEVICE_ATTR(bus_stats, 0444, microp_bus_stats_show, NULL);
+
 static DEVICE_ATTR(gpio, 0644,  microp_gpio_show,
 			microp_gpio_store);
 
@@ -612,6 +764,7 @@ static int __devexit microp_i2c_remove(struct i2c_client *client)
 	device_remove_file(&client->dev, &dev_attr_reset);
 	device_remove_file(&client->dev, &dev_attr_version);
 	device_remove_file(&client->dev, &dev_attr_gpio);
+	device_remove_file(&client->dev, &dev_attr_bus_stats);
 	destroy_workqueue(cdata->microp_queue);
 	kfree(cdata);
 
@@ -730,6 +883,7 @@ static int microp_i2c_probe(struct i2c_client *client
 	ret = device_create_file(&client->dev, &dev_attr_reset);
 	ret = device_create_file(&client->dev, &dev_attr_version);
 	ret = device_create_file(&client->dev, &dev_attr_gpio);
+	ret = device_create_file(&client->dev, &dev_attr_bus_stats);
 
 	register_microp_devices(pdata->microp_devices, pdata->num_devices);
 	if (board_ops->init_microp_func) {
@@ -750,6 +904,7 @@ err_fun_init:
 	device_remove_file(&client->dev, &dev_attr_reset);
 	device_remove_file(&client->dev, &dev_attr_version);
 	device_remove_file(&client->dev, &dev_attr_gpio);
+	device_remove_file(&client->dev, &dev_attr_bus_stats);
 	destroy_workqueue(cdata->microp_queue);
 err_intr:
 err_create_work_queue:
@@ -0,0 +1,92 @@
+/* arch/arm/mach-msm/bench.h
+ *
+ * Latency bookkeeping shared by the hot path benchmark modules.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _ARCH_ARM_MACH_MSM_BENCH_H_
+#define _ARCH_ARM_MACH_MSM_BENCH_H_
+
+#include <linux/hrtimer.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+
+struct msm_bench {
+	const char *name;
+	u32 *ns;		/* one latency sample per iteration */
+	unsigned int nr;
+	unsigned int max;
+	ktime_t start;
+};
+
+static inline int msm_bench_init(struct msm_bench *b, const char *name,
+				 unsigned int max)
+{
+	b->name = name;
+	b->nr = 0;
+	b->max = max;
+	b->ns = vmalloc(sizeof(*b->ns) * max);
+	return b->ns ? 0 : -ENOMEM;
+}
+
+static inline void msm_bench_free(struct msm_bench *b)
+{
+	vfree(b->ns);
+}
+
+static inline void msm_bench_add(struct msm_bench *b, ktime_t from,
+				 ktime_t to)
+{
+	s64 ns = ktime_to_ns(ktime_sub(to, from));
+
+	if (b->nr < b->max)
+		b->ns[b->nr++] = clamp_t(s64, ns, 0, ~0U);
+}
+
+static inline int msm_bench_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static inline u32 msm_bench_pct(struct msm_bench *b, unsigned int pct)
+{
+	return b->ns[(b->nr - 1) * pct / 100];
+}
+
+/* kB/s for @bytes moved in @ns of wall time */
+static inline u64 msm_bench_rate(u64 bytes, s64 ns)
+{
+	return div64_u64(bytes * NSEC_PER_SEC, max_t(s64, ns, 1) * 1024ULL);
+}
+
+/* Sort the samples and print min/median/tail latencies in microseconds */
+static inline void msm_bench_report(struct msm_bench *b, const char *what)
+{
+	if (!b->nr) {
+		pr_info("%s: %s: no samples\n", b->name, what);
+		return;
+	}
+
+	sort(b->ns, b->nr, sizeof(*b->ns), msm_bench_cmp, NULL);
+	pr_info("%s: %s: %u runs, us min %u p50 %u p90 %u p99 %u max %u\n",
+		b->name, what, b->nr, b->ns[0] / 1000,
+		msm_bench_pct(b, 50) / 1000, msm_bench_pct(b, 90) / 1000,
+		msm_bench_pct(b, 99) / 1000, b->ns[b->nr - 1] / 1000);
+	b->nr = 0;
+}
+
+#endif
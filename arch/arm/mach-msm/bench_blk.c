@@ -0,0 +1,272 @@
+/* arch/arm/mach-msm/bench_blk.c
+ *
+ * Block device read benchmark at queue depth.
+ *
+ * Reads a block device, e.g. mmcblk0 on msm_sdcc or an mtdblock on
+ * msm_nand, with 1, 2, 4, ... up to max_depth requests in flight, and
+ * prints the throughput and the completion latency distribution for each
+ * depth when the module is loaded. The bios go straight to the device,
+ * so the page cache does not get in the way. The module refuses to stay
+ * loaded so it can simply be loaded again.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/err.h>
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+#include "bench.h"
+
+static char *dev = "/dev/block/mmcblk0";
+module_param(dev, charp, 0);
+MODULE_PARM_DESC(dev, "Block device to read");
+
+static unsigned int bs_kb = 64;
+module_param(bs_kb, uint, 0);
+MODULE_PARM_DESC(bs_kb, "Request size in kB");
+
+static unsigned int total_mb = 32;
+module_param(total_mb, uint, 0);
+MODULE_PARM_DESC(total_mb, "Data read per queue depth, in MB");
+
+static unsigned int max_depth = 16;
+module_param(max_depth, uint, 0);
+MODULE_PARM_DESC(max_depth, "Deepest queue depth to run");
+
+static int random_reads;
+module_param(random_reads, bool, 0);
+MODULE_PARM_DESC(random_reads, "Read at random offsets instead of in order");
+
+#define BENCH_BLK_MAX_DEPTH	64
+
+struct bench_blk_slot {
+	struct page **pages;
+	ktime_t start;
+	struct bench_blk_slot *next;
+};
+
+static struct block_device *bdev;
+static unsigned int nr_pages;		/* pages per request */
+static unsigned int nr_reqs_dev;		/* requests that fit on the device */
+static struct msm_bench bench;
+
+static DEFINE_SPINLOCK(slot_lock);
+static DECLARE_WAIT_QUEUE_HEAD(slot_wait);
+static struct bench_blk_slot *free_slots;
+static unsigned int inflight;
+static int io_error;
+
+static void bench_blk_end_io(struct bio *bio, int error)
+{
+	struct bench_blk_slot *slot = bio->bi_private;
+	ktime_t now = ktime_get();
+	unsigned long flags;
+
+	spin_lock_irqsave(&slot_lock, flags);
+	msm_bench_add(&bench, slot->start, now);
+	if (error)
+		io_error = error;
+	slot->next = free_slots;
+	free_slots = slot;
+	inflight--;
+	spin_unlock_irqrestore(&slot_lock, flags);
+
+	wake_up(&slot_wait);
+	bio_put(bio);
+}
+
+static struct bench_blk_slot *bench_blk_get_slot(void)
+{
+	struct bench_blk_slot *slot;
+
+	spin_lock_irq(&slot_lock);
+	slot = free_slots;
+	if (slot) {
+		free_slots = slot->next;
+		inflight++;
+	}
+	spin_unlock_irq(&slot_lock);
+
+	return slot;
+}
+
+static int bench_blk_idle(void)
+{
+	int idle;
+
+	spin_lock_irq(&slot_lock);
+	idle = !inflight;
+	spin_unlock_irq(&slot_lock);
+
+	return idle;
+}
+
+static int __init bench_blk_submit(struct bench_blk_slot *slot,
+				   unsigned int req)
+{
+	struct bio *bio;
+	unsigned int i;
+
+	bio = bio_alloc(GFP_KERNEL, nr_pages);
+	bio->bi_bdev = bdev;
+	bio->bi_sector = (sector_t)req * (nr_pages << (PAGE_SHIFT - 9));
+	bio->bi_end_io = bench_blk_end_io;
+	bio->bi_private = slot;
+
+	for (i = 0; i < nr_pages; i++) {
+		if (!bio_add_page(bio, slot->pages[i], PAGE_SIZE, 0)) {
+			bio_put(bio);
+			return -EINVAL;
+		}
+	}
+
+	slot->start = ktime_get();
+	submit_bio(READ, bio);
+	return 0;
+}
+
+static int __init bench_blk_depth(struct bench_blk_slot *slots,
+				  unsigned int depth)
+{
+	unsigned int i, nr_reqs;
+	struct bench_blk_slot *slot;
+	ktime_t start, end;
+	char what[16];
+	int ret = 0;
+
+	nr_reqs = (u64)total_mb * 1024 / bs_kb;
+	if (nr_reqs > nr_reqs_dev)
+		nr_reqs = nr_reqs_dev;
+
+	free_slots = NULL;
+	for (i = 0; i < depth; i++) {
+		slots[i].next = free_slots;
+		free_slots = &slots[i];
+	}
+	io_error = 0;
+
+	start = ktime_get();
+	for (i = 0; i < nr_reqs; i++) {
+		wait_event(slot_wait, (slot = bench_blk_get_slot()) != NULL);
+		ret = bench_blk_submit(slot, random_reads ?
+				       random32() % nr_reqs_dev : i);
+		if (ret) {
+			spin_lock_irq(&slot_lock);
+			slot->next = free_slots;
+			free_slots = slot;
+			inflight--;
+			spin_unlock_irq(&slot_lock);
+			break;
+		}
+	}
+	wait_event(slot_wait, bench_blk_idle());
+	end = ktime_get();
+
+	if (!ret)
+		ret = io_error;
+	if (ret) {
+		pr_err("bench_blk: read failed (%d)\n", ret);
+		return ret;
+	}
+
+	snprintf(what, sizeof(what), "depth %u", depth);
+	msm_bench_report(&bench, what);
+	pr_info("bench_blk: depth %u: %llu kB/s\n", depth,
+		msm_bench_rate((u64)nr_reqs * bs_kb * 1024,
+			       ktime_to_ns(ktime_sub(end, start))));
+	return 0;
+}
+
+static int __init bench_blk_init(void)
+{
+	struct bench_blk_slot *slots;
+	unsigned int depth, i, j;
+	int ret;
+
+	if (!bs_kb || bs_kb % (PAGE_SIZE / 1024) || !total_mb ||
+	    !max_depth || max_depth > BENCH_BLK_MAX_DEPTH)
+		return -EINVAL;
+	nr_pages = bs_kb / (PAGE_SIZE / 1024);
+	if (nr_pages > BIO_MAX_PAGES)
+		return -EINVAL;
+
+	bdev = open_bdev_exclusive(dev, FMODE_READ, &bench);
+	if (IS_ERR(bdev)) {
+		pr_err("bench_blk: cannot open %s (%ld)\n", dev,
+		       PTR_ERR(bdev));
+		return PTR_ERR(bdev);
+	}
+
+	nr_reqs_dev = min_t(loff_t, i_size_read(bdev->bd_inode) >> PAGE_SHIFT,
+			    UINT_MAX) / nr_pages;
+	if (!nr_reqs_dev) {
+		ret = -ENOSPC;
+		goto out_bdev;
+	}
+
+	ret = msm_bench_init(&bench, "bench_blk",
+			     (u64)total_mb * 1024 / bs_kb);
+	if (ret)
+		goto out_bdev;
+
+	ret = -ENOMEM;
+	slots = kcalloc(max_depth, sizeof(*slots), GFP_KERNEL);
+	if (!slots)
+		goto out_bench;
+	for (i = 0; i < max_depth; i++) {
+		slots[i].pages = kcalloc(nr_pages, sizeof(struct page *),
+					 GFP_KERNEL);
+		if (!slots[i].pages)
+			goto out_slots;
+		for (j = 0; j < nr_pages; j++) {
+			slots[i].pages[j] = alloc_page(GFP_KERNEL);
+			if (!slots[i].pages[j])
+				goto out_slots;
+		}
+	}
+
+	pr_info("bench_blk: %s, %u kB %s reads\n", dev, bs_kb,
+		random_reads ? "random" : "sequential");
+	for (depth = 1; depth <= max_depth; depth *= 2) {
+		ret = bench_blk_depth(slots, depth);
+		if (ret)
+			goto out_slots;
+	}
+	ret = -EAGAIN;
+
+out_slots:
+	for (i = 0; i < max_depth; i++) {
+		if (!slots[i].pages)
+			continue;
+		for (j = 0; j < nr_pages; j++)
+			if (slots[i].pages[j])
+				__free_page(slots[i].pages[j]);
+		kfree(slots[i].pages);
+	}
+	kfree(slots);
+out_bench:
+	msm_bench_free(&bench);
+out_bdev:
+	close_bdev_exclusive(bdev, FMODE_READ);
+	return ret;
+}
+module_init(bench_blk_init);
+MODULE_LICENSE("GPL v2");
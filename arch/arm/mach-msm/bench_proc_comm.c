@@ -0,0 +1,69 @@
+/* arch/arm/mach-msm/bench_proc_comm.c
+ *
+ * proc_comm round trip benchmark.
+ *
+ * Issues a harmless proc_comm command in a loop and prints the latency
+ * distribution of the round trip to the modem when the module is loaded.
+ * The module refuses to stay loaded so it can simply be loaded again.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+
+#include "bench.h"
+#include "proc_comm.h"
+
+static unsigned int iters = 1000;
+module_param(iters, uint, 0);
+MODULE_PARM_DESC(iters, "Commands timed");
+
+static unsigned int cmd = PCOM_CHG_IS_CHARGING;
+module_param(cmd, uint, 0);
+MODULE_PARM_DESC(cmd, "proc_comm command to issue, must have no side effects");
+
+static int __init bench_proc_comm_init(void)
+{
+	struct msm_bench b;
+	unsigned int i, data1, data2;
+	ktime_t start;
+	int ret;
+
+	if (!iters)
+		return -EINVAL;
+
+	ret = msm_bench_init(&b, "bench_proc_comm", iters);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < iters; i++) {
+		data1 = data2 = 0;
+		start = ktime_get();
+		ret = msm_proc_comm(cmd, &data1, &data2);
+		msm_bench_add(&b, start, ktime_get());
+		if (ret) {
+			pr_err("bench_proc_comm: command %u failed (%d)\n",
+			       cmd, ret);
+			break;
+		}
+		cond_resched();
+	}
+
+	msm_bench_report(&b, "round trip");
+	msm_bench_free(&b);
+	return -EAGAIN;
+}
+module_init(bench_proc_comm_init);
+MODULE_LICENSE("GPL v2");
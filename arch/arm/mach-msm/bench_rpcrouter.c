@@ -0,0 +1,91 @@
+/* arch/arm/mach-msm/bench_rpcrouter.c
+ *
+ * ONCRPC call latency benchmark.
+ *
+ * Connects to a modem RPC server and times calls to its null procedure,
+ * which every ONCRPC program implements and which does no work, so the
+ * result is the cost of the router, the SMD transport and the server's
+ * dispatch. Prints the latency distribution when the module is loaded,
+ * and refuses to stay loaded so it can simply be loaded again.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/err.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+#include <mach/msm_rpcrouter.h>
+
+#include "bench.h"
+
+/* The PMIC library server is present on every 7x30 modem build */
+static unsigned int prog = 0x30000061;
+module_param(prog, uint, 0);
+MODULE_PARM_DESC(prog, "RPC program to call");
+
+static unsigned int vers = 0x00010001;
+module_param(vers, uint, 0);
+MODULE_PARM_DESC(vers, "RPC program version");
+
+static unsigned int iters = 1000;
+module_param(iters, uint, 0);
+MODULE_PARM_DESC(iters, "Calls timed");
+
+#define RPC_NULL_PROC	0
+
+static int __init bench_rpcrouter_init(void)
+{
+	struct msm_rpc_endpoint *ept;
+	struct rpc_request_hdr req;
+	struct msm_bench b;
+	unsigned int i;
+	ktime_t start;
+	int ret;
+
+	if (!iters)
+		return -EINVAL;
+
+	ret = msm_bench_init(&b, "bench_rpcrouter", iters);
+	if (ret)
+		return ret;
+
+	ept = msm_rpc_connect_compatible(prog, vers, 0);
+	if (IS_ERR(ept)) {
+		pr_err("bench_rpcrouter: cannot connect to %08x:%08x (%ld)\n",
+		       prog, vers, PTR_ERR(ept));
+		ret = PTR_ERR(ept);
+		goto out_bench;
+	}
+
+	for (i = 0; i < iters; i++) {
+		start = ktime_get();
+		ret = msm_rpc_call(ept, RPC_NULL_PROC, &req, sizeof(req),
+				   5 * HZ);
+		msm_bench_add(&b, start, ktime_get());
+		if (ret < 0) {
+			pr_err("bench_rpcrouter: call failed (%d)\n", ret);
+			break;
+		}
+		cond_resched();
+	}
+
+	msm_bench_report(&b, "null call");
+	ret = ret < 0 ? ret : -EAGAIN;
+	msm_rpc_close(ept);
+out_bench:
+	msm_bench_free(&b);
+	return ret;
+}
+module_init(bench_rpcrouter_init);
+MODULE_LICENSE("GPL v2");
@@ -0,0 +1,154 @@
+/* arch/arm/mach-msm/bench_smd.c
+ *
+ * SMD loopback round trip benchmark.
+ *
+ * Opens the modem's loopback channel, and for each packet size writes a
+ * packet and waits for the modem to echo it back. Prints the round trip
+ * latency distribution and the echoed throughput when the module is
+ * loaded, and refuses to stay loaded so it can simply be loaded again.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/completion.h>
+#include <linux/init.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/wait.h>
+#include <mach/msm_smd.h>
+
+#include "bench.h"
+
+static unsigned int iters = 1000;
+module_param(iters, uint, 0);
+MODULE_PARM_DESC(iters, "Round trips timed per packet size");
+
+static char *channel = "LOOPBACK";
+module_param(channel, charp, 0);
+MODULE_PARM_DESC(channel, "SMD channel whose remote end echoes writes");
+
+static const int sizes[] __initconst = {
+	16, 64, 256, 1024, 4096,
+};
+
+static smd_channel_t *ch;
+static DECLARE_COMPLETION(ch_opened);
+static DECLARE_WAIT_QUEUE_HEAD(ch_wait);
+
+static void bench_smd_notify(void *priv, unsigned event)
+{
+	switch (event) {
+	case SMD_EVENT_OPEN:
+		complete(&ch_opened);
+		break;
+	case SMD_EVENT_DATA:
+		wake_up(&ch_wait);
+		break;
+	}
+}
+
+static int __init bench_smd_size(struct msm_bench *b, char *buf, int size)
+{
+	ktime_t start, now, first;
+	char what[16];
+	unsigned int i;
+	long t;
+	int n;
+
+	first = ktime_get();
+	for (i = 0; i < iters; i++) {
+		start = ktime_get();
+		if (smd_write(ch, buf, size) != size) {
+			pr_err("bench_smd: short write of %d bytes\n", size);
+			return -EIO;
+		}
+
+		for (n = 0; n < size; ) {
+			t = wait_event_timeout(ch_wait, smd_read_avail(ch) > 0,
+					       HZ);
+			if (!t) {
+				pr_err("bench_smd: no echo from %s\n",
+				       channel);
+				return -ETIMEDOUT;
+			}
+			n += smd_read(ch, buf + n, size - n);
+		}
+		msm_bench_add(b, start, ktime_get());
+	}
+	now = ktime_get();
+
+	snprintf(what, sizeof(what), "%d bytes", size);
+	msm_bench_report(b, what);
+	pr_info("bench_smd: %d bytes: %llu kB/s echoed\n", size,
+		msm_bench_rate((u64)size * iters,
+			       ktime_to_ns(ktime_sub(now, first))));
+	return 0;
+}
+
+static int __init bench_smd_init(void)
+{
+	struct msm_bench b;
+	unsigned int i;
+	char *buf;
+	int ret;
+
+	if (!iters)
+		return -EINVAL;
+
+	ret = msm_bench_init(&b, "bench_smd", iters);
+	if (ret)
+		return ret;
+
+	buf = kmalloc(sizes[ARRAY_SIZE(sizes) - 1], GFP_KERNEL);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto out_bench;
+	}
+	memset(buf, 0x5a, sizes[ARRAY_SIZE(sizes) - 1]);
+
+	ret = smd_open(channel, &ch, NULL, bench_smd_notify);
+	if (ret) {
+		pr_err("bench_smd: cannot open %s (%d)\n", channel, ret);
+		goto out_buf;
+	}
+	if (!wait_for_completion_timeout(&ch_opened, 5 * HZ)) {
+		pr_err("bench_smd: %s did not open\n", channel);
+		ret = -ETIMEDOUT;
+		goto out_close;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		if (sizes[i] > smd_write_avail(ch)) {
+			pr_info("bench_smd: %d bytes exceeds the fifo\n",
+				sizes[i]);
+			break;
+		}
+		ret = bench_smd_size(&b, buf, sizes[i]);
+		if (ret)
+			break;
+	}
+	if (!ret)
+		ret = -EAGAIN;
+
+out_close:
+	smd_close(ch);
+out_buf:
+	kfree(buf);
+out_bench:
+	msm_bench_free(&b);
+	return ret;
+}
+module_init(bench_smd_init);
+MODULE_LICENSE("GPL v2");
@@ -269,7 +269,8 @@ int glacier_wifi_power(int on)
 
 	gpio_set_value(GLACIER_GPIO_WIFI_SHUTDOWN_N, on); /* WIFI_SHUTDOWN */
 
-	mdelay(120);
+	/* only called from the driver's process context; let others run */
+	msleep(120);
 	return 0;
 }
 EXPORT_SYMBOL(glacier_wifi_power);
@@ -2092,6 +2092,8 @@ static void __init glacier_init(void)
 {
 	int ret = 0;
 	uint32_t soc_version = 0;
+	s32 pm_latency;
+	int i;
 
 	printk("glacier_init() reglacier=%d\n", system_rev);
 	printk(KERN_INFO "%s: microp version = %s\n", __func__, microp_ver);
@@ -2109,7 +2111,15 @@ static void __init glacier_init(void)
 		&msm_device_uart2.dev, 23, MSM_GPIO_TO_INT(GLACIER_GPIO_UART2_RX));
 #endif
 
+	msm_pm_set_platform_data(msm_pm_data, ARRAY_SIZE(msm_pm_data));
+
+	/* stay out of power collapse while BT is active or the screen touched */
+	pm_latency = msm_pm_collapse_latency();
+	for (i = 0; i < ARRAY_SIZE(glacier_ts_atmel_data); i++)
+		glacier_ts_atmel_data[i].cpu_dma_latency = pm_latency;
+
 #ifdef CONFIG_SERIAL_MSM_HS
+	msm_uart_dm1_pdata.cpu_dma_latency = pm_latency;
 	msm_device_uart_dm1.dev.platform_data = &msm_uart_dm1_pdata;
 	#ifndef CONFIG_SERIAL_MSM_HS_PURE_ANDROID
 	msm_device_uart_dm1.name = "msm_serial_hs_bcm";	/* for bcm */
@@ -2119,7 +2129,6 @@ static void __init glacier_init(void)
 	msm_add_serial_devices(0);
 #endif
 
-	msm_pm_set_platform_data(msm_pm_data, ARRAY_SIZE(msm_pm_data));
 #ifdef CONFIG_USB_MSM_OTG_72K
 	if (SOCINFO_VERSION_MAJOR(soc_version) >= 2 &&
 			SOCINFO_VERSION_MINOR(soc_version) >= 1) {
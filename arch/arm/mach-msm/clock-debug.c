@@ -218,6 +218,14 @@ int __init clock_debug_add(struct clk *clock)
 				&clock_local_fops))
 		goto error;
 
+	if (!debugfs_create_u32("rate_calls", S_IRUGO, clk_dir,
+				&clock->rate_calls))
+		goto error;
+
+	if (!debugfs_create_u32("rate_changes", S_IRUGO, clk_dir,
+				&clock->rate_changes))
+		goto error;
+
 	if (measure &&
 	    !clk_set_parent(measure, clock) &&
 	    !debugfs_create_file("measure", S_IRUGO, clk_dir, clock,
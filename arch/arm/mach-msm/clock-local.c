@@ -547,6 +547,7 @@ static int _rcg_clk_set_rate(struct rcg_clk *clk, struct clk_freq_tbl *nf)
 	unsigned long flags;
 
 	spin_lock_irqsave(&clk->c.lock, flags);
+	clk->c.rate_calls++;
 
 	/* Check if frequency is actually changed. */
 	cf = clk->current_freq;
@@ -593,6 +594,7 @@ static int _rcg_clk_set_rate(struct rcg_clk *clk, struct clk_freq_tbl *nf)
 	 * is called to make sure the MNCNTR_EN bit is set correctly.
 	 */
 	clk->current_freq = nf;
+	clk->c.rate_changes++;
 
 	/* Enable any clocks that were disabled. */
 	if (!clk->bank_info) {
@@ -15,6 +15,7 @@
 
 #include <linux/kernel.h>
 #include <linux/err.h>
+#include <linux/spinlock.h>
 
 #include <mach/clk.h>
 #include <mach/socinfo.h>
@@ -26,6 +27,43 @@
 /*
  * glue for the proc_comm interface
  */
+
+#define PC_CLK_RATE	BIT(0)
+#define PC_CLK_MIN_RATE	BIT(1)
+#define PC_CLK_MAX_RATE	BIT(2)
+
+/* Serializes rate votes with the bookkeeping of what the modem was sent */
+static DEFINE_SPINLOCK(pc_clk_vote_lock);
+
+/*
+ * Send a rate vote unless it repeats the last one that succeeded. Drivers
+ * set the same rates again on every resume or use case, and each repeat
+ * would otherwise cost a full round trip to the modem.
+ */
+static int pc_clk_vote(struct clk *clk, unsigned cmd, unsigned which,
+		       unsigned *last, int *id, unsigned rate)
+{
+	struct pcom_clk *pc = to_pcom_clk(clk);
+	unsigned long flags;
+	unsigned data = rate;
+	int rc = 0;
+
+	spin_lock_irqsave(&pc_clk_vote_lock, flags);
+	if ((pc->cached & which) && *last == rate)
+		goto out;
+
+	rc = msm_proc_comm(cmd, id, &data);
+	if (rc == 0 && *id >= 0) {
+		pc->cached |= which;
+		*last = rate;
+	} else {
+		pc->cached &= ~which;
+	}
+out:
+	spin_unlock_irqrestore(&pc_clk_vote_lock, flags);
+	return rc;
+}
+
 static int pc_clk_enable(struct clk *clk)
 {
 	int rc;
@@ -80,8 +118,10 @@ static int pc_clk_set_rate(struct clk *clk, unsigned rate)
 	 * remote function. So a return value of 0 doesn't necessarily mean
 	 * that the exact rate was set successfully.
 	 */
-	int id = to_pcom_clk(clk)->id;
-	int rc = msm_proc_comm(PCOM_CLKCTL_RPC_SET_RATE, &id, &rate);
+	struct pcom_clk *pc = to_pcom_clk(clk);
+	int id = pc->id;
+	int rc = pc_clk_vote(clk, PCOM_CLKCTL_RPC_SET_RATE, PC_CLK_RATE,
+			     &pc->rate, &id, rate);
 	if (rc < 0)
 		return rc;
 	else
@@ -91,11 +131,13 @@ static int pc_clk_set_rate(struct clk *clk, unsigned rate)
 static int pc_clk_set_min_rate(struct clk *clk, unsigned rate)
 {
 	int rc;
-	int id = to_pcom_clk(clk)->id;
+	struct pcom_clk *pc = to_pcom_clk(clk);
+	int id = pc->id;
 	bool ignore_error = (cpu_is_msm7x27() && id == P_EBI1_CLK &&
 				rate >= INT_MAX);
 
-	rc = msm_proc_comm(PCOM_CLKCTL_RPC_MIN_RATE, &id, &rate);
+	rc = pc_clk_vote(clk, PCOM_CLKCTL_RPC_MIN_RATE, PC_CLK_MIN_RATE,
+			 &pc->min_rate, &id, rate);
 	if (rc < 0)
 		return rc;
 	else if (ignore_error)
@@ -106,8 +148,10 @@ static int pc_clk_set_min_rate(struct clk *clk, unsigned rate)
 
 static int pc_clk_set_max_rate(struct clk *clk, unsigned rate)
 {
-	int id = to_pcom_clk(clk)->id;
-	int rc = msm_proc_comm(PCOM_CLKCTL_RPC_MAX_RATE, &id, &rate);
+	struct pcom_clk *pc = to_pcom_clk(clk);
+	int id = pc->id;
+	int rc = pc_clk_vote(clk, PCOM_CLKCTL_RPC_MAX_RATE, PC_CLK_MAX_RATE,
+			     &pc->max_rate, &id, rate);
 	if (rc < 0)
 		return rc;
 	else
@@ -161,10 +161,18 @@ extern struct clk_ops clk_ops_pcom_ext_config;
 /*
  * struct pcom_clk - proc_comm controlled clock
  * @id: proc_comm identifier
+ * @cached: which of @rate, @min_rate and @max_rate hold the last vote sent
+ * @rate: last rate sent with PCOM_CLKCTL_RPC_SET_RATE
+ * @min_rate: last rate sent with PCOM_CLKCTL_RPC_MIN_RATE
+ * @max_rate: last rate sent with PCOM_CLKCTL_RPC_MAX_RATE
  * @c:
  */
 struct pcom_clk {
 	unsigned id;
+	unsigned cached;
+	unsigned rate;
+	unsigned min_rate;
+	unsigned max_rate;
 	struct clk c;
 };
 
@@ -12,14 +12,33 @@
  */
 
 #include <linux/err.h>
+#include <linux/jiffies.h>
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <linux/clk.h>
 
 #include "clock.h"
 #include "clock-voter.h"
 
+/*
+ * Rate increases reach the parent at once. Decreases wait this long, so
+ * that voters updating one after another reprogram the parent only once,
+ * with the final aggregate.
+ */
+#define VOTER_CLK_DEFER_MS	10
+#define VOTER_CLK_MAX_PARENTS	4
+
 static DEFINE_SPINLOCK(voter_clk_lock);
 
+static struct voter_parent {
+	struct clk *clk;
+	unsigned rate;		/* rate last set on the parent */
+	bool lower;		/* a decrease is waiting for voter_clk_work */
+} voter_parents[VOTER_CLK_MAX_PARENTS];
+
+static void voter_clk_work_func(struct work_struct *work);
+static DECLARE_DELAYED_WORK(voter_clk_work, voter_clk_work_func);
+
 /* Aggregate the rate of clocks that are currently on. */
 static unsigned voter_clk_aggregate_rate(const struct clk *parent)
 {
@@ -34,40 +53,81 @@ static unsigned voter_clk_aggregate_rate(const struct clk *parent)
 	return rate;
 }
 
-static int voter_clk_set_rate(struct clk *clk, unsigned rate)
+static struct voter_parent *voter_clk_find_parent(const struct clk *parent)
 {
-	int ret = 0;
-	unsigned long flags;
-	struct clk *clkp;
-	struct clk_voter *clkh, *v = to_clk_voter(clk);
-	unsigned cur_rate, new_rate, other_rate = 0;
+	int i;
 
-	spin_lock_irqsave(&voter_clk_lock, flags);
+	for (i = 0; i < VOTER_CLK_MAX_PARENTS; i++)
+		if (voter_parents[i].clk == parent)
+			return &voter_parents[i];
+	return NULL;
+}
 
-	if (v->enabled) {
-		struct clk *parent = v->parent;
-
-		/*
-		 * Get the aggregate rate without this clock's vote and update
-		 * if the new rate is different than the current rate
-		 */
-		list_for_each_entry(clkp, &parent->children, siblings) {
-			clkh = to_clk_voter(clkp);
-			if (clkh->enabled && clkh != v)
-				other_rate = max(clkh->rate, other_rate);
-		}
+/* Must hold voter_clk_lock, with the votes already updated */
+static int voter_clk_update(struct clk *parent)
+{
+	struct voter_parent *vp = voter_clk_find_parent(parent);
+	unsigned rate;
+	int ret;
 
-		cur_rate = max(other_rate, v->rate);
-		new_rate = max(other_rate, rate);
+	if (WARN_ON(!vp))
+		return -EINVAL;
 
-		if (new_rate != cur_rate) {
-			ret = clk_set_min_rate(parent, new_rate);
-			if (ret)
-				goto unlock;
+	parent->rate_calls++;
+	rate = voter_clk_aggregate_rate(parent);
+	if (rate > vp->rate) {
+		ret = clk_set_min_rate(parent, rate);
+		if (ret)
+			return ret;
+		parent->rate_changes++;
+		vp->rate = rate;
+	} else if (rate < vp->rate && !vp->lower) {
+		vp->lower = true;
+		schedule_delayed_work(&voter_clk_work,
+				      msecs_to_jiffies(VOTER_CLK_DEFER_MS));
+	}
+	return 0;
+}
+
+static void voter_clk_work_func(struct work_struct *work)
+{
+	struct voter_parent *vp;
+	unsigned long flags;
+	unsigned rate;
+
+	spin_lock_irqsave(&voter_clk_lock, flags);
+	for (vp = voter_parents; vp < voter_parents + VOTER_CLK_MAX_PARENTS;
+	     vp++) {
+		if (!vp->lower)
+			continue;
+		vp->lower = false;
+
+		rate = voter_clk_aggregate_rate(vp->clk);
+		if (rate < vp->rate && !clk_set_min_rate(vp->clk, rate)) {
+			vp->clk->rate_changes++;
+			vp->rate = rate;
 		}
 	}
+	spin_unlock_irqrestore(&voter_clk_lock, flags);
+}
+
+static int voter_clk_set_rate(struct clk *clk, unsigned rate)
+{
+	int ret = 0;
+	unsigned long flags;
+	unsigned old_rate;
+	struct clk_voter *v = to_clk_voter(clk);
+
+	spin_lock_irqsave(&voter_clk_lock, flags);
+
+	old_rate = v->rate;
 	v->rate = rate;
-unlock:
+	if (v->enabled && rate != old_rate) {
+		ret = voter_clk_update(v->parent);
+		if (ret)
+			v->rate = old_rate;
+	}
+
 	spin_unlock_irqrestore(&voter_clk_lock, flags);
 
 	return ret;
@@ -75,27 +135,17 @@ unlock:
 
 static int voter_clk_enable(struct clk *clk)
 {
-	int ret = 0;
+	int ret;
 	unsigned long flags;
-	unsigned cur_rate;
-	struct clk *parent;
 	struct clk_voter *v = to_clk_voter(clk);
 
 	spin_lock_irqsave(&voter_clk_lock, flags);
-	parent = v->parent;
-
-	/*
-	 * Increase the rate if this clock is voting for a higher rate
-	 * than the current rate.
-	 */
-	cur_rate = voter_clk_aggregate_rate(parent);
-	if (v->rate > cur_rate) {
-		ret = clk_set_min_rate(parent, v->rate);
-		if (ret)
-			goto out;
-	}
+
 	v->enabled = true;
-out:
+	ret = voter_clk_update(v->parent);
+	if (ret)
+		v->enabled = false;
+
 	spin_unlock_irqrestore(&voter_clk_lock, flags);
 
 	return ret;
@@ -104,24 +154,11 @@ out:
 static void voter_clk_disable(struct clk *clk)
 {
 	unsigned long flags;
-	struct clk *parent;
 	struct clk_voter *v = to_clk_voter(clk);
-	unsigned cur_rate, new_rate;
 
 	spin_lock_irqsave(&voter_clk_lock, flags);
-	parent = v->parent;
-
-	/*
-	 * Decrease the rate if this clock was the only one voting for
-	 * the highest rate.
-	 */
 	v->enabled = false;
-	new_rate = voter_clk_aggregate_rate(parent);
-	cur_rate = max(new_rate, v->rate);
-
-	if (new_rate < cur_rate)
-		clk_set_min_rate(parent, new_rate);
-
+	voter_clk_update(v->parent);
 	spin_unlock_irqrestore(&voter_clk_lock, flags);
 }
 
@@ -153,13 +190,24 @@ static long voter_clk_round_rate(struct clk *clk, unsigned rate)
 static int voter_clk_set_parent(struct clk *clk, struct clk *parent)
 {
 	unsigned long flags;
+	struct voter_parent *vp;
+	int ret = 0;
 
 	spin_lock_irqsave(&voter_clk_lock, flags);
+	if (!voter_clk_find_parent(parent)) {
+		vp = voter_clk_find_parent(NULL);
+		if (WARN(!vp, "too many voter clock parents\n")) {
+			ret = -ENOMEM;
+			goto unlock;
+		}
+		vp->clk = parent;
+	}
 	if (list_empty(&clk->siblings))
 		list_add(&clk->siblings, &parent->children);
+unlock:
 	spin_unlock_irqrestore(&voter_clk_lock, flags);
 
-	return 0;
+	return ret;
 }
 
 static struct clk *voter_clk_get_parent(struct clk *clk)
@@ -21,6 +21,7 @@
 #include <linux/module.h>
 #include <linux/clk.h>
 #include <linux/clkdev.h>
+#include <trace/events/power.h>
 
 #include "clock.h"
 
@@ -55,6 +56,7 @@ int clk_enable(struct clk *clk)
 			clk_disable(parent);
 			goto out;
 		}
+		trace_clock_enable(clk->dbg_name, 1, smp_processor_id());
 	} else if (clk->flags & CLKFLAG_HANDOFF_RATE) {
 		/*
 		 * The clock was already enabled by handoff code so there is no
@@ -87,6 +89,7 @@ void clk_disable(struct clk *clk)
 	if (clk->count == 1) {
 		if (clk->ops->disable)
 			clk->ops->disable(clk);
+		trace_clock_disable(clk->dbg_name, 0, smp_processor_id());
 		clk_disable(clk->depends);
 		parent = clk_get_parent(clk);
 		clk_disable(parent);
@@ -120,6 +123,7 @@ int clk_set_rate(struct clk *clk, unsigned long rate)
 	if (!clk->ops->set_rate)
 		return -ENOSYS;
 
+	trace_clock_set_rate(clk->dbg_name, rate, raw_smp_processor_id());
 	return clk->ops->set_rate(clk, rate);
 }
 EXPORT_SYMBOL(clk_set_rate);
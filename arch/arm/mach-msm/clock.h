@@ -69,6 +69,10 @@ struct clk {
 
 	unsigned count;
 	spinlock_t lock;
+
+	/* Rate requests seen and hardware rate changes, where counted */
+	uint32_t rate_calls;
+	uint32_t rate_changes;
 };
 
 #define CLK_INIT(name) \
@@ -94,6 +94,9 @@
 #define MAX_RETRY_COUNT 5
 #define RETRY_DELAY 10
 
+/* asynch event messages kept per port for the SMD callback */
+#define DALRPC_ASYNCH_POOL 4
+
 struct dalrpc_msg_hdr {
 	uint32_t len:16;
 	uint32_t proto_ver:8;
@@ -111,6 +114,12 @@ struct dalrpc_msg {
 	uint32_t param[DALRPC_MAX_PARAMS];
 };
 
+struct dalrpc_asynch_msg {
+	struct list_head list;
+	int pooled;
+	struct dalrpc_msg msg;
+};
+
 struct dalrpc_event_handle {
 	struct list_head list;
 
@@ -147,10 +156,18 @@ struct dalrpc_port {
 
 	smd_channel_t *ch;
 
+	/* read state, only touched from the SMD callback */
 	struct dalrpc_msg msg_in;
 	struct daldevice_handle *msg_owner;
+	struct dalrpc_asynch_msg *msg_asynch;
 	unsigned msg_bytes_read;
 
+	/* asynch events read by the callback, dispatched by port_work */
+	spinlock_t asynch_lock;
+	struct list_head asynch_free;
+	struct list_head asynch_pending;
+	struct dalrpc_asynch_msg asynch_pool[DALRPC_ASYNCH_POOL];
+
 	struct list_head event_list;
 	struct mutex event_list_lock;
 
@@ -161,6 +178,8 @@ struct dalrpc_port {
 static LIST_HEAD(port_list);
 static LIST_HEAD(client_list);
 static DEFINE_MUTEX(pc_lists_lock);
+/* also held for client_list changes, for the SMD callback's lookups */
+static DEFINE_SPINLOCK(client_list_lock);
 
 static DECLARE_WAIT_QUEUE_HEAD(event_wq);
 
@@ -188,7 +207,8 @@ static int client_exists_locked(void *handle)
 {
 	struct daldevice_handle *h;
 
-	/* this function must be called with pc_lists_lock acquired */
+	/* this function must be called with pc_lists_lock or
+	 * client_list_lock acquired */
 
 	if (!handle)
 		return 0;
@@ -200,22 +220,6 @@ static int client_exists_locked(void *handle)
 	return 0;
 }
 
-static int port_exists(struct dalrpc_port *p)
-{
-	struct dalrpc_port *p_iter;
-
-	/* this function must be called with pc_lists_lock acquired */
-
-	if (!p)
-		return 0;
-
-	list_for_each_entry(p_iter, &port_list, list)
-		if (p_iter == p)
-			return 1;
-
-	return 0;
-}
-
 static struct dalrpc_port *port_name_exists(char *port)
 {
 	struct dalrpc_port *p;
@@ -240,8 +244,14 @@ static void port_close(struct dalrpc_port *p)
 	mutex_unlock(&pc_lists_lock);
 
 	if (p->refcount == 0) {
-		destroy_workqueue(p->wq);
+		struct dalrpc_asynch_msg *a, *tmp;
+
+		/* no callbacks, so no new work, once the channel is closed */
 		smd_close(p->ch);
+		destroy_workqueue(p->wq);
+		list_for_each_entry_safe(a, tmp, &p->asynch_pending, list)
+			if (!a->pooled)
+				kfree(a);
 		kfree(p);
 	}
 }
@@ -291,13 +301,13 @@ static int check_version(struct dalrpc_msg_hdr *msg_hdr)
 	return 0;
 }
 
-static void process_asynch(struct dalrpc_port *p)
+static void process_asynch(struct dalrpc_port *p, struct dalrpc_msg *msg)
 {
 	struct dalrpc_event_handle *ev;
 	struct dalrpc_cb_handle *cb;
 
-	ev = (struct dalrpc_event_handle *)p->msg_in.param[0];
-	cb = (struct dalrpc_cb_handle *)p->msg_in.param[0];
+	ev = (struct dalrpc_event_handle *)msg->param[0];
+	cb = (struct dalrpc_cb_handle *)msg->param[0];
 
 	mutex_lock(&p->event_list_lock);
 	if (event_exists(p, ev)) {
@@ -313,16 +323,57 @@ static void process_asynch(struct dalrpc_port *p)
 
 	mutex_lock(&p->cb_list_lock);
 	if (cb_exists(p, cb)) {
-		cb->fn(cb->context, p->msg_in.param[1],
-		       &p->msg_in.param[3], p->msg_in.param[2]);
+		cb->fn(cb->context, msg->param[1],
+		       &msg->param[3], msg->param[2]);
 		mutex_unlock(&p->cb_list_lock);
 		return;
 	}
 	mutex_unlock(&p->cb_list_lock);
 }
 
+/*
+ * Asynch events come from the pool, or from GFP_ATOMIC memory when
+ * more are waiting for port_work than the pool holds.
+ */
+static struct dalrpc_asynch_msg *dalrpc_asynch_get(struct dalrpc_port *p)
+{
+	struct dalrpc_asynch_msg *a = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&p->asynch_lock, flags);
+	if (!list_empty(&p->asynch_free)) {
+		a = list_first_entry(&p->asynch_free,
+				     struct dalrpc_asynch_msg, list);
+		list_del(&a->list);
+	}
+	spin_unlock_irqrestore(&p->asynch_lock, flags);
+
+	if (!a) {
+		a = kmalloc(sizeof(*a), GFP_ATOMIC);
+		if (a)
+			a->pooled = 0;
+	}
+	return a;
+}
+
+static void dalrpc_asynch_put(struct dalrpc_port *p,
+			      struct dalrpc_asynch_msg *a)
+{
+	unsigned long flags;
+
+	if (!a->pooled) {
+		kfree(a);
+		return;
+	}
+	spin_lock_irqsave(&p->asynch_lock, flags);
+	list_add(&a->list, &p->asynch_free);
+	spin_unlock_irqrestore(&p->asynch_lock, flags);
+}
+
 static void process_msg(struct dalrpc_port *p)
 {
+	unsigned long flags;
+
 	switch (p->msg_in.hdr.msgid) {
 
 	case DALRPC_MSGID_DDI_REPLY:
@@ -332,7 +383,11 @@ static void process_msg(struct dalrpc_port *p)
 		break;
 
 	case DALRPC_MSGID_ASYNCH:
-		process_asynch(p);
+		/* event and callback handlers may sleep */
+		spin_lock_irqsave(&p->asynch_lock, flags);
+		list_add_tail(&p->msg_asynch->list, &p->asynch_pending);
+		spin_unlock_irqrestore(&p->asynch_lock, flags);
+		queue_work(p->wq, &p->port_work);
 		break;
 
 	default:
@@ -347,7 +402,7 @@ static void flush_msg(struct dalrpc_port *p)
 
 	len = p->msg_in.hdr.len - sizeof(struct dalrpc_msg_hdr);
 	while (len > 0) {
-		bytes_read = smd_read(p->ch, NULL, len);
+		bytes_read = smd_read_from_cb(p->ch, NULL, len);
 		if (bytes_read <= 0)
 			break;
 		len -= bytes_read;
@@ -357,19 +412,38 @@ static void flush_msg(struct dalrpc_port *p)
 
 static int check_header(struct dalrpc_port *p)
 {
-	if (check_version(&p->msg_in.hdr) ||
-	    p->msg_in.hdr.len > DALRPC_MAX_MSG_SIZE ||
-	    (p->msg_in.hdr.msgid != DALRPC_MSGID_ASYNCH &&
-	     !client_exists_locked(p->msg_in.hdr.to))) {
+	unsigned long flags;
+	int bad;
+
+	spin_lock_irqsave(&client_list_lock, flags);
+	bad = check_version(&p->msg_in.hdr) ||
+		p->msg_in.hdr.len > DALRPC_MAX_MSG_SIZE ||
+		(p->msg_in.hdr.msgid != DALRPC_MSGID_ASYNCH &&
+		 !client_exists_locked(p->msg_in.hdr.to));
+	spin_unlock_irqrestore(&client_list_lock, flags);
+
+	if (bad) {
 		printk(KERN_ERR "dalrpc_read_msg: bad msg\n");
 		flush_msg(p);
 		return 1;
 	}
-	p->msg_owner = (struct daldevice_handle *)p->msg_in.hdr.to;
 
-	if (p->msg_in.hdr.msgid != DALRPC_MSGID_ASYNCH)
-		memcpy(&p->msg_owner->msg.hdr, &p->msg_in.hdr,
+	if (p->msg_in.hdr.msgid == DALRPC_MSGID_ASYNCH) {
+		p->msg_asynch = dalrpc_asynch_get(p);
+		if (!p->msg_asynch) {
+			printk(KERN_ERR "dalrpc_read_msg: no memory for "
+			       "asynch event\n");
+			flush_msg(p);
+			return 1;
+		}
+		memcpy(&p->msg_asynch->msg.hdr, &p->msg_in.hdr,
 		       sizeof(p->msg_in.hdr));
+		return 0;
+	}
+
+	p->msg_owner = (struct daldevice_handle *)p->msg_in.hdr.to;
+	memcpy(&p->msg_owner->msg.hdr, &p->msg_in.hdr,
+	       sizeof(p->msg_in.hdr));
 
 	return 0;
 }
@@ -383,9 +457,9 @@ static int dalrpc_read_msg(struct dalrpc_port *p)
 	while (p->msg_bytes_read < sizeof(p->msg_in.hdr)) {
 		read_ptr = (uint8_t *)&p->msg_in.hdr + p->msg_bytes_read;
 
-		bytes_read = smd_read(p->ch, read_ptr,
-				      sizeof(p->msg_in.hdr) -
-				      p->msg_bytes_read);
+		bytes_read = smd_read_from_cb(p->ch, read_ptr,
+					      sizeof(p->msg_in.hdr) -
+					      p->msg_bytes_read);
 		if (bytes_read <= 0)
 			return 0;
 		p->msg_bytes_read += bytes_read;
@@ -399,12 +473,13 @@ static int dalrpc_read_msg(struct dalrpc_port *p)
 	if (p->msg_in.hdr.msgid != DALRPC_MSGID_ASYNCH)
 		read_ptr = (uint8_t *)&p->msg_owner->msg;
 	else
-		read_ptr = (uint8_t *)&p->msg_in;
+		read_ptr = (uint8_t *)&p->msg_asynch->msg;
 	read_ptr += p->msg_bytes_read;
 
 	while (p->msg_bytes_read < p->msg_in.hdr.len) {
-		bytes_read = smd_read(p->ch, read_ptr,
-				      p->msg_in.hdr.len - p->msg_bytes_read);
+		bytes_read = smd_read_from_cb(p->ch, read_ptr,
+					      p->msg_in.hdr.len -
+					      p->msg_bytes_read);
 		if (bytes_read <= 0)
 			return 0;
 		p->msg_bytes_read += bytes_read;
@@ -414,6 +489,7 @@ static int dalrpc_read_msg(struct dalrpc_port *p)
 	process_msg(p);
 	p->msg_bytes_read = 0;
 	p->msg_owner = NULL;
+	p->msg_asynch = NULL;
 
 	return 1;
 }
@@ -423,16 +499,31 @@ static void dalrpc_work(struct work_struct *work)
 	struct dalrpc_port *p = container_of(work,
 					     struct dalrpc_port,
 					     port_work);
+	struct dalrpc_asynch_msg *a;
+	unsigned long flags;
+
+	/* port_close() flushes this work before the port goes away */
+	for (;;) {
+		spin_lock_irqsave(&p->asynch_lock, flags);
+		if (list_empty(&p->asynch_pending)) {
+			spin_unlock_irqrestore(&p->asynch_lock, flags);
+			break;
+		}
+		a = list_first_entry(&p->asynch_pending,
+				     struct dalrpc_asynch_msg, list);
+		list_del(&a->list);
+		spin_unlock_irqrestore(&p->asynch_lock, flags);
 
-	/* must lock port/client lists to ensure port doesn't disappear
-	   under an asynch event */
-	mutex_lock(&pc_lists_lock);
-	if (port_exists(p))
-		while (dalrpc_read_msg(p))
-		;
-	mutex_unlock(&pc_lists_lock);
+		process_asynch(p, &a->msg);
+		dalrpc_asynch_put(p, a);
+	}
 }
 
+/*
+ * Messages are read here, in the SMD callback, so that a reply wakes
+ * its caller without a round trip through the port workqueue. Only
+ * asynch events are handed on to port_work.
+ */
 static void dalrpc_smd_cb(void *priv, unsigned smd_flags)
 {
 	struct dalrpc_port *p = priv;
@@ -440,13 +531,15 @@ static void dalrpc_smd_cb(void *priv, unsigned smd_flags)
 	if (smd_flags != SMD_EVENT_DATA)
 		return;
 
-	queue_work(p->wq, &p->port_work);
+	while (dalrpc_read_msg(p))
+		;
 }
 
 static struct dalrpc_port *dalrpc_port_open(char *port, int cpu)
 {
 	struct dalrpc_port *p;
 	char wq_name[32];
+	int i;
 
 	p = port_name_exists(port);
 	if (p) {
@@ -476,7 +569,16 @@ static struct dalrpc_port *dalrpc_port_open(char *port, int cpu)
 	INIT_LIST_HEAD(&p->event_list);
 	INIT_LIST_HEAD(&p->cb_list);
 
+	spin_lock_init(&p->asynch_lock);
+	INIT_LIST_HEAD(&p->asynch_free);
+	INIT_LIST_HEAD(&p->asynch_pending);
+	for (i = 0; i < DALRPC_ASYNCH_POOL; i++) {
+		p->asynch_pool[i].pooled = 1;
+		list_add(&p->asynch_pool[i].list, &p->asynch_free);
+	}
+
 	p->msg_owner = NULL;
+	p->msg_asynch = NULL;
 	p->msg_bytes_read = 0;
 
 #if 1 //HK test
@@ -550,7 +652,9 @@ int daldevice_attach(uint32_t device_id, char *port, int cpu,
 	mutex_init(&h->client_lock);
 
 	mutex_lock(&pc_lists_lock);
+	spin_lock_irq(&client_list_lock);
 	list_add(&h->list, &client_list);
+	spin_unlock_irq(&client_list_lock);
 	mutex_unlock(&pc_lists_lock);
 
 	/* 3 attempts, enough for one each on the user specified port, the
@@ -562,7 +666,9 @@ int daldevice_attach(uint32_t device_id, char *port, int cpu,
 		mutex_lock(&pc_lists_lock);
 		h->port = dalrpc_port_open(port, cpu);
 		if (!h->port) {
+			spin_lock_irq(&client_list_lock);
 			list_del(&h->list);
+			spin_unlock_irq(&client_list_lock);
 			mutex_unlock(&pc_lists_lock);
 			printk(KERN_ERR "daldevice_attach: could not "
 			       "open port\n");
@@ -651,7 +757,9 @@ int daldevice_detach(void *handle)
 
 norpc:
 	mutex_lock(&pc_lists_lock);
+	spin_lock_irq(&client_list_lock);
 	list_del(&h->list);
+	spin_unlock_irq(&client_list_lock);
 	mutex_unlock(&pc_lists_lock);
 
 	port_close(h->port);
@@ -689,7 +797,7 @@ again:
 	if (ret && retry_count++ < MAX_RETRY_COUNT) {
 		printk(KERN_INFO "*********** %s: %d retry %d times, ret %d\n",
 		       __func__, ddi_idx, retry_count, ret);
-		mdelay(RETRY_DELAY);
+		msleep(RETRY_DELAY);
 		goto again;
 	}
 	
@@ -724,7 +832,7 @@ again:
 	if (ret && retry_count++ < MAX_RETRY_COUNT) {
 		printk(KERN_INFO "*********** %s: %d retry %d times, ret %d\n",
 		       __func__, ddi_idx, retry_count, ret);
-		mdelay(RETRY_DELAY);
+		msleep(RETRY_DELAY);
 		goto again;
 	}
 
@@ -847,7 +955,7 @@ again:
 	if (ret && retry_count++ < MAX_RETRY_COUNT) {
 		printk(KERN_INFO "*********** %s: %d retry %d times, ret %d\n",
 		       __func__, ddi_idx, retry_count, ret);
-		mdelay(RETRY_DELAY);
+		msleep(RETRY_DELAY);
 		goto again;
 	}
 
@@ -887,7 +995,7 @@ again:
 	if (ret && retry_count++ < MAX_RETRY_COUNT) {
 		printk(KERN_INFO "*********** %s: %d retry %d times, ret %d\n",
 		       __func__, ddi_idx, retry_count, ret);
-		mdelay(RETRY_DELAY);
+		msleep(RETRY_DELAY);
 		goto again;
 	}
 
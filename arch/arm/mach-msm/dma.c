@@ -15,6 +15,7 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/err.h>
 #include <linux/io.h>
 #include <linux/interrupt.h>
@@ -22,6 +23,8 @@
 #include <linux/platform_device.h>
 #include <linux/spinlock.h>
 #include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <mach/dma.h>
 
 #define MODULE_NAME "msm_dmov"
@@ -29,6 +32,13 @@
 #define MSM_DMOV_CHANNEL_COUNT 16
 #define MSM_DMOV_CRCI_COUNT 16
 
+/*
+ * Command pointers handed to a channel at once. Further commands wait in
+ * the ready queue, so a high priority command queued later goes ahead of
+ * them.
+ */
+#define MSM_DMOV_MAX_ACTIVE 4
+
 enum {
 	CLK_DIS,
 	CLK_TO_BE_DIS,
@@ -52,6 +62,17 @@ struct msm_dmov_chan_conf {
 	int priority;
 };
 
+struct msm_dmov_chan_stats {
+	unsigned int depth;		/* ready + active commands */
+	unsigned int max_depth;
+	unsigned int active;		/* command pointers in the hardware */
+	unsigned long submitted;
+	unsigned long completed;
+	unsigned long batched;		/* started while another was active */
+	ktime_t busy_start;
+	u64 busy_ns;
+};
+
 struct msm_dmov_conf {
 	void *base;
 	struct msm_dmov_crci_conf *crci_conf;
@@ -59,6 +80,7 @@ struct msm_dmov_conf {
 	int channel_active;
 	struct list_head ready_commands[MSM_DMOV_CHANNEL_COUNT];
 	struct list_head active_commands[MSM_DMOV_CHANNEL_COUNT];
+	struct msm_dmov_chan_stats stats[MSM_DMOV_CHANNEL_COUNT];
 	spinlock_t lock;
 	unsigned int irq;
 	struct clk *clk;
@@ -275,13 +297,109 @@ void msm_dmov_stop_cmd(unsigned id, struct msm_dmov_cmd *cmd, int graceful)
 }
 EXPORT_SYMBOL(msm_dmov_stop_cmd);
 
-void msm_dmov_enqueue_cmd_ext(unsigned id, struct msm_dmov_cmd *cmd)
+/* Must hold dmov_conf[adm].lock */
+static void msm_dmov_set_active(int adm, int ch)
+{
+	if (dmov_conf[adm].channel_active & (1U << ch))
+		return;
+	if (!dmov_conf[adm].channel_active)
+		enable_irq(dmov_conf[adm].irq);
+	dmov_conf[adm].channel_active |= 1U << ch;
+	dmov_conf[adm].stats[ch].busy_start = ktime_get();
+}
+
+/* Must hold dmov_conf[adm].lock */
+static void msm_dmov_clear_active(int adm, int ch)
+{
+	struct msm_dmov_chan_stats *stats = &dmov_conf[adm].stats[ch];
+
+	if (!(dmov_conf[adm].channel_active & (1U << ch)))
+		return;
+	dmov_conf[adm].channel_active &= ~(1U << ch);
+	stats->busy_ns += ktime_to_ns(ktime_sub(ktime_get(),
+						stats->busy_start));
+}
+
+/* Must hold dmov_conf[adm].lock */
+static void msm_dmov_queue_ready(int adm, int ch, struct msm_dmov_cmd *cmd)
+{
+	struct msm_dmov_chan_stats *stats = &dmov_conf[adm].stats[ch];
+	struct msm_dmov_cmd *pos;
+
+	if (++stats->depth > stats->max_depth)
+		stats->max_depth = stats->depth;
+
+	/* FIFO within a class */
+	list_for_each_entry(pos, &dmov_conf[adm].ready_commands[ch], list) {
+		if (pos->priority > cmd->priority) {
+			list_add_tail(&cmd->list, &pos->list);
+			return;
+		}
+	}
+	list_add_tail(&cmd->list, &dmov_conf[adm].ready_commands[ch]);
+}
+
+/*
+ * Hand ready commands to the channel for as long as it accepts command
+ * pointers, so back to back commands do not each wait for the previous
+ * one's interrupt before they start. Must hold dmov_conf[adm].lock.
+ */
+static void msm_dmov_start_ready(int adm, int ch)
+{
+	struct msm_dmov_chan_stats *stats = &dmov_conf[adm].stats[ch];
+	struct list_head *ready = &dmov_conf[adm].ready_commands[ch];
+	struct msm_dmov_cmd *cmd;
+	unsigned int status;
+
+	while (!list_empty(ready) && stats->active < MSM_DMOV_MAX_ACTIVE) {
+		status = readl_relaxed(DMOV_REG(DMOV_STATUS(ch), adm));
+		if (!(status & DMOV_STATUS_CMD_PTR_RDY))
+			break;
+
+		cmd = list_entry(ready->next, typeof(*cmd), list);
+		list_del(&cmd->list);
+		PRINT_IO("msm_dmov_enqueue_cmd(%d), start command, status %x\n",
+			DMOV_CHAN_ADM_TO_ID(ch, adm), status);
+		if (cmd->exec_func)
+			cmd->exec_func(cmd);
+		list_add_tail(&cmd->list, &dmov_conf[adm].active_commands[ch]);
+		msm_dmov_set_active(adm, ch);
+		if (stats->active++)
+			stats->batched++;
+		stats->submitted++;
+		PRINT_IO("Writing %x exactly to register", cmd->cmdptr);
+		writel_relaxed(cmd->cmdptr, DMOV_REG(DMOV_CMD_PTR(ch), adm));
+		/* let CMD_PTR_RDY reflect this write before it is read again */
+		mb();
+	}
+}
+
+/* Must hold dmov_conf[adm].lock */
+static void msm_dmov_complete_cmd(int adm, int ch, struct msm_dmov_cmd *cmd,
+				  unsigned int result,
+				  struct msm_dmov_errdata *err)
+{
+	struct msm_dmov_chan_stats *stats = &dmov_conf[adm].stats[ch];
+
+	list_del(&cmd->list);
+	if (stats->active)
+		stats->active--;
+	if (stats->depth)
+		stats->depth--;
+	stats->completed++;
+	cmd->complete_func(cmd, result, err);
+}
+
+void msm_dmov_enqueue_cmd_prio(unsigned id, struct msm_dmov_cmd *cmd,
+			       int priority)
 {
 	unsigned long irq_flags;
 	unsigned int status;
 	int adm = DMOV_ID_TO_ADM(id);
 	int ch = DMOV_ID_TO_CHAN(id);
 
+	cmd->priority = priority;
+
 	spin_lock_irqsave(&dmov_conf[adm].lock, irq_flags);
 	if (dmov_conf[adm].clk_ctl == CLK_DIS)
 		msm_dmov_clk_toggle(adm, 1);
@@ -289,32 +407,27 @@ void msm_dmov_enqueue_cmd_ext(unsigned id, struct msm_dmov_cmd *cmd)
 		del_timer(&dmov_conf[adm].timer);
 	dmov_conf[adm].clk_ctl = CLK_EN;
 
-	status = readl_relaxed(DMOV_REG(DMOV_STATUS(ch), adm));
-	if (status & DMOV_STATUS_CMD_PTR_RDY) {
-		PRINT_IO("msm_dmov_enqueue_cmd(%d), start command, status %x\n",
-			id, status);
-		if (cmd->exec_func)
-			cmd->exec_func(cmd);
-		list_add_tail(&cmd->list, &dmov_conf[adm].active_commands[ch]);
-		if (!dmov_conf[adm].channel_active)
-			enable_irq(dmov_conf[adm].irq);
-		dmov_conf[adm].channel_active |= 1U << ch;
-		PRINT_IO("Writing %x exactly to register", cmd->cmdptr);
-		writel_relaxed(cmd->cmdptr, DMOV_REG(DMOV_CMD_PTR(ch), adm));
-	} else {
+	msm_dmov_queue_ready(adm, ch, cmd);
+	msm_dmov_start_ready(adm, ch);
+
+	if (list_empty(&dmov_conf[adm].active_commands[ch])) {
+		status = readl_relaxed(DMOV_REG(DMOV_STATUS(ch), adm));
 		if (!dmov_conf[adm].channel_active) {
 			dmov_conf[adm].clk_ctl = CLK_TO_BE_DIS;
-			mod_timer(&dmov_conf[adm].timer, jiffies + HZ);
+			mod_timer(&dmov_conf[adm].timer,
+				  round_jiffies_up(jiffies + HZ));
 		}
-		if (list_empty(&dmov_conf[adm].active_commands[ch]))
-			PRINT_ERROR("msm_dmov_enqueue_cmd_ext(%d), stalled, "
-				"status %x\n", id, status);
-		PRINT_IO("msm_dmov_enqueue_cmd(%d), enqueue command, status "
-		    "%x\n", id, status);
-		list_add_tail(&cmd->list, &dmov_conf[adm].ready_commands[ch]);
+		PRINT_ERROR("msm_dmov_enqueue_cmd_ext(%d), stalled, "
+			"status %x\n", id, status);
 	}
 	spin_unlock_irqrestore(&dmov_conf[adm].lock, irq_flags);
 }
+EXPORT_SYMBOL(msm_dmov_enqueue_cmd_prio);
+
+void msm_dmov_enqueue_cmd_ext(unsigned id, struct msm_dmov_cmd *cmd)
+{
+	msm_dmov_enqueue_cmd_prio(id, cmd, MSM_DMOV_PRIO_NORMAL);
+}
 EXPORT_SYMBOL(msm_dmov_enqueue_cmd_ext);
 
 void msm_dmov_enqueue_cmd(unsigned id, struct msm_dmov_cmd *cmd)
@@ -322,7 +435,7 @@ void msm_dmov_enqueue_cmd(unsigned id, struct msm_dmov_cmd *cmd)
 	/* Disable callback function (for backwards compatibility) */
 	cmd->exec_func = NULL;
 
-	msm_dmov_enqueue_cmd_ext(id, cmd);
+	msm_dmov_enqueue_cmd_prio(id, cmd, MSM_DMOV_PRIO_NORMAL);
 }
 EXPORT_SYMBOL(msm_dmov_enqueue_cmd);
 
@@ -449,10 +562,9 @@ static irqreturn_t msm_datamover_irq_handler(int irq, void *dev_id)
 					id, ch_status);
 				PRINT_IO("msm_datamover_irq_handler id %d, got result "
 					"for %p, result %x\n", id, cmd, ch_result);
-				if (cmd) {
-					list_del(&cmd->list);
-					cmd->complete_func(cmd, ch_result, NULL);
-				}
+				if (cmd)
+					msm_dmov_complete_cmd(adm, ch, cmd,
+							ch_result, NULL);
 			}
 			if (ch_result & DMOV_RSLT_FLUSH) {
 				struct msm_dmov_errdata errdata;
@@ -460,10 +572,9 @@ static irqreturn_t msm_datamover_irq_handler(int irq, void *dev_id)
 				fill_errdata(&errdata, ch, adm);
 				PRINT_FLOW("msm_datamover_irq_handler id %d, status %x\n", id, ch_status);
 				PRINT_FLOW("msm_datamover_irq_handler id %d, flush, result %x, flush0 %x\n", id, ch_result, errdata.flush[0]);
-				if (cmd) {
-					list_del(&cmd->list);
-					cmd->complete_func(cmd, ch_result, &errdata);
-				}
+				if (cmd)
+					msm_dmov_complete_cmd(adm, ch, cmd,
+							ch_result, &errdata);
 			}
 			if (ch_result & DMOV_RSLT_ERROR) {
 				struct msm_dmov_errdata errdata;
@@ -472,10 +583,9 @@ static irqreturn_t msm_datamover_irq_handler(int irq, void *dev_id)
 
 				PRINT_ERROR("msm_datamover_irq_handler id %d, status %x\n", id, ch_status);
 				PRINT_ERROR("msm_datamover_irq_handler id %d, error, result %x, flush0 %x\n", id, ch_result, errdata.flush[0]);
-				if (cmd) {
-					list_del(&cmd->list);
-					cmd->complete_func(cmd, ch_result, &errdata);
-				}
+				if (cmd)
+					msm_dmov_complete_cmd(adm, ch, cmd,
+							ch_result, &errdata);
 				/* this does not seem to work, once we get an error */
 				/* the datamover will no longer accept commands */
 				writel_relaxed(0, DMOV_REG(DMOV_FLUSH0(ch),
@@ -485,37 +595,89 @@ static irqreturn_t msm_datamover_irq_handler(int irq, void *dev_id)
 			ch_status = readl_relaxed(DMOV_REG(DMOV_STATUS(ch),
 						  adm));
 			PRINT_FLOW("msm_datamover_irq_handler id %d, status %x\n", id, ch_status);
-			if ((ch_status & DMOV_STATUS_CMD_PTR_RDY) &&
-			    !list_empty(&dmov_conf[adm].ready_commands[ch])) {
-				cmd = list_entry(dmov_conf[adm].
-					ready_commands[ch].next, typeof(*cmd),
-					list);
-				list_del(&cmd->list);
-				if (cmd->exec_func)
-					cmd->exec_func(cmd);
-				list_add_tail(&cmd->list,
-					&dmov_conf[adm].active_commands[ch]);
-				PRINT_FLOW("msm_datamover_irq_handler id %d, start command\n", id);
-				writel_relaxed(cmd->cmdptr,
-					       DMOV_REG(DMOV_CMD_PTR(ch), adm));
+			if (ch_status & DMOV_STATUS_CMD_PTR_RDY) {
+				msm_dmov_start_ready(adm, ch);
+				ch_status = readl_relaxed(
+					DMOV_REG(DMOV_STATUS(ch), adm));
 			}
 		} while (ch_status & DMOV_STATUS_RSLT_VALID);
 		if (list_empty(&dmov_conf[adm].active_commands[ch]) &&
 				list_empty(&dmov_conf[adm].ready_commands[ch]))
-			dmov_conf[adm].channel_active &= ~(1U << ch);
+			msm_dmov_clear_active(adm, ch);
 		PRINT_FLOW("msm_datamover_irq_handler id %d, status %x\n", id, ch_status);
 	}
 
 	if (!dmov_conf[adm].channel_active && valid) {
 		disable_irq_nosync(dmov_conf[adm].irq);
 		dmov_conf[adm].clk_ctl = CLK_TO_BE_DIS;
-		mod_timer(&dmov_conf[adm].timer, jiffies + HZ);
+		/* the clocks may go off late, share the wakeup with others */
+		mod_timer(&dmov_conf[adm].timer, round_jiffies_up(jiffies + HZ));
 	}
 
 	spin_unlock_irqrestore(&dmov_conf[adm].lock, irq_flags);
 	return valid ? IRQ_HANDLED : IRQ_NONE;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int msm_dmov_stats_show(struct seq_file *m, void *unused)
+{
+	int adm = (int)m->private;
+	struct msm_dmov_chan_stats stats;
+	unsigned long irq_flags;
+	int active;
+	int ch;
+
+	seq_printf(m, "ch depth max_depth submitted completed batched "
+		   "busy_ms\n");
+	for (ch = 0; ch < MSM_DMOV_CHANNEL_COUNT; ch++) {
+		spin_lock_irqsave(&dmov_conf[adm].lock, irq_flags);
+		stats = dmov_conf[adm].stats[ch];
+		active = dmov_conf[adm].channel_active & (1U << ch);
+		spin_unlock_irqrestore(&dmov_conf[adm].lock, irq_flags);
+
+		if (!stats.submitted)
+			continue;
+		if (active)
+			stats.busy_ns += ktime_to_ns(ktime_sub(ktime_get(),
+							stats.busy_start));
+		seq_printf(m, "%2d %5u %9u %9lu %9lu %7lu %7llu\n", ch,
+			   stats.depth, stats.max_depth, stats.submitted,
+			   stats.completed, stats.batched,
+			   div_u64(stats.busy_ns, NSEC_PER_MSEC));
+	}
+	return 0;
+}
+
+static int msm_dmov_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_dmov_stats_show, inode->i_private);
+}
+
+static const struct file_operations msm_dmov_stats_fops = {
+	.open		= msm_dmov_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void msm_dmov_debugfs_init(int adm)
+{
+	static struct dentry *dent;
+	char name[8];
+
+	if (!dent)
+		dent = debugfs_create_dir("msm_dmov", NULL);
+	if (IS_ERR_OR_NULL(dent))
+		return;
+
+	snprintf(name, sizeof(name), "adm%d", adm);
+	debugfs_create_file(name, S_IRUGO, dent, (void *)adm,
+			    &msm_dmov_stats_fops);
+}
+#else
+static inline void msm_dmov_debugfs_init(int adm) { }
+#endif
+
 static int msm_dmov_suspend_late(struct device *dev)
 {
 	unsigned long irq_flags;
@@ -660,6 +822,7 @@ static int msm_dmov_probe(struct platform_device *pdev)
 	}
 	wmb();
 	msm_dmov_clk_toggle(adm, 0);
+	msm_dmov_debugfs_init(adm);
 	return ret;
 }
 
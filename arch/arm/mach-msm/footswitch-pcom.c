@@ -91,7 +91,11 @@ static inline int set_rail_state(int pcom_id, int state)
 
 static int enable_clocks(struct footswitch *fs)
 {
-	if (fs->set_clk_name) {
+	/*
+	 * Only ask the modem for the rate until it is known to be set; the
+	 * query is a proc_comm round trip of its own on every rail change.
+	 */
+	if (fs->set_clk_name && !fs->is_core_rate_set) {
 		fs->is_core_rate_set = !!(clk_get_rate(fs->core_clk));
 		if (!fs->is_core_rate_set) {
 			int rc = clk_set_rate(fs->core_clk,
@@ -102,6 +106,7 @@ static int enable_clocks(struct footswitch *fs)
 					fs->core_clk_init_rate);
 				return rc;
 			}
+			fs->is_core_rate_set = true;
 		}
 	}
 	clk_enable(fs->core_clk);
@@ -273,18 +273,36 @@ static void msm_gpio_update_both_edge_detect(struct msm_gpio_chip *msm_chip)
 	printk(KERN_ERR "msm_gpio_update_both_edge_detect, failed to reach stable state %x != %x\n", val, val2);
 }
 
+/*
+ * The out register is still read back before it is written: other
+ * processors may drive pins of the same bank behind our back.
+ */
+static void msm_gpio_write_mask(struct msm_gpio_chip *msm_chip, unsigned mask, unsigned val)
+{
+	unsigned v;
+
+	v = readl(msm_chip->regs.out);
+	v = (v & ~mask) | (val & mask);
+	writel(v, msm_chip->regs.out);
+	msm_chip->out_shadow = v;
+}
+
+/* Pins we drive are answered from the shadow, inputs from the in register */
+static unsigned msm_gpio_read_mask(struct msm_gpio_chip *msm_chip, unsigned mask)
+{
+	unsigned v = msm_chip->out_shadow & msm_chip->oe_shadow;
+
+	if (mask & ~msm_chip->oe_shadow)
+		v |= readl(msm_chip->regs.in) & ~msm_chip->oe_shadow;
+	return v & mask;
+}
+
 static int msm_gpio_write(struct gpio_chip *chip, unsigned n, unsigned on)
 {
 	struct msm_gpio_chip *msm_chip = container_of(chip, struct msm_gpio_chip, chip);
 	unsigned b = 1U << (n - chip->start);
-	unsigned v;
 
-	v = readl(msm_chip->regs.out);
-	if (on) {
-		writel(v | b, msm_chip->regs.out);
-	} else {
-		writel(v & (~b), msm_chip->regs.out);
-	}
+	msm_gpio_write_mask(msm_chip, b, on ? b : 0);
 	return 0;
 }
 
@@ -293,7 +311,7 @@ static int msm_gpio_read(struct gpio_chip *chip, unsigned n)
 	struct msm_gpio_chip *msm_chip = container_of(chip, struct msm_gpio_chip, chip);
 	unsigned b = 1U << (n - chip->start);
 
-	return (readl(msm_chip->regs.in) & b) ? 1 : 0;
+	return msm_gpio_read_mask(msm_chip, b) ? 1 : 0;
 }
 
 static int msm_gpio_read_detect_status(struct gpio_chip *chip, unsigned int gpio)
@@ -337,11 +355,12 @@ int msm_gpio_configure(struct gpio_chip *chip, unsigned int gpio, unsigned long
 
 	if (flags & (GPIOF_INPUT | GPIOF_DRIVE_OUTPUT)) {
 		v = readl(msm_chip->regs.oe);
-		if (flags & GPIOF_DRIVE_OUTPUT) {
-			writel(v | b, msm_chip->regs.oe);
-		} else {
-			writel(v & (~b), msm_chip->regs.oe);
-		}
+		if (flags & GPIOF_DRIVE_OUTPUT)
+			v |= b;
+		else
+			v &= ~b;
+		writel(v, msm_chip->regs.oe);
+		msm_chip->oe_shadow = v;
 	}
 
 	if (flags & (IRQF_TRIGGER_MASK | GPIOF_IRQF_TRIGGER_NONE)) {
@@ -609,6 +628,8 @@ static int __init msm_init_gpio(void)
 
 	for (i = 0; i < ARRAY_SIZE(msm_gpio_chips); i++) {
 		writel(0, msm_gpio_chips[i].regs.int_en);
+		msm_gpio_chips[i].out_shadow = readl(msm_gpio_chips[i].regs.out);
+		msm_gpio_chips[i].oe_shadow = readl(msm_gpio_chips[i].regs.oe);
 		register_gpio_chip(&msm_gpio_chips[i].chip);
 	}
 
@@ -630,6 +651,67 @@ int gpio_configure(unsigned int gpio, unsigned long flags)
 }
 EXPORT_SYMBOL(gpio_configure);
 
+static struct msm_gpio_chip *msm_gpio_find_bank(unsigned int gpio, unsigned long mask)
+{
+	unsigned int i;
+
+	if (!mask)
+		return NULL;
+	for (i = 0; i < ARRAY_SIZE(msm_gpio_chips); i++)
+		if (gpio >= msm_gpio_chips[i].chip.start &&
+		    gpio + fls(mask) - 1 <= msm_gpio_chips[i].chip.end)
+			return &msm_gpio_chips[i];
+	return NULL;
+}
+
+/**
+ * msm_gpio_set_multiple - set several outputs of one bank at once
+ * @gpio: the gpio that bit 0 of @mask and @values refers to
+ * @mask: which gpios to change
+ * @values: their new levels
+ *
+ * All gpios must be in the same bank; they change with a single write.
+ */
+int msm_gpio_set_multiple(unsigned int gpio, unsigned long mask, unsigned long values)
+{
+	struct msm_gpio_chip *msm_chip = msm_gpio_find_bank(gpio, mask);
+	unsigned int shift;
+	unsigned long irq_flags;
+
+	if (!msm_chip)
+		return -EINVAL;
+	shift = gpio - msm_chip->chip.start;
+
+	spin_lock_irqsave(&msm_chip->chip.lock, irq_flags);
+	msm_gpio_write_mask(msm_chip, mask << shift, values << shift);
+	spin_unlock_irqrestore(&msm_chip->chip.lock, irq_flags);
+	return 0;
+}
+EXPORT_SYMBOL(msm_gpio_set_multiple);
+
+/**
+ * msm_gpio_get_multiple - read several gpios of one bank at once
+ * @gpio: the gpio that bit 0 of @mask and *@values refers to
+ * @mask: which gpios to read
+ * @values: their levels, bits outside @mask are cleared
+ */
+int msm_gpio_get_multiple(unsigned int gpio, unsigned long mask, unsigned long *values)
+{
+	struct msm_gpio_chip *msm_chip = msm_gpio_find_bank(gpio, mask);
+	unsigned int shift;
+	unsigned long irq_flags;
+
+	if (!msm_chip)
+		return -EINVAL;
+	shift = gpio - msm_chip->chip.start;
+
+	spin_lock_irqsave(&msm_chip->chip.lock, irq_flags);
+	*values = msm_gpio_read_mask(msm_chip, mask << shift) >> shift;
+	spin_unlock_irqrestore(&msm_chip->chip.lock, irq_flags);
+	return 0;
+}
+EXPORT_SYMBOL(msm_gpio_get_multiple);
+
 void register_gpio_int_mask(unsigned int gpio, unsigned int idle)
 {
 	unsigned int i;
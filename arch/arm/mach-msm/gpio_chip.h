@@ -63,6 +63,8 @@ struct msm_gpio_chip {
 	unsigned                int_status_copy;
 #endif
 	unsigned int            both_edge_detect;
+	unsigned int            out_shadow; /* last value written to out */
+	unsigned int            oe_shadow; /* last value written to oe */
 	unsigned int            int_enable[2]; /* 0: awake, 1: sleep */
 	unsigned int            int_enable_mask[2]; /* 0: awake, 1: sleep */
 };
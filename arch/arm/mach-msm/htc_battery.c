@@ -1459,8 +1459,9 @@ static void htc_battery_tps65200_int_func(struct work_struct *work)
 			htc_batt_info.rep.over_vchg = 1;
 #endif
 			power_supply_changed(&htc_power_supplies[CHARGER_BATTERY]);
+			/* slow poll until the fault clears, on a whole second */
 			schedule_delayed_work(&ip->int_work,
-					    msecs_to_jiffies(5000));
+				round_jiffies_up_relative(msecs_to_jiffies(5000)));
 			BATT_LOG("OVER_VOLTAGE: "
 				"over voltage fault bit on TPS65200 is raised:"
 				" %d", fault_bit);
@@ -51,10 +51,8 @@ static struct msm_rpc_server hs_rpc_server = {
 	.rpc_call	= hs_mgr_rpc_call,
 };
 
-struct button_work {
-	struct delayed_work key_work;
-	int key_code;
-};
+/* Key code meaning the remote ADC is to be read once the line settles */
+#define HS_KEY_READ_ADC		-2
 
 static struct htc_headset_mgr_info *hi;
 static struct hs_notifier_func hs_mgr_notifier;
@@ -379,17 +377,38 @@ static void mic_detect_work_func(struct work_struct *work)
 static void button_35mm_work_func(struct work_struct *work)
 {
 	int key;
-	struct button_work *works;
+	int adc = 0;
+	int key_code;
 
 	wake_lock_timeout(&hi->hs_wake_lock, HS_WAKE_LOCK_TIMEOUT);
 
 	HS_DBG();
 
-	works = container_of(work, struct button_work, key_work.work);
-	hi->key_level_flag = works->key_code;
+	key_code = atomic_read(&hi->key_code);
+	if (key_code == HS_KEY_READ_ADC) {
+		hs_mgr_notifier.remote_adc(&adc);
+		key_code = hs_mgr_notifier.remote_keycode(adc);
+	}
+
+	if (hi->ext_35mm_status == HTC_35MM_UNKNOWN_MIC ||
+	    hi->ext_35mm_status == HTC_35MM_NO_MIC ||
+	    hi->h2w_35mm_status == HTC_35MM_NO_MIC) {
+		/* One MIC read for this key edge, no polling after it */
+		HS_LOG("MIC re-detection");
+		cancel_delayed_work_sync(&mic_detect_work);
+		hi->mic_detect_counter = 0;
+		queue_delayed_work(detect_wq, &mic_detect_work, HS_JIFFIES_ZERO);
+		return;
+	}
+
+	if (!hs_hpin_stable()) {
+		HS_LOG("The HPIN is unstable, SKIP THE BUTTON EVENT.");
+		return;
+	}
+
+	hi->key_level_flag = key_code;
 
 	if (!hi->is_ext_insert && !hi->h2w_35mm_status) {
-		kfree(works);
 		HS_LOG("3.5mm headset is plugged out, skip report key event");
 		return;
 	}
@@ -419,8 +438,6 @@ static void button_35mm_work_func(struct work_struct *work)
 		else
 			HS_LOG("3.5mm RC: WRONG Button Release");
 	}
-
-	kfree(works);
 }
 
 static void debug_work_func(struct work_struct *work)
@@ -474,7 +491,9 @@ static void remove_detect_work_func(struct work_struct *work)
 
 	if (time_before_eq(jiffies, hi->insert_jiffies + HZ)) {
 		HS_LOG("Waiting for HPIN stable");
-		msleep(HS_DELAY_SEC - HS_DELAY_REMOVE);
+		queue_delayed_work(detect_wq, &remove_detect_work,
+			msecs_to_jiffies(HS_DELAY_SEC - HS_DELAY_REMOVE));
+		return;
 	}
 
 	if (hi->is_ext_insert) {
@@ -618,51 +637,35 @@ int hs_notify_plug_event(int insert)
 	return 1;
 }
 
-int hs_notify_key_event(int key_code)
+static enum hrtimer_restart key_debounce_timer_func(struct hrtimer *timer)
 {
-	struct button_work *work;
+	queue_delayed_work(button_wq, &button_35mm_work, HS_JIFFIES_ZERO);
+	return HRTIMER_NORESTART;
+}
 
+/*
+ * Each key edge restarts the debounce timer, and only the code seen last
+ * is handled once the line has been quiet for HS_DELAY_KEY_DEBOUNCE.
+ */
+int hs_notify_key_event(int key_code)
+{
 	HS_DBG();
 
-	if (hi->ext_35mm_status == HTC_35MM_UNKNOWN_MIC ||
-	    hi->ext_35mm_status == HTC_35MM_NO_MIC ||
-	    hi->h2w_35mm_status == HTC_35MM_NO_MIC) {
-		HS_LOG("MIC re-detection");
-		cancel_delayed_work_sync(&mic_detect_work);
-		hi->mic_detect_counter = HS_DEF_MIC_DETECT_COUNT;
-		queue_delayed_work(detect_wq, &mic_detect_work,
-				   HS_JIFFIES_MIC_DETECT);
-	} else if (!hs_hpin_stable()) {
-		HS_LOG("The HPIN is unstable, SKIP THE BUTTON EVENT.");
-		return 1;
-	} else {
-		work = kzalloc(sizeof(struct button_work), GFP_KERNEL);
-		if (!work) {
-			HS_ERR("Failed to allocate button memory");
-			return 1;
-		}
-		work->key_code = key_code;
-		INIT_DELAYED_WORK(&work->key_work, button_35mm_work_func);
-		queue_delayed_work(button_wq, &work->key_work,
-				   HS_JIFFIES_BUTTON);
-	}
+	atomic_set(&hi->key_code, key_code);
+	hrtimer_start(&hi->key_timer,
+		      ktime_set(0, HS_DELAY_KEY_DEBOUNCE * NSEC_PER_MSEC),
+		      HRTIMER_MODE_REL);
 
 	return 1;
 }
 
+/* The ADC is read once, after the debounce, rather than on every edge */
 int hs_notify_key_irq(void)
 {
-	int adc = 0;
-	int key_code = HS_MGR_KEY_INVALID;
-
 	if (!hs_mgr_notifier.remote_adc || !hs_mgr_notifier.remote_keycode)
 		return 1;
 
-	hs_mgr_notifier.remote_adc(&adc);
-	key_code = hs_mgr_notifier.remote_keycode(adc);
-	hs_notify_key_event(key_code);
-
-	return 1;
+	return hs_notify_key_event(HS_KEY_READ_ADC);
 }
 
 static void usb_headset_detect(int type)
@@ -1095,6 +1098,9 @@ static int htc_headset_mgr_probe(struct platform_device *pdev)
 	hi->key_level_flag = -1;
 
 	atomic_set(&hi->btn_state, 0);
+	atomic_set(&hi->key_code, HS_MGR_KEY_INVALID);
+	hrtimer_init(&hi->key_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	hi->key_timer.function = key_debounce_timer_func;
 
 	hi->tty_enable_flag = 0;
 	hi->fm_flag = 0;
@@ -1203,6 +1209,7 @@ static int htc_headset_mgr_remove(struct platform_device *pdev)
 
 	unregister_attributes();
 	input_unregister_device(hi->input);
+	hrtimer_cancel(&hi->key_timer);
 	destroy_workqueue(button_wq);
 	destroy_workqueue(detect_wq);
 	switch_dev_unregister(&hi->sdev);
@@ -22,6 +22,9 @@
 #include <linux/device.h>
 #include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
 #include <mach/msm_smd.h>
 #include <mach/htc_pwrsink.h>
 
@@ -44,6 +47,44 @@ static DEFINE_SPINLOCK(audio_sink_lock);
 static unsigned long total_sink;
 static uint32_t *smem_total_sink;
 
+/*
+ * Charge drawn by each sink, integrated from its estimated current each
+ * time its utilization changes. The wall clock is used because it keeps
+ * running across suspend, where the system load sink still draws.
+ */
+static u64 sink_charge[PWRSINK_LAST + 1];	/* uA * ms */
+static ktime_t sink_since[PWRSINK_LAST + 1];
+
+static const char * const sink_names[PWRSINK_LAST + 1] = {
+	[PWRSINK_SYSTEM_LOAD]	= "system_load",
+	[PWRSINK_AUDIO]		= "audio",
+	[PWRSINK_BACKLIGHT]	= "backlight",
+	[PWRSINK_LED_BUTTON]	= "led_button",
+	[PWRSINK_LED_KEYBOARD]	= "led_keyboard",
+	[PWRSINK_GP_CLK]	= "gp_clk",
+	[PWRSINK_BLUETOOTH]	= "bluetooth",
+	[PWRSINK_CAMERA]	= "camera",
+	[PWRSINK_SDCARD]	= "sdcard",
+	[PWRSINK_VIDEO]		= "video",
+	[PWRSINK_WIFI]		= "wifi",
+};
+
+static unsigned sink_current(struct pwr_sink *sink)
+{
+	return sink->ua_max * sink->percent_util / 100;
+}
+
+/* Must hold sink_lock */
+static void sink_account(pwrsink_id_type id, ktime_t now)
+{
+	s64 ms = ktime_to_ms(ktime_sub(now, sink_since[id]));
+
+	/* the wall clock may have been set back */
+	if (ms > 0)
+		sink_charge[id] += (u64)sink_current(sink_array[id]) * ms;
+	sink_since[id] = now;
+}
+
 int htc_pwrsink_set(pwrsink_id_type id, unsigned percent_utilized)
 {
 	unsigned long flags;
@@ -69,11 +110,10 @@ int htc_pwrsink_set(pwrsink_id_type id, unsigned percent_utilized)
 		return 0;
 	}
 
-	total_sink -= (sink_array[id]->ua_max *
-		       sink_array[id]->percent_util / 100);
+	sink_account(id, ktime_get_real());
+	total_sink -= sink_current(sink_array[id]);
 	sink_array[id]->percent_util = percent_utilized;
-	total_sink += (sink_array[id]->ua_max *
-		       sink_array[id]->percent_util / 100);
+	total_sink += sink_current(sink_array[id]);
 
 	if (smem_total_sink)
 		*smem_total_sink = total_sink / 1000;
@@ -229,6 +269,76 @@ void htc_pwrsink_resume_late(struct early_suspend *h)
 	htc_pwrsink_set(PWRSINK_SYSTEM_LOAD, 38);
 }
 
+#if defined(CONFIG_DEBUG_FS)
+static int htc_pwrsink_charge_show(struct seq_file *m, void *unused)
+{
+	u64 charge[PWRSINK_LAST + 1];
+	unsigned ua[PWRSINK_LAST + 1];
+	unsigned long flags;
+	ktime_t now;
+	int i;
+
+	spin_lock_irqsave(&sink_lock, flags);
+	now = ktime_get_real();
+	for (i = 0; i <= PWRSINK_LAST; i++) {
+		if (!sink_array[i])
+			continue;
+		sink_account(i, now);
+		charge[i] = sink_charge[i];
+		ua[i] = sink_current(sink_array[i]);
+	}
+	spin_unlock_irqrestore(&sink_lock, flags);
+
+	seq_printf(m, "%-14s %10s %10s\n", "sink", "uA", "uAh");
+	for (i = 0; i <= PWRSINK_LAST; i++) {
+		if (!sink_array[i])
+			continue;
+		seq_printf(m, "%-14s %10u %10llu\n", sink_names[i], ua[i],
+			   div_u64(charge[i], 3600 * 1000));
+	}
+	return 0;
+}
+
+static int htc_pwrsink_charge_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, htc_pwrsink_charge_show, NULL);
+}
+
+/* Any write starts the integration over */
+static ssize_t htc_pwrsink_charge_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+	ktime_t now;
+	int i;
+
+	spin_lock_irqsave(&sink_lock, flags);
+	now = ktime_get_real();
+	for (i = 0; i <= PWRSINK_LAST; i++) {
+		sink_charge[i] = 0;
+		sink_since[i] = now;
+	}
+	spin_unlock_irqrestore(&sink_lock, flags);
+	return count;
+}
+
+static const struct file_operations htc_pwrsink_charge_fops = {
+	.open		= htc_pwrsink_charge_open,
+	.read		= seq_read,
+	.write		= htc_pwrsink_charge_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init htc_pwrsink_debug_init(void)
+{
+	debugfs_create_file("htc_pwrsink_charge", 0600, NULL, NULL,
+			    &htc_pwrsink_charge_fops);
+}
+#else
+static inline void htc_pwrsink_debug_init(void) { }
+#endif
+
 #ifdef CONFIG_WAKELOCK
 struct early_suspend htc_pwrsink_early_suspend = {
 	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB + 1,
@@ -240,6 +350,7 @@ struct early_suspend htc_pwrsink_early_suspend = {
 static int __init htc_pwrsink_probe(struct platform_device *pdev)
 {
 	struct pwr_sink_platform_data *pdata = pdev->dev.platform_data;
+	ktime_t now = ktime_get_real();
 	int i;
 
 	if (!pdata)
@@ -248,11 +359,12 @@ static int __init htc_pwrsink_probe(struct platform_device *pdev)
 	total_sink = 0;
 	for (i = 0; i < pdata->num_sinks; i++) {
 		sink_array[pdata->sinks[i].id] = &pdata->sinks[i];
-		total_sink += (pdata->sinks[i].ua_max *
-			       pdata->sinks[i].percent_util / 100);
+		sink_since[pdata->sinks[i].id] = now;
+		total_sink += sink_current(&pdata->sinks[i]);
 	}
 
 	initialized = 1;
+	htc_pwrsink_debug_init();
 
 #ifdef CONFIG_WAKELOCK
 	if (pdata->suspend_early)
@@ -21,9 +21,11 @@
 /* #define VERBOSE */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/irq.h>
 #include <linux/cdev.h>
@@ -34,6 +36,7 @@
 #include <linux/platform_device.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/time.h>
 #include <linux/uaccess.h>
@@ -59,6 +62,17 @@ struct mem_region {
 #define MINOR_MASTER 0
 #define MINOR_CLIENT 1
 
+struct hw3d_stats {
+	unsigned int		revokes;
+	s64			revoke_us_total;
+	s64			revoke_us_max;
+	unsigned int		cold_opens;	/* core had to be powered up */
+	unsigned int		warm_opens;	/* core was still powered */
+	unsigned int		power_offs;
+	s64			power_on_us_max;
+	s64			power_off_us_max;
+};
+
 struct hw3d_info {
 	dev_t devno;
 	struct cdev	master_cdev;
@@ -81,6 +95,11 @@ struct hw3d_info {
 	wait_queue_head_t	revoke_wq;
 	wait_queue_head_t	revoke_done_wq;
 	unsigned int		waiter_cnt;
+	ktime_t			revoke_start;
+
+	/* powers the core down once it has been without a client a while */
+	struct timer_list	idle_timer;
+	struct hw3d_stats	stats;
 
 	spinlock_t		lock;
 
@@ -234,13 +253,78 @@ static long hw3d_wait_for_revoke(struct hw3d_info *info, struct file *filp)
 	return 0;
 }
 
-static void locked_hw3d_client_done(struct hw3d_info *info, int had_timer)
+static s64 hw3d_us_since(ktime_t start)
 {
+	return ktime_to_us(ktime_sub(ktime_get(), start));
+}
+
+static void locked_hw3d_power_on(struct hw3d_info *info)
+{
+	ktime_t start;
+	s64 us;
+
 	if (info->enabled) {
-		pr_debug("hw3d: was enabled\n");
-		info->enabled = 0;
-		clk_disable(info->grp_clk);
-		clk_disable(info->imem_clk);
+		info->stats.warm_opens++;
+		return;
+	}
+
+	start = ktime_get();
+	clk_enable(info->imem_clk);
+	clk_enable(info->grp_clk);
+	info->enabled = 1;
+
+	us = hw3d_us_since(start);
+	info->stats.cold_opens++;
+	info->stats.power_on_us_max = max(info->stats.power_on_us_max, us);
+}
+
+static void locked_hw3d_power_off(struct hw3d_info *info)
+{
+	ktime_t start;
+	s64 us;
+
+	if (!info->enabled)
+		return;
+
+	pr_debug("hw3d: powering down\n");
+	start = ktime_get();
+	info->enabled = 0;
+	clk_disable(info->grp_clk);
+	clk_disable(info->imem_clk);
+
+	us = hw3d_us_since(start);
+	info->stats.power_offs++;
+	info->stats.power_off_us_max = max(info->stats.power_off_us_max, us);
+}
+
+#define IDLE_TIMEOUT		(HZ / 2)
+static void hw3d_idle_timeout(unsigned long data)
+{
+	struct hw3d_info *info = (struct hw3d_info *)data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&info->lock, flags);
+	if (!info->client_file)
+		locked_hw3d_power_off(info);
+	spin_unlock_irqrestore(&info->lock, flags);
+}
+
+static void locked_hw3d_client_done(struct hw3d_info *info, int had_timer)
+{
+	s64 us;
+
+	/* keep the core up for a quick handoff, unless suspending */
+	if (info->suspending)
+		locked_hw3d_power_off(info);
+	else if (info->enabled)
+		mod_timer(&info->idle_timer, jiffies + IDLE_TIMEOUT);
+
+	if (info->revoking) {
+		us = hw3d_us_since(info->revoke_start);
+		info->stats.revokes++;
+		info->stats.revoke_us_total += us;
+		info->stats.revoke_us_max = max(info->stats.revoke_us_max, us);
+		pr_debug("hw3d: revoke took %lld us\n", us);
 	}
 	info->revoking = 0;
 
@@ -280,6 +364,8 @@ static void locked_hw3d_revoke(struct hw3d_info *info)
 	 * user doesn't release the gpu, the timer will turn off the gpu,
 	 * and force kill the process. */
 	wake_lock(&info->wake_lock);
+	if (!info->revoking)
+		info->revoke_start = ktime_get();
 	info->revoking = 1;
 	wake_up(&info->revoke_wq);
 	mod_timer(&info->revoke_timer, jiffies + REVOKE_TIMEOUT);
@@ -485,9 +571,8 @@ static int hw3d_open(struct inode *inode, struct file *file)
 	/* XXX: we enable these clocks if the client connects..
 	 * probably not right? Should only turn the clocks on when the user
 	 * tries to map the registers? */
-	clk_enable(info->imem_clk);
-	clk_enable(info->grp_clk);
-	info->enabled = 1;
+	del_timer(&info->idle_timer);
+	locked_hw3d_power_on(info);
 
 	spin_unlock_irqrestore(&info->lock, flags);
 	return 0;
@@ -691,6 +776,9 @@ static void hw3d_early_suspend(struct early_suspend *h)
 	if (info->client_file) {
 		pr_info("hw3d: Requesting revoke for suspend\n");
 		locked_hw3d_revoke(info);
+	} else {
+		del_timer(&info->idle_timer);
+		locked_hw3d_power_off(info);
 	}
 	spin_unlock_irqrestore(&info->lock, flags);
 }
@@ -709,6 +797,21 @@ static void hw3d_late_resume(struct early_suspend *h)
 	spin_unlock_irqrestore(&info->lock, flags);
 }
 
+static int hw3d_suspend(struct platform_device *pdev, pm_message_t state)
+{
+	struct hw3d_info *info = platform_get_drvdata(pdev);
+	unsigned long flags;
+
+	/* don't let a pending idle timeout hold the clocks across suspend */
+	spin_lock_irqsave(&info->lock, flags);
+	if (!info->client_file) {
+		del_timer(&info->idle_timer);
+		locked_hw3d_power_off(info);
+	}
+	spin_unlock_irqrestore(&info->lock, flags);
+	return 0;
+}
+
 static int hw3d_resume(struct platform_device *pdev)
 {
 	struct hw3d_info *info = platform_get_drvdata(pdev);
@@ -722,6 +825,38 @@ static int hw3d_resume(struct platform_device *pdev)
 	return 0;
 }
 
+static int hw3d_stats_show(struct seq_file *m, void *unused)
+{
+	struct hw3d_info *info = m->private;
+	struct hw3d_stats stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&info->lock, flags);
+	stats = info->stats;
+	spin_unlock_irqrestore(&info->lock, flags);
+
+	seq_printf(m, "revokes %u total %lld us max %lld us\n",
+		   stats.revokes, stats.revoke_us_total, stats.revoke_us_max);
+	seq_printf(m, "opens cold %u warm %u\n",
+		   stats.cold_opens, stats.warm_opens);
+	seq_printf(m, "power offs %u\n", stats.power_offs);
+	seq_printf(m, "power on max %lld us off max %lld us\n",
+		   stats.power_on_us_max, stats.power_off_us_max);
+	return 0;
+}
+
+static int hw3d_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, hw3d_stats_show, inode->i_private);
+}
+
+static const struct file_operations hw3d_stats_fops = {
+	.open		= hw3d_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init hw3d_probe(struct platform_device *pdev)
 {
 	struct hw3d_info *info;
@@ -763,6 +898,7 @@ static int __init hw3d_probe(struct platform_device *pdev)
 	setup_timer(&info->revoke_timer,
 		    (void (*)(unsigned long))do_force_revoke,
 		    (unsigned long)info);
+	setup_timer(&info->idle_timer, hw3d_idle_timeout, (unsigned long)info);
 
 	platform_set_drvdata(pdev, info);
 
@@ -838,6 +974,8 @@ static int __init hw3d_probe(struct platform_device *pdev)
 	}
 	hw3d_disable_interrupt(info);
 
+	debugfs_create_file("hw3d", S_IRUGO, NULL, info, &hw3d_stats_fops);
+
 	hw3d_info = info;
 
 	return 0;
@@ -874,6 +1012,7 @@ err_alloc:
 
 static struct platform_driver msm_hw3d_driver = {
 	.probe		= hw3d_probe,
+	.suspend	= hw3d_suspend,
 	.resume		= hw3d_resume,
 	.driver		= {
 		.name = "msm_hw3d",
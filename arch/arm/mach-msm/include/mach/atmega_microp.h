@@ -253,6 +253,21 @@ struct microp_ops {
 	void (*led_gpio_set)(struct microp_led_data *);
 };
 
+#define MICROP_I2C_BATCH_MAX	4
+
+enum {
+	MICROP_PRIO_NORMAL,
+	MICROP_PRIO_BACKGROUND,
+};
+
+struct microp_i2c_op {
+	uint8_t addr;
+	uint8_t read;
+	uint8_t *data;
+	int length;
+};
+
+int microp_i2c_batch(struct microp_i2c_op *ops, int n, int prio);
 int microp_i2c_read(uint8_t addr, uint8_t *data, int length);
 int microp_i2c_write(uint8_t addr, uint8_t *data, int length);
 int microp_function_check(struct i2c_client *client, uint8_t category);
@@ -264,6 +279,7 @@ int microp_spi_vote_enable(int spi_device, uint8_t enable);
 void microp_register_ops(struct microp_ops *ops);
 
 int microp_read_adc(uint8_t *data);
+int microp_read_adc_background(uint8_t *data);
 void microp_mobeam_enable(int enable);
 
 #endif /* _LINUX_ATMEGA_MICROP_H */
@@ -28,6 +28,13 @@ struct msm_dmov_errdata {
 	uint32_t flush[6];
 };
 
+/* Queued commands of a channel are started in order of priority class */
+enum {
+	MSM_DMOV_PRIO_HIGH,	/* latency sensitive, e.g. UART */
+	MSM_DMOV_PRIO_NORMAL,
+	MSM_DMOV_PRIO_LOW,	/* bulk transfers */
+};
+
 struct msm_dmov_cmd {
 	struct list_head list;
 	unsigned int cmdptr;
@@ -36,10 +43,13 @@ struct msm_dmov_cmd {
 			      struct msm_dmov_errdata *err);
 	void (*exec_func)(struct msm_dmov_cmd *cmd);
 	void *user;	/* Pointer for caller's reference */
+	int priority;	/* set by the enqueue functions */
 };
 
 void msm_dmov_enqueue_cmd(unsigned id, struct msm_dmov_cmd *cmd);
 void msm_dmov_enqueue_cmd_ext(unsigned id, struct msm_dmov_cmd *cmd);
+void msm_dmov_enqueue_cmd_prio(unsigned id, struct msm_dmov_cmd *cmd,
+			       int priority);
 void msm_dmov_stop_cmd(unsigned id, struct msm_dmov_cmd *cmd, int graceful);
 void msm_dmov_flush(unsigned int id);
 int msm_dmov_exec_cmd(unsigned id, unsigned int cmdptr);
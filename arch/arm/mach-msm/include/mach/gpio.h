@@ -32,6 +32,16 @@ extern void register_gpio_int_mask(unsigned int gpio, unsigned int idle);
 extern void unregister_gpio_int_mask(unsigned int gpio, unsigned int idle);
 extern int gpio_configure(unsigned int gpio, unsigned long flags);
 
+/*
+ * Change or sample several gpios of one bank with one register access.
+ * Bit n of mask and values stands for gpio + n. Returns -EINVAL if the
+ * gpios span more than one bank.
+ */
+extern int msm_gpio_set_multiple(unsigned int gpio, unsigned long mask,
+				 unsigned long values);
+extern int msm_gpio_get_multiple(unsigned int gpio, unsigned long mask,
+				 unsigned long *values);
+
 static inline int gpio_get_value(unsigned gpio)
 {
 	return __gpio_get_value(gpio);
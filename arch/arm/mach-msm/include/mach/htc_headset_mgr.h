@@ -22,6 +22,7 @@
 
 #include <mach/msm_rpcrouter.h>
 
+#include <linux/hrtimer.h>
 #include <linux/input.h>
 #include <linux/switch.h>
 #include <linux/wakelock.h>
@@ -95,14 +96,13 @@
 #define HS_DELAY_MIC_DETECT		1000
 #define HS_DELAY_INSERT			500
 #define HS_DELAY_REMOVE			200
-#define HS_DELAY_BUTTON			500
+#define HS_DELAY_KEY_DEBOUNCE		30
 
 #define HS_JIFFIES_ZERO			msecs_to_jiffies(HS_DELAY_ZERO)
 #define HS_JIFFIES_MIC_BIAS		msecs_to_jiffies(HS_DELAY_MIC_BIAS)
 #define HS_JIFFIES_MIC_DETECT		msecs_to_jiffies(HS_DELAY_MIC_DETECT)
 #define HS_JIFFIES_INSERT		msecs_to_jiffies(HS_DELAY_INSERT)
 #define HS_JIFFIES_REMOVE		msecs_to_jiffies(HS_DELAY_REMOVE)
-#define HS_JIFFIES_BUTTON		msecs_to_jiffies(HS_DELAY_BUTTON)
 
 #define HS_WAKE_LOCK_TIMEOUT		(2 * HZ)
 #define HS_RPC_TIMEOUT			(5 * HZ)
@@ -246,6 +246,10 @@ struct htc_headset_mgr_info {
 
 	atomic_t btn_state;
 
+	/* Last key code, reported once the key line is quiet */
+	struct hrtimer key_timer;
+	atomic_t key_code;
+
 	int tty_enable_flag;
 	int fm_flag;
 	int debug_flag;
@@ -48,6 +48,17 @@ int msm_adsp_write(struct msm_adsp_module *module,
 		   unsigned queue_id,
 		   void *data, size_t len);
 
+struct msm_adsp_cmd {
+	unsigned queue_id;
+	void *data;
+	size_t len;
+};
+
+/* Returns the number of commands written, or an error if none was.
+ */
+int msm_adsp_write_batch(struct msm_adsp_module *module,
+			 struct msm_adsp_cmd *cmds, unsigned count);
+
 #if 1
 /* Command Queue Indexes */
 #define QDSP_lpmCommandQueue              0
@@ -20,6 +20,9 @@
 #define AUDIO_FLAG_READ		0
 #define AUDIO_FLAG_WRITE	1
 
+/* Most buffers a pcm session can cycle through */
+#define Q6_MAX_BUFFERS		8
+
 struct audio_buffer {
 	dma_addr_t phys;
 	void *data;
@@ -28,7 +31,9 @@ struct audio_buffer {
 };
 
 struct audio_client {
-	struct audio_buffer buf[2];
+	struct audio_buffer buf[Q6_MAX_BUFFERS];
+	int buf_count;
+	size_t buf_total; /* bytes allocated for all buffers, from buf[0] */
 	int cpu_buf;	/* next buffer the CPU will touch */
 	int dsp_buf;	/* next buffer the DSP will touch */
 	int running;
@@ -55,12 +60,26 @@ struct q6_hw_info {
 	int max_gain;
 };
 
+static inline int q6audio_next_buf(struct audio_client *ac, int n)
+{
+	return n + 1 < ac->buf_count ? n + 1 : 0;
+}
+
 /* Obtain a 16bit signed, interleaved audio channel of the specified
- * rate (Hz) and channels (1 or 2), with two buffers of bufsz bytes.
+ * rate (Hz) and channels (1 or 2), with bufcnt buffers of bufsz bytes.
+ * The buffers are carved from one coherent allocation, so the whole
+ * ring can be mapped to userspace at once.
  */
-struct audio_client *q6audio_open_pcm(uint32_t bufsz, uint32_t rate,
-				      uint32_t channels, uint32_t flags,
-				      uint32_t acdb_id);
+struct audio_client *q6audio_open_pcm_ring(uint32_t bufsz, uint32_t bufcnt,
+					   uint32_t rate, uint32_t channels,
+					   uint32_t flags, uint32_t acdb_id);
+
+static inline struct audio_client *q6audio_open_pcm(uint32_t bufsz,
+		uint32_t rate, uint32_t channels, uint32_t flags,
+		uint32_t acdb_id)
+{
+	return q6audio_open_pcm_ring(bufsz, 2, rate, channels, flags, acdb_id);
+}
 
 struct audio_client *q6voice_open(uint32_t flags, uint32_t acdb_id);
 
@@ -163,6 +163,34 @@ int msm_rpc_call(struct msm_rpc_endpoint *ept, uint32_t proc,
 		 void *request, int request_size,
 		 long timeout);
 
+/* asynchronous rpc calls
+ *
+ * msm_rpc_call_async() fills out the request header the same way as
+ * msm_rpc_call_reply() and returns as soon as the request is written,
+ * so several calls can be outstanding on one endpoint.  Replies are
+ * matched by xid.  On completion status holds the reply length or a
+ * negative error and reply the reply itself, which the caller must
+ * kfree.  If complete is set it is called from the router's read
+ * worker, otherwise the call is handed back by msm_rpc_wait_any().
+ */
+struct msm_rpc_async_call {
+	struct list_head list;
+	struct msm_rpc_endpoint *ept;
+	uint32_t xid; /* be32 */
+	int pending;
+	int status;
+	void *reply;
+	void (*complete)(struct msm_rpc_async_call *call);
+	void *data;
+};
+
+int msm_rpc_call_async(struct msm_rpc_endpoint *ept, uint32_t proc,
+		       void *request, int request_size,
+		       struct msm_rpc_async_call *call);
+struct msm_rpc_async_call *msm_rpc_wait_any(struct msm_rpc_endpoint *ept,
+					    long timeout);
+int msm_rpc_cancel_async(struct msm_rpc_async_call *call);
+
 struct msm_rpc_xdr {
 	void *in_buf;
 	uint32_t in_size;
@@ -193,6 +221,31 @@ int xdr_recv_int32(struct msm_rpc_xdr *xdr, int32_t *value);
 int xdr_recv_uint32(struct msm_rpc_xdr *xdr, uint32_t *value);
 int xdr_recv_bytes(struct msm_rpc_xdr *xdr, void **data, uint32_t *size);
 
+/*
+ * A message layout lists the byte offsets of a struct's 32-bit fields in
+ * wire order, so that xdr_send_struct()/xdr_recv_struct() marshal all of
+ * them with one bounds check. Define one per message with
+ * DEFINE_XDR_LAYOUT(name, XDR_FIELD(type, member), ...).
+ */
+struct msm_rpc_xdr_layout {
+	uint32_t nr_fields;
+	const uint16_t *offsets;
+};
+
+#define XDR_FIELD(type, member)	offsetof(type, member)
+
+#define DEFINE_XDR_LAYOUT(name, ...)					\
+	static const uint16_t name##_offsets[] = { __VA_ARGS__ };	\
+	static const struct msm_rpc_xdr_layout name = {			\
+		.nr_fields = ARRAY_SIZE(name##_offsets),		\
+		.offsets = name##_offsets,				\
+	}
+
+int xdr_send_struct(struct msm_rpc_xdr *xdr,
+		    const struct msm_rpc_xdr_layout *layout, const void *obj);
+int xdr_recv_struct(struct msm_rpc_xdr *xdr,
+		    const struct msm_rpc_xdr_layout *layout, void *obj);
+
 struct msm_rpc_server
 {
 	struct list_head list;
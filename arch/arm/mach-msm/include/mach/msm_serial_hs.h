@@ -39,6 +39,9 @@ struct msm_serial_hs_platform_data {
 
 	unsigned char cpu_lock_supported;
 
+	/* PM QoS CPU/DMA latency held while the clock is on, 0 for none */
+	s32 cpu_dma_latency;
+
 	/* for bcm */
 	unsigned char bt_wakeup_pin_supported;
 	unsigned char bt_wakeup_pin;	/* Device to Chip */
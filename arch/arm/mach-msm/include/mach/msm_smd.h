@@ -58,6 +58,11 @@ int smd_write_user_buffer(smd_channel_t *ch, const void *data, int len);
 int smd_write_avail(smd_channel_t *ch);
 int smd_read_avail(smd_channel_t *ch);
 
+/* Returns the bytes written to the channel that the other side has not
+** read yet, packet headers included.
+*/
+int smd_write_queued(smd_channel_t *ch);
+
 /* Returns the total size of the current packet being read.
 ** Returns 0 if no packets available or a stream channel.
 */
@@ -164,4 +169,34 @@ int smd_write_segment(smd_channel_t *ch, void *data, int len, int user_buf);
  */
 int smd_write_end(smd_channel_t *ch);
 
+/* Zero-copy access to the fifo. The reserve calls return a pointer to, and
+ * the length of, the next contiguous span of readable data or free space;
+ * a span that wraps around the end of the fifo takes two reserve/commit
+ * rounds. The commit calls consume (read) or publish (write) 'len' bytes of
+ * that span and notify the other processor.
+ *
+ * Reads from packet channels are limited to the current packet. Writes to
+ * packet channels must be inside a smd_write_start()/smd_write_end()
+ * transaction and are limited to what is left of the packet.
+ *
+ * Returns:
+ *      reserve: length of the span (0 if nothing available), commit: len
+ *      -ENODEV - invalid smd channel
+ *      -EINVAL - commit length larger than the reserved span
+ *      -ENOEXEC - packet write outside a transaction
+ */
+/* Batches the interrupts raised to the remote processor for fifo updates
+ * on a busy channel. The first update after an idle period interrupts
+ * right away; later ones are held until 'bytes' have accumulated or 'usecs'
+ * have passed, and the channel drops back to per-update interrupts once a
+ * period passes without traffic. Passing 0 for 'bytes' disables batching.
+ */
+int smd_set_coalesce(smd_channel_t *ch, unsigned bytes, unsigned usecs);
+
+int smd_read_reserve(smd_channel_t *ch, void **ptr);
+int smd_read_commit(smd_channel_t *ch, int len);
+int smd_read_commit_from_cb(smd_channel_t *ch, int len);
+int smd_write_reserve(smd_channel_t *ch, void **ptr);
+int smd_write_commit(smd_channel_t *ch, int len);
+
 #endif
@@ -20,6 +20,7 @@
 #define __ARCH_ARM_MACH_PERF_LOCK_H
 
 #include <linux/list.h>
+#include <linux/pm_qos.h>
 
 /*
  * Performance level determine differnt EBI1 rate
@@ -34,6 +35,7 @@ enum {
 
 struct perf_lock {
 	struct list_head link;
+	struct pm_qos_request qos;
 	unsigned int flags;
 	unsigned int level;
 	const char *name;
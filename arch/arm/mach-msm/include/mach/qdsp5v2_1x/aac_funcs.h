@@ -0,0 +1,20 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef AAC_FUNCS_H
+#define AAC_FUNCS_H
+
+/* Function Prototypes */
+long aac_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
+void audpp_cmd_cfg_aac_params(struct audio *audio);
+void aac_init(struct audio *audio);
+
+#endif /* !AAC_FUNCS_H */
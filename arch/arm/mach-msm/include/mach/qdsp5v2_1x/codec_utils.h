@@ -129,6 +129,7 @@ struct audio {
 	int eq_needs_commit;
 	struct audpp_cmd_cfg_object_params_eqalizer eq;
 	struct audpp_cmd_cfg_object_params_volume vol_pan;
+	struct audpp_cmd_cfg_adec_params_aac aac_params; /* AAC decoder only */
 
 	unsigned int minor_no;
 	struct codec_operations codec_ops;
@@ -253,14 +253,14 @@ static inline void _remote_spin_release_all(uint32_t pid) {}
 #if defined(CONFIG_MSM_REMOTE_SPINLOCK_DEKKERS)
 /* Use Dekker's algorithm when LDREX/STREX and SWP are unavailable for
  * shared memory */
-#define _remote_spin_lock(lock)		__raw_remote_dek_spin_lock(*lock)
+#define __remote_spin_lock(lock)	__raw_remote_dek_spin_lock(*lock)
 #define _remote_spin_unlock(lock)	__raw_remote_dek_spin_unlock(*lock)
 #define _remote_spin_trylock(lock)	__raw_remote_dek_spin_trylock(*lock)
 #define _remote_spin_release(lock, pid)	__raw_remote_dek_spin_release(*lock,\
 		pid)
 #elif defined(CONFIG_MSM_REMOTE_SPINLOCK_SWP)
 /* Use SWP-based locks when LDREX/STREX are unavailable for shared memory. */
-#define _remote_spin_lock(lock)		__raw_remote_swp_spin_lock(*lock)
+#define __remote_spin_lock(lock)	__raw_remote_swp_spin_lock(*lock)
 #define _remote_spin_unlock(lock)	__raw_remote_swp_spin_unlock(*lock)
 #define _remote_spin_trylock(lock)	__raw_remote_swp_spin_trylock(*lock)
 #define _remote_spin_release(lock, pid)	__raw_remote_gen_spin_release(*lock,\
@@ -274,13 +274,36 @@ static inline void _remote_spin_release_all(uint32_t pid) {}
 		pid)
 #else
 /* Use LDREX/STREX for shared memory locking, when available */
-#define _remote_spin_lock(lock)		__raw_remote_ex_spin_lock(*lock)
+#define __remote_spin_lock(lock)	__raw_remote_ex_spin_lock(*lock)
 #define _remote_spin_unlock(lock)	__raw_remote_ex_spin_unlock(*lock)
 #define _remote_spin_trylock(lock)	__raw_remote_ex_spin_trylock(*lock)
 #define _remote_spin_release(lock, pid)	__raw_remote_gen_spin_release(*lock, \
 		pid)
 #endif
 
+#if defined(CONFIG_MSM_SMD) && !defined(CONFIG_MSM_REMOTE_SPINLOCK_SFPB)
+/* Only a failed first attempt leaves the inline path: the lock is then
+ * polled with exponential backoff, so that a remote processor holding it
+ * for a while does not have the apps core hammering shared memory.
+ */
+void _remote_spin_lock_contended(_remote_spinlock_t *lock);
+#ifdef CONFIG_MSM_REMOTE_SPINLOCK_STATS
+void _remote_spin_lock_acquired(_remote_spinlock_t *lock);
+#else
+static inline void _remote_spin_lock_acquired(_remote_spinlock_t *lock) {}
+#endif
+
+#define _remote_spin_lock(lock)						\
+	do {								\
+		if (likely(_remote_spin_trylock(lock)))			\
+			_remote_spin_lock_acquired(lock);		\
+		else							\
+			_remote_spin_lock_contended(lock);		\
+	} while (0)
+#elif !defined(CONFIG_MSM_REMOTE_SPINLOCK_SFPB)
+#define _remote_spin_lock(lock)		__remote_spin_lock(lock)
+#endif
+
 /* Remote mutex definitions. */
 
 typedef struct {
@@ -45,7 +45,7 @@ static spinlock_t vibe_lock;
 static int vibe_state;
 static int pmic_vibrator_level;
 
-static void set_pmic_vibrator(int on)
+static void set_pmic_vibrator_level(int level)
 {
 	static struct msm_rpc_endpoint *vib_endpoint;
 	struct set_vib_on_off_req {
@@ -67,20 +67,22 @@ static void set_pmic_vibrator(int on)
 		}
 	}
 
-	if (on)
-		req.data = cpu_to_be32(pmic_vibrator_level);
-	else
-		req.data = cpu_to_be32(0);
+	req.data = cpu_to_be32(level);
 
 	rc = msm_rpc_call(vib_endpoint, HTC_PROCEDURE_SET_VIB_ON_OFF, &req,
 		sizeof(req), 5 * HZ);
 
 	if (rc < 0)
 		VIB_ERR_LOG("msm_rpc_call failed!\n");
-	else if (on)
+	else if (level)
 		pr_info("[ATS][set_vibration][successful]\n");
 }
 
+static void set_pmic_vibrator(int on)
+{
+	set_pmic_vibrator_level(on ? pmic_vibrator_level : 0);
+}
+
 static void update_vibrator(struct work_struct *work)
 {
 	set_pmic_vibrator(vibe_state);
@@ -119,6 +121,12 @@ static int get_vibrator_level(struct timed_output_dev *dev)
 	return pmic_vibrator_level;
 }
 
+/* called by the timed_output pattern engine, once per edge */
+static void vibrator_output(struct timed_output_dev *dev, int level)
+{
+	set_pmic_vibrator_level(level);
+}
+
 static int vibrator_get_time(struct timed_output_dev *dev)
 {
 	if (hrtimer_active(&vibe_timer)) {
@@ -142,6 +150,7 @@ static struct timed_output_dev pmic_vibrator = {
 	.enable = vibrator_enable,
 	.set_level = set_vibrator_level,
 	.get_level = get_vibrator_level,
+	.output = vibrator_output,
 };
 
 void __init msm_init_pmic_vibrator(int level)
@@ -67,6 +67,8 @@
 #include <linux/workqueue.h>
 #include <linux/spinlock_types.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "npa.h"
 #include "npa_resource.h"
@@ -676,6 +678,17 @@ static void request_state(struct npa_resource *resource,
 		resource->definition->name, client->name, state);
 
 	RESOURCE_LOCK(resource);
+	resource->request_count++;
+
+	/* A repeated required request cannot change the aggregate */
+	if (client->type == NPA_CLIENT_REQUIRED &&
+			state == ACTIVE_STATE(client) &&
+			!(resource->definition->attributes &
+				NPA_RESOURCE_REPORT_ALL_REQS)) {
+		RESOURCE_UNLOCK(resource);
+		return;
+	}
+
 	PENDING_STATE(client) = state;
 	new_state = resource->active_plugin->update_fn(resource, client);
 	ACTIVE_STATE(client) = PENDING_STATE(client);
@@ -687,6 +700,7 @@ static void request_state(struct npa_resource *resource,
 	if ((resource->definition->attributes &
 				NPA_RESOURCE_REPORT_ALL_REQS) ||
 				new_state != resource->active_state) {
+		resource->update_count++;
 		resource->active_state =
 			resource->node->driver_fn(resource, client,
 					new_state);
@@ -1443,6 +1457,11 @@ static unsigned int min_update(struct npa_resource *resource,
 	return val;
 }
 
+/* The max and sum plugins keep the combined request of the required
+ * clients in resource->aggregate and only apply the change made by the
+ * requesting client. The max has to be looked up again only when the
+ * client holding it lowers its request.
+ */
 static unsigned int max_update(struct npa_resource *resource,
 					struct npa_client *client)
 {
@@ -1454,28 +1473,27 @@ static unsigned int max_update(struct npa_resource *resource,
 	if (!(client->type & NPA_CLIENT_REQUIRED))
 		return resource->active_state;
 
-	if ((val != 0) &&
-		(resource->active_state == ACTIVE_STATE(client)) &&
-		(val >= ACTIVE_STATE(client))) {
+	if (val >= resource->aggregate ||
+		ACTIVE_STATE(client) < resource->aggregate) {
+
+		if (val > resource->aggregate)
+			resource->aggregate = val;
 
 		npa_log(NPA_LOG_MASK_PLUGIN, resource,
-			"NPA: Max plugin: Current request [%u] is max for "
+			"NPA: Max plugin: Request [%u] gives max [%u] for "
 			"resource [%s]\n",
-			val, resource->definition->name);
+			val, resource->aggregate, resource->definition->name);
 
-		return val;
+		return resource->aggregate;
 	}
 
 	list_for_each_entry(cl_itr, &resource->clients, list) {
 		if (!(cl_itr->type & NPA_CLIENT_REQUIRED))
 			continue;
-		if ((cl_itr != client) && ACTIVE_STATE(cl_itr)) {
-			if (!val)
-				val = ACTIVE_STATE(cl_itr);
-			if (ACTIVE_STATE(cl_itr) > val)
-				val = ACTIVE_STATE(cl_itr);
-		}
+		if ((cl_itr != client) && (ACTIVE_STATE(cl_itr) > val))
+			val = ACTIVE_STATE(cl_itr);
 	}
+	resource->aggregate = val;
 
 	npa_log(NPA_LOG_MASK_PLUGIN, resource,
 		"NPA: Max plugin: Calculated [%u] for resource [%s] "
@@ -1485,25 +1503,48 @@ static unsigned int max_update(struct npa_resource *resource,
 	return val;
 }
 
+static void max_destroy_client(struct npa_client *client)
+{
+	struct npa_resource *resource = client->resource;
+	struct npa_client *cl_itr = NULL;
+	unsigned int val = 0;
+
+	if (!(client->type & NPA_CLIENT_REQUIRED) ||
+		ACTIVE_STATE(client) < resource->aggregate)
+		return;
+
+	list_for_each_entry(cl_itr, &resource->clients, list) {
+		if (!(cl_itr->type & NPA_CLIENT_REQUIRED))
+			continue;
+		if ((cl_itr != client) && (ACTIVE_STATE(cl_itr) > val))
+			val = ACTIVE_STATE(cl_itr);
+	}
+	resource->aggregate = val;
+}
+
 static unsigned int sum_update(struct npa_resource *resource,
 					struct npa_client *client)
 {
-	unsigned int val = resource->active_state;
-
 	__print_client_states(resource);
 
 	if (!(client->type & NPA_CLIENT_REQUIRED))
 		return resource->active_state;
 
-	val -= ACTIVE_STATE(client);
-	val += PENDING_STATE(client);
+	resource->aggregate -= ACTIVE_STATE(client);
+	resource->aggregate += PENDING_STATE(client);
 
 	npa_log(NPA_LOG_MASK_PLUGIN, resource,
 		"NPA: Sum plugin: Calculated [%u] for resource [%s] "
 		"client [%s]\n",
-		val, resource->definition->name, client->name);
+		resource->aggregate, resource->definition->name, client->name);
 
-	return val;
+	return resource->aggregate;
+}
+
+static void sum_destroy_client(struct npa_client *client)
+{
+	if (client->type & NPA_CLIENT_REQUIRED)
+		client->resource->aggregate -= ACTIVE_STATE(client);
 }
 
 static unsigned int always_update(struct npa_resource *resource,
@@ -1544,7 +1585,7 @@ const struct npa_resource_plugin_ops npa_max_plugin = {
 	.update_fn 		= max_update,
 	.supported_clients 	= NPA_CLIENT_REQUIRED,
 	.create_client_fn 	= NULL,
-	.destroy_client_fn	= NULL,
+	.destroy_client_fn	= max_destroy_client,
 };
 EXPORT_SYMBOL(npa_max_plugin);
 
@@ -1552,7 +1593,7 @@ const struct npa_resource_plugin_ops npa_sum_plugin = {
 	.update_fn 		= sum_update,
 	.supported_clients 	= NPA_CLIENT_REQUIRED,
 	.create_client_fn 	= NULL,
-	.destroy_client_fn	= NULL,
+	.destroy_client_fn	= sum_destroy_client,
 };
 EXPORT_SYMBOL(npa_sum_plugin);
 
@@ -1564,6 +1605,53 @@ const struct npa_resource_plugin_ops npa_always_on_plugin = {
 };
 EXPORT_SYMBOL(npa_always_on_plugin);
 
+#ifdef CONFIG_DEBUG_FS
+static int npa_stats_show(struct seq_file *m, void *unused)
+{
+	struct npa_resource *resource = NULL;
+
+	seq_printf(m, "%-32s %10s %10s %10s\n",
+			"resource", "state", "requests", "updates");
+
+	read_lock(&list_lock);
+	list_for_each_entry(resource, &active_list, list)
+		seq_printf(m, "%-32s %10u %10u %10u\n",
+				resource->definition->name,
+				resource->active_state,
+				resource->request_count,
+				resource->update_count);
+	read_unlock(&list_lock);
+
+	return 0;
+}
+
+static int npa_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, npa_stats_show, NULL);
+}
+
+static const struct file_operations npa_stats_fops = {
+	.open		= npa_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init npa_debugfs_init(void)
+{
+	struct dentry *dent;
+
+	dent = debugfs_create_dir("npa", NULL);
+	if (IS_ERR_OR_NULL(dent))
+		return 0;
+
+	debugfs_create_file("stats", 0444, dent, NULL, &npa_stats_fops);
+
+	return 0;
+}
+late_initcall(npa_debugfs_init);
+#endif
+
 /* NPA Init function. */
 static int npa_init(void)
 {
@@ -211,6 +211,11 @@ struct npa_resource {
 	unsigned int			active_max; /* Clipping value after
 						     * update function */
 	int				active_headroom;
+	unsigned int			aggregate; /* Required requests combined
+						    * by the max and sum
+						    * plugins */
+	unsigned int			request_count; /* Client requests */
+	unsigned int			update_count; /* Driver calls */
 	const struct npa_resource_plugin_ops *active_plugin; /* Overridable */
 	struct mutex			*resource_lock; /* Node lock */
 	unsigned int			level; /* Resource depth for locks */
@@ -22,6 +22,7 @@
 #include <linux/earlysuspend.h>
 #include <linux/cpufreq.h>
 #include <linux/timer.h>
+#include <linux/pm_qos.h>
 #include <mach/perflock.h>
 #include "proc_comm.h"
 #include "acpuclock.h"
@@ -37,8 +38,13 @@ enum {
 	PERF_SCREEN_ON_POLICY_DEBUG = 1U << 4,
 };
 
+/*
+ * Active locks are requests on the PM_QOS_CPU_FREQ_MIN class, which keeps
+ * them in a priority list: the speed to lock at is read in O(1) and an
+ * update costs O(log n). The list below is only for is_perf_locked() and
+ * the debug output.
+ */
 static LIST_HEAD(active_perf_locks);
-static LIST_HEAD(inactive_perf_locks);
 static DEFINE_SPINLOCK(list_lock);
 static DEFINE_SPINLOCK(policy_update_lock);
 static int initialized;
@@ -98,7 +104,7 @@ static void perflock_late_resume(struct early_suspend *handler)
 	/* Work around for display driver,
 	 * need to increase cpu speed immediately.
 	 */
-	unsigned int lock_speed = get_perflock_speed() / 1000;
+	unsigned int lock_speed = get_perflock_speed();
 	if (lock_speed > CONFIG_PERFLOCK_SCREEN_ON_MIN)
 		acpuclk_set_rate(lock_speed * 1000, 0);
 	else
@@ -215,10 +221,12 @@ static int perflock_notifier_call(struct notifier_block *self,
 			screen_off_policy_req--;
 		}
 #endif
-		lock_speed = get_perflock_speed() / 1000;
+		lock_speed = get_perflock_speed();
 		if (lock_speed) {
-			policy->min = lock_speed;
-			policy->max = lock_speed;
+			/* Requests from /dev/cpu_freq_min are not checked */
+			policy->min = clamp(lock_speed, policy->cpuinfo.min_freq,
+					    policy->cpuinfo.max_freq);
+			policy->max = policy->min;
 			if (debug_mask & PERF_CPUFREQ_LOCK_DEBUG) {
 				pr_info("%s: cpufreq lock speed %d\n",
 					__func__, lock_speed);
@@ -242,24 +250,10 @@ static struct notifier_block perflock_notifier = {
 	.notifier_call = perflock_notifier_call,
 };
 
+/* Speed in kHz the active locks need, 0 if there are none */
 static unsigned int get_perflock_speed(void)
 {
-	unsigned long irqflags;
-	struct perf_lock *lock;
-	unsigned int perf_level = 0;
-
-	/* Get the maxmimum perf level. */
-	if (list_empty(&active_perf_locks))
-		return 0;
-
-	spin_lock_irqsave(&list_lock, irqflags);
-	list_for_each_entry(lock, &active_perf_locks, link) {
-		if (lock->level > perf_level)
-			perf_level = lock->level;
-	}
-	spin_unlock_irqrestore(&list_lock, irqflags);
-
-	return perf_acpu_table[perf_level];
+	return pm_qos_request(PM_QOS_CPU_FREQ_MIN);
 }
 
 static void print_active_locks(void)
@@ -285,8 +279,6 @@ static void print_active_locks(void)
 void perf_lock_init(struct perf_lock *lock,
 			unsigned int level, const char *name)
 {
-	unsigned long irqflags = 0;
-
 	WARN_ON(!name);
 	WARN_ON(level >= PERF_LOCK_INVALID);
 	WARN_ON(lock->flags & PERF_LOCK_INITIALIZED);
@@ -302,9 +294,7 @@ void perf_lock_init(struct perf_lock *lock,
 	lock->level = level;
 
 	INIT_LIST_HEAD(&lock->link);
-	spin_lock_irqsave(&list_lock, irqflags);
-	list_add(&lock->link, &inactive_perf_locks);
-	spin_unlock_irqrestore(&list_lock, irqflags);
+	memset(&lock->qos, 0, sizeof(lock->qos));
 }
 EXPORT_SYMBOL(perf_lock_init);
 
@@ -318,7 +308,8 @@ void perf_lock(struct perf_lock *lock)
 {
 	unsigned long irqflags;
 
-	WARN_ON(!initialized);
+	if (WARN_ON(!initialized))
+		return;
 	WARN_ON((lock->flags & PERF_LOCK_INITIALIZED) == 0);
 	WARN_ON(lock->flags & PERF_LOCK_ACTIVE);
 
@@ -327,18 +318,17 @@ void perf_lock(struct perf_lock *lock)
 		pr_info("%s: '%s', flags %d level %d\n",
 			__func__, lock->name, lock->flags, lock->level);
 	if (lock->flags & PERF_LOCK_ACTIVE) {
+		spin_unlock_irqrestore(&list_lock, irqflags);
 		pr_err("%s: over-locked\n", __func__);
 		return;
 	}
 	lock->flags |= PERF_LOCK_ACTIVE;
-	list_del(&lock->link);
 	list_add(&lock->link, &active_perf_locks);
 	spin_unlock_irqrestore(&list_lock, irqflags);
 
-	/* Update cpufreq policy - scaling_min/scaling_max */
-	if (cpufreq_policy &&
-			(curr_lock_speed != (get_perflock_speed() / 1000)))
-		cpufreq_update_policy(cpufreq_policy->cpu);
+	/* perflock_qos_notify() updates the policy if the speed went up */
+	pm_qos_add_request(&lock->qos, PM_QOS_CPU_FREQ_MIN,
+			   perf_acpu_table[lock->level] / 1000);
 }
 EXPORT_SYMBOL(perf_lock);
 
@@ -348,8 +338,7 @@ static void do_expire_perf_locks(struct work_struct *work)
 	if (debug_mask & PERF_EXPIRE_DEBUG)
 		pr_info("%s: timed out to unlock\n", __func__);
 
-	if (cpufreq_policy &&
-			(curr_lock_speed != (get_perflock_speed() / 1000))) {
+	if (cpufreq_policy && curr_lock_speed != get_perflock_speed()) {
 		if (debug_mask & PERF_EXPIRE_DEBUG)
 			pr_info("%s: update cpufreq policy\n", __func__);
 		cpufreq_update_policy(cpufreq_policy->cpu);
@@ -357,6 +346,29 @@ static void do_expire_perf_locks(struct work_struct *work)
 }
 static DECLARE_DELAYED_WORK(work_expire_perf_locks, do_expire_perf_locks);
 
+/* Called only when the aggregate of the PM_QOS_CPU_FREQ_MIN class changes */
+static int perflock_qos_notify(struct notifier_block *self,
+			       unsigned long speed, void *data)
+{
+	if (!cpufreq_policy)
+		return NOTIFY_OK;
+
+	/* Raise at once; prevent lock/unlock quickly, add a timeout to
+	 * release perf_lock */
+	if (speed > curr_lock_speed) {
+		cancel_delayed_work(&work_expire_perf_locks);
+		cpufreq_update_policy(cpufreq_policy->cpu);
+	} else
+		schedule_delayed_work(&work_expire_perf_locks,
+			PERF_UNLOCK_DELAY);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block perflock_qos_notifier = {
+	.notifier_call = perflock_qos_notify,
+};
+
 /**
  * perf_unlock - de-activate a perf lock
  * @lock: perf lock to de-activate
@@ -375,19 +387,15 @@ void perf_unlock(struct perf_lock *lock)
 		pr_info("%s: '%s', flags %d level %d\n",
 			__func__, lock->name, lock->flags, lock->level);
 	if (!(lock->flags & PERF_LOCK_ACTIVE)) {
+		spin_unlock_irqrestore(&list_lock, irqflags);
 		pr_err("%s: under-locked\n", __func__);
 		return;
 	}
 	lock->flags &= ~PERF_LOCK_ACTIVE;
-	list_del(&lock->link);
-	list_add(&lock->link, &inactive_perf_locks);
+	list_del_init(&lock->link);
 	spin_unlock_irqrestore(&list_lock, irqflags);
 
-	/* Prevent lock/unlock quickly, add a timeout to release perf_lock */
-	if (cpufreq_policy &&
-			(curr_lock_speed != (get_perflock_speed() / 1000)))
-		schedule_delayed_work(&work_expire_perf_locks,
-			PERF_UNLOCK_DELAY);
+	pm_qos_remove_request(&lock->qos);
 }
 EXPORT_SYMBOL(perf_unlock);
 
@@ -464,6 +472,7 @@ void __init perflock_init(struct perflock_platform_data *pdata)
 		goto invalid_config;
 
 	perf_acpu_table_fixup();
+	pm_qos_add_notifier(PM_QOS_CPU_FREQ_MIN, &perflock_qos_notifier);
 	cpufreq_register_notifier(&perflock_notifier, CPUFREQ_POLICY_NOTIFIER);
 
 	initialized = 1;
@@ -31,6 +31,7 @@
 #include <linux/memory.h>
 #ifdef CONFIG_HAS_WAKELOCK
 #include <linux/wakelock.h>
+#include <trace/events/power.h>
 #endif
 #include <mach/msm_iomap.h>
 #include <mach/system.h>
@@ -377,6 +378,36 @@ void __init msm_pm_set_platform_data(
 	msm_pm_modes = data;
 }
 
+/*
+ * arch_idle() skips every mode whose latency is not below the aggregate
+ * PM_QOS_CPU_DMA_LATENCY.  A request at this value therefore rules out
+ * the modes that need the modem to bring the apps processor back, as
+ * holding a WAKE_LOCK_IDLE does, while standalone power collapse and
+ * WFI stay available.
+ */
+s32 msm_pm_collapse_latency(void)
+{
+	static const int modes[] = {
+		MSM_PM_SLEEP_MODE_POWER_COLLAPSE,
+		MSM_PM_SLEEP_MODE_POWER_COLLAPSE_NO_XO_SHUTDOWN,
+		MSM_PM_SLEEP_MODE_APPS_SLEEP,
+	};
+	s32 latency = PM_QOS_CPU_DMA_LAT_DEFAULT_VALUE;
+	int i;
+
+	if (!msm_pm_modes)
+		return latency;
+
+	for (i = 0; i < ARRAY_SIZE(modes); i++) {
+		struct msm_pm_platform_data *mode = &msm_pm_modes[modes[i]];
+
+		if (mode->idle_supported && mode->latency < latency)
+			latency = mode->latency;
+	}
+	return latency;
+}
+EXPORT_SYMBOL(msm_pm_collapse_latency);
+
 
 /******************************************************************************
  * Sleep Limitations
@@ -652,6 +683,163 @@ void msm_pm_set_max_sleep_time(int64_t max_sleep_time_ns)
 EXPORT_SYMBOL(msm_pm_set_max_sleep_time);
 
 
+/******************************************************************************
+ * Idle Duration Prediction
+ *****************************************************************************/
+
+/*
+ * The next timer only bounds how long the CPU stays idle; interrupts
+ * often wake it much sooner, and a power collapse cut short costs more
+ * than it saves. Like the cpuidle menu governor, scale the timer distance
+ * by a correction factor learned for its order of magnitude, and when the
+ * last few idle periods were steady use their average if it is shorter.
+ * The modes' residency thresholds are checked against the prediction.
+ */
+static int msm_pm_idle_predict = 1;
+module_param_named(
+	idle_predict, msm_pm_idle_predict,
+	int, S_IRUGO | S_IWUSR | S_IWGRP
+);
+
+#define MSM_PM_PREDICT_BUCKETS		6
+#define MSM_PM_PREDICT_INTERVALS	8
+#define MSM_PM_PREDICT_RESOLUTION	1024
+#define MSM_PM_PREDICT_DECAY		8
+#define MSM_PM_PREDICT_MAX_US		USEC_PER_SEC
+
+static struct msm_pm_idle_predictor {
+	unsigned int correction[MSM_PM_PREDICT_BUCKETS];
+	uint32_t intervals[MSM_PM_PREDICT_INTERVALS];
+	unsigned int nr_intervals;
+	unsigned int interval_ptr;
+
+	unsigned int bucket;
+	uint32_t expected_us;	/* 0 when nothing was predicted */
+	uint32_t predicted_us;
+
+	unsigned int predictions;
+	unsigned int early;	/* woke before half the prediction */
+	unsigned int late;	/* stayed idle over twice the prediction */
+} msm_pm_predictor = {
+	.correction = {
+		[0 ... MSM_PM_PREDICT_BUCKETS - 1] =
+			MSM_PM_PREDICT_RESOLUTION * MSM_PM_PREDICT_DECAY,
+	},
+};
+
+static unsigned int msm_pm_predict_bucket(uint32_t us)
+{
+	unsigned int bucket = 0;
+	uint32_t limit = 10;
+
+	while (bucket < MSM_PM_PREDICT_BUCKETS - 1 && us >= limit) {
+		bucket++;
+		limit *= 10;
+	}
+
+	return bucket;
+}
+
+/*
+ * Average of the recent idle periods if their standard deviation is
+ * within a sixth of it, otherwise no limit.
+ */
+static uint32_t msm_pm_typical_interval(void)
+{
+	struct msm_pm_idle_predictor *p = &msm_pm_predictor;
+	uint64_t avg = 0;
+	uint64_t variance = 0;
+	int i;
+
+	if (p->nr_intervals < MSM_PM_PREDICT_INTERVALS)
+		return UINT_MAX;
+
+	for (i = 0; i < MSM_PM_PREDICT_INTERVALS; i++)
+		avg += p->intervals[i];
+	do_div(avg, MSM_PM_PREDICT_INTERVALS);
+
+	for (i = 0; i < MSM_PM_PREDICT_INTERVALS; i++) {
+		int64_t diff = (int64_t)p->intervals[i] - (int64_t)avg;
+		variance += diff * diff;
+	}
+	do_div(variance, MSM_PM_PREDICT_INTERVALS);
+
+	if (variance * 36 <= avg * avg)
+		return (uint32_t)avg;
+
+	return UINT_MAX;
+}
+
+/*
+ * Return how long in ns the coming idle period is expected to last,
+ * given that the next timer fires in timer_ns.
+ */
+static int64_t msm_pm_predict_idle(int64_t timer_ns)
+{
+	struct msm_pm_idle_predictor *p = &msm_pm_predictor;
+	uint64_t us = timer_ns;
+	uint64_t predicted;
+	uint32_t typical;
+
+	if (!msm_pm_idle_predict || timer_ns <= 0) {
+		p->expected_us = 0;
+		return timer_ns;
+	}
+
+	do_div(us, NSEC_PER_USEC);
+	p->expected_us = max_t(uint64_t,
+			min_t(uint64_t, us, MSM_PM_PREDICT_MAX_US), 1);
+	p->bucket = msm_pm_predict_bucket(p->expected_us);
+
+	predicted = (uint64_t)p->expected_us * p->correction[p->bucket];
+	do_div(predicted, MSM_PM_PREDICT_RESOLUTION * MSM_PM_PREDICT_DECAY);
+
+	typical = msm_pm_typical_interval();
+	if (typical < predicted)
+		predicted = typical;
+
+	p->predicted_us = predicted;
+	return min_t(int64_t, timer_ns, predicted * NSEC_PER_USEC);
+}
+
+/*
+ * Learn from how long the idle period predicted last actually lasted.
+ */
+static void msm_pm_predict_update(int64_t measured_ns)
+{
+	struct msm_pm_idle_predictor *p = &msm_pm_predictor;
+	uint64_t us = max_t(int64_t, measured_ns, 0);
+	uint32_t measured_us;
+	unsigned int factor;
+
+	if (!p->expected_us)
+		return;
+
+	do_div(us, NSEC_PER_USEC);
+	measured_us = min_t(uint64_t, us, MSM_PM_PREDICT_MAX_US);
+
+	/* Waking up late from the timer is not a misprediction */
+	factor = p->correction[p->bucket];
+	factor -= factor / MSM_PM_PREDICT_DECAY;
+	factor += MSM_PM_PREDICT_RESOLUTION *
+		min(measured_us, p->expected_us) / p->expected_us;
+	p->correction[p->bucket] = factor ? factor : 1;
+
+	p->intervals[p->interval_ptr] = measured_us;
+	p->interval_ptr = (p->interval_ptr + 1) % MSM_PM_PREDICT_INTERVALS;
+	if (p->nr_intervals < MSM_PM_PREDICT_INTERVALS)
+		p->nr_intervals++;
+
+	p->predictions++;
+	if (measured_us * 2ULL < p->predicted_us)
+		p->early++;
+	else if (measured_us > p->predicted_us * 2ULL)
+		p->late++;
+
+	p->expected_us = 0;
+}
+
+
 /******************************************************************************
  * CONFIG_MSM_IDLE_STATS
  *****************************************************************************/
@@ -809,6 +997,15 @@ static int msm_pm_read_proc
 		else
 			SNPRINTF(p, count, "against TCXO shutdown\n\n");
 
+		SNPRINTF(p, count,
+			"Idle prediction:\n"
+			"  count: %7u\n"
+			"  woke early: %7u\n"
+			"  stayed late: %7u\n\n",
+			msm_pm_predictor.predictions,
+			msm_pm_predictor.early,
+			msm_pm_predictor.late);
+
 		*start = (char *) 1;
 		*eof = 0;
 	} else if (--off < ARRAY_SIZE(msm_pm_stats)) {
@@ -893,6 +1090,9 @@ static int msm_pm_write_proc(struct file *file, const char __user *buffer,
 	}
 
 	msm_pm_sleep_limit = SLEEP_LIMIT_NONE;
+	msm_pm_predictor.predictions = 0;
+	msm_pm_predictor.early = 0;
+	msm_pm_predictor.late = 0;
 	local_irq_restore(flags);
 
 	return count;
@@ -992,6 +1192,7 @@ static int msm_pm_power_collapse
 	struct msm_pm_polled_group state_grps[2];
 	unsigned long saved_acpuclk_rate;
 	uint32_t saved_vector[2];
+	ktime_t calltime;
 	int collapsed = 0;
 	int ret;
 
@@ -1034,7 +1235,10 @@ static int msm_pm_power_collapse
 	state_grps[1].group_id = SMSM_MODEM_STATE;
 	state_grps[1].bits_all_set = SMSM_RESET;
 
+	calltime = pm_profile_start();
 	ret = msm_pm_poll_state(ARRAY_SIZE(state_grps), state_grps);
+	if (!from_idle)
+		pm_profile_record(NULL, "modem_pwrc", calltime);
 
 	if (ret < 0) {
 		printk(KERN_EMERG "%s(): power collapse entry "
@@ -1141,7 +1345,10 @@ static int msm_pm_power_collapse
 	state_grps[1].group_id = SMSM_MODEM_STATE;
 	state_grps[1].bits_all_set = SMSM_RESET;
 
+	calltime = pm_profile_start();
 	ret = msm_pm_poll_state(ARRAY_SIZE(state_grps), state_grps);
+	if (!from_idle)
+		pm_profile_record(NULL, "modem_rsa", calltime);
 
 	if (ret < 0) {
 		printk(KERN_EMERG "%s(): power collapse exit "
@@ -1181,7 +1388,10 @@ static int msm_pm_power_collapse
 	state_grps[1].group_id = SMSM_MODEM_STATE;
 	state_grps[1].bits_all_set = SMSM_RESET;
 
+	calltime = pm_profile_start();
 	ret = msm_pm_poll_state(ARRAY_SIZE(state_grps), state_grps);
+	if (!from_idle)
+		pm_profile_record(NULL, "modem_wfpi", calltime);
 
 	if (ret < 0) {
 		printk(KERN_EMERG "%s(): power collapse WFPI "
@@ -1403,6 +1613,8 @@ void arch_idle(void)
 
 	int latency_qos;
 	int64_t timer_expiration;
+	int64_t predicted_idle;
+	ktime_t idle_start;
 
 	int low_power;
 	int ret;
@@ -1419,6 +1631,7 @@ void arch_idle(void)
 
 	latency_qos = pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
 	timer_expiration = msm_timer_enter_idle();
+	predicted_idle = msm_pm_predict_idle(timer_expiration);
 
 #ifdef CONFIG_MSM_IDLE_STATS
 	t1 = ktime_to_ns(ktime_get());
@@ -1457,7 +1670,7 @@ void arch_idle(void)
 		goto arch_idle_exit;
 	}
 
-	if ((timer_expiration < msm_pm_idle_sleep_min_time) ||
+	if ((predicted_idle < msm_pm_idle_sleep_min_time) ||
 #ifdef CONFIG_HAS_WAKELOCK
 		has_wake_lock(WAKE_LOCK_IDLE) ||
 #endif
@@ -1471,7 +1684,7 @@ void arch_idle(void)
 		struct msm_pm_platform_data *mode = &msm_pm_modes[i];
 		if (!mode->idle_supported || !mode->idle_enabled ||
 			mode->latency >= latency_qos ||
-			mode->residency * 1000ULL >= timer_expiration)
+			mode->residency * 1000ULL >= predicted_idle)
 			allow[i] = false;
 	}
 
@@ -1496,14 +1709,17 @@ void arch_idle(void)
 	}
 
 	MSM_PM_DPRINTK(MSM_PM_DEBUG_IDLE, KERN_INFO,
-		"%s(): latency qos %d, next timer %lld, sleep limit %u\n",
-		__func__, latency_qos, timer_expiration, sleep_limit);
+		"%s(): latency qos %d, next timer %lld, predicted %lld, "
+		"sleep limit %u\n", __func__, latency_qos, timer_expiration,
+		predicted_idle, sleep_limit);
 
 	for (i = 0; i < ARRAY_SIZE(allow); i++)
 		MSM_PM_DPRINTK(MSM_PM_DEBUG_IDLE, KERN_INFO,
 			"%s(): allow %s: %d\n", __func__,
 			msm_pm_sleep_mode_labels[i], (int)allow[i]);
 
+	idle_start = ktime_get();
+
 	if (allow[MSM_PM_SLEEP_MODE_POWER_COLLAPSE] ||
 		allow[MSM_PM_SLEEP_MODE_POWER_COLLAPSE_NO_XO_SHUTDOWN]) {
 		uint32_t sleep_delay;
@@ -1522,6 +1738,8 @@ void arch_idle(void)
 		sleep_limit |= SLEEP_RESOURCE_MEMORY_BIT0;
 #endif
 
+		trace_power_start(POWER_CSTATE,
+				  MSM_PM_SLEEP_MODE_POWER_COLLAPSE);
 		ret = msm_pm_power_collapse(true, sleep_delay, sleep_limit);
 		low_power = (ret != -EBUSY && ret != -ETIMEDOUT);
 
@@ -1541,6 +1759,7 @@ void arch_idle(void)
 		if (sleep_delay == 0) /* 0 would mean infinite time */
 			sleep_delay = 1;
 
+		trace_power_start(POWER_CSTATE, MSM_PM_SLEEP_MODE_APPS_SLEEP);
 		ret = msm_pm_apps_sleep(sleep_delay, sleep_limit);
 		low_power = 0;
 
@@ -1551,6 +1770,8 @@ void arch_idle(void)
 			exit_stat = MSM_PM_STAT_IDLE_SLEEP;
 #endif /* CONFIG_MSM_IDLE_STATS */
 	} else if (allow[MSM_PM_SLEEP_MODE_POWER_COLLAPSE_STANDALONE]) {
+		trace_power_start(POWER_CSTATE,
+				  MSM_PM_SLEEP_MODE_POWER_COLLAPSE_STANDALONE);
 		ret = msm_pm_power_collapse_standalone();
 		low_power = 0;
 #ifdef CONFIG_MSM_IDLE_STATS
@@ -1559,6 +1780,8 @@ void arch_idle(void)
 			MSM_PM_STAT_IDLE_STANDALONE_POWER_COLLAPSE;
 #endif /* CONFIG_MSM_IDLE_STATS */
 	} else if (allow[MSM_PM_SLEEP_MODE_RAMP_DOWN_AND_WAIT_FOR_INTERRUPT]) {
+		trace_power_start(POWER_CSTATE,
+			MSM_PM_SLEEP_MODE_RAMP_DOWN_AND_WAIT_FOR_INTERRUPT);
 		ret = msm_pm_swfi(true);
 		if (ret)
 			while (!msm_irq_pending())
@@ -1568,12 +1791,16 @@ void arch_idle(void)
 		exit_stat = ret ? MSM_PM_STAT_IDLE_SPIN : MSM_PM_STAT_IDLE_WFI;
 #endif /* CONFIG_MSM_IDLE_STATS */
 	} else if (allow[MSM_PM_SLEEP_MODE_WAIT_FOR_INTERRUPT]) {
+		trace_power_start(POWER_CSTATE,
+				  MSM_PM_SLEEP_MODE_WAIT_FOR_INTERRUPT);
 		msm_pm_swfi(false);
 		low_power = 0;
 #ifdef CONFIG_MSM_IDLE_STATS
 		exit_stat = MSM_PM_STAT_IDLE_WFI;
 #endif /* CONFIG_MSM_IDLE_STATS */
 	} else {
+		/* spinning is reported as the state past the last mode */
+		trace_power_start(POWER_CSTATE, MSM_PM_SLEEP_MODE_NR);
 		while (!msm_irq_pending())
 			udelay(1);
 		low_power = 0;
@@ -1581,6 +1808,9 @@ void arch_idle(void)
 		exit_stat = MSM_PM_STAT_IDLE_SPIN;
 #endif /* CONFIG_MSM_IDLE_STATS */
 	}
+	trace_power_end(0);
+
+	msm_pm_predict_update(ktime_to_ns(ktime_sub(ktime_get(), idle_start)));
 
 arch_idle_exit:
 	msm_timer_exit_idle(low_power);
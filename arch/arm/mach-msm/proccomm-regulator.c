@@ -161,6 +161,10 @@ static int proccomm_vreg_set_voltage(struct regulator_dev *rdev,
 	int level_mV = UV_TO_MV(min_uV);
 	int rc;
 
+	/* Consumers reapply their voltage on every enable; skip repeats */
+	if (ddata->last_voltage && ddata->last_voltage == level_mV)
+		return 0;
+
 	rc = _vreg_set_level(rdev_get_id(rdev),
 			ddata->negative ? -level_mV : level_mV);
 
@@ -31,6 +31,8 @@
 #include <linux/kthread.h>
 #include <linux/module.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/uaccess.h>
 #include <linux/wait.h>
 #include <linux/wakelock.h>
@@ -382,32 +384,35 @@ static int rpc_send_accepted_void_reply(struct msm_rpc_endpoint *client,
 	return rc;
 }
 
-int __msm_adsp_write(struct msm_adsp_module *module, unsigned dsp_queue_addr,
-		   void *cmd_buf, size_t cmd_size)
+/* Must hold adsp_cmd_lock */
+static int adsp_write_ready(struct msm_adsp_module *module)
 {
-	uint32_t ctrl_word;
-	uint32_t dsp_q_addr;
-	uint32_t dsp_addr;
-	uint32_t cmd_id = 0;
-	int cnt = 0;
-	int ret_status = 0;
-	unsigned long flags;
-	struct adsp_info *info = module->info;
-
-	spin_lock_irqsave(&adsp_cmd_lock, flags);
-
 	if (module->state != ADSP_STATE_ENABLED) {
-		spin_unlock_irqrestore(&adsp_cmd_lock, flags);
 		pr_err("adsp: module %s not enabled before write\n",
 		       module->name);
 		return -ENODEV;
 	}
 	if (adsp_validate_module(module->id)) {
-		spin_unlock_irqrestore(&adsp_cmd_lock, flags);
 		pr_info("adsp: module id validation failed %s  %d\n",
 			module->name, module->id);
 		return -ENXIO;
 	}
+	return 0;
+}
+
+/* Must hold adsp_cmd_lock */
+static int adsp_write_locked(struct msm_adsp_module *module,
+			     unsigned dsp_queue_addr, void *cmd_buf,
+			     size_t cmd_size)
+{
+	uint32_t ctrl_word;
+	uint32_t dsp_q_addr;
+	uint32_t dsp_addr;
+	uint32_t cmd_id = 0;
+	int cnt = 0;
+	int ret_status = 0;
+	struct adsp_info *info = module->info;
+
 	dsp_q_addr = adsp_get_queue_offset(info, dsp_queue_addr);
 	dsp_q_addr &= ADSP_RTOS_WRITE_CTRL_WORD_DSP_ADDR_M;
 
@@ -470,6 +475,8 @@ int __msm_adsp_write(struct msm_adsp_module *module, unsigned dsp_queue_addr,
 
 	if ((ctrl_word & ADSP_RTOS_WRITE_CTRL_WORD_STATUS_M) !=
 			 ADSP_RTOS_WRITE_CTRL_WORD_NO_ERR_V) {
+		/* No free buffer in the DSP queue */
+		module->num_stalls++;
 		ret_status = -EAGAIN;
 		goto fail;
 	}
@@ -529,6 +536,20 @@ int __msm_adsp_write(struct msm_adsp_module *module, unsigned dsp_queue_addr,
 	module->num_commands++;
 
 fail:
+	return ret_status;
+}
+
+int __msm_adsp_write(struct msm_adsp_module *module, unsigned dsp_queue_addr,
+		   void *cmd_buf, size_t cmd_size)
+{
+	int ret_status;
+	unsigned long flags;
+
+	spin_lock_irqsave(&adsp_cmd_lock, flags);
+	ret_status = adsp_write_ready(module);
+	if (!ret_status)
+		ret_status = adsp_write_locked(module, dsp_queue_addr,
+					       cmd_buf, cmd_size);
 	spin_unlock_irqrestore(&adsp_cmd_lock, flags);
 	return ret_status;
 }
@@ -549,6 +570,42 @@ int msm_adsp_write(struct msm_adsp_module *module, unsigned dsp_queue_addr,
 	return rc;
 }
 
+/*
+ * Write several commands taking the command lock once. When the DSP
+ * runs out of queue buffers the lock is dropped to let it drain, and
+ * the batch resumes with the command that was refused. Returns the
+ * number of commands written, or an error if none was.
+ */
+int msm_adsp_write_batch(struct msm_adsp_module *module,
+			 struct msm_adsp_cmd *cmds, unsigned count)
+{
+	unsigned long flags;
+	unsigned done = 0;
+	int rc = 0, retries = 0;
+
+	while (done < count) {
+		spin_lock_irqsave(&adsp_cmd_lock, flags);
+		rc = adsp_write_ready(module);
+		while (!rc && done < count) {
+			rc = adsp_write_locked(module, cmds[done].queue_id,
+					       cmds[done].data, cmds[done].len);
+			if (!rc)
+				done++;
+		}
+		spin_unlock_irqrestore(&adsp_cmd_lock, flags);
+
+		if (rc != -EAGAIN || retries++ >= 100)
+			break;
+		udelay(10);
+	}
+	module->num_batches++;
+	if (retries > 50)
+		pr_warning("adsp: %s batch stalled %d times: rc %d\n",
+				module->name, retries, rc);
+	return done ? done : rc;
+}
+EXPORT_SYMBOL(msm_adsp_write_batch);
+
 #ifdef CONFIG_MSM_ADSP_REPORT_EVENTS
 static void *modem_event_addr;
 #if CONFIG_MSM_AMSS_VERSION >= 6350
@@ -1175,6 +1232,46 @@ static struct platform_driver msm_adsp_driver = {
 	},
 };
 
+#ifdef CONFIG_DEBUG_FS
+static int adsp_stats_show(struct seq_file *m, void *unused)
+{
+	struct msm_adsp_module *mod;
+	int n;
+
+	seq_printf(m, "%-16s %10s %10s %10s %10s\n", "module", "commands",
+		   "batches", "stalls", "events");
+	for (n = 0; adsp_modules && n < adsp_info.module_count; n++) {
+		mod = adsp_modules + n;
+		if (!mod->num_commands && !mod->num_events)
+			continue;
+		seq_printf(m, "%-16s %10u %10u %10u %10u\n", mod->name,
+			   mod->num_commands, mod->num_batches,
+			   mod->num_stalls, mod->num_events);
+	}
+	return 0;
+}
+
+static int adsp_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, adsp_stats_show, NULL);
+}
+
+static const struct file_operations adsp_stats_fops = {
+	.open		= adsp_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init adsp_stats_init(void)
+{
+	debugfs_create_file("adsp_stats", S_IRUGO, NULL, NULL,
+			    &adsp_stats_fops);
+	return 0;
+}
+late_initcall(adsp_stats_init);
+#endif
+
 static int __init adsp_init(void)
 {
 	return platform_driver_register(&msm_adsp_driver);
@@ -265,6 +265,8 @@ struct rpc_adsp_rtos_modem_to_app_args_t {
 #define ADSP_STATE_INIT_INFO  4
 #endif
 
+struct adsp_pmem_region;
+
 struct msm_adsp_module {
 	struct mutex lock;
 	const char *name;
@@ -278,6 +280,8 @@ struct msm_adsp_module {
 	/* statistics */
 	unsigned num_commands;
 	unsigned num_events;
+	unsigned num_batches;
+	unsigned num_stalls;	/* writes refused for lack of queue space */
 
 	wait_queue_head_t state_wait;
 	unsigned state;
@@ -288,6 +292,7 @@ struct msm_adsp_module {
 
 	struct mutex pmem_regions_lock;
 	struct hlist_head pmem_regions;
+	struct adsp_pmem_region *pmem_hint;	/* last region looked up */
 	int (*verify_cmd) (struct msm_adsp_module*, unsigned int, void *,
 			   size_t);
 	int (*patch_event) (struct msm_adsp_module*, struct adsp_event *);
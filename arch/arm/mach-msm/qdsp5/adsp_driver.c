@@ -147,6 +147,19 @@ end:
 	return rc;
 }
 
+static int adsp_pmem_region_has(struct adsp_pmem_region *region,
+				void *vaddr, unsigned long len)
+{
+	return vaddr >= region->vaddr &&
+		vaddr < region->vaddr + region->len &&
+		vaddr + len <= region->vaddr + region->len;
+}
+
+/*
+ * Commands of a session keep pointing into the same few buffers, so
+ * the region of the last lookup is tried first. Registered regions
+ * never overlap, so the first hit is the only one.
+ */
 static int adsp_pmem_lookup_vaddr(struct msm_adsp_module *module, void **addr,
 		     unsigned long len, struct adsp_pmem_region **region)
 {
@@ -154,42 +167,23 @@ static int adsp_pmem_lookup_vaddr(struct msm_adsp_module *module, void **addr,
 	void *vaddr = *addr;
 	struct adsp_pmem_region *region_elt;
 
-	int match_count = 0;
-
-	*region = NULL;
-
-	/* returns physical address or zero */
-	hlist_for_each_entry(region_elt, node, &module->pmem_regions, list) {
-		if (vaddr >= region_elt->vaddr &&
-		    vaddr < region_elt->vaddr + region_elt->len &&
-		    vaddr + len <= region_elt->vaddr + region_elt->len) {
-			/* offset since we could pass vaddr inside a registerd
-			 * pmem buffer
-			 */
-
-			match_count++;
-			if (!*region)
-				*region = region_elt;
-		}
+	region_elt = module->pmem_hint;
+	if (region_elt && adsp_pmem_region_has(region_elt, vaddr, len)) {
+		*region = region_elt;
+		return 0;
 	}
 
-	if (match_count > 1) {
-		printk(KERN_ERR "adsp: module %s: "
-			"multiple hits for vaddr %p, len %ld\n",
-			module->name, vaddr, len);
-		hlist_for_each_entry(region_elt, node,
-				&module->pmem_regions, list) {
-			if (vaddr >= region_elt->vaddr &&
-			    vaddr < region_elt->vaddr + region_elt->len &&
-			    vaddr + len <= region_elt->vaddr + region_elt->len)
-				printk(KERN_ERR "\t%p, %ld --> %p\n",
-					region_elt->vaddr,
-					region_elt->len,
-					(void *)region_elt->paddr);
+	/* offset since we could pass vaddr inside a registerd pmem buffer */
+	hlist_for_each_entry(region_elt, node, &module->pmem_regions, list) {
+		if (adsp_pmem_region_has(region_elt, vaddr, len)) {
+			module->pmem_hint = region_elt;
+			*region = region_elt;
+			return 0;
 		}
 	}
 
-	return *region ? 0 : -1;
+	*region = NULL;
+	return -1;
 }
 
 int adsp_pmem_fixup_kvaddr(struct msm_adsp_module *module, void **addr,
@@ -285,6 +279,70 @@ end:
 	return rc;
 }
 
+/* Payloads of a batch beyond this are written one ioctl at a time */
+#define ADSP_BATCH_MAX_BYTES	(4 * PAGE_SIZE)
+
+static long adsp_write_cmds(struct adsp_device *adev, void __user *arg)
+{
+	struct adsp_command_batch_t batch;
+	struct adsp_command_t ucmd[ADSP_MAX_BATCH_COMMANDS];
+	struct msm_adsp_cmd cmds[ADSP_MAX_BATCH_COMMANDS];
+	size_t total = 0;
+	unsigned n;
+	char *data;
+	long rc = 0;
+
+	if (copy_from_user(&batch, arg, sizeof(batch)))
+		return -EFAULT;
+	if (!batch.count || batch.count > ADSP_MAX_BATCH_COMMANDS)
+		return -EINVAL;
+	if (copy_from_user(ucmd, (void __user *)batch.cmds,
+				batch.count * sizeof(ucmd[0])))
+		return -EFAULT;
+
+	for (n = 0; n < batch.count; n++) {
+		if (ucmd[n].len > ADSP_BATCH_MAX_BYTES)
+			return -EINVAL;
+		/* keep every command word aligned for the verifiers */
+		total += ALIGN(ucmd[n].len, sizeof(uint32_t));
+	}
+	if (total > ADSP_BATCH_MAX_BYTES)
+		return -EINVAL;
+
+	data = kmalloc(total, GFP_USER);
+	if (!data)
+		return -ENOMEM;
+
+	for (n = 0, total = 0; n < batch.count; n++) {
+		cmds[n].queue_id = ucmd[n].queue;
+		cmds[n].data = data + total;
+		cmds[n].len = ucmd[n].len;
+		if (copy_from_user(cmds[n].data, (void __user *)ucmd[n].data,
+					ucmd[n].len)) {
+			rc = -EFAULT;
+			goto end;
+		}
+		total += ALIGN(ucmd[n].len, sizeof(uint32_t));
+	}
+
+	mutex_lock(&adev->module->pmem_regions_lock);
+	for (n = 0; n < batch.count; n++) {
+		if (adsp_verify_cmd(adev->module, cmds[n].queue_id,
+					cmds[n].data, cmds[n].len)) {
+			printk(KERN_ERR "module %s: verify failed.\n",
+				adev->module->name);
+			rc = -EINVAL;
+			break;
+		}
+	}
+	if (!rc)
+		rc = msm_adsp_write_batch(adev->module, cmds, batch.count);
+	mutex_unlock(&adev->module->pmem_regions_lock);
+end:
+	kfree(data);
+	return rc;
+}
+
 static int adsp_events_pending(struct adsp_device *adev)
 {
 	unsigned long flags;
@@ -302,9 +360,17 @@ static int adsp_pmem_lookup_paddr(struct msm_adsp_module *module, void **addr,
 	unsigned long paddr = (unsigned long)(*addr);
 	struct adsp_pmem_region *region_elt;
 
+	region_elt = module->pmem_hint;
+	if (region_elt && paddr >= region_elt->paddr &&
+	    paddr < region_elt->paddr + region_elt->len) {
+		*region = region_elt;
+		return 0;
+	}
+
 	hlist_for_each_entry(region_elt, node, &module->pmem_regions, list) {
 		if (paddr >= region_elt->paddr &&
 		    paddr < region_elt->paddr + region_elt->len) {
+			module->pmem_hint = region_elt;
 			*region = region_elt;
 			return 0;
 		}
@@ -333,10 +399,16 @@ int adsp_pmem_paddr_fixup(struct msm_adsp_module *module, void **addr)
 static int adsp_patch_event(struct msm_adsp_module *module,
 				struct adsp_event *event)
 {
+	int rc = 0;
+
 	/* call the per-module msg verifier */
-	if (module->patch_event)
-		return module->patch_event(module, event);
-	return 0;
+	if (module->patch_event) {
+		/* the region list and lookup hint may change under us */
+		mutex_lock(&module->pmem_regions_lock);
+		rc = module->patch_event(module, event);
+		mutex_unlock(&module->pmem_regions_lock);
+	}
+	return rc;
 }
 
 static long adsp_get_event(struct adsp_device *adev, void __user *arg)
@@ -434,6 +506,9 @@ static long adsp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	case ADSP_IOCTL_WRITE_COMMAND:
 		return adsp_write_cmd(adev, (void __user *) arg);
 
+	case ADSP_IOCTL_WRITE_COMMANDS:
+		return adsp_write_cmds(adev, (void __user *) arg);
+
 	case ADSP_IOCTL_GET_EVENT:
 		return adsp_get_event(adev, (void __user *) arg);
 
@@ -477,6 +552,7 @@ static int adsp_release(struct inode *inode, struct file *filp)
 	adev->module = NULL;
 
 	mutex_lock(&module->pmem_regions_lock);
+	module->pmem_hint = NULL;
 	hlist_for_each_safe(node, tmp, &module->pmem_regions) {
 		region = hlist_entry(node, struct adsp_pmem_region, list);
 		hlist_del(node);
@@ -0,0 +1,164 @@
+/*
+ * AAC decoder parameters for the LPA driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/fs.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+
+#include <linux/msm_audio.h>
+
+#include <mach/qdsp5v2_1x/qdsp5audppmsg.h>
+#include <mach/qdsp5v2_1x/qdsp5audplaycmdi.h>
+#include <mach/qdsp5v2_1x/qdsp5audplaymsg.h>
+#include <mach/qdsp5v2_1x/audpp.h>
+#include <mach/qdsp5v2_1x/codec_utils.h>
+#include <mach/qdsp5v2_1x/aac_funcs.h>
+#include <mach/debug_audio_mm.h>
+
+static int aac_validate_usr_config(struct msm_audio_aac_config *config)
+{
+	if (config->format != AUDIO_AAC_FORMAT_ADTS &&
+		config->format != AUDIO_AAC_FORMAT_RAW &&
+		config->format != AUDIO_AAC_FORMAT_PSUEDO_RAW &&
+		config->format != AUDIO_AAC_FORMAT_LOAS)
+		return -EINVAL;
+
+	if (config->audio_object != AUDIO_AAC_OBJECT_LC &&
+		config->audio_object != AUDIO_AAC_OBJECT_LTP &&
+		config->audio_object != AUDIO_AAC_OBJECT_ERLC)
+		return -EINVAL;
+
+	if (config->audio_object == AUDIO_AAC_OBJECT_ERLC) {
+		if (config->ep_config > 3)
+			return -EINVAL;
+		if (config->aac_scalefactor_data_resilience_flag !=
+			AUDIO_AAC_SCA_DATA_RES_OFF &&
+			config->aac_scalefactor_data_resilience_flag !=
+			AUDIO_AAC_SCA_DATA_RES_ON)
+			return -EINVAL;
+		if (config->aac_section_data_resilience_flag !=
+			AUDIO_AAC_SEC_DATA_RES_OFF &&
+			config->aac_section_data_resilience_flag !=
+			AUDIO_AAC_SEC_DATA_RES_ON)
+			return -EINVAL;
+		if (config->aac_spectral_data_resilience_flag !=
+			AUDIO_AAC_SPEC_DATA_RES_OFF &&
+			config->aac_spectral_data_resilience_flag !=
+			AUDIO_AAC_SPEC_DATA_RES_ON)
+			return -EINVAL;
+	} else {
+		config->aac_section_data_resilience_flag =
+			AUDIO_AAC_SEC_DATA_RES_OFF;
+		config->aac_scalefactor_data_resilience_flag =
+			AUDIO_AAC_SCA_DATA_RES_OFF;
+		config->aac_spectral_data_resilience_flag =
+			AUDIO_AAC_SPEC_DATA_RES_OFF;
+	}
+
+	if (config->sbr_on_flag != AUDIO_AAC_SBR_ON_FLAG_OFF &&
+		config->sbr_on_flag != AUDIO_AAC_SBR_ON_FLAG_ON)
+		return -EINVAL;
+
+	if (config->sbr_ps_on_flag != AUDIO_AAC_SBR_PS_ON_FLAG_OFF &&
+		config->sbr_ps_on_flag != AUDIO_AAC_SBR_PS_ON_FLAG_ON)
+		return -EINVAL;
+
+	if (config->dual_mono_mode > AUDIO_AAC_DUAL_MONO_PL_SR)
+		return -EINVAL;
+
+	if (config->channel_configuration > 2)
+		return -EINVAL;
+
+	return 0;
+}
+
+long aac_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	struct audio *audio = file->private_data;
+	struct msm_audio_aac_config config;
+
+	MM_DBG("aac_ioctl() cmd = %d\n", cmd);
+
+	switch (cmd) {
+	case AUDIO_GET_AAC_LP_CONFIG:
+		memset(&config, 0, sizeof(config));
+		config.format = audio->aac_params.format;
+		config.audio_object = audio->aac_params.audio_object;
+		config.ep_config = audio->aac_params.ep_config;
+		config.aac_section_data_resilience_flag =
+			audio->aac_params.aac_section_data_resilience_flag;
+		config.aac_scalefactor_data_resilience_flag =
+			audio->aac_params.aac_scalefactor_data_resilience_flag;
+		config.aac_spectral_data_resilience_flag =
+			audio->aac_params.aac_spectral_data_resilience_flag;
+		config.sbr_on_flag = audio->aac_params.sbr_on_flag;
+		config.sbr_ps_on_flag = audio->aac_params.sbr_ps_on_flag;
+		config.dual_mono_mode = AUDIO_AAC_DUAL_MONO_PL_SR;
+		config.channel_configuration =
+			audio->aac_params.channel_configuration;
+		if (copy_to_user((void *) arg, &config, sizeof(config)))
+			return -EFAULT;
+		return 0;
+
+	case AUDIO_SET_AAC_LP_CONFIG:
+		if (copy_from_user(&config, (void *) arg, sizeof(config)))
+			return -EFAULT;
+		if (aac_validate_usr_config(&config))
+			return -EINVAL;
+		audio->aac_params.format = config.format;
+		audio->aac_params.audio_object = config.audio_object;
+		audio->aac_params.ep_config = config.ep_config;
+		audio->aac_params.aac_section_data_resilience_flag =
+			config.aac_section_data_resilience_flag;
+		audio->aac_params.aac_scalefactor_data_resilience_flag =
+			config.aac_scalefactor_data_resilience_flag;
+		audio->aac_params.aac_spectral_data_resilience_flag =
+			config.aac_spectral_data_resilience_flag;
+		audio->aac_params.sbr_on_flag = config.sbr_on_flag;
+		audio->aac_params.sbr_ps_on_flag = config.sbr_ps_on_flag;
+		audio->aac_params.channel_configuration =
+			config.channel_configuration;
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+void aac_init(struct audio *audio)
+{
+	audio->aac_params.format = AUDIO_AAC_FORMAT_ADTS;
+	audio->aac_params.audio_object = AUDIO_AAC_OBJECT_LC;
+	audio->aac_params.ep_config = 0;
+	audio->aac_params.aac_section_data_resilience_flag =
+		AUDIO_AAC_SEC_DATA_RES_OFF;
+	audio->aac_params.aac_scalefactor_data_resilience_flag =
+		AUDIO_AAC_SCA_DATA_RES_OFF;
+	audio->aac_params.aac_spectral_data_resilience_flag =
+		AUDIO_AAC_SPEC_DATA_RES_OFF;
+	audio->aac_params.sbr_on_flag = AUDIO_AAC_SBR_ON_FLAG_ON;
+	audio->aac_params.sbr_ps_on_flag = AUDIO_AAC_SBR_PS_ON_FLAG_ON;
+	audio->aac_params.channel_configuration = 2;
+}
+
+void audpp_cmd_cfg_aac_params(struct audio *audio)
+{
+	struct audpp_cmd_cfg_adec_params_aac cmd = audio->aac_params;
+
+	cmd.common.cmd_id = AUDPP_CMD_CFG_ADEC_PARAMS;
+	cmd.common.length = AUDPP_CMD_CFG_ADEC_PARAMS_AAC_LEN;
+	cmd.common.dec_id = audio->dec_id;
+	cmd.common.input_sampling_frequency = audio->out_sample_rate;
+
+	audpp_send_queue2(&cmd, sizeof(cmd));
+}
@@ -33,6 +33,8 @@
 #include <linux/uaccess.h>
 #include <linux/wait.h>
 #include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/io.h>
 #include <mach/msm_iomap.h>
@@ -257,46 +259,41 @@ void msm_adsp_put(struct msm_adsp_module *module)
 }
 EXPORT_SYMBOL(msm_adsp_put);
 
-int __msm_adsp_write(struct msm_adsp_module *module, unsigned dsp_queue_addr,
-		   void *cmd_buf, size_t cmd_size)
+/* Must hold adsp_write_lock */
+static int adsp_write_ready(struct msm_adsp_module *module)
 {
-	uint32_t ctrl_word;
-	uint32_t dsp_q_addr;
-	uint32_t dsp_addr;
-	uint32_t cmd_id = 0;
-	int cnt = 0;
-	int ret_status = 0;
-	unsigned long flags;
-	struct adsp_info *info;
-
-	if (!module || !cmd_buf) {
-		MM_AUD_ERR("Called with NULL parameters\n");
-		return -EINVAL;
-	}
-	info = module->info;
-	spin_lock_irqsave(&adsp_write_lock, flags);
-
 	if (module->state != ADSP_STATE_ENABLED) {
-		spin_unlock_irqrestore(&adsp_write_lock, flags);
 		MM_AUD_ERR("module %s not enabled before write\n",
 				module->name);
 		return -ENODEV;
 	}
 	if (adsp_validate_module(module->id)) {
-		spin_unlock_irqrestore(&adsp_write_lock, flags);
 		MM_AUD_INFO("module id validation failed %s  %d\n",
 				module->name, module->id);
 		return -ENXIO;
 	}
+	return 0;
+}
+
+/* Must hold adsp_write_lock */
+static int adsp_write_locked(struct msm_adsp_module *module,
+			unsigned dsp_queue_addr, void *cmd_buf,
+			size_t cmd_size)
+{
+	uint32_t ctrl_word;
+	uint32_t dsp_q_addr;
+	uint32_t dsp_addr;
+	uint32_t cmd_id = 0;
+	int cnt = 0;
+	int ret_status = 0;
+	struct adsp_info *info = module->info;
+
 	if (dsp_queue_addr >= QDSP_MAX_NUM_QUEUES) {
-		spin_unlock_irqrestore(&adsp_write_lock, flags);
 		MM_AUD_INFO("Invalid Queue Index: %d\n", dsp_queue_addr);
 		return -ENXIO;
 	}
-	if (adsp_validate_queue(module->id, dsp_queue_addr, cmd_size)) {
-		spin_unlock_irqrestore(&adsp_write_lock, flags);
+	if (adsp_validate_queue(module->id, dsp_queue_addr, cmd_size))
 		return -EINVAL;
-	}
 	dsp_q_addr = adsp_get_queue_offset(info, dsp_queue_addr);
 	dsp_q_addr &= ADSP_RTOS_WRITE_CTRL_WORD_DSP_ADDR_M;
 
@@ -359,6 +356,8 @@ int __msm_adsp_write(struct msm_adsp_module *module, unsigned dsp_queue_addr,
 
 	if ((ctrl_word & ADSP_RTOS_WRITE_CTRL_WORD_STATUS_M) !=
 	    ADSP_RTOS_WRITE_CTRL_WORD_NO_ERR_V) {
+		/* No free buffer in the DSP queue */
+		module->num_stalls++;
 		ret_status = -EAGAIN;
 		goto fail;
 	} else {
@@ -417,6 +416,24 @@ int __msm_adsp_write(struct msm_adsp_module *module, unsigned dsp_queue_addr,
 	} /* Ctrl word status bits were 00, no error in the ctrl word */
 
 fail:
+	return ret_status;
+}
+
+int __msm_adsp_write(struct msm_adsp_module *module, unsigned dsp_queue_addr,
+		   void *cmd_buf, size_t cmd_size)
+{
+	int ret_status;
+	unsigned long flags;
+
+	if (!module || !cmd_buf) {
+		MM_AUD_ERR("Called with NULL parameters\n");
+		return -EINVAL;
+	}
+	spin_lock_irqsave(&adsp_write_lock, flags);
+	ret_status = adsp_write_ready(module);
+	if (!ret_status)
+		ret_status = adsp_write_locked(module, dsp_queue_addr,
+						cmd_buf, cmd_size);
 	spin_unlock_irqrestore(&adsp_write_lock, flags);
 	return ret_status;
 }
@@ -442,6 +459,45 @@ int msm_adsp_write(struct msm_adsp_module *module, unsigned dsp_queue_addr,
 	return rc;
 }
 
+/*
+ * Write several commands taking the write lock once. When the DSP runs
+ * out of queue buffers the lock is dropped to let it drain, and the
+ * batch resumes with the command that was refused. Returns the number
+ * of commands written, or an error if none was.
+ */
+int msm_adsp_write_batch(struct msm_adsp_module *module,
+			struct msm_adsp_cmd *cmds, unsigned count)
+{
+	unsigned long flags;
+	unsigned done = 0;
+	int rc = 0, retries = 0;
+
+	if (!module || !cmds)
+		return -EINVAL;
+
+	while (done < count) {
+		spin_lock_irqsave(&adsp_write_lock, flags);
+		rc = adsp_write_ready(module);
+		while (!rc && done < count) {
+			rc = adsp_write_locked(module, cmds[done].queue_id,
+					cmds[done].data, cmds[done].len);
+			if (!rc)
+				done++;
+		}
+		spin_unlock_irqrestore(&adsp_write_lock, flags);
+
+		if (rc != -EAGAIN || retries++ >= 100)
+			break;
+		udelay(50);
+	}
+	module->num_batches++;
+	if (retries > 20)
+		MM_AUD_INFO("%s batch stalled %d times: rc %d\n",
+			module->name, retries, rc);
+	return done ? done : rc;
+}
+EXPORT_SYMBOL(msm_adsp_write_batch);
+
 #ifdef CONFIG_MSM_ADSP_REPORT_EVENTS
 static void *event_addr;
 static void read_event(void *buf, size_t len)
@@ -1059,6 +1115,46 @@ struct platform_device msm_adsp_device = {
 
 static char msm_adsp_driver_name[] = "msm_adsp";
 
+#ifdef CONFIG_DEBUG_FS
+static int adsp_stats_show(struct seq_file *m, void *unused)
+{
+	struct msm_adsp_module *mod;
+	int n;
+
+	seq_printf(m, "%-16s %10s %10s %10s %10s\n", "module", "commands",
+			"batches", "stalls", "events");
+	for (n = 0; adsp_modules && n < adsp_info.module_count; n++) {
+		mod = adsp_modules + n;
+		if (!mod->num_commands && !mod->num_events)
+			continue;
+		seq_printf(m, "%-16s %10u %10u %10u %10u\n", mod->name,
+				mod->num_commands, mod->num_batches,
+				mod->num_stalls, mod->num_events);
+	}
+	return 0;
+}
+
+static int adsp_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, adsp_stats_show, NULL);
+}
+
+static const struct file_operations adsp_stats_fops = {
+	.open		= adsp_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init adsp_stats_init(void)
+{
+	debugfs_create_file("adsp_stats", S_IRUGO, NULL, NULL,
+				&adsp_stats_fops);
+	return 0;
+}
+late_initcall(adsp_stats_init);
+#endif
+
 static int __init adsp_init(void)
 {
 	int rc;
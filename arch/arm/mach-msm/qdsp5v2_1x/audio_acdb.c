@@ -92,6 +92,9 @@
 
 #define MAX_RETRY	10
 
+/* device tables fetched from the modem kept for quick device switches */
+#define ACDB_CACHE_ENTRIES	4
+
 /* rpc table index */
 enum {
 	ACDB_DalACDB_ioctl = DALDEVICE_FIRST_DEVICE_API_IDX
@@ -105,6 +108,14 @@ enum {
 };
 
 
+struct acdb_cache_entry {
+	u32 acdb_id;
+	u32 sample_rate;
+	u32 used_bytes;		/* 0 if the entry is unused */
+	unsigned long last_used;
+	u8 *data;
+};
+
 struct acdb_data {
 	void *handle;
 
@@ -136,6 +147,9 @@ struct acdb_data {
 	u32 acdb_compl;
 	u32 wait_for_cal_compl;
 	struct acdb_result acdb_result;
+
+	struct acdb_cache_entry cache[ACDB_CACHE_ENTRIES];
+	unsigned long cache_clock;
 };
 
 
@@ -551,6 +565,59 @@ done:
 }
 
 
+/* Must hold acdb_mutex */
+static int acdb_cache_lookup(u32 acdb_id, u32 sample_rate)
+{
+	struct acdb_cache_entry *entry;
+	int i;
+
+	for (i = 0; i < ACDB_CACHE_ENTRIES; i++) {
+		entry = &acdb_data.cache[i];
+		if (!entry->used_bytes || entry->acdb_id != acdb_id ||
+			entry->sample_rate != sample_rate)
+			continue;
+
+		memcpy(acdb_data.virt_addr, entry->data, entry->used_bytes);
+		acdb_data.acdb_result.used_bytes = entry->used_bytes;
+		entry->last_used = ++acdb_data.cache_clock;
+		return 1;
+	}
+	return 0;
+}
+
+/* Must hold acdb_mutex */
+static void acdb_cache_store(u32 acdb_id, u32 sample_rate)
+{
+	struct acdb_cache_entry *entry, *victim = &acdb_data.cache[0];
+	u32 used_bytes = acdb_data.acdb_result.used_bytes;
+	int i;
+
+	if (!used_bytes || used_bytes > ACDB_BUF_SIZE)
+		return;
+
+	for (i = 0; i < ACDB_CACHE_ENTRIES; i++) {
+		entry = &acdb_data.cache[i];
+		if (!entry->used_bytes) {
+			victim = entry;
+			break;
+		}
+		if (entry->last_used < victim->last_used)
+			victim = entry;
+	}
+
+	if (!victim->data) {
+		victim->data = kmalloc(ACDB_BUF_SIZE, GFP_KERNEL);
+		if (!victim->data)
+			return;
+	}
+
+	memcpy(victim->data, acdb_data.virt_addr, used_bytes);
+	victim->acdb_id = acdb_id;
+	victim->sample_rate = sample_rate;
+	victim->used_bytes = used_bytes;
+	victim->last_used = ++acdb_data.cache_clock;
+}
+
 s32 acdb_get_calibration(void)
 {
 	struct acdb_cmd_get_device_table	acdb_cmd;
@@ -564,6 +631,12 @@ s32 acdb_get_calibration(void)
 	if (sz > 0) {
 		acdb_data.acdb_state |= CAL_DATA_READY;
 		acdb_data.enable = 1;
+	} else if (acdb_cache_lookup(acdb_data.device_info->acdb_id,
+				acdb_data.device_info->sample_rate)) {
+		MM_DBG("acdb table for device %d from cache\n",
+			acdb_data.device_info->acdb_id);
+		acdb_data.acdb_state |= CAL_DATA_READY;
+		acdb_data.enable = 1;
 	} else {
 		MM_DBG("acdb state = %d\n", acdb_data.acdb_state);
 		acdb_cmd.command_id = ACDB_GET_DEVICE_TABLE;
@@ -601,6 +674,8 @@ s32 acdb_get_calibration(void)
 					" (iterations = %d)\n", iterations);
 				acdb_data.acdb_state |= CAL_DATA_READY;
 				acdb_data.enable = 1;
+				acdb_cache_store(acdb_cmd.device_id,
+						acdb_cmd.sample_rate_id);
 				pr_aud_info("%d: change acdb_State to %d\n",
 						__LINE__,acdb_data.acdb_state);
 				goto done;
@@ -1257,6 +1332,7 @@ s32 acdb_fill_audpreproc_iir(void)
 static void __exit acdb_exit(void)
 {
 	s32	result = 0;
+	int	i;
 
 	result = auddev_unregister_evt_listner(AUDDEV_CLNT_AUDIOCAL, 0);
 	if (result)
@@ -1283,6 +1359,8 @@ static void __exit acdb_exit(void)
 	kfree(acdb_data.pp_mbadrc);
 	kfree(acdb_data.preproc_agc);
 	kfree(acdb_data.preproc_iir);
+	for (i = 0; i < ACDB_CACHE_ENTRIES; i++)
+		kfree(acdb_data.cache[i].data);
 
 	mutex_destroy(&acdb_data.acdb_mutex);
 	memset(&acdb_data, 0, sizeof(acdb_data));
@@ -830,6 +830,33 @@ struct miscdevice audio_dev_ctrl_misc = {
  * 16-23 for Encoder clients
  * 24-31 Do not care
  */
+/*
+ * Whether another open rx device on the same COPP still carries the
+ * session, as after the codec path was handed over to a new device
+ * before the old one was closed. Releasing the old device must not
+ * unroute the stream then.
+ */
+static int audio_dev_ctrl_copp_held(struct msm_snddev_info *dev_info,
+					u32 session_mask)
+{
+	struct msm_snddev_info *info;
+	int i;
+
+	if (!(dev_info->capability & SNDDEV_CAP_RX))
+		return 0;
+
+	for (i = 0; i < audio_dev_ctrl.num_dev; i++) {
+		info = audio_dev_ctrl.devs[i];
+		if (info == dev_info || !info->opened)
+			continue;
+		if ((info->capability & SNDDEV_CAP_RX) &&
+			info->copp_id == dev_info->copp_id &&
+			(info->sessions & session_mask))
+			return 1;
+	}
+	return 0;
+}
+
 void broadcast_event(u32 evt_id, u32 dev_id, u32 session_id)
 {
 	int clnt_id = 0;
@@ -932,6 +959,11 @@ void broadcast_event(u32 evt_id, u32 dev_id, u32 session_id)
 volume_strm:
 		if (callback->clnt_type == AUDDEV_CLNT_DEC) {
 			MM_DBG("AUDDEV_CLNT_DEC\n");
+			if (((evt_id == AUDDEV_EVT_REL_PENDING) ||
+				(evt_id == AUDDEV_EVT_DEV_RLS)) &&
+				audio_dev_ctrl_copp_held(dev_info,
+							session_mask))
+				goto sent_dec;
 			if (evt_id == AUDDEV_EVT_STREAM_VOL_CHG) {
 				MM_DBG("clnt_id = %d, session_id = 0x%8x\n",
 					clnt_id, session_id);
@@ -42,6 +42,7 @@
 #include <mach/qdsp5v2_1x/qdsp5audplaymsg.h>
 #include <mach/qdsp5v2_1x/audpp.h>
 #include <mach/qdsp5v2_1x/codec_utils.h>
+#include <mach/qdsp5v2_1x/aac_funcs.h>
 #include <mach/qdsp5v2_1x/mp3_funcs.h>
 #include <mach/qdsp5v2_1x/pcm_funcs.h>
 #include <mach/debug_audio_mm.h>
@@ -59,6 +60,7 @@
 
 #define AUDDEC_DEC_PCM 0
 #define AUDDEC_DEC_MP3 2
+#define AUDDEC_DEC_AAC 5
 
 #define PCM_BUFSZ_MIN 4800	/* Hold one stereo MP3 frame */
 
@@ -159,12 +161,16 @@ struct audlpa_dec {
 	int dec_attrb;
 	long (*ioctl)(struct file *, unsigned int, unsigned long);
 	void (*adec_params)(struct audio *);
+	void (*init)(struct audio *);	/* optional, sets codec defaults */
 };
 
+/* Open fails with -ENODEV if the DSP image has no LP decoder for a codec */
 struct audlpa_dec audlpa_decs[] = {
 	{"msm_mp3_lp", AUDDEC_DEC_MP3, &mp3_ioctl, &audpp_cmd_cfg_mp3_params},
 	{"msm_pcm_lp_dec", AUDDEC_DEC_PCM, &pcm_ioctl,
 		&audpp_cmd_cfg_pcm_params},
+	{"msm_aac_lp", AUDDEC_DEC_AAC, &aac_ioctl, &audpp_cmd_cfg_aac_params,
+		&aac_init},
 };
 
 static int auddec_dsp_config(struct audio *audio, int enable);
@@ -1602,6 +1608,8 @@ static int audio_open(struct inode *inode, struct file *file)
 	audio->out_channel_mode = AUDPP_CMD_PCM_INTF_STEREO_V;
 	audio->out_bits = AUDPP_CMD_WAV_PCM_WIDTH_16;
 	audio->vol_pan.volume = 0x2000;
+	if (audlpa_decs[audio->minor_no].init)
+		audlpa_decs[audio->minor_no].init(audio);
 
 	audlpa_async_flush(audio);
 
@@ -23,11 +23,14 @@
 #include <linux/uaccess.h>
 #include <linux/mutex.h>
 #include <linux/wakelock.h>
+#include <linux/pm_qos.h>
 #include <mach/msm_audio_mvs.h>
 #include <mach/debug_audio_mm.h>
 #include <linux/slab.h>
 #include <mach/msm_rpcrouter.h>
 
+#include "../pm.h"
+
 #define MVS_PROG 0x30000014
 #if (CONFIG_MSM_AMSS_VERSION >= 2000)
 #define MVS_VERS 0x00030001
@@ -264,7 +267,7 @@ struct audio_mvs_info_type {
 	struct mutex out_lock;
 
 	struct wake_lock suspend_lock;
-	struct wake_lock idle_lock;
+	struct pm_qos_request pm_qos_req;
 };
 
 static struct audio_mvs_info_type audio_mvs_info;
@@ -480,7 +483,7 @@ static int audio_mvs_start(struct audio_mvs_info_type *audio)
 
 	/* Prevent sleep. */
 	wake_lock(&audio->suspend_lock);
-	wake_lock(&audio->idle_lock);
+	pm_qos_update_request(&audio->pm_qos_req, msm_pm_collapse_latency());
 
 	/* Acquire MVS. */
 	memset(&acquire_msg, 0, sizeof(acquire_msg));
@@ -572,7 +575,7 @@ static int audio_mvs_stop(struct audio_mvs_info_type *audio)
 
 	/* Allow sleep. */
 	wake_unlock(&audio->suspend_lock);
-	wake_unlock(&audio->idle_lock);
+	pm_qos_update_request(&audio->pm_qos_req, PM_QOS_DEFAULT_VALUE);
 
 	return rc;
 }
@@ -1385,9 +1388,9 @@ static int __init audio_mvs_init(void)
 	wake_lock_init(&audio_mvs_info.suspend_lock,
 		       WAKE_LOCK_SUSPEND,
 		       "audio_mvs_suspend");
-	wake_lock_init(&audio_mvs_info.idle_lock,
-		       WAKE_LOCK_IDLE,
-		       "audio_mvs_idle");
+	pm_qos_add_request(&audio_mvs_info.pm_qos_req,
+			   PM_QOS_CPU_DMA_LATENCY,
+			   PM_QOS_DEFAULT_VALUE);
 
 	rc = misc_register(&audio_mvs_misc);
 
@@ -27,6 +27,9 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/wakelock.h>
+#include <linux/pm_qos.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
 
 #include <linux/msm_audio_7X30.h>
 
@@ -42,9 +45,14 @@
 #include <mach/htc_pwrsink.h>
 #include <linux/rtc.h>
 
+#include "../pm.h"
+
 #define BUFSZ (960 * 5)
 #define DMASZ (BUFSZ * 2)
 
+/* Smallest period AUDIO_SET_CONFIG accepts: 5ms of 48kHz stereo */
+#define MIN_BUFSZ 960
+
 #define HOSTPCM_STREAM_ID 5
 
 struct buffer {
@@ -62,6 +70,8 @@ struct audio {
 	uint8_t out_head;
 	uint8_t out_tail;
 	uint8_t out_needed; /* number of buffers the dsp is waiting for */
+	uint8_t out_playing; /* buffer the dsp started at out_start */
+	ktime_t out_start;
 
 	atomic_t out_bytes;
 
@@ -86,10 +96,11 @@ struct audio {
 	int enabled;
 	int running;
 	int stopped; /* set when stopped, cleared on flush */
+	int mmap_held; /* out_head handed out by AUDIO_MMAP_NEXT_PERIOD */
 	uint16_t dec_id;
 
 	struct wake_lock wakelock;
-	struct wake_lock idlelock;
+	struct pm_qos_request pm_qos_req;
 
 	struct audpp_cmd_cfg_object_params_volume vol_pan;
 };
@@ -139,7 +150,7 @@ static void audio_prevent_sleep(struct audio *audio)
 	tm.tm_hour, tm.tm_min, tm.tm_sec, ts.tv_nsec);
 	MM_DBG("\n"); /* Macro prints the file name and function */
 	wake_lock(&audio->wakelock);
-	wake_lock(&audio->idlelock);
+	pm_qos_update_request(&audio->pm_qos_req, msm_pm_collapse_latency());
 }
 
 static void audio_allow_sleep(struct audio *audio)
@@ -147,7 +158,7 @@ static void audio_allow_sleep(struct audio *audio)
 	struct timespec ts;
 	struct rtc_time tm;
 	wake_unlock(&audio->wakelock);
-	wake_unlock(&audio->idlelock);
+	pm_qos_update_request(&audio->pm_qos_req, PM_QOS_DEFAULT_VALUE);
 	MM_DBG("\n"); /* Macro prints the file name and function */
 	getnstimeofday(&ts);
 	rtc_time_to_tm(ts.tv_sec, &tm);
@@ -239,6 +250,8 @@ static void audio_dsp_event(void *private, unsigned id, uint16_t *msg)
 		if (audio->running) {
 			atomic_add(audio->out[idx].used, &audio->out_bytes);
 			audio->out[idx].used = 0;
+			audio->out_playing = idx ^ 1;
+			audio->out_start = ktime_get();
 			frame = audio->out + audio->out_tail;
 			if (frame->used) {
 				/* Reset teos flag to avoid stale
@@ -299,6 +312,8 @@ static int audio_dsp_out_enable(struct audio *audio, int yes)
 	cmd.intf_type	= AUDPP_CMD_PCM_INTF_RX_ENA_ARMTODSP_V;
 
 	if (yes) {
+		audio->out_playing = 0;
+		audio->out_start = ktime_get();
 		cmd.write_buf1LSW	= audio->out[0].addr;
 		cmd.write_buf1MSW	= audio->out[0].addr >> 16;
 		if (audio->out[0].used)
@@ -340,6 +355,39 @@ static int audio_dsp_send_buffer(struct audio *audio, unsigned idx,
 }
 
 /* ------------------- device --------------------- */
+static unsigned audio_bytes_to_us(struct audio *audio, unsigned bytes)
+{
+	unsigned frame = audio->out_channel_mode == AUDPP_CMD_PCM_INTF_MONO_V ?
+		2 : 4;
+
+	if (!audio->out_sample_rate)
+		return 0;
+	return div_u64((u64)bytes * USEC_PER_SEC,
+		       audio->out_sample_rate * frame);
+}
+
+/* Time until a sample written now is played: everything queued ahead of
+ * it, less what the dsp has already played of its current buffer.
+ */
+static unsigned audio_presentation_delay(struct audio *audio)
+{
+	unsigned long flags;
+	unsigned queued, playing, elapsed = 0;
+
+	spin_lock_irqsave(&audio->dsp_lock, flags);
+	queued = audio_bytes_to_us(audio,
+			audio->out[0].used + audio->out[1].used);
+	if (audio->running && audio->out_needed < 2) {
+		playing = audio_bytes_to_us(audio,
+			audio->out[audio->out_playing].used);
+		elapsed = min_t(s64, ktime_us_delta(ktime_get(),
+				audio->out_start), playing);
+	}
+	spin_unlock_irqrestore(&audio->dsp_lock, flags);
+
+	return queued - elapsed;
+}
+
 static void audio_flush(struct audio *audio)
 {
 	audio->out[0].used = 0;
@@ -347,6 +395,79 @@ static void audio_flush(struct audio *audio)
 	audio->out_head = 0;
 	audio->out_tail = 0;
 	audio->stopped = 0;
+	audio->mmap_held = 0;
+}
+
+/* Pass the next filled buffer to the dsp if it is waiting for one */
+static void audio_queue_buffer(struct audio *audio)
+{
+	struct buffer *frame;
+	unsigned long flags;
+
+	spin_lock_irqsave(&audio->dsp_lock, flags);
+	frame = audio->out + audio->out_tail;
+	if (frame->used && audio->out_needed) {
+		/* Reset teos flag to avoid stale
+		 * PCMDMAMISS been considered
+		 */
+		audio->teos = 0;
+		if (audio->out_needed == 2) {
+			/* the dsp was starved and starts on this one */
+			audio->out_playing = audio->out_tail;
+			audio->out_start = ktime_get();
+		}
+		audio_dsp_send_buffer(audio, audio->out_tail,
+				frame->used);
+		audio->out_tail ^= 1;
+		audio->out_needed--;
+	}
+	spin_unlock_irqrestore(&audio->dsp_lock, flags);
+}
+
+/* Hand the application the next free buffer of the mmap()ed area to fill
+ * in place, after queueing the one it got from the previous call.
+ */
+static long audio_mmap_next_period(struct audio *audio, void __user *arg)
+{
+	struct msm_audio_mmap_period period;
+	struct buffer *frame;
+	long rc;
+
+	if (copy_from_user(&period, arg, sizeof(period)))
+		return -EFAULT;
+
+	mutex_lock(&audio->write_lock);
+	frame = audio->out + audio->out_head;
+	if (period.size) {
+		if (!audio->mmap_held || period.size > frame->size ||
+		    period.offset != (char *)frame->data - audio->data) {
+			rc = -EINVAL;
+			goto done;
+		}
+		frame->used = period.size;
+		audio->out_head ^= 1;
+		audio->mmap_held = 0;
+		audio_queue_buffer(audio);
+		frame = audio->out + audio->out_head;
+	}
+
+	rc = wait_event_interruptible(audio->wait,
+				      (frame->used == 0) || (audio->stopped));
+	if (rc < 0)
+		goto done;
+	if (audio->stopped) {
+		rc = -EBUSY;
+		goto done;
+	}
+
+	audio->mmap_held = 1;
+	period.offset = (char *)frame->data - audio->data;
+	period.size = frame->size;
+	if (copy_to_user(arg, &period, sizeof(period)))
+		rc = -EFAULT;
+done:
+	mutex_unlock(&audio->write_lock);
+	return rc;
 }
 
 static long audio_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
@@ -355,6 +476,16 @@ static long audio_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	int rc = -EINVAL;
 	unsigned long flags = 0;
 
+	if (cmd == AUDIO_MMAP_NEXT_PERIOD)
+		return audio_mmap_next_period(audio, (void __user *) arg);
+
+	if (cmd == AUDIO_GET_PRESENTATION_DELAY) {
+		unsigned delay = audio_presentation_delay(audio);
+		if (copy_to_user((void *) arg, &delay, sizeof(delay)))
+			return -EFAULT;
+		return 0;
+	}
+
 	if (cmd == AUDIO_GET_STATS) {
 		struct msm_audio_stats stats;
 		stats.byte_count = atomic_read(&audio->out_bytes);
@@ -418,6 +549,26 @@ static long audio_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			rc = -EINVAL;
 			break;
 		}
+		/* A smaller period lowers latency, at the cost of more
+		 * buffer-done wakeups. It can only change while idle.
+		 */
+		if (config.buffer_size &&
+				config.buffer_size != audio->out_buffer_size) {
+			if (config.buffer_size < MIN_BUFSZ ||
+					config.buffer_size > BUFSZ ||
+					(config.buffer_size & 3)) {
+				rc = -EINVAL;
+				break;
+			}
+			if (audio->enabled || audio->out[0].used ||
+					audio->out[1].used) {
+				rc = -EBUSY;
+				break;
+			}
+			audio->out_buffer_size = config.buffer_size;
+			audio->out[0].size = config.buffer_size;
+			audio->out[1].size = config.buffer_size;
+		}
 		audio->out_sample_rate = config.sample_rate;
 		audio->out_channel_mode = config.channel_count;
 		rc = 0;
@@ -425,7 +576,7 @@ static long audio_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	}
 	case AUDIO_GET_CONFIG: {
 		struct msm_audio_config config;
-		config.buffer_size = BUFSZ;
+		config.buffer_size = audio->out_buffer_size;
 		config.buffer_count = 2;
 		config.sample_rate = audio->out_sample_rate;
 		if (audio->out_channel_mode == AUDPP_CMD_PCM_INTF_MONO_V)
@@ -514,7 +665,6 @@ static ssize_t audio_write(struct file *file, const char __user *buf,
 {
 	struct sched_param s = { .sched_priority = 1 };
 	struct audio *audio = file->private_data;
-	unsigned long flags;
 	const char __user *start = buf;
 	struct buffer *frame;
 	size_t xfer;
@@ -536,6 +686,7 @@ static ssize_t audio_write(struct file *file, const char __user *buf,
 	}
 
 	mutex_lock(&audio->write_lock);
+	audio->mmap_held = 0;
 	while (count > 0) {
 		frame = audio->out + audio->out_head;
 
@@ -559,19 +710,7 @@ static ssize_t audio_write(struct file *file, const char __user *buf,
 		count -= xfer;
 		buf += xfer;
 
-		spin_lock_irqsave(&audio->dsp_lock, flags);
-		frame = audio->out + audio->out_tail;
-		if (frame->used && audio->out_needed) {
-			/* Reset teos flag to avoid stale
-			 * PCMDMAMISS been considered
-			 */
-			audio->teos = 0;
-			audio_dsp_send_buffer(audio, audio->out_tail,
-					frame->used);
-			audio->out_tail ^= 1;
-			audio->out_needed--;
-		}
-		spin_unlock_irqrestore(&audio->dsp_lock, flags);
+		audio_queue_buffer(audio);
 	}
 
 	mutex_unlock(&audio->write_lock);
@@ -595,6 +734,13 @@ static ssize_t audio_write(struct file *file, const char __user *buf,
 	return rc;
 }
 
+static int audio_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct audio *audio = file->private_data;
+
+	return dma_mmap_coherent(NULL, vma, audio->data, audio->phys, DMASZ);
+}
+
 static int audio_release(struct inode *inode, struct file *file)
 {
 	struct audio *audio = file->private_data;
@@ -684,6 +830,7 @@ static const struct file_operations audio_fops = {
 	.release	= audio_release,
 	.read		= audio_read,
 	.write		= audio_write,
+	.mmap		= audio_mmap,
 	.unlocked_ioctl	= audio_ioctl,
 	.fsync		= audio_fsync,
 };
@@ -701,7 +848,8 @@ static int __init audio_init(void)
 	spin_lock_init(&the_audio.dsp_lock);
 	init_waitqueue_head(&the_audio.wait);
 	wake_lock_init(&the_audio.wakelock, WAKE_LOCK_SUSPEND, "audio_pcm");
-	wake_lock_init(&the_audio.idlelock, WAKE_LOCK_IDLE, "audio_pcm_idle");
+	pm_qos_add_request(&the_audio.pm_qos_req, PM_QOS_CPU_DMA_LATENCY,
+			   PM_QOS_DEFAULT_VALUE);
 	return misc_register(&audio_misc);
 }
 
@@ -108,6 +108,8 @@ struct audio_in {
 	int running;
 	int stopped; /* set when stopped, cleared on flush */
 	int abort; /* set when error, like sample rate mismatch */
+	int mmap_held; /* in[mmap_index] handed out by AUDIO_MMAP_NEXT_PERIOD */
+	uint32_t mmap_index;
 };
 
 static struct audio_in the_audio_in;
@@ -510,6 +512,7 @@ static void audpcm_in_flush(struct audio_in *audio)
 	audio->in_head = 0;
 	audio->in_tail = 0;
 	audio->in_count = 0;
+	audio->mmap_held = 0;
 	for (i = 0; i < FRAME_NUM; i++) {
 		audio->in[i].size = 0;
 		audio->in[i].read = 0;
@@ -520,6 +523,83 @@ static void audpcm_in_flush(struct audio_in *audio)
 	atomic_set(&audio->in_samples, 0);
 }
 
+static int audpcm_in_period_ready(struct audio_in *audio)
+{
+#ifdef CONFIG_2WCR
+	if (audio->in_call && audio->running &&
+	    audio->voice_state == VOICE_STATE_OFFCALL)
+		return 1;
+#endif
+	return audio->in_count > 0 || audio->stopped || audio->abort;
+}
+
+/* Release the period the application got from the previous call, then
+ * hand it the next filled one to read in place from the mmap()ed area.
+ * A released period the dsp has already overrun is simply dropped.
+ */
+static long audpcm_in_mmap_next_period(struct audio_in *audio,
+				       void __user *arg)
+{
+	struct msm_audio_mmap_period period;
+	unsigned long flags;
+	uint32_t index;
+	long rc;
+
+	if (copy_from_user(&period, arg, sizeof(period)))
+		return -EFAULT;
+
+	mutex_lock(&audio->read_lock);
+	if (period.size) {
+		if (!audio->mmap_held) {
+			rc = -EINVAL;
+			goto done;
+		}
+		spin_lock_irqsave(&audio->dsp_lock, flags);
+		if (audio->mmap_index == audio->in_tail) {
+			audio->in[audio->in_tail].size = 0;
+			audio->in_tail = (audio->in_tail + 1) & (FRAME_NUM - 1);
+			audio->in_count--;
+		}
+		spin_unlock_irqrestore(&audio->dsp_lock, flags);
+		audio->mmap_held = 0;
+	}
+
+	rc = wait_event_interruptible(audio->wait,
+				      audpcm_in_period_ready(audio));
+	if (rc < 0)
+		goto done;
+	if (audio->abort) {
+		rc = -EPERM;
+		goto done;
+	}
+
+	spin_lock_irqsave(&audio->dsp_lock, flags);
+	if (!audio->in_count) {
+		/* stopped: end of stream is a period of size 0 */
+		period.offset = 0;
+		period.size = 0;
+	} else {
+		index = audio->in_tail;
+		audio->mmap_index = index;
+		audio->mmap_held = 1;
+		period.offset = (char *)audio->in[index].data - audio->data;
+		period.size = audio->in[index].size;
+	}
+	spin_unlock_irqrestore(&audio->dsp_lock, flags);
+
+#ifdef CONFIG_2WCR
+	if (!period.size && !audio->stopped) {
+		rc = -EPERM; /* Voice Call stopped */
+		goto done;
+	}
+#endif
+	if (copy_to_user(arg, &period, sizeof(period)))
+		rc = -EFAULT;
+done:
+	mutex_unlock(&audio->read_lock);
+	return rc;
+}
+
 /* ------------------- device --------------------- */
 static long audpcm_in_ioctl(struct file *file,
 				unsigned int cmd, unsigned long arg)
@@ -527,6 +607,9 @@ static long audpcm_in_ioctl(struct file *file,
 	struct audio_in *audio = file->private_data;
 	int rc = 0;
 
+	if (cmd == AUDIO_MMAP_NEXT_PERIOD)
+		return audpcm_in_mmap_next_period(audio, (void __user *) arg);
+
 	if (cmd == AUDIO_GET_STATS) {
 		struct msm_audio_stats stats;
 		stats.byte_count = atomic_read(&audio->in_bytes);
@@ -716,6 +799,7 @@ static ssize_t audpcm_in_read(struct file *file,
 	int rc = 0;
 
 	mutex_lock(&audio->read_lock);
+	audio->mmap_held = 0;
 	while (count > 0) {
 		rc = wait_event_interruptible(
 			audio->wait, (audio->in_count > 0) || audio->stopped ||
@@ -789,6 +873,13 @@ static ssize_t audpcm_in_read(struct file *file,
 	return rc;
 }
 
+static int audpcm_in_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct audio_in *audio = file->private_data;
+
+	return dma_mmap_coherent(NULL, vma, audio->data, audio->phys, DMASZ);
+}
+
 static ssize_t audpcm_in_write(struct file *file,
 				const char __user *buf,
 				size_t count, loff_t *pos)
@@ -926,6 +1017,7 @@ static const struct file_operations audio_in_fops = {
 	.release	= audpcm_in_release,
 	.read		= audpcm_in_read,
 	.write		= audpcm_in_write,
+	.mmap		= audpcm_in_mmap,
 	.unlocked_ioctl	= audpcm_in_ioctl,
 };
 
@@ -69,13 +69,15 @@
 #include <mach/qdsp5v2_1x/lpa.h>
 #include <mach/vreg.h>
 #include <mach/debug_audio_mm.h>
-#include <linux/wakelock.h>
+#include <linux/pm_qos.h>
 #include <linux/slab.h>
 #include <mach/qdsp5v2_1x/audio_acdb_def.h>
 
 #include <mach/qdsp5v2_1x/marimba_profile.h>
 #include <asm/mach-types.h>
 
+#include "../pm.h"
+
 #define SNDDEV_ICODEC_PCM_SZ 32 /* 16 bit / sample stereo mode */
 #define SNDDEV_ICODEC_MUL_FACTOR 3 /* Multi by 8 Shift by 3  */
 #define SNDDEV_ICODEC_CLK_RATE(freq) \
@@ -267,6 +269,7 @@ struct snddev_icodec_drv_state {
 	struct mutex tx_lock;
 	u32 rx_active; /* ensure one rx device at a time */
 	u32 tx_active; /* ensure one tx device at a time */
+	struct snddev_icodec_state *rx_owner; /* device driving the rx path */
 	struct clk *rx_mclk;
 	struct clk *rx_sclk;
 	struct clk *tx_mclk;
@@ -276,8 +279,9 @@ struct snddev_icodec_drv_state {
 	struct clk *lpa_p_clk;
 	struct lpa_drv *lpa;
 
-	struct wake_lock rx_idlelock;
-	struct wake_lock tx_idlelock;
+	/* keep idle out of power collapse while a path is open */
+	struct pm_qos_request rx_pm_qos_req;
+	struct pm_qos_request tx_pm_qos_req;
 };
 
 static struct snddev_icodec_drv_state snddev_icodec_drv;
@@ -289,7 +293,8 @@ static int snddev_icodec_open_rx(struct snddev_icodec_state *icodec)
 	struct snddev_icodec_drv_state *drv = &snddev_icodec_drv;
 	struct lpa_codec_config lpa_config;
 
-	wake_lock(&drv->rx_idlelock);
+	pm_qos_update_request(&drv->rx_pm_qos_req,
+			      msm_pm_collapse_latency());
 
 	/* enable MI2S RX master block */
 	/* enable MI2S RX bit clock */
@@ -365,7 +370,8 @@ static int snddev_icodec_open_rx(struct snddev_icodec_state *icodec)
 
 	icodec->enabled = 1;
 
-	wake_unlock(&drv->rx_idlelock);
+	pm_qos_update_request(&drv->rx_pm_qos_req,
+			      PM_QOS_DEFAULT_VALUE);
 	return 0;
 
 error_afe:
@@ -386,7 +392,8 @@ error_invalid_freq:
 
 	pr_aud_err("%s: encounter error\n", __func__);
 
-	wake_unlock(&drv->rx_idlelock);
+	pm_qos_update_request(&drv->rx_pm_qos_req,
+			      PM_QOS_DEFAULT_VALUE);
 	return -ENODEV;
 }
 
@@ -396,7 +403,8 @@ static int snddev_icodec_open_tx(struct snddev_icodec_state *icodec)
 	struct msm_afe_config afe_config;
 	struct snddev_icodec_drv_state *drv = &snddev_icodec_drv;
 
-	wake_lock(&drv->tx_idlelock);
+	pm_qos_update_request(&drv->tx_pm_qos_req,
+			      msm_pm_collapse_latency());
 
 	/* Reuse pamp_on for TX platform-specific setup  */
 	if (icodec->data->pamp_on)
@@ -442,7 +450,8 @@ static int snddev_icodec_open_tx(struct snddev_icodec_state *icodec)
 
 	icodec->enabled = 1;
 
-	wake_unlock(&drv->tx_idlelock);
+	pm_qos_update_request(&drv->tx_pm_qos_req,
+			      PM_QOS_DEFAULT_VALUE);
 	return 0;
 
 error_afe:
@@ -458,15 +467,108 @@ error_invalid_freq:
 
 	pr_aud_err("%s: encounter error\n", __func__);
 
-	wake_unlock(&drv->tx_idlelock);
+	pm_qos_update_request(&drv->tx_pm_qos_req,
+			      PM_QOS_DEFAULT_VALUE);
 	return -ENODEV;
 }
 
+static int snddev_icodec_rx_uses_adie(struct snddev_icodec_state *icodec)
+{
+	return !support_aic3254 ||
+		!strcmp(icodec->data->name, "usb_headset_stereo_rx");
+}
+
+static int snddev_icodec_rx_adie_on(struct snddev_icodec_state *icodec)
+{
+	int trc;
+
+	trc = adie_codec_open(icodec->data->profile, &icodec->adie_path);
+	if (IS_ERR_VALUE(trc))
+		return trc;
+	adie_codec_setpath(icodec->adie_path, icodec->sample_rate, 256);
+
+	if (adie_codec_proceed_stage(icodec->adie_path,
+				ADIE_CODEC_DIGITAL_READY) ||
+	    adie_codec_proceed_stage(icodec->adie_path,
+				ADIE_CODEC_DIGITAL_ANALOG_READY)) {
+		adie_codec_close(icodec->adie_path);
+		icodec->adie_path = NULL;
+		return -ENODEV;
+	}
+	return 0;
+}
+
+static void snddev_icodec_rx_adie_off(struct snddev_icodec_state *icodec)
+{
+	adie_codec_proceed_stage(icodec->adie_path, ADIE_CODEC_DIGITAL_OFF);
+	adie_codec_close(icodec->adie_path);
+	icodec->adie_path = NULL;
+}
+
+/* The MI2S clock, LPA and AFE setup only depend on rate and channels */
+static int snddev_icodec_can_switch_rx(struct snddev_icodec_state *icodec)
+{
+	struct snddev_icodec_state *owner = snddev_icodec_drv.rx_owner;
+
+	return owner && owner != icodec &&
+		owner->sample_rate == icodec->sample_rate &&
+		owner->data->channel_mode == icodec->data->channel_mode;
+}
+
+/*
+ * Hand the running rx path over to another device. Only the ADIE
+ * profile and the amplifiers change; the clocks, LPA and AFE keep
+ * running, so the stream is not stopped and no AFE acknowledgement
+ * has to be waited for. The displaced device is left closed.
+ */
+static int snddev_icodec_switch_rx(struct snddev_icodec_state *icodec)
+{
+	struct snddev_icodec_drv_state *drv = &snddev_icodec_drv;
+	struct snddev_icodec_state *old = drv->rx_owner;
+	int trc = 0;
+
+	pm_qos_update_request(&drv->rx_pm_qos_req,
+			      msm_pm_collapse_latency());
+
+	if (old->data->pamp_on)
+		old->data->pamp_on(0);
+
+	/* The codec takes a single rx profile at a time */
+	if (snddev_icodec_rx_uses_adie(old))
+		snddev_icodec_rx_adie_off(old);
+
+	if (snddev_icodec_rx_uses_adie(icodec)) {
+		trc = snddev_icodec_rx_adie_on(icodec);
+		if (IS_ERR_VALUE(trc)) {
+			pr_aud_err("%s: %s failed, restoring %s\n", __func__,
+				icodec->data->name, old->data->name);
+			if (snddev_icodec_rx_uses_adie(old))
+				snddev_icodec_rx_adie_on(old);
+			if (old->data->pamp_on)
+				old->data->pamp_on(1);
+			pm_qos_update_request(&drv->rx_pm_qos_req,
+					      PM_QOS_DEFAULT_VALUE);
+			return -ENODEV;
+		}
+	}
+
+	if (icodec->data->pamp_on)
+		icodec->data->pamp_on(1);
+
+	old->enabled = 0;
+	icodec->enabled = 1;
+
+	pm_qos_update_request(&drv->rx_pm_qos_req,
+			      PM_QOS_DEFAULT_VALUE);
+	return 0;
+}
+
 static int snddev_icodec_close_rx(struct snddev_icodec_state *icodec)
 {
 	struct snddev_icodec_drv_state *drv = &snddev_icodec_drv;
 
-	wake_lock(&drv->rx_idlelock);
+	pm_qos_update_request(&drv->rx_pm_qos_req,
+			      msm_pm_collapse_latency());
 
 	/* Disable power amplifier */
 	if (icodec->data->pamp_on)
@@ -498,7 +600,8 @@ static int snddev_icodec_close_rx(struct snddev_icodec_state *icodec)
 	clk_disable(drv->rx_mclk);
 	icodec->enabled = 0;
 
-	wake_unlock(&drv->rx_idlelock);
+	pm_qos_update_request(&drv->rx_pm_qos_req,
+			      PM_QOS_DEFAULT_VALUE);
 	return 0;
 }
 
@@ -506,7 +609,8 @@ static int snddev_icodec_close_tx(struct snddev_icodec_state *icodec)
 {
 	struct snddev_icodec_drv_state *drv = &snddev_icodec_drv;
 
-	wake_lock(&drv->tx_idlelock);
+	pm_qos_update_request(&drv->tx_pm_qos_req,
+			      msm_pm_collapse_latency());
 
 	afe_disable(AFE_HW_PATH_CODEC_TX);
 
@@ -526,7 +630,8 @@ static int snddev_icodec_close_tx(struct snddev_icodec_state *icodec)
 
 	icodec->enabled = 0;
 
-	wake_unlock(&drv->tx_idlelock);
+	pm_qos_update_request(&drv->tx_pm_qos_req,
+			      PM_QOS_DEFAULT_VALUE);
 	return 0;
 }
 
@@ -590,15 +695,19 @@ static int snddev_icodec_open(struct msm_snddev_info *dev_info)
 
 	if (icodec->data->capability & SNDDEV_CAP_RX) {
 		mutex_lock(&drv->rx_lock);
-		if (drv->rx_active) {
+		if (drv->rx_active && !snddev_icodec_can_switch_rx(icodec)) {
 			mutex_unlock(&drv->rx_lock);
 			rc = -EBUSY;
 			goto error;
 		}
-		rc = snddev_icodec_open_rx(icodec);
+		if (drv->rx_active)
+			rc = snddev_icodec_switch_rx(icodec);
+		else
+			rc = snddev_icodec_open_rx(icodec);
 
 		if (!IS_ERR_VALUE(rc)) {
 			drv->rx_active = 1;
+			drv->rx_owner = icodec;
 			if ((icodec->data->dev_vol_type & (
 				SNDDEV_DEV_VOL_DIGITAL |
 				SNDDEV_DEV_VOL_ANALOG)))
@@ -652,14 +761,21 @@ static int snddev_icodec_close(struct msm_snddev_info *dev_info)
 
 	if (icodec->data->capability & SNDDEV_CAP_RX) {
 		mutex_lock(&drv->rx_lock);
+		if (drv->rx_owner != icodec) {
+			/* The path was handed over to another device */
+			mutex_unlock(&drv->rx_lock);
+			goto error;
+		}
 		if (!drv->rx_active) {
 			mutex_unlock(&drv->rx_lock);
 			rc = -EPERM;
 			goto error;
 		}
 		rc = snddev_icodec_close_rx(icodec);
-		if (!IS_ERR_VALUE(rc))
+		if (!IS_ERR_VALUE(rc)) {
 			drv->rx_active = 0;
+			drv->rx_owner = NULL;
+		}
 		mutex_unlock(&drv->rx_lock);
 	} else {
 		mutex_lock(&drv->tx_lock);
@@ -1134,10 +1250,10 @@ static int __init snddev_icodec_init(void)
 	icodec_drv->rx_active = 0;
 	icodec_drv->tx_active = 0;
 	icodec_drv->lpa = NULL;
-	wake_lock_init(&icodec_drv->tx_idlelock, WAKE_LOCK_IDLE,
-			"snddev_tx_idle");
-	wake_lock_init(&icodec_drv->rx_idlelock, WAKE_LOCK_IDLE,
-			"snddev_rx_idle");
+	pm_qos_add_request(&icodec_drv->tx_pm_qos_req, PM_QOS_CPU_DMA_LATENCY,
+			   PM_QOS_DEFAULT_VALUE);
+	pm_qos_add_request(&icodec_drv->rx_pm_qos_req, PM_QOS_CPU_DMA_LATENCY,
+			   PM_QOS_DEFAULT_VALUE);
 	return 0;
 
 error_lpa_p_clk:
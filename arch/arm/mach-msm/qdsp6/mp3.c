@@ -175,7 +175,7 @@ static ssize_t mp3_write(struct file *file, const char __user *buf,
 
 		ab->used = xfer;
 		q6audio_write(ac, ab);
-		ac->cpu_buf ^= 1;
+		ac->cpu_buf = q6audio_next_buf(ac, ac->cpu_buf);
 	}
 
 	return buf - start;
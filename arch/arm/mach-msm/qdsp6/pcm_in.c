@@ -177,7 +177,7 @@ static ssize_t q6_in_read(struct file *file, char __user *buf,
 
 		ab->used = 1;
 		q6audio_read(ac, ab);
-		ac->cpu_buf ^= 1;
+		ac->cpu_buf = q6audio_next_buf(ac, ac->cpu_buf);
 	}
 fail:
 	res = buf - start;
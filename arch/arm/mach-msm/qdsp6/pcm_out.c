@@ -14,7 +14,9 @@
  *
  */
 
+#include <linux/dma-mapping.h>
 #include <linux/fs.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/miscdevice.h>
 #include <linux/mutex.h>
@@ -33,12 +35,68 @@ void audio_client_dump(struct audio_client *ac);
 
 struct pcm {
 	struct mutex lock;
+	struct mutex write_lock;
 	struct audio_client *ac;
 	uint32_t sample_rate;
 	uint32_t channel_count;
 	size_t buffer_size;
+	uint32_t buffer_count;
+	int mmap_held; /* cpu_buf handed out by AUDIO_MMAP_NEXT_PERIOD */
 };
 
+static void pcm_wait_buffer(struct audio_client *ac, struct audio_buffer *ab)
+{
+	if (ab->used)
+		if (!wait_event_timeout(ac->wait, (ab->used == 0), 5*HZ)) {
+			audio_client_dump(ac);
+			pr_err("pcm_write: timeout. dsp dead?\n");
+			q6audio_dsp_not_responding();
+		}
+}
+
+/* Hand the application the next free buffer of the mmap()ed ring to fill
+ * in place, after queueing the one it got from the previous call. The DSP
+ * is given the buffer's physical address, so nothing is copied.
+ */
+static long pcm_mmap_next_period(struct pcm *pcm, void __user *arg)
+{
+	struct msm_audio_mmap_period period;
+	struct audio_client *ac = pcm->ac;
+	struct audio_buffer *ab;
+	long rc = 0;
+
+	if (!ac)
+		return -ENODEV;
+	if (copy_from_user(&period, arg, sizeof(period)))
+		return -EFAULT;
+
+	mutex_lock(&pcm->write_lock);
+	ab = ac->buf + ac->cpu_buf;
+	if (period.size) {
+		if (!pcm->mmap_held || period.size > ab->size ||
+		    period.offset != (char *)ab->data - (char *)ac->buf[0].data) {
+			rc = -EINVAL;
+			goto done;
+		}
+		ab->used = period.size;
+		q6audio_write(ac, ab);
+		ac->cpu_buf = q6audio_next_buf(ac, ac->cpu_buf);
+		pcm->mmap_held = 0;
+		ab = ac->buf + ac->cpu_buf;
+	}
+
+	pcm_wait_buffer(ac, ab);
+
+	pcm->mmap_held = 1;
+	period.offset = (char *)ab->data - (char *)ac->buf[0].data;
+	period.size = ab->size;
+	if (copy_to_user(arg, &period, sizeof(period)))
+		rc = -EFAULT;
+done:
+	mutex_unlock(&pcm->write_lock);
+	return rc;
+}
+
 static long pcm_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct pcm *pcm = file->private_data;
@@ -52,6 +110,9 @@ static long pcm_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		return 0;
 	}
 
+	if (cmd == AUDIO_MMAP_NEXT_PERIOD)
+		return pcm_mmap_next_period(pcm, (void __user *) arg);
+
 	mutex_lock(&pcm->lock);
 	switch (cmd) {
 	case AUDIO_SET_VOLUME: {
@@ -81,9 +142,11 @@ static long pcm_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		if (pcm->ac) {
 			rc = -EBUSY;
 		} else {
-			pcm->ac = q6audio_open_pcm(pcm->buffer_size, pcm->sample_rate,
-						   pcm->channel_count,
-						   AUDIO_FLAG_WRITE, acdb_id);
+			pcm->ac = q6audio_open_pcm_ring(pcm->buffer_size,
+							pcm->buffer_count,
+							pcm->sample_rate,
+							pcm->channel_count,
+							AUDIO_FLAG_WRITE, acdb_id);
 			if (!pcm->ac)
 				rc = -ENOMEM;
 		}
@@ -115,15 +178,22 @@ static long pcm_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			rc = -EINVAL;
 			break;
 		}
+		/* more, smaller buffers keep the DSP fed at lower latency */
+		if (config.buffer_count < 2 ||
+		    config.buffer_count > Q6_MAX_BUFFERS) {
+			rc = -EINVAL;
+			break;
+		}
 		pcm->sample_rate = config.sample_rate;
 		pcm->channel_count = config.channel_count;
 		pcm->buffer_size = config.buffer_size;
+		pcm->buffer_count = config.buffer_count;
 		break;
 	}
 	case AUDIO_GET_CONFIG: {
 		struct msm_audio_config config;
 		config.buffer_size = pcm->buffer_size;
-		config.buffer_count = 2;
+		config.buffer_count = pcm->buffer_count;
 		config.sample_rate = pcm->sample_rate;
 		config.channel_count = pcm->channel_count;
 		config.unused[0] = 0;
@@ -152,9 +222,11 @@ static int pcm_open(struct inode *inode, struct file *file)
 		return -ENOMEM;
 
 	mutex_init(&pcm->lock);
+	mutex_init(&pcm->write_lock);
 	pcm->channel_count = 2;
 	pcm->sample_rate = 44100;
 	pcm->buffer_size = BUFSZ;
+	pcm->buffer_count = 2;
 
 	file->private_data = pcm;
 	return 0;
@@ -176,34 +248,55 @@ static ssize_t pcm_write(struct file *file, const char __user *buf,
 	if (!ac)
 		return -ENODEV;
 
+	mutex_lock(&pcm->write_lock);
+	/* a write takes back a buffer held through the mapping */
+	pcm->mmap_held = 0;
 	while (count > 0) {
 		ab = ac->buf + ac->cpu_buf;
 
-		if (ab->used)
-			if (!wait_event_timeout(ac->wait, (ab->used == 0), 5*HZ)) {
-				audio_client_dump(ac);
-				pr_err("pcm_write: timeout. dsp dead?\n");
-				q6audio_dsp_not_responding();
-			}
+		pcm_wait_buffer(ac, ab);
 
 		xfer = count;
 		if (xfer > ab->size)
 			xfer = ab->size;
 
-		if (copy_from_user(ab->data, buf, xfer)) 
+		if (copy_from_user(ab->data, buf, xfer)) {
+			mutex_unlock(&pcm->write_lock);
 			return -EFAULT;
+		}
 
 		buf += xfer;
 		count -= xfer;
 
 		ab->used = xfer;
 		q6audio_write(ac, ab);
-		ac->cpu_buf ^= 1;
+		ac->cpu_buf = q6audio_next_buf(ac, ac->cpu_buf);
 	}
+	mutex_unlock(&pcm->write_lock);
 
 	return buf - start;
 }
 
+/* Map the whole buffer ring; only possible once AUDIO_START allocated it */
+static int pcm_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct pcm *pcm = file->private_data;
+	struct audio_client *ac;
+	int rc;
+
+	mutex_lock(&pcm->lock);
+	ac = pcm->ac;
+	if (!ac || vma->vm_pgoff) {
+		rc = -EINVAL;
+		goto done;
+	}
+	rc = dma_mmap_coherent(NULL, vma, ac->buf[0].data, ac->buf[0].phys,
+			       ac->buf_total);
+done:
+	mutex_unlock(&pcm->lock);
+	return rc;
+}
+
 static int pcm_release(struct inode *inode, struct file *file)
 {
 	struct pcm *pcm = file->private_data;
@@ -218,6 +311,7 @@ static struct file_operations pcm_fops = {
 	.owner		= THIS_MODULE,
 	.open		= pcm_open,
 	.write		= pcm_write,
+	.mmap		= pcm_mmap,
 	.release	= pcm_release,
 	.unlocked_ioctl	= pcm_ioctl,
 };
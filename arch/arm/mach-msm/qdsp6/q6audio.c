@@ -278,18 +278,19 @@ static void audio_client_free(struct audio_client *ac)
 	session_free(ac->session, ac);
 
 	if (ac->buf[0].data)
-		dma_free_coherent(NULL, ac->buf[0].size,
+		dma_free_coherent(NULL, ac->buf_total,
 				  ac->buf[0].data, ac->buf[0].phys);
-	if (ac->buf[1].data)
-		dma_free_coherent(NULL, ac->buf[1].size,
-				  ac->buf[1].data, ac->buf[1].phys);
 	kfree(ac);
 }
 
-static struct audio_client *audio_client_alloc(unsigned bufsz)
+static struct audio_client *audio_client_alloc(unsigned bufsz, unsigned bufcnt)
 {
 	struct audio_client *ac;
-	int n;
+	unsigned stride;
+	int n, i;
+
+	if (bufcnt > Q6_MAX_BUFFERS)
+		return 0;
 
 	ac = kzalloc(sizeof(*ac), GFP_KERNEL);
 	if (!ac)
@@ -300,18 +301,21 @@ static struct audio_client *audio_client_alloc(unsigned bufsz)
 		goto fail_session;
 	ac->session = n;
 
-	if (bufsz > 0) {
-		ac->buf[0].data = dma_alloc_coherent(NULL, bufsz,
+	if (bufsz > 0 && bufcnt > 0) {
+		/* keep every buffer cache line aligned for the DSP */
+		stride = L1_CACHE_ALIGN(bufsz);
+		ac->buf_total = stride * bufcnt;
+		ac->buf[0].data = dma_alloc_coherent(NULL, ac->buf_total,
 						&ac->buf[0].phys, GFP_KERNEL);
 		if (!ac->buf[0].data)
 			goto fail;
-		ac->buf[1].data = dma_alloc_coherent(NULL, bufsz,
-						&ac->buf[1].phys, GFP_KERNEL);
-		if (!ac->buf[1].data)
-			goto fail;
 
-		ac->buf[0].size = bufsz;
-		ac->buf[1].size = bufsz;
+		for (i = 0; i < bufcnt; i++) {
+			ac->buf[i].data = ac->buf[0].data + i * stride;
+			ac->buf[i].phys = ac->buf[0].phys + i * stride;
+			ac->buf[i].size = bufsz;
+		}
+		ac->buf_count = bufcnt;
 	}
 
 	init_waitqueue_head(&ac->wait);
@@ -614,7 +618,7 @@ static void callback(void *data, int len, void *cookie)
 		if (e->status)
 			pr_err("buffer status %d\n", e->status);
 		ac->buf[ac->dsp_buf].used = 0;
-		ac->dsp_buf ^= 1;
+		ac->dsp_buf = q6audio_next_buf(ac, ac->dsp_buf);
 		wake_up(&ac->wait);
 		return;
 	}
@@ -671,7 +675,7 @@ static int q6audio_init(void)
 	audio_init(adsp);
 	dal_trace(adsp);
 
-	ac = audio_client_alloc(0);
+	ac = audio_client_alloc(0, 0);
 	if (!ac) {
 		pr_err("audio_init: cannot allocate client\n");
 		res = -ENOMEM;
@@ -1403,16 +1407,18 @@ done:
 	return 0;
 }
 
-struct audio_client *q6audio_open_pcm(uint32_t bufsz, uint32_t rate,
-				      uint32_t channels, uint32_t flags, uint32_t acdb_id)
+struct audio_client *q6audio_open_pcm_ring(uint32_t bufsz, uint32_t bufcnt,
+					   uint32_t rate, uint32_t channels,
+					   uint32_t flags, uint32_t acdb_id)
 {
 	int rc, retry = 5;
 	struct audio_client *ac;
+	int i;
 
 	if (q6audio_init())
 		return 0;
 
-	ac = audio_client_alloc(bufsz);
+	ac = audio_client_alloc(bufsz, bufcnt);
 	if (!ac)
 		return 0;
 
@@ -1477,10 +1483,10 @@ struct audio_client *q6audio_open_pcm(uint32_t bufsz, uint32_t rate,
 	}
 
 	if (!(ac->flags & AUDIO_FLAG_WRITE)) {
-		ac->buf[0].used = 1;
-		ac->buf[1].used = 1;
-		q6audio_read(ac, &ac->buf[0]);
-		q6audio_read(ac, &ac->buf[1]);
+		for (i = 0; i < ac->buf_count; i++) {
+			ac->buf[i].used = 1;
+			q6audio_read(ac, &ac->buf[i]);
+		}
 	}
 
 	audio_prevent_sleep();
@@ -1507,7 +1513,7 @@ struct audio_client *q6voice_open(uint32_t flags, uint32_t acdb_id)
 	if (q6audio_init())
 		return 0;
 
-	ac = audio_client_alloc(0);
+	ac = audio_client_alloc(0, 0);
 	if (!ac)
 		return 0;
 
@@ -1543,7 +1549,7 @@ struct audio_client *q6audio_open_mp3(uint32_t bufsz, uint32_t rate,
 	if (q6audio_init())
 		return 0;
 
-	ac = audio_client_alloc(bufsz);
+	ac = audio_client_alloc(bufsz, 2);
 	if (!ac)
 		return 0;
 
@@ -11,8 +11,13 @@
  *
  */
 
+#include <linux/debugfs.h>
 #include <linux/err.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
 #include <linux/string.h>
 #include <linux/delay.h>
 
@@ -26,6 +31,201 @@
 
 static void remote_spin_release_all_locks(uint32_t pid, int count);
 
+#ifdef CONFIG_MSM_REMOTE_SPINLOCK_STATS
+/* Spin times in power of two microsecond buckets, the last open ended */
+#define REMOTE_SPIN_HIST_BUCKETS	16
+#define REMOTE_SPIN_STATS_LOCKS		16
+
+struct remote_spin_stats {
+	raw_remote_spinlock_t *lock;
+	char name[24];
+	unsigned long acquired;
+	unsigned long contended;
+	u64 spin_ns;
+	u64 max_ns;
+	unsigned int hist[REMOTE_SPIN_HIST_BUCKETS];
+};
+
+/* Entries are only added, and updated with their remote lock held */
+static struct remote_spin_stats remote_spin_stats[REMOTE_SPIN_STATS_LOCKS];
+static int remote_spin_stats_count;
+static DEFINE_SPINLOCK(remote_spin_stats_lock);
+
+static struct remote_spin_stats *remote_spin_find_stats(
+		raw_remote_spinlock_t *lock)
+{
+	int i, count = remote_spin_stats_count;
+
+	smp_rmb();
+	for (i = 0; i < count; i++)
+		if (remote_spin_stats[i].lock == lock)
+			return &remote_spin_stats[i];
+	return NULL;
+}
+
+static void remote_spin_add_stats(remote_spinlock_id_t id,
+				  raw_remote_spinlock_t *lock)
+{
+	struct remote_spin_stats *stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&remote_spin_stats_lock, flags);
+	if (remote_spin_find_stats(lock) ||
+	    remote_spin_stats_count == REMOTE_SPIN_STATS_LOCKS)
+		goto out;
+
+	stats = &remote_spin_stats[remote_spin_stats_count];
+	stats->lock = lock;
+	strlcpy(stats->name, id, sizeof(stats->name));
+	smp_wmb();
+	remote_spin_stats_count++;
+out:
+	spin_unlock_irqrestore(&remote_spin_stats_lock, flags);
+}
+
+void _remote_spin_lock_acquired(_remote_spinlock_t *lock)
+{
+	struct remote_spin_stats *stats = remote_spin_find_stats(*lock);
+
+	if (stats)
+		stats->acquired++;
+}
+EXPORT_SYMBOL(_remote_spin_lock_acquired);
+
+static void remote_spin_record(raw_remote_spinlock_t *lock,
+			       unsigned long long start)
+{
+	struct remote_spin_stats *stats = remote_spin_find_stats(lock);
+	u64 ns = sched_clock() - start;
+	unsigned int us;
+
+	if (!stats)
+		return;
+
+	us = ns >> 32 ? UINT_MAX : (u32)ns / NSEC_PER_USEC;
+	stats->acquired++;
+	stats->contended++;
+	stats->spin_ns += ns;
+	if (ns > stats->max_ns)
+		stats->max_ns = ns;
+	stats->hist[min_t(int, fls(us), REMOTE_SPIN_HIST_BUCKETS - 1)]++;
+}
+
+static int remote_spin_stats_show(struct seq_file *m, void *unused)
+{
+	struct remote_spin_stats snap;
+	int i, j, count = remote_spin_stats_count;
+
+	smp_rmb();
+	for (i = 0; i < count; i++) {
+		snap = remote_spin_stats[i];
+
+		seq_printf(m, "%s: acquired %lu contended %lu "
+			   "spin %llu us max %llu us\n", snap.name,
+			   snap.acquired, snap.contended,
+			   div_u64(snap.spin_ns, NSEC_PER_USEC),
+			   div_u64(snap.max_ns, NSEC_PER_USEC));
+		seq_printf(m, "  %8s us  %u\n", "< 1", snap.hist[0]);
+		for (j = 1; j < REMOTE_SPIN_HIST_BUCKETS; j++)
+			if (snap.hist[j])
+				seq_printf(m, "  %8u us+ %u\n", 1U << (j - 1),
+					   snap.hist[j]);
+	}
+	return 0;
+}
+
+static int remote_spin_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, remote_spin_stats_show, NULL);
+}
+
+static ssize_t remote_spin_stats_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	int i, n = remote_spin_stats_count;
+
+	/* racing with a lock holder at worst keeps one stale sample */
+	smp_rmb();
+	for (i = 0; i < n; i++) {
+		struct remote_spin_stats *stats = &remote_spin_stats[i];
+
+		stats->acquired = 0;
+		stats->contended = 0;
+		stats->spin_ns = 0;
+		stats->max_ns = 0;
+		memset(stats->hist, 0, sizeof(stats->hist));
+	}
+	return count;
+}
+
+static const struct file_operations remote_spin_stats_fops = {
+	.open		= remote_spin_stats_open,
+	.read		= seq_read,
+	.write		= remote_spin_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init remote_spin_stats_init(void)
+{
+	debugfs_create_file("remote_spinlock", 0600, NULL, NULL,
+			    &remote_spin_stats_fops);
+	return 0;
+}
+late_initcall(remote_spin_stats_init);
+#else
+static inline void remote_spin_add_stats(remote_spinlock_id_t id,
+					 raw_remote_spinlock_t *lock)
+{
+}
+#endif
+
+#if defined(CONFIG_MSM_REMOTE_SPINLOCK_DEKKERS)
+static inline int remote_spin_is_held(raw_remote_spinlock_t *lock)
+{
+	return lock->dek.other_lock;
+}
+#else
+static inline int remote_spin_is_held(raw_remote_spinlock_t *lock)
+{
+	return lock->lock != 0;
+}
+#endif
+
+/* Longest pause between two looks at a contended lock, in cpu_relax() */
+#define REMOTE_SPIN_BACKOFF_MAX		1024
+
+#if !defined(CONFIG_MSM_REMOTE_SPINLOCK_SFPB)
+/*
+ * Called once the inline attempt failed. The lock word is only read
+ * until it looks free, waiting twice as long between each look, and
+ * only then taken again. WFE is not used: the other processors do not
+ * signal an event when they release the lock, and the callers have
+ * interrupts disabled, so nothing would reliably wake the core.
+ */
+void _remote_spin_lock_contended(_remote_spinlock_t *lock)
+{
+#ifdef CONFIG_MSM_REMOTE_SPINLOCK_STATS
+	unsigned long long start = sched_clock();
+#endif
+	unsigned int delay = 1, i;
+
+	do {
+		while (remote_spin_is_held(*lock)) {
+			for (i = 0; i < delay; i++)
+				cpu_relax();
+			if (delay < REMOTE_SPIN_BACKOFF_MAX)
+				delay <<= 1;
+		}
+	} while (!_remote_spin_trylock(lock));
+
+#ifdef CONFIG_MSM_REMOTE_SPINLOCK_STATS
+	remote_spin_record(*lock, start);
+#endif
+}
+EXPORT_SYMBOL(_remote_spin_lock_contended);
+#endif
+
 #if defined(CONFIG_MSM_REMOTE_SPINLOCK_SFPB)
 #define SFPB_SPINLOCK_COUNT 8
 #define MSM_SFPB_MUTEX_REG_BASE 0x01200600
@@ -143,20 +343,26 @@ remote_spinlock_dal_init(const char *chunk_name, _remote_spinlock_t *lock)
 
 int _remote_spin_lock_init(remote_spinlock_id_t id, _remote_spinlock_t *lock)
 {
+	int ret;
+
 	BUG_ON(id == NULL);
 
 	if (id[0] == 'D' && id[1] == ':') {
 		/* DAL chunk name starts after "D:" */
-		return remote_spinlock_dal_init(&id[2], lock);
+		ret = remote_spinlock_dal_init(&id[2], lock);
 	} else if (id[0] == 'S' && id[1] == ':') {
 		/* Single-digit lock ID follows "S:" */
 		BUG_ON(id[3] != '\0');
 
-		return remote_spinlock_init_address((((uint8_t)id[2])-'0'),
+		ret = remote_spinlock_init_address((((uint8_t)id[2])-'0'),
 				lock);
 	} else {
 		return -EINVAL;
 	}
+
+	if (!ret)
+		remote_spin_add_stats(id, *lock);
+	return ret;
 }
 
 int _remote_mutex_init(struct remote_mutex_id *id, _remote_mutex_t *lock)
@@ -122,14 +122,15 @@ static struct dentry *stats_dentry;
 #define RMT_STORAGE_EVENT_CB_TYPE_PROC          3
 #define RMT_STORAGE_READ_IOVEC_CB_TYPE_PROC     4
 
+DEFINE_XDR_LAYOUT(rmt_storage_send_sts_layout,
+	XDR_FIELD(struct rmt_storage_send_sts, handle),
+	XDR_FIELD(struct rmt_storage_send_sts, err_code),
+	XDR_FIELD(struct rmt_storage_send_sts, data));
+
 static int rmt_storage_send_sts_arg(struct msm_rpc_client *client,
 				struct msm_rpc_xdr *xdr, void *data)
 {
-	struct rmt_storage_send_sts *args = data;
-
-	xdr_send_uint32(xdr, &args->handle);
-	xdr_send_uint32(xdr, &args->err_code);
-	xdr_send_uint32(xdr, &args->data);
+	xdr_send_struct(xdr, &rmt_storage_send_sts_layout, data);
 	return 0;
 }
 
@@ -230,6 +231,17 @@ struct rmt_storage_event_params {
 	} params;
 };
 
+DEFINE_XDR_LAYOUT(rmt_storage_rw_block_layout,
+	XDR_FIELD(struct rmt_storage_rw_block_args, handle),
+	XDR_FIELD(struct rmt_storage_rw_block_args, data_phy_addr),
+	XDR_FIELD(struct rmt_storage_rw_block_args, sector_addr),
+	XDR_FIELD(struct rmt_storage_rw_block_args, num_sector));
+
+DEFINE_XDR_LAYOUT(rmt_storage_iovec_desc_layout,
+	XDR_FIELD(struct rmt_storage_iovec_desc, sector_addr),
+	XDR_FIELD(struct rmt_storage_iovec_desc, data_phy_addr),
+	XDR_FIELD(struct rmt_storage_iovec_desc, num_sector));
+
 static int rmt_storage_parse_params(struct msm_rpc_xdr *xdr,
 		struct rmt_storage_event_params *event)
 {
@@ -248,10 +260,7 @@ static int rmt_storage_parse_params(struct msm_rpc_xdr *xdr,
 		struct rmt_storage_rw_block_args *args;
 		args = &event->params.block;
 
-		xdr_recv_uint32(xdr, &args->handle);
-		xdr_recv_uint32(xdr, &args->data_phy_addr);
-		xdr_recv_uint32(xdr, &args->sector_addr);
-		xdr_recv_uint32(xdr, &args->num_sector);
+		xdr_recv_struct(xdr, &rmt_storage_rw_block_layout, args);
 		break;
 	}
 
@@ -440,9 +449,7 @@ static int rmt_storage_event_write_iovec_cb(
 #endif
 	for (i = 0; i < ent; i++) {
 		xfer = &event_args->xfer_desc[i];
-		xdr_recv_uint32(xdr, &xfer->sector_addr);
-		xdr_recv_uint32(xdr, &xfer->data_phy_addr);
-		xdr_recv_uint32(xdr, &xfer->num_sector);
+		xdr_recv_struct(xdr, &rmt_storage_iovec_desc_layout, xfer);
 
 		if (xfer->data_phy_addr < _rmc->rmt_shrd_mem.start ||
 		   xfer->data_phy_addr > (_rmc->rmt_shrd_mem.start +
@@ -487,9 +494,7 @@ static int rmt_storage_event_read_iovec_cb(
 #endif
 	for (i = 0; i < ent; i++) {
 		xfer = &event_args->xfer_desc[i];
-		xdr_recv_uint32(xdr, &xfer->sector_addr);
-		xdr_recv_uint32(xdr, &xfer->data_phy_addr);
-		xdr_recv_uint32(xdr, &xfer->num_sector);
+		xdr_recv_struct(xdr, &rmt_storage_iovec_desc_layout, xfer);
 
 		if (xfer->data_phy_addr < _rmc->rmt_shrd_mem.start ||
 		   xfer->data_phy_addr > (_rmc->rmt_shrd_mem.start +
@@ -135,6 +135,8 @@ static struct rmt_storage_server_info *_rms;
 #define RMT_STORAGE_SRV_REGISTER_SYNC_PROC 8
 #define RMT_STORAGE_SRV_REGISTER_SYNC_STATUS_PROC 10
 
+#define RMT_STORAGE_SECTOR_SIZE 512
+
 #define RMT_STORAGE_EVENT_FUNC_PTR_TYPE_PROC 1
 #define RMT_STORAGE_REG_SYNC_CB_TYPE_PROC 2
 #define RMT_STORAGE_REG_SYNC_STATUS_CB_TYPE_PROC 3
@@ -356,6 +358,48 @@ static int rmt_storage_get_sync_status(void)
 	return args.data;
 }
 
+static int rmt_storage_check_xfer(struct rmt_storage_server_info *rms,
+				  struct rmt_storage_iovec_desc *xfer)
+{
+	uint32_t start = rms->rmt_shrd_mem.start;
+	uint32_t end = start + rms->rmt_shrd_mem.size;
+
+	if (xfer->data_phy_addr < start || xfer->data_phy_addr > end)
+		return -EINVAL;
+	if (xfer->num_sector > (end - xfer->data_phy_addr) /
+				RMT_STORAGE_SECTOR_SIZE)
+		return -EINVAL;
+	return 0;
+}
+
+/*
+ * EFS sync hands us long runs of small writes that are both sector and
+ * buffer contiguous.  Merge them so the daemon issues one eMMC transfer
+ * per run instead of one per descriptor.
+ */
+static uint32_t rmt_storage_coalesce_xfer(struct rmt_storage_iovec_desc *xfer,
+					  uint32_t cnt)
+{
+	struct rmt_storage_iovec_desc *prev;
+	uint32_t i, n;
+
+	if (cnt < 2)
+		return cnt;
+
+	for (i = 1, n = 0; i < cnt; i++) {
+		prev = &xfer[n];
+		if (xfer[i].sector_addr == prev->sector_addr +
+					   prev->num_sector &&
+		    xfer[i].data_phy_addr == prev->data_phy_addr +
+				prev->num_sector * RMT_STORAGE_SECTOR_SIZE) {
+			prev->num_sector += xfer[i].num_sector;
+			continue;
+		}
+		xfer[++n] = xfer[i];
+	}
+	return n + 1;
+}
+
 static void put_event(struct rmt_storage_server_info *rms,
 			struct rmt_storage_kevent *kevent)
 {
@@ -444,28 +488,27 @@ static int handle_rmt_storage_call(struct msm_rpc_server *server,
 		struct rmt_storage_write_block_args *args;
 		struct rmt_storage_iovec_desc *xfer;
 
-		pr_info("%s: rmt_storage write block event\n", __func__);
+		pr_debug("%s: rmt_storage write block event\n", __func__);
 		args = (struct rmt_storage_write_block_args *)(req + 1);
 		event_args->handle = be32_to_cpu(args->handle);
 		xfer = &event_args->xfer_desc[0];
 		xfer->sector_addr = be32_to_cpu(args->sector_addr);
 		xfer->data_phy_addr = be32_to_cpu(args->data_phy_addr);
+		xfer->num_sector = be32_to_cpu(args->num_sector);
 
-		if (xfer->data_phy_addr < rms->rmt_shrd_mem.start ||
-		   xfer->data_phy_addr > (rms->rmt_shrd_mem.start +
-		   rms->rmt_shrd_mem.size)) {
+		if (rmt_storage_check_xfer(rms, xfer)) {
+			kfree(kevent);
 			result = RMT_STORAGE_ERROR_PARAM;
 			goto out;
 		}
 
-		xfer->num_sector = be32_to_cpu(args->num_sector);
 		event_args->xfer_cnt = 1;
 		event_args->id = RMT_STORAGE_WRITE;
 
 		if (atomic_inc_return(&rms->wcount) == 1)
 			wake_lock(&rms->wlock);
 
-		pr_info("sec_addr = %u, data_addr = %x, num_sec = %d\n\n",
+		pr_debug("sec_addr = %u, data_addr = %x, num_sec = %d\n\n",
 			xfer->sector_addr, xfer->data_phy_addr,
 			xfer->num_sector);
 		break;
@@ -486,37 +529,46 @@ static int handle_rmt_storage_call(struct msm_rpc_server *server,
 		struct rmt_storage_iovec_desc *iovec, *xfer;
 		struct rmt_storage_write_iovec_args *args;
 
-		pr_info("%s: rmt_storage write iovec event\n", __func__);
+		pr_debug("%s: rmt_storage write iovec event\n", __func__);
 		args = (struct rmt_storage_write_iovec_args *)(req + 1);
 		event_args->handle = be32_to_cpu(args->handle);
 		ent = be32_to_cpu(args->count);
-		pr_info("handle = %d\n", event_args->handle);
+		pr_debug("handle = %d\n", event_args->handle);
+
+		if (ent > RMT_STORAGE_MAX_IOVEC_XFR_CNT) {
+			kfree(kevent);
+			result = RMT_STORAGE_ERROR_PARAM;
+			goto out;
+		}
 
 		iovec = (struct rmt_storage_iovec_desc *)(args + 1);
 		for (i = 0; i < ent; i++) {
 			xfer = &event_args->xfer_desc[i];
 			xfer->sector_addr = be32_to_cpu(iovec->sector_addr);
 			xfer->data_phy_addr = be32_to_cpu(iovec->data_phy_addr);
+			xfer->num_sector = be32_to_cpu(iovec->num_sector);
 
-			if (xfer->data_phy_addr < rms->rmt_shrd_mem.start ||
-			   xfer->data_phy_addr > (rms->rmt_shrd_mem.start +
-			   rms->rmt_shrd_mem.size)) {
+			if (rmt_storage_check_xfer(rms, xfer)) {
+				kfree(kevent);
 				result = RMT_STORAGE_ERROR_PARAM;
 				goto out;
 			}
 
-			xfer->num_sector = be32_to_cpu(iovec->num_sector);
 			iovec += 1;
-			pr_info("sec_addr = %u, data_addr = %x, num_sec = %d\n",
+			pr_debug("sec_addr = %u, data_addr = %x, num_sec = %d\n",
 				xfer->sector_addr, xfer->data_phy_addr,
 				xfer->num_sector);
 		}
 		event_args->xfer_cnt = be32_to_cpu(*((uint32_t *)iovec));
+		if (event_args->xfer_cnt == ent)
+			event_args->xfer_cnt = rmt_storage_coalesce_xfer(
+					event_args->xfer_desc, ent);
 		event_args->id = RMT_STORAGE_WRITE;
 		if (atomic_inc_return(&rms->wcount) == 1)
 			wake_lock(&rms->wlock);
 
-		pr_info("iovec transfer count = %d\n\n", event_args->xfer_cnt);
+		pr_debug("iovec transfer count = %d\n\n",
+			 event_args->xfer_cnt);
 
 		break;
 	}
@@ -631,7 +683,7 @@ static long rmt_storage_ioctl(struct file *fp, unsigned int cmd,
 		break;
 
 	case RMT_STORAGE_WAIT_FOR_REQ:
-		pr_info("%s: wait for request ioctl\n", __func__);
+		pr_debug("%s: wait for request ioctl\n", __func__);
 		if (atomic_read(&rms->total_events) == 0) {
 			ret = wait_event_interruptible(rms->event_q,
 				atomic_read(&rms->total_events) != 0);
@@ -651,7 +703,7 @@ static long rmt_storage_ioctl(struct file *fp, unsigned int cmd,
 		break;
 
 	case RMT_STORAGE_SEND_STATUS:
-		pr_info("%s: send callback ioctl\n", __func__);
+		pr_debug("%s: send callback ioctl\n", __func__);
 		if (copy_from_user(&cb, (void __user *)arg,
 				sizeof(struct rmt_storage_cb))) {
 			pr_err("%s: copy from user failed\n\n", __func__);
@@ -17,6 +17,7 @@
 
 #include <linux/platform_device.h>
 #include <linux/types.h>
+#include <linux/string.h>
 
 #include <mach/msm_smd.h>
 #include "smd_rpcrouter.h"
@@ -26,6 +27,11 @@ struct rpcrouter_smd_xprt {
 	struct rpcrouter_xprt xprt;
 
 	smd_channel_t *channel;
+
+	/* header and pacmark are staged until the payload arrives */
+	unsigned char tx_buf[sizeof(struct rr_header) + sizeof(uint32_t) +
+			     RPCROUTER_MSGSIZE_MAX];
+	uint32_t tx_len;
 };
 
 static struct rpcrouter_smd_xprt smd_remote_xprt;
@@ -33,6 +39,34 @@ static struct rpcrouter_smd_xprt smd_remote_xprt;
 static struct rpcrouter_smd_xprt smd_remote_qdsp_xprt;
 #endif
 
+/*
+ * The router writes each packet as header, pacmark and payload while
+ * holding the xprt lock.  Hand them to SMD as a single write so the
+ * remote side gets one interrupt per packet instead of three.
+ */
+static int rpcrouter_smd_xprt_write(struct rpcrouter_smd_xprt *smd_xprt,
+				    void *data, uint32_t len, uint32_t type)
+{
+	int rc;
+
+	if (type == HEADER)
+		smd_xprt->tx_len = 0;
+
+	if (smd_xprt->tx_len + len > sizeof(smd_xprt->tx_buf)) {
+		smd_xprt->tx_len = 0;
+		return -EINVAL;
+	}
+	memcpy(smd_xprt->tx_buf + smd_xprt->tx_len, data, len);
+	smd_xprt->tx_len += len;
+
+	if (type != PAYLOAD)
+		return len;
+
+	rc = smd_write(smd_xprt->channel, smd_xprt->tx_buf, smd_xprt->tx_len);
+	smd_xprt->tx_len = 0;
+	return rc < 0 ? rc : len;
+}
+
 static int rpcrouter_smd_remote_read_avail(void)
 {
 	return smd_read_avail(smd_remote_xprt.channel);
@@ -50,7 +84,7 @@ static int rpcrouter_smd_remote_write_avail(void)
 
 static int rpcrouter_smd_remote_write(void *data, uint32_t len, uint32_t type)
 {
-	return smd_write(smd_remote_xprt.channel, data, len);
+	return rpcrouter_smd_xprt_write(&smd_remote_xprt, data, len, type);
 }
 
 static int rpcrouter_smd_remote_close(void)
@@ -102,7 +136,7 @@ static int rpcrouter_smd_remote_qdsp_write_avail(void)
 static int rpcrouter_smd_remote_qdsp_write(void *data,
 		uint32_t len, uint32_t type)
 {
-	return smd_write(smd_remote_qdsp_xprt.channel, data, len);
+	return rpcrouter_smd_xprt_write(&smd_remote_qdsp_xprt, data, len, type);
 }
 
 static int rpcrouter_smd_remote_qdsp_close(void)
@@ -206,7 +240,7 @@ static int rpcrouter_smd_loopback_write_avail(void)
 
 static int rpcrouter_smd_loopback_write(void *data, uint32_t len, uint32 type)
 {
-	return smd_write(smd_loopback_xprt.channel, data, len);
+	return rpcrouter_smd_xprt_write(&smd_loopback_xprt, data, len, type);
 }
 
 static int rpcrouter_smd_loopback_close(void)
@@ -169,11 +169,12 @@ static void sirc_irq_handler(unsigned int irq, struct irq_desc *desc)
 	if (status == 0)
 		return;
 
-	for (sirq = 0;
-	     (sirq < NR_SIRC_IRQS) && ((status & (1U << sirq)) == 0);
-	     sirq++)
-		;
-	generic_handle_irq(sirq+FIRST_SIRC_IRQ);
+	/* Serve everything pending, lowest first, before re-entering */
+	while (status) {
+		sirq = __ffs(status);
+		status &= ~(1U << sirq);
+		generic_handle_irq(sirq + FIRST_SIRC_IRQ);
+	}
 
 	desc->chip->ack(irq);
 }
@@ -30,7 +30,9 @@
 #include <linux/termios.h>
 #include <linux/ctype.h>
 #include <linux/remote_spinlock.h>
+#include <linux/lock_prof.h>
 #include <linux/uaccess.h>
+#include <linux/hrtimer.h>
 #include <mach/msm_smd.h>
 #include <mach/msm_iomap.h>
 #include <mach/system.h>
@@ -41,6 +43,9 @@
 #include "proc_comm.h"
 #include "modem_notifier.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/smd.h>
+
 #if defined(CONFIG_ARCH_QSD8X50) || defined(CONFIG_ARCH_MSM8X60) \
 	|| defined(CONFIG_ARCH_MSM8960) || defined(CONFIG_ARCH_FSM9XXX) \
 	|| defined(CONFIG_ARCH_MSM9615)
@@ -138,6 +143,17 @@ module_param_named(debug_mask, msm_smd_debug_mask,
 #define SMSM_INFO(x...) do { } while (0)
 #endif
 
+static int smd_stats_enable;
+module_param_named(stats_enable, smd_stats_enable,
+		   int, S_IRUGO | S_IWUSR | S_IWGRP);
+
+#define SMD_STAT_ADD(ch, field, n) do {			\
+		if (unlikely(smd_stats_enable))		\
+			(ch)->stats.field += (n);	\
+	} while (0)
+
+static void smd_stat_latency(struct smd_channel *ch, ktime_t start);
+
 static unsigned last_heap_free = 0xffffffff;
 
 static inline void smd_write_intr(unsigned int val,
@@ -382,6 +398,7 @@ EXPORT_SYMBOL(smsm_check_for_modem_crash);
  * list or fiddles with channel state
  */
 static DEFINE_SPINLOCK(smd_lock);
+static DEFINE_LOCK_PROF(smd_lock_prof, "smd_lock");
 DEFINE_SPINLOCK(smem_lock);
 
 /* the mutex is used during open() and close()
@@ -437,6 +454,16 @@ struct smd_channel {
 	int pending_pkt_sz;
 
 	char is_pkt_ch;
+
+	/* interrupt batching, see smd_set_coalesce() */
+	spinlock_t coalesce_lock;
+	struct hrtimer coalesce_timer;
+	ktime_t coalesce_period;
+	unsigned coalesce_bytes;
+	unsigned coalesce_pending;
+	unsigned coalesce_active;
+
+	struct smd_ch_stats stats;
 };
 
 struct edge_to_pid {
@@ -670,7 +697,7 @@ void smd_channel_reset(uint32_t restart_pid)
 
 	/* change all remote states to CLOSING */
 	mutex_lock(&smd_probe_lock);
-	spin_lock_irqsave(&smd_lock, flags);
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	smd_channel_reset_state(shared, SMD_SS_CLOSING, restart_pid);
 	spin_unlock_irqrestore(&smd_lock, flags);
 	mutex_unlock(&smd_probe_lock);
@@ -685,7 +712,7 @@ void smd_channel_reset(uint32_t restart_pid)
 
 	/* change all remote states to CLOSED */
 	mutex_lock(&smd_probe_lock);
-	spin_lock_irqsave(&smd_lock, flags);
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	smd_channel_reset_state(shared, SMD_SS_CLOSED, restart_pid);
 	spin_unlock_irqrestore(&smd_lock, flags);
 	mutex_unlock(&smd_probe_lock);
@@ -829,6 +856,7 @@ static void update_packet_state(struct smd_channel *ch)
 		BUG_ON(r != SMD_HEADER_SIZE);
 
 		ch->current_packet = hdr[0];
+		SMD_STAT_ADD(ch, pkts_in, 1);
 	}
 }
 
@@ -873,6 +901,7 @@ static void ch_set_state(struct smd_channel *ch, unsigned n)
 	}
 	ch->send->state = n;
 	ch->send->fSTATE = 1;
+	ch->stats.intr_out++;
 	ch->notify_other_cpu();
 }
 
@@ -885,6 +914,12 @@ static void do_smd_probe(void)
 	}
 }
 
+static inline void smd_notify(struct smd_channel *ch, unsigned event)
+{
+	trace_smd_notify(ch->name, event);
+	ch->notify(ch->priv, event);
+}
+
 static void smd_state_change(struct smd_channel *ch,
 			     unsigned last, unsigned next)
 {
@@ -905,7 +940,7 @@ static void smd_state_change(struct smd_channel *ch,
 	case SMD_SS_OPENED:
 		if (ch->send->state == SMD_SS_OPENING) {
 			ch_set_state(ch, SMD_SS_OPENED);
-			ch->notify(ch->priv, SMD_EVENT_OPEN);
+			smd_notify(ch, SMD_EVENT_OPEN);
 		}
 		break;
 	case SMD_SS_FLUSHING:
@@ -916,7 +951,7 @@ static void smd_state_change(struct smd_channel *ch,
 		if (ch->send->state == SMD_SS_OPENED) {
 			ch_set_state(ch, SMD_SS_CLOSING);
 			ch->current_packet = 0;
-			ch->notify(ch->priv, SMD_EVENT_CLOSE);
+			smd_notify(ch, SMD_EVENT_CLOSE);
 		}
 		break;
 	case SMD_SS_CLOSING:
@@ -937,7 +972,7 @@ static void handle_smd_irq_closing_list(void)
 	struct smd_channel *index;
 	unsigned tmp;
 
-	spin_lock_irqsave(&smd_lock, flags);
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	list_for_each_entry_safe(ch, index, &smd_ch_closing_list, ch_list) {
 		if (ch->recv->fSTATE)
 			ch->recv->fSTATE = 0;
@@ -955,8 +990,12 @@ static void handle_smd_irq(struct list_head *list, void (*notify)(void))
 	unsigned ch_flags;
 	unsigned tmp;
 	unsigned char state_change;
+	ktime_t start = { 0 };
+
+	if (unlikely(smd_stats_enable))
+		start = ktime_get();
 
-	spin_lock_irqsave(&smd_lock, flags);
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	list_for_each_entry(ch, list, ch_list) {
 		state_change = 0;
 		ch_flags = 0;
@@ -980,11 +1019,14 @@ static void handle_smd_irq(struct list_head *list, void (*notify)(void))
 			state_change = 1;
 		}
 		if (ch_flags) {
+			ch->stats.intr_in++;
 			ch->update_state(ch);
-			ch->notify(ch->priv, SMD_EVENT_DATA);
+			if (unlikely(smd_stats_enable))
+				smd_stat_latency(ch, start);
+			smd_notify(ch, SMD_EVENT_DATA);
 		}
 		if (ch_flags & 0x4 && !state_change)
-			ch->notify(ch->priv, SMD_EVENT_STATUS);
+			smd_notify(ch, SMD_EVENT_STATUS);
 	}
 	spin_unlock_irqrestore(&smd_lock, flags);
 	do_smd_probe();
@@ -1052,7 +1094,7 @@ void smd_sleep_exit(void)
 	struct smd_channel *ch;
 	int need_int = 0;
 
-	spin_lock_irqsave(&smd_lock, flags);
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	list_for_each_entry(ch, &smd_ch_list_modem, ch_list) {
 		if (smd_need_int(ch)) {
 			need_int = 1;
@@ -1087,6 +1129,153 @@ void smd_sleep_exit(void)
 }
 EXPORT_SYMBOL(smd_sleep_exit);
 
+static void smd_stat_latency(struct smd_channel *ch, ktime_t start)
+{
+	s64 usecs = ktime_us_delta(ktime_get(), start);
+	int b = 0;
+
+	while (usecs > 1 && b < SMD_LATENCY_BUCKETS - 1) {
+		usecs >>= 1;
+		b++;
+	}
+	ch->stats.notify_latency[b]++;
+}
+
+static int smd_print_ch_list_stats(char *buf, int max, struct list_head *list)
+{
+	struct smd_channel *ch;
+	int i = 0;
+	int b;
+
+	list_for_each_entry(ch, list, ch_list) {
+		struct smd_ch_stats *st = &ch->stats;
+
+		i += scnprintf(buf + i, max - i,
+			       "%-20s irq in %10u out %10u coalesced %10u\n",
+			       ch->name, st->intr_in, st->intr_out,
+			       st->intr_coalesced);
+		if (!smd_stats_enable)
+			continue;
+		i += scnprintf(buf + i, max - i,
+			       "  rx %u bytes %u pkts  tx %u bytes %u pkts"
+			       "  fifo full %u\n  notify latency (2^n us):",
+			       st->bytes_in, st->pkts_in, st->bytes_out,
+			       st->pkts_out, st->fifo_full);
+		for (b = 0; b < SMD_LATENCY_BUCKETS; b++)
+			i += scnprintf(buf + i, max - i, " %u",
+				       st->notify_latency[b]);
+		i += scnprintf(buf + i, max - i, "\n");
+	}
+	return i;
+}
+
+int smd_print_ch_stats(char *buf, int max)
+{
+	unsigned long flags;
+	int i = 0;
+
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
+	i += smd_print_ch_list_stats(buf + i, max - i, &smd_ch_list_modem);
+	i += smd_print_ch_list_stats(buf + i, max - i, &smd_ch_list_dsp);
+	i += smd_print_ch_list_stats(buf + i, max - i, &smd_ch_list_dsps);
+	i += smd_print_ch_list_stats(buf + i, max - i, &smd_ch_list_wcnss);
+	i += smd_print_ch_list_stats(buf + i, max - i, &smd_ch_list_loopback);
+	spin_unlock_irqrestore(&smd_lock, flags);
+
+	return i;
+}
+
+/* tell the remote processor about 'count' bytes of fifo progress */
+static void smd_kick(struct smd_channel *ch, unsigned count)
+{
+	unsigned long flags;
+
+	if (!ch->coalesce_bytes) {
+		ch->stats.intr_out++;
+		ch->notify_other_cpu();
+		return;
+	}
+
+	spin_lock_irqsave(&ch->coalesce_lock, flags);
+	if (!ch->coalesce_active) {
+		/* first update after idle: no latency, open a batch window */
+		ch->coalesce_active = 1;
+		hrtimer_start(&ch->coalesce_timer, ch->coalesce_period,
+			      HRTIMER_MODE_REL);
+	} else {
+		ch->coalesce_pending += count;
+		if (ch->coalesce_pending < ch->coalesce_bytes) {
+			ch->stats.intr_coalesced++;
+			spin_unlock_irqrestore(&ch->coalesce_lock, flags);
+			return;
+		}
+		ch->coalesce_pending = 0;
+	}
+	ch->stats.intr_out++;
+	ch->notify_other_cpu();
+	spin_unlock_irqrestore(&ch->coalesce_lock, flags);
+}
+
+static enum hrtimer_restart smd_coalesce_timer_fn(struct hrtimer *timer)
+{
+	struct smd_channel *ch = container_of(timer, struct smd_channel,
+					      coalesce_timer);
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ch->coalesce_lock, flags);
+	if (ch->coalesce_pending) {
+		/* still busy: flush the batch and keep polling */
+		ch->coalesce_pending = 0;
+		ch->stats.intr_out++;
+		ch->notify_other_cpu();
+		hrtimer_forward_now(timer, ch->coalesce_period);
+		ret = HRTIMER_RESTART;
+	} else {
+		ch->coalesce_active = 0;
+	}
+	spin_unlock_irqrestore(&ch->coalesce_lock, flags);
+
+	/* pick up remote updates whose interrupt we have not seen yet */
+	if (ret == HRTIMER_RESTART && smd_need_int(ch))
+		tasklet_schedule(&smd_fake_irq_tasklet);
+
+	return ret;
+}
+
+static void smd_coalesce_init(struct smd_channel *ch)
+{
+	spin_lock_init(&ch->coalesce_lock);
+	hrtimer_init(&ch->coalesce_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	ch->coalesce_timer.function = smd_coalesce_timer_fn;
+}
+
+int smd_set_coalesce(smd_channel_t *ch, unsigned bytes, unsigned usecs)
+{
+	unsigned long flags;
+
+	if (!ch)
+		return -ENODEV;
+	if (bytes && !usecs)
+		return -EINVAL;
+
+	hrtimer_cancel(&ch->coalesce_timer);
+
+	spin_lock_irqsave(&ch->coalesce_lock, flags);
+	if (ch->coalesce_pending) {
+		ch->stats.intr_out++;
+		ch->notify_other_cpu();
+	}
+	ch->coalesce_pending = 0;
+	ch->coalesce_active = 0;
+	ch->coalesce_period = ns_to_ktime((u64)usecs * NSEC_PER_USEC);
+	ch->coalesce_bytes = bytes;
+	spin_unlock_irqrestore(&ch->coalesce_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(smd_set_coalesce);
+
 static int smd_is_packet(struct smd_alloc_elm *alloc_elm)
 {
 	if (SMD_XFER_TYPE(alloc_elm->type) == 1)
@@ -1146,8 +1335,12 @@ static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
 			break;
 	}
 
-	if (orig_len - len)
-		ch->notify_other_cpu();
+	if (len)
+		SMD_STAT_ADD(ch, fifo_full, 1);
+	if (orig_len - len) {
+		SMD_STAT_ADD(ch, bytes_out, orig_len - len);
+		smd_kick(ch, orig_len - len);
+	}
 
 	return orig_len - len;
 }
@@ -1164,8 +1357,10 @@ static int smd_packet_write(smd_channel_t *ch, const void *_data, int len,
 	else if (len == 0)
 		return 0;
 
-	if (smd_stream_write_avail(ch) < (len + SMD_HEADER_SIZE))
+	if (smd_stream_write_avail(ch) < (len + SMD_HEADER_SIZE)) {
+		SMD_STAT_ADD(ch, fifo_full, 1);
 		return -ENOMEM;
+	}
 
 	hdr[0] = len;
 	hdr[1] = hdr[2] = hdr[3] = hdr[4] = 0;
@@ -1185,6 +1380,7 @@ static int smd_packet_write(smd_channel_t *ch, const void *_data, int len,
 			"%d returned\n", __func__, ret);
 		return ret;
 	}
+	SMD_STAT_ADD(ch, pkts_out, 1);
 
 	return len;
 }
@@ -1197,9 +1393,10 @@ static int smd_stream_read(smd_channel_t *ch, void *data, int len, int user_buf)
 		return -EINVAL;
 
 	r = ch_read(ch, data, len, user_buf);
+	SMD_STAT_ADD(ch, bytes_in, r);
 	if (r > 0)
 		if (!read_intr_blocked(ch))
-			ch->notify_other_cpu();
+			smd_kick(ch, r);
 
 	return r;
 }
@@ -1216,11 +1413,12 @@ static int smd_packet_read(smd_channel_t *ch, void *data, int len, int user_buf)
 		len = ch->current_packet;
 
 	r = ch_read(ch, data, len, user_buf);
+	SMD_STAT_ADD(ch, bytes_in, r);
 	if (r > 0)
 		if (!read_intr_blocked(ch))
-			ch->notify_other_cpu();
+			smd_kick(ch, r);
 
-	spin_lock_irqsave(&smd_lock, flags);
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	ch->current_packet -= r;
 	update_packet_state(ch);
 	spin_unlock_irqrestore(&smd_lock, flags);
@@ -1240,9 +1438,10 @@ static int smd_packet_read_from_cb(smd_channel_t *ch, void *data, int len,
 		len = ch->current_packet;
 
 	r = ch_read(ch, data, len, user_buf);
+	SMD_STAT_ADD(ch, bytes_in, r);
 	if (r > 0)
 		if (!read_intr_blocked(ch))
-			ch->notify_other_cpu();
+			smd_kick(ch, r);
 
 	ch->current_packet -= r;
 	update_packet_state(ch);
@@ -1314,6 +1513,7 @@ static int smd_alloc_channel(struct smd_alloc_elm *alloc_elm)
 
 	ch->fifo_mask = ch->fifo_size - 1;
 	ch->type = SMD_CHANNEL_TYPE(alloc_elm->type);
+	smd_coalesce_init(ch);
 
 	if (ch->type == SMD_APPS_MODEM)
 		ch->notify_other_cpu = notify_modem_smd;
@@ -1370,9 +1570,9 @@ static inline void notify_loopback_smd(void)
 	unsigned long flags;
 	struct smd_channel *ch;
 
-	spin_lock_irqsave(&smd_lock, flags);
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	list_for_each_entry(ch, &smd_ch_list_loopback, ch_list) {
-		ch->notify(ch->priv, SMD_EVENT_DATA);
+		smd_notify(ch, SMD_EVENT_DATA);
 	}
 	spin_unlock_irqrestore(&smd_lock, flags);
 }
@@ -1399,6 +1599,7 @@ static int smd_alloc_loopback_channel(void)
 	ch->fifo_mask = ch->fifo_size - 1;
 	ch->type = SMD_LOOPBACK_TYPE;
 	ch->notify_other_cpu = notify_loopback_smd;
+	smd_coalesce_init(ch);
 
 	ch->read = smd_stream_read;
 	ch->write = smd_stream_write;
@@ -1433,16 +1634,16 @@ static void finalize_channel_close_fn(struct work_struct *work)
 	struct smd_channel *ch;
 	struct smd_channel *index;
 
-	spin_lock_irqsave(&smd_lock, flags);
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	list_for_each_entry_safe(ch, index,  &smd_ch_to_close_list, ch_list) {
 		list_del(&ch->ch_list);
 		spin_unlock_irqrestore(&smd_lock, flags);
 		mutex_lock(&smd_creation_mutex);
 		list_add(&ch->ch_list, &smd_ch_closed_list);
 		mutex_unlock(&smd_creation_mutex);
-		ch->notify(ch->priv, SMD_EVENT_REOPEN_READY);
+		smd_notify(ch, SMD_EVENT_REOPEN_READY);
 		ch->notify = do_nothing_notify;
-		spin_lock_irqsave(&smd_lock, flags);
+		lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	}
 	spin_unlock_irqrestore(&smd_lock, flags);
 }
@@ -1503,7 +1704,7 @@ int smd_named_open_on_edge(const char *name, uint32_t edge,
 
 	SMD_DBG("smd_open: opening '%s'\n", ch->name);
 
-	spin_lock_irqsave(&smd_lock, flags);
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	if (SMD_CHANNEL_TYPE(ch->type) == SMD_APPS_MODEM)
 		list_add(&ch->ch_list, &smd_ch_list_modem);
 	else if (SMD_CHANNEL_TYPE(ch->type) == SMD_APPS_QDSP)
@@ -1544,7 +1745,9 @@ int smd_close(smd_channel_t *ch)
 
 	SMD_INFO("smd_close(%s)\n", ch->name);
 
-	spin_lock_irqsave(&smd_lock, flags);
+	smd_set_coalesce(ch, 0, 0);
+
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	list_del(&ch->ch_list);
 	if (ch->n == SMD_LOOPBACK_CID) {
 		ch->send->fDSR = 0;
@@ -1610,6 +1813,7 @@ int smd_write_start(smd_channel_t *ch, int len)
 		pr_err("%s: packet header failed to write\n", __func__);
 		return -EPERM;
 	}
+	SMD_STAT_ADD(ch, pkts_out, 1);
 	return 0;
 }
 EXPORT_SYMBOL(smd_write_start);
@@ -1661,6 +1865,116 @@ int smd_write_end(smd_channel_t *ch)
 }
 EXPORT_SYMBOL(smd_write_end);
 
+int smd_read_reserve(smd_channel_t *ch, void **ptr)
+{
+	unsigned n;
+
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+
+	n = ch_read_buffer(ch, ptr);
+	if (ch->is_pkt_ch && n > ch->current_packet)
+		n = ch->current_packet;
+
+	return n;
+}
+EXPORT_SYMBOL(smd_read_reserve);
+
+static int __smd_read_commit(smd_channel_t *ch, int len, int from_cb)
+{
+	unsigned long flags;
+	void *ptr;
+
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+	if (len < 0 || len > smd_read_reserve(ch, &ptr)) {
+		pr_err("%s: invalid length: %d\n", __func__, len);
+		return -EINVAL;
+	}
+	if (len == 0)
+		return 0;
+
+	ch_read_done(ch, len);
+	SMD_STAT_ADD(ch, bytes_in, len);
+	if (!read_intr_blocked(ch))
+		smd_kick(ch, len);
+
+	if (ch->is_pkt_ch) {
+		if (!from_cb)
+			lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
+		ch->current_packet -= len;
+		update_packet_state(ch);
+		if (!from_cb)
+			spin_unlock_irqrestore(&smd_lock, flags);
+	}
+
+	return len;
+}
+
+int smd_read_commit(smd_channel_t *ch, int len)
+{
+	return __smd_read_commit(ch, len, 0);
+}
+EXPORT_SYMBOL(smd_read_commit);
+
+int smd_read_commit_from_cb(smd_channel_t *ch, int len)
+{
+	return __smd_read_commit(ch, len, 1);
+}
+EXPORT_SYMBOL(smd_read_commit_from_cb);
+
+int smd_write_reserve(smd_channel_t *ch, void **ptr)
+{
+	unsigned n;
+
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+	if (ch->is_pkt_ch && !ch->pending_pkt_sz) {
+		pr_err("%s: no transaction in progress\n", __func__);
+		return -ENOEXEC;
+	}
+	if (!ch_is_open(ch))
+		return 0;
+
+	n = ch_write_buffer(ch, ptr);
+	if (ch->is_pkt_ch && n > ch->pending_pkt_sz)
+		n = ch->pending_pkt_sz;
+
+	return n;
+}
+EXPORT_SYMBOL(smd_write_reserve);
+
+int smd_write_commit(smd_channel_t *ch, int len)
+{
+	void *ptr;
+	int n;
+
+	n = smd_write_reserve(ch, &ptr);
+	if (n < 0)
+		return n;
+	if (len < 0 || len > n) {
+		pr_err("%s: invalid length: %d\n", __func__, len);
+		return -EINVAL;
+	}
+	if (len == 0)
+		return 0;
+
+	ch_write_done(ch, len);
+	if (ch->is_pkt_ch)
+		ch->pending_pkt_sz -= len;
+	SMD_STAT_ADD(ch, bytes_out, len);
+	smd_kick(ch, len);
+
+	return len;
+}
+EXPORT_SYMBOL(smd_write_commit);
+
 int smd_read(smd_channel_t *ch, void *data, int len)
 {
 	return ch->read(ch, data, len, 0);
@@ -1703,6 +2017,12 @@ int smd_write_avail(smd_channel_t *ch)
 }
 EXPORT_SYMBOL(smd_write_avail);
 
+int smd_write_queued(smd_channel_t *ch)
+{
+	return (ch->send->head - ch->send->tail) & ch->fifo_mask;
+}
+EXPORT_SYMBOL(smd_write_queued);
+
 void smd_enable_read_intr(smd_channel_t *ch)
 {
 	if (ch)
@@ -1772,7 +2092,7 @@ int smd_tiocmset(smd_channel_t *ch, unsigned int set, unsigned int clear)
 {
 	unsigned long flags;
 
-	spin_lock_irqsave(&smd_lock, flags);
+	lock_prof_spin_lock_irqsave(&smd_lock, flags, &smd_lock_prof);
 	smd_tiocmset_from_cb(ch, set, clear);
 	spin_unlock_irqrestore(&smd_lock, flags);
 
@@ -2572,6 +2892,7 @@ static struct platform_driver msm_smd_driver = {
 
 static int __init msm_smd_init(void)
 {
+	lock_prof_register(&smd_lock_prof);
 	return platform_driver_register(&msm_smd_driver);
 }
 
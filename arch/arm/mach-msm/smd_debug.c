@@ -604,7 +604,7 @@ static int debug_read_intr_mux(char *buf, int max)
 	return i;
 }
 
-#define DEBUG_BUFMAX 4096
+#define DEBUG_BUFMAX 16384
 static char debug_buffer[DEBUG_BUFMAX];
 
 static ssize_t debug_read(struct file *file, char __user *buf,
@@ -642,6 +642,7 @@ static int __init smd_debugfs_init(void)
 		return PTR_ERR(dent);
 
 	debug_create("ch", 0444, dent, debug_read_ch);
+	debug_create("stats", 0444, dent, smd_print_ch_stats);
 	debug_create("diag", 0444, dent, debug_read_diag_msg);
 	debug_create("mem", 0444, dent, debug_read_mem);
 	debug_create("version", 0444, dent, debug_read_smd_version);
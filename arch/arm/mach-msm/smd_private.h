@@ -205,6 +205,26 @@ enum {
 
 extern spinlock_t smem_lock;
 
+#define SMD_LATENCY_BUCKETS 12
+
+/*
+ * per-channel event counters, reported through debugfs; all but the
+ * interrupt counts are only kept while smd's stats_enable is set
+ */
+struct smd_ch_stats {
+	unsigned intr_in;		/* remote notifications handled */
+	unsigned intr_out;		/* interrupts raised to the remote */
+	unsigned intr_coalesced;	/* notifications folded into a batch */
+	unsigned bytes_in;
+	unsigned bytes_out;
+	unsigned pkts_in;
+	unsigned pkts_out;
+	unsigned fifo_full;		/* writes that found no room */
+	/* irq entry to notify callback, log2 usec buckets */
+	unsigned notify_latency[SMD_LATENCY_BUCKETS];
+};
+
+int smd_print_ch_stats(char *buf, int max);
 
 void smd_diag(void);
 
@@ -40,6 +40,8 @@
 #include <linux/platform_device.h>
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/rculist.h>
 
 #include <asm/byteorder.h>
 
@@ -147,6 +149,24 @@ static DEFINE_SPINLOCK(local_endpoints_lock);
 static DEFINE_SPINLOCK(remote_endpoints_lock);
 static DEFINE_SPINLOCK(server_list_lock);
 
+/*
+ * Lookup indexes for the lists above. Entries are added and removed under
+ * the matching list lock; servers and remote endpoints are looked up under
+ * RCU only, local endpoints under local_endpoints_lock, which also keeps the
+ * endpoint alive while do_read_data() queues a packet on it.
+ */
+#define RR_HASH_BITS 5
+static struct hlist_head local_ept_hash[1 << RR_HASH_BITS];
+static struct hlist_head remote_ept_hash[1 << RR_HASH_BITS];
+static struct hlist_head server_hash[1 << RR_HASH_BITS];
+
+#define local_ept_bucket(cid) \
+	(&local_ept_hash[hash_32(cid, RR_HASH_BITS)])
+#define remote_ept_bucket(pid, cid) \
+	(&remote_ept_hash[hash_32((pid) ^ (cid), RR_HASH_BITS)])
+#define server_bucket(prog) \
+	(&server_hash[hash_32(prog, RR_HASH_BITS)])
+
 static LIST_HEAD(rpc_board_dev_list);
 static DEFINE_SPINLOCK(rpc_board_dev_list_lock);
 
@@ -156,6 +176,15 @@ static atomic_t next_xid = ATOMIC_INIT(1);
 static atomic_t pm_mid = ATOMIC_INIT(1);
 
 static void do_read_data(struct work_struct *work);
+static void rpcrouter_complete_async(struct msm_rpc_async_call *call,
+				     struct rr_packet *pkt, int err);
+static void rpcrouter_abort_async(struct msm_rpc_endpoint *ept,
+				  struct list_head *aborted);
+static void rr_free_pkt(struct rr_packet *pkt);
+
+/* rr_fragment is just over 512 bytes, keep it out of kmalloc-1024 */
+static struct kmem_cache *rr_frag_cache;
+static struct kmem_cache *rr_pkt_cache;
 static void do_create_pdevs(struct work_struct *work);
 static void do_create_rpcrouter_pdev(struct work_struct *work);
 
@@ -282,8 +311,9 @@ static void modem_reset_cleanup(struct rpcrouter_xprt_info *xprt_info)
 	struct msm_rpc_endpoint *ept;
 	struct rr_remote_endpoint *r_ept;
 	struct rr_packet *pkt, *tmp_pkt;
-	struct rr_fragment *frag, *next;
 	struct msm_rpc_reply *reply, *reply_tmp;
+	struct msm_rpc_async_call *call, *call_tmp;
+	LIST_HEAD(aborted);
 	unsigned long flags;
 
 	spin_lock_irqsave(&local_endpoints_lock, flags);
@@ -329,13 +359,7 @@ static void modem_reset_cleanup(struct rpcrouter_xprt_info *xprt_info)
 		list_for_each_entry_safe(pkt, tmp_pkt,
 					 &ept->incomplete, list) {
 			list_del(&pkt->list);
-			frag = pkt->first;
-			while (frag != NULL) {
-				next = frag->next;
-				kfree(frag);
-				frag = next;
-			}
-			kfree(pkt);
+			rr_free_pkt(pkt);
 		}
 		spin_unlock(&ept->incomplete_lock);
 
@@ -344,22 +368,24 @@ static void modem_reset_cleanup(struct rpcrouter_xprt_info *xprt_info)
 		list_for_each_entry_safe(pkt, tmp_pkt, &ept->read_q,
 					 list) {
 			list_del(&pkt->list);
-			frag = pkt->first;
-			while (frag != NULL) {
-				next = frag->next;
-				kfree(frag);
-				frag = next;
-			}
-			kfree(pkt);
+			rr_free_pkt(pkt);
 		}
 		spin_unlock(&ept->read_q_lock);
 
+		/* outstanding async calls will never see their reply */
+		spin_lock(&ept->async_lock);
+		rpcrouter_abort_async(ept, &aborted);
+		spin_unlock(&ept->async_lock);
+
 		spin_unlock(&ept->restart_lock);
 		wake_up(&ept->wait_q);
 	}
 
 	spin_unlock_irqrestore(&local_endpoints_lock, flags);
 
+	list_for_each_entry_safe(call, call_tmp, &aborted, list)
+		rpcrouter_complete_async(call, NULL, -ENETRESET);
+
     /* Unblock endpoints waiting for quota ack*/
 	spin_lock_irqsave(&remote_endpoints_lock, flags);
 	list_for_each_entry(r_ept, &remote_endpoints, list) {
@@ -460,6 +486,7 @@ static struct rr_server *rpcrouter_create_server(uint32_t pid,
 
 	spin_lock_irqsave(&server_list_lock, flags);
 	list_add_tail(&server->list, &server_list);
+	hlist_add_head_rcu(&server->hash, server_bucket(prog));
 	spin_unlock_irqrestore(&server_list_lock, flags);
 
 	rc = msm_rpcrouter_create_server_cdev(server);
@@ -470,20 +497,28 @@ static struct rr_server *rpcrouter_create_server(uint32_t pid,
 out_fail:
 	spin_lock_irqsave(&server_list_lock, flags);
 	list_del(&server->list);
+	hlist_del_rcu(&server->hash);
 	spin_unlock_irqrestore(&server_list_lock, flags);
+	synchronize_rcu();
 	kfree(server);
 	return ERR_PTR(rc);
 }
 
+static void rpcrouter_free_server_rcu(struct rcu_head *head)
+{
+	kfree(container_of(head, struct rr_server, rcu));
+}
+
 static void rpcrouter_destroy_server(struct rr_server *server)
 {
 	unsigned long flags;
 
 	spin_lock_irqsave(&server_list_lock, flags);
 	list_del(&server->list);
+	hlist_del_rcu(&server->hash);
 	spin_unlock_irqrestore(&server_list_lock, flags);
 	device_destroy(msm_rpcrouter_class, server->device_number);
-	kfree(server);
+	call_rcu(&server->rcu, rpcrouter_free_server_rcu);
 }
 
 int msm_rpc_add_board_dev(struct rpc_board_dev *devices, int num)
@@ -535,17 +570,17 @@ static void rpcrouter_register_board_dev(struct rr_server *server)
 static struct rr_server *rpcrouter_lookup_server(uint32_t prog, uint32_t ver)
 {
 	struct rr_server *server;
-	unsigned long flags;
+	struct hlist_node *node;
 
-	spin_lock_irqsave(&server_list_lock, flags);
-	list_for_each_entry(server, &server_list, list) {
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(server, node, server_bucket(prog), hash) {
 		if (server->prog == prog
 		 && server->vers == ver) {
-			spin_unlock_irqrestore(&server_list_lock, flags);
+			rcu_read_unlock();
 			return server;
 		}
 	}
-	spin_unlock_irqrestore(&server_list_lock, flags);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -611,9 +646,14 @@ struct msm_rpc_endpoint *msm_rpcrouter_create_local_endpoint(dev_t dev)
 	wake_lock_init(&ept->reply_q_wake_lock, WAKE_LOCK_SUSPEND, "rpc_reply");
 	INIT_LIST_HEAD(&ept->incomplete);
 	spin_lock_init(&ept->incomplete_lock);
+	INIT_LIST_HEAD(&ept->async_pend_q);
+	INIT_LIST_HEAD(&ept->async_done_q);
+	spin_lock_init(&ept->async_lock);
+	init_waitqueue_head(&ept->async_wait);
 
 	spin_lock_irqsave(&local_endpoints_lock, flags);
 	list_add_tail(&ept->list, &local_endpoints);
+	hlist_add_head(&ept->hash, local_ept_bucket(ept->cid));
 	spin_unlock_irqrestore(&local_endpoints_lock, flags);
 	return ept;
 }
@@ -623,6 +663,8 @@ int msm_rpcrouter_destroy_local_endpoint(struct msm_rpc_endpoint *ept)
 	int rc;
 	union rr_control_msg msg;
 	struct msm_rpc_reply *reply, *reply_tmp;
+	struct msm_rpc_async_call *call, *call_tmp;
+	LIST_HEAD(aborted);
 	unsigned long flags;
 	struct rpcrouter_xprt_info *xprt_info;
 
@@ -631,6 +673,7 @@ int msm_rpcrouter_destroy_local_endpoint(struct msm_rpc_endpoint *ept)
 	** destroying it.*/
 	spin_lock_irqsave(&local_endpoints_lock, flags);
 	list_del(&ept->list);
+	hlist_del(&ept->hash);
 	spin_unlock_irqrestore(&local_endpoints_lock, flags);
 	if (ept->dst_pid != 0xffffffff) {
 		msg.cmd = RPCROUTER_CTRL_CMD_REMOVE_CLIENT;
@@ -661,6 +704,13 @@ int msm_rpcrouter_destroy_local_endpoint(struct msm_rpc_endpoint *ept)
 	}
 	spin_unlock_irqrestore(&ept->reply_q_lock, flags);
 
+	/* Fail calls still waiting for a reply */
+	spin_lock_irqsave(&ept->async_lock, flags);
+	rpcrouter_abort_async(ept, &aborted);
+	spin_unlock_irqrestore(&ept->async_lock, flags);
+	list_for_each_entry_safe(call, call_tmp, &aborted, list)
+		rpcrouter_complete_async(call, NULL, -ENETRESET);
+
 	wake_lock_destroy(&ept->read_q_wake_lock);
 	wake_lock_destroy(&ept->reply_q_wake_lock);
 	kfree(ept);
@@ -682,18 +732,27 @@ static int rpcrouter_create_remote_endpoint(uint32_t pid, uint32_t cid)
 	init_waitqueue_head(&new_c->quota_wait);
 	spin_lock_init(&new_c->quota_lock);
 
+	new_c->quota_restart_state = RESTART_NORMAL;
+
 	spin_lock_irqsave(&remote_endpoints_lock, flags);
 	list_add_tail(&new_c->list, &remote_endpoints);
-	new_c->quota_restart_state = RESTART_NORMAL;
+	hlist_add_head_rcu(&new_c->hash, remote_ept_bucket(pid, cid));
 	spin_unlock_irqrestore(&remote_endpoints_lock, flags);
 	return 0;
 }
 
+static void rpcrouter_free_remote_endpoint_rcu(struct rcu_head *head)
+{
+	kfree(container_of(head, struct rr_remote_endpoint, rcu));
+}
+
+/* Caller must hold local_endpoints_lock */
 static struct msm_rpc_endpoint *rpcrouter_lookup_local_endpoint(uint32_t cid)
 {
 	struct msm_rpc_endpoint *ept;
+	struct hlist_node *node;
 
-	list_for_each_entry(ept, &local_endpoints, list) {
+	hlist_for_each_entry(ept, node, local_ept_bucket(cid), hash) {
 		if (ept->cid == cid)
 			return ept;
 	}
@@ -704,16 +763,17 @@ static struct rr_remote_endpoint *rpcrouter_lookup_remote_endpoint(uint32_t pid,
 								   uint32_t cid)
 {
 	struct rr_remote_endpoint *ept;
-	unsigned long flags;
+	struct hlist_node *node;
 
-	spin_lock_irqsave(&remote_endpoints_lock, flags);
-	list_for_each_entry(ept, &remote_endpoints, list) {
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(ept, node, remote_ept_bucket(pid, cid),
+				 hash) {
 		if ((ept->pid == pid) && (ept->cid == cid)) {
-			spin_unlock_irqrestore(&remote_endpoints_lock, flags);
+			rcu_read_unlock();
 			return ept;
 		}
 	}
-	spin_unlock_irqrestore(&remote_endpoints_lock, flags);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -887,8 +947,10 @@ static int process_control_msg(struct rpcrouter_xprt_info *xprt_info,
 		if (r_ept) {
 			spin_lock_irqsave(&remote_endpoints_lock, flags);
 			list_del(&r_ept->list);
+			hlist_del_rcu(&r_ept->hash);
 			spin_unlock_irqrestore(&remote_endpoints_lock, flags);
-			kfree(r_ept);
+			call_rcu(&r_ept->rcu,
+				 rpcrouter_free_remote_endpoint_rcu);
 		}
 
 		/* Notify local clients of this event */
@@ -952,6 +1014,63 @@ static void *rr_malloc(unsigned sz)
 	return ptr;
 }
 
+static void *rr_cache_alloc(struct kmem_cache *cache)
+{
+	void *ptr = kmem_cache_alloc(cache, GFP_KERNEL);
+	if (ptr)
+		return ptr;
+
+	printk(KERN_ERR "rpcrouter: cache alloc failed, retrying...\n");
+	do {
+		ptr = kmem_cache_alloc(cache, GFP_KERNEL);
+	} while (!ptr);
+
+	return ptr;
+}
+
+static inline struct rr_fragment *rr_frag_alloc(void)
+{
+	return rr_cache_alloc(rr_frag_cache);
+}
+
+static inline struct rr_packet *rr_pkt_alloc(void)
+{
+	return rr_cache_alloc(rr_pkt_cache);
+}
+
+void rr_free_frag(struct rr_fragment *frag)
+{
+	struct rr_fragment *next;
+
+	while (frag != NULL) {
+		next = frag->next;
+		kmem_cache_free(rr_frag_cache, frag);
+		frag = next;
+	}
+}
+
+static void rr_free_pkt(struct rr_packet *pkt)
+{
+	rr_free_frag(pkt->first);
+	kmem_cache_free(rr_pkt_cache, pkt);
+}
+
+/*
+ * Copy a fragment chain into one buffer of exactly len bytes and return
+ * the fragments to the cache.  The caller owns (and kfree()s) the result.
+ */
+static void *rr_flatten(struct rr_fragment *frag, int len)
+{
+	struct rr_fragment *f;
+	char *buf, *p;
+
+	buf = rr_malloc(len);
+	for (p = buf, f = frag; f != NULL; p += f->length, f = f->next)
+		memcpy(p, f->data, f->length);
+	rr_free_frag(frag);
+	return buf;
+}
+
 static int rr_read(struct rpcrouter_xprt_info *xprt_info,
 		   void *data, uint32_t len)
 {
@@ -1005,6 +1124,88 @@ static char *type_to_str(int i)
 }
 #endif
 
+/* Called with ept->async_lock held */
+static struct msm_rpc_async_call *
+rpcrouter_match_async(struct msm_rpc_endpoint *ept, struct rr_packet *pkt)
+{
+	struct rpc_reply_hdr *reply = (void *) pkt->first->data;
+	struct msm_rpc_async_call *call;
+
+	if (list_empty(&ept->async_pend_q))
+		return NULL;
+	if (pkt->first->length < (3 * sizeof(uint32_t)) ||
+	    reply->type != cpu_to_be32(1))
+		return NULL;
+
+	list_for_each_entry(call, &ept->async_pend_q, list) {
+		if (call->xid == reply->xid) {
+			list_del(&call->list);
+			call->pending = 0;
+			return call;
+		}
+	}
+	return NULL;
+}
+
+/* Called with ept->async_lock held */
+static void rpcrouter_abort_async(struct msm_rpc_endpoint *ept,
+				  struct list_head *aborted)
+{
+	struct msm_rpc_async_call *call;
+
+	list_for_each_entry(call, &ept->async_pend_q, list)
+		call->pending = 0;
+	list_splice_init(&ept->async_pend_q, aborted);
+}
+
+/*
+ * Hand a call that is no longer on async_pend_q back to its owner,
+ * either with the reply in pkt or with err.  Must not be called with
+ * any router locks held, complete() may sleep.
+ */
+static void rpcrouter_complete_async(struct msm_rpc_async_call *call,
+				     struct rr_packet *pkt, int err)
+{
+	struct msm_rpc_endpoint *ept = call->ept;
+	struct rpc_reply_hdr *reply;
+	unsigned long flags;
+
+	call->reply = NULL;
+	call->status = err;
+
+	if (pkt) {
+		reply = rr_flatten(pkt->first, pkt->length);
+
+		if (pkt->length < sizeof(*reply))
+			call->status = -EIO;
+		else if (reply->reply_stat != 0)
+			call->status = -EPERM;
+		else if (reply->data.acc_hdr.accept_stat != 0)
+			call->status = -EINVAL;
+		else
+			call->status = pkt->length;
+
+		if (call->status < 0)
+			kfree(reply);
+		else
+			call->reply = reply;
+		kmem_cache_free(rr_pkt_cache, pkt);
+	}
+
+	if (call->complete) {
+		spin_lock_irqsave(&ept->async_lock, flags);
+		ept->async_cnt--;
+		spin_unlock_irqrestore(&ept->async_lock, flags);
+		call->complete(call);
+		return;
+	}
+
+	spin_lock_irqsave(&ept->async_lock, flags);
+	list_add_tail(&call->list, &ept->async_done_q);
+	spin_unlock_irqrestore(&ept->async_lock, flags);
+	wake_up(&ept->async_wait);
+}
+
 static void do_read_data(struct work_struct *work)
 {
 	struct rr_header hdr;
@@ -1014,6 +1215,7 @@ static void do_read_data(struct work_struct *work)
 #if defined(CONFIG_MSM_ONCRPCROUTER_DEBUG)
 	struct rpc_request_hdr *rq;
 #endif
+	struct msm_rpc_async_call *call;
 	uint32_t pm, mid;
 	unsigned long flags;
 
@@ -1067,11 +1269,16 @@ static void do_read_data(struct work_struct *work)
 
 	hdr.size -= sizeof(pm);
 
-	frag = rr_malloc(sizeof(*frag));
+	if (hdr.size > RPCROUTER_MSGSIZE_MAX) {
+		DIAG("oversized fragment (%d bytes)\n", hdr.size);
+		goto fail_data;
+	}
+
+	frag = rr_frag_alloc();
 	frag->next = NULL;
 	frag->length = hdr.size;
 	if (rr_read(xprt_info, frag->data, hdr.size)) {
-		kfree(frag);
+		rr_free_frag(frag);
 		goto fail_io;
 	}
 
@@ -1115,7 +1322,7 @@ static void do_read_data(struct work_struct *work)
 	if (!ept) {
 		spin_unlock_irqrestore(&local_endpoints_lock, flags);
 		DIAG("no local ept for cid %08x\n", hdr.dst_cid);
-		kfree(frag);
+		rr_free_frag(frag);
 		goto done;
 	}
 
@@ -1145,7 +1352,7 @@ static void do_read_data(struct work_struct *work)
 	 * the incomplete list if this fragment is not a last fragment,
 	 * otherwise put it on the read queue.
 	 */
-	pkt = rr_malloc(sizeof(struct rr_packet));
+	pkt = rr_pkt_alloc();
 	pkt->first = frag;
 	pkt->last = frag;
 	memcpy(&pkt->hdr, &hdr, sizeof(hdr));
@@ -1157,8 +1364,7 @@ static void do_read_data(struct work_struct *work)
 	if (!ept) {
 		spin_unlock_irqrestore(&local_endpoints_lock, flags);
 		DIAG("no local ept for cid %08x\n", hdr.dst_cid);
-		kfree(frag);
-		kfree(pkt);
+		rr_free_pkt(pkt);
 		goto done;
 	}
 	if (!PACMARK_LAST(pm)) {
@@ -1170,6 +1376,15 @@ static void do_read_data(struct work_struct *work)
 	}
 
 packet_complete:
+	spin_lock(&ept->async_lock);
+	call = rpcrouter_match_async(ept, pkt);
+	spin_unlock(&ept->async_lock);
+	if (call) {
+		spin_unlock_irqrestore(&local_endpoints_lock, flags);
+		rpcrouter_complete_async(call, pkt, 0);
+		goto done;
+	}
+
 	spin_lock(&ept->read_q_lock);
 	D("%s: take read lock on ept %p\n", __func__, ept);
 	wake_lock(&ept->read_q_wake_lock);
@@ -1663,36 +1878,14 @@ EXPORT_SYMBOL(msm_rpc_write);
 int msm_rpc_read(struct msm_rpc_endpoint *ept, void **buffer,
 		 unsigned user_len, long timeout)
 {
-	struct rr_fragment *frag, *next;
-	char *buf;
+	struct rr_fragment *frag;
 	int rc;
 
 	rc = __msm_rpc_read(ept, &frag, user_len, timeout);
 	if (rc <= 0)
 		return rc;
 
-	/* single-fragment messages conveniently can be
-	 * returned as-is (the buffer is at the front)
-	 */
-	if (frag->next == 0) {
-		*buffer = (void*) frag;
-		return rc;
-	}
-
-	/* multi-fragment messages, we have to do it the
-	 * hard way, which is rather disgusting right now
-	 */
-	buf = rr_malloc(rc);
-	*buffer = buf;
-
-	while (frag != NULL) {
-		memcpy(buf, frag->data, frag->length);
-		next = frag->next;
-		buf += frag->length;
-		kfree(frag);
-		frag = next;
-	}
-
+	*buffer = rr_flatten(frag, rc);
 	return rc;
 }
 EXPORT_SYMBOL(msm_rpc_read);
@@ -1707,15 +1900,9 @@ int msm_rpc_call(struct msm_rpc_endpoint *ept, uint32_t proc,
 }
 EXPORT_SYMBOL(msm_rpc_call);
 
-int msm_rpc_call_reply(struct msm_rpc_endpoint *ept, uint32_t proc,
-		       void *_request, int request_size,
-		       void *_reply, int reply_size,
-		       long timeout)
+static int msm_rpc_setup_call(struct msm_rpc_endpoint *ept, uint32_t proc,
+			      struct rpc_request_hdr *req, int request_size)
 {
-	struct rpc_request_hdr *req = _request;
-	struct rpc_reply_hdr *reply;
-	int rc;
-
 	if (request_size < sizeof(*req))
 		return -ETOOSMALL;
 
@@ -1728,6 +1915,21 @@ int msm_rpc_call_reply(struct msm_rpc_endpoint *ept, uint32_t proc,
 	req->prog = ept->dst_prog;
 	req->vers = ept->dst_vers;
 	req->procedure = cpu_to_be32(proc);
+	return 0;
+}
+
+int msm_rpc_call_reply(struct msm_rpc_endpoint *ept, uint32_t proc,
+		       void *_request, int request_size,
+		       void *_reply, int reply_size,
+		       long timeout)
+{
+	struct rpc_request_hdr *req = _request;
+	struct rpc_reply_hdr *reply;
+	int rc;
+
+	rc = msm_rpc_setup_call(ept, proc, req, request_size);
+	if (rc < 0)
+		return rc;
 
 	rc = msm_rpc_write(ept, req, request_size);
 	if (rc < 0)
@@ -1778,6 +1980,141 @@ int msm_rpc_call_reply(struct msm_rpc_endpoint *ept, uint32_t proc,
 }
 EXPORT_SYMBOL(msm_rpc_call_reply);
 
+int msm_rpc_call_async(struct msm_rpc_endpoint *ept, uint32_t proc,
+		       void *_request, int request_size,
+		       struct msm_rpc_async_call *call)
+{
+	struct rpc_request_hdr *req = _request;
+	unsigned long flags;
+	int rc;
+
+	rc = msm_rpc_setup_call(ept, proc, req, request_size);
+	if (rc < 0)
+		return rc;
+
+	call->ept = ept;
+	call->xid = req->xid;
+	call->status = 0;
+	call->reply = NULL;
+
+	/* the reply may arrive before msm_rpc_write() returns */
+	spin_lock_irqsave(&ept->async_lock, flags);
+	call->pending = 1;
+	list_add_tail(&call->list, &ept->async_pend_q);
+	ept->async_cnt++;
+	spin_unlock_irqrestore(&ept->async_lock, flags);
+
+	rc = msm_rpc_write(ept, req, request_size);
+	if (rc < 0) {
+		spin_lock_irqsave(&ept->async_lock, flags);
+		if (call->pending) {
+			list_del(&call->list);
+			call->pending = 0;
+			ept->async_cnt--;
+			spin_unlock_irqrestore(&ept->async_lock, flags);
+			return rc;
+		}
+		spin_unlock_irqrestore(&ept->async_lock, flags);
+		/* already failed by a reset, completion is on its way */
+	}
+	return 0;
+}
+EXPORT_SYMBOL(msm_rpc_call_async);
+
+static int async_call_available(struct msm_rpc_endpoint *ept)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&ept->async_lock, flags);
+	ret = !list_empty(&ept->async_done_q);
+	spin_unlock_irqrestore(&ept->async_lock, flags);
+	return ret;
+}
+
+/*
+ * Wait for any msm_rpc_call_async() call on ept without a complete
+ * callback to finish and return it, or an ERR_PTR.
+ */
+struct msm_rpc_async_call *msm_rpc_wait_any(struct msm_rpc_endpoint *ept,
+					    long timeout)
+{
+	struct msm_rpc_async_call *call;
+	unsigned long flags;
+	long rc;
+
+	spin_lock_irqsave(&ept->async_lock, flags);
+	rc = ept->async_cnt;
+	spin_unlock_irqrestore(&ept->async_lock, flags);
+	if (!rc)
+		return ERR_PTR(-ENOENT);
+
+	if (ept->flags & MSM_RPC_UNINTERRUPTIBLE) {
+		if (timeout < 0) {
+			wait_event(ept->async_wait, async_call_available(ept));
+		} else {
+			rc = wait_event_timeout(ept->async_wait,
+						async_call_available(ept),
+						timeout);
+			if (rc == 0)
+				return ERR_PTR(-ETIMEDOUT);
+		}
+	} else {
+		if (timeout < 0) {
+			rc = wait_event_interruptible(ept->async_wait,
+						async_call_available(ept));
+			if (rc < 0)
+				return ERR_PTR(rc);
+		} else {
+			rc = wait_event_interruptible_timeout(ept->async_wait,
+						async_call_available(ept),
+						timeout);
+			if (rc < 0)
+				return ERR_PTR(rc);
+			if (rc == 0)
+				return ERR_PTR(-ETIMEDOUT);
+		}
+	}
+
+	spin_lock_irqsave(&ept->async_lock, flags);
+	if (list_empty(&ept->async_done_q)) {
+		spin_unlock_irqrestore(&ept->async_lock, flags);
+		return ERR_PTR(-EAGAIN);
+	}
+	call = list_first_entry(&ept->async_done_q,
+				struct msm_rpc_async_call, list);
+	list_del(&call->list);
+	ept->async_cnt--;
+	spin_unlock_irqrestore(&ept->async_lock, flags);
+
+	return call;
+}
+EXPORT_SYMBOL(msm_rpc_wait_any);
+
+/*
+ * Stop waiting for the reply to call.  Returns -EALREADY if the call
+ * has already completed, its completion is then delivered as usual.
+ * A reply that arrives after cancellation is dropped by the caller's
+ * next msm_rpc_read() like any other unexpected reply.
+ */
+int msm_rpc_cancel_async(struct msm_rpc_async_call *call)
+{
+	struct msm_rpc_endpoint *ept = call->ept;
+	unsigned long flags;
+	int rc = -EALREADY;
+
+	spin_lock_irqsave(&ept->async_lock, flags);
+	if (call->pending) {
+		list_del(&call->list);
+		call->pending = 0;
+		ept->async_cnt--;
+		rc = 0;
+	}
+	spin_unlock_irqrestore(&ept->async_lock, flags);
+	return rc;
+}
+EXPORT_SYMBOL(msm_rpc_cancel_async);
+
 
 static inline int ept_packet_available(struct msm_rpc_endpoint *ept)
 {
@@ -1884,7 +2221,7 @@ int __msm_rpc_read(struct msm_rpc_endpoint *ept,
 		set_pend_reply(ept, reply);
 	}
 
-	kfree(pkt);
+	kmem_cache_free(rr_pkt_cache, pkt);
 
 	IO("READ on ept %p (%d bytes)\n", ept, rc);
 
@@ -1924,17 +2261,17 @@ static struct rr_server *msm_rpc_get_server(uint32_t prog, uint32_t vers,
 					    uint32_t *found_prog)
 {
 	struct rr_server *server;
-	unsigned long     flags;
+	struct hlist_node *node;
 
 	if (found_prog == NULL)
 		return NULL;
 
 	*found_prog = 0;
-	spin_lock_irqsave(&server_list_lock, flags);
-	list_for_each_entry(server, &server_list, list) {
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(server, node, server_bucket(prog), hash) {
 		if (server->prog == prog) {
 			*found_prog = 1;
-			spin_unlock_irqrestore(&server_list_lock, flags);
+			rcu_read_unlock();
 			if (accept_compatible) {
 				if (msm_rpc_is_compatible_version(server->vers,
 								  vers)) {
@@ -1948,7 +2285,7 @@ static struct rr_server *msm_rpc_get_server(uint32_t prog, uint32_t vers,
 				return NULL;
 		}
 	}
-	spin_unlock_irqrestore(&server_list_lock, flags);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -2490,6 +2827,11 @@ static int __init rpcrouter_init(void)
 	debugfs_init();
 
 
+	rr_frag_cache = KMEM_CACHE(rr_fragment, 0);
+	rr_pkt_cache = KMEM_CACHE(rr_packet, 0);
+	if (!rr_frag_cache || !rr_pkt_cache)
+		return -ENOMEM;
+
 	/* Initialize what we need to start processing */
 	rpcrouter_workqueue =
 		create_singlethread_workqueue("rpcrouter");
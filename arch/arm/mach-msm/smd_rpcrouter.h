@@ -20,6 +20,7 @@
 
 #include <linux/types.h>
 #include <linux/list.h>
+#include <linux/rcupdate.h>
 #include <linux/cdev.h>
 #include <linux/platform_device.h>
 #include <linux/msm_rpcrouter.h>
@@ -133,6 +134,8 @@ static inline uint32_t PACMARK(uint32_t len, uint32_t mid, uint32_t first,
 
 struct rr_server {
 	struct list_head list;
+	struct hlist_node hash;		/* by prog, see server_hash */
+	struct rcu_head rcu;
 
 	uint32_t pid;
 	uint32_t cid;
@@ -156,6 +159,8 @@ struct rr_remote_endpoint {
 	wait_queue_head_t quota_wait;
 
 	struct list_head list;
+	struct hlist_node hash;		/* by pid/cid, see remote_ept_hash */
+	struct rcu_head rcu;
 };
 
 struct msm_rpc_reply {
@@ -169,6 +174,7 @@ struct msm_rpc_reply {
 
 struct msm_rpc_endpoint {
 	struct list_head list;
+	struct hlist_node hash;		/* by cid, see local_ept_hash */
 
 	/* incomplete packets waiting for assembly */
 	struct list_head incomplete;
@@ -213,6 +219,13 @@ struct msm_rpc_endpoint {
 	uint32_t reply_cnt;
 	struct wake_lock reply_q_wake_lock;
 
+	/* outstanding msm_rpc_call_async() calls, matched by xid */
+	struct list_head async_pend_q;
+	struct list_head async_done_q;
+	spinlock_t async_lock;
+	wait_queue_head_t async_wait;
+	uint32_t async_cnt;
+
 	/* device node if this endpoint is accessed via userspace */
 	dev_t dev;
 };
@@ -239,6 +252,7 @@ void msm_rpcrouter_xprt_notify(struct rpcrouter_xprt *xprt, unsigned event);
 int __msm_rpc_read(struct msm_rpc_endpoint *ept,
 		   struct rr_fragment **frag,
 		   unsigned len, long timeout);
+void rr_free_frag(struct rr_fragment *frag);
 
 int msm_rpcrouter_close(void);
 struct msm_rpc_endpoint *msm_rpcrouter_create_local_endpoint(dev_t dev);
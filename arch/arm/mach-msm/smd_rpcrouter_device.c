@@ -156,28 +156,26 @@ static ssize_t rpcrouter_read(struct file *filp, char __user *buf,
 {
 	struct rpcrouter_file_info *file_info = filp->private_data;
 	struct msm_rpc_endpoint *ept;
-	struct rr_fragment *frag, *next;
+	struct rr_fragment *frag, *f;
 	int rc;
 
 	ept = (struct msm_rpc_endpoint *) file_info->ept;
 
 	rc = __msm_rpc_read(ept, &frag, count, -1);
-	if (rc < 0)
+	if (rc <= 0)
 		return rc;
 
 	count = rc;
 
-	while (frag != NULL) {		
-		if (copy_to_user(buf, frag->data, frag->length)) {
+	for (f = frag; f != NULL; f = f->next) {
+		if (copy_to_user(buf, f->data, f->length)) {
 			printk(KERN_ERR
 			       "rpcrouter: could not copy all read data to user!\n");
 			rc = -EFAULT;
 		}
-		buf += frag->length;
-		next = frag->next;
-		kfree(frag);
-		frag = next;
+		buf += f->length;
 	}
+	rr_free_frag(frag);
 
 	return rc;
 }
@@ -169,6 +169,45 @@ int xdr_recv_bytes(struct msm_rpc_xdr *xdr, void **data,
 	return 0;
 }
 
+int xdr_send_struct(struct msm_rpc_xdr *xdr,
+		    const struct msm_rpc_xdr_layout *layout, const void *obj)
+{
+	uint32_t len = layout->nr_fields * sizeof(uint32_t);
+	uint32_t *out;
+	uint32_t i;
+
+	if ((xdr->out_index + len) > xdr->out_size) {
+		pr_err("%s: xdr out buffer full\n", __func__);
+		return -1;
+	}
+
+	out = xdr->out_buf + xdr->out_index;
+	for (i = 0; i < layout->nr_fields; i++)
+		out[i] = cpu_to_be32(*(const uint32_t *)
+				     (obj + layout->offsets[i]));
+	xdr->out_index += len;
+	return 0;
+}
+
+int xdr_recv_struct(struct msm_rpc_xdr *xdr,
+		    const struct msm_rpc_xdr_layout *layout, void *obj)
+{
+	uint32_t len = layout->nr_fields * sizeof(uint32_t);
+	const uint32_t *in;
+	uint32_t i;
+
+	if ((xdr->in_index + len) > xdr->in_size) {
+		pr_err("%s: xdr in buffer full\n", __func__);
+		return -1;
+	}
+
+	in = xdr->in_buf + xdr->in_index;
+	for (i = 0; i < layout->nr_fields; i++)
+		*(uint32_t *)(obj + layout->offsets[i]) = be32_to_cpu(in[i]);
+	xdr->in_index += len;
+	return 0;
+}
+
 int xdr_send_pointer(struct msm_rpc_xdr *xdr, void **obj,
 		     uint32_t obj_size, void *xdr_op)
 {
@@ -272,43 +311,48 @@ int xdr_recv_array(struct msm_rpc_xdr *xdr, void **addr, uint32_t *size,
 	return 0;
 }
 
+DEFINE_XDR_LAYOUT(xdr_req_layout,
+	XDR_FIELD(struct rpc_request_hdr, xid),
+	XDR_FIELD(struct rpc_request_hdr, type),
+	XDR_FIELD(struct rpc_request_hdr, rpc_vers),
+	XDR_FIELD(struct rpc_request_hdr, prog),
+	XDR_FIELD(struct rpc_request_hdr, vers),
+	XDR_FIELD(struct rpc_request_hdr, procedure),
+	XDR_FIELD(struct rpc_request_hdr, cred_flavor),
+	XDR_FIELD(struct rpc_request_hdr, cred_length),
+	XDR_FIELD(struct rpc_request_hdr, verf_flavor),
+	XDR_FIELD(struct rpc_request_hdr, verf_length));
+
+DEFINE_XDR_LAYOUT(xdr_reply_layout,
+	XDR_FIELD(struct rpc_reply_hdr, xid),
+	XDR_FIELD(struct rpc_reply_hdr, type),
+	XDR_FIELD(struct rpc_reply_hdr, reply_stat));
+
+DEFINE_XDR_LAYOUT(xdr_acc_hdr_layout,
+	XDR_FIELD(struct rpc_reply_hdr, data.acc_hdr.verf_flavor),
+	XDR_FIELD(struct rpc_reply_hdr, data.acc_hdr.verf_length),
+	XDR_FIELD(struct rpc_reply_hdr, data.acc_hdr.accept_stat));
+
 int xdr_recv_req(struct msm_rpc_xdr *xdr, struct rpc_request_hdr *req)
 {
-	int rc = 0;
 	if (!req)
 		return -1;
 
-	rc |= xdr_recv_uint32(xdr, &req->xid);           /* xid */
-	rc |= xdr_recv_uint32(xdr, &req->type);          /* type */
-	rc |= xdr_recv_uint32(xdr, &req->rpc_vers);      /* rpc_vers */
-	rc |= xdr_recv_uint32(xdr, &req->prog);          /* prog */
-	rc |= xdr_recv_uint32(xdr, &req->vers);          /* vers */
-	rc |= xdr_recv_uint32(xdr, &req->procedure);     /* procedure */
-	rc |= xdr_recv_uint32(xdr, &req->cred_flavor);   /* cred_flavor */
-	rc |= xdr_recv_uint32(xdr, &req->cred_length);   /* cred_length */
-	rc |= xdr_recv_uint32(xdr, &req->verf_flavor);   /* verf_flavor */
-	rc |= xdr_recv_uint32(xdr, &req->verf_length);   /* verf_length */
-
-	return rc;
+	return xdr_recv_struct(xdr, &xdr_req_layout, req);
 }
 
 int xdr_recv_reply(struct msm_rpc_xdr *xdr, struct rpc_reply_hdr *reply)
 {
-	int rc = 0;
+	int rc;
 
 	if (!reply)
 		return -1;
 
-	rc |= xdr_recv_uint32(xdr, &reply->xid);           /* xid */
-	rc |= xdr_recv_uint32(xdr, &reply->type);          /* type */
-	rc |= xdr_recv_uint32(xdr, &reply->reply_stat);    /* reply_stat */
+	rc = xdr_recv_struct(xdr, &xdr_reply_layout, reply);
 
 	/* acc_hdr */
-	if (reply->reply_stat == RPCMSG_REPLYSTAT_ACCEPTED) {
-		rc |= xdr_recv_uint32(xdr, &reply->data.acc_hdr.verf_flavor);
-		rc |= xdr_recv_uint32(xdr, &reply->data.acc_hdr.verf_length);
-		rc |= xdr_recv_uint32(xdr, &reply->data.acc_hdr.accept_stat);
-	}
+	if (!rc && reply->reply_stat == RPCMSG_REPLYSTAT_ACCEPTED)
+		rc = xdr_recv_struct(xdr, &xdr_acc_hdr_layout, reply);
 
 	return rc;
 }
@@ -16,6 +16,7 @@
  */
 
 #include <linux/module.h>
+#include <linux/debugfs.h>
 #include <linux/fs.h>
 #include <linux/cdev.h>
 #include <linux/device.h>
@@ -23,6 +24,7 @@
 #include <linux/delay.h>
 #include <linux/wakelock.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 
 #include <linux/tty.h>
 #include <linux/tty_driver.h>
@@ -36,6 +38,7 @@
 
 #define MAX_SMD_TTYS 37
 #define MAX_TTY_BUF_SIZE 2048
+#define MIN_TTY_BUF_SIZE 128
 
 static DEFINE_MUTEX(smd_tty_lock);
 
@@ -58,6 +61,16 @@ struct smd_tty_info {
 	int is_open;
 	wait_queue_head_t ch_opened_wait_queue;
 	spinlock_t reset_lock;
+
+	/* largest flip buffer request, shrunk while the tty layer is short */
+	int rx_chunk;
+
+	/* rx statistics, reported in debugfs smd_tty/stats */
+	unsigned long rx_bytes;
+	unsigned long rx_pushes;
+	unsigned long rx_throttled;
+	unsigned long rx_flip_full;
+	unsigned int rx_max_batch;
 };
 
 #define LOOPBACK_IDX 36
@@ -102,10 +115,32 @@ static void buf_req_retry(unsigned long param)
 	tasklet_hi_schedule(&info->tty_tsklt);
 }
 
+/* Hand what has been copied so far to the line discipline */
+static void smd_tty_push(struct smd_tty_info *info, int batch)
+{
+	if (!batch)
+		return;
+
+	info->rx_bytes += batch;
+	info->rx_pushes++;
+	if (batch > info->rx_max_batch)
+		info->rx_max_batch = batch;
+
+	wake_lock_timeout(&info->wake_lock, HZ / 2);
+	tty_flip_buffer_push(info->tty);
+}
+
+/*
+ * Copies straight from the fifo into the flip buffer, one contiguous span
+ * at a time, and pushes once per MAX_TTY_BUF_SIZE batch rather than once
+ * per chunk. The batch limit gives the line discipline a chance to
+ * throttle us before a flood fills the tty buffers.
+ */
 static void smd_tty_read(unsigned long param)
 {
 	unsigned char *ptr;
-	int avail;
+	void *src;
+	int avail, batch = 0;
 	struct smd_tty_info *info = (struct smd_tty_info *)param;
 	struct tty_struct *tty = info->tty;
 
@@ -114,22 +149,31 @@ static void smd_tty_read(unsigned long param)
 
 	for (;;) {
 		if (is_in_reset(info)) {
+			smd_tty_push(info, batch);
 			/* signal TTY clients using TTY_BREAK */
 			tty_insert_flip_char(tty, 0x00, TTY_BREAK);
 			tty_flip_buffer_push(tty);
+			return;
+		}
+
+		if (test_bit(TTY_THROTTLED, &tty->flags)) {
+			/* smd_tty_unthrottle() reschedules us */
+			info->rx_throttled++;
 			break;
 		}
 
-		if (test_bit(TTY_THROTTLED, &tty->flags)) break;
-		avail = smd_read_avail(info->ch);
-		if (avail == 0)
+		avail = smd_read_reserve(info->ch, &src);
+		if (avail <= 0)
 			break;
 
-		if (avail > MAX_TTY_BUF_SIZE)
-			avail = MAX_TTY_BUF_SIZE;
+		if (avail > info->rx_chunk)
+			avail = info->rx_chunk;
 
 		avail = tty_prepare_flip_string(tty, &ptr, avail);
 		if (avail <= 0) {
+			info->rx_flip_full++;
+			if (info->rx_chunk > MIN_TTY_BUF_SIZE)
+				info->rx_chunk >>= 1;
 			if (!timer_pending(&info->buf_req_timer)) {
 				init_timer(&info->buf_req_timer);
 				info->buf_req_timer.expires = jiffies +
@@ -138,10 +182,12 @@ static void smd_tty_read(unsigned long param)
 				info->buf_req_timer.data = param;
 				add_timer(&info->buf_req_timer);
 			}
+			smd_tty_push(info, batch);
 			return;
 		}
 
-		if (smd_read(info->ch, ptr, avail) != avail) {
+		memcpy(ptr, src, avail);
+		if (smd_read_commit(info->ch, avail) != avail) {
 			/* shouldn't be possible since we're in interrupt
 			** context here and nobody else could 'steal' our
 			** characters.
@@ -149,10 +195,18 @@ static void smd_tty_read(unsigned long param)
 			printk(KERN_ERR "OOPS - smd_tty_buffer mismatch?!");
 		}
 
-		wake_lock_timeout(&info->wake_lock, HZ / 2);
-		tty_flip_buffer_push(tty);
+		if (info->rx_chunk < MAX_TTY_BUF_SIZE)
+			info->rx_chunk <<= 1;
+
+		batch += avail;
+		if (batch >= MAX_TTY_BUF_SIZE) {
+			smd_tty_push(info, batch);
+			batch = 0;
+		}
 	}
 
+	smd_tty_push(info, batch);
+
 	/* XXX only when writable and necessary */
 	tty_wakeup(tty);
 }
@@ -198,7 +252,7 @@ static void smd_tty_notify(void *priv, unsigned event)
 
 		if (info->tty->index == LOOPBACK_IDX)
 			schedule_delayed_work(&loopback_work,
-					msecs_to_jiffies(1000));
+				round_jiffies_relative(msecs_to_jiffies(1000)));
 		break;
 	}
 }
@@ -281,6 +335,7 @@ static int smd_tty_open(struct tty_struct *tty, struct file *f)
 
 
 		info->tty = tty;
+		info->rx_chunk = MAX_TTY_BUF_SIZE;
 		tasklet_init(&info->tty_tsklt, smd_tty_read,
 			     (unsigned long)info);
 		wake_lock_init(&info->wake_lock, WAKE_LOCK_SUSPEND,
@@ -431,12 +486,59 @@ static void loopback_probe_worker(struct work_struct *work)
 {
 	/* wait for modem to restart before requesting loopback server */
 	if (!is_modem_smsm_inited())
-		schedule_delayed_work(&loopback_work, msecs_to_jiffies(1000));
+		schedule_delayed_work(&loopback_work,
+				round_jiffies_relative(msecs_to_jiffies(1000)));
 	else
 		smsm_change_state(SMSM_APPS_STATE,
 			  0, SMSM_SMD_LOOPBACK);
 }
 
+#if defined(CONFIG_DEBUG_FS)
+static int smd_tty_stats_show(struct seq_file *m, void *unused)
+{
+	struct smd_tty_info *info;
+	int n;
+
+	seq_printf(m, "%-16s %10s %8s %9s %9s %6s %6s\n", "channel",
+		   "bytes", "pushes", "throttled", "flip_full", "batch",
+		   "chunk");
+	for (n = 0; n < MAX_SMD_TTYS; n++) {
+		if (!smd_ch_name[n])
+			continue;
+		info = smd_tty + n;
+		seq_printf(m, "%-16s %10lu %8lu %9lu %9lu %6u %6d\n",
+			   smd_ch_name[n], info->rx_bytes, info->rx_pushes,
+			   info->rx_throttled, info->rx_flip_full,
+			   info->rx_max_batch, info->rx_chunk);
+	}
+	return 0;
+}
+
+static int smd_tty_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, smd_tty_stats_show, NULL);
+}
+
+static const struct file_operations smd_tty_stats_fops = {
+	.open		= smd_tty_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init smd_tty_debugfs_init(void)
+{
+	struct dentry *dent;
+
+	dent = debugfs_create_dir("smd_tty", 0);
+	if (IS_ERR_OR_NULL(dent))
+		return;
+	debugfs_create_file("stats", 0444, dent, NULL, &smd_tty_stats_fops);
+}
+#else
+static inline void smd_tty_debugfs_init(void) { }
+#endif
+
 static struct tty_operations smd_tty_ops = {
 	.open = smd_tty_open,
 	.close = smd_tty_close,
@@ -638,6 +740,7 @@ static int __init smd_tty_init(void)
 	if (ret)
 		goto unreg27;
 
+	smd_tty_debugfs_init();
 	return 0;
 
 unreg27:
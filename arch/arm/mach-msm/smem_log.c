@@ -69,12 +69,17 @@
 #include <linux/debugfs.h>
 #include <linux/io.h>
 #include <linux/string.h>
+#include <linux/percpu.h>
+#include <linux/irqflags.h>
 
 #include <mach/msm_iomap.h>
 #include <mach/smem_log.h>
 
 #include "smd_private.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/smem_log.h>
+
 #define DEBUG
 #undef DEBUG
 
@@ -148,6 +153,24 @@ enum smem_logs {
 
 static struct smem_log_inst inst[NUM];
 
+/*
+ * Apps-only events do not need to be seen by the other processors, so
+ * they are kept in a per-cpu ring instead of the shared log.  Writers
+ * only disable local interrupts; the remote spinlock is reserved for
+ * events that have to land in shared memory.
+ */
+#define SMEM_LOG_NUM_LOCAL_ENTRIES 512
+
+struct smem_log_local {
+	struct smem_log_item events[SMEM_LOG_NUM_LOCAL_ENTRIES];
+	unsigned int idx;
+};
+
+static DEFINE_PER_CPU(struct smem_log_local, smem_log_local);
+
+static int local_events = 1;
+module_param(local_events, int, S_IRUGO | S_IWUSR);
+
 #if defined(CONFIG_DEBUG_FS)
 
 #define HSIZE 13
@@ -1010,13 +1033,54 @@ static void smem_log_event_from_user(struct smem_log_inst *inst,
 	remote_spin_unlock_irqrestore(inst->remote_spinlock, flags);
 }
 
+/*
+ * Events raised by the apps processor about its own state stay local,
+ * except for the power, sleep and shared memory protocol bases which
+ * the modem side tools need to line up with their own timeline.
+ */
+static inline int smem_log_is_local(uint32_t id)
+{
+	if (!local_events)
+		return 0;
+
+	if ((id & SMEM_LOG_PROC_ID_APPS) != SMEM_LOG_PROC_ID_APPS ||
+	    (id & SMEM_LOG_PROC_ID_Q6))
+		return 0;
+
+	switch (id & 0x0fff0000) {
+	case SMEM_LOG_SMEM_EVENT_BASE:
+	case SMEM_LOG_DEM_EVENT_BASE:
+	case SMEM_LOG_ERROR_EVENT_BASE:
+	case SMEM_LOG_DCVS_EVENT_BASE:
+	case SMEM_LOG_SLEEP_EVENT_BASE:
+		return 0;
+	}
+
+	return 1;
+}
+
+static void smem_log_local_event(struct smem_log_item *item, int count)
+{
+	struct smem_log_local *local;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	local = &__get_cpu_var(smem_log_local);
+	while (count--) {
+		local->events[local->idx] = *item++;
+		if (++local->idx >= SMEM_LOG_NUM_LOCAL_ENTRIES)
+			local->idx = 0;
+	}
+	local_irq_restore(flags);
+}
+
 static void _smem_log_event(
 	struct smem_log_item __iomem *events,
 	uint32_t __iomem *_idx,
 	remote_spinlock_t *lock,
 	int num,
 	uint32_t id, uint32_t data1, uint32_t data2,
-	uint32_t data3)
+	uint32_t data3, int local)
 {
 	struct smem_log_item item;
 	uint32_t idx;
@@ -1029,6 +1093,13 @@ static void _smem_log_event(
 	item.data2 = data2;
 	item.data3 = data3;
 
+	trace_smem_log_event(id, item.timetick, data1, data2, data3);
+
+	if (local) {
+		smem_log_local_event(&item, 1);
+		return;
+	}
+
 	remote_spin_lock_irqsave(lock, flags);
 
 	idx = *_idx;
@@ -1053,7 +1124,7 @@ static void _smem_log_event6(
 	int num,
 	uint32_t id, uint32_t data1, uint32_t data2,
 	uint32_t data3, uint32_t data4, uint32_t data5,
-	uint32_t data6)
+	uint32_t data6, int local)
 {
 	struct smem_log_item item[2];
 	uint32_t idx;
@@ -1071,6 +1142,14 @@ static void _smem_log_event6(
 	item[1].data2 = data5;
 	item[1].data3 = data6;
 
+	trace_smem_log_event6(id, item[0].timetick, data1, data2, data3,
+			      data4, data5, data6);
+
+	if (local) {
+		smem_log_local_event(item, 2);
+		return;
+	}
+
 	remote_spin_lock_irqsave(lock, flags);
 
 	idx = *_idx;
@@ -1093,7 +1172,7 @@ void smem_log_event(uint32_t id, uint32_t data1, uint32_t data2,
 {
 	_smem_log_event(inst[GEN].events, inst[GEN].idx,
 			inst[GEN].remote_spinlock, SMEM_LOG_NUM_ENTRIES,
-			id, data1, data2, data3);
+			id, data1, data2, data3, smem_log_is_local(id));
 }
 
 void smem_log_event6(uint32_t id, uint32_t data1, uint32_t data2,
@@ -1102,7 +1181,8 @@ void smem_log_event6(uint32_t id, uint32_t data1, uint32_t data2,
 {
 	_smem_log_event6(inst[GEN].events, inst[GEN].idx,
 			 inst[GEN].remote_spinlock, SMEM_LOG_NUM_ENTRIES,
-			 id, data1, data2, data3, data4, data5, data6);
+			 id, data1, data2, data3, data4, data5, data6,
+			 smem_log_is_local(id));
 }
 
 void smem_log_event_to_static(uint32_t id, uint32_t data1, uint32_t data2,
@@ -1110,7 +1190,7 @@ void smem_log_event_to_static(uint32_t id, uint32_t data1, uint32_t data2,
 {
 	_smem_log_event(inst[STA].events, inst[STA].idx,
 			inst[STA].remote_spinlock, SMEM_LOG_NUM_STATIC_ENTRIES,
-			id, data1, data2, data3);
+			id, data1, data2, data3, 0);
 }
 
 void smem_log_event6_to_static(uint32_t id, uint32_t data1, uint32_t data2,
@@ -1119,7 +1199,7 @@ void smem_log_event6_to_static(uint32_t id, uint32_t data1, uint32_t data2,
 {
 	_smem_log_event6(inst[STA].events, inst[STA].idx,
 			 inst[STA].remote_spinlock, SMEM_LOG_NUM_STATIC_ENTRIES,
-			 id, data1, data2, data3, data4, data5, data6);
+			 id, data1, data2, data3, data4, data5, data6, 0);
 }
 
 static int _smem_log_init(void)
@@ -1962,6 +2042,35 @@ static int debug_dump_power_sym(char *buf, int max)
 	return _debug_dump_sym(POW, buf, max);
 }
 
+/* Lockless snapshot; a record being written concurrently may be torn. */
+static int debug_dump_local(char *buf, int max)
+{
+	struct smem_log_local *local;
+	struct smem_log_item *item;
+	unsigned int idx, n;
+	int cpu;
+	int i = 0;
+
+	for_each_possible_cpu(cpu) {
+		local = &per_cpu(smem_log_local, cpu);
+		idx = local->idx;
+		for (n = 0; n < SMEM_LOG_NUM_LOCAL_ENTRIES; n++) {
+			item = &local->events[idx];
+			if (++idx >= SMEM_LOG_NUM_LOCAL_ENTRIES)
+				idx = 0;
+			if (!item->identifier)
+				continue;
+
+			i += scnprintf(buf + i, max - i,
+				       "%d %08x %08x %08x %08x %08x\n",
+				       cpu, item->identifier, item->timetick,
+				       item->data1, item->data2, item->data3);
+		}
+	}
+
+	return i;
+}
+
 #define SMEM_LOG_ITEM_PRINT_SIZE 160
 
 #define EVENTS_PRINT_SIZE \
@@ -2010,6 +2119,7 @@ static void smem_log_debugfs_init(void)
 	debug_create("dump_static_sym", 0444, dent, debug_dump_static_sym);
 	debug_create("dump_power", 0444, dent, debug_dump_power);
 	debug_create("dump_power_sym", 0444, dent, debug_dump_power_sym);
+	debug_create("dump_local", 0444, dent, debug_dump_local);
 }
 #else
 static void smem_log_debugfs_init(void) {}
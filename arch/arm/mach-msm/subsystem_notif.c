@@ -16,8 +16,15 @@
  * Use subsys_notif_register_notifier to register for notifications
  * and subsys_notif_queue_notification to send notifications.
  *
+ * The notifiers of one subsystem are called concurrently, from the async
+ * thread pool, so that the slow teardown of one client does not hold up
+ * the others. Notifiers of different priorities still run in priority
+ * order, each priority waiting for the one above it to finish.
+ *
  */
 
+#include <linux/async.h>
+#include <linux/hrtimer.h>
 #include <linux/notifier.h>
 #include <linux/init.h>
 #include <linux/debugfs.h>
@@ -35,6 +42,12 @@ struct subsys_notif_info {
 	struct list_head list;
 };
 
+struct subsys_notif_call {
+	struct notifier_block *nb;
+	struct subsys_notif_info *subsys;
+	enum subsys_notif_type notif_type;
+};
+
 static LIST_HEAD(subsystem_list);
 static DEFINE_MUTEX(notif_lock);
 static DEFINE_MUTEX(notif_add_lock);
@@ -43,6 +56,27 @@ static DEFINE_MUTEX(notif_add_lock);
 static void subsys_notif_reg_test_notifier(const char *);
 #endif
 
+static const char *notif_to_string(enum subsys_notif_type notif_type)
+{
+	switch (notif_type) {
+
+	case	SUBSYS_BEFORE_SHUTDOWN:
+		return __stringify(SUBSYS_BEFORE_SHUTDOWN);
+
+	case	SUBSYS_AFTER_SHUTDOWN:
+		return __stringify(SUBSYS_AFTER_SHUTDOWN);
+
+	case	SUBSYS_BEFORE_POWERUP:
+		return __stringify(SUBSYS_BEFORE_POWERUP);
+
+	case	SUBSYS_AFTER_POWERUP:
+		return __stringify(SUBSYS_AFTER_POWERUP);
+
+	default:
+		return "unknown";
+	}
+}
+
 static struct subsys_notif_info *_notif_find_subsys(const char *subsys_name)
 {
 	struct subsys_notif_info *subsys;
@@ -146,12 +180,29 @@ done:
 }
 EXPORT_SYMBOL(subsys_notif_add_subsys);
 
+static void subsys_notif_call(void *data, async_cookie_t cookie)
+{
+	struct subsys_notif_call *call = data;
+	ktime_t start = ktime_get();
+
+	call->nb->notifier_call(call->nb, call->notif_type, call->subsys);
+
+	pr_info("subsys-notif: %s %s: %pf took %lld us\n",
+		call->subsys->name, notif_to_string(call->notif_type),
+		call->nb->notifier_call, ktime_us_delta(ktime_get(), start));
+}
+
 int subsys_notif_queue_notification(void *subsys_handle,
 					enum subsys_notif_type notif_type)
 {
 	int ret = 0;
 	struct subsys_notif_info *subsys =
 		(struct subsys_notif_info *) subsys_handle;
+	struct srcu_notifier_head *head;
+	struct subsys_notif_call *calls;
+	struct notifier_block *nb;
+	LIST_HEAD(domain);
+	int idx, i = 0, n = 0;
 
 	if (!subsys)
 		return -EINVAL;
@@ -159,36 +210,45 @@ int subsys_notif_queue_notification(void *subsys_handle,
 	if (notif_type < 0 || notif_type >= SUBSYS_NOTIF_TYPE_COUNT)
 		return -EINVAL;
 
-	ret = srcu_notifier_call_chain(
-		&subsys->subsys_notif_rcvr_list, notif_type,
-		(void *)subsys);
-
-	return ret;
-}
-EXPORT_SYMBOL(subsys_notif_queue_notification);
-
-#if defined(SUBSYS_RESTART_DEBUG)
-static const char *notif_to_string(enum subsys_notif_type notif_type)
-{
-	switch (notif_type) {
+	head = &subsys->subsys_notif_rcvr_list;
+	idx = srcu_read_lock(&head->srcu);
 
-	case	SUBSYS_BEFORE_SHUTDOWN:
-		return __stringify(SUBSYS_BEFORE_SHUTDOWN);
+	for (nb = rcu_dereference_raw(head->head); nb;
+	     nb = rcu_dereference_raw(nb->next))
+		n++;
 
-	case	SUBSYS_AFTER_SHUTDOWN:
-		return __stringify(SUBSYS_AFTER_SHUTDOWN);
+	calls = n ? kcalloc(n, sizeof(*calls), GFP_KERNEL) : NULL;
+	if (!calls) {
+		srcu_read_unlock(&head->srcu, idx);
+		if (!n)
+			return 0;
+		return srcu_notifier_call_chain(head, notif_type,
+						(void *)subsys);
+	}
 
-	case	SUBSYS_BEFORE_POWERUP:
-		return __stringify(SUBSYS_BEFORE_POWERUP);
+	/* The read lock is held until every call is done, keeping the
+	 * blocks registered while the async threads use them.
+	 */
+	for (nb = rcu_dereference_raw(head->head); nb && i < n;
+	     nb = rcu_dereference_raw(nb->next), i++) {
+		if (i && nb->priority != calls[i - 1].nb->priority)
+			async_synchronize_full_domain(&domain);
+
+		calls[i].nb = nb;
+		calls[i].subsys = subsys;
+		calls[i].notif_type = notif_type;
+		async_schedule_domain(subsys_notif_call, &calls[i], &domain);
+	}
+	async_synchronize_full_domain(&domain);
 
-	case	SUBSYS_AFTER_POWERUP:
-		return __stringify(SUBSYS_AFTER_POWERUP);
+	srcu_read_unlock(&head->srcu, idx);
+	kfree(calls);
 
-	default:
-		return "unknown";
-	}
+	return ret;
 }
+EXPORT_SYMBOL(subsys_notif_queue_notification);
 
+#if defined(SUBSYS_RESTART_DEBUG)
 static int subsys_notifier_test_call(struct notifier_block *this,
 				  unsigned long code,
 				  void *data)
@@ -19,6 +19,7 @@
 #include <linux/delay.h>
 #include <linux/list.h>
 #include <linux/io.h>
+#include <linux/hrtimer.h>
 #include <linux/kthread.h>
 #include <linux/time.h>
 
@@ -225,12 +226,16 @@ static void _send_notification_to_order(struct subsys_data
 			**restart_list, int count,
 			enum subsys_notif_type notif_type)
 {
+	ktime_t start = ktime_get();
 	int i;
 
 	for (i = 0; i < count; i++)
 		if (restart_list[i])
 			subsys_notif_queue_notification(
 				restart_list[i]->notif_handle, notif_type);
+
+	pr_info("subsys-restart: notification %d took %lld us\n",
+		notif_type, ktime_us_delta(ktime_get(), start));
 }
 
 static int max_restarts;
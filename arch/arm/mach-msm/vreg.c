@@ -18,15 +18,28 @@
 #include <linux/device.h>
 #include <linux/init.h>
 #include <linux/debugfs.h>
+#include <linux/spinlock.h>
 #include <mach/vreg.h>
 
 #include "proc_comm.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/vreg.h>
+
 struct vreg {
 	const char *name;
 	unsigned id;
+	unsigned cached;	/* VREG_CACHED_* bits valid below */
+	unsigned enabled;
+	unsigned mv;
 };
 
+#define VREG_CACHED_SWITCH	BIT(0)
+#define VREG_CACHED_LEVEL	BIT(1)
+
+/* Serializes votes with the record of what the modem was last sent */
+static DEFINE_SPINLOCK(vreg_lock);
+
 #define VREG(_name, _id) { .name = _name, .id = _id, }
 
 static struct vreg vregs[] = {
@@ -96,24 +109,56 @@ void vreg_put(struct vreg *vreg)
 {
 }
 
-int vreg_enable(struct vreg *vreg)
+/*
+ * The modem keeps a single vote per vreg for the apps processor, so
+ * sending the state it already has changes nothing. Skip those repeats
+ * and save the round trip; a failed vote forgets the state so the next
+ * one is always sent.
+ */
+static int vreg_vote(struct vreg *vreg, unsigned cmd, unsigned which,
+		     unsigned *last, unsigned val)
 {
+	unsigned long flags;
 	unsigned id = vreg->id;
-	unsigned enable = 1;
-	return msm_proc_comm(PCOM_VREG_SWITCH, &id, &enable);
+	unsigned data = val;
+	int rc = 0;
+
+	spin_lock_irqsave(&vreg_lock, flags);
+	if ((vreg->cached & which) && *last == val)
+		goto out;
+
+	rc = msm_proc_comm(cmd, &id, &data);
+	if (cmd == PCOM_VREG_SWITCH)
+		trace_vreg_switch(vreg->name, val, rc);
+	else
+		trace_vreg_set_level(vreg->name, val, rc);
+	if (rc == 0) {
+		vreg->cached |= which;
+		*last = val;
+	} else {
+		vreg->cached &= ~which;
+	}
+out:
+	spin_unlock_irqrestore(&vreg_lock, flags);
+	return rc;
+}
+
+int vreg_enable(struct vreg *vreg)
+{
+	return vreg_vote(vreg, PCOM_VREG_SWITCH, VREG_CACHED_SWITCH,
+			 &vreg->enabled, 1);
 }
 
 int vreg_disable(struct vreg *vreg)
 {
-	unsigned id = vreg->id;
-	unsigned enable = 0;
-	return msm_proc_comm(PCOM_VREG_SWITCH, &id, &enable);
+	return vreg_vote(vreg, PCOM_VREG_SWITCH, VREG_CACHED_SWITCH,
+			 &vreg->enabled, 0);
 }
 
 int vreg_set_level(struct vreg *vreg, unsigned mv)
 {
-	unsigned id = vreg->id;
-	return msm_proc_comm(PCOM_VREG_SET_LEVEL, &id, &mv);
+	return vreg_vote(vreg, PCOM_VREG_SET_LEVEL, VREG_CACHED_LEVEL,
+			 &vreg->mv, mv);
 }
 
 #if defined(CONFIG_DEBUG_FS)
@@ -170,6 +170,8 @@ static char *op_name_from_perf_id(enum arm_perf_pmu_ids id)
 		return "arm/armv7";
 	case ARM_PERF_PMU_ID_CA9:
 		return "arm/armv7-ca9";
+	case ARM_PERF_PMU_ID_SCORPION:
+		return "arm/armv7-scorpion";
 	default:
 		return NULL;
 	}
@@ -623,6 +623,12 @@ static void bfq_arm_slice_timer(struct bfq_data *bfqd)
 		jiffies_to_msecs(sl), jiffies_to_msecs(bfqd->bfq_slice_idle));
 }
 
+/* Should the flash profile be used on this device? */
+static inline int bfq_nonrot(struct bfq_data *bfqd)
+{
+	return bfqd->nonrot_tuning && blk_queue_nonrot(bfqd->queue);
+}
+
 /*
  * Set the maximum time for the active queue to consume its
  * budget. This prevents seeky processes from lowering the disk
@@ -949,6 +955,39 @@ static int bfq_update_peak_rate(struct bfq_data *bfqd, struct bfq_queue *bfqq,
 	return expected > (4 * bfqq->entity.budget) / 3;
 }
 
+/*
+ * On flash a request costs about the same whatever its position, so
+ * sectors are a poor measure of how much a queue has used the device:
+ * a queue doing small random reads holds it far longer per sector than
+ * a sequential one. Charge the expiring queue at least the service the
+ * device could have delivered at its peak rate during the time the
+ * queue was active, up to its budget. Returns 0 if the peak rate is not
+ * known yet.
+ */
+static int bfq_bfqq_charge_time(struct bfq_data *bfqd,
+				struct bfq_queue *bfqq, int compensate)
+{
+	struct bfq_entity *entity = &bfqq->entity;
+	u64 usecs, serv;
+	ktime_t end;
+
+	if (bfqd->peak_rate_samples < BFQ_PEAK_RATE_SAMPLES ||
+	    bfq_bfqq_budget_new(bfqq))
+		return 0;
+
+	end = compensate ? bfqd->last_idling_start : ktime_get();
+	usecs = ktime_to_us(ktime_sub(end, bfqd->last_budget_start));
+
+	serv = (usecs * bfqd->peak_rate) >> BFQ_RATE_SHIFT;
+	if (serv > entity->budget)
+		serv = entity->budget;
+	if (serv > entity->service) {
+		bfq_log_bfqq(bfqd, bfqq, "charge_time %llu usecs", usecs);
+		bfq_bfqq_served(bfqq, serv - entity->service);
+	}
+	return 1;
+}
+
 /**
  * bfq_bfqq_expire - expire a queue.
  * @bfqd: device owning the queue.
@@ -1002,10 +1041,15 @@ static void bfq_bfqq_expire(struct bfq_data *bfqd,
 	 * processes may timeout just for bad luck. To avoid punishing
 	 * them we do not charge a full budget to a process that
 	 * succeeded in consuming at least 2/3 of its budget.
+	 *
+	 * On flash the queue pays for the device time it used instead.
 	 */
-	if (slow || (reason == BFQ_BFQQ_BUDGET_TIMEOUT &&
-		     bfq_bfqq_budget_left(bfqq) >=  bfqq->entity.budget / 3))
-		bfq_bfqq_charge_full_budget(bfqq);
+	if (!bfq_nonrot(bfqd) ||
+	    !bfq_bfqq_charge_time(bfqd, bfqq, compensate)) {
+		if (slow || (reason == BFQ_BFQQ_BUDGET_TIMEOUT &&
+			bfq_bfqq_budget_left(bfqq) >= bfqq->entity.budget / 3))
+			bfq_bfqq_charge_full_budget(bfqq);
+	}
 
 	if (bfqd->low_latency && bfqq->raising_coeff == 1)
 		bfqq->last_rais_start_finish = jiffies;
@@ -1635,7 +1679,8 @@ static void bfq_update_idle_window(struct bfq_data *bfqd,
 	if (atomic_read(&cic->ioc->nr_tasks) == 0 ||
 	    bfqd->bfq_slice_idle == 0 ||
 		(bfqd->hw_tag && BFQQ_SEEKY(bfqq) &&
-			bfqq->raising_coeff == 1))
+			bfqq->raising_coeff == 1) ||
+		(bfq_nonrot(bfqd) && bfqq->raising_coeff == 1))
 		enable_idle = 0;
 	else if (bfq_sample_valid(cic->ttime_samples)) {
 		if (cic->ttime_mean > bfqd->bfq_slice_idle)
@@ -2153,6 +2198,7 @@ static void *bfq_init_queue(struct request_queue *q)
 	bfqd->bfq_timeout[BLK_RW_SYNC] = bfq_timeout_sync;
 
 	bfqd->low_latency = true;
+	bfqd->nonrot_tuning = true;
 
 	bfqd->bfq_raising_coeff = 20;
 	bfqd->bfq_raising_max_time = msecs_to_jiffies(7500);
@@ -2243,6 +2289,7 @@ SHOW_FUNCTION(bfq_max_budget_async_rq_show, bfqd->bfq_max_budget_async_rq, 0);
 SHOW_FUNCTION(bfq_timeout_sync_show, bfqd->bfq_timeout[BLK_RW_SYNC], 1);
 SHOW_FUNCTION(bfq_timeout_async_show, bfqd->bfq_timeout[BLK_RW_ASYNC], 1);
 SHOW_FUNCTION(bfq_low_latency_show, bfqd->low_latency, 0);
+SHOW_FUNCTION(bfq_nonrot_tuning_show, bfqd->nonrot_tuning, 0);
 SHOW_FUNCTION(bfq_raising_coeff_show, bfqd->bfq_raising_coeff, 0);
 SHOW_FUNCTION(bfq_raising_max_time_show, bfqd->bfq_raising_max_time, 1);
 SHOW_FUNCTION(bfq_raising_min_idle_time_show, bfqd->bfq_raising_min_idle_time,
@@ -2361,6 +2408,20 @@ static ssize_t bfq_low_latency_store(struct elevator_queue *e,
 	return ret;
 }
 
+static ssize_t bfq_nonrot_tuning_store(struct elevator_queue *e,
+				       const char *page, size_t count)
+{
+	struct bfq_data *bfqd = e->elevator_data;
+	unsigned int __data;
+	int ret = bfq_var_store(&__data, (page), count);
+
+	if (__data > 1)
+		__data = 1;
+	bfqd->nonrot_tuning = __data;
+
+	return ret;
+}
+
 #define BFQ_ATTR(name) \
 	__ATTR(name, S_IRUGO|S_IWUSR, bfq_##name##_show, bfq_##name##_store)
 
@@ -2376,6 +2437,7 @@ static struct elv_fs_entry bfq_attrs[] = {
 	BFQ_ATTR(timeout_sync),
 	BFQ_ATTR(timeout_async),
 	BFQ_ATTR(low_latency),
+	BFQ_ATTR(nonrot_tuning),
 	BFQ_ATTR(raising_coeff),
 	BFQ_ATTR(raising_max_time),
 	BFQ_ATTR(raising_min_idle_time),
@@ -207,6 +207,9 @@ struct bfq_group;
  *               they are charged for the whole allocated budget, to try
  *               to preserve a behavior reasonably fair among them, but
  *               without service-domain guarantees).
+ * @nonrot_tuning: on non-rotational devices, idle only for weight-raised
+ *                 queues, and charge expiring queues for the device time
+ *                 they used rather than only for the sectors they moved.
  * @bfq_raising_coeff: Maximum factor by which the weight of a boosted
  *                            queue is multiplied
  * @bfq_raising_max_time: maximum duration of a weight-raising period (jiffies)
@@ -265,6 +268,7 @@ struct bfq_data {
 	unsigned int bfq_timeout[2];
 
 	bool low_latency;
+	bool nonrot_tuning;
 
 	/* parameters of the low_latency heuristics */
 	unsigned int bfq_raising_coeff;
@@ -12,6 +12,12 @@
 * Asynchronous and synchronous requests are not treated separately, but
 * we relay on deadlines to ensure fairness.
 *
+* Sync reads issued from the foreground (tasks in the root cpu cgroup,
+* which is where Android keeps the interactive apps) are dispatched ahead
+* of everything else while they are queued. Expired requests still go out
+* first, but background writes only get bg_write_cap of them between two
+* foreground reads.
+*
 */
 #include <linux/blkdev.h>
 #include <linux/elevator.h>
@@ -19,6 +25,9 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/slab.h>
+#include <linux/cgroup.h>
+#include <linux/iocontext.h>
+#include <linux/ioprio.h>
 
 enum {
 ASYNC,
@@ -30,6 +39,12 @@ static const int sync_expire = HZ / 2; /* max time before a sync is submitted. *
 static const int async_expire = 5 * HZ; /* ditto for async, these limits are SOFT! */
 static const int fifo_batch = 1; /* # of sequential requests treated as one
 by the above parameters. For throughput. */
+static const int fg_priority = 1; /* serve foreground sync reads first. */
+static const int bg_write_cap = 1; /* expired async requests allowed between
+two foreground reads. */
+
+/* rq->elevator_private marks a sync read issued by the foreground */
+#define SIO_FG_READ ((void *) 1)
 
 /* Elevator data */
 struct sio_data {
@@ -38,12 +53,47 @@ struct list_head fifo_list[2];
 
 /* Attributes */
 unsigned int batched;
+unsigned int fg_reads;
+unsigned int bg_writes;
 
 /* Settings */
 int fifo_expire[2];
 int fifo_batch;
+int fg_priority;
+int bg_write_cap;
 };
 
+static int
+sio_current_foreground(void)
+{
+#ifdef CONFIG_CGROUP_SCHED
+struct cgroup_subsys_state *css;
+int root;
+
+rcu_read_lock();
+css = task_subsys_state(current, cpu_cgroup_subsys_id);
+root = !css->cgroup->parent;
+rcu_read_unlock();
+
+if (!root)
+return 0;
+#endif
+if (current->io_context &&
+IOPRIO_PRIO_CLASS(current->io_context->ioprio) == IOPRIO_CLASS_IDLE)
+return 0;
+
+return 1;
+}
+
+static inline void
+sio_forget_request(struct sio_data *sd, struct request *rq)
+{
+if (rq->elevator_private == SIO_FG_READ) {
+rq->elevator_private = NULL;
+sd->fg_reads--;
+}
+}
+
 static void
 sio_merged_requests(struct request_queue *q, struct request *rq,
 struct request *next)
@@ -60,6 +110,7 @@ rq_set_fifo_time(rq, rq_fifo_time(next));
 }
 
 /* Delete next request */
+sio_forget_request(q->elevator->elevator_data, next);
 rq_fifo_clear(next);
 }
 
@@ -75,6 +126,16 @@ const int sync = rq_is_sync(rq);
 */
 rq_set_fifo_time(rq, jiffies + sd->fifo_expire[sync]);
 list_add_tail(&rq->queuelist, &sd->fifo_list[sync]);
+
+/*
+* Requests are added from the submitting context, except for
+* plugged writeback which is async anyway.
+*/
+rq->elevator_private = NULL;
+if (sync && rq_data_dir(rq) == READ && sio_current_foreground()) {
+rq->elevator_private = SIO_FG_READ;
+sd->fg_reads++;
+}
 }
 
 static int
@@ -140,6 +201,34 @@ return rq_entry_fifo(sd->fifo_list[ASYNC].next);
 return NULL;
 }
 
+static struct request *
+sio_choose_foreground_request(struct sio_data *sd)
+{
+struct request *rq;
+
+rq = sio_expired_request(sd, SYNC);
+if (rq)
+return rq;
+
+/* Background writeback gets a few slots so it cannot expire forever */
+if (sd->bg_writes < sd->bg_write_cap) {
+rq = sio_expired_request(sd, ASYNC);
+if (rq) {
+sd->bg_writes++;
+return rq;
+}
+}
+
+list_for_each_entry(rq, &sd->fifo_list[SYNC], queuelist) {
+if (rq->elevator_private == SIO_FG_READ) {
+sd->bg_writes = 0;
+return rq;
+}
+}
+
+return NULL;
+}
+
 static inline void
 sio_dispatch_request(struct sio_data *sd, struct request *rq)
 {
@@ -147,6 +236,7 @@ sio_dispatch_request(struct sio_data *sd, struct request *rq)
 * Remove the request from the fifo list
 * and dispatch it.
 */
+sio_forget_request(sd, rq);
 rq_fifo_clear(rq);
 elv_dispatch_add_tail(rq->q, rq);
 
@@ -159,6 +249,15 @@ sio_dispatch_requests(struct request_queue *q, int force)
 struct sio_data *sd = q->elevator->elevator_data;
 struct request *rq = NULL;
 
+/* Foreground reads are waiting, they go before the usual batching */
+if (sd->fg_reads && sd->fg_priority) {
+rq = sio_choose_foreground_request(sd);
+if (rq) {
+sio_dispatch_request(sd, rq);
+return 1;
+}
+}
+
 /*
 * Retrieve any expired request after a batch of
 * sequential requests.
@@ -223,9 +322,13 @@ INIT_LIST_HEAD(&sd->fifo_list[ASYNC]);
 
 /* Initialize data */
 sd->batched = 0;
+sd->fg_reads = 0;
+sd->bg_writes = 0;
 sd->fifo_expire[SYNC] = sync_expire;
 sd->fifo_expire[ASYNC] = async_expire;
 sd->fifo_batch = fifo_batch;
+sd->fg_priority = fg_priority;
+sd->bg_write_cap = bg_write_cap;
 
 return sd;
 }
@@ -273,6 +376,8 @@ return sio_var_show(__data, (page)); \
 SHOW_FUNCTION(sio_sync_expire_show, sd->fifo_expire[SYNC], 1);
 SHOW_FUNCTION(sio_async_expire_show, sd->fifo_expire[ASYNC], 1);
 SHOW_FUNCTION(sio_fifo_batch_show, sd->fifo_batch, 0);
+SHOW_FUNCTION(sio_fg_priority_show, sd->fg_priority, 0);
+SHOW_FUNCTION(sio_bg_write_cap_show, sd->bg_write_cap, 0);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV) \
@@ -294,6 +399,8 @@ return ret; \
 STORE_FUNCTION(sio_sync_expire_store, &sd->fifo_expire[SYNC], 0, INT_MAX, 1);
 STORE_FUNCTION(sio_async_expire_store, &sd->fifo_expire[ASYNC], 0, INT_MAX, 1);
 STORE_FUNCTION(sio_fifo_batch_store, &sd->fifo_batch, 0, INT_MAX, 0);
+STORE_FUNCTION(sio_fg_priority_store, &sd->fg_priority, 0, 1, 0);
+STORE_FUNCTION(sio_bg_write_cap_store, &sd->bg_write_cap, 0, INT_MAX, 0);
 #undef STORE_FUNCTION
 
 #define DD_ATTR(name) \
@@ -304,6 +411,8 @@ static struct elv_fs_entry sio_attrs[] = {
 DD_ATTR(sync_expire),
 DD_ATTR(async_expire),
 DD_ATTR(fifo_batch),
+DD_ATTR(fg_priority),
+DD_ATTR(bg_write_cap),
 __ATTR_NULL
 };
 
@@ -15,6 +15,17 @@
 * Async and synch requests are not treated seperately. Instead we
 * rely on deadlines to ensure fairness.
 *
+* Setting `read_tokens' or `write_tokens' bounds the mix of reads and
+* writes instead: each round dispatches up to that many requests of
+* each direction, taking the nearest request of the other direction
+* once one runs out, and a new round starts when neither has tokens
+* left for what is queued. Expired requests are still served first.
+*
+* Queue time (insertion to dispatch to the driver) and service time
+* (dispatch to completion) are kept as histograms per direction in
+* the `read_latency' and `write_latency' attributes; writing to one
+* clears it.
+*
 */
 #include <linux/kernel.h>
 #include <linux/fs.h>
@@ -26,6 +37,8 @@
 #include <linux/init.h>
 #include <linux/compiler.h>
 #include <linux/rbtree.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
 
 #include <asm/div64.h>
 
@@ -43,6 +56,19 @@ static const int sync_expire = HZ / 2; /* max time before a sync is submitted. *
 static const int async_expire = 5 * HZ; /* ditto for async, these limits are SOFT! */
 static const int fifo_batch = 1;
 static const int rev_penalty = 0; /* penalty for reversing head direction */
+static const int read_tokens = 0; /* reads per round, 0 with write_tokens 0 is off */
+static const int write_tokens = 0; /* writes per round */
+
+/* power of two microsecond buckets, the last open ended */
+#define VR_HIST_BUCKETS 16
+
+struct vr_latency {
+unsigned long nr;
+u64 queue_us;
+u64 service_us;
+unsigned int queue_hist[VR_HIST_BUCKETS];
+unsigned int service_hist[VR_HIST_BUCKETS];
+};
 
 struct vr_data {
 struct rb_root sort_list;
@@ -59,8 +85,31 @@ int head_dir;
 int fifo_expire[2];
 int fifo_batch;
 int rev_penalty;
+int rw_tokens[2];
+
+int tokens[2]; /* left in this round, by rq_data_dir() */
+unsigned int nr_queued[2];
+
+struct vr_latency latency[2];
 };
 
+/*
+* Request timestamps in microseconds, truncated to unsigned long; only
+* differences are used. elevator_private holds the insertion time and
+* elevator_private2 the dispatch time.
+*/
+static inline unsigned long
+vr_now_us(void)
+{
+return (unsigned long)div_u64(sched_clock(), NSEC_PER_USEC);
+}
+
+static inline unsigned int
+vr_hist_bucket(unsigned long us)
+{
+return min_t(unsigned int, fls_long(us), VR_HIST_BUCKETS - 1);
+}
+
 static void vr_move_request(struct vr_data *, struct request *);
 
 static inline struct vr_data *
@@ -122,6 +171,8 @@ struct vr_data *vd = vr_get_data(q);
 const int dir = rq_is_sync(rq);
 
 vr_add_rq_rb(vd, rq);
+vd->nr_queued[rq_data_dir(rq)]++;
+rq->elevator_private = (void *)vr_now_us();
 
 if (vd->fifo_expire[dir]) {
 rq_set_fifo_time(rq, jiffies + vd->fifo_expire[dir]);
@@ -139,6 +190,30 @@ struct vr_data *vd = vr_get_data(q);
 
 rq_fifo_clear(rq);
 vr_del_rq_rb(vd, rq);
+vd->nr_queued[rq_data_dir(rq)]--;
+}
+
+static void
+vr_activate_request(struct request_queue *q, struct request *rq)
+{
+rq->elevator_private2 = (void *)vr_now_us();
+}
+
+static void
+vr_completed_request(struct request_queue *q, struct request *rq)
+{
+struct vr_data *vd = vr_get_data(q);
+struct vr_latency *lat = &vd->latency[rq_data_dir(rq)];
+unsigned long added = (unsigned long)rq->elevator_private;
+unsigned long started = (unsigned long)rq->elevator_private2;
+unsigned long queued = started - added;
+unsigned long service = vr_now_us() - started;
+
+lat->nr++;
+lat->queue_us += queued;
+lat->service_us += service;
+lat->queue_hist[vr_hist_bucket(queued)]++;
+lat->service_hist[vr_hist_bucket(service)]++;
 }
 
 static int
@@ -282,16 +357,74 @@ return next;
 return prev;
 }
 
+/*
+* Return the request of direction ddir closest to the head. Walks the
+* sort list from the cached neighbours, so it is linear in the number
+* of requests of the other direction in the way.
+*/
+static struct request *
+vr_nearest_dir(struct vr_data *vd, int ddir)
+{
+struct request *next = vd->next_rq;
+struct request *prev = vd->prev_rq;
+
+while (next && rq_data_dir(next) != ddir)
+next = elv_rb_latter_request(NULL, next);
+while (prev && rq_data_dir(prev) != ddir)
+prev = elv_rb_former_request(NULL, prev);
+
+if (!prev)
+return next;
+else if (!next)
+return prev;
+
+if (blk_rq_pos(next) - vd->last_sector <=
+vd->last_sector - blk_rq_pos(prev))
+return next;
+
+return prev;
+}
+
+/*
+* Charge rq against this round's tokens, or pick a request of the
+* other direction instead when rq's direction has none left.
+*/
+static struct request *
+vr_apply_tokens(struct vr_data *vd, struct request *rq, int expired)
+{
+int ddir = rq_data_dir(rq);
+struct request *other = NULL;
+
+if (!vd->tokens[ddir] && !expired &&
+vd->tokens[!ddir] && vd->nr_queued[!ddir])
+other = vr_nearest_dir(vd, !ddir);
+
+if (other) {
+rq = other;
+ddir = !ddir;
+} else if (!vd->tokens[ddir]) {
+vd->tokens[READ] = vd->rw_tokens[READ];
+vd->tokens[WRITE] = vd->rw_tokens[WRITE];
+}
+
+if (vd->tokens[ddir])
+vd->tokens[ddir]--;
+
+return rq;
+}
+
 static int
 vr_dispatch_requests(struct request_queue *q, int force)
 {
 struct vr_data *vd = vr_get_data(q);
 struct request *rq = NULL;
+int expired = 0;
 
 /* Check for and issue expired requests */
 if (vd->nbatched > vd->fifo_batch) {
 vd->nbatched = 0;
 rq = vr_check_fifo(vd);
+expired = rq != NULL;
 }
 
 if (!rq) {
@@ -300,6 +433,9 @@ if (!rq)
 return 0;
 }
 
+if (vd->rw_tokens[READ] || vd->rw_tokens[WRITE])
+rq = vr_apply_tokens(vd, rq, expired);
+
 vr_move_request(vd, rq);
 
 return 1;
@@ -338,6 +474,8 @@ vd->fifo_expire[SYNC] = sync_expire;
 vd->fifo_expire[ASYNC] = async_expire;
 vd->fifo_batch = fifo_batch;
 vd->rev_penalty = rev_penalty;
+vd->rw_tokens[READ] = read_tokens;
+vd->rw_tokens[WRITE] = write_tokens;
 return vd;
 }
 
@@ -371,6 +509,8 @@ SHOW_FUNCTION(vr_sync_expire_show, vd->fifo_expire[SYNC], 1);
 SHOW_FUNCTION(vr_async_expire_show, vd->fifo_expire[ASYNC], 1);
 SHOW_FUNCTION(vr_fifo_batch_show, vd->fifo_batch, 0);
 SHOW_FUNCTION(vr_rev_penalty_show, vd->rev_penalty, 0);
+SHOW_FUNCTION(vr_read_tokens_show, vd->rw_tokens[READ], 0);
+SHOW_FUNCTION(vr_write_tokens_show, vd->rw_tokens[WRITE], 0);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV) \
@@ -393,8 +533,50 @@ STORE_FUNCTION(vr_sync_expire_store, &vd->fifo_expire[SYNC], 0, INT_MAX, 1);
 STORE_FUNCTION(vr_async_expire_store, &vd->fifo_expire[ASYNC], 0, INT_MAX, 1);
 STORE_FUNCTION(vr_fifo_batch_store, &vd->fifo_batch, 0, INT_MAX, 0);
 STORE_FUNCTION(vr_rev_penalty_store, &vd->rev_penalty, 0, INT_MAX, 0);
+STORE_FUNCTION(vr_read_tokens_store, &vd->rw_tokens[READ], 0, INT_MAX, 0);
+STORE_FUNCTION(vr_write_tokens_store, &vd->rw_tokens[WRITE], 0, INT_MAX, 0);
 #undef STORE_FUNCTION
 
+/*
+* The statistics are updated under the queue lock but read and cleared
+* without it, so a line may be off by a request in flight.
+*/
+static ssize_t
+vr_latency_show(struct vr_latency *lat, char *page)
+{
+unsigned long nr = lat->nr;
+int len, i;
+
+len = sprintf(page, "requests %lu queue_avg %llu us service_avg %llu us\n",
+nr, nr ? div64_u64(lat->queue_us, nr) : 0,
+nr ? div64_u64(lat->service_us, nr) : 0);
+len += sprintf(page + len, "%11s %10s %10s\n", "us", "queue", "service");
+len += sprintf(page + len, "%8s us %10u %10u\n", "< 1",
+lat->queue_hist[0], lat->service_hist[0]);
+for (i = 1; i < VR_HIST_BUCKETS; i++)
+len += sprintf(page + len, "%8u us+%10u %10u\n", 1U << (i - 1),
+lat->queue_hist[i], lat->service_hist[i]);
+return len;
+}
+
+#define LATENCY_FUNCTION(__DIR, __NAME) \
+static ssize_t vr_##__NAME##_latency_show(struct elevator_queue *e, \
+char *page) \
+{ \
+struct vr_data *vd = e->elevator_data; \
+return vr_latency_show(&vd->latency[__DIR], page); \
+} \
+static ssize_t vr_##__NAME##_latency_store(struct elevator_queue *e, \
+const char *page, size_t count) \
+{ \
+struct vr_data *vd = e->elevator_data; \
+memset(&vd->latency[__DIR], 0, sizeof(vd->latency[__DIR])); \
+return count; \
+}
+LATENCY_FUNCTION(READ, read);
+LATENCY_FUNCTION(WRITE, write);
+#undef LATENCY_FUNCTION
+
 #define DD_ATTR(name) \
 __ATTR(name, S_IRUGO|S_IWUSR, vr_##name##_show, \
 vr_##name##_store)
@@ -404,6 +586,10 @@ DD_ATTR(sync_expire),
 DD_ATTR(async_expire),
 DD_ATTR(fifo_batch),
 DD_ATTR(rev_penalty),
+DD_ATTR(read_tokens),
+DD_ATTR(write_tokens),
+DD_ATTR(read_latency),
+DD_ATTR(write_latency),
 __ATTR_NULL
 };
 
@@ -414,6 +600,8 @@ static struct elevator_type iosched_vr = {
 .elevator_merge_req_fn = vr_merged_requests,
 .elevator_dispatch_fn = vr_dispatch_requests,
 .elevator_add_req_fn = vr_add_request,
+.elevator_activate_req_fn = vr_activate_request,
+.elevator_completed_req_fn = vr_completed_request,
 .elevator_queue_empty_fn = vr_queue_empty,
 .elevator_former_req_fn = elv_rb_former_request,
 .elevator_latter_req_fn = elv_rb_latter_request,
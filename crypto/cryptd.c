@@ -24,6 +24,7 @@
 #include <linux/slab.h>
 
 #define CRYPTD_MAX_CPU_QLEN 100
+#define CRYPTD_BATCH 16
 
 struct cryptd_cpu_queue {
 	struct crypto_queue queue;
@@ -107,29 +108,33 @@ static int cryptd_enqueue_request(struct cryptd_queue *queue,
 	return err;
 }
 
-/* Called in workqueue context, do one real cryption work (via
- * req->complete) and reschedule itself if there are more work to
- * do. */
+/* Called in workqueue context, do up to CRYPTD_BATCH real cryption
+ * works (via req->complete) and reschedule itself if there are more
+ * work to do. */
 static void cryptd_queue_worker(struct work_struct *work)
 {
 	struct cryptd_cpu_queue *cpu_queue;
 	struct crypto_async_request *req, *backlog;
+	int n = 0;
 
 	cpu_queue = container_of(work, struct cryptd_cpu_queue, work);
-	/* Only handle one request at a time to avoid hogging crypto
-	 * workqueue. preempt_disable/enable is used to prevent
-	 * being preempted by cryptd_enqueue_request() */
-	preempt_disable();
-	backlog = crypto_get_backlog(&cpu_queue->queue);
-	req = crypto_dequeue_request(&cpu_queue->queue);
-	preempt_enable();
-
-	if (!req)
-		return;
-
-	if (backlog)
-		backlog->complete(backlog, -EINPROGRESS);
-	req->complete(req, 0);
+	/* Handle a bounded batch at a time to avoid hogging crypto
+	 * workqueue, while sparing a work dispatch for every small
+	 * request of a bulk stream. preempt_disable/enable is used to
+	 * prevent being preempted by cryptd_enqueue_request() */
+	do {
+		preempt_disable();
+		backlog = crypto_get_backlog(&cpu_queue->queue);
+		req = crypto_dequeue_request(&cpu_queue->queue);
+		preempt_enable();
+
+		if (!req)
+			return;
+
+		if (backlog)
+			backlog->complete(backlog, -EINPROGRESS);
+		req->complete(req, 0);
+	} while (++n < CRYPTD_BATCH && !need_resched());
 
 	if (cpu_queue->queue.qlen)
 		queue_work(kcrypto_wq, &cpu_queue->work);
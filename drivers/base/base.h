@@ -1,4 +1,6 @@
 
+#include <linux/async.h>
+
 /**
  * struct bus_type_private - structure to hold the private to the driver core portions of the bus_type structure.
  *
@@ -33,6 +35,7 @@ struct driver_private {
 	struct klist_node knode_bus;
 	struct module_kobject *mkobj;
 	struct device_driver *driver;
+	async_cookie_t attach_cookie;
 };
 #define to_driver(obj) container_of(obj, struct driver_private, kobj)
 
@@ -16,6 +16,7 @@
 #include <linux/slab.h>
 #include <linux/init.h>
 #include <linux/string.h>
+#include <linux/async.h>
 #include "base.h"
 #include "power/power.h"
 
@@ -641,9 +642,25 @@ static ssize_t driver_uevent_store(struct device_driver *drv,
 }
 static DRIVER_ATTR(uevent, S_IWUSR, NULL, driver_uevent_store);
 
+static void driver_attach_async(void *data, async_cookie_t cookie)
+{
+	struct device_driver *drv = data;
+	int error;
+
+	error = driver_attach(drv);
+	if (error)
+		printk(KERN_ERR "%s: driver_attach(%s) failed: %d\n",
+		       __func__, drv->name, error);
+}
+
 /**
  * bus_add_driver - Add a driver to the bus.
  * @drv: driver.
+ *
+ * A driver with @async_probe set is attached to its devices from an
+ * async thread once it is registered, so that slow probes of unrelated
+ * drivers overlap. wait_for_device_probe() and the end of the initcalls
+ * wait for these attaches like for any other async work.
  */
 int bus_add_driver(struct device_driver *drv)
 {
@@ -671,7 +688,7 @@ int bus_add_driver(struct device_driver *drv)
 	if (error)
 		goto out_unregister;
 
-	if (drv->bus->p->drivers_autoprobe) {
+	if (drv->bus->p->drivers_autoprobe && !drv->async_probe) {
 		error = driver_attach(drv);
 		if (error)
 			goto out_unregister;
@@ -701,6 +718,9 @@ int bus_add_driver(struct device_driver *drv)
 	}
 
 	kobject_uevent(&priv->kobj, KOBJ_ADD);
+
+	if (drv->bus->p->drivers_autoprobe && drv->async_probe)
+		priv->attach_cookie = async_schedule(driver_attach_async, drv);
 	return 0;
 
 out_unregister:
@@ -725,6 +745,10 @@ void bus_remove_driver(struct device_driver *drv)
 	if (!drv->bus)
 		return;
 
+	/* let a pending async attach finish before detaching */
+	if (drv->async_probe)
+		async_synchronize_cookie(drv->p->attach_cookie + 1);
+
 	if (!drv->suppress_bind_attrs)
 		remove_bind_files(drv);
 	driver_remove_attrs(drv->bus, drv);
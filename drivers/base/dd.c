@@ -24,6 +24,7 @@
 #include <linux/wait.h>
 #include <linux/async.h>
 #include <linux/pm_runtime.h>
+#include <linux/boot_profile.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -103,6 +104,7 @@ static DECLARE_WAIT_QUEUE_HEAD(probe_waitqueue);
 
 static int really_probe(struct device *dev, struct device_driver *drv)
 {
+	ktime_t start = boot_profile_start();
 	int ret = 0;
 
 	atomic_inc(&probe_count);
@@ -150,6 +152,7 @@ probe_failed:
 	 */
 	ret = 0;
 done:
+	boot_profile_probe(drv, dev, start, ret);
 	atomic_dec(&probe_count);
 	wake_up(&probe_waitqueue);
 	return ret;
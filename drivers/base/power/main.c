@@ -173,9 +173,11 @@ void device_pm_move_last(struct device *dev)
 	list_move_tail(&dev->power.entry, &dpm_list);
 }
 
+static char *pm_verb(int event);
+
 static ktime_t initcall_debug_start(struct device *dev)
 {
-	ktime_t calltime = ktime_set(0, 0);
+	ktime_t calltime = pm_profile_start();
 
 	if (initcall_debug) {
 		pr_info("calling  %s+ @ %i\n",
@@ -288,6 +290,7 @@ static int pm_op(struct device *dev,
 		error = -EINVAL;
 	}
 
+	pm_profile_record(dev_name(dev), pm_verb(state.event), calltime);
 	initcall_debug_report(dev, calltime, error);
 
 	return error;
@@ -307,7 +310,7 @@ static int pm_noirq_op(struct device *dev,
 			pm_message_t state)
 {
 	int error = 0;
-	ktime_t calltime = ktime_set(0, 0), delta, rettime;
+	ktime_t calltime = pm_profile_start(), delta, rettime;
 
 	if (initcall_debug) {
 		pr_info("calling  %s+ @ %i, parent: %s\n",
@@ -367,6 +370,8 @@ static int pm_noirq_op(struct device *dev,
 		error = -EINVAL;
 	}
 
+	pm_profile_record(dev_name(dev), state.event == PM_EVENT_RESUME ?
+			  "resume_noirq" : "suspend_noirq", calltime);
 	if (initcall_debug) {
 		rettime = ktime_get();
 		delta = ktime_sub(rettime, calltime);
@@ -533,6 +538,7 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
 	error = cb(dev);
 	suspend_report_result(cb, error);
 
+	pm_profile_record(dev_name(dev), "resume", calltime);
 	initcall_debug_report(dev, calltime, error);
 
 	return error;
@@ -900,6 +906,7 @@ static int legacy_suspend(struct device *dev, pm_message_t state,
 	error = cb(dev, state);
 	suspend_report_result(cb, error);
 
+	pm_profile_record(dev_name(dev), pm_verb(state.event), calltime);
 	initcall_debug_report(dev, calltime, error);
 
 	return error;
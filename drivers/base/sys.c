@@ -23,6 +23,7 @@
 #include <linux/mutex.h>
 #include <linux/interrupt.h>
 #include <linux/resume-trace.h>
+#include <linux/suspend.h>
 
 #include "base.h"
 
@@ -352,6 +353,7 @@ static void __sysdev_resume(struct sys_device *dev)
 {
 	struct sysdev_class *cls = dev->cls;
 	struct sysdev_driver *drv;
+	ktime_t calltime = pm_profile_start();
 
 	/* First, call the class-specific one */
 	if (cls->resume) {
@@ -376,6 +378,8 @@ static void __sysdev_resume(struct sys_device *dev)
 		WARN_ONCE(!irqs_disabled(),
 			"Interrupts enabled after %pF\n", drv->resume);
 	}
+
+	pm_profile_record(kobject_name(&dev->kobj), "sysdev_resume", calltime);
 }
 
 /**
@@ -414,6 +418,8 @@ int sysdev_suspend(pm_message_t state)
 			 kobject_name(&cls->kset.kobj));
 
 		list_for_each_entry(sysdev, &cls->kset.list, kobj.entry) {
+			ktime_t calltime = pm_profile_start();
+
 			pr_debug(" %s\n", kobject_name(&sysdev->kobj));
 
 			/* Call auxillary drivers first */
@@ -445,6 +451,9 @@ int sysdev_suspend(pm_message_t state)
 					"Interrupts enabled after %pF\n",
 					cls->suspend);
 			}
+
+			pm_profile_record(kobject_name(&sysdev->kobj),
+					  "sysdev_suspend", calltime);
 		}
 	}
 	return 0;
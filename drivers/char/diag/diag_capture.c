@@ -0,0 +1,333 @@
+/* Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * On-device capture of modem diag traffic.
+ *
+ * In CAPTURE_MODE the HDLC stream read from the modem SMD channel is
+ * decoded here, log and event packets are matched against the capture
+ * masks, and the ones that match are appended to a ring that the logging
+ * process maps from /dev/diag. The ring starts with a struct
+ * diag_capture_hdr; the kernel only advances head and the reader only
+ * advances tail, so no read() is needed per packet.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/bitops.h>
+#include <linux/crc-ccitt.h>
+#include <linux/uaccess.h>
+#include <linux/diagchar.h>
+#include "diagchar.h"
+#include "diagchar_hdlc.h"
+#include "diag_capture.h"
+
+static unsigned int capture_size = SZ_1M;
+module_param(capture_size, uint, 0);
+
+#define DIAG_CAPTURE_FRAME_MAX	8192
+#define DIAG_LOG_F		0x10
+#define DIAG_EVENT_REPORT_F	0x60
+#define HDLC_GOOD_CRC		0xF0B8
+
+struct diag_capture {
+	struct diag_capture_hdr *hdr;	/* vmalloc_user()ed ring */
+	unsigned char *data;
+	uint32_t size;
+	wait_queue_head_t wait_q;
+
+	/* HDLC frame being reassembled, only touched by the SMD reader */
+	unsigned char frame[DIAG_CAPTURE_FRAME_MAX];
+	unsigned int frame_len;
+	int escaping;
+	int discard;
+
+	spinlock_t mask_lock;
+	DECLARE_BITMAP(log_mask, DIAG_CAPTURE_LOG_CODES);
+	DECLARE_BITMAP(event_mask, DIAG_CAPTURE_EVENT_IDS);
+};
+
+static struct diag_capture *capture;
+static DEFINE_MUTEX(capture_mutex);
+
+/* Allocate the ring on first use, it stays around until module exit */
+int diag_capture_start(void)
+{
+	struct diag_capture *cap;
+	uint32_t size;
+
+	mutex_lock(&capture_mutex);
+	if (capture) {
+		mutex_unlock(&capture_mutex);
+		return 0;
+	}
+
+	size = PAGE_ALIGN(max_t(uint32_t, capture_size, 2 * PAGE_SIZE));
+
+	cap = kzalloc(sizeof(*cap), GFP_KERNEL);
+	if (!cap) {
+		mutex_unlock(&capture_mutex);
+		return -ENOMEM;
+	}
+
+	cap->hdr = vmalloc_user(size);
+	if (!cap->hdr) {
+		kfree(cap);
+		mutex_unlock(&capture_mutex);
+		return -ENOMEM;
+	}
+
+	cap->data = (unsigned char *)cap->hdr + PAGE_SIZE;
+	cap->size = size - PAGE_SIZE;
+	cap->hdr->size = cap->size;
+	cap->hdr->data_offset = PAGE_SIZE;
+	init_waitqueue_head(&cap->wait_q);
+	spin_lock_init(&cap->mask_lock);
+
+	capture = cap;
+	mutex_unlock(&capture_mutex);
+	return 0;
+}
+
+void diag_capture_exit(void)
+{
+	if (!capture)
+		return;
+	vfree(capture->hdr);
+	kfree(capture);
+	capture = NULL;
+}
+
+static int diag_capture_put(struct diag_capture *cap, uint16_t type,
+			    const unsigned char *buf, unsigned int len)
+{
+	struct diag_capture_hdr *hdr = cap->hdr;
+	struct diag_capture_rec *rec;
+	uint32_t head, tail, used, need, skip;
+
+	need = ALIGN(sizeof(*rec) + len, 4);
+	head = hdr->head;
+	tail = ACCESS_ONCE(hdr->tail);
+	if (tail >= cap->size || (tail & 3)) {
+		/* reader scribbled on the header, resync */
+		tail = head;
+		hdr->tail = head;
+	}
+
+	used = head >= tail ? head - tail : cap->size - tail + head;
+	skip = cap->size - head < need ? cap->size - head : 0;
+	if (used + skip + need >= cap->size) {
+		hdr->dropped++;
+		return -ENOSPC;
+	}
+
+	if (skip) {
+		rec = (struct diag_capture_rec *)(cap->data + head);
+		rec->len = 0;
+		rec->type = DIAG_CAPTURE_WRAP;
+		head = 0;
+	}
+
+	rec = (struct diag_capture_rec *)(cap->data + head);
+	rec->len = len;
+	rec->type = type;
+	memcpy(rec->data, buf, len);
+
+	head += need;
+	if (head == cap->size)
+		head = 0;
+
+	/* record contents must be visible before the new head */
+	smp_wmb();
+	hdr->head = head;
+	return 0;
+}
+
+/* Returns 1 if any event in the report is enabled in the event mask */
+static int diag_capture_match_events(struct diag_capture *cap,
+				     const unsigned char *buf, unsigned int len)
+{
+	const unsigned char *p = buf + 3;
+	const unsigned char *end;
+	unsigned int total;
+	uint16_t id;
+
+	if (len < 3)
+		return 0;
+	total = buf[1] | (buf[2] << 8);
+	end = buf + min(len, total + 3);
+
+	while (p + 2 <= end) {
+		id = p[0] | (p[1] << 8);
+		if (test_bit(id & 0x0fff, cap->event_mask))
+			return 1;
+
+		/* truncated (2 byte) or full (8 byte) timestamp */
+		p += 2 + ((id & 0x8000) ? 2 : 8);
+
+		switch ((id >> 13) & 0x3) {
+		case 1:
+			p += 1;
+			break;
+		case 2:
+			p += 2;
+			break;
+		case 3:
+			if (p >= end)
+				return 0;
+			p += 1 + *p;
+			break;
+		}
+	}
+	return 0;
+}
+
+static void diag_capture_frame(struct diag_capture *cap,
+			       const unsigned char *buf, unsigned int len)
+{
+	uint16_t type;
+	unsigned long flags;
+	int match = 0;
+
+	/* payload, 2 crc bytes and the terminating CONTROL_CHAR */
+	if (len < 4 || crc_ccitt(0xffff, buf, len - 1) != HDLC_GOOD_CRC)
+		return;
+	len -= 3;
+
+	spin_lock_irqsave(&cap->mask_lock, flags);
+	switch (buf[0]) {
+	case DIAG_LOG_F:
+		/* cmd, more, length, then the log header: length, code */
+		if (len >= 8)
+			match = test_bit(buf[6] | (buf[7] << 8),
+					 cap->log_mask);
+		type = DIAG_CAPTURE_LOG;
+		break;
+	case DIAG_EVENT_REPORT_F:
+		match = diag_capture_match_events(cap, buf, len);
+		type = DIAG_CAPTURE_EVENT;
+		break;
+	default:
+		type = 0;
+		break;
+	}
+	spin_unlock_irqrestore(&cap->mask_lock, flags);
+
+	if (match && !diag_capture_put(cap, type, buf, len))
+		wake_up_interruptible(&cap->wait_q);
+}
+
+/* Called from the SMD read work with a chunk of the modem HDLC stream */
+void diag_capture_process(const unsigned char *buf, int len)
+{
+	struct diag_capture *cap = capture;
+	struct diag_hdlc_decode_type hdlc;
+
+	if (!cap || len <= 0)
+		return;
+
+	hdlc.src_ptr = (uint8_t *)buf;
+	hdlc.src_idx = 0;
+	hdlc.src_size = len;
+	hdlc.dest_ptr = cap->frame;
+	hdlc.dest_idx = cap->frame_len;
+	hdlc.dest_size = sizeof(cap->frame);
+	hdlc.escaping = cap->escaping;
+
+	while (hdlc.src_idx < hdlc.src_size) {
+		if (diag_hdlc_decode(&hdlc)) {
+			if (!cap->discard)
+				diag_capture_frame(cap, cap->frame,
+						   hdlc.dest_idx);
+			cap->discard = 0;
+			hdlc.dest_idx = 0;
+		} else if (hdlc.dest_idx >= hdlc.dest_size) {
+			/* too large to capture, skip to the next frame */
+			cap->discard = 1;
+			hdlc.dest_idx = 0;
+		}
+	}
+
+	cap->frame_len = hdlc.dest_idx;
+	cap->escaping = hdlc.escaping;
+}
+
+int diag_capture_set_mask(unsigned long arg)
+{
+	struct diag_capture_mask mask;
+	unsigned long *bits;
+	unsigned long flags;
+	unsigned int limit, i;
+	int rc;
+
+	if (copy_from_user(&mask, (void __user *)arg, sizeof(mask)))
+		return -EFAULT;
+
+	rc = diag_capture_start();
+	if (rc)
+		return rc;
+
+	if (mask.type == DIAG_CAPTURE_LOG) {
+		bits = capture->log_mask;
+		limit = DIAG_CAPTURE_LOG_CODES;
+	} else if (mask.type == DIAG_CAPTURE_EVENT) {
+		bits = capture->event_mask;
+		limit = DIAG_CAPTURE_EVENT_IDS;
+	} else
+		return -EINVAL;
+
+	if (mask.first > mask.last || mask.last >= limit)
+		return -EINVAL;
+
+	spin_lock_irqsave(&capture->mask_lock, flags);
+	for (i = mask.first; i <= mask.last; i++) {
+		if (mask.enable)
+			__set_bit(i, bits);
+		else
+			__clear_bit(i, bits);
+	}
+	spin_unlock_irqrestore(&capture->mask_lock, flags);
+	return 0;
+}
+
+int diag_capture_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+	int rc;
+
+	rc = diag_capture_start();
+	if (rc)
+		return rc;
+
+	if (vma->vm_pgoff || size > capture->size + PAGE_SIZE)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, capture->hdr, 0);
+}
+
+unsigned int diag_capture_poll(struct file *file, poll_table *wait)
+{
+	struct diag_capture *cap = capture;
+
+	if (!cap)
+		return 0;
+
+	poll_wait(file, &cap->wait_q, wait);
+	if (ACCESS_ONCE(cap->hdr->head) != ACCESS_ONCE(cap->hdr->tail))
+		return POLLIN | POLLRDNORM;
+	return 0;
+}
@@ -0,0 +1,26 @@
+/* Copyright (c) 2011, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef DIAG_CAPTURE_H
+#define DIAG_CAPTURE_H
+
+#include <linux/fs.h>
+#include <linux/poll.h>
+
+int diag_capture_start(void);
+void diag_capture_process(const unsigned char *buf, int len);
+int diag_capture_set_mask(unsigned long arg);
+int diag_capture_mmap(struct file *file, struct vm_area_struct *vma);
+unsigned int diag_capture_poll(struct file *file, poll_table *wait);
+void diag_capture_exit(void);
+
+#endif
@@ -30,6 +30,7 @@
 #include "diagfwd.h"
 #include "diagmem.h"
 #include "diagchar.h"
+#include "diag_capture.h"
 #include <linux/timer.h>
 #include "../../usb/gadget/f_diag.h"
 
@@ -304,13 +305,36 @@ static int diagchar_ioctl(struct inode *inode, struct file *filp,
 		driver->data_ready[i] |= DEINIT_TYPE;
 		wake_up_interruptible(&driver->wait_q);
 		success = 1;
+	} else if (iocmd == DIAG_IOCTL_CAPTURE_MASK) {
+		return diag_capture_set_mask(ioarg);
 	} else if (iocmd == DIAG_IOCTL_SWITCH_LOGGING) {
+		if ((int)ioarg == CAPTURE_MODE && diag_capture_start())
+			return -ENOMEM;
 		mutex_lock(&driver->diagchar_mutex);
 		temp = driver->logging_mode;
 		driver->logging_mode = (int)ioarg;
 		driver->logging_process_id = current->tgid;
 		mutex_unlock(&driver->diagchar_mutex);
-		if (temp == USB_MODE && driver->logging_mode == NO_LOGGING_MODE)
+		if (temp == driver->logging_mode)
+			return 1;
+		if (driver->logging_mode == CAPTURE_MODE) {
+			/* modem data is consumed by the capture ring */
+			if (temp == USB_MODE)
+				diagfwd_disconnect();
+			driver->in_busy_1 = 0;
+			driver->in_busy_2 = 0;
+			if (driver->ch)
+				queue_work(driver->diag_wq,
+					&(driver->diag_read_smd_work));
+		} else if (temp == CAPTURE_MODE) {
+			if (driver->logging_mode == USB_MODE)
+				diagfwd_connect();
+			else if (driver->logging_mode == NO_LOGGING_MODE) {
+				driver->in_busy_1 = 1;
+				driver->in_busy_2 = 1;
+			}
+		} else if (temp == USB_MODE &&
+			   driver->logging_mode == NO_LOGGING_MODE)
 			diagfwd_disconnect();
 		else if (temp == NO_LOGGING_MODE && driver->logging_mode
 								== USB_MODE)
@@ -817,6 +841,8 @@ static const struct file_operations diagcharfops = {
 	.read = diagchar_read,
 	.write = diagchar_write,
 	.ioctl = diagchar_ioctl,
+	.mmap = diag_capture_mmap,
+	.poll = diag_capture_poll,
 	.open = diagchar_open,
 	.release = diagchar_close
 };
@@ -1227,6 +1253,7 @@ fail:
 static void __exit diagchar_exit(void)
 {
 	printk(KERN_INFO "diagchar exiting ..\n");
+	diag_capture_exit();
 	diagmem_exit(driver);
 	diagfwd_exit();
 	diagchar_cleanup();
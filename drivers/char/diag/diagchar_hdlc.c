@@ -23,6 +23,8 @@
 #include <linux/device.h>
 #include <linux/uaccess.h>
 #include <linux/crc-ccitt.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
 #include "diagchar_hdlc.h"
 
 
@@ -33,6 +35,47 @@ MODULE_LICENSE("GPL v2");
 #define CRC_16_L_STEP(xx_crc, xx_c) \
 	crc_ccitt_byte(xx_crc, xx_c)
 
+#define HDLC_ONES	(~0UL / 0xff)
+#define HDLC_HIGHS	(HDLC_ONES * 0x80)
+#define HDLC_HAS_BYTE(w, c) \
+	((((w) ^ (HDLC_ONES * (c))) - HDLC_ONES) & \
+	 ~((w) ^ (HDLC_ONES * (c))) & HDLC_HIGHS)
+
+static inline int hdlc_special(uint8_t c)
+{
+	return c == CONTROL_CHAR || c == ESC_CHAR;
+}
+
+/*
+ * Return the length of the run at the start of src[0..len) that holds no
+ * CONTROL_CHAR or ESC_CHAR. Most diag traffic has long runs like this, so
+ * once src is aligned the scan goes a word at a time.
+ */
+static unsigned int hdlc_clear_run(const uint8_t *src, unsigned int len)
+{
+	const uint8_t *p = src;
+	const uint8_t *end = src + len;
+	unsigned long w;
+
+	while (p < end && ((unsigned long)p & (sizeof(unsigned long) - 1))) {
+		if (hdlc_special(*p))
+			return p - src;
+		p++;
+	}
+
+	while (end - p >= sizeof(unsigned long)) {
+		w = *(const unsigned long *)p;
+		if (HDLC_HAS_BYTE(w, CONTROL_CHAR) || HDLC_HAS_BYTE(w, ESC_CHAR))
+			break;
+		p += sizeof(unsigned long);
+	}
+
+	while (p < end && !hdlc_special(*p))
+		p++;
+
+	return p - src;
+}
+
 void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		      struct diag_hdlc_dest_type *enc)
 {
@@ -44,6 +87,7 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 	unsigned char src_byte = 0;
 	enum diag_send_state_enum_type state;
 	unsigned int used = 0;
+	unsigned int run;
 
 	if (src_desc && enc) {
 
@@ -69,6 +113,18 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 			   of 2 dest bytes for an escaped byte */
 			while (src <= src_last && dest <= dest_last) {
 
+				/* Copy bytes that need no escaping in bulk */
+				run = hdlc_clear_run(src, min(src_last - src,
+							dest_last - dest) + 1);
+				if (run) {
+					memcpy(dest, src, run);
+					crc = crc_ccitt(crc, src, run);
+					src += run;
+					dest += run;
+					used += run;
+					continue;
+				}
+
 				src_byte = *src++;
 
 				if ((src_byte == CONTROL_CHAR) ||
@@ -173,6 +229,7 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 
 	unsigned int len = 0;
 	unsigned int i;
+	unsigned int run;
 	uint8_t src_byte;
 
 	int pkt_bnd = 0;
@@ -191,6 +248,21 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 
 		for (i = 0; i < src_length; i++) {
 
+			/* Copy bytes that need no unescaping in bulk */
+			if (!hdlc->escaping) {
+				run = hdlc_clear_run(&src_ptr[i],
+						min(src_length - i,
+						    dest_length - len));
+				if (run) {
+					memcpy(&dest_ptr[len], &src_ptr[i], run);
+					len += run;
+					i += run;
+					if (len >= dest_length ||
+					    i >= src_length)
+						break;
+				}
+			}
+
 			src_byte = src_ptr[i];
 
 			if (hdlc->escaping) {
@@ -22,6 +22,7 @@
 #include <linux/platform_device.h>
 #include <linux/sched.h>
 #include <linux/workqueue.h>
+#include <linux/slab.h>
 #include <linux/diagchar.h>
 #include <mach/usbdiag.h>
 #include <mach/msm_smd.h>
@@ -29,6 +30,7 @@
 #include "diagchar.h"
 #include "diagfwd.h"
 #include "diagchar_hdlc.h"
+#include "diag_capture.h"
 #include <linux/pm_runtime.h>
 #include "../../usb/gadget/f_diag.h"
 
@@ -54,19 +56,22 @@ static unsigned int buf_tbl_size = 8; /*Number of entries in table of buffers */
 void __diag_smd_send_req(void)
 {
 	void *buf = NULL;
+	unsigned char **buf_ptr = NULL;
 	int *in_busy_ptr = NULL;
 	struct diag_request *write_ptr_modem = NULL;
 	int type;
 
 	if (!driver->in_busy_1) {
-		buf = driver->usb_buf_in_1;
+		buf_ptr = &driver->usb_buf_in_1;
 		write_ptr_modem = driver->usb_write_ptr_1;
 		in_busy_ptr = &(driver->in_busy_1);
 	} else if (!driver->in_busy_2) {
-		buf = driver->usb_buf_in_2;
+		buf_ptr = &driver->usb_buf_in_2;
 		write_ptr_modem = driver->usb_write_ptr_2;
 		in_busy_ptr = &(driver->in_busy_2);
 	}
+	if (buf_ptr)
+		buf = *buf_ptr;
 
 	if (driver->ch && buf) {
 		int r = smd_read_avail(driver->ch);
@@ -76,6 +81,9 @@ void __diag_smd_send_req(void)
 				printk(KERN_ALERT "\n diag: SMD sending in "
 						   "packets upto %d bytes", r);
 				buf = krealloc(buf, r, GFP_KERNEL);
+				/* write_complete matches on this pointer */
+				if (buf)
+					*buf_ptr = buf;
 			} else {
 				printk(KERN_ALERT "\n diag: SMD sending in "
 				"packets more than %d bytes", MAX_BUF_SIZE);
@@ -90,6 +98,11 @@ void __diag_smd_send_req(void)
 				APPEND_DEBUG('i');
 				smd_read(driver->ch, buf, r);
 
+				if (driver->logging_mode == CAPTURE_MODE) {
+					diag_capture_process(buf, r);
+					return;
+				}
+
 				if (diag7k_debug_mask) {
 					switch (diag7k_debug_mask) {
 					case 1:
@@ -229,18 +242,21 @@ int diag_device_write(void *buf, int proc_num, struct diag_request *write_ptr)
 void __diag_smd_qdsp_send_req(void)
 {
 	void *buf = NULL;
+	unsigned char **buf_ptr = NULL;
 	int *in_busy_qdsp_ptr = NULL;
 	struct diag_request *write_ptr_qdsp = NULL;
 
 	if (!driver->in_busy_qdsp_1) {
-		buf = driver->usb_buf_in_qdsp_1;
+		buf_ptr = &driver->usb_buf_in_qdsp_1;
 		write_ptr_qdsp = driver->usb_write_ptr_qdsp_1;
 		in_busy_qdsp_ptr = &(driver->in_busy_qdsp_1);
 	} else if (!driver->in_busy_qdsp_2) {
-		buf = driver->usb_buf_in_qdsp_2;
+		buf_ptr = &driver->usb_buf_in_qdsp_2;
 		write_ptr_qdsp = driver->usb_write_ptr_qdsp_2;
 		in_busy_qdsp_ptr = &(driver->in_busy_qdsp_2);
 	}
+	if (buf_ptr)
+		buf = *buf_ptr;
 
 	if (driver->chqdsp && buf) {
 		int r = smd_read_avail(driver->chqdsp);
@@ -250,6 +266,9 @@ void __diag_smd_qdsp_send_req(void)
 				printk(KERN_ALERT "\n diag: SMD sending in "
 						   "packets upto %d bytes", r);
 				buf = krealloc(buf, r, GFP_KERNEL);
+				/* write_complete matches on this pointer */
+				if (buf)
+					*buf_ptr = buf;
 			} else {
 				printk(KERN_ALERT "\n diag: SMD sending in "
 				"packets more than %d bytes", MAX_BUF_SIZE);
@@ -29,6 +29,8 @@
 #include <linux/major.h>
 #include <linux/fb.h>
 #include <linux/regulator/consumer.h>
+#include <linux/sync.h>
+#include <linux/sw_sync.h>
 #ifdef CONFIG_MSM_MULTIMEDIA_USE_ION
 #include <linux/msm_ion.h>
 #else /* FIXME */
@@ -90,6 +92,7 @@ struct ion_handle {
 #define IMEM_NO_OWNER -1;
 
 #define MAX_SESSIONS 16
+#define ROTATOR_FENCE_TIMEOUT 1000
 #define INVALID_SESSION -1
 #define VERSION_KEY_MASK 0xFFFFFF00
 #define MAX_DOWNSCALE_RATIO 3
@@ -156,6 +159,12 @@ struct msm_rotator_dev {
 	int imem_owner;
 	wait_queue_head_t wq;
 	struct ion_client *client;
+	struct workqueue_struct *job_wq;
+	struct work_struct job_work;
+	struct list_head job_list;
+	spinlock_t job_lock;
+	struct sw_sync_timeline *timeline;
+	int timeline_max;
 	#ifdef CONFIG_MSM_BUS_SCALING
 	uint32_t bus_client_handle;
 	#endif
@@ -845,30 +854,56 @@ static void put_img(struct file *p_file, struct ion_handle *p_ihdl)
 		ion_free(msm_rotator_dev->client, p_ihdl);
 #endif
 }
-static int msm_rotator_do_rotate(unsigned long arg)
-{
-	unsigned int status, format;
-	struct msm_rotator_data_info info;
+/*
+ * A rotation with its buffers resolved.  The buffers are looked up in the
+ * context of the submitting process (memory ids are fds) and pinned until
+ * the job is released, the session parameters are copied so a queued job
+ * is not affected by a later START or FINISH on its session.
+ */
+struct msm_rotator_job {
+	struct list_head list;
+	struct msm_rotator_img_info img_info;
+	int session;
+	unsigned int src_flags;
 	unsigned int in_paddr, out_paddr;
+	unsigned int in_chroma_paddr, out_chroma_paddr, in_chroma2_paddr;
+	struct file *srcp0_file, *dstp0_file, *srcp1_file, *dstp1_file;
+	struct ion_handle *srcp0_ihdl, *dstp0_ihdl, *srcp1_ihdl, *dstp1_ihdl;
+	int ps0_need;
+	struct sync_fence *acq_fence;
+};
+
+static void msm_rotator_job_release(struct msm_rotator_job *job)
+{
+	put_img(job->dstp1_file, job->dstp1_ihdl);
+	put_img(job->srcp1_file, job->srcp1_ihdl);
+	put_img(job->dstp0_file, job->dstp0_ihdl);
+
+	/* only source may use frame buffer */
+	if (job->src_flags) {
+		if (job->srcp0_file)
+			fput_light(job->srcp0_file, job->ps0_need);
+	} else
+		put_img(job->srcp0_file, job->srcp0_ihdl);
+
+	if (job->acq_fence)
+		sync_fence_put(job->acq_fence);
+}
+
+/* Called with rotator_lock held, the job is released by the caller */
+static int msm_rotator_job_prepare(struct msm_rotator_data_info *info,
+				   struct msm_rotator_job *job, int async)
+{
 	unsigned long src_len, dst_len;
-	int use_imem = 0, rc = 0, s;
-	struct file *srcp0_file = NULL, *dstp0_file = NULL;
-	struct file *srcp1_file = NULL, *dstp1_file = NULL;
-	struct ion_handle *srcp0_ihdl = NULL, *dstp0_ihdl = NULL;
-	struct ion_handle *srcp1_ihdl = NULL, *dstp1_ihdl = NULL;
-	int ps0_need, p_need;
-	unsigned int in_chroma_paddr = 0, out_chroma_paddr = 0;
-	unsigned int in_chroma2_paddr = 0;
+	int rc = 0, s, p_need;
 	struct msm_rotator_img_info *img_info;
 	struct msm_rotator_mem_planes src_planes, dst_planes;
 
-	if (copy_from_user(&info, (void __user *)arg, sizeof(info)))
-		return -EFAULT;
+	job->src_flags = info->src.flags;
 
-	mutex_lock(&msm_rotator_dev->rotator_lock);
 	for (s = 0; s < MAX_SESSIONS; s++)
 		if ((msm_rotator_dev->img_info[s] != NULL) &&
-			(info.session_id ==
+			(info->session_id ==
 			(unsigned int)msm_rotator_dev->img_info[s]
 			))
 			break;
@@ -877,142 +912,155 @@ static int msm_rotator_do_rotate(unsigned long arg)
 		dev_dbg(msm_rotator_dev->device,
 			"%s() : Attempt to use invalid session_id %d\n",
 			__func__, s);
-		rc = -EINVAL;
-		goto do_rotate_unlock_mutex;
+		return -EINVAL;
 	}
 
 	if (msm_rotator_dev->img_info[s]->enable == 0) {
 		dev_dbg(msm_rotator_dev->device,
 			"%s() : Session_id %d not enabled \n",
 			__func__, s);
-		rc = -EINVAL;
-		goto do_rotate_unlock_mutex;
+		return -EINVAL;
 	}
 
-	img_info = msm_rotator_dev->img_info[s];
+	job->session = s;
+	job->img_info = *msm_rotator_dev->img_info[s];
+	img_info = &job->img_info;
 	if (msm_rotator_get_plane_sizes(img_info->src.format,
 					img_info->src.width,
 					img_info->src.height,
 					&src_planes)) {
 		pr_err("%s: invalid src format\n", __func__);
-		rc = -EINVAL;
-		goto do_rotate_unlock_mutex;
+		return -EINVAL;
 	}
 	if (msm_rotator_get_plane_sizes(img_info->dst.format,
 					img_info->dst.width,
 					img_info->dst.height,
 					&dst_planes)) {
 		pr_err("%s: invalid dst format\n", __func__);
-		rc = -EINVAL;
-		goto do_rotate_unlock_mutex;
+		return -EINVAL;
 	}
 
-
-	rc = get_img(&info.src, (unsigned long *)&in_paddr,
-		(unsigned long *)&src_len, &srcp0_file, &ps0_need, &srcp0_ihdl);
+	rc = get_img(&info->src, (unsigned long *)&job->in_paddr,
+		(unsigned long *)&src_len, &job->srcp0_file, &job->ps0_need,
+		&job->srcp0_ihdl);
 	if (rc) {
 		pr_err("%s: in get_img() failed id=0x%08x\n",
-			DRIVER_NAME, info.src.memory_id);
-		goto do_rotate_unlock_mutex;
+			DRIVER_NAME, info->src.memory_id);
+		return rc;
+	}
+
+	/*
+	 * fget_light() does not take a reference for a single threaded
+	 * caller, the fd may be closed before a queued job runs.
+	 */
+	if (async && job->src_flags && !job->ps0_need) {
+		get_file(job->srcp0_file);
+		job->ps0_need = 1;
 	}
 
-	rc = get_img(&info.dst, (unsigned long *)&out_paddr,
-		(unsigned long *)&dst_len, &dstp0_file, &p_need, &dstp0_ihdl);
+	rc = get_img(&info->dst, (unsigned long *)&job->out_paddr,
+		(unsigned long *)&dst_len, &job->dstp0_file, &p_need,
+		&job->dstp0_ihdl);
 	if (rc) {
 		pr_err("%s: out get_img() failed id=0x%08x\n",
-		       DRIVER_NAME, info.dst.memory_id);
-		goto do_rotate_unlock_mutex;
+		       DRIVER_NAME, info->dst.memory_id);
+		return rc;
 	}
 
-	format = msm_rotator_dev->img_info[s]->src.format;
-	if (((info.version_key & VERSION_KEY_MASK) == 0xA5B4C300) &&
-			((info.version_key & ~VERSION_KEY_MASK) > 0) &&
+	if (((info->version_key & VERSION_KEY_MASK) == 0xA5B4C300) &&
+			((info->version_key & ~VERSION_KEY_MASK) > 0) &&
 			(src_planes.num_planes == 2)) {
-		if (checkoffset(info.src.offset,
+		if (checkoffset(info->src.offset,
 				src_planes.plane_size[0],
 				src_len)) {
 			pr_err("%s: invalid src buffer (len=%lu offset=%x)\n",
-			       __func__, src_len, info.src.offset);
-			rc = -ERANGE;
-			goto do_rotate_unlock_mutex;
+			       __func__, src_len, info->src.offset);
+			return -ERANGE;
 		}
-		if (checkoffset(info.dst.offset,
+		if (checkoffset(info->dst.offset,
 				dst_planes.plane_size[0],
 				dst_len)) {
 			pr_err("%s: invalid dst buffer (len=%lu offset=%x)\n",
-			       __func__, dst_len, info.dst.offset);
-			rc = -ERANGE;
-			goto do_rotate_unlock_mutex;
+			       __func__, dst_len, info->dst.offset);
+			return -ERANGE;
 		}
 
-		rc = get_img(&info.src_chroma,
-				(unsigned long *)&in_chroma_paddr,
-				(unsigned long *)&src_len, &srcp1_file, &p_need,
-				&srcp1_ihdl);
+		rc = get_img(&info->src_chroma,
+				(unsigned long *)&job->in_chroma_paddr,
+				(unsigned long *)&src_len, &job->srcp1_file,
+				&p_need, &job->srcp1_ihdl);
 		if (rc) {
 			pr_err("%s: in chroma get_img() failed id=0x%08x\n",
-				DRIVER_NAME, info.src_chroma.memory_id);
-			goto do_rotate_unlock_mutex;
+				DRIVER_NAME, info->src_chroma.memory_id);
+			return rc;
 		}
 
-		rc = get_img(&info.dst_chroma,
-				(unsigned long *)&out_chroma_paddr,
-				(unsigned long *)&dst_len, &dstp1_file, &p_need,
-				&dstp1_ihdl);
+		rc = get_img(&info->dst_chroma,
+				(unsigned long *)&job->out_chroma_paddr,
+				(unsigned long *)&dst_len, &job->dstp1_file,
+				&p_need, &job->dstp1_ihdl);
 		if (rc) {
 			pr_err("%s: out chroma get_img() failed id=0x%08x\n",
-				DRIVER_NAME, info.dst_chroma.memory_id);
-			goto do_rotate_unlock_mutex;
+				DRIVER_NAME, info->dst_chroma.memory_id);
+			return rc;
 		}
 
-		if (checkoffset(info.src_chroma.offset,
+		if (checkoffset(info->src_chroma.offset,
 				src_planes.plane_size[1],
 				src_len)) {
 			pr_err("%s: invalid chr src buf len=%lu offset=%x\n",
-			       __func__, src_len, info.src_chroma.offset);
-			rc = -ERANGE;
-			goto do_rotate_unlock_mutex;
+			       __func__, src_len, info->src_chroma.offset);
+			return -ERANGE;
 		}
 
-		if (checkoffset(info.dst_chroma.offset,
+		if (checkoffset(info->dst_chroma.offset,
 				src_planes.plane_size[1],
 				dst_len)) {
 			pr_err("%s: invalid chr dst buf len=%lu offset=%x\n",
-			       __func__, dst_len, info.dst_chroma.offset);
-			rc = -ERANGE;
-			goto do_rotate_unlock_mutex;
+			       __func__, dst_len, info->dst_chroma.offset);
+			return -ERANGE;
 		}
 
-		in_chroma_paddr += info.src_chroma.offset;
-		out_chroma_paddr += info.dst_chroma.offset;
+		job->in_chroma_paddr += info->src_chroma.offset;
+		job->out_chroma_paddr += info->dst_chroma.offset;
 	} else {
-		if (checkoffset(info.src.offset,
+		if (checkoffset(info->src.offset,
 				src_planes.total_size,
 				src_len)) {
 			pr_err("%s: invalid src buffer (len=%lu offset=%x)\n",
-			       __func__, src_len, info.src.offset);
-			rc = -ERANGE;
-			goto do_rotate_unlock_mutex;
+			       __func__, src_len, info->src.offset);
+			return -ERANGE;
 		}
-		if (checkoffset(info.dst.offset,
+		if (checkoffset(info->dst.offset,
 				dst_planes.total_size,
 				dst_len)) {
 			pr_err("%s: invalid dst buffer (len=%lu offset=%x)\n",
-			       __func__, dst_len, info.dst.offset);
-			rc = -ERANGE;
-			goto do_rotate_unlock_mutex;
+			       __func__, dst_len, info->dst.offset);
+			return -ERANGE;
 		}
 	}
 
-	in_paddr += info.src.offset;
-	out_paddr += info.dst.offset;
+	job->in_paddr += info->src.offset;
+	job->out_paddr += info->dst.offset;
 
-	if (!in_chroma_paddr && src_planes.num_planes >= 2)
-		in_chroma_paddr = in_paddr + src_planes.plane_size[0];
-	if (!out_chroma_paddr && dst_planes.num_planes >= 2)
-		out_chroma_paddr = out_paddr + dst_planes.plane_size[0];
+	if (!job->in_chroma_paddr && src_planes.num_planes >= 2)
+		job->in_chroma_paddr = job->in_paddr + src_planes.plane_size[0];
+	if (!job->out_chroma_paddr && dst_planes.num_planes >= 2)
+		job->out_chroma_paddr = job->out_paddr +
+			dst_planes.plane_size[0];
 	if (src_planes.num_planes >= 3)
-		in_chroma2_paddr = in_chroma_paddr + src_planes.plane_size[1];
+		job->in_chroma2_paddr = job->in_chroma_paddr +
+			src_planes.plane_size[1];
+
+	return 0;
+}
+
+/* Program the hardware and wait for it, called with rotator_lock held */
+static int msm_rotator_job_run(struct msm_rotator_job *job)
+{
+	struct msm_rotator_img_info *img_info = &job->img_info;
+	unsigned int status;
+	int use_imem = 0, rc = 0, s = job->session;
 
 	cancel_delayed_work(&msm_rotator_dev->rot_clk_work);
 	if (msm_rotator_dev->rot_clk_state != CLK_EN) {
@@ -1034,20 +1082,20 @@ static int msm_rotator_do_rotate(unsigned long arg)
 	if (use_imem)
 		iowrite32(0x42, MSM_ROTATOR_MAX_BURST_SIZE);
 
-	iowrite32(((msm_rotator_dev->img_info[s]->src_rect.h & 0x1fff)
+	iowrite32(((img_info->src_rect.h & 0x1fff)
 				<< 16) |
-		  (msm_rotator_dev->img_info[s]->src_rect.w & 0x1fff),
+		  (img_info->src_rect.w & 0x1fff),
 		  MSM_ROTATOR_SRC_SIZE);
-	iowrite32(((msm_rotator_dev->img_info[s]->src_rect.y & 0x1fff)
+	iowrite32(((img_info->src_rect.y & 0x1fff)
 				<< 16) |
-		  (msm_rotator_dev->img_info[s]->src_rect.x & 0x1fff),
+		  (img_info->src_rect.x & 0x1fff),
 		  MSM_ROTATOR_SRC_XY);
-	iowrite32(((msm_rotator_dev->img_info[s]->src.height & 0x1fff)
+	iowrite32(((img_info->src.height & 0x1fff)
 				<< 16) |
-		  (msm_rotator_dev->img_info[s]->src.width & 0x1fff),
+		  (img_info->src.width & 0x1fff),
 		  MSM_ROTATOR_SRC_IMAGE_SIZE);
 
-	switch (format) {
+	switch (img_info->src.format) {
 	case MDP_RGB_565:
 	case MDP_BGR_565:
 	case MDP_RGB_888:
@@ -1056,8 +1104,8 @@ static int msm_rotator_do_rotate(unsigned long arg)
 	case MDP_XRGB_8888:
 	case MDP_BGRA_8888:
 	case MDP_RGBX_8888:
-		rc = msm_rotator_rgb_types(msm_rotator_dev->img_info[s],
-					   in_paddr, out_paddr,
+		rc = msm_rotator_rgb_types(img_info,
+					   job->in_paddr, job->out_paddr,
 					   use_imem,
 					   msm_rotator_dev->last_session_idx
 								!= s);
@@ -1069,28 +1117,30 @@ static int msm_rotator_do_rotate(unsigned long arg)
 	case MDP_Y_CR_CB_GH2V2:
 	case MDP_Y_CRCB_H2V2_TILE:
 	case MDP_Y_CBCR_H2V2_TILE:
-		rc = msm_rotator_ycxcx_h2v2(msm_rotator_dev->img_info[s],
-					    in_paddr, out_paddr, use_imem,
+		rc = msm_rotator_ycxcx_h2v2(img_info,
+					    job->in_paddr, job->out_paddr,
+					    use_imem,
 					    msm_rotator_dev->last_session_idx
 								!= s,
-					    in_chroma_paddr,
-					    out_chroma_paddr,
-					    in_chroma2_paddr);
+					    job->in_chroma_paddr,
+					    job->out_chroma_paddr,
+					    job->in_chroma2_paddr);
 		break;
 	case MDP_Y_CBCR_H2V1:
 	case MDP_Y_CRCB_H2V1:
-		rc = msm_rotator_ycxcx_h2v1(msm_rotator_dev->img_info[s],
-					    in_paddr, out_paddr, use_imem,
+		rc = msm_rotator_ycxcx_h2v1(img_info,
+					    job->in_paddr, job->out_paddr,
+					    use_imem,
 					    msm_rotator_dev->last_session_idx
 								!= s,
-					    in_chroma_paddr,
-					    out_chroma_paddr);
+					    job->in_chroma_paddr,
+					    job->out_chroma_paddr);
 		break;
 	case MDP_YCRYCB_H2V1:
-		rc = msm_rotator_ycrycb(msm_rotator_dev->img_info[s],
-				in_paddr, out_paddr, use_imem,
+		rc = msm_rotator_ycrycb(img_info,
+				job->in_paddr, job->out_paddr, use_imem,
 				msm_rotator_dev->last_session_idx != s,
-				out_chroma_paddr);
+				job->out_chroma_paddr);
 		break;
 	default:
 		rc = -EINVAL;
@@ -1121,22 +1171,144 @@ do_rotate_exit:
 	msm_rotator_imem_free(ROTATOR_REQUEST);
 #endif
 	schedule_delayed_work(&msm_rotator_dev->rot_clk_work, HZ);
-do_rotate_unlock_mutex:
-	put_img(dstp1_file, dstp1_ihdl);
-	put_img(srcp1_file, srcp1_ihdl);
-	put_img(dstp0_file, dstp0_ihdl);
+	return rc;
+}
 
-	/* only source may use frame buffer */
-	if (info.src.flags)
-		fput_light(srcp0_file, ps0_need);
-	else
-		put_img(srcp0_file, srcp0_ihdl);
+static int msm_rotator_do_rotate(unsigned long arg)
+{
+	struct msm_rotator_data_info info;
+	struct msm_rotator_job job;
+	int rc;
+
+	if (copy_from_user(&info, (void __user *)arg, sizeof(info)))
+		return -EFAULT;
+
+	/* keep the order with rotations queued before this one */
+	flush_workqueue(msm_rotator_dev->job_wq);
+
+	memset(&job, 0, sizeof(job));
+	mutex_lock(&msm_rotator_dev->rotator_lock);
+	rc = msm_rotator_job_prepare(&info, &job, 0);
+	if (!rc)
+		rc = msm_rotator_job_run(&job);
+	msm_rotator_job_release(&job);
 	mutex_unlock(&msm_rotator_dev->rotator_lock);
 	dev_dbg(msm_rotator_dev->device, "%s() returning rc = %d\n",
 		__func__, rc);
 	return rc;
 }
 
+/*
+ * Run the queued jobs back to back.  Each job drops rotator_lock once it
+ * is done so synchronous callers and START/FINISH can get in between.
+ */
+static void msm_rotator_job_work(struct work_struct *work)
+{
+	struct msm_rotator_job *job;
+	int rc;
+
+	for (;;) {
+		spin_lock(&msm_rotator_dev->job_lock);
+		job = NULL;
+		if (!list_empty(&msm_rotator_dev->job_list)) {
+			job = list_first_entry(&msm_rotator_dev->job_list,
+				struct msm_rotator_job, list);
+			list_del(&job->list);
+		}
+		spin_unlock(&msm_rotator_dev->job_lock);
+		if (job == NULL)
+			break;
+
+		if (job->acq_fence &&
+			sync_fence_wait(job->acq_fence, ROTATOR_FENCE_TIMEOUT))
+			pr_err("%s: acquire fence wait failed\n", __func__);
+
+		mutex_lock(&msm_rotator_dev->rotator_lock);
+		rc = msm_rotator_job_run(job);
+		msm_rotator_job_release(job);
+		mutex_unlock(&msm_rotator_dev->rotator_lock);
+		if (rc)
+			pr_err("%s: rotation failed rc=%d\n", __func__, rc);
+
+		/* jobs retire in order, one timeline step each */
+		sw_sync_timeline_inc(msm_rotator_dev->timeline, 1);
+		kfree(job);
+	}
+}
+
+static int msm_rotator_do_rotate_async(unsigned long arg)
+{
+	struct msm_rotator_async_data data;
+	struct msm_rotator_job *job;
+	struct sync_pt *pt;
+	struct sync_fence *fence;
+	int rc, fd;
+
+	if (copy_from_user(&data, (void __user *)arg, sizeof(data)))
+		return -EFAULT;
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (job == NULL)
+		return -ENOMEM;
+
+	if (data.acq_fen_fd >= 0) {
+		job->acq_fence = sync_fence_fdget(data.acq_fen_fd);
+		if (job->acq_fence == NULL) {
+			kfree(job);
+			return -EINVAL;
+		}
+	}
+
+	mutex_lock(&msm_rotator_dev->rotator_lock);
+	rc = msm_rotator_job_prepare(&data.data, job, 1);
+	if (rc)
+		goto err_release;
+
+	fd = get_unused_fd_flags(0);
+	if (fd < 0) {
+		rc = fd;
+		goto err_release;
+	}
+
+	/* timeline_max is only advanced under rotator_lock */
+	pt = sw_sync_pt_create(msm_rotator_dev->timeline,
+		msm_rotator_dev->timeline_max + 1);
+	if (pt == NULL) {
+		rc = -ENOMEM;
+		goto err_fd;
+	}
+	fence = sync_fence_create("msm_rotator", pt);
+	if (fence == NULL) {
+		sync_pt_free(pt);
+		rc = -ENOMEM;
+		goto err_fd;
+	}
+
+	data.rel_fen_fd = fd;
+	if (copy_to_user((void __user *)arg, &data, sizeof(data))) {
+		sync_fence_put(fence);
+		rc = -EFAULT;
+		goto err_fd;
+	}
+	sync_fence_install(fence, fd);
+
+	msm_rotator_dev->timeline_max++;
+	spin_lock(&msm_rotator_dev->job_lock);
+	list_add_tail(&job->list, &msm_rotator_dev->job_list);
+	spin_unlock(&msm_rotator_dev->job_lock);
+	queue_work(msm_rotator_dev->job_wq, &msm_rotator_dev->job_work);
+	mutex_unlock(&msm_rotator_dev->rotator_lock);
+	return 0;
+
+err_fd:
+	put_unused_fd(fd);
+err_release:
+	msm_rotator_job_release(job);
+	mutex_unlock(&msm_rotator_dev->rotator_lock);
+	kfree(job);
+	return rc;
+}
+
 static void msm_rotator_set_perf_level(u32 wh, u32 is_rgb)
 {
 	u32 perf_level;
@@ -1413,6 +1585,8 @@ static long msm_rotator_ioctl(struct file *file, unsigned cmd,
 		return msm_rotator_start(arg, fd_info);
 	case MSM_ROTATOR_IOCTL_ROTATE:
 		return msm_rotator_do_rotate(arg);
+	case MSM_ROTATOR_IOCTL_ROTATE_ASYNC:
+		return msm_rotator_do_rotate_async(arg);
 	case MSM_ROTATOR_IOCTL_FINISH:
 		return msm_rotator_finish(arg);
 
@@ -1616,12 +1790,28 @@ static int __devinit msm_rotator_probe(struct platform_device *pdev)
 	}
 
 	cdev_init(&msm_rotator_dev->cdev, &msm_rotator_fops);
+	INIT_LIST_HEAD(&msm_rotator_dev->job_list);
+	spin_lock_init(&msm_rotator_dev->job_lock);
+	INIT_WORK(&msm_rotator_dev->job_work, msm_rotator_job_work);
+	msm_rotator_dev->job_wq = create_singlethread_workqueue("msm_rotator");
+	if (msm_rotator_dev->job_wq == NULL) {
+		printk(KERN_ERR "%s: workqueue create failed\n", __func__);
+		rc = -ENOMEM;
+		goto error_cdev_add;
+	}
+	msm_rotator_dev->timeline = sw_sync_timeline_create("msm_rotator");
+	if (msm_rotator_dev->timeline == NULL) {
+		printk(KERN_ERR "%s: timeline create failed\n", __func__);
+		rc = -ENOMEM;
+		goto error_timeline;
+	}
+
 	rc = cdev_add(&msm_rotator_dev->cdev,
 		      MKDEV(MAJOR(msm_rotator_dev->dev_num), 0),
 		      1);
 	if (rc < 0) {
 		printk(KERN_ERR "%s: cdev_add failed %d\n", __func__, rc);
-		goto error_cdev_add;
+		goto error_cdev;
 	}
 
 	init_waitqueue_head(&msm_rotator_dev->wq);
@@ -1629,6 +1819,10 @@ static int __devinit msm_rotator_probe(struct platform_device *pdev)
 	dev_dbg(msm_rotator_dev->device, "probe successful\n");
 	return rc;
 
+error_cdev:
+	sync_timeline_destroy(&msm_rotator_dev->timeline->obj);
+error_timeline:
+	destroy_workqueue(msm_rotator_dev->job_wq);
 error_cdev_add:
 	device_destroy(msm_rotator_dev->class, msm_rotator_dev->dev_num);
 error_class_device_create:
@@ -1661,8 +1855,10 @@ static int __devexit msm_rotator_remove(struct platform_device *plat_dev)
 	msm_bus_scale_unregister_client(msm_rotator_dev->bus_client_handle);
 #endif
 	free_irq(msm_rotator_dev->irq, NULL);
-	mutex_destroy(&msm_rotator_dev->rotator_lock);
 	cdev_del(&msm_rotator_dev->cdev);
+	destroy_workqueue(msm_rotator_dev->job_wq);
+	sync_timeline_destroy(&msm_rotator_dev->timeline->obj);
+	mutex_destroy(&msm_rotator_dev->rotator_lock);
 	device_destroy(msm_rotator_dev->class, msm_rotator_dev->dev_num);
 	class_destroy(msm_rotator_dev->class);
 	unregister_chrdev_region(msm_rotator_dev->dev_num, 1);
@@ -0,0 +1,157 @@
+/*
+ * drivers/cpufreq/cpufreq_energy.c
+ *
+ * Energy model for the load-based governors.
+ *
+ * The clock driver describes the relative power of each frequency. From
+ * that the cost of a cycle at each frequency is known, and a frequency is
+ * not worth using when a faster one costs no more per cycle: the work
+ * gets done for the same energy and the CPU goes idle sooner. Governors
+ * pass the frequency their load heuristic picked through
+ * cpufreq_energy_efficient_freq() to step over such frequencies.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/cpufreq.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+
+struct cpufreq_energy_model {
+	unsigned int nr_states;
+	struct {
+		u64 cost;		/* power scaled by fmax / f */
+		unsigned int frequency;	/* kHz, increasing */
+	} state[0];
+};
+
+static DEFINE_PER_CPU(struct cpufreq_energy_model *, cpufreq_energy_model);
+
+static unsigned int skip_inefficient = 1;
+
+/**
+ * cpufreq_energy_register - describe the power cost of each frequency
+ * @cpus: the CPUs sharing this clock
+ * @states: frequencies in increasing order, with their relative power
+ * @nr_states: number of entries in @states
+ *
+ * The power values only need to be comparable with each other. The
+ * table is copied, so it may live in init memory.
+ */
+int cpufreq_energy_register(const struct cpumask *cpus,
+			    const struct cpufreq_energy_state *states,
+			    unsigned int nr_states)
+{
+	struct cpufreq_energy_model *model;
+	unsigned int fmax, i, cpu;
+
+	if (!nr_states)
+		return -EINVAL;
+
+	for (i = 1; i < nr_states; i++)
+		if (WARN_ON(states[i].frequency <= states[i - 1].frequency))
+			return -EINVAL;
+
+	model = kzalloc(sizeof(*model) + nr_states * sizeof(model->state[0]),
+			GFP_KERNEL);
+	if (!model)
+		return -ENOMEM;
+
+	model->nr_states = nr_states;
+	fmax = states[nr_states - 1].frequency;
+	for (i = 0; i < nr_states; i++) {
+		model->state[i].frequency = states[i].frequency;
+		model->state[i].cost = div_u64((u64)states[i].power * fmax,
+					       states[i].frequency);
+	}
+
+	for_each_cpu(cpu, cpus) {
+		if (per_cpu(cpufreq_energy_model, cpu)) {
+			pr_warning("cpufreq: cpu %u already has an energy "
+				   "model\n", cpu);
+			continue;
+		}
+		per_cpu(cpufreq_energy_model, cpu) = model;
+	}
+
+	return 0;
+}
+
+/**
+ * cpufreq_energy_efficient_freq - cheapest frequency that meets demand
+ * @policy: the policy whose limits apply
+ * @freq: the lowest frequency that meets demand, in kHz
+ *
+ * Returns the frequency in [@freq, policy->max] with the lowest cost
+ * per cycle, the faster one on a tie, or @freq if there is no model.
+ */
+unsigned int cpufreq_energy_efficient_freq(struct cpufreq_policy *policy,
+					   unsigned int freq)
+{
+	struct cpufreq_energy_model *model;
+	unsigned int best = freq;
+	u64 best_cost = ~0ULL;
+	unsigned int i;
+
+	model = per_cpu(cpufreq_energy_model, policy->cpu);
+	if (!model || !skip_inefficient)
+		return freq;
+
+	for (i = 0; i < model->nr_states; i++) {
+		unsigned int f = model->state[i].frequency;
+
+		if (f < freq || f < policy->min)
+			continue;
+		if (f > policy->max)
+			break;
+
+		if (model->state[i].cost <= best_cost) {
+			best = f;
+			best_cost = model->state[i].cost;
+		}
+	}
+
+	return best;
+}
+EXPORT_SYMBOL_GPL(cpufreq_energy_efficient_freq);
+
+static ssize_t show_skip_inefficient(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", skip_inefficient);
+}
+
+static ssize_t store_skip_inefficient(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	skip_inefficient = !!val;
+	return count;
+}
+
+static struct global_attr skip_inefficient_attr = __ATTR(skip_inefficient,
+		0644, show_skip_inefficient, store_skip_inefficient);
+
+static int __init cpufreq_energy_init(void)
+{
+	return sysfs_create_file(cpufreq_global_kobject,
+				 &skip_inefficient_attr.attr);
+}
+late_initcall(cpufreq_energy_init);
@@ -0,0 +1,202 @@
+/*
+ * drivers/cpufreq/cpufreq_input_boost.c
+ *
+ * Input event boost shared by the sampling governors.
+ *
+ * A touch-down or key press starts a boost and touch movement keeps it
+ * going for input_boost_ms. Governors registered on the notifier chain
+ * are told when a boost starts, so they can jump to their high speed at
+ * once instead of waiting for the next load sample, and can ask
+ * cpufreq_input_boost_active() before ramping back down.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/cpufreq.h>
+#include <linux/init.h>
+#include <linux/input.h>
+#include <linux/jiffies.h>
+#include <linux/module.h>
+#include <linux/notifier.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#define DEFAULT_INPUT_BOOST_MS 500
+static unsigned int input_boost_ms = DEFAULT_INPUT_BOOST_MS;
+
+static DEFINE_SPINLOCK(input_boost_lock);
+static unsigned long input_boost_until;
+static int input_boosted;
+
+static ATOMIC_NOTIFIER_HEAD(input_boost_chain);
+
+int cpufreq_register_input_boost_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&input_boost_chain, nb);
+}
+EXPORT_SYMBOL_GPL(cpufreq_register_input_boost_notifier);
+
+int cpufreq_unregister_input_boost_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&input_boost_chain, nb);
+}
+EXPORT_SYMBOL_GPL(cpufreq_unregister_input_boost_notifier);
+
+/* Must hold input_boost_lock */
+static int input_boost_active_locked(void)
+{
+	if (!input_boosted)
+		return 0;
+
+	if (time_before(jiffies, input_boost_until))
+		return 1;
+
+	input_boosted = 0;
+	return 0;
+}
+
+int cpufreq_input_boost_active(void)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&input_boost_lock, flags);
+	ret = input_boost_active_locked();
+	spin_unlock_irqrestore(&input_boost_lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(cpufreq_input_boost_active);
+
+static void input_boost_kick(void)
+{
+	unsigned long flags;
+	int start;
+
+	if (!input_boost_ms)
+		return;
+
+	spin_lock_irqsave(&input_boost_lock, flags);
+	start = !input_boost_active_locked();
+	input_boost_until = jiffies + msecs_to_jiffies(input_boost_ms);
+	input_boosted = 1;
+	spin_unlock_irqrestore(&input_boost_lock, flags);
+
+	if (start)
+		atomic_notifier_call_chain(&input_boost_chain, 0, NULL);
+}
+
+static void input_boost_event(struct input_handle *handle, unsigned int type,
+		unsigned int code, int value)
+{
+	/* Releases and autorepeat do not need a faster CPU */
+	if ((type == EV_KEY && value == 1) || type == EV_ABS)
+		input_boost_kick();
+}
+
+static int input_dev_filter(const char *input_dev_name)
+{
+	if (strstr(input_dev_name, "touchscreen") ||
+	    strstr(input_dev_name, "-keypad") ||
+	    strstr(input_dev_name, "-nav") ||
+	    strstr(input_dev_name, "-oj"))
+		return 0;
+
+	return 1;
+}
+
+static int input_boost_connect(struct input_handler *handler,
+		struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	/* filter out those input_dev that we don't care */
+	if (input_dev_filter(dev->name))
+		return -ENODEV;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_boost";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err2;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err1;
+
+	return 0;
+err1:
+	input_unregister_handle(handle);
+err2:
+	kfree(handle);
+	return error;
+}
+
+static void input_boost_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id input_boost_ids[] = {
+	{ .driver_info = 1 },
+	{ },
+};
+
+static struct input_handler input_boost_handler = {
+	.event		= input_boost_event,
+	.connect	= input_boost_connect,
+	.disconnect	= input_boost_disconnect,
+	.name		= "cpufreq_boost",
+	.id_table	= input_boost_ids,
+};
+
+static ssize_t show_input_boost_ms(struct kobject *kobj,
+				   struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", input_boost_ms);
+}
+
+static ssize_t store_input_boost_ms(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	input_boost_ms = val;
+	return count;
+}
+
+static struct global_attr input_boost_ms_attr = __ATTR(input_boost_ms, 0644,
+		show_input_boost_ms, store_input_boost_ms);
+
+static int __init cpufreq_input_boost_init(void)
+{
+	int rc;
+
+	rc = sysfs_create_file(cpufreq_global_kobject, &input_boost_ms_attr.attr);
+	if (rc)
+		return rc;
+
+	return input_register_handler(&input_boost_handler);
+}
+late_initcall(cpufreq_input_boost_init);
@@ -172,6 +172,10 @@ static void cpufreq_interactive_timer(unsigned long data)
 		new_freq = pcpu->policy->cur * cpu_load / 100;
 	}
 
+	/* Hold hi speed for as long as the input boost lasts */
+	if (new_freq < hispeed_freq && cpufreq_input_boost_active())
+		new_freq = hispeed_freq;
+
 	if (cpufreq_frequency_table_target(pcpu->policy, pcpu->freq_table,
 					   new_freq, CPUFREQ_RELATION_H,
 					   &index)) {
@@ -180,7 +184,8 @@ static void cpufreq_interactive_timer(unsigned long data)
 		goto rearm;
 	}
 
-	new_freq = pcpu->freq_table[index].frequency;
+	new_freq = cpufreq_energy_efficient_freq(pcpu->policy,
+			pcpu->freq_table[index].frequency);
 
 	if (pcpu->target_freq == new_freq)
 		goto rearm_if_notmax;
@@ -433,6 +438,43 @@ static void cpufreq_interactive_freq_down(struct work_struct *work)
 	}
 }
 
+static int cpufreq_interactive_input_boost(struct notifier_block *nb,
+					   unsigned long val, void *data)
+{
+	unsigned int cpu;
+	unsigned int boost_freq;
+	unsigned long flags;
+	int wake = 0;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+
+	for_each_online_cpu(cpu) {
+		pcpu = &per_cpu(cpuinfo, cpu);
+		smp_rmb();
+
+		if (!pcpu->governor_enabled)
+			continue;
+
+		boost_freq = min_t(u64, hispeed_freq, pcpu->policy->max);
+		if (pcpu->target_freq >= boost_freq)
+			continue;
+
+		pcpu->target_freq = boost_freq;
+		spin_lock_irqsave(&up_cpumask_lock, flags);
+		cpumask_set_cpu(cpu, &up_cpumask);
+		spin_unlock_irqrestore(&up_cpumask_lock, flags);
+		wake = 1;
+	}
+
+	if (wake)
+		wake_up_process(up_task);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpufreq_interactive_input_boost_nb = {
+	.notifier_call = cpufreq_interactive_input_boost,
+};
+
 static ssize_t show_hispeed_freq(struct kobject *kobj,
 				 struct attribute *attr, char *buf)
 {
@@ -679,6 +721,8 @@ static int __init cpufreq_interactive_init(void)
 	mutex_init(&set_speed_lock);
 
 	idle_notifier_register(&cpufreq_interactive_idle_nb);
+	cpufreq_register_input_boost_notifier(
+		&cpufreq_interactive_input_boost_nb);
 
 	return cpufreq_register_governor(&cpufreq_gov_interactive);
 
@@ -696,6 +740,8 @@ module_init(cpufreq_interactive_init);
 static void __exit cpufreq_interactive_exit(void)
 {
 	cpufreq_unregister_governor(&cpufreq_gov_interactive);
+	cpufreq_unregister_input_boost_notifier(
+		&cpufreq_interactive_input_boost_nb);
 	kthread_stop(up_task);
 	put_task_struct(up_task);
 	destroy_workqueue(down_wq);
@@ -51,6 +51,7 @@ static cpumask_t work_cpumask;
 
 static unsigned int suspended = 0;
 static unsigned int enabled = 0;
+static unsigned int boost_pending = 0;
 
 /*
  * The minimum ammount of time to spend at a frequency before we can ramp down,
@@ -131,6 +132,10 @@ static void cpufreq_interactivex_timer(unsigned long data)
 	if (policy->cur == policy->min)
 		return;
 
+	/* Stay up while the user is touching the screen */
+	if (cpufreq_input_boost_active())
+		return;
+
 	/*
 	 * Do not scale down unless we have been at this frequency for the
 	 * minimum sample time.
@@ -203,7 +208,11 @@ static void cpufreq_interactivex_freq_change_time_work(struct work_struct *work)
 
 	for_each_cpu(cpu, tmp_mask) {
 	  if (!suspended) {
-		if (target_freq == policy->max) {
+		if (boost_pending) {
+			boost_pending = 0;
+			if (policy->cur < newtarget)
+				__cpufreq_driver_target(policy, newtarget, CPUFREQ_RELATION_L);
+		} else if (target_freq == policy->max) {
 			if (nr_running() == 1) {
 				cpumask_clear_cpu(cpu, &work_cpumask);
 				return;
@@ -223,6 +232,24 @@ static void cpufreq_interactivex_freq_change_time_work(struct work_struct *work)
 
 }
 
+/* Touch-down: jump to the threshold speed without waiting for load */
+static int interactivex_input_boost(struct notifier_block *nb,
+				    unsigned long val, void *data)
+{
+	if (!enabled || suspended)
+		return NOTIFY_DONE;
+
+	boost_pending = 1;
+	cpumask_set_cpu(policy->cpu, &work_cpumask);
+	queue_work(up_wq, &freq_scale_work);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block interactivex_input_boost_nb = {
+	.notifier_call = interactivex_input_boost,
+};
+
 static ssize_t show_min_sample_time(struct kobject *kobj,
 				struct attribute *attr, char *buf)
 {
@@ -354,6 +381,7 @@ static int __init cpufreq_interactivex_init(void)
 	down_wq = create_workqueue("knteractive_down");
 
 	INIT_WORK(&freq_scale_work, cpufreq_interactivex_freq_change_time_work);
+	cpufreq_register_input_boost_notifier(&interactivex_input_boost_nb);
 
         pr_info("[imoseyon] interactiveX enter\n");
 	return cpufreq_register_governor(&cpufreq_gov_interactivex);
@@ -369,6 +397,7 @@ static void __exit cpufreq_interactivex_exit(void)
 {
         pr_info("[imoseyon] interactiveX exit\n");
 	cpufreq_unregister_governor(&cpufreq_gov_interactivex);
+	cpufreq_unregister_input_boost_notifier(&interactivex_input_boost_nb);
 	destroy_workqueue(up_wq);
 	destroy_workqueue(down_wq);
 }
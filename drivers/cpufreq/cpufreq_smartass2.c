@@ -262,6 +262,11 @@ inline static int target_freq(struct cpufreq_policy *policy, struct smartass_inf
 	}
 	else target = new_freq;
 
+	// step over frequencies costing more per cycle than a faster one:
+	target = cpufreq_energy_efficient_freq(policy,target);
+	if (target == old_freq)
+		return 0;
+
 	__cpufreq_driver_target(policy, target, prefered_relation);
 
 	dprintk(SMARTASS_DEBUG_JUMPS,"SmartassQ: jumping from %d to %d => %d (%d)\n",
@@ -330,6 +335,7 @@ static void cpufreq_smartass_timer(unsigned long cpu)
 	// Similarly for scale down: load should be below min and if we are at or below ideal
 	// frequency we require that we have been at this frequency for at least down_rate_us:
 	else if (cpu_load < min_cpu_load && old_freq > policy->min &&
+		 !cpufreq_input_boost_active() &&
 		 (old_freq > this_smartass->ideal_speed ||
 		  cputime64_sub(update_time, this_smartass->freq_change_time) >= down_rate_us))
 	{
@@ -397,6 +403,11 @@ static void cpufreq_smartass_freq_change_time_work(struct work_struct *work)
 			       old_freq,policy->cur);
 			new_freq = old_freq;
 		}
+		else if (ramp_dir > 1) {
+			// input boost: jump to the wakeup speed whatever the load
+			new_freq = sleep_wakeup_freq;
+			dprintk(SMARTASS_DEBUG_ALG,"smartassQ @ %d input boost\n",old_freq);
+		}
 		else if (ramp_dir > 0 && nr_running() > 1) {
 			// ramp up logic:
 			if (old_freq < this_smartass->ideal_speed)
@@ -455,6 +466,38 @@ static void cpufreq_smartass_freq_change_time_work(struct work_struct *work)
 	}
 }
 
+static int smartass_input_boost(struct notifier_block *nb, unsigned long val, void *data)
+{
+	unsigned int cpu;
+	int queued_work = 0;
+
+	if (suspended)
+		return NOTIFY_DONE;
+
+	for_each_online_cpu(cpu) {
+		struct smartass_info_s *this_smartass = &per_cpu(smartass_info, cpu);
+		struct cpufreq_policy *policy = this_smartass->cur_policy;
+
+		if (!this_smartass->enable ||
+		    policy->cur >= validate_freq(policy,sleep_wakeup_freq))
+			continue;
+
+		this_smartass->old_freq = policy->cur;
+		this_smartass->ramp_dir = 2;
+		work_cpumask_set(cpu);
+		queued_work = 1;
+	}
+
+	if (queued_work)
+		queue_work(up_wq, &freq_scale_work);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block smartass_input_boost_nb = {
+	.notifier_call = smartass_input_boost,
+};
+
 static ssize_t show_debug_mask(struct kobject *kobj, struct attribute *attr, char *buf)
 {
 	return sprintf(buf, "%lu\n", debug_mask);
@@ -844,6 +887,7 @@ static int __init cpufreq_smartass_init(void)
 	INIT_WORK(&freq_scale_work, cpufreq_smartass_freq_change_time_work);
 
 	register_early_suspend(&smartass_power_suspend);
+	cpufreq_register_input_boost_notifier(&smartass_input_boost_nb);
 
 	return cpufreq_register_governor(&cpufreq_gov_smartass2);
 }
@@ -857,6 +901,7 @@ module_init(cpufreq_smartass_init);
 static void __exit cpufreq_smartass_exit(void)
 {
 	cpufreq_unregister_governor(&cpufreq_gov_smartass2);
+	cpufreq_unregister_input_boost_notifier(&smartass_input_boost_nb);
 	destroy_workqueue(up_wq);
 	destroy_workqueue(down_wq);
 }
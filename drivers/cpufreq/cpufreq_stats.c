@@ -20,6 +20,8 @@
 #include <linux/kobject.h>
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
+#include <linux/hrtimer.h>
+#include <linux/log2.h>
 #include <asm/cputime.h>
 
 static spinlock_t cpufreq_stats_lock;
@@ -30,6 +32,14 @@ static struct freq_attr _attr_##_name = {\
 	.show = _show,\
 };
 
+/*
+ * Transition latency, from PRECHANGE to POSTCHANGE, in power of two
+ * buckets: the first counts switches under 16us, the last those of
+ * 16ms and more.
+ */
+#define LATENCY_HIST_MIN_SHIFT	4
+#define LATENCY_HIST_BUCKETS	12
+
 struct cpufreq_stats {
 	unsigned int cpu;
 	unsigned int total_trans;
@@ -38,7 +48,12 @@ struct cpufreq_stats {
 	unsigned int state_num;
 	unsigned int last_index;
 	cputime64_t *time_in_state;
+	u64 *latency_total;
 	unsigned int *freq_table;
+	unsigned int *latency_count;
+	unsigned int *latency_max;
+	ktime_t trans_start;
+	unsigned int latency_hist[LATENCY_HIST_BUCKETS];
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
 #endif
@@ -93,6 +108,44 @@ static ssize_t show_time_in_state(struct cpufreq_policy *policy, char *buf)
 	return len;
 }
 
+/* Cost of switching to each frequency: count, average and worst in us */
+static ssize_t show_trans_latency(struct cpufreq_policy *policy, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+	spin_lock(&cpufreq_stats_lock);
+	for (i = 0; i < stat->state_num; i++) {
+		unsigned int count = stat->latency_count[i];
+
+		len += sprintf(buf + len, "%u %u %llu %u\n",
+			stat->freq_table[i], count,
+			count ? div_u64(stat->latency_total[i], count) : 0,
+			stat->latency_max[i]);
+	}
+	spin_unlock(&cpufreq_stats_lock);
+	return len;
+}
+
+static ssize_t show_trans_latency_hist(struct cpufreq_policy *policy,
+				       char *buf)
+{
+	ssize_t len = 0;
+	int i;
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+	spin_lock(&cpufreq_stats_lock);
+	for (i = 0; i < LATENCY_HIST_BUCKETS; i++)
+		len += sprintf(buf + len, "%u %u\n",
+			i ? 1U << (i + LATENCY_HIST_MIN_SHIFT - 1) : 0,
+			stat->latency_hist[i]);
+	spin_unlock(&cpufreq_stats_lock);
+	return len;
+}
+
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 static ssize_t show_trans_table(struct cpufreq_policy *policy, char *buf)
 {
@@ -142,10 +195,14 @@ CPUFREQ_STATDEVICE_ATTR(trans_table, 0444, show_trans_table);
 
 CPUFREQ_STATDEVICE_ATTR(total_trans, 0444, show_total_trans);
 CPUFREQ_STATDEVICE_ATTR(time_in_state, 0444, show_time_in_state);
+CPUFREQ_STATDEVICE_ATTR(trans_latency, 0444, show_trans_latency);
+CPUFREQ_STATDEVICE_ATTR(trans_latency_hist, 0444, show_trans_latency_hist);
 
 static struct attribute *default_attrs[] = {
 	&_attr_total_trans.attr,
 	&_attr_time_in_state.attr,
+	&_attr_trans_latency.attr,
+	&_attr_trans_latency_hist.attr,
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	&_attr_trans_table.attr,
 #endif
@@ -225,6 +282,7 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 	}
 
 	alloc_size = count * sizeof(int) + count * sizeof(cputime64_t);
+	alloc_size += count * (sizeof(u64) + 2 * sizeof(int));
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	alloc_size += count * count * sizeof(int);
@@ -235,10 +293,13 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 		ret = -ENOMEM;
 		goto error_out;
 	}
-	stat->freq_table = (unsigned int *)(stat->time_in_state + count);
+	stat->latency_total = (u64 *)(stat->time_in_state + count);
+	stat->freq_table = (unsigned int *)(stat->latency_total + count);
+	stat->latency_count = stat->freq_table + count;
+	stat->latency_max = stat->latency_count + count;
 
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
-	stat->trans_table = stat->freq_table + count;
+	stat->trans_table = stat->latency_max + count;
 #endif
 	j = 0;
 	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
@@ -287,14 +348,24 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	struct cpufreq_freqs *freq = data;
 	struct cpufreq_stats *stat;
 	int old_index, new_index;
+	ktime_t start;
+	u32 latency;
 
-	if (val != CPUFREQ_POSTCHANGE)
+	if (val != CPUFREQ_PRECHANGE && val != CPUFREQ_POSTCHANGE)
 		return 0;
 
 	stat = per_cpu(cpufreq_stats_table, freq->cpu);
 	if (!stat)
 		return 0;
 
+	if (val == CPUFREQ_PRECHANGE) {
+		stat->trans_start = ktime_get();
+		return 0;
+	}
+
+	start = stat->trans_start;
+	stat->trans_start = ktime_set(0, 0);
+
 	old_index = stat->last_index;
 	new_index = freq_table_get_index(stat, freq->new);
 
@@ -313,6 +384,18 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	stat->trans_table[old_index * stat->max_state + new_index]++;
 #endif
 	stat->total_trans++;
+	if (start.tv64) {
+		latency = ktime_us_delta(ktime_get(), start);
+		stat->latency_total[new_index] += latency;
+		stat->latency_count[new_index]++;
+		if (latency > stat->latency_max[new_index])
+			stat->latency_max[new_index] = latency;
+		if (latency < (1U << LATENCY_HIST_MIN_SHIFT))
+			stat->latency_hist[0]++;
+		else
+			stat->latency_hist[min_t(int, LATENCY_HIST_BUCKETS - 1,
+				ilog2(latency) - LATENCY_HIST_MIN_SHIFT + 1)]++;
+	}
 	spin_unlock(&cpufreq_stats_lock);
 	return 0;
 }
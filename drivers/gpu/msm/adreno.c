@@ -118,6 +118,7 @@ static struct adreno_device device_3d0 = {
 	.pm4_fw = NULL,
 	.wait_timeout = 0, /* in milliseconds, 0 means disabled */
 	.ib_check_level = 0,
+	.hang_dump_window = 30000, /* in milliseconds, 0 means always dump */
 };
 
 /* This set of registers are used for Hang detection
@@ -1610,6 +1611,12 @@ _adreno_recover_hang(struct kgsl_device *device,
 				adreno_dev->drawctxt_active = last_ctx->devctxt;
 		}
 	}
+
+	/* Replayed commands leave the active context's shadows stale */
+	if (adreno_dev->drawctxt_active) {
+		adreno_dev->drawctxt_active->flags |= CTXT_FLAGS_STATE_DIRTY;
+		adreno_dev->drawctxt_active->flags &= ~CTXT_FLAGS_GMEM_SAVED;
+	}
 done:
 	/* Turn off iommu clocks */
 	if (KGSL_MMU_TYPE_IOMMU == kgsl_mmu_get_mmutype())
@@ -1686,10 +1693,34 @@ done:
 	return ret;
 }
 
+/*
+ * The postmortem dump goes to the kernel log and takes far longer than the
+ * recovery itself.  Only the first hang in a hang_dump_window gets it, a
+ * burst of repeated hangs is usually the same fault and the first dump and
+ * snapshot (which stays frozen until it is read) already describe it.
+ */
+static bool adreno_hang_full_dump(struct adreno_device *adreno_dev)
+{
+	unsigned long now = jiffies;
+	bool full = true;
+
+	if (adreno_dev->hang_dump_window && adreno_dev->last_hang &&
+		time_before(now, adreno_dev->last_hang +
+			msecs_to_jiffies(adreno_dev->hang_dump_window)))
+		full = false;
+
+	/* Keep the window anchored on the last dumped hang */
+	if (full)
+		adreno_dev->last_hang = now ? now : 1;
+
+	return full;
+}
+
 int
 adreno_dump_and_recover(struct kgsl_device *device)
 {
 	int result = -ETIMEDOUT;
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
 	struct adreno_recovery_data rec_data;
 
 	if (device->state == KGSL_STATE_HUNG)
@@ -1707,17 +1738,25 @@ adreno_dump_and_recover(struct kgsl_device *device)
 
 		/* Get the recovery data as soon as hang is detected */
 		result = adreno_setup_recovery_data(device, &rec_data);
-		/*
-		 * Trigger an automatic dump of the state to
-		 * the console
-		 */
-		kgsl_postmortem_dump(device, 0);
 
-		/*
-		 * Make a GPU snapshot.  For now, do it after the PM dump so we
-		 * can at least be sure the PM dump will work as it always has
-		 */
-		kgsl_device_snapshot(device, 1);
+		if (adreno_hang_full_dump(adreno_dev)) {
+			/*
+			 * Trigger an automatic dump of the state to
+			 * the console
+			 */
+			kgsl_postmortem_dump(device, 0);
+
+			/*
+			 * Make a GPU snapshot.  For now, do it after the PM
+			 * dump so we can at least be sure the PM dump will
+			 * work as it always has
+			 */
+			kgsl_device_snapshot(device, 1);
+		} else {
+			adreno_dev->hang_dumps_skipped++;
+			KGSL_DRV_ERR(device,
+				"Repeated GPU hang, skipping state dump\n");
+		}
 
 		result = adreno_recover_hang(device, &rec_data);
 		adreno_destroy_recovery_data(&rec_data);
@@ -2284,16 +2323,36 @@ static int adreno_next_event(struct kgsl_device *device,
 	return adreno_check_hw_ts(device, event->context, event->timestamp);
 }
 
-static int adreno_check_interrupt_timestamp(struct kgsl_device *device,
-		struct kgsl_context *context, unsigned int timestamp)
+/*
+ * A waiter in adreno_waittimestamp.  It is registered as a regular
+ * timestamp event so it sits in the (sorted) per-context event list and is
+ * woken by the event worker only when its own timestamp retires.
+ */
+struct adreno_ts_waiter {
+	wait_queue_head_t wq;
+	unsigned int timestamp;
+	int done;
+};
+
+static void adreno_ts_waiter_retired(struct kgsl_device *device, void *priv,
+		u32 id, u32 timestamp)
 {
-	int status;
+	struct adreno_ts_waiter *waiter = priv;
 
-	mutex_lock(&device->mutex);
-	status = adreno_check_hw_ts(device, context, timestamp);
-	mutex_unlock(&device->mutex);
+	/*
+	 * Runs with the device mutex held; the waiter retakes the mutex
+	 * before it returns so it can't go away under the wake up.
+	 */
+	waiter->timestamp = timestamp;
+	waiter->done = 1;
+	wake_up_interruptible(&waiter->wq);
+}
 
-	return status;
+/* 0 if the waiter's timestamp retired, -EINVAL if the event was canceled */
+static inline int adreno_ts_waiter_status(struct adreno_ts_waiter *waiter,
+		unsigned int timestamp)
+{
+	return (timestamp_cmp(waiter->timestamp, timestamp) >= 0) ? 0 : -EINVAL;
 }
 
 /*
@@ -2457,6 +2516,7 @@ static int adreno_waittimestamp(struct kgsl_device *device,
 	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
 	unsigned int context_id = _get_context_id(context);
 	unsigned int prev_reg_val[hang_detect_regs_count];
+	struct adreno_ts_waiter waiter;
 	unsigned int time_elapsed = 0;
 	unsigned int wait;
 	int ts_compare = 1;
@@ -2488,6 +2548,21 @@ static int adreno_waittimestamp(struct kgsl_device *device,
 	/* Clear the registers used for hang detection */
 	memset(prev_reg_val, 0, sizeof(prev_reg_val));
 
+	/*
+	 * Queue ourselves as an event on the timestamp.  The event code takes
+	 * care of arming the timestamp interrupt for the earliest pending
+	 * event, and the interrupt only wakes the waiters that have retired.
+	 */
+	init_waitqueue_head(&waiter.wq);
+	waiter.done = 0;
+
+	ret = kgsl_add_event(device, context_id, timestamp,
+		adreno_ts_waiter_retired, &waiter, &waiter);
+	if (ret)
+		return ret;
+
+	ret = -ETIMEDOUT;
+
 	/*
 	 * On the first time through the loop only wait 100ms.
 	 * this gives enough time for the engine to start moving and oddly
@@ -2508,6 +2583,11 @@ static int adreno_waittimestamp(struct kgsl_device *device,
 		 * work needs to be queued.
 		 */
 
+		if (waiter.done) {
+			ret = adreno_ts_waiter_status(&waiter, timestamp);
+			break;
+		}
+
 		if (kgsl_check_timestamp(device, context, timestamp)) {
 			queue_work(device->work_queue, &device->ts_expired_ws);
 			ret = 0;
@@ -2534,11 +2614,9 @@ static int adreno_waittimestamp(struct kgsl_device *device,
 
 		mutex_unlock(&device->mutex);
 
-		/* Wait for a timestamp event */
-		status = kgsl_wait_event_interruptible_timeout(
-			device->wait_queue,
-			adreno_check_interrupt_timestamp(device, context,
-				timestamp), msecs_to_jiffies(wait), io);
+		/* Wait for our timestamp event to fire */
+		status = kgsl_wait_event_interruptible_timeout(waiter.wq,
+			waiter.done, msecs_to_jiffies(wait), io);
 
 		mutex_lock(&device->mutex);
 
@@ -2549,7 +2627,9 @@ static int adreno_waittimestamp(struct kgsl_device *device,
 		 */
 
 		if (status != 0) {
-			ret = (status > 0) ? 0 : (int) status;
+			ret = (status > 0) ?
+				adreno_ts_waiter_status(&waiter, timestamp) :
+				(int) status;
 			break;
 		}
 		time_elapsed += wait;
@@ -2591,6 +2671,10 @@ static int adreno_waittimestamp(struct kgsl_device *device,
 
 	} while (!msecs || time_elapsed < msecs);
 
+	if (!waiter.done)
+		kgsl_cancel_event(device, context_id, timestamp,
+			adreno_ts_waiter_retired, &waiter);
+
 	return ret;
 }
 
@@ -2737,6 +2821,7 @@ static const struct kgsl_functable adreno_functable = {
 	.waittimestamp = adreno_waittimestamp,
 	.readtimestamp = adreno_readtimestamp,
 	.issueibcmds = adreno_ringbuffer_issueibcmds,
+	.issueibcmds_batch = adreno_ringbuffer_issueibcmds_batch,
 	.ioctl = adreno_ioctl,
 	.setup_pt = adreno_setup_pt,
 	.cleanup_pt = adreno_cleanup_pt,
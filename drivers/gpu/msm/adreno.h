@@ -36,6 +36,10 @@
 #define KGSL_CMD_FLAGS_NONE             0x00000000
 #define KGSL_CMD_FLAGS_PMODE		0x00000001
 #define KGSL_CMD_FLAGS_INTERNAL_ISSUE	0x00000002
+/* Leave out the timestamp interrupt (not the last entry of a batch) */
+#define KGSL_CMD_FLAGS_NO_TS_INT	0x00000004
+/* Raise the timestamp interrupt even if nobody is waiting yet */
+#define KGSL_CMD_FLAGS_TS_INT		0x00000008
 
 /* Command identifiers */
 #define KGSL_CONTEXT_TO_MEM_IDENTIFIER	0x2EADBEEF
@@ -48,6 +52,8 @@
 #define ADRENO_DEFAULT_PWRSCALE_POLICY  (&kgsl_pwrscale_policy_tz)
 #elif defined CONFIG_MSM_SLEEP_STATS_DEVICE
 #define ADRENO_DEFAULT_PWRSCALE_POLICY  (&kgsl_pwrscale_policy_idlestats)
+#elif defined CONFIG_MSM_KGSL_PWRSCALE_PREDICT
+#define ADRENO_DEFAULT_PWRSCALE_POLICY  (&kgsl_pwrscale_policy_predict)
 #else
 #define ADRENO_DEFAULT_PWRSCALE_POLICY  NULL
 #endif
@@ -79,6 +85,22 @@ enum adreno_gpurev {
 
 struct adreno_gpudev;
 
+/* Per-submission GPU profiling, see adreno_profile_retire() */
+struct adreno_profile {
+	unsigned int enabled;
+	unsigned int counting;	/* busy counter enabled since the last start */
+	unsigned int head;	/* next slot to fill */
+	unsigned int tail;	/* oldest slot not yet collected */
+	struct {
+		unsigned int ctxt_id;
+		unsigned int timestamp;	/* global timestamp of the submission */
+	} slot[ADRENO_PROFILE_SLOTS];
+	u64 cycles;
+	unsigned int submits;
+	unsigned int dropped;	/* not profiled because every slot was busy */
+	unsigned int resets;	/* pairs that straddled a counter reset */
+};
+
 struct adreno_device {
 	struct kgsl_device dev;    /* Must be first field in this struct */
 	unsigned int chip_id;
@@ -103,6 +125,14 @@ struct adreno_device {
 	unsigned int instruction_size;
 	unsigned int ib_check_level;
 	unsigned int fast_hang_detect;
+	/* context saves skipped because the shadows were current */
+	unsigned int ctxt_save_elided;
+	unsigned int gmem_save_elided;
+	/* hangs within this many msecs of a dumped one skip the dump */
+	unsigned int hang_dump_window;
+	unsigned int hang_dumps_skipped;
+	unsigned long last_hang;
+	struct adreno_profile profile;
 	unsigned int gpulist_index;
 	struct ocmem_buf *ocmem_hdl;
 	unsigned int ocmem_base;
@@ -1506,6 +1506,7 @@ static void a2xx_drawctxt_save(struct adreno_device *adreno_dev,
 			struct adreno_context *context)
 {
 	struct kgsl_device *device = &adreno_dev->dev;
+	bool clean;
 
 	if (context == NULL || (context->flags & CTXT_FLAGS_BEING_DESTROYED))
 		return;
@@ -1514,7 +1515,15 @@ static void a2xx_drawctxt_save(struct adreno_device *adreno_dev,
 		KGSL_CTXT_WARN(device,
 			"Current active context has caused gpu hang\n");
 
-	if (!(context->flags & CTXT_FLAGS_PREAMBLE)) {
+	/*
+	 * Nothing ran for this context since it was last saved, so the
+	 * shadows still match what it left behind.
+	 */
+	clean = !(context->flags & CTXT_FLAGS_STATE_DIRTY);
+
+	if (clean && !(context->flags & CTXT_FLAGS_PREAMBLE)) {
+		adreno_dev->ctxt_save_elided++;
+	} else if (!(context->flags & CTXT_FLAGS_PREAMBLE)) {
 
 		/* save registers and constants. */
 		adreno_ringbuffer_issuecmds(device, context,
@@ -1540,6 +1549,12 @@ static void a2xx_drawctxt_save(struct adreno_device *adreno_dev,
 	}
 
 	if ((context->flags & CTXT_FLAGS_GMEM_SAVE) &&
+	    (context->flags & CTXT_FLAGS_GMEM_SHADOW) &&
+	    clean && (context->flags & CTXT_FLAGS_GMEM_SAVED)) {
+		adreno_dev->gmem_save_elided++;
+		context->flags |= CTXT_FLAGS_GMEM_RESTORE;
+		a2xx_drawctxt_draw_workaround(adreno_dev, context);
+	} else if ((context->flags & CTXT_FLAGS_GMEM_SAVE) &&
 	    (context->flags & CTXT_FLAGS_GMEM_SHADOW)) {
 		/* save gmem.
 		 * (note: changes shader. shader must already be saved.)
@@ -1556,9 +1571,12 @@ static void a2xx_drawctxt_save(struct adreno_device *adreno_dev,
 		}
 		adreno_dev->gpudev->ctx_switches_since_last_draw = 0;
 
-		context->flags |= CTXT_FLAGS_GMEM_RESTORE;
+		context->flags |= CTXT_FLAGS_GMEM_RESTORE |
+			CTXT_FLAGS_GMEM_SAVED;
 	} else if (adreno_is_a2xx(adreno_dev))
 		a2xx_drawctxt_draw_workaround(adreno_dev, context);
+
+	context->flags &= ~CTXT_FLAGS_STATE_DIRTY;
 }
 
 static void a2xx_drawctxt_restore(struct adreno_device *adreno_dev,
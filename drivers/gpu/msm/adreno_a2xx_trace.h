@@ -72,6 +72,40 @@ TRACE_EVENT(kgsl_a2xx_irq_status,
 	)
 );
 
+/*
+ * Tracepoint for the busy cycles of a profiled submission, reported
+ * when its counts are collected after it retired
+ */
+TRACE_EVENT(kgsl_a2xx_profile,
+
+	TP_PROTO(struct kgsl_device *device, unsigned int id,
+		 unsigned int timestamp, unsigned int cycles),
+
+	TP_ARGS(device, id, timestamp, cycles),
+
+	TP_STRUCT__entry(
+		__string(device_name, device->name)
+		__field(unsigned int, id)
+		__field(unsigned int, timestamp)
+		__field(unsigned int, cycles)
+	),
+
+	TP_fast_assign(
+		__assign_str(device_name, device->name);
+		__entry->id = id;
+		__entry->timestamp = timestamp;
+		__entry->cycles = cycles;
+	),
+
+	TP_printk(
+		"d_name=%s ctx=%u ts=%u cycles=%u",
+		__get_str(device_name),
+		__entry->id,
+		__entry->timestamp,
+		__entry->cycles
+	)
+);
+
 #endif /* _ADRENO_A2XX_TRACE_H */
 
 /* This part must be outside protection */
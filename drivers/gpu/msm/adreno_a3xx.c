@@ -2383,6 +2383,7 @@ static void a3xx_drawctxt_save(struct adreno_device *adreno_dev,
 			   struct adreno_context *context)
 {
 	struct kgsl_device *device = &adreno_dev->dev;
+	bool clean;
 
 	if (context == NULL || (context->flags & CTXT_FLAGS_BEING_DESTROYED))
 		return;
@@ -2391,7 +2392,12 @@ static void a3xx_drawctxt_save(struct adreno_device *adreno_dev,
 		KGSL_CTXT_WARN(device,
 			       "Current active context has caused gpu hang\n");
 
-	if (!(context->flags & CTXT_FLAGS_PREAMBLE)) {
+	/* The shadows are current if nothing ran since the last save */
+	clean = !(context->flags & CTXT_FLAGS_STATE_DIRTY);
+
+	if (clean && !(context->flags & CTXT_FLAGS_PREAMBLE)) {
+		adreno_dev->ctxt_save_elided++;
+	} else if (!(context->flags & CTXT_FLAGS_PREAMBLE)) {
 		/* Fixup self modifying IBs for save operations */
 		adreno_ringbuffer_issuecmds(device, context,
 			KGSL_CMD_FLAGS_NONE, context->save_fixup, 3);
@@ -2412,17 +2418,24 @@ static void a3xx_drawctxt_save(struct adreno_device *adreno_dev,
 
 	if ((context->flags & CTXT_FLAGS_GMEM_SAVE) &&
 	    (context->flags & CTXT_FLAGS_GMEM_SHADOW)) {
-		/*
-		 * Save GMEM (note: changes shader. shader must
-		 * already be saved.)
-		 */
+		if (clean && (context->flags & CTXT_FLAGS_GMEM_SAVED)) {
+			adreno_dev->gmem_save_elided++;
+		} else {
+			/*
+			 * Save GMEM (note: changes shader. shader must
+			 * already be saved.)
+			 */
 
-		adreno_ringbuffer_issuecmds(device, context,
-					KGSL_CMD_FLAGS_PMODE,
-					    context->context_gmem_shadow.
-					    gmem_save, 3);
+			adreno_ringbuffer_issuecmds(device, context,
+						KGSL_CMD_FLAGS_PMODE,
+						    context->context_gmem_shadow.
+						    gmem_save, 3);
+			context->flags |= CTXT_FLAGS_GMEM_SAVED;
+		}
 		context->flags |= CTXT_FLAGS_GMEM_RESTORE;
 	}
+
+	context->flags &= ~CTXT_FLAGS_STATE_DIRTY;
 }
 
 static void a3xx_drawctxt_restore(struct adreno_device *adreno_dev,
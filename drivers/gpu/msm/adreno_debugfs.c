@@ -16,6 +16,8 @@
 #include <linux/debugfs.h>
 #include <linux/uaccess.h>
 #include <linux/io.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
 
 #include "kgsl.h"
 #include "adreno.h"
@@ -43,6 +45,88 @@ static int kgsl_cff_dump_enable_get(void *data, u64 *val)
 DEFINE_SIMPLE_ATTRIBUTE(kgsl_cff_dump_enable_fops, kgsl_cff_dump_enable_get,
 			kgsl_cff_dump_enable_set, "%llu\n");
 
+static int adreno_profile_show(struct seq_file *s, void *unused)
+{
+	struct kgsl_device *device = s->private;
+	struct adreno_profile *profile = &ADRENO_DEVICE(device)->profile;
+	struct kgsl_context *context;
+	struct adreno_context *drawctxt;
+	int next = 0;
+
+	mutex_lock(&device->mutex);
+	adreno_profile_retire(device);
+
+	seq_printf(s, "submits %u cycles %llu dropped %u resets %u\n",
+		   profile->submits, profile->cycles, profile->dropped,
+		   profile->resets);
+	seq_printf(s, "%5s %6s %8s %12s %10s %5s\n", "ctxt", "pid",
+		   "submits", "cycles", "max", "busy");
+
+	/* each context's share of the profiled busy cycles */
+	while ((context = idr_get_next(&device->context_idr, &next))) {
+		drawctxt = context->devctxt;
+		if (drawctxt && drawctxt->profile_submits)
+			seq_printf(s, "%5u %6d %8u %12llu %10u %4llu%%\n",
+				context->id,
+				context->dev_priv->process_priv->pid,
+				drawctxt->profile_submits,
+				drawctxt->profile_cycles,
+				drawctxt->profile_max,
+				div64_u64(drawctxt->profile_cycles * 100,
+					  max_t(u64, profile->cycles, 1)));
+		next++;
+	}
+	mutex_unlock(&device->mutex);
+
+	return 0;
+}
+
+static int adreno_profile_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, adreno_profile_show, inode->i_private);
+}
+
+/* Any write clears the totals */
+static ssize_t adreno_profile_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct kgsl_device *device =
+		((struct seq_file *)file->private_data)->private;
+	struct adreno_profile *profile = &ADRENO_DEVICE(device)->profile;
+	struct kgsl_context *context;
+	struct adreno_context *drawctxt;
+	int next = 0;
+
+	mutex_lock(&device->mutex);
+	adreno_profile_retire(device);
+
+	profile->cycles = 0;
+	profile->submits = 0;
+	profile->dropped = 0;
+	profile->resets = 0;
+
+	while ((context = idr_get_next(&device->context_idr, &next))) {
+		drawctxt = context->devctxt;
+		if (drawctxt) {
+			drawctxt->profile_cycles = 0;
+			drawctxt->profile_submits = 0;
+			drawctxt->profile_max = 0;
+		}
+		next++;
+	}
+	mutex_unlock(&device->mutex);
+
+	return count;
+}
+
+static const struct file_operations adreno_profile_fops = {
+	.open		= adreno_profile_open,
+	.read		= seq_read,
+	.write		= adreno_profile_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 typedef void (*reg_read_init_t)(struct kgsl_device *device);
 typedef void (*reg_read_fill_t)(struct kgsl_device *device, int i,
 	unsigned int *vals, int linec);
@@ -64,5 +148,17 @@ void adreno_debugfs_init(struct kgsl_device *device)
 	adreno_dev->fast_hang_detect = 1;
 	debugfs_create_u32("fast_hang_detect", 0644, device->d_debugfs,
 			   &adreno_dev->fast_hang_detect);
+	debugfs_create_u32("ctxt_save_elided", 0444, device->d_debugfs,
+			   &adreno_dev->ctxt_save_elided);
+	debugfs_create_u32("gmem_save_elided", 0444, device->d_debugfs,
+			   &adreno_dev->gmem_save_elided);
+	debugfs_create_u32("hang_dump_window", 0644, device->d_debugfs,
+			   &adreno_dev->hang_dump_window);
+	debugfs_create_u32("hang_dumps_skipped", 0444, device->d_debugfs,
+			   &adreno_dev->hang_dumps_skipped);
+	debugfs_create_u32("profile", 0644, device->d_debugfs,
+			   &adreno_dev->profile.enabled);
+	debugfs_create_file("profile_stats", 0644, device->d_debugfs, device,
+			    &adreno_profile_fops);
 
 }
@@ -158,6 +158,7 @@ int adreno_drawctxt_create(struct kgsl_device *device,
 	drawctxt->pagetable = pagetable;
 	drawctxt->bin_base_offset = 0;
 	drawctxt->id = context->id;
+	drawctxt->flags |= CTXT_FLAGS_STATE_DIRTY;
 	rb->timestamp[context->id] = 0;
 
 	if (flags & KGSL_CONTEXT_PREAMBLE)
@@ -237,6 +238,9 @@ void adreno_drawctxt_destroy(struct kgsl_device *device,
 	if (device->state != KGSL_STATE_HUNG)
 		adreno_idle(device);
 
+	/* collect its profiled submissions before the id can be reused */
+	adreno_profile_retire(device);
+
 	kgsl_sharedmem_free(&drawctxt->gpustate);
 	kgsl_sharedmem_free(&drawctxt->context_gmem_shadow.gmemshadow);
 
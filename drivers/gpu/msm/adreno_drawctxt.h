@@ -50,6 +50,10 @@
 #define CTXT_FLAGS_BEING_DESTROYED	BIT(13)
 /* User mode generated timestamps enabled */
 #define CTXT_FLAGS_USER_GENERATED_TS    BIT(14)
+/* Commands were submitted since the state was last saved */
+#define CTXT_FLAGS_STATE_DIRTY		BIT(15)
+/* gmem shadow holds the current gmem contents */
+#define CTXT_FLAGS_GMEM_SAVED		BIT(16)
 
 struct kgsl_device;
 struct adreno_device;
@@ -111,6 +115,11 @@ struct adreno_context {
 	struct kgsl_memdesc constant_load_commands[3];
 	struct kgsl_memdesc cond_execs[4];
 	struct kgsl_memdesc hlsqcontrol_restore_commands[1];
+
+	/* Busy cycles of this context's profiled submissions */
+	u64 profile_cycles;
+	unsigned int profile_submits;
+	unsigned int profile_max;
 };
 
 int adreno_drawctxt_create(struct kgsl_device *device,
@@ -25,6 +25,7 @@
 
 #include "a2xx_reg.h"
 #include "a3xx_reg.h"
+#include "adreno_a2xx_trace.h"
 
 #define GSL_RB_NOP_SIZEDWORDS				2
 
@@ -36,7 +37,7 @@
 
 #define CP_DEBUG_DEFAULT ((1 << 27) | (1 << 25))
 
-void adreno_ringbuffer_submit(struct adreno_ringbuffer *rb)
+static void __adreno_ringbuffer_submit(struct adreno_ringbuffer *rb)
 {
 	BUG_ON(rb->wptr == 0);
 
@@ -52,6 +53,15 @@ void adreno_ringbuffer_submit(struct adreno_ringbuffer *rb)
 	adreno_regwrite(rb->device, REG_CP_RB_WPTR, rb->wptr);
 }
 
+void adreno_ringbuffer_submit(struct adreno_ringbuffer *rb)
+{
+	/* A batch is handed to the CP once all of it is in the ring */
+	if (rb->batch)
+		return;
+
+	__adreno_ringbuffer_submit(rb);
+}
+
 static int
 adreno_ringbuffer_waitspace(struct adreno_ringbuffer *rb,
 				struct adreno_context *context,
@@ -68,6 +78,10 @@ adreno_ringbuffer_waitspace(struct adreno_ringbuffer *rb,
 
 	memset(prev_reg_val, 0, sizeof(prev_reg_val));
 
+	/* The CP can only free space for commands it has been given */
+	if (rb->batch && rb->wptr)
+		__adreno_ringbuffer_submit(rb);
+
 	/* if wptr ahead, fill the remaining with NOPs */
 	if (wptr_ahead) {
 		/* -1 for header */
@@ -88,7 +102,7 @@ adreno_ringbuffer_waitspace(struct adreno_ringbuffer *rb,
 
 		rb->wptr++;
 
-		adreno_ringbuffer_submit(rb);
+		__adreno_ringbuffer_submit(rb);
 
 		rb->wptr = 0;
 	}
@@ -331,12 +345,19 @@ int adreno_ringbuffer_start(struct adreno_ringbuffer *rb, unsigned int init_ram)
 	if (rb->flags & KGSL_FLAGS_STARTED)
 		return 0;
 
+	/* A restart in the middle of a batch submits the rest directly */
+	rb->batch = 0;
+
 	if (init_ram)
 		rb->timestamp[KGSL_MEMSTORE_GLOBAL] = 0;
 
 	kgsl_sharedmem_set(&rb->memptrs_desc, 0, 0,
 			   sizeof(struct kgsl_rbmemptrs));
 
+	/* anything still in flight was lost with the old ring */
+	adreno_dev->profile.tail = adreno_dev->profile.head;
+	adreno_dev->profile.counting = 0;
+
 	kgsl_sharedmem_set(&rb->buffer_desc, 0, 0xAA,
 			   (rb->sizedwords << 2));
 
@@ -464,6 +485,8 @@ void adreno_ringbuffer_stop(struct adreno_ringbuffer *rb)
 	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
 
 	if (rb->flags & KGSL_FLAGS_STARTED) {
+		adreno_profile_retire(device);
+
 		if (adreno_is_a200(adreno_dev))
 			adreno_regwrite(rb->device, REG_CP_ME_CNTL, 0x10000000);
 
@@ -573,7 +596,8 @@ adreno_ringbuffer_addcmds(struct adreno_ringbuffer *rb,
 	total_sizedwords += (flags & KGSL_CMD_FLAGS_INTERNAL_ISSUE) ? 2 : 0;
 
 	/* Add CP_COND_EXEC commands to generate CP_INTERRUPT */
-	total_sizedwords += context ? 13 : 0;
+	if (context && !(flags & KGSL_CMD_FLAGS_NO_TS_INT))
+		total_sizedwords += (flags & KGSL_CMD_FLAGS_TS_INT) ? 8 : 13;
 
 	if (adreno_is_a3xx(adreno_dev))
 		total_sizedwords += 7;
@@ -711,19 +735,21 @@ adreno_ringbuffer_addcmds(struct adreno_ringbuffer *rb,
 		GSL_RB_WRITE(ringcmds, rcmd_gpu, CACHE_FLUSH);
 	}
 
-	if (context) {
-		/* Conditional execution based on memory values */
-		GSL_RB_WRITE(ringcmds, rcmd_gpu,
-			cp_type3_packet(CP_COND_EXEC, 4));
-		GSL_RB_WRITE(ringcmds, rcmd_gpu, (gpuaddr +
-			KGSL_MEMSTORE_OFFSET(
-				context_id, ts_cmp_enable)) >> 2);
-		GSL_RB_WRITE(ringcmds, rcmd_gpu, (gpuaddr +
-			KGSL_MEMSTORE_OFFSET(
-				context_id, ref_wait_ts)) >> 2);
-		GSL_RB_WRITE(ringcmds, rcmd_gpu, timestamp);
-		/* # of conditional command DWORDs */
-		GSL_RB_WRITE(ringcmds, rcmd_gpu, 8);
+	if (context && !(flags & KGSL_CMD_FLAGS_NO_TS_INT)) {
+		if (!(flags & KGSL_CMD_FLAGS_TS_INT)) {
+			/* Conditional execution based on memory values */
+			GSL_RB_WRITE(ringcmds, rcmd_gpu,
+				cp_type3_packet(CP_COND_EXEC, 4));
+			GSL_RB_WRITE(ringcmds, rcmd_gpu, (gpuaddr +
+				KGSL_MEMSTORE_OFFSET(
+					context_id, ts_cmp_enable)) >> 2);
+			GSL_RB_WRITE(ringcmds, rcmd_gpu, (gpuaddr +
+				KGSL_MEMSTORE_OFFSET(
+					context_id, ref_wait_ts)) >> 2);
+			GSL_RB_WRITE(ringcmds, rcmd_gpu, timestamp);
+			/* # of conditional command DWORDs */
+			GSL_RB_WRITE(ringcmds, rcmd_gpu, 8);
+		}
 
 		/* Clear the ts_cmp_enable for the context */
 		GSL_RB_WRITE(ringcmds, rcmd_gpu,
@@ -973,45 +999,175 @@ done:
 	return ret;
 }
 
-int
-adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
-				struct kgsl_context *context,
-				struct kgsl_ibdesc *ibdesc,
-				unsigned int numibs,
-				uint32_t *timestamp,
-				unsigned int flags)
+static bool
+_check_ib(struct kgsl_device_private *dev_priv, struct kgsl_ibdesc *ib)
+{
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(dev_priv->device);
+
+	if (unlikely(adreno_dev->ib_check_level >= 1 &&
+	    !_parse_ibs(dev_priv, ib->gpuaddr, ib->sizedwords)))
+		return false;
+
+	return ib->sizedwords != 0;
+}
+
+/*
+ * Optional per-submission profiling, switched on through the "profile"
+ * debugfs file.  The IB chain is bracketed by two CP reads of the busy
+ * cycle counter that pwrscale samples, each behind a wait for idle so
+ * that only this submission's work falls in between.  The a2xx has no
+ * free running counter and pwrscale resets this one whenever it samples,
+ * so a pair that straddles a reset only counts the cycles since then.
+ */
+#define ADRENO_PROFILE_DWORDS	10
+
+/* Dwords needed for the IB1 chain of a submission of numibs IBs */
+#define IB_CHAIN_DWORDS(numibs) ((numibs) * 3 + 4 + ADRENO_PROFILE_DWORDS)
+
+static void adreno_profile_start_counter(struct kgsl_device *device)
+{
+	unsigned int reg;
+
+	adreno_regread(device, REG_RBBM_PM_OVERRIDE2, &reg);
+	adreno_regwrite(device, REG_RBBM_PM_OVERRIDE2, (reg | 0x40));
+	adreno_regwrite(device, REG_RBBM_PERFCOUNTER1_SELECT, 0x1);
+	adreno_regwrite(device, REG_CP_PERFMON_CNTL,
+		REG_PERF_MODE_CNT | REG_PERF_STATE_ENABLE);
+}
+
+/*
+ * Must hold device->mutex.  Returns the slot the next submission is to
+ * be profiled in, or -1 if it is not to be profiled.
+ */
+static int adreno_profile_claim(struct adreno_device *adreno_dev)
+{
+	struct adreno_profile *profile = &adreno_dev->profile;
+
+	if (likely(!profile->enabled) || !adreno_is_a2xx(adreno_dev))
+		return -1;
+
+	if (profile->head - profile->tail == ADRENO_PROFILE_SLOTS) {
+		adreno_profile_retire(&adreno_dev->dev);
+		if (profile->head - profile->tail == ADRENO_PROFILE_SLOTS) {
+			profile->dropped++;
+			return -1;
+		}
+	}
+
+	if (!profile->counting) {
+		adreno_profile_start_counter(&adreno_dev->dev);
+		profile->counting = 1;
+	}
+
+	return profile->head % ADRENO_PROFILE_SLOTS;
+}
+
+static unsigned int *
+adreno_profile_read(struct adreno_device *adreno_dev, unsigned int *cmds,
+		    int slot, int end)
+{
+	*cmds++ = cp_type3_packet(CP_WAIT_FOR_IDLE, 1);
+	*cmds++ = 0;
+	*cmds++ = cp_type3_packet(CP_REG_TO_MEM, 2);
+	*cmds++ = REG_RBBM_PERFCOUNTER1_LO;
+	*cmds++ = adreno_dev->ringbuffer.memptrs_desc.gpuaddr +
+		  GSL_RB_MEMPTRS_PROFILE_OFFSET(slot, end);
+
+	return cmds;
+}
+
+/* Must hold device->mutex, after the profiled chain went to the ring */
+static void adreno_profile_commit(struct adreno_device *adreno_dev,
+				  struct adreno_context *drawctxt,
+				  unsigned int issued)
+{
+	struct adreno_profile *profile = &adreno_dev->profile;
+	unsigned int global =
+		adreno_dev->ringbuffer.timestamp[KGSL_MEMSTORE_GLOBAL];
+	unsigned int i = profile->head % ADRENO_PROFILE_SLOTS;
+
+	/* nothing was written if the timestamp did not move */
+	if (global == issued)
+		return;
+
+	profile->slot[i].ctxt_id = drawctxt->id;
+	profile->slot[i].timestamp = global;
+	profile->head++;
+}
+
+/**
+ * adreno_profile_retire - collect the counts of retired submissions
+ * @device: the adreno device, with device->mutex held
+ *
+ * Adds the busy cycles of each profiled submission the GPU has retired
+ * to its context and to the device totals, and traces it.
+ */
+void adreno_profile_retire(struct kgsl_device *device)
 {
-	struct kgsl_device *device = dev_priv->device;
 	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
-	unsigned int *link;
-	unsigned int *cmds;
-	unsigned int i;
+	struct adreno_profile *profile = &adreno_dev->profile;
+	struct kgsl_rbmemptrs *memptrs = adreno_dev->ringbuffer.memptrs;
+	struct kgsl_context *context;
 	struct adreno_context *drawctxt;
-	unsigned int start_index = 0;
-	int ret;
+	unsigned int retired, start, end, cycles, i;
 
-	if (device->state & KGSL_STATE_HUNG)
-		return -EBUSY;
-	if (!(adreno_dev->ringbuffer.flags & KGSL_FLAGS_STARTED) ||
-	      context == NULL || ibdesc == 0 || numibs == 0)
-		return -EINVAL;
+	if (profile->tail == profile->head)
+		return;
 
-	drawctxt = context->devctxt;
+	retired = kgsl_readtimestamp(device, NULL, KGSL_TIMESTAMP_RETIRED);
+	rmb();
 
-	if (drawctxt->flags & CTXT_FLAGS_GPU_HANG) {
-		KGSL_CTXT_WARN(device, "Context %p caused a gpu hang.."
-			" will not accept commands for context %d\n",
-			drawctxt, drawctxt->id);
-		return -EDEADLK;
-	}
+	for (; profile->tail != profile->head; profile->tail++) {
+		i = profile->tail % ADRENO_PROFILE_SLOTS;
+		if (timestamp_cmp(profile->slot[i].timestamp, retired) > 0)
+			break;
 
-	cmds = link = kzalloc(sizeof(unsigned int) * (numibs * 3 + 4),
-				GFP_KERNEL);
-	if (!link) {
-		KGSL_CORE_ERR("kzalloc(%d) failed\n",
-			sizeof(unsigned int) * (numibs * 3 + 4));
-		return -ENOMEM;
+		start = memptrs->profile[i][0];
+		end = memptrs->profile[i][1];
+		if (end >= start) {
+			cycles = end - start;
+		} else {
+			cycles = end;
+			profile->resets++;
+		}
+
+		profile->cycles += cycles;
+		profile->submits++;
+
+		context = idr_find(&device->context_idr,
+				   profile->slot[i].ctxt_id);
+		drawctxt = context ? context->devctxt : NULL;
+		if (drawctxt) {
+			drawctxt->profile_cycles += cycles;
+			drawctxt->profile_submits++;
+			drawctxt->profile_max = max(drawctxt->profile_max,
+						    cycles);
+		}
+
+		trace_kgsl_a2xx_profile(device, profile->slot[i].ctxt_id,
+					profile->slot[i].timestamp, cycles);
 	}
+}
+
+/*
+ * Build the IB1 chain for one submission in link, which needs room for
+ * IB_CHAIN_DWORDS(numibs) dwords.  If slot is not -1 the chain is
+ * profiled in that slot.  Returns the number of dwords used or -EINVAL
+ * if check is set and one of the IBs is rejected.
+ */
+static int
+_build_ib_chain(struct kgsl_device_private *dev_priv,
+		struct adreno_context *drawctxt,
+		struct kgsl_ibdesc *ibdesc, unsigned int numibs,
+		unsigned int *link, bool check, int slot)
+{
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(dev_priv->device);
+	unsigned int *cmds = link;
+	unsigned int start_index = 0;
+	unsigned int i;
+
+	if (slot >= 0)
+		cmds = adreno_profile_read(adreno_dev, cmds, slot, 0);
 
 	/*When preamble is enabled, the preamble buffer with state restoration
 	commands are stored in the first node of the IB chain. We can skip that
@@ -1032,17 +1188,8 @@ adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 		*cmds++ = ibdesc[0].sizedwords;
 	}
 	for (i = start_index; i < numibs; i++) {
-		if (unlikely(adreno_dev->ib_check_level >= 1 &&
-		    !_parse_ibs(dev_priv, ibdesc[i].gpuaddr,
-				ibdesc[i].sizedwords))) {
-			ret = -EINVAL;
-			goto done;
-		}
-
-		if (ibdesc[i].sizedwords == 0) {
-			ret = -EINVAL;
-			goto done;
-		}
+		if (check && !_check_ib(dev_priv, &ibdesc[i]))
+			return -EINVAL;
 
 		*cmds++ = CP_HDR_INDIRECT_BUFFER_PFD;
 		*cmds++ = ibdesc[i].gpuaddr;
@@ -1052,16 +1199,37 @@ adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 	*cmds++ = cp_nop_packet(1);
 	*cmds++ = KGSL_END_OF_IB_IDENTIFIER;
 
-	kgsl_setstate(&device->mmu, context->id,
-		      kgsl_mmu_pt_get_flags(device->mmu.hwpagetable,
-					device->id));
+	if (slot >= 0)
+		cmds = adreno_profile_read(adreno_dev, cmds, slot, 1);
+
+	return cmds - link;
+}
+
+static int
+_submit_ib_chain(struct kgsl_device_private *dev_priv,
+		struct adreno_context *drawctxt,
+		unsigned int *link, unsigned int sizedwords,
+		uint32_t *timestamp, unsigned int flags,
+		unsigned int cmdflags, int slot)
+{
+	struct kgsl_device *device = dev_priv->device;
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
+	unsigned int issued =
+		adreno_dev->ringbuffer.timestamp[KGSL_MEMSTORE_GLOBAL];
 
 	adreno_drawctxt_switch(adreno_dev, drawctxt, flags);
 
+	/* The shadows go stale once the context's own commands run */
+	drawctxt->flags |= CTXT_FLAGS_STATE_DIRTY;
+	drawctxt->flags &= ~CTXT_FLAGS_GMEM_SAVED;
+
 	*timestamp = adreno_ringbuffer_addcmds(&adreno_dev->ringbuffer,
 					drawctxt,
-					0,
-					&link[0], (cmds - link), *timestamp);
+					cmdflags,
+					link, sizedwords, *timestamp);
+
+	if (slot >= 0)
+		adreno_profile_commit(adreno_dev, drawctxt, issued);
 
 #ifdef CONFIG_MSM_KGSL_CFF_DUMP
 	/*
@@ -1075,14 +1243,152 @@ adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 	/* If context hung and recovered then return error so that the
 	 * application may handle it */
 
-	ret = (drawctxt->flags & CTXT_FLAGS_GPU_HANG_RECOVERED) ?
+	return (drawctxt->flags & CTXT_FLAGS_GPU_HANG_RECOVERED) ?
 		-EDEADLK : 0;
+}
+
+int
+adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
+				struct kgsl_context *context,
+				struct kgsl_ibdesc *ibdesc,
+				unsigned int numibs,
+				uint32_t *timestamp,
+				unsigned int flags)
+{
+	struct kgsl_device *device = dev_priv->device;
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
+	unsigned int *link;
+	struct adreno_context *drawctxt;
+	int slot;
+	int ret;
+
+	if (device->state & KGSL_STATE_HUNG)
+		return -EBUSY;
+	if (!(adreno_dev->ringbuffer.flags & KGSL_FLAGS_STARTED) ||
+	      context == NULL || ibdesc == 0 || numibs == 0)
+		return -EINVAL;
+
+	drawctxt = context->devctxt;
+
+	if (drawctxt->flags & CTXT_FLAGS_GPU_HANG) {
+		KGSL_CTXT_WARN(device, "Context %p caused a gpu hang.."
+			" will not accept commands for context %d\n",
+			drawctxt, drawctxt->id);
+		return -EDEADLK;
+	}
+
+	link = kzalloc(sizeof(unsigned int) * IB_CHAIN_DWORDS(numibs),
+				GFP_KERNEL);
+	if (!link) {
+		KGSL_CORE_ERR("kzalloc(%d) failed\n",
+			sizeof(unsigned int) * IB_CHAIN_DWORDS(numibs));
+		return -ENOMEM;
+	}
+
+	slot = adreno_profile_claim(adreno_dev);
+	ret = _build_ib_chain(dev_priv, drawctxt, ibdesc, numibs, link, true,
+			      slot);
+	if (ret < 0)
+		goto done;
+
+	kgsl_setstate(&device->mmu, context->id,
+		      kgsl_mmu_pt_get_flags(device->mmu.hwpagetable,
+					device->id));
+
+	ret = _submit_ib_chain(dev_priv, drawctxt, link, ret, timestamp,
+			       flags, 0, slot);
 
 done:
 	kfree(link);
 	return ret;
 }
 
+/*
+ * Submit IB chains for several contexts of the same process.  The
+ * pagetable is switched once, the CP WPTR is written once after the
+ * whole batch (including the context switches) is in the ring, and
+ * only the last entry raises the timestamp interrupt.  Everything is
+ * validated before the first entry is written so that a bad entry
+ * cannot leave the ring without a closing interrupt.
+ */
+int
+adreno_ringbuffer_issueibcmds_batch(struct kgsl_device_private *dev_priv,
+				struct kgsl_ibcmds *cmds,
+				unsigned int count)
+{
+	struct kgsl_device *device = dev_priv->device;
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
+	struct adreno_ringbuffer *rb = &adreno_dev->ringbuffer;
+	struct adreno_context *drawctxt;
+	unsigned int *link;
+	unsigned int maxibs = 0;
+	unsigned int cmdflags;
+	unsigned int i, j;
+	int sizedwords, slot;
+	int ret = 0, err;
+
+	if (device->state & KGSL_STATE_HUNG)
+		return -EBUSY;
+	if (!(rb->flags & KGSL_FLAGS_STARTED) || count == 0)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++) {
+		if (cmds[i].context == NULL || cmds[i].numibs == 0)
+			return -EINVAL;
+
+		drawctxt = cmds[i].context->devctxt;
+		if (drawctxt->flags & CTXT_FLAGS_GPU_HANG) {
+			KGSL_CTXT_WARN(device, "Context %p caused a gpu hang.."
+				" will not accept commands for context %d\n",
+				drawctxt, drawctxt->id);
+			return -EDEADLK;
+		}
+
+		for (j = 0; j < cmds[i].numibs; j++)
+			if (!_check_ib(dev_priv, &cmds[i].ibdesc[j]))
+				return -EINVAL;
+
+		maxibs = max(maxibs, cmds[i].numibs);
+	}
+
+	link = kzalloc(sizeof(unsigned int) * IB_CHAIN_DWORDS(maxibs),
+		       GFP_KERNEL);
+	if (!link) {
+		KGSL_CORE_ERR("kzalloc(%d) failed\n",
+			sizeof(unsigned int) * IB_CHAIN_DWORDS(maxibs));
+		return -ENOMEM;
+	}
+
+	kgsl_setstate(&device->mmu, cmds[0].context->id,
+		      kgsl_mmu_pt_get_flags(device->mmu.hwpagetable,
+					device->id));
+
+	rb->batch = 1;
+
+	for (i = 0; i < count; i++) {
+		drawctxt = cmds[i].context->devctxt;
+		cmdflags = (i == count - 1) ? KGSL_CMD_FLAGS_TS_INT :
+			KGSL_CMD_FLAGS_NO_TS_INT;
+
+		slot = adreno_profile_claim(adreno_dev);
+		sizedwords = _build_ib_chain(dev_priv, drawctxt,
+				cmds[i].ibdesc, cmds[i].numibs, link, false,
+				slot);
+
+		err = _submit_ib_chain(dev_priv, drawctxt, link, sizedwords,
+				       &cmds[i].timestamp, cmds[i].flags,
+				       cmdflags, slot);
+		if (err && !ret)
+			ret = err;
+	}
+
+	rb->batch = 0;
+	adreno_ringbuffer_submit(rb);
+
+	kfree(link);
+	return ret;
+}
+
 static int _find_start_of_cmd_seq(struct adreno_ringbuffer *rb,
 					unsigned int *ptr,
 					bool inc)
@@ -30,9 +30,15 @@ struct kgsl_device_private;
 struct adreno_recovery_data;
 
 #define GSL_RB_MEMPTRS_SCRATCH_COUNT	 8
+
+/* Profiled submissions that can be in flight at once */
+#define ADRENO_PROFILE_SLOTS		64
+
 struct kgsl_rbmemptrs {
 	int  rptr;
 	int  wptr_poll;
+	/* busy cycle counter before and after each profiled submission */
+	unsigned int profile[ADRENO_PROFILE_SLOTS][2];
 };
 
 #define GSL_RB_MEMPTRS_RPTR_OFFSET \
@@ -41,6 +47,10 @@ struct kgsl_rbmemptrs {
 #define GSL_RB_MEMPTRS_WPTRPOLL_OFFSET \
 	(offsetof(struct kgsl_rbmemptrs, wptr_poll))
 
+#define GSL_RB_MEMPTRS_PROFILE_OFFSET(slot, end) \
+	(offsetof(struct kgsl_rbmemptrs, profile) + \
+	 ((slot) * 2 + (end)) * sizeof(unsigned int))
+
 struct adreno_ringbuffer {
 	struct kgsl_device *device;
 	uint32_t flags;
@@ -57,6 +67,9 @@ struct adreno_ringbuffer {
 	unsigned int rptr; /* read pointer offset in dwords from baseaddr */
 
 	unsigned int timestamp[KGSL_MEMSTORE_MAX];
+
+	/* Set while a batch is written, defers the WPTR update */
+	unsigned int batch;
 };
 
 
@@ -95,6 +108,10 @@ int adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 				uint32_t *timestamp,
 				unsigned int flags);
 
+int adreno_ringbuffer_issueibcmds_batch(struct kgsl_device_private *dev_priv,
+				struct kgsl_ibcmds *cmds,
+				unsigned int count);
+
 int adreno_ringbuffer_init(struct kgsl_device *device);
 
 int adreno_ringbuffer_start(struct adreno_ringbuffer *rb,
@@ -129,6 +146,8 @@ int adreno_ringbuffer_read_pfp_ucode(struct kgsl_device *device);
 
 int adreno_ringbuffer_read_pm4_ucode(struct kgsl_device *device);
 
+void adreno_profile_retire(struct kgsl_device *device);
+
 static inline int adreno_ringbuffer_count(struct adreno_ringbuffer *rb,
 	unsigned int rptr)
 {
@@ -1126,36 +1126,25 @@ static long kgsl_ioctl_device_waittimestamp_ctxtid(struct kgsl_device_private
 	return result;
 }
 
-static long kgsl_ioctl_rb_issueibcmds(struct kgsl_device_private *dev_priv,
-				      unsigned int cmd, void *data)
+static int _kgsl_get_ibdesc(struct kgsl_device_private *dev_priv,
+			    struct kgsl_ringbuffer_issueibcmds *param,
+			    struct kgsl_ibdesc **ibdesc_out)
 {
 	int result = 0;
 	int i = 0;
-	struct kgsl_ringbuffer_issueibcmds *param = data;
 	struct kgsl_ibdesc *ibdesc;
-	struct kgsl_context *context;
-
-	context = kgsl_find_context(dev_priv, param->drawctxt_id);
-	if (context == NULL) {
-		result = -EINVAL;
-		goto done;
-	}
 
 	if (param->flags & KGSL_CONTEXT_SUBMIT_IB_LIST) {
-		if (!param->numibs) {
-			result = -EINVAL;
-			goto done;
-		}
+		if (!param->numibs)
+			return -EINVAL;
 
 		/*
 		 * Put a reasonable upper limit on the number of IBs that can be
 		 * submitted
 		 */
 
-		if (param->numibs > 10000) {
-			result = -EINVAL;
-			goto done;
-		}
+		if (param->numibs > 10000)
+			return -EINVAL;
 
 		ibdesc = kzalloc(sizeof(struct kgsl_ibdesc) * param->numibs,
 					GFP_KERNEL);
@@ -1163,8 +1152,7 @@ static long kgsl_ioctl_rb_issueibcmds(struct kgsl_device_private *dev_priv,
 			KGSL_MEM_ERR(dev_priv->device,
 				"kzalloc(%d) failed\n",
 				sizeof(struct kgsl_ibdesc) * param->numibs);
-			result = -ENOMEM;
-			goto done;
+			return -ENOMEM;
 		}
 
 		if (copy_from_user(ibdesc, (void *)param->ibdesc_addr,
@@ -1184,8 +1172,7 @@ static long kgsl_ioctl_rb_issueibcmds(struct kgsl_device_private *dev_priv,
 			KGSL_MEM_ERR(dev_priv->device,
 				"kzalloc(%d) failed\n",
 				sizeof(struct kgsl_ibdesc));
-			result = -ENOMEM;
-			goto done;
+			return -ENOMEM;
 		}
 		ibdesc[0].gpuaddr = param->ibdesc_addr;
 		ibdesc[0].sizedwords = param->numibs;
@@ -1202,6 +1189,30 @@ static long kgsl_ioctl_rb_issueibcmds(struct kgsl_device_private *dev_priv,
 		}
 	}
 
+	*ibdesc_out = ibdesc;
+	return 0;
+
+free_ibdesc:
+	kfree(ibdesc);
+	return result;
+}
+
+static long kgsl_ioctl_rb_issueibcmds(struct kgsl_device_private *dev_priv,
+				      unsigned int cmd, void *data)
+{
+	int result = 0;
+	struct kgsl_ringbuffer_issueibcmds *param = data;
+	struct kgsl_ibdesc *ibdesc;
+	struct kgsl_context *context;
+
+	context = kgsl_find_context(dev_priv, param->drawctxt_id);
+	if (context == NULL)
+		return -EINVAL;
+
+	result = _kgsl_get_ibdesc(dev_priv, param, &ibdesc);
+	if (result)
+		return result;
+
 	result = dev_priv->device->ftbl->issueibcmds(dev_priv,
 					     context,
 					     ibdesc,
@@ -1211,10 +1222,82 @@ static long kgsl_ioctl_rb_issueibcmds(struct kgsl_device_private *dev_priv,
 
 	trace_kgsl_issueibcmds(dev_priv->device, param, ibdesc, result);
 
-free_ibdesc:
 	kfree(ibdesc);
-done:
+	return result;
+}
+
+static long
+kgsl_ioctl_rb_issueibcmds_batch(struct kgsl_device_private *dev_priv,
+				unsigned int cmd, void *data)
+{
+	struct kgsl_ringbuffer_issueibcmds_batch *param = data;
+	struct kgsl_device *device = dev_priv->device;
+	struct kgsl_ringbuffer_issueibcmds *params;
+	struct kgsl_ibcmds *cmds;
+	unsigned int i;
+	int result = 0;
+
+	if (param->count == 0 || param->count > KGSL_IBCMDS_BATCH_MAX)
+		return -EINVAL;
+
+	params = kcalloc(param->count, sizeof(*params), GFP_KERNEL);
+	cmds = kcalloc(param->count, sizeof(*cmds), GFP_KERNEL);
+	if (params == NULL || cmds == NULL) {
+		result = -ENOMEM;
+		goto done;
+	}
+
+	if (copy_from_user(params, (void __user *) param->cmds,
+			param->count * sizeof(*params))) {
+		result = -EFAULT;
+		goto done;
+	}
+
+	for (i = 0; i < param->count; i++) {
+		cmds[i].context = kgsl_find_context(dev_priv,
+					params[i].drawctxt_id);
+		if (cmds[i].context == NULL) {
+			result = -EINVAL;
+			goto done;
+		}
 
+		result = _kgsl_get_ibdesc(dev_priv, &params[i],
+					  &cmds[i].ibdesc);
+		if (result)
+			goto done;
+
+		cmds[i].numibs = params[i].numibs;
+		cmds[i].timestamp = params[i].timestamp;
+		cmds[i].flags = params[i].flags;
+	}
+
+	if (device->ftbl->issueibcmds_batch) {
+		result = device->ftbl->issueibcmds_batch(dev_priv, cmds,
+							 param->count);
+	} else {
+		for (i = 0; i < param->count && !result; i++)
+			result = device->ftbl->issueibcmds(dev_priv,
+					cmds[i].context, cmds[i].ibdesc,
+					cmds[i].numibs, &cmds[i].timestamp,
+					cmds[i].flags);
+	}
+
+	for (i = 0; i < param->count; i++) {
+		params[i].timestamp = cmds[i].timestamp;
+		trace_kgsl_issueibcmds(device, &params[i], cmds[i].ibdesc,
+				       result);
+	}
+
+	if (copy_to_user((void __user *) param->cmds, params,
+			param->count * sizeof(*params)))
+		result = -EFAULT;
+
+done:
+	if (cmds)
+		for (i = 0; i < param->count; i++)
+			kfree(cmds[i].ibdesc);
+	kfree(cmds);
+	kfree(params);
 	return result;
 }
 
@@ -2386,6 +2469,9 @@ static const struct {
 			kgsl_ioctl_gpumem_get_info, 0),
 	KGSL_IOCTL_FUNC(IOCTL_KGSL_GPUMEM_SYNC_CACHE,
 			kgsl_ioctl_gpumem_sync_cache, 0),
+	KGSL_IOCTL_FUNC(IOCTL_KGSL_RINGBUFFER_ISSUEIBCMDS_BATCH,
+			kgsl_ioctl_rb_issueibcmds_batch,
+			KGSL_IOCTL_LOCK | KGSL_IOCTL_WAKE),
 };
 
 static long kgsl_ioctl(struct file *filep, unsigned int cmd, unsigned long arg)
@@ -3166,6 +3252,7 @@ static void kgsl_core_exit(void)
 	}
 
 	kgsl_memfree_hist_exit();
+	kgsl_page_pool_exit();
 	unregister_chrdev_region(kgsl_driver.major, KGSL_DEVICE_MAX);
 }
 
@@ -3223,6 +3310,7 @@ static int __init kgsl_core_init(void)
 	kgsl_core_debugfs_init();
 
 	kgsl_sharedmem_init_sysfs();
+	kgsl_page_pool_init();
 	kgsl_cffdump_init();
 
 	INIT_LIST_HEAD(&kgsl_driver.process_list);
@@ -129,6 +129,9 @@ struct kgsl_driver {
 		unsigned int mapped;
 		unsigned int mapped_max;
 		unsigned int histogram[16];
+		unsigned int pool;
+		unsigned int pool_hits;
+		unsigned int pool_misses;
 	} stats;
 };
 
@@ -215,6 +218,9 @@ int kgsl_add_event(struct kgsl_device *device, u32 id, u32 ts,
 void kgsl_cancel_events(struct kgsl_device *device,
 	void *owner);
 
+void kgsl_cancel_event(struct kgsl_device *device, u32 id, u32 ts,
+	void (*cb)(struct kgsl_device *, void *, u32, u32), void *priv);
+
 void kgsl_cancel_events_ctxt(struct kgsl_device *device,
 	struct kgsl_context *context);
 
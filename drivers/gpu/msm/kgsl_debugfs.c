@@ -314,10 +314,56 @@ kgsl_process_init_debugfs(struct kgsl_process_private *private)
 			    &process_mem_fops);
 }
 
+/*
+ * One line per process with the running per-type counters, so monitoring
+ * tools can sample the GPU memory usage of the whole system with a single
+ * read instead of walking every process directory.
+ */
+static int proc_mem_print(struct seq_file *s, void *unused)
+{
+	struct kgsl_process_private *private;
+	unsigned int total;
+	int i;
+
+	seq_printf(s, "%8s", "pid");
+	for (i = 0; i < KGSL_MEM_ENTRY_MAX; i++)
+		seq_printf(s, " %10s", memtype_str(i));
+	seq_printf(s, " %10s\n", "total");
+
+	mutex_lock(&kgsl_driver.process_mutex);
+	list_for_each_entry(private, &kgsl_driver.process_list, list) {
+		total = 0;
+
+		seq_printf(s, "%8d", private->pid);
+		for (i = 0; i < KGSL_MEM_ENTRY_MAX; i++) {
+			seq_printf(s, " %10u", private->stats[i].cur);
+			total += private->stats[i].cur;
+		}
+		seq_printf(s, " %10u\n", total);
+	}
+	mutex_unlock(&kgsl_driver.process_mutex);
+
+	return 0;
+}
+
+static int proc_mem_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, proc_mem_print, inode->i_private);
+}
+
+static const struct file_operations proc_mem_fops = {
+	.open = proc_mem_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 void kgsl_core_debugfs_init(void)
 {
 	kgsl_debugfs_dir = debugfs_create_dir("kgsl", 0);
 	proc_d_debugfs = debugfs_create_dir("proc", kgsl_debugfs_dir);
+	debugfs_create_file("proc_mem", 0444, kgsl_debugfs_dir, NULL,
+			    &proc_mem_fops);
 }
 
 void kgsl_core_debugfs_close(void)
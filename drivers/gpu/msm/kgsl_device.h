@@ -60,6 +60,15 @@ struct kgsl_context;
 struct kgsl_power_stats;
 struct kgsl_event;
 
+/* One entry of a batched IB submission */
+struct kgsl_ibcmds {
+	struct kgsl_context *context;
+	struct kgsl_ibdesc *ibdesc;
+	unsigned int numibs;
+	uint32_t timestamp;
+	unsigned int flags;
+};
+
 struct kgsl_functable {
 	/* Mandatory functions - these functions must be implemented
 	   by the client device.  The driver will not check for a NULL
@@ -115,6 +124,8 @@ struct kgsl_functable {
 	int (*postmortem_dump) (struct kgsl_device *device, int manual);
 	int (*next_event)(struct kgsl_device *device,
 		struct kgsl_event *event);
+	int (*issueibcmds_batch) (struct kgsl_device_private *dev_priv,
+		struct kgsl_ibcmds *cmds, unsigned int count);
 };
 
 /* MH register values */
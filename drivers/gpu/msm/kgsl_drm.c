@@ -74,6 +74,15 @@
    (_t == DRM_KGSL_GEM_TYPE_KMEM) || \
    (TYPE_IS_MEM(_t) && (_t & DRM_KGSL_GEM_CACHE_WCOMBINE)))
 
+/* Returns true if the CPU maps the KMEM region cached */
+
+#define IS_MEM_CACHED(_t) (TYPE_IS_MEM(_t) && !IS_MEM_UNCACHED(_t))
+
+/* Who may have the contents of a cached object, see kgsl_gem_to_dev() */
+
+#define KGSL_GEM_OWNER_CPU 0
+#define KGSL_GEM_OWNER_DEV 1
+
 struct drm_kgsl_gem_object_wait_list_entry {
 	struct list_head list;
 	int pid;
@@ -121,6 +130,7 @@ struct drm_kgsl_gem_object {
 
 	int bound;
 	int lockpid;
+	int cache_owner;
 	/* Put these here to avoid allocing all the time */
 	struct drm_kgsl_gem_object_wait_list_entry
 	wait_entries[DRM_KGSL_HANDLE_WAIT_ENTRIES];
@@ -150,6 +160,38 @@ kgsl_gem_memory_allocated(struct drm_gem_object *obj)
 	return priv->memdesc.size ? 1 : 0;
 }
 
+/*
+ * A cached object changes hands between the CPU and the devices (GPU,
+ * MDP, rotator) only here. The CPU's lines are cleaned when it hands the
+ * object over and invalidated when it takes it back, and not at all while
+ * the object goes from one device to the next, so a camera to GPU to
+ * display pipeline does no cache maintenance of its own.
+ * Must hold dev->struct_mutex.
+ */
+static void
+kgsl_gem_to_dev(struct drm_kgsl_gem_object *priv)
+{
+	if (!IS_MEM_CACHED(priv->type) ||
+	    priv->cache_owner == KGSL_GEM_OWNER_DEV)
+		return;
+
+	if (kgsl_gem_memory_allocated(priv->obj))
+		kgsl_cache_range_op(&priv->memdesc, KGSL_CACHE_OP_CLEAN);
+	priv->cache_owner = KGSL_GEM_OWNER_DEV;
+}
+
+static void
+kgsl_gem_to_cpu(struct drm_kgsl_gem_object *priv)
+{
+	if (!IS_MEM_CACHED(priv->type) ||
+	    priv->cache_owner == KGSL_GEM_OWNER_CPU)
+		return;
+
+	if (kgsl_gem_memory_allocated(priv->obj))
+		kgsl_cache_range_op(&priv->memdesc, KGSL_CACHE_OP_INV);
+	priv->cache_owner = KGSL_GEM_OWNER_CPU;
+}
+
 static int
 kgsl_gem_alloc_memory(struct drm_gem_object *obj)
 {
@@ -388,6 +430,7 @@ kgsl_gem_obj_addr(int drm_fd, int handle, unsigned long *start,
 	/* We can only use the MDP for PMEM regions */
 
 	if (TYPE_IS_PMEM(priv->type)) {
+		kgsl_gem_to_dev(priv);
 		*start = priv->memdesc.physaddr +
 			priv->bufs[priv->active].offset;
 
@@ -421,6 +464,7 @@ kgsl_gem_init_obj(struct drm_device *dev,
 	priv->bufcount = 1;
 	priv->active = 0;
 	priv->bound = 0;
+	priv->cache_owner = KGSL_GEM_OWNER_CPU;
 
 	priv->type = DRM_KGSL_GEM_TYPE_KMEM;
 
@@ -663,6 +707,8 @@ kgsl_gem_get_ion_fd_ioctl(struct drm_device *dev, void *data,
 		ret = -EINVAL;
 	else if (TYPE_IS_PMEM(priv->type) || TYPE_IS_MEM(priv->type)) {
 		if (priv->ion_handle) {
+			/* whoever imports the fd accesses it as a device */
+			kgsl_gem_to_dev(priv);
 			args->ion_fd = ion_share_dma_buf(
 				kgsl_drm_ion_client, priv->ion_handle);
 			if (args->ion_fd < 0) {
@@ -754,6 +800,21 @@ int
 kgsl_gem_bind_gpu_ioctl(struct drm_device *dev, void *data,
 			struct drm_file *file_priv)
 {
+	struct drm_kgsl_gem_bind_gpu *args = data;
+	struct drm_gem_object *obj;
+
+	obj = drm_gem_object_lookup(dev, file_priv, args->handle);
+
+	if (obj == NULL) {
+		DRM_ERROR("Invalid GEM handle %x\n", args->handle);
+		return -EBADF;
+	}
+
+	mutex_lock(&dev->struct_mutex);
+	kgsl_gem_to_dev(obj->driver_private);
+	drm_gem_object_unreference(obj);
+	mutex_unlock(&dev->struct_mutex);
+
 	return 0;
 }
 
@@ -1275,6 +1336,7 @@ kgsl_gem_lock_handle_ioctl(struct drm_device *dev, void *data,
 
 		/* Getting here means no one currently holds the lock */
 		priv->lockpid = args->pid;
+		kgsl_gem_to_cpu(priv);
 
 		args->lock_id = gem_buf_fence[fence_index].fence_id;
 	}
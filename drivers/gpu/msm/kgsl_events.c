@@ -210,6 +210,51 @@ void kgsl_cancel_events(struct kgsl_device *device,
 }
 EXPORT_SYMBOL(kgsl_cancel_events);
 
+/**
+ * kgsl_cancel_event - Remove a single pending event without firing it
+ * @device - KGSL device the event was registered on
+ * @id - the context ID that the event was added to
+ * @ts - the timestamp of the event
+ * @cb - callback of the event
+ * @priv - private data of the event
+ *
+ * Used by waiters that give up (timeout or signal) before the timestamp
+ * retires, so the callback never sees stale private data.
+ */
+void kgsl_cancel_event(struct kgsl_device *device, u32 id, u32 ts,
+	void (*cb)(struct kgsl_device *, void *, u32, u32), void *priv)
+{
+	struct kgsl_event *event, *event_tmp;
+	struct kgsl_context *context = NULL;
+	struct list_head *head = &device->events;
+
+	if (id != KGSL_MEMSTORE_GLOBAL) {
+		context = idr_find(&device->context_idr, id);
+		if (context == NULL)
+			return;
+		head = &context->events;
+	}
+
+	list_for_each_entry_safe(event, event_tmp, head, list) {
+		if (event->timestamp != ts || event->func != cb ||
+			event->priv != priv)
+			continue;
+
+		list_del(&event->list);
+
+		if (context && list_empty(&context->events))
+			list_del_init(&context->events_list);
+
+		if (event->context)
+			kgsl_context_put(event->context);
+		kfree(event);
+
+		kgsl_active_count_put(device);
+		break;
+	}
+}
+EXPORT_SYMBOL(kgsl_cancel_event);
+
 static void _process_event_list(struct kgsl_device *device,
 		struct list_head *head, unsigned int timestamp)
 {
@@ -0,0 +1,369 @@
+/* Copyright (c) 2010-2013, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Predictive power policy.  Whenever commands are queued a timestamp
+ * event is armed on the last queued global timestamp.  When it retires
+ * the GPU busy time of that window is normalised to the fastest clock and
+ * pushed into a short history.  The busy time of the next frame is
+ * predicted from that history and the slowest power level that still
+ * fits the frame budget is selected from the busy hook, i.e. before the
+ * new commands are kicked off rather than after the idle sampling has
+ * noticed the load.
+ *
+ * Input events (touch, keys) open a boost window: any submission inside
+ * of it runs at the fastest allowed level, so the first frames of an
+ * animation are not rendered at the idle clock.
+ */
+
+#include <linux/export.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/input.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+
+#include "kgsl.h"
+#include "kgsl_pwrscale.h"
+#include "kgsl_device.h"
+
+#define PREDICT_HISTORY		8
+
+/* Windows shorter than this are folded into the next one */
+#define PREDICT_FLOOR		2000
+
+struct predict_priv {
+	/* Busy time per frame in usecs at the fastest power level */
+	unsigned int history[PREDICT_HISTORY];
+	unsigned int head;
+	unsigned int frames;
+	struct kgsl_power_stats bin;
+	int event_pending;
+	unsigned int target_us;
+	unsigned int threshold;
+	unsigned int boost_ms;
+	unsigned long boost_until;
+	struct input_handler input;
+	int input_registered;
+};
+
+static void predict_input_event(struct input_handle *handle,
+		unsigned int type, unsigned int code, int value)
+{
+	struct predict_priv *priv = handle->handler->private;
+
+	if (type != EV_ABS && type != EV_KEY)
+		return;
+
+	priv->boost_until = jiffies + msecs_to_jiffies(priv->boost_ms);
+}
+
+static int predict_input_connect(struct input_handler *handler,
+		struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "kgsl_predict";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err2;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err1;
+
+	return 0;
+err1:
+	input_unregister_handle(handle);
+err2:
+	kfree(handle);
+	return error;
+}
+
+static void predict_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id predict_input_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static inline int predict_boosting(struct predict_priv *priv)
+{
+	return priv->boost_ms && time_before(jiffies, priv->boost_until);
+}
+
+/*
+ * Weighted average of the history with the newest frame weighted most,
+ * but never less than the newest frame so that a sudden load increase
+ * is followed immediately.
+ */
+static unsigned int predict_next(struct predict_priv *priv)
+{
+	unsigned int i, n, idx, last, weight = 0;
+	u64 sum = 0;
+
+	n = min_t(unsigned int, priv->frames, PREDICT_HISTORY);
+	if (n == 0)
+		return 0;
+
+	last = priv->history[(priv->head + PREDICT_HISTORY - 1) %
+		PREDICT_HISTORY];
+
+	for (i = 0; i < n; i++) {
+		idx = (priv->head + PREDICT_HISTORY - 1 - i) % PREDICT_HISTORY;
+		sum += (u64) priv->history[idx] * (n - i);
+		weight += n - i;
+	}
+
+	return max_t(unsigned int, last, div_u64(sum, weight));
+}
+
+static void predict_update(struct kgsl_device *device,
+		struct predict_priv *priv)
+{
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	unsigned int fmax = pwr->pwrlevels[0].gpu_freq;
+	unsigned int busy, budget;
+	int level;
+
+	if (predict_boosting(priv)) {
+		kgsl_pwrctrl_pwrlevel_change(device, pwr->max_pwrlevel);
+		return;
+	}
+
+	if (priv->frames == 0)
+		return;
+
+	busy = predict_next(priv);
+	budget = priv->target_us * priv->threshold / 100;
+
+	/* Pick the slowest level that still renders the frame in budget */
+	for (level = pwr->min_pwrlevel; level > pwr->max_pwrlevel; level--) {
+		unsigned int freq = pwr->pwrlevels[level].gpu_freq;
+
+		if (freq && div_u64((u64) busy * fmax, freq) <= budget)
+			break;
+	}
+
+	kgsl_pwrctrl_pwrlevel_change(device, level);
+}
+
+static void predict_frame_retired(struct kgsl_device *device, void *data,
+		u32 id, u32 timestamp)
+{
+	struct predict_priv *priv = data;
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	struct kgsl_power_stats stats;
+	unsigned int fmax = pwr->pwrlevels[0].gpu_freq;
+	unsigned int fcur = pwr->pwrlevels[pwr->active_pwrlevel].gpu_freq;
+
+	priv->event_pending = 0;
+
+	if (device->state != KGSL_STATE_ACTIVE || !fmax)
+		return;
+
+	device->ftbl->power_stats(device, &stats);
+	priv->bin.total_time += stats.total_time;
+	priv->bin.busy_time += div_u64((u64) stats.busy_time * fcur, fmax);
+
+	if (stats.total_time == 0 || priv->bin.total_time < PREDICT_FLOOR)
+		return;
+
+	priv->history[priv->head] = priv->bin.busy_time;
+	priv->head = (priv->head + 1) % PREDICT_HISTORY;
+	priv->frames++;
+
+	priv->bin.total_time = 0;
+	priv->bin.busy_time = 0;
+}
+
+static void predict_busy(struct kgsl_device *device,
+		struct kgsl_pwrscale *pwrscale)
+{
+	struct predict_priv *priv = pwrscale->priv;
+	unsigned int ts;
+
+	device->on_time = ktime_to_us(ktime_get());
+
+	/*
+	 * Only one window is tracked at a time, commands queued while it is
+	 * outstanding are accounted to the next one.  The callback may run
+	 * synchronously if the timestamp has already retired.
+	 */
+	if (!priv->event_pending) {
+		priv->event_pending = 1;
+		ts = kgsl_readtimestamp(device, NULL, KGSL_TIMESTAMP_QUEUED);
+		if (kgsl_add_event(device, KGSL_MEMSTORE_GLOBAL, ts,
+			predict_frame_retired, priv, priv))
+			priv->event_pending = 0;
+	}
+
+	predict_update(device, priv);
+}
+
+static void predict_idle(struct kgsl_device *device,
+		struct kgsl_pwrscale *pwrscale)
+{
+	/* Drop back down once a boost window has run out */
+	predict_update(device, pwrscale->priv);
+}
+
+static void predict_sleep(struct kgsl_device *device,
+		struct kgsl_pwrscale *pwrscale)
+{
+	struct predict_priv *priv = pwrscale->priv;
+
+	priv->frames = 0;
+	priv->head = 0;
+	priv->bin.total_time = 0;
+	priv->bin.busy_time = 0;
+}
+
+static void predict_wake(struct kgsl_device *device,
+		struct kgsl_pwrscale *pwrscale)
+{
+	struct predict_priv *priv = pwrscale->priv;
+
+	if (device->state == KGSL_STATE_NAP)
+		return;
+
+	kgsl_pwrctrl_pwrlevel_change(device, predict_boosting(priv) ?
+		device->pwrctrl.max_pwrlevel :
+		device->pwrctrl.default_pwrlevel);
+}
+
+#define PREDICT_ATTR(_name, _min, _max)					\
+static ssize_t predict_##_name##_show(struct kgsl_device *device,	\
+				struct kgsl_pwrscale *pwrscale,		\
+				char *buf)				\
+{									\
+	struct predict_priv *priv = pwrscale->priv;			\
+	return snprintf(buf, PAGE_SIZE, "%u\n", priv->_name);		\
+}									\
+static ssize_t predict_##_name##_store(struct kgsl_device *device,	\
+				struct kgsl_pwrscale *pwrscale,		\
+				const char *buf, size_t count)		\
+{									\
+	struct predict_priv *priv = pwrscale->priv;			\
+	unsigned long val;						\
+	int ret;							\
+									\
+	ret = strict_strtoul(buf, 0, &val);				\
+	if (ret)							\
+		return ret;						\
+	if (val < (_min) || val > (_max))				\
+		return -EINVAL;						\
+									\
+	mutex_lock(&device->mutex);					\
+	priv->_name = val;						\
+	mutex_unlock(&device->mutex);					\
+	return count;							\
+}									\
+PWRSCALE_POLICY_ATTR(_name, 0644, predict_##_name##_show,		\
+	predict_##_name##_store)
+
+PREDICT_ATTR(target_us, 1000, 1000000);
+PREDICT_ATTR(threshold, 10, 100);
+PREDICT_ATTR(boost_ms, 0, 5000);
+
+static struct attribute *predict_attrs[] = {
+	&policy_attr_target_us.attr,
+	&policy_attr_threshold.attr,
+	&policy_attr_boost_ms.attr,
+	NULL
+};
+
+static struct attribute_group predict_attr_group = {
+	.attrs = predict_attrs,
+};
+
+static int predict_init(struct kgsl_device *device,
+		struct kgsl_pwrscale *pwrscale)
+{
+	struct predict_priv *priv;
+
+	priv = pwrscale->priv = kzalloc(sizeof(struct predict_priv),
+		GFP_KERNEL);
+	if (pwrscale->priv == NULL)
+		return -ENOMEM;
+
+	/* 60fps, leave some headroom for the CPU side of the frame */
+	priv->target_us = 16667;
+	priv->threshold = 80;
+	priv->boost_ms = 100;
+
+	priv->input.event = predict_input_event;
+	priv->input.connect = predict_input_connect;
+	priv->input.disconnect = predict_input_disconnect;
+	priv->input.name = "kgsl_predict";
+	priv->input.id_table = predict_input_ids;
+	priv->input.private = priv;
+
+	/* Boost hints are optional, the predictor works without them */
+	if (input_register_handler(&priv->input))
+		KGSL_PWR_WARN(device, "predict: no input boost\n");
+	else
+		priv->input_registered = 1;
+
+	kgsl_pwrscale_policy_add_files(device, pwrscale, &predict_attr_group);
+
+	return 0;
+}
+
+static void predict_close(struct kgsl_device *device,
+		struct kgsl_pwrscale *pwrscale)
+{
+	struct predict_priv *priv = pwrscale->priv;
+
+	kgsl_pwrscale_policy_remove_files(device, pwrscale,
+		&predict_attr_group);
+
+	if (priv->input_registered)
+		input_unregister_handler(&priv->input);
+
+	kgsl_cancel_events(device, priv);
+
+	kfree(pwrscale->priv);
+	pwrscale->priv = NULL;
+}
+
+struct kgsl_pwrscale_policy kgsl_pwrscale_policy_predict = {
+	.name = "predict",
+	.init = predict_init,
+	.busy = predict_busy,
+	.idle = predict_idle,
+	.sleep = predict_sleep,
+	.wake = predict_wake,
+	.close = predict_close
+};
+EXPORT_SYMBOL(kgsl_pwrscale_policy_predict);
@@ -18,6 +18,8 @@
 #include <linux/slab.h>
 #include <linux/kmemleak.h>
 #include <linux/highmem.h>
+#include <linux/mm.h>
+#include <linux/workqueue.h>
 
 #include "kgsl.h"
 #include "kgsl_sharedmem.h"
@@ -223,6 +225,12 @@ static int kgsl_drv_memstat_show(struct device *dev,
 		val = kgsl_driver.stats.mapped;
 	else if (!strncmp(attr->attr.name, "mapped_max", 10))
 		val = kgsl_driver.stats.mapped_max;
+	else if (!strncmp(attr->attr.name, "pool_hits", 9))
+		val = kgsl_driver.stats.pool_hits;
+	else if (!strncmp(attr->attr.name, "pool_misses", 11))
+		val = kgsl_driver.stats.pool_misses;
+	else if (!strncmp(attr->attr.name, "pool", 4))
+		val = kgsl_driver.stats.pool;
 
 	return snprintf(buf, PAGE_SIZE, "%u\n", val);
 }
@@ -251,6 +259,9 @@ DEVICE_ATTR(coherent_max, 0444, kgsl_drv_memstat_show, NULL);
 DEVICE_ATTR(mapped, 0444, kgsl_drv_memstat_show, NULL);
 DEVICE_ATTR(mapped_max, 0444, kgsl_drv_memstat_show, NULL);
 DEVICE_ATTR(histogram, 0444, kgsl_drv_histogram_show, NULL);
+DEVICE_ATTR(pool, 0444, kgsl_drv_memstat_show, NULL);
+DEVICE_ATTR(pool_hits, 0444, kgsl_drv_memstat_show, NULL);
+DEVICE_ATTR(pool_misses, 0444, kgsl_drv_memstat_show, NULL);
 
 static const struct device_attribute *drv_attr_list[] = {
 	&dev_attr_vmalloc,
@@ -262,6 +273,9 @@ static const struct device_attribute *drv_attr_list[] = {
 	&dev_attr_mapped,
 	&dev_attr_mapped_max,
 	&dev_attr_histogram,
+	&dev_attr_pool,
+	&dev_attr_pool_hits,
+	&dev_attr_pool_misses,
 	NULL
 };
 
@@ -305,12 +319,175 @@ static void outer_cache_range_op_sg(struct scatterlist *sg, int sglen, int op)
 	}
 }
 
+static void outer_cache_page_op(struct page *page, int op)
+{
+	_outer_cache_range_op(op, page_to_phys(page), PAGE_SIZE);
+}
+
 #else
 static void outer_cache_range_op_sg(struct scatterlist *sg, int sglen, int op)
 {
 }
+
+static void outer_cache_page_op(struct page *page, int op)
+{
+}
 #endif
 
+/*
+ * Pool of zeroed, cache clean single pages.  Freed pages are queued on
+ * the dirty list and scrubbed by a worker, so neither the allocation
+ * nor the free path pays for the memset and the cache maintenance.
+ */
+
+#define KGSL_PAGE_POOL_MAX (SZ_16M >> PAGE_SHIFT)
+
+static struct {
+	spinlock_t lock;
+	struct list_head clean;
+	struct list_head dirty;
+	unsigned int count;
+	struct work_struct work;
+} kgsl_page_pool;
+
+static void kgsl_page_pool_scrub(struct work_struct *work)
+{
+	struct page *page;
+	unsigned long flags;
+	void *ptr;
+
+	spin_lock_irqsave(&kgsl_page_pool.lock, flags);
+	while (!list_empty(&kgsl_page_pool.dirty)) {
+		page = list_first_entry(&kgsl_page_pool.dirty,
+					struct page, lru);
+		list_del(&page->lru);
+		spin_unlock_irqrestore(&kgsl_page_pool.lock, flags);
+
+		ptr = kmap_atomic(page, KM_USER0);
+		memset(ptr, 0, PAGE_SIZE);
+		dmac_flush_range(ptr, ptr + PAGE_SIZE);
+		kunmap_atomic(ptr, KM_USER0);
+		outer_cache_page_op(page, KGSL_CACHE_OP_FLUSH);
+
+		spin_lock_irqsave(&kgsl_page_pool.lock, flags);
+		list_add(&page->lru, &kgsl_page_pool.clean);
+	}
+	spin_unlock_irqrestore(&kgsl_page_pool.lock, flags);
+}
+
+static struct page *kgsl_page_pool_get(void)
+{
+	struct page *page = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&kgsl_page_pool.lock, flags);
+	if (!list_empty(&kgsl_page_pool.clean)) {
+		page = list_first_entry(&kgsl_page_pool.clean,
+					struct page, lru);
+		list_del(&page->lru);
+		kgsl_page_pool.count--;
+		kgsl_driver.stats.pool -= PAGE_SIZE;
+		kgsl_driver.stats.pool_hits++;
+	} else {
+		kgsl_driver.stats.pool_misses++;
+	}
+	spin_unlock_irqrestore(&kgsl_page_pool.lock, flags);
+
+	return page;
+}
+
+/* Returns 1 if the page was taken by the pool */
+static int kgsl_page_pool_put(struct page *page)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	if (page_count(page) != 1)
+		return 0;
+
+	spin_lock_irqsave(&kgsl_page_pool.lock, flags);
+	if (kgsl_page_pool.count < KGSL_PAGE_POOL_MAX) {
+		list_add_tail(&page->lru, &kgsl_page_pool.dirty);
+		kgsl_page_pool.count++;
+		kgsl_driver.stats.pool += PAGE_SIZE;
+		ret = 1;
+	}
+	spin_unlock_irqrestore(&kgsl_page_pool.lock, flags);
+
+	return ret;
+}
+
+static unsigned long kgsl_page_pool_take(struct list_head *from,
+					 struct list_head *to,
+					 unsigned long nr)
+{
+	struct page *page, *tmp;
+
+	list_for_each_entry_safe(page, tmp, from, lru) {
+		if (!nr)
+			break;
+		list_move(&page->lru, to);
+		kgsl_page_pool.count--;
+		kgsl_driver.stats.pool -= PAGE_SIZE;
+		nr--;
+	}
+
+	return nr;
+}
+
+static int kgsl_page_pool_shrink(struct shrinker *shrinker,
+				 struct shrink_control *sc)
+{
+	struct page *page, *tmp;
+	unsigned long nr = sc->nr_to_scan;
+	unsigned long flags;
+	LIST_HEAD(list);
+	int count;
+
+	spin_lock_irqsave(&kgsl_page_pool.lock, flags);
+	/* Give back pages that still need scrubbing first */
+	nr = kgsl_page_pool_take(&kgsl_page_pool.dirty, &list, nr);
+	kgsl_page_pool_take(&kgsl_page_pool.clean, &list, nr);
+	count = kgsl_page_pool.count;
+	spin_unlock_irqrestore(&kgsl_page_pool.lock, flags);
+
+	list_for_each_entry_safe(page, tmp, &list, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+
+	return count;
+}
+
+static struct shrinker kgsl_page_pool_shrinker = {
+	.shrink = kgsl_page_pool_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+void kgsl_page_pool_init(void)
+{
+	spin_lock_init(&kgsl_page_pool.lock);
+	INIT_LIST_HEAD(&kgsl_page_pool.clean);
+	INIT_LIST_HEAD(&kgsl_page_pool.dirty);
+	INIT_WORK(&kgsl_page_pool.work, kgsl_page_pool_scrub);
+	register_shrinker(&kgsl_page_pool_shrinker);
+}
+
+void kgsl_page_pool_exit(void)
+{
+	struct shrink_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.nr_to_scan = KGSL_PAGE_POOL_MAX,
+	};
+
+	if (!kgsl_page_pool.work.func)
+		return;
+
+	unregister_shrinker(&kgsl_page_pool_shrinker);
+	cancel_work_sync(&kgsl_page_pool.work);
+	kgsl_page_pool_shrink(&kgsl_page_pool_shrinker, &sc);
+}
+
 static int kgsl_page_alloc_vmfault(struct kgsl_memdesc *memdesc,
 				struct vm_area_struct *vma,
 				struct vm_fault *vmf)
@@ -374,9 +551,21 @@ static void kgsl_page_alloc_free(struct kgsl_memdesc *memdesc)
 		vunmap(memdesc->hostptr);
 		kgsl_driver.stats.vmalloc -= memdesc->size;
 	}
-	if (memdesc->sg)
-		for_each_sg(memdesc->sg, sg, sglen, i)
-			__free_pages(sg_page(sg), get_order(sg->length));
+	if (memdesc->sg) {
+		int pooled = 0;
+
+		for_each_sg(memdesc->sg, sg, sglen, i) {
+			if (sg->length == PAGE_SIZE &&
+			    kgsl_page_pool_put(sg_page(sg)))
+				pooled = 1;
+			else
+				__free_pages(sg_page(sg),
+					     get_order(sg->length));
+		}
+
+		if (pooled)
+			schedule_work(&kgsl_page_pool.work);
+	}
 }
 
 static int kgsl_contiguous_vmflags(struct kgsl_memdesc *memdesc)
@@ -507,11 +696,51 @@ static struct kgsl_memdesc_ops kgsl_coherent_ops = {
 	.free = kgsl_coherent_free,
 };
 
+static void _inner_cache_range_op(int op, void *addr, size_t size)
+{
+	switch (op) {
+	case KGSL_CACHE_OP_FLUSH:
+		dmac_flush_range(addr, addr + size);
+		break;
+	case KGSL_CACHE_OP_CLEAN:
+		dmac_clean_range(addr, addr + size);
+		break;
+	case KGSL_CACHE_OP_INV:
+		dmac_inv_range(addr, addr + size);
+		break;
+	}
+}
+
+/*
+ * For buffers with no known mapping, one page at a time through kmap.
+ * Carveout memory outside the kernel's memory map has no cacheable
+ * kernel alias and is skipped.
+ */
+static void inner_cache_range_op_sg(struct scatterlist *sg, int sglen, int op)
+{
+	struct scatterlist *s;
+	unsigned long pfn;
+	unsigned int off;
+	void *ptr;
+	int i;
+
+	for_each_sg(sg, s, sglen, i) {
+		for (off = 0; off < s->length; off += PAGE_SIZE) {
+			pfn = page_to_pfn(sg_page(s)) + (off >> PAGE_SHIFT);
+			if (!pfn_valid(pfn))
+				break;
+			ptr = kmap_atomic(pfn_to_page(pfn), KM_USER0);
+			_inner_cache_range_op(op, ptr, PAGE_SIZE);
+			kunmap_atomic(ptr, KM_USER0);
+		}
+	}
+}
+
 void kgsl_cache_range_op(struct kgsl_memdesc *memdesc, int op)
 {
 	/*
 	 * If the buffer is mapped in the kernel operate on that address
-	 * otherwise use the user address
+	 * otherwise use the user address, and failing that the pages
 	 */
 
 	void *addr = (memdesc->hostptr) ?
@@ -519,19 +748,10 @@ void kgsl_cache_range_op(struct kgsl_memdesc *memdesc, int op)
 
 	int size = memdesc->size;
 
-	if (addr !=  NULL) {
-		switch (op) {
-		case KGSL_CACHE_OP_FLUSH:
-			dmac_flush_range(addr, addr + size);
-			break;
-		case KGSL_CACHE_OP_CLEAN:
-			dmac_clean_range(addr, addr + size);
-			break;
-		case KGSL_CACHE_OP_INV:
-			dmac_inv_range(addr, addr + size);
-			break;
-		}
-	}
+	if (addr !=  NULL)
+		_inner_cache_range_op(op, addr, size);
+	else
+		inner_cache_range_op_sg(memdesc->sg, memdesc->sglen, op);
 	outer_cache_range_op_sg(memdesc->sg, memdesc->sglen, op);
 }
 EXPORT_SYMBOL(kgsl_cache_range_op);
@@ -551,7 +771,13 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 
 	align = (memdesc->flags & KGSL_MEMALIGN_MASK) >> KGSL_MEMALIGN_SHIFT;
 
-	page_size = (align >= ilog2(SZ_64K) && size >= SZ_64K)
+	/*
+	 * Use 64K chunks for large buffers if userspace asked for the
+	 * alignment, or if the IOMMU can cover them with large page entries
+	 * (kgsl_mmu_map aligns the GPU address to match below).
+	 */
+	page_size = (size >= SZ_64K && (align >= ilog2(SZ_64K) ||
+		kgsl_mmu_get_mmutype() == KGSL_MMU_TYPE_IOMMU))
 			? SZ_64K : PAGE_SIZE;
 	/* update align flags for what we actually use */
 	if (page_size != PAGE_SIZE)
@@ -621,6 +847,17 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 		if (page_size != PAGE_SIZE)
 			gfp_mask |= __GFP_COMP;
 
+		/* Pool pages are already zeroed and clean */
+		if (page_size == PAGE_SIZE) {
+			page = kgsl_page_pool_get();
+			if (page != NULL) {
+				sg_set_page(&memdesc->sg[sglen++], page,
+					PAGE_SIZE, 0);
+				len -= PAGE_SIZE;
+				continue;
+			}
+		}
+
 		page = alloc_pages(gfp_mask, get_order(page_size));
 
 		if (page == NULL) {
@@ -708,8 +945,9 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 		}
 	}
 
-	outer_cache_range_op_sg(memdesc->sg, memdesc->sglen,
-				KGSL_CACHE_OP_FLUSH);
+	if (pcount)
+		outer_cache_range_op_sg(memdesc->sg, memdesc->sglen,
+					KGSL_CACHE_OP_FLUSH);
 
 	KGSL_STATS_ADD(size, kgsl_driver.stats.page_alloc,
 		kgsl_driver.stats.page_alloc_max);
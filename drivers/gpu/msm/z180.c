@@ -13,6 +13,7 @@
 #include <linux/module.h>
 #include <linux/uaccess.h>
 #include <linux/sched.h>
+#include <linux/debugfs.h>
 
 #include "kgsl.h"
 #include "kgsl_cffdump.h"
@@ -211,12 +212,42 @@ static irqreturn_t z180_irq_handler(struct kgsl_device *device)
 			count >>= 8;
 			count &= 255;
 			z180_dev->timestamp += count;
-
-			queue_work(device->work_queue, &device->ts_expired_ws);
-			wake_up_interruptible(&device->wait_queue);
+			z180_dev->irqs++;
+
+			/*
+			 * Blits are retired in batches: only bother the event
+			 * worker and the waiters when somebody is actually
+			 * interested in a timestamp.  kgsl_add_event() queues
+			 * the worker itself, so an event added concurrently is
+			 * not lost.
+			 */
+			if (!list_empty(&device->events) ||
+				!list_empty(&device->events_pending_list))
+				queue_work(device->work_queue,
+					&device->ts_expired_ws);
+
+			/* Order the timestamp update against the waiters */
+			smp_mb();
+			if (waitqueue_active(&device->wait_queue)) {
+				z180_dev->irq_wakeups++;
+				wake_up_interruptible(&device->wait_queue);
+			}
 		}
 	}
 
+	/*
+	 * Only look at napping once the queued blits have drained, there is
+	 * no point in running the idle check for every blit of a batch.
+	 */
+	if (timestamp_cmp(z180_dev->current_timestamp,
+		z180_dev->timestamp) > 0) {
+		mod_timer_pending(&device->idle_timer,
+			jiffies + device->pwrctrl.interval_timeout);
+		return result;
+	}
+
+	z180_dev->batches++;
+
 	if ((device->pwrctrl.nap_allowed == true) &&
 		(device->requested_state == KGSL_STATE_NONE)) {
 		kgsl_pwrctrl_request_state(device, KGSL_STATE_NAP);
@@ -465,6 +496,7 @@ z180_cmdstream_issueibcmds(struct kgsl_device_private *dev_priv,
 	*timestamp = z180_dev->current_timestamp;
 
 	z180_dev->ringbuffer.prevctx = context->id;
+	z180_dev->submits++;
 
 	addcmd(&z180_dev->ringbuffer, old_timestamp, cmd + ofs, cnt);
 	kgsl_pwrscale_busy(device);
@@ -509,6 +541,23 @@ static void z180_ringbuffer_close(struct kgsl_device *device)
 	memset(&z180_dev->ringbuffer, 0, sizeof(struct z180_ringbuffer));
 }
 
+static void z180_debugfs_init(struct kgsl_device *device)
+{
+	struct z180_device *z180_dev = Z180_DEVICE(device);
+
+	if (!device->d_debugfs || IS_ERR(device->d_debugfs))
+		return;
+
+	debugfs_create_u32("submits", 0444, device->d_debugfs,
+			   &z180_dev->submits);
+	debugfs_create_u32("irqs", 0444, device->d_debugfs,
+			   &z180_dev->irqs);
+	debugfs_create_u32("irq_wakeups", 0444, device->d_debugfs,
+			   &z180_dev->irq_wakeups);
+	debugfs_create_u32("batches", 0444, device->d_debugfs,
+			   &z180_dev->batches);
+}
+
 static int __devinit z180_probe(struct platform_device *pdev)
 {
 	int status = -EINVAL;
@@ -531,6 +580,8 @@ static int __devinit z180_probe(struct platform_device *pdev)
 	kgsl_pwrscale_init(device);
 	kgsl_pwrscale_attach_policy(device, Z180_DEFAULT_PWRSCALE_POLICY);
 
+	z180_debugfs_init(device);
+
 	return status;
 
 error_close_ringbuffer:
@@ -42,6 +42,11 @@ struct z180_device {
 	int timestamp;
 	struct z180_ringbuffer ringbuffer;
 	spinlock_t cmdwin_lock;
+	/* submission and interrupt coalescing statistics (debugfs) */
+	unsigned int submits;
+	unsigned int irqs;
+	unsigned int irq_wakeups;
+	unsigned int batches;
 };
 
 int z180_dump(struct kgsl_device *, int);
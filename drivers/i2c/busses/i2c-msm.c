@@ -29,6 +29,20 @@
 
 #define DEBUG 0
 
+/*
+ * The controller has a single byte data register and no data mover
+ * channel, so every byte costs an interrupt. For transfers longer than
+ * burst_threshold the handler keeps servicing bytes that become ready
+ * within a couple of byte times, for at most MSM_I2C_BURST_US per
+ * interrupt, instead of returning after each one.
+ */
+#define MSM_I2C_BURST_US 250
+
+static int burst_threshold = 32;
+module_param(burst_threshold, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(burst_threshold,
+		 "Service several bytes per interrupt above this length (0 = off)");
+
 enum {
 	I2C_WRITE_DATA          = 0x00,
 	I2C_CLK_CTL             = 0x04,
@@ -85,6 +99,8 @@ struct msm_i2c_dev {
 	int                 reg;
 	int                 last_reg;
 	int                 last_flag;
+	bool                burst;
+	int                 byte_us;
 };
 
 #if DEBUG
@@ -196,7 +212,7 @@ static void msm_i2c_read_buffer(struct msm_i2c_dev *dev)
 	}
 }
 
-static void msm_i2c_interrupt_locked(struct msm_i2c_dev *dev)
+static bool msm_i2c_interrupt_locked(struct msm_i2c_dev *dev)
 {
 	uint32_t status	= readl(dev->base + I2C_STATUS);
 	bool not_done = true;
@@ -207,7 +223,7 @@ static void msm_i2c_interrupt_locked(struct msm_i2c_dev *dev)
 	if (!dev->msg) {
 		dev_err(dev->dev,
 			"IRQ but nothing to do!, status %x\n", status);
-		return;
+		return true;
 	}
 	if (status & I2C_STATUS_ERROR_MASK)
 		goto out_err;
@@ -226,7 +242,7 @@ static void msm_i2c_interrupt_locked(struct msm_i2c_dev *dev)
 		} else if (!not_done && !dev->need_flush)
 			goto out_complete;
 	}
-	return;
+	return false;
 
 out_err:
 	dev_err(dev->dev, "error, status %x	\
@@ -236,6 +252,37 @@ out_err:
 	dev->ret = -EIO;
 out_complete:
 	complete(dev->complete);
+	return true;
+}
+
+/* Would the controller interrupt us with the current status? */
+static bool msm_i2c_ready(struct msm_i2c_dev *dev, uint32_t status)
+{
+	if (status & (I2C_STATUS_ERROR_MASK | I2C_STATUS_RD_BUFFER_FULL))
+		return true;
+	if (status & I2C_STATUS_WR_BUFFER_FULL)
+		return false;
+	return dev->pos < 0 || !(dev->msg->flags & I2C_M_RD);
+}
+
+static void msm_i2c_burst_locked(struct msm_i2c_dev *dev)
+{
+	int budget = MSM_I2C_BURST_US;
+	int wait = 0;
+
+	while (budget > 0 && wait < 2 * dev->byte_us) {
+		uint32_t status = readl(dev->base + I2C_STATUS);
+
+		if (!msm_i2c_ready(dev, status)) {
+			udelay(1);
+			budget--;
+			wait++;
+			continue;
+		}
+		if (msm_i2c_interrupt_locked(dev))
+			return;
+		wait = 0;
+	}
 }
 
 static irqreturn_t
@@ -244,7 +291,8 @@ msm_i2c_interrupt(int irq, void *devid)
 	struct msm_i2c_dev *dev = devid;
 
 	spin_lock(&dev->lock);
-	msm_i2c_interrupt_locked(dev);
+	if (!msm_i2c_interrupt_locked(dev) && dev->burst)
+		msm_i2c_burst_locked(dev);
 	spin_unlock(&dev->lock);
 
 	return IRQ_HANDLED;
@@ -345,6 +393,7 @@ msm_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	long timeout;
 	unsigned long flags;
 	uint8_t slave_reg = -1;
+	int i, len = 0;
 	/*
 	 * If there is an i2c_xfer after driver has been suspended,
 	 * grab wakelock to abort suspend.
@@ -357,6 +406,9 @@ msm_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	if (msgs->buf != NULL)
 		slave_reg = msgs->buf[0];
 
+	for (i = 0; i < num; i++)
+		len += msgs[i].len;
+
 	ret = msm_i2c_poll_notbusy(dev, 1);
 	if (ret) {
 		dev_err(dev->dev, "Still busy in starting xfer	\
@@ -384,6 +436,7 @@ msm_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	dev->flush_cnt = 0;
 	dev->cnt = msgs->len;
 	dev->reg = slave_reg;
+	dev->burst = burst_threshold > 0 && len > burst_threshold;
 	dev->complete = &complete;
 
 	msm_i2c_interrupt_locked(dev);
@@ -414,6 +467,7 @@ msm_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	dev->ret = 0;
 	dev->flush_cnt = 0;
 	dev->cnt = 0;
+	dev->burst = false;
 	spin_unlock_irqrestore(&dev->lock, flags);
 
 	if (!timeout) {
@@ -537,6 +591,7 @@ msm_i2c_probe(struct platform_device *pdev)
 	hs_div = 3;
 	clk_ctl = ((hs_div & 0x7) << 8) | (fs_div & 0xff);
 	writel(clk_ctl, dev->base + I2C_CLK_CTL);
+	dev->byte_us = DIV_ROUND_UP(9 * USEC_PER_SEC, i2c_clock);
 	printk(KERN_INFO "msm_i2c_probe: clk_ctl %x, %d Hz\n",
 	       clk_ctl, i2c_clk / (2 * ((clk_ctl & 0xff) + 3)));
 	clk_disable(clk);
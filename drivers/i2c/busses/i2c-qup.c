@@ -78,6 +78,17 @@ MODULE_LICENSE("Dual BSD/GPL");
 MODULE_VERSION("0.2");
 MODULE_ALIAS("platform:i2c_qup");
 
+/*
+ * There is no data mover channel for the QUP in this tree, so each FIFO
+ * block costs an interrupt and a wakeup. Transfers longer than
+ * poll_threshold keep the interrupts masked and poll the service flags
+ * instead.
+ */
+static int poll_threshold = 128;
+module_param(poll_threshold, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(poll_threshold,
+		 "Poll instead of taking interrupts above this length (0 = off)");
+
 /* QUP Registers */
 enum {
 	QUP_CONFIG              = 0x0,
@@ -183,6 +194,7 @@ struct qup_i2c_dev {
 	struct msm_i2c_platform_data *pdata;
 	int                          suspended;
 	int                          clk_state;
+	int                          poll;
 	struct timer_list            pwr_timer;
 	struct mutex                 mlock;
 	void                         *complete;
@@ -261,6 +273,29 @@ intr_done:
 	return IRQ_HANDLED;
 }
 
+static long
+qup_i2c_poll_complete(struct qup_i2c_dev *dev, struct completion *complete,
+			unsigned long timeout)
+{
+	unsigned long end = jiffies + timeout;
+
+	do {
+		uint32_t status = readl(dev->base + QUP_I2C_STATUS);
+		uint32_t status1 = readl(dev->base + QUP_ERROR_FLAGS);
+		uint32_t op_flgs = readl(dev->base + QUP_OPERATIONAL);
+
+		if ((status & I2C_STATUS_ERROR_MASK) || (status1 & 0x7F) ||
+			(op_flgs & (QUP_OUT_SVC_FLAG | QUP_IN_SVC_FLAG |
+				QUP_MX_INPUT_DONE)))
+			qup_i2c_interrupt(dev->err_irq, dev);
+		if (try_wait_for_completion(complete))
+			return max_t(long, end - jiffies, 1);
+		udelay(dev->one_bit_t);
+	} while (time_before(jiffies, end));
+
+	return 0;
+}
+
 static void
 qup_i2c_pwr_mgmt(struct qup_i2c_dev *dev, unsigned int state)
 {
@@ -553,6 +588,7 @@ qup_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	int rem = num;
 	long timeout;
 	int err;
+	int i, len = 0;
 
 	del_timer_sync(&dev->pwr_timer);
 	mutex_lock(&dev->mlock);
@@ -600,11 +636,17 @@ qup_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 				dev->out_blk_sz, dev->out_fifo_sz);
 	}
 
-	if (dev->num_irqs == 3) {
-		enable_irq(dev->in_irq);
-		enable_irq(dev->out_irq);
+	for (i = 0; i < num; i++)
+		len += msgs[i].len;
+	dev->poll = poll_threshold > 0 && len > poll_threshold;
+
+	if (!dev->poll) {
+		if (dev->num_irqs == 3) {
+			enable_irq(dev->in_irq);
+			enable_irq(dev->out_irq);
+		}
+		enable_irq(dev->err_irq);
 	}
-	enable_irq(dev->err_irq);
 	writel(QUP_RESET_STATE, dev->base + QUP_STATE);
 	ret = qup_i2c_poll_state(dev, QUP_RESET_STATE);
 	if (ret) {
@@ -720,7 +762,11 @@ qup_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 				idx, rem, num, dev->mode);
 
 			qup_print_status(dev);
-			timeout = wait_for_completion_timeout(&complete,
+			if (dev->poll)
+				timeout = qup_i2c_poll_complete(dev, &complete,
+					msecs_to_jiffies(dev->out_fifo_sz));
+			else
+				timeout = wait_for_completion_timeout(&complete,
 					msecs_to_jiffies(dev->out_fifo_sz));
 			if (!timeout) {
 				dev_err(dev->dev, "Transaction timed out\n");
@@ -785,11 +831,14 @@ qup_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	dev->pos = 0;
 	dev->err = 0;
 	dev->cnt = 0;
-	disable_irq(dev->err_irq);
-	if (dev->num_irqs == 3) {
-		disable_irq(dev->in_irq);
-		disable_irq(dev->out_irq);
+	if (!dev->poll) {
+		disable_irq(dev->err_irq);
+		if (dev->num_irqs == 3) {
+			disable_irq(dev->in_irq);
+			disable_irq(dev->out_irq);
+		}
 	}
+	dev->poll = 0;
 	dev->pwr_timer.expires = jiffies + 3*HZ;
 	add_timer(&dev->pwr_timer);
 	mutex_unlock(&dev->mlock);
@@ -1189,6 +1189,7 @@ static struct i2c_driver a1026_driver = {
 	.id_table = a1026_id,
 	.driver = {
 		.name = "audience_a1026",
+		.async_probe = true,
 	},
 };
 
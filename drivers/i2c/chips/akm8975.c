@@ -1134,6 +1134,7 @@ static struct i2c_driver akm8975_driver = {
 #endif
 	.driver = {
 		   .name = AKM8975_I2C_NAME,
+		   .async_probe = true,
 		   },
 };
 
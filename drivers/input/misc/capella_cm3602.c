@@ -318,7 +318,8 @@ static struct platform_driver capella_cm3602_driver = {
 	.probe = capella_cm3602_probe,
 	.driver = {
 		.name = CAPELLA_CM3602,
-		.owner = THIS_MODULE
+		.owner = THIS_MODULE,
+		.async_probe = true,
 	},
 };
 
@@ -122,7 +122,8 @@ static int get_ls_adc_level(uint8_t *data)
 
 	data[0] = 0x00;
 	data[1] = li->ls_config->channel;
-	if (microp_read_adc(data))
+	/* ambient light can wait for the LEDs and the headset */
+	if (microp_read_adc_background(data))
 		return -1;
 
 	adc_value = data[0]<<8 | data[1];
@@ -21,6 +21,7 @@
 #include <linux/i2c.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
+#include <linux/pm_qos.h>
 #include <asm/io.h>
 #include <asm/gpio.h>
 #include <mach/board.h>
@@ -39,6 +40,10 @@
 
 #define ATMEL_EN_SYSFS
 #define ATMEL_I2C_RETRY_TIMES 10
+/* messages read per interrupt while CHG stays asserted */
+#define ATMEL_MSG_DRAIN_MAX 10
+/* how long the latency bound outlives the last touch interrupt, in us */
+#define ATMEL_PM_QOS_TIMEOUT_US 100000
 
 /* config_setting */
 #define NONE                                    0
@@ -53,8 +58,13 @@ struct atmel_ts_data {
 	struct i2c_client *client;
 	struct input_dev *input_dev;
 	struct workqueue_struct *atmel_wq;
-	struct work_struct work;
 	struct work_struct check_delta_work;
+	int gpio_irq;
+	ktime_t irq_time;
+	unsigned int latency_last;
+	unsigned int latency_max;
+	s32 cpu_dma_latency;
+	struct pm_qos_request pm_qos_req;
 	int (*power) (int on);
 	struct early_suspend early_suspend;
 	struct info_id_t *id;
@@ -454,6 +464,29 @@ static ssize_t atmel_debug_level_dump(struct device *dev,
 static DEVICE_ATTR(debug_level, (S_IWUSR|S_IRUGO),
 	atmel_debug_level_show, atmel_debug_level_dump);
 
+static ssize_t atmel_latency_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct atmel_ts_data *ts_data;
+	ts_data = private_ts;
+
+	return sprintf(buf, "last %u max %u us\n",
+		ts_data->latency_last, ts_data->latency_max);
+}
+
+static ssize_t atmel_latency_reset(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct atmel_ts_data *ts_data;
+	ts_data = private_ts;
+	ts_data->latency_max = 0;
+
+	return count;
+}
+
+static DEVICE_ATTR(latency, (S_IWUSR|S_IRUGO),
+	atmel_latency_show, atmel_latency_reset);
+
 static ssize_t atmel_diag_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -646,6 +679,11 @@ static int atmel_touch_sysfs_init(void)
 		printk(KERN_ERR "TOUCH_ERR: create_file unlock failed\n");
 		return ret;
 	}
+	ret = sysfs_create_file(android_touch_kobj, &dev_attr_latency.attr);
+	if (ret) {
+		printk(KERN_ERR "TOUCH_ERR: create_file latency failed\n");
+		return ret;
+	}
 	return 0;
 }
 
@@ -654,6 +692,7 @@ static void atmel_touch_sysfs_deinit(void)
 #ifdef CONFIG_TOUCHSCREEN_ATMEL_SWEEP2WAKE
 	sysfs_remove_file(android_touch_kobj, &dev_attr_sweep2wake.attr);
 #endif
+	sysfs_remove_file(android_touch_kobj, &dev_attr_latency.attr);
 	sysfs_remove_file(android_touch_kobj, &dev_attr_unlock.attr);
 	sysfs_remove_file(android_touch_kobj, &dev_attr_diag.attr);
 	sysfs_remove_file(android_touch_kobj, &dev_attr_debug_level.attr);
@@ -1205,10 +1244,9 @@ static void multi_input_report(struct atmel_ts_data *ts)
 	}
 }
 
-static void atmel_ts_work_func(struct work_struct *work)
+static void atmel_ts_handle_msg(struct atmel_ts_data *ts)
 {
 	int ret;
-	struct atmel_ts_data *ts = container_of(work, struct atmel_ts_data, work);
 	uint8_t data[7];
 	int8_t report_type;
 	uint8_t loop_i, loop_j, msg_byte_num = 7;
@@ -1308,7 +1346,6 @@ static void atmel_ts_work_func(struct work_struct *work)
 			printk(KERN_INFO"RAW data: %x, %x, %x, %x, %x, %x, %x\n",
 				data[0], data[1], data[2], data[3], data[4], data[5], data[6]);
 	}
-	enable_irq(ts->client->irq);
 }
 
 static void atmel_ts_check_delta_work_func(struct work_struct *work)
@@ -1341,8 +1378,33 @@ static irqreturn_t atmel_ts_irq_handler(int irq, void *dev_id)
 {
 	struct atmel_ts_data *ts = dev_id;
 
-	disable_irq_nosync(ts->client->irq);
-	queue_work(ts->atmel_wq, &ts->work);
+	ts->irq_time = ktime_get();
+	return IRQ_WAKE_THREAD;
+}
+
+static irqreturn_t atmel_ts_irq_thread(int irq, void *dev_id)
+{
+	struct atmel_ts_data *ts = dev_id;
+	int loop_i = 0;
+
+	/* the chip reports every few ms while touched, keep the gaps short */
+	if (ts->cpu_dma_latency)
+		pm_qos_update_request_timeout(&ts->pm_qos_req,
+					      ts->cpu_dma_latency,
+					      ATMEL_PM_QOS_TIMEOUT_US);
+
+	/* CHG stays low while messages are pending, read them all here
+	 * instead of taking the interrupt again for each one
+	 */
+	do {
+		atmel_ts_handle_msg(ts);
+	} while (ts->gpio_irq && ++loop_i < ATMEL_MSG_DRAIN_MAX &&
+		 !gpio_get_value(ts->gpio_irq));
+
+	ts->latency_last = ktime_to_us(ktime_sub(ktime_get(), ts->irq_time));
+	if (ts->latency_last > ts->latency_max)
+		ts->latency_max = ts->latency_last;
+
 	return IRQ_HANDLED;
 }
 
@@ -1523,14 +1585,13 @@ static int atmel_ts_probe(struct i2c_client *client,
 		goto err_alloc_data_failed;
 	}
 
-	ts->atmel_wq = create_singlethread_workqueue("atmel_wq");
+	ts->atmel_wq = create_singlethread_hipri_workqueue("atmel_wq");
 	if (!ts->atmel_wq) {
 		printk(KERN_ERR "TOUCH_ERR: create workqueue failed\n");
 		ret = -ENOMEM;
 		goto err_cread_wq_failed;
 	}
 
-	INIT_WORK(&ts->work, atmel_ts_work_func);
 	INIT_WORK(&ts->check_delta_work, atmel_ts_check_delta_work_func);
 	ts->client = client;
 	i2c_set_clientdata(client, ts);
@@ -1539,6 +1600,7 @@ static int atmel_ts_probe(struct i2c_client *client,
 	if (pdata) {
 		ts->power = pdata->power;
 		intr = pdata->gpio_irq;
+		ts->gpio_irq = intr;
 	}
 	if (ts->power)
 		ret = ts->power(1);
@@ -1698,6 +1760,7 @@ static int atmel_ts_probe(struct i2c_client *client,
 		ts->abs_pressure_max = pdata->abs_pressure_max;
 		ts->abs_width_min = pdata->abs_width_min;
 		ts->abs_width_max = pdata->abs_width_max;
+		ts->cpu_dma_latency = pdata->cpu_dma_latency;
 		ts->GCAF_level = pdata->GCAF_level;
 		if (ts->id->version >= 0x20)
 			ts->ATCH_EXT = &pdata->config_T8[T8_CFG_ATCHCALST];
@@ -1962,7 +2025,12 @@ static int atmel_ts_probe(struct i2c_client *client,
 		goto err_input_register_device_failed;
 	}
 
-	ret = request_irq(client->irq, atmel_ts_irq_handler, IRQF_TRIGGER_LOW,
+	if (ts->cpu_dma_latency)
+		pm_qos_add_request(&ts->pm_qos_req, PM_QOS_CPU_DMA_LATENCY,
+				   PM_QOS_DEFAULT_VALUE);
+
+	ret = request_threaded_irq(client->irq, atmel_ts_irq_handler,
+			atmel_ts_irq_thread, IRQF_TRIGGER_LOW | IRQF_ONESHOT,
 			client->name, ts);
 	if (ret)
 		dev_err(&client->dev, "TOUCH_ERR: request_irq failed\n");
@@ -2016,6 +2084,8 @@ static int atmel_ts_remove(struct i2c_client *client)
 
 	unregister_early_suspend(&ts->early_suspend);
 	free_irq(client->irq, ts);
+	if (ts->cpu_dma_latency)
+		pm_qos_remove_request(&ts->pm_qos_req);
 
 	destroy_workqueue(ts->atmel_wq);
 	input_unregister_device(ts->input_dev);
@@ -2026,7 +2096,6 @@ static int atmel_ts_remove(struct i2c_client *client)
 
 static int atmel_ts_suspend(struct i2c_client *client, pm_message_t mesg)
 {
-	int ret;
 	struct atmel_ts_data *ts = i2c_get_clientdata(client);
 
 	printk(KERN_INFO "%s: enter\n", __func__);
@@ -2049,9 +2118,6 @@ static int atmel_ts_suspend(struct i2c_client *client, pm_message_t mesg)
 #endif
 
 	cancel_work_sync(&ts->check_delta_work);
-	ret = cancel_work_sync(&ts->work);
-	if (ret)
-		enable_irq(client->irq);
 
 	ts->finger_pressed = 0;
 	ts->finger_count = 0;
@@ -2197,6 +2263,7 @@ static struct i2c_driver atmel_ts_driver = {
 #endif
 	.driver = {
 			.name = ATMEL_QT602240_NAME,
+			.async_probe = true,
 	},
 };
 
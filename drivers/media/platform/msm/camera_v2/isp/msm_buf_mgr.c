@@ -20,6 +20,9 @@
 #include <linux/proc_fs.h>
 #include <linux/videodev2.h>
 #include <linux/vmalloc.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 
 
 #include <media/v4l2-dev.h>
@@ -116,12 +119,89 @@ static int msm_isp_free_buf_handle(struct msm_isp_buf_mgr *buf_mgr,
 	return 0;
 }
 
+/*
+ * Take over a mapping of the same ion buffer left by a released buffer
+ * queue. The cache already holds a handle and an iommu reference, so the
+ * handle reference just taken by the import is dropped.
+ */
+static int msm_isp_map_cache_get(struct msm_isp_buf_mgr *buf_mgr,
+	struct msm_isp_buffer_mapped_info *mapped_info)
+{
+	struct msm_isp_cached_map *map;
+	int i;
+
+	mutex_lock(&buf_mgr->map_cache_lock);
+	for (i = 0; i < MSM_ISP_MAP_CACHE_SIZE; i++) {
+		map = &buf_mgr->map_cache[i];
+		if (map->handle != mapped_info->handle)
+			continue;
+		mapped_info->paddr = map->paddr;
+		mapped_info->len = map->len;
+		map->handle = NULL;
+		buf_mgr->stats.num_cache_hits++;
+		mutex_unlock(&buf_mgr->map_cache_lock);
+		ion_free(buf_mgr->client, mapped_info->handle);
+		return 0;
+	}
+	mutex_unlock(&buf_mgr->map_cache_lock);
+	return -ENOENT;
+}
+
+/* Keep the mapping of an unprepared plane, evicting the oldest one */
+static void msm_isp_map_cache_put(struct msm_isp_buf_mgr *buf_mgr,
+	struct msm_isp_buffer_mapped_info *mapped_info)
+{
+	struct msm_isp_cached_map *map, *victim = &buf_mgr->map_cache[0];
+	int i;
+
+	mutex_lock(&buf_mgr->map_cache_lock);
+	for (i = 0; i < MSM_ISP_MAP_CACHE_SIZE; i++) {
+		map = &buf_mgr->map_cache[i];
+		if (!map->handle) {
+			victim = map;
+			break;
+		}
+		if (map->last_used < victim->last_used)
+			victim = map;
+	}
+	if (victim->handle) {
+		ion_unmap_iommu(buf_mgr->client, victim->handle,
+			buf_mgr->iommu_domain_num, 0);
+		ion_free(buf_mgr->client, victim->handle);
+	}
+	victim->handle = mapped_info->handle;
+	victim->paddr = mapped_info->paddr - mapped_info->offset;
+	victim->len = mapped_info->len;
+	victim->last_used = ++buf_mgr->map_cache_clock;
+	mutex_unlock(&buf_mgr->map_cache_lock);
+}
+
+static void msm_isp_map_cache_flush(struct msm_isp_buf_mgr *buf_mgr)
+{
+	struct msm_isp_cached_map *map;
+	int i;
+
+	mutex_lock(&buf_mgr->map_cache_lock);
+	for (i = 0; i < MSM_ISP_MAP_CACHE_SIZE; i++) {
+		map = &buf_mgr->map_cache[i];
+		if (!map->handle)
+			continue;
+		ion_unmap_iommu(buf_mgr->client, map->handle,
+			buf_mgr->iommu_domain_num, 0);
+		ion_free(buf_mgr->client, map->handle);
+		map->handle = NULL;
+	}
+	mutex_unlock(&buf_mgr->map_cache_lock);
+}
+
 static int msm_isp_prepare_v4l2_buf(struct msm_isp_buf_mgr *buf_mgr,
 	struct msm_isp_buffer *buf_info,
 	struct v4l2_buffer *v4l2_buf)
 {
 	int i, rc = -1;
 	struct msm_isp_buffer_mapped_info *mapped_info;
+	ktime_t start = ktime_get();
+
 	for (i = 0; i < v4l2_buf->length; i++) {
 		mapped_info = &buf_info->mapped_info[i];
 		mapped_info->handle =
@@ -132,7 +212,8 @@ static int msm_isp_prepare_v4l2_buf(struct msm_isp_buf_mgr *buf_mgr,
 				__func__, mapped_info->handle);
 			goto ion_map_error;
 		}
-		if (ion_map_iommu(buf_mgr->client, mapped_info->handle,
+		if (msm_isp_map_cache_get(buf_mgr, mapped_info) &&
+			ion_map_iommu(buf_mgr->client, mapped_info->handle,
 				buf_mgr->iommu_domain_num, 0, SZ_4K,
 				0, &(mapped_info->paddr),
 				&(mapped_info->len), 0, 0) < 0) {
@@ -141,11 +222,18 @@ static int msm_isp_prepare_v4l2_buf(struct msm_isp_buf_mgr *buf_mgr,
 			ion_free(buf_mgr->client, mapped_info->handle);
 			goto ion_map_error;
 		}
-		mapped_info->paddr += v4l2_buf->m.planes[i].data_offset;
+		mapped_info->offset = v4l2_buf->m.planes[i].data_offset;
+		mapped_info->paddr += mapped_info->offset;
 		CDBG("%s: plane: %d addr:%lu\n",
 			__func__, i, mapped_info->paddr);
 	}
 	buf_info->num_planes = v4l2_buf->length;
+
+	mutex_lock(&buf_mgr->map_cache_lock);
+	buf_mgr->stats.num_maps += buf_info->num_planes;
+	buf_mgr->stats.map_time_us +=
+		ktime_to_us(ktime_sub(ktime_get(), start));
+	mutex_unlock(&buf_mgr->map_cache_lock);
 	return 0;
 ion_map_error:
 	for (--i; i >= 0; i--) {
@@ -165,9 +253,7 @@ static void msm_isp_unprepare_v4l2_buf(
 	struct msm_isp_buffer_mapped_info *mapped_info;
 	for (i = 0; i < buf_info->num_planes; i++) {
 		mapped_info = &buf_info->mapped_info[i];
-		ion_unmap_iommu(buf_mgr->client, mapped_info->handle,
-			buf_mgr->iommu_domain_num, 0);
-		ion_free(buf_mgr->client, mapped_info->handle);
+		msm_isp_map_cache_put(buf_mgr, mapped_info);
 	}
 	return;
 }
@@ -359,6 +445,7 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 		}
 	} else {
 		(*buf_info)->state = MSM_ISP_BUFFER_STATE_DEQUEUED;
+		(*buf_info)->zsl_filled = 0;
 		if (bufq->buf_type == ISP_SHARE_BUF) {
 			memset((*buf_info)->buf_used, 0,
 				   sizeof(uint8_t) * bufq->buf_client_count);
@@ -449,6 +536,20 @@ static int msm_isp_buf_done(struct msm_isp_buf_mgr *buf_mgr,
 
 	spin_lock_irqsave(&bufq->bufq_lock, flags);
 	state = buf_info->state;
+	if (bufq->buf_type == ISP_ZSL_BUF &&
+		state == MSM_ISP_BUFFER_STATE_DEQUEUED) {
+		/*
+		 * The frame goes back to the tail of the ring, so the
+		 * VFE overwrites the oldest frame first.
+		 */
+		buf_info->zsl_filled = 1;
+		buf_info->zsl_frame_id = frame_id;
+		buf_info->zsl_tv = *tv;
+		buf_info->state = MSM_ISP_BUFFER_STATE_QUEUED;
+		list_add_tail(&buf_info->list, &bufq->head);
+		spin_unlock_irqrestore(&bufq->bufq_lock, flags);
+		return 0;
+	}
 	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
 
 	if (state == MSM_ISP_BUFFER_STATE_DEQUEUED ||
@@ -505,7 +606,17 @@ static int msm_isp_flush_buf(struct msm_isp_buf_mgr *buf_mgr,
 		}
 
 		spin_lock_irqsave(&bufq->bufq_lock, flags);
-		if (flush_type == MSM_ISP_BUFFER_FLUSH_DIVERTED &&
+		if (bufq->buf_type == ISP_ZSL_BUF) {
+			if (flush_type == MSM_ISP_BUFFER_FLUSH_ALL &&
+				(buf_info->state ==
+					MSM_ISP_BUFFER_STATE_DEQUEUED ||
+				buf_info->state ==
+					MSM_ISP_BUFFER_STATE_DISPATCHED)) {
+				buf_info->zsl_filled = 0;
+				buf_info->state = MSM_ISP_BUFFER_STATE_QUEUED;
+				list_add_tail(&buf_info->list, &bufq->head);
+			}
+		} else if (flush_type == MSM_ISP_BUFFER_FLUSH_DIVERTED &&
 			buf_info->state == MSM_ISP_BUFFER_STATE_DIVERTED) {
 			buf_info->state = MSM_ISP_BUFFER_STATE_QUEUED;
 		} else if (flush_type == MSM_ISP_BUFFER_FLUSH_ALL &&
@@ -560,12 +671,85 @@ static int msm_isp_buf_divert(struct msm_isp_buf_mgr *buf_mgr,
 	return 0;
 }
 
+static int msm_isp_zsl_claim_buf(struct msm_isp_buf_mgr *buf_mgr,
+	struct msm_isp_zsl_claim_info *info)
+{
+	int rc = -EAGAIN;
+	unsigned long flags;
+	s64 target, delta, best_delta = 0;
+	struct msm_isp_bufq *bufq = NULL;
+	struct msm_isp_buffer *buf_info = NULL, *best = NULL;
+
+	bufq = msm_isp_get_bufq(buf_mgr, info->handle);
+	if (!bufq || bufq->buf_type != ISP_ZSL_BUF) {
+		pr_err("%s: Invalid bufq\n", __func__);
+		return -EINVAL;
+	}
+
+	target = timeval_to_ns(&info->timestamp);
+	spin_lock_irqsave(&bufq->bufq_lock, flags);
+	list_for_each_entry(buf_info, &bufq->head, list) {
+		if (!buf_info->zsl_filled)
+			continue;
+		delta = timeval_to_ns(&buf_info->zsl_tv) - target;
+		if (delta < 0)
+			delta = -delta;
+		if (!best || delta < best_delta) {
+			best = buf_info;
+			best_delta = delta;
+		}
+	}
+
+	if (best) {
+		list_del_init(&best->list);
+		best->state = MSM_ISP_BUFFER_STATE_DISPATCHED;
+		info->buf_idx = best->buf_idx;
+		info->frame_id = best->zsl_frame_id;
+		info->frame_timestamp = best->zsl_tv;
+		rc = 0;
+	}
+	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
+	return rc;
+}
+
+/* Give a claimed frame back to its zero shutter lag ring */
+static int msm_isp_zsl_release_buf(struct msm_isp_buf_mgr *buf_mgr,
+	struct msm_isp_qbuf_info *info)
+{
+	int rc = -EINVAL;
+	unsigned long flags;
+	struct msm_isp_bufq *bufq = NULL;
+	struct msm_isp_buffer *buf_info = NULL;
+
+	bufq = msm_isp_get_bufq(buf_mgr, info->handle);
+	buf_info = msm_isp_get_buf_ptr(buf_mgr, info->handle, info->buf_idx);
+	if (!bufq || !buf_info)
+		return rc;
+
+	spin_lock_irqsave(&bufq->bufq_lock, flags);
+	if (buf_info->state == MSM_ISP_BUFFER_STATE_DISPATCHED) {
+		/* Reuse it before the frames still worth claiming */
+		buf_info->zsl_filled = 0;
+		buf_info->state = MSM_ISP_BUFFER_STATE_QUEUED;
+		list_add(&buf_info->list, &bufq->head);
+		rc = 0;
+	}
+	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
+	return rc;
+}
+
 static int msm_isp_buf_enqueue(struct msm_isp_buf_mgr *buf_mgr,
 	struct msm_isp_qbuf_info *info)
 {
 	int rc = -1, buf_state;
 	struct msm_isp_bufq *bufq = NULL;
 	struct msm_isp_buffer *buf_info = NULL;
+
+	bufq = msm_isp_get_bufq(buf_mgr, info->handle);
+	if (bufq && bufq->buf_type == ISP_ZSL_BUF &&
+		!msm_isp_zsl_release_buf(buf_mgr, info))
+		return 0;
+
 	buf_state = msm_isp_buf_prepare(buf_mgr, info, NULL);
 	if (buf_state < 0) {
 		pr_err("%s: Buf prepare failed\n", __func__);
@@ -627,6 +811,13 @@ static int msm_isp_request_bufq(struct msm_isp_buf_mgr *buf_mgr,
 		return rc;
 	}
 
+	/*The ring lives in the kernel, so only native buffers qualify*/
+	if (buf_request->buf_type == ISP_ZSL_BUF &&
+		!BUF_SRC(buf_request->stream_id)) {
+		pr_err("Invalid zero shutter lag buffer request\n");
+		return rc;
+	}
+
 	buf_request->handle = msm_isp_get_buf_handle(buf_mgr,
 		buf_request->session_id, buf_request->stream_id);
 	if (!buf_request->handle) {
@@ -767,6 +958,7 @@ static int msm_isp_deinit_isp_buf_mgr(
 	if (--buf_mgr->open_count)
 		return 0;
 	msm_isp_release_all_bufq(buf_mgr);
+	msm_isp_map_cache_flush(buf_mgr);
 	ion_client_destroy(buf_mgr->client);
 	kfree(buf_mgr->bufq);
 	buf_mgr->num_buf_q = 0;
@@ -793,6 +985,10 @@ int msm_isp_proc_buf_cmd(struct msm_isp_buf_mgr *buf_mgr,
 		buf_mgr->ops->release_buf(buf_mgr, buf_req->handle);
 		break;
 	}
+	case VIDIOC_MSM_ISP_ZSL_CLAIM_BUF: {
+		struct msm_isp_zsl_claim_info *claim_info = arg;
+		return buf_mgr->ops->claim_buf(buf_mgr, claim_info);
+	}
 	}
 	return 0;
 }
@@ -807,11 +1003,39 @@ static struct msm_isp_buf_ops isp_buf_ops = {
 	.flush_buf = msm_isp_flush_buf,
 	.buf_done = msm_isp_buf_done,
 	.buf_divert = msm_isp_buf_divert,
+	.claim_buf = msm_isp_zsl_claim_buf,
 	.register_ctx = msm_isp_register_ctx,
 	.buf_mgr_init = msm_isp_init_isp_buf_mgr,
 	.buf_mgr_deinit = msm_isp_deinit_isp_buf_mgr,
 };
 
+static int msm_isp_buf_mgr_stats_show(struct seq_file *m, void *unused)
+{
+	struct msm_isp_buf_mgr *buf_mgr = m->private;
+	struct msm_isp_buf_mgr_stats stats;
+
+	mutex_lock(&buf_mgr->map_cache_lock);
+	stats = buf_mgr->stats;
+	mutex_unlock(&buf_mgr->map_cache_lock);
+
+	seq_printf(m, "planes mapped: %u\n", stats.num_maps);
+	seq_printf(m, "mapping cache hits: %u\n", stats.num_cache_hits);
+	seq_printf(m, "mapping time: %llu us\n", stats.map_time_us);
+	return 0;
+}
+
+static int msm_isp_buf_mgr_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_isp_buf_mgr_stats_show, inode->i_private);
+}
+
+static const struct file_operations msm_isp_buf_mgr_stats_fops = {
+	.open = msm_isp_buf_mgr_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int msm_isp_create_isp_buf_mgr(
 	struct msm_isp_buf_mgr *buf_mgr,
 	struct msm_sd_req_vb2_q *vb2_ops,
@@ -842,6 +1066,9 @@ int msm_isp_create_isp_buf_mgr(
 
 	buf_mgr->ops = &isp_buf_ops;
 	buf_mgr->vb2_ops = vb2_ops;
+	mutex_init(&buf_mgr->map_cache_lock);
+	debugfs_create_file("msm_isp_buf_mgr", S_IRUGO, NULL, buf_mgr,
+		&msm_isp_buf_mgr_stats_fops);
 	buf_mgr->init_done = 1;
 	buf_mgr->open_count = 0;
 	return 0;
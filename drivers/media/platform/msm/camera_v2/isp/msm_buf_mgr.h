@@ -20,6 +20,7 @@
 /*Buffer source can be from userspace / HAL*/
 #define BUF_SRC(id) (id & ISP_NATIVE_BUF_BIT)
 #define ISP_SHARE_BUF_CLIENT 2
+#define MSM_ISP_MAP_CACHE_SIZE 32
 
 struct msm_isp_buf_mgr;
 
@@ -41,9 +42,24 @@ enum msm_isp_buffer_flush_t {
 struct msm_isp_buffer_mapped_info {
 	unsigned long len;
 	unsigned long paddr;
+	unsigned long offset;	/* plane data offset included in paddr */
 	struct ion_handle *handle;
 };
 
+/* An iommu mapping kept after its buffer queue was released */
+struct msm_isp_cached_map {
+	struct ion_handle *handle;
+	unsigned long paddr;
+	unsigned long len;
+	unsigned long last_used;
+};
+
+struct msm_isp_buf_mgr_stats {
+	uint32_t num_maps;
+	uint32_t num_cache_hits;
+	uint64_t map_time_us;
+};
+
 struct msm_isp_buffer {
 	/*Common Data structure*/
 	int num_planes;
@@ -57,6 +73,11 @@ struct msm_isp_buffer {
 	struct list_head list;
 	enum msm_isp_buffer_state state;
 
+	/*Zero shutter lag ring: the frame the buffer holds*/
+	uint8_t zsl_filled;
+	uint32_t zsl_frame_id;
+	struct timeval zsl_tv;
+
 	/*Vb2 buffer data*/
 	struct vb2_buffer *vb2_buf;
 
@@ -112,6 +133,8 @@ struct msm_isp_buf_ops {
 	int (*buf_divert) (struct msm_isp_buf_mgr *buf_mgr,
 		uint32_t bufq_handle, uint32_t buf_index,
 		struct timeval *tv, uint32_t frame_id);
+	int (*claim_buf) (struct msm_isp_buf_mgr *buf_mgr,
+		struct msm_isp_zsl_claim_info *info);
 	void (*register_ctx) (struct msm_isp_buf_mgr *buf_mgr,
 		struct device **iommu_ctx, int num_iommu_ctx);
 	int (*buf_mgr_init) (struct msm_isp_buf_mgr *buf_mgr,
@@ -138,6 +161,12 @@ struct msm_isp_buf_mgr {
 
 	int num_iommu_ctx;
 	struct device *iommu_ctx[2];
+
+	/*Mappings reused across stream off and on*/
+	struct mutex map_cache_lock;
+	struct msm_isp_cached_map map_cache[MSM_ISP_MAP_CACHE_SIZE];
+	unsigned long map_cache_clock;
+	struct msm_isp_buf_mgr_stats stats;
 };
 
 int msm_isp_create_isp_buf_mgr(struct msm_isp_buf_mgr *buf_mgr,
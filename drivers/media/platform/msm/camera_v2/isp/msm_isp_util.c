@@ -337,7 +337,8 @@ long msm_isp_ioctl(struct v4l2_subdev *sd,
 	}
 	case VIDIOC_MSM_ISP_REQUEST_BUF:
 	case VIDIOC_MSM_ISP_ENQUEUE_BUF:
-	case VIDIOC_MSM_ISP_RELEASE_BUF: {
+	case VIDIOC_MSM_ISP_RELEASE_BUF:
+	case VIDIOC_MSM_ISP_ZSL_CLAIM_BUF: {
 		mutex_lock(&vfe_dev->realtime_mutex);
 		rc = msm_isp_proc_buf_cmd(vfe_dev->buf_mgr, cmd, arg);
 		mutex_unlock(&vfe_dev->realtime_mutex);
@@ -427,7 +427,11 @@ int msm_jpeg_fe_pingpong_irq(struct msm_jpeg_device *pgmn_dev,
 		rc = -EFAULT;
 	}
 
-	buf_out = msm_jpeg_q_out(&pgmn_dev->input_buf_q);
+	/* a pending frame programs the fetch engine itself */
+	if (!list_empty_careful(&pgmn_dev->job_q.q))
+		buf_out = NULL;
+	else
+		buf_out = msm_jpeg_q_out(&pgmn_dev->input_buf_q);
 
 	if (buf_out) {
 		rc = msm_jpeg_core_fe_buf_update(pgmn_dev, buf_out);
@@ -543,6 +547,30 @@ int msm_jpeg_input_buf_enqueue(struct msm_jpeg_device *pgmn_dev,
 	return 0;
 }
 
+/*************** job queue ****************/
+
+static void msm_jpeg_job_done(struct msm_jpeg_device *pgmn_dev)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pgmn_dev->job_lock, flags);
+	if (!list_empty_careful(&pgmn_dev->job_q.q))
+		schedule_work(&pgmn_dev->job_work);
+	else
+		pgmn_dev->job_active = 0;
+	spin_unlock_irqrestore(&pgmn_dev->job_lock, flags);
+}
+
+static void msm_jpeg_job_abort(struct msm_jpeg_device *pgmn_dev)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pgmn_dev->job_lock, flags);
+	pgmn_dev->job_active = 0;
+	spin_unlock_irqrestore(&pgmn_dev->job_lock, flags);
+	msm_jpeg_q_cleanup(&pgmn_dev->job_q);
+}
+
 int msm_jpeg_irq(int event, void *context, void *data)
 {
 	struct msm_jpeg_device *pgmn_dev =
@@ -552,6 +580,7 @@ int msm_jpeg_irq(int event, void *context, void *data)
 	case MSM_JPEG_EVT_SESSION_DONE:
 		msm_jpeg_framedone_irq(pgmn_dev, data);
 		msm_jpeg_we_pingpong_irq(pgmn_dev, data);
+		msm_jpeg_job_done(pgmn_dev);
 		break;
 
 	case MSM_JPEG_HW_MASK_COMP_FE:
@@ -568,6 +597,7 @@ int msm_jpeg_irq(int event, void *context, void *data)
 
 	case MSM_JPEG_HW_MASK_COMP_ERR:
 	default:
+		msm_jpeg_job_abort(pgmn_dev);
 		msm_jpeg_err_irq(pgmn_dev, event);
 		break;
 	}
@@ -610,6 +640,8 @@ int __msm_jpeg_open(struct msm_jpeg_device *pgmn_dev)
 		pgmn_dev->domain_num);
 	msm_jpeg_q_cleanup(&pgmn_dev->input_rtn_q);
 	msm_jpeg_q_cleanup(&pgmn_dev->input_buf_q);
+	msm_jpeg_q_cleanup(&pgmn_dev->job_q);
+	pgmn_dev->job_active = 0;
 	msm_jpeg_core_init(pgmn_dev);
 
 	JPEG_DBG("%s:%d] success\n", __func__, __LINE__);
@@ -628,6 +660,8 @@ int __msm_jpeg_release(struct msm_jpeg_device *pgmn_dev)
 	pgmn_dev->open_count--;
 	mutex_unlock(&pgmn_dev->lock);
 
+	cancel_work_sync(&pgmn_dev->job_work);
+	msm_jpeg_job_abort(pgmn_dev);
 	msm_jpeg_core_release(pgmn_dev, pgmn_dev->domain_num);
 	msm_jpeg_q_cleanup(&pgmn_dev->evt_q);
 	msm_jpeg_q_cleanup(&pgmn_dev->output_rtn_q);
@@ -677,24 +711,22 @@ int msm_jpeg_ioctl_hw_cmd(struct msm_jpeg_device *pgmn_dev,
 	return 0;
 }
 
-int msm_jpeg_ioctl_hw_cmds(struct msm_jpeg_device *pgmn_dev,
-	void * __user arg)
+static struct msm_jpeg_hw_cmds *msm_jpeg_get_hw_cmds(void * __user arg,
+	uint32_t *len_p)
 {
-	int is_copy_to_user;
 	uint32_t len;
 	uint32_t m;
 	struct msm_jpeg_hw_cmds *hw_cmds_p;
-	struct msm_jpeg_hw_cmd *hw_cmd_p;
 
 	if (copy_from_user(&m, arg, sizeof(m))) {
 		JPEG_PR_ERR("%s:%d] failed\n", __func__, __LINE__);
-		return -EFAULT;
+		return NULL;
 	}
 
 	if ((m == 0) || (m > ((UINT32_MAX - sizeof(struct msm_jpeg_hw_cmds)) /
 		sizeof(struct msm_jpeg_hw_cmd)))) {
 		JPEG_PR_ERR("%s:%d] m_cmds out of range\n", __func__, __LINE__);
-		return -EFAULT;
+		return NULL;
 	}
 
 	len = sizeof(struct msm_jpeg_hw_cmds) +
@@ -702,19 +734,43 @@ int msm_jpeg_ioctl_hw_cmds(struct msm_jpeg_device *pgmn_dev,
 	hw_cmds_p = kmalloc(len, GFP_KERNEL);
 	if (!hw_cmds_p) {
 		JPEG_PR_ERR("%s:%d] no mem %d\n", __func__, __LINE__, len);
-		return -EFAULT;
+		return NULL;
 	}
 
 	if (copy_from_user(hw_cmds_p, arg, len)) {
 		JPEG_PR_ERR("%s:%d] failed\n", __func__, __LINE__);
 		kfree(hw_cmds_p);
-		return -EFAULT;
+		return NULL;
 	}
+	/* m is what was validated, not what a second read returned */
+	hw_cmds_p->m = m;
 
-	hw_cmd_p = (struct msm_jpeg_hw_cmd *) &(hw_cmds_p->hw_cmd);
+	*len_p = len;
+	return hw_cmds_p;
+}
+
+static int msm_jpeg_exec_hw_cmds(struct msm_jpeg_device *pgmn_dev,
+	struct msm_jpeg_hw_cmds *hw_cmds_p)
+{
+	struct msm_jpeg_hw_cmd *hw_cmd_p;
 
-	is_copy_to_user = msm_jpeg_hw_exec_cmds(hw_cmd_p, m,
+	hw_cmd_p = (struct msm_jpeg_hw_cmd *) &(hw_cmds_p->hw_cmd);
+	return msm_jpeg_hw_exec_cmds(hw_cmd_p, hw_cmds_p->m,
 		 pgmn_dev->res_size, pgmn_dev->base);
+}
+
+int msm_jpeg_ioctl_hw_cmds(struct msm_jpeg_device *pgmn_dev,
+	void * __user arg)
+{
+	int is_copy_to_user;
+	uint32_t len;
+	struct msm_jpeg_hw_cmds *hw_cmds_p;
+
+	hw_cmds_p = msm_jpeg_get_hw_cmds(arg, &len);
+	if (!hw_cmds_p)
+		return -EFAULT;
+
+	is_copy_to_user = msm_jpeg_exec_hw_cmds(pgmn_dev, hw_cmds_p);
 
 	if (is_copy_to_user >= 0) {
 		if (copy_to_user(arg, hw_cmds_p, len)) {
@@ -727,7 +783,9 @@ int msm_jpeg_ioctl_hw_cmds(struct msm_jpeg_device *pgmn_dev,
 	return 0;
 }
 
-int msm_jpeg_start(struct msm_jpeg_device *pgmn_dev, void * __user arg)
+/* Load the frame's buffers and run its configuration, which starts it */
+static int msm_jpeg_run_frame(struct msm_jpeg_device *pgmn_dev,
+	struct msm_jpeg_hw_cmds *hw_cmds_p)
 {
 	struct msm_jpeg_core_buf *buf_out;
 	struct msm_jpeg_core_buf *buf_out_free[2] = {NULL, NULL};
@@ -767,13 +825,69 @@ int msm_jpeg_start(struct msm_jpeg_device *pgmn_dev, void * __user arg)
 
 	JPEG_DBG_HIGH("%s:%d] START\n", __func__, __LINE__);
 	wmb();
-	rc = msm_jpeg_ioctl_hw_cmds(pgmn_dev, arg);
+	rc = msm_jpeg_exec_hw_cmds(pgmn_dev, hw_cmds_p);
 	wmb();
 	pgmn_dev->state = MSM_JPEG_EXECUTING;
 	JPEG_DBG("%s:%d]", __func__, __LINE__);
 	return rc;
 }
 
+static void msm_jpeg_job_work(struct work_struct *work)
+{
+	struct msm_jpeg_device *pgmn_dev =
+		container_of(work, struct msm_jpeg_device, job_work);
+	struct msm_jpeg_hw_cmds *hw_cmds_p;
+
+	hw_cmds_p = msm_jpeg_q_out(&pgmn_dev->job_q);
+	if (!hw_cmds_p) {
+		msm_jpeg_job_done(pgmn_dev);
+		return;
+	}
+
+	if (msm_jpeg_run_frame(pgmn_dev, hw_cmds_p) == -EFAULT)
+		JPEG_PR_ERR("%s:%d] queued frame failed\n", __func__,
+			__LINE__);
+	kfree(hw_cmds_p);
+}
+
+/*
+ * A frame started while the previous one still encodes is queued with
+ * its configuration, its buffers stay on the input and output queues,
+ * and it is started from the frame done interrupt of the previous one.
+ * Register reads in a queued configuration are not returned.
+ */
+int msm_jpeg_start(struct msm_jpeg_device *pgmn_dev, void * __user arg)
+{
+	struct msm_jpeg_hw_cmds *hw_cmds_p;
+	unsigned long flags;
+	uint32_t len;
+	int rc;
+
+	hw_cmds_p = msm_jpeg_get_hw_cmds(arg, &len);
+	if (!hw_cmds_p)
+		return -EFAULT;
+
+	spin_lock_irqsave(&pgmn_dev->job_lock, flags);
+	if (pgmn_dev->job_active) {
+		rc = msm_jpeg_q_in(&pgmn_dev->job_q, hw_cmds_p);
+		spin_unlock_irqrestore(&pgmn_dev->job_lock, flags);
+		if (rc < 0)
+			kfree(hw_cmds_p);
+		return rc;
+	}
+	pgmn_dev->job_active = 1;
+	spin_unlock_irqrestore(&pgmn_dev->job_lock, flags);
+
+	rc = 0;
+	if (msm_jpeg_run_frame(pgmn_dev, hw_cmds_p) >= 0 &&
+		copy_to_user(arg, hw_cmds_p, len)) {
+		JPEG_PR_ERR("%s:%d] failed\n", __func__, __LINE__);
+		rc = -EFAULT;
+	}
+	kfree(hw_cmds_p);
+	return rc;
+}
+
 int msm_jpeg_ioctl_reset(struct msm_jpeg_device *pgmn_dev,
 	void * __user arg)
 {
@@ -822,6 +936,8 @@ long __msm_jpeg_ioctl(struct msm_jpeg_device *pgmn_dev,
 		break;
 
 	case MSM_JPEG_IOCTL_STOP:
+		cancel_work_sync(&pgmn_dev->job_work);
+		msm_jpeg_job_abort(pgmn_dev);
 		rc = msm_jpeg_ioctl_hw_cmds(pgmn_dev, (void __user *) arg);
 		pgmn_dev->state = MSM_JPEG_STOPPED;
 		break;
@@ -922,6 +1038,9 @@ int __msm_jpeg_init(struct msm_jpeg_device *pgmn_dev)
 	msm_jpeg_q_init("output_buf_q", &pgmn_dev->output_buf_q);
 	msm_jpeg_q_init("input_rtn_q", &pgmn_dev->input_rtn_q);
 	msm_jpeg_q_init("input_buf_q", &pgmn_dev->input_buf_q);
+	msm_jpeg_q_init("job_q", &pgmn_dev->job_q);
+	INIT_WORK(&pgmn_dev->job_work, msm_jpeg_job_work);
+	spin_lock_init(&pgmn_dev->job_lock);
 
 #ifdef CONFIG_MSM_IOMMU
 	j = (pgmn_dev->iommu_cnt <= 1) ? idx : 0;
@@ -19,6 +19,7 @@
 #include <linux/list.h>
 #include <linux/cdev.h>
 #include <linux/platform_device.h>
+#include <linux/workqueue.h>
 #include <media/v4l2-device.h>
 #include <media/v4l2-subdev.h>
 #include "msm_jpeg_hw.h"
@@ -82,6 +83,13 @@ struct msm_jpeg_device {
 	 */
 	struct msm_jpeg_q input_buf_q;
 
+	/* frames started while the core was busy, run on frame done
+	 */
+	struct msm_jpeg_q job_q;
+	struct work_struct job_work;
+	spinlock_t job_lock;
+	int job_active;
+
 	struct v4l2_subdev subdev;
 
 	struct class *msm_jpeg_class;
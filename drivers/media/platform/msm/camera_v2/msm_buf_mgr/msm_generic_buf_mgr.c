@@ -13,6 +13,9 @@
 
 static struct msm_buf_mngr_device *msm_buf_mngr_dev;
 
+/* a descriptor is taken for every buffer handed out, once per frame */
+static struct kmem_cache *msm_get_bufs_cache;
+
 struct v4l2_subdev *msm_buf_mngr_get_subdev(void)
 {
 	return &msm_buf_mngr_dev->subdev.sd;
@@ -25,7 +28,7 @@ static int msm_buf_mngr_get_buf(struct msm_buf_mngr_device *buf_mngr_dev,
 	struct msm_buf_mngr_info *buf_info =
 		(struct msm_buf_mngr_info *)argp;
 	struct msm_get_bufs *new_entry =
-		kzalloc(sizeof(struct msm_get_bufs), GFP_KERNEL);
+		kmem_cache_zalloc(msm_get_bufs_cache, GFP_KERNEL);
 
 	if (!new_entry) {
 		pr_err("%s:No mem\n", __func__);
@@ -36,7 +39,7 @@ static int msm_buf_mngr_get_buf(struct msm_buf_mngr_device *buf_mngr_dev,
 		buf_info->stream_id);
 	if (!new_entry->vb2_buf) {
 		pr_debug("%s:Get buf is null\n", __func__);
-		kfree(new_entry);
+		kmem_cache_free(msm_get_bufs_cache, new_entry);
 		return -EINVAL;
 	}
 	new_entry->session_id = buf_info->session_id;
@@ -68,7 +71,7 @@ static int msm_buf_mngr_buf_done(struct msm_buf_mngr_device *buf_mngr_dev,
 						buf_info->session_id,
 						buf_info->stream_id);
 			list_del_init(&bufs->entry);
-			kfree(bufs);
+			kmem_cache_free(msm_get_bufs_cache, bufs);
 			break;
 		}
 	}
@@ -92,7 +95,7 @@ static int msm_buf_mngr_put_buf(struct msm_buf_mngr_device *buf_mngr_dev,
 			ret = buf_mngr_dev->vb2_ops.put_buf(bufs->vb2_buf,
 				buf_info->session_id, buf_info->stream_id);
 			list_del_init(&bufs->entry);
-			kfree(bufs);
+			kmem_cache_free(msm_get_bufs_cache, bufs);
 			break;
 		}
 	}
@@ -112,7 +115,7 @@ static void msm_buf_mngr_sd_shutdown(struct msm_buf_mngr_device *buf_mngr_dev)
 			pr_err("%s: Delete invalid bufs =%x\n", __func__,
 				(unsigned int)bufs);
 			list_del_init(&bufs->entry);
-			kfree(bufs);
+			kmem_cache_free(msm_get_bufs_cache, bufs);
 		}
 	}
 	spin_unlock_irqrestore(&buf_mngr_dev->buf_q_spinlock, flags);
@@ -165,10 +168,14 @@ static const struct of_device_id msm_buf_mngr_dt_match[] = {
 static int __init msm_buf_mngr_init(void)
 {
 	int rc = 0;
+	msm_get_bufs_cache = KMEM_CACHE(msm_get_bufs, 0);
+	if (WARN_ON(!msm_get_bufs_cache))
+		return -ENOMEM;
 	msm_buf_mngr_dev = kzalloc(sizeof(*msm_buf_mngr_dev),
 		GFP_KERNEL);
 	if (WARN_ON(!msm_buf_mngr_dev)) {
 		pr_err("%s: not enough memory", __func__);
+		kmem_cache_destroy(msm_get_bufs_cache);
 		return -ENOMEM;
 	}
 	/* Sub-dev */
@@ -202,6 +209,7 @@ end:
 static void __exit msm_buf_mngr_exit(void)
 {
 	kfree(msm_buf_mngr_dev);
+	kmem_cache_destroy(msm_get_bufs_cache);
 }
 
 module_init(msm_buf_mngr_init);
@@ -17,6 +17,7 @@
 #include <linux/of.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/slab.h>
 #include <media/v4l2-subdev.h>
 #include <media/msmb_camera.h>
 #include <media/msmb_generic_buf_mgr.h>
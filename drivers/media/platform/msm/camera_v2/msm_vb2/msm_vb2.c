@@ -48,6 +48,7 @@ int msm_vb2_buf_init(struct vb2_buffer *vb)
 	}
 	msm_vb2_buf = container_of(vb, struct msm_vb2_buffer, vb2_buf);
 	msm_vb2_buf->in_freeq = 0;
+	INIT_LIST_HEAD(&msm_vb2_buf->list);
 
 	return 0;
 }
@@ -81,7 +82,6 @@ static int msm_vb2_buf_finish(struct vb2_buffer *vb)
 	struct msm_vb2_buffer *msm_vb2;
 	struct msm_stream *stream;
 	unsigned long flags;
-	struct msm_vb2_buffer *msm_vb2_entry, *temp;
 
 	msm_vb2 = container_of(vb, struct msm_vb2_buffer, vb2_buf);
 
@@ -97,13 +97,7 @@ static int msm_vb2_buf_finish(struct vb2_buffer *vb)
 	}
 
 	spin_lock_irqsave(&stream->stream_lock, flags);
-	list_for_each_entry_safe(msm_vb2_entry, temp, &(stream->queued_list),
-		list) {
-		if (msm_vb2_entry == msm_vb2) {
-			list_del_init(&msm_vb2_entry->list);
-			break;
-		}
-	}
+	list_del_init(&msm_vb2->list);
 	spin_unlock_irqrestore(&stream->stream_lock, flags);
 	return 0;
 }
@@ -128,7 +122,7 @@ static void msm_vb2_buf_cleanup(struct vb2_buffer *vb)
 	}
 
 	spin_lock_irqsave(&stream->stream_lock, flags);
-	INIT_LIST_HEAD(&stream->queued_list);
+	list_del_init(&msm_vb2->list);
 	spin_unlock_irqrestore(&stream->stream_lock, flags);
 }
 
@@ -215,7 +215,6 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 	while (cmd_size) {
 		CDBG("%s cmd_size %d addr 0x%x data 0x%x", __func__,
 			cmd_size, i2c_cmd->reg_addr, i2c_cmd->reg_data);
-		delay = i2c_cmd->delay;
 		data[i++] = CCI_I2C_WRITE_CMD;
 		if (i2c_cmd->reg_addr)
 			reg_addr = i2c_cmd->reg_addr;
@@ -226,13 +225,16 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 			data[i++] = (reg_addr & 0xFF00) >> 8;
 			data[i++] = reg_addr & 0x00FF;
 		}
-		/* max of 10 data bytes */
+		/*
+		 * max of 10 data bytes, entries without an address or with
+		 * the next address in sequence share one write command
+		 */
 		do {
 			if (i2c_msg->data_type == MSM_CAMERA_I2C_BYTE_DATA) {
 				data[i++] = i2c_cmd->reg_data;
 				reg_addr++;
 			} else {
-				if ((i + 1) <= 10) {
+				if ((i + 1) < 10) {
 					data[i++] = (i2c_cmd->reg_data &
 						0xFF00) >> 8; /* MSB */
 					data[i++] = i2c_cmd->reg_data &
@@ -241,8 +243,10 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 				} else
 					break;
 			}
+			delay = i2c_cmd->delay;
 			i2c_cmd++;
-		} while (--cmd_size && !i2c_cmd->reg_addr && (i <= 10));
+		} while (--cmd_size && (i < 10) && (!i2c_cmd->reg_addr ||
+			(!delay && i2c_cmd->reg_addr == reg_addr)));
 		data[0] |= ((i-1) << 4);
 		len = ((i-1)/4) + 1;
 		rc = msm_cci_validate_queue(cci_dev, len, master, queue);
@@ -575,3 +575,16 @@ int msm_camera_request_gpio_table(struct gpio *gpio_tbl, uint8_t size,
 	}
 	return rc;
 }
+
+/*
+ * Sleep until a power sequence step has settled. The step records its
+ * deadline instead of sleeping at once, so host side work can run while
+ * the sensor settles.
+ */
+void msm_camera_wait_until(ktime_t deadline)
+{
+	s64 us = ktime_us_delta(deadline, ktime_get());
+
+	if (us > 0)
+		usleep_range(us, us + 1000);
+}
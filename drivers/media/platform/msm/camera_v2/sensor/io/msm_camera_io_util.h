@@ -15,6 +15,7 @@
 
 #include <linux/regulator/consumer.h>
 #include <linux/gpio.h>
+#include <linux/hrtimer.h>
 #include <mach/camera2.h>
 #include <media/msm_cam_sensor.h>
 
@@ -55,4 +56,6 @@ int msm_camera_config_single_vreg(struct device *dev,
 int msm_camera_request_gpio_table(struct gpio *gpio_tbl, uint8_t size,
 	int gpio_en);
 
+void msm_camera_wait_until(ktime_t deadline);
+
 #endif
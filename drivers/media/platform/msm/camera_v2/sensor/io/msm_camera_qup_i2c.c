@@ -25,6 +25,7 @@
 #define I2C_COMPARE_MATCH 0
 #define I2C_COMPARE_MISMATCH 1
 #define I2C_POLL_MAX_ITERATION 20
+#define I2C_BURST_MAX_DATA 64
 
 static int32_t msm_camera_qup_i2c_rxdata(
 	struct msm_camera_i2c_client *dev_client, unsigned char *rxdata,
@@ -226,10 +227,44 @@ int32_t msm_camera_qup_i2c_write_seq(struct msm_camera_i2c_client *client,
 	return rc;
 }
 
+/*
+ * Number of table entries from reg_setting that target consecutive
+ * addresses and can go out as one auto incrementing transfer.
+ */
+static int msm_camera_qup_i2c_burst_len(
+	struct msm_camera_i2c_reg_array *reg_setting, int count,
+	enum msm_camera_i2c_data_type data_type)
+{
+	int n = 1;
+
+	while (n < count && (n + 1) * data_type <= I2C_BURST_MAX_DATA &&
+		reg_setting[n].reg_addr ==
+			(uint16_t)(reg_setting[n - 1].reg_addr + data_type))
+		n++;
+	return n;
+}
+
+static int32_t msm_camera_qup_i2c_write_burst(
+	struct msm_camera_i2c_client *client,
+	struct msm_camera_i2c_reg_array *reg_setting, int count,
+	enum msm_camera_i2c_data_type data_type)
+{
+	uint8_t data[I2C_BURST_MAX_DATA];
+	int i, len = 0;
+
+	for (i = 0; i < count; i++) {
+		if (data_type == MSM_CAMERA_I2C_WORD_DATA)
+			data[len++] = reg_setting[i].reg_data >> BITS_PER_BYTE;
+		data[len++] = reg_setting[i].reg_data;
+	}
+	return msm_camera_qup_i2c_write_seq(client, reg_setting->reg_addr,
+		data, len);
+}
+
 int32_t msm_camera_qup_i2c_write_table(struct msm_camera_i2c_client *client,
 	struct msm_camera_i2c_reg_setting *write_setting)
 {
-	int i;
+	int i, n;
 	int32_t rc = -EFAULT;
 	struct msm_camera_i2c_reg_array *reg_setting;
 	uint16_t client_addr_type;
@@ -247,15 +282,22 @@ int32_t msm_camera_qup_i2c_write_table(struct msm_camera_i2c_client *client,
 	client_addr_type = client->addr_type;
 	client->addr_type = write_setting->addr_type;
 
-	for (i = 0; i < write_setting->size; i++) {
+	for (i = 0; i < write_setting->size; i += n) {
 		CDBG("%s addr %x data %x\n", __func__,
 			reg_setting->reg_addr, reg_setting->reg_data);
 
-		rc = msm_camera_qup_i2c_write(client, reg_setting->reg_addr,
-			reg_setting->reg_data, write_setting->data_type);
+		n = msm_camera_qup_i2c_burst_len(reg_setting,
+			write_setting->size - i, write_setting->data_type);
+		if (n > 1)
+			rc = msm_camera_qup_i2c_write_burst(client, reg_setting,
+				n, write_setting->data_type);
+		else
+			rc = msm_camera_qup_i2c_write(client,
+				reg_setting->reg_addr, reg_setting->reg_data,
+				write_setting->data_type);
 		if (rc < 0)
 			break;
-		reg_setting++;
+		reg_setting += n;
 	}
 	if (write_setting->delay > 20)
 		msleep(write_setting->delay);
@@ -44,12 +44,23 @@
 #define AK8975DRV_DATA_DBG 0
 #define MAX_FAILURE_COUNT 10
 
+#define AKM8975_BATCH_SIZE 32
+
+struct akm8975_frame {
+	short value[12];
+	ktime_t time;
+};
+
 struct akm8975_data {
 	struct i2c_client *this_client;
 	struct akm8975_platform_data *pdata;
 	struct input_dev *input_dev;
 	struct work_struct work;
 	struct mutex flags_lock;
+	struct mutex batch_lock;
+	struct delayed_work batch_work;
+	struct akm8975_frame batch[AKM8975_BATCH_SIZE];
+	unsigned int batch_count;
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct early_suspend early_suspend;
 #endif
@@ -71,6 +82,7 @@ static short t_flag;
 static short mv_flag;
 
 static short akmd_delay;
+static short akmd_batch;
 
 static ssize_t akm8975_show(struct device *dev, struct device_attribute *attr,
 				 char *buf)
@@ -138,7 +150,8 @@ static int akm8975_i2c_txdata(struct akm8975_data *akm, char *buf, int length)
 		return 0;
 }
 
-static void akm8975_ecs_report_value(struct akm8975_data *akm, short *rbuf)
+static void akm8975_ecs_report_value(struct akm8975_data *akm, short *rbuf,
+				     int age_us)
 {
 	struct akm8975_data *data = i2c_get_clientdata(akm->this_client);
 
@@ -181,12 +194,66 @@ static void akm8975_ecs_report_value(struct akm8975_data *akm, short *rbuf)
 	}
 	mutex_unlock(&akm->flags_lock);
 
+	if (age_us >= 0)
+		input_event(data->input_dev, EV_MSC, MSC_RAW, age_us);
 	input_sync(data->input_dev);
 }
 
+/* Must hold batch_lock */
+static void akm8975_batch_flush_locked(struct akm8975_data *akm)
+{
+	ktime_t now = ktime_get();
+	unsigned int i;
+
+	for (i = 0; i < akm->batch_count; i++)
+		akm8975_ecs_report_value(akm, akm->batch[i].value,
+			(int)ktime_us_delta(now, akm->batch[i].time));
+	akm->batch_count = 0;
+}
+
+static void akm8975_batch_flush(struct akm8975_data *akm)
+{
+	mutex_lock(&akm->batch_lock);
+	akm8975_batch_flush_locked(akm);
+	mutex_unlock(&akm->batch_lock);
+}
+
+static void akm8975_batch_work_func(struct work_struct *work)
+{
+	struct akm8975_data *akm =
+	    container_of(work, struct akm8975_data, batch_work.work);
+
+	akm8975_batch_flush(akm);
+}
+
+/*
+ * Queue a sample from the daemon. The readers of the input device are
+ * woken once per batch, when it fills or akmd_batch ms after its first
+ * sample, rather than once per sample.
+ */
+static void akm8975_batch_value(struct akm8975_data *akm, short *rbuf)
+{
+	struct akm8975_frame *frame;
+
+	mutex_lock(&akm->batch_lock);
+	frame = &akm->batch[akm->batch_count++];
+	memcpy(frame->value, rbuf, sizeof(frame->value));
+	frame->time = ktime_get();
+
+	if (akm->batch_count == 1)
+		schedule_delayed_work(&akm->batch_work,
+				      msecs_to_jiffies(akmd_batch));
+	if (akm->batch_count == AKM8975_BATCH_SIZE) {
+		akm8975_batch_flush_locked(akm);
+		cancel_delayed_work(&akm->batch_work);
+	}
+	mutex_unlock(&akm->batch_lock);
+}
+
 static void akm8975_ecs_close_done(struct akm8975_data *akm)
 {
 	FUNCDBG("called");
+	akm8975_batch_flush(akm);
 	mutex_lock(&akm->flags_lock);
 	m_flag = 1;
 	a_flag = 1;
@@ -244,6 +311,12 @@ static int akm_aot_ioctl(struct inode *inode, struct file *file,
 		if (copy_from_user(&flag, argp, sizeof(flag)))
 			return -EFAULT;
 		break;
+	case ECS_IOCTL_APP_SET_BATCH:
+		if (copy_from_user(&flag, argp, sizeof(flag)))
+			return -EFAULT;
+		if (flag < 0)
+			return -EINVAL;
+		break;
 	default:
 		break;
 	}
@@ -274,16 +347,29 @@ static int akm_aot_ioctl(struct inode *inode, struct file *file,
 	case ECS_IOCTL_APP_GET_DELAY:
 		flag = akmd_delay;
 		break;
+	case ECS_IOCTL_APP_SET_BATCH:
+		akmd_batch = flag;
+		break;
+	case ECS_IOCTL_APP_GET_BATCH:
+		flag = akmd_batch;
+		break;
 	default:
+		mutex_unlock(&akm->flags_lock);
 		return -ENOTTY;
 	}
 	mutex_unlock(&akm->flags_lock);
 
 	switch (cmd) {
+	case ECS_IOCTL_APP_SET_BATCH:
+		/* the queued samples are reported with flags_lock */
+		if (!flag)
+			akm8975_batch_flush(akm);
+		break;
 	case ECS_IOCTL_APP_GET_MFLAG:
 	case ECS_IOCTL_APP_GET_AFLAG:
 	case ECS_IOCTL_APP_GET_MVFLAG:
 	case ECS_IOCTL_APP_GET_DELAY:
+	case ECS_IOCTL_APP_GET_BATCH:
 		if (copy_to_user(argp, &flag, sizeof(flag)))
 			return -EFAULT;
 		break;
@@ -365,7 +451,10 @@ static int akmd_ioctl(struct inode *inode, struct file *file, unsigned int cmd,
 			return ret;
 		break;
 	case ECS_IOCTL_SET_YPR:
-		akm8975_ecs_report_value(akm, value);
+		if (akmd_batch)
+			akm8975_batch_value(akm, value);
+		else
+			akm8975_ecs_report_value(akm, value, -1);
 		break;
 
 	case ECS_IOCTL_GET_OPEN_STATUS:
@@ -589,7 +678,9 @@ int akm8975_probe(struct i2c_client *client,
 	akm->pdata = client->dev.platform_data;
 
 	mutex_init(&akm->flags_lock);
+	mutex_init(&akm->batch_lock);
 	INIT_WORK(&akm->work, akm_work_func);
+	INIT_DELAYED_WORK(&akm->batch_work, akm8975_batch_work_func);
 	i2c_set_clientdata(client, akm);
 
 	err = akm8975_power_on(akm);
@@ -609,6 +700,8 @@ int akm8975_probe(struct i2c_client *client,
 	}
 
 	set_bit(EV_ABS, akm->input_dev->evbit);
+	set_bit(EV_MSC, akm->input_dev->evbit);
+	set_bit(MSC_RAW, akm->input_dev->mscbit);
 
 	/* yaw */
 	input_set_abs_params(akm->input_dev, ABS_RX, 0, 23040, 0, 0);
@@ -683,6 +776,7 @@ static int __devexit akm8975_remove(struct i2c_client *client)
 	struct akm8975_data *akm = i2c_get_clientdata(client);
 	FUNCDBG("called");
 	free_irq(client->irq, NULL);
+	cancel_delayed_work_sync(&akm->batch_work);
 	input_unregister_device(akm->input_dev);
 	misc_deregister(&akmd_device);
 	misc_deregister(&akm_aot_device);
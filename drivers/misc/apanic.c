@@ -37,6 +37,8 @@
 #include <linux/mutex.h>
 #include <linux/workqueue.h>
 #include <linux/preempt.h>
+#include <linux/vmalloc.h>
+#include <linux/lzo.h>
 
 extern void ram_console_enable_console(int);
 
@@ -46,6 +48,7 @@ struct panic_header {
 
 	u32 version;
 #define PHDR_VERSION   0x01
+#define PHDR_VERSION_LZO 0x02	/* console and threads are chunk streams */
 
 	u32 console_offset;
 	u32 console_length;
@@ -54,12 +57,36 @@ struct panic_header {
 	u32 threads_length;
 };
 
+/*
+ * A compressed stream is a run of these, each followed by clen bytes of
+ * LZO holding ulen bytes of text, packed without alignment.
+ */
+struct apanic_chunk {
+	u32 clen;
+	u32 ulen;
+};
+
+/* Text compressed at a time, and the flash writes are staged in */
+#define APANIC_CHUNK_SIZE	(16 * 1024)
+#define APANIC_STAGE_SIZE	(64 * 1024)
+
 struct apanic_data {
 	struct mtd_info		*mtd;
 	struct panic_header	curr;
 	void			*bounce;
 	struct proc_dir_entry	*apanic_console;
 	struct proc_dir_entry	*apanic_threads;
+
+	/* panic time output, written out in runs of whole pages */
+	void			*stage;
+	size_t			stage_len;
+	loff_t			stage_off;
+	void			*lzo_in;
+	void			*lzo_wrkmem;
+
+	/* the previous dump, if it was compressed */
+	char			*inflated[2];
+	size_t			inflated_len[2];
 };
 
 static struct apanic_data drv_ctx;
@@ -154,6 +181,26 @@ static int apanic_proc_read(char *buffer, char **start, off_t offset,
 
 	mutex_lock(&drv_mutex);
 
+	if (((int) dat == 1 || (int) dat == 2) &&
+	    ctx->inflated[(int) dat - 1]) {
+		char *data = ctx->inflated[(int) dat - 1];
+
+		file_length = ctx->inflated_len[(int) dat - 1];
+		if (offset >= file_length) {
+			*peof = 1;
+			mutex_unlock(&drv_mutex);
+			return 0;
+		}
+		if (count > file_length - offset)
+			count = file_length - offset;
+		memcpy(buffer, data + offset, count);
+		*start = (char *) count;
+		if (offset + count == file_length)
+			*peof = 1;
+		mutex_unlock(&drv_mutex);
+		return count;
+	}
+
 	switch ((int) dat) {
 	case 1:	/* apanic_console */
 		file_length = ctx->curr.console_length;
@@ -197,7 +244,7 @@ static int apanic_proc_read(char *buffer, char **start, off_t offset,
 		count -= page_offset;
 	memcpy(buffer, ctx->bounce + page_offset, count);
 
-	*start = count;
+	*start = (char *) count;
 
 	if ((offset + count) == file_length)
 		*peof = 1;
@@ -273,6 +320,9 @@ static void apanic_remove_proc_work(struct work_struct *work)
 	mutex_lock(&drv_mutex);
 	mtd_panic_erase();
 	memset(&ctx->curr, 0, sizeof(struct panic_header));
+	vfree(ctx->inflated[0]);
+	vfree(ctx->inflated[1]);
+	memset(ctx->inflated, 0, sizeof(ctx->inflated));
 	if (ctx->apanic_console) {
 		remove_proc_entry("apanic_console", NULL);
 		ctx->apanic_console = NULL;
@@ -291,6 +341,102 @@ static int apanic_proc_write(struct file *file, const char __user *buffer,
 	return count;
 }
 
+#ifdef CONFIG_APANIC_LZO
+static inline int apanic_version_lzo(u32 version)
+{
+	return version == PHDR_VERSION_LZO;
+}
+
+/*
+ * Reads back a compressed stream written by apanic() and expands it, so
+ * the proc files can serve the text from memory.
+ */
+static int apanic_inflate(struct mtd_info *mtd, unsigned int off,
+			  unsigned int len, char **out, size_t *out_len)
+{
+	struct apanic_data *ctx = &drv_ctx;
+	struct apanic_chunk chunk;
+	unsigned char *raw;
+	unsigned int pos;
+	size_t ulen = 0, rlen, dlen;
+	char *text;
+	int rc;
+
+	raw = vmalloc(ALIGN(len, mtd->writesize));
+	if (!raw)
+		return -ENOMEM;
+
+	for (pos = 0; pos < len; pos += mtd->writesize) {
+		loff_t phys = phy_offset(mtd, off + pos);
+
+		if (phys == APANIC_INVALID_OFFSET) {
+			rc = -EINVAL;
+			goto out_raw;
+		}
+		rc = mtd->read(mtd, phys, mtd->writesize, &rlen, ctx->bounce);
+		if (rc && rc != -EUCLEAN)
+			goto out_raw;
+		memcpy(raw + pos, ctx->bounce, mtd->writesize);
+	}
+
+	/*
+	 * Size the text. A chunk cut short by a failed write ends the
+	 * stream.
+	 */
+	for (pos = 0; pos + sizeof(chunk) <= len;
+	     pos += sizeof(chunk) + chunk.clen) {
+		memcpy(&chunk, raw + pos, sizeof(chunk));
+		if (chunk.ulen > APANIC_CHUNK_SIZE) {
+			rc = -EINVAL;
+			goto out_raw;
+		}
+		if (!chunk.clen || chunk.clen > len - pos - sizeof(chunk))
+			break;
+		ulen += chunk.ulen;
+	}
+	len = pos;
+
+	text = vmalloc(ulen ? ulen : 1);
+	if (!text) {
+		rc = -ENOMEM;
+		goto out_raw;
+	}
+
+	ulen = 0;
+	for (pos = 0; pos + sizeof(chunk) <= len;
+	     pos += sizeof(chunk) + chunk.clen) {
+		memcpy(&chunk, raw + pos, sizeof(chunk));
+		dlen = chunk.ulen;
+		rc = lzo1x_decompress_safe(raw + pos + sizeof(chunk),
+					   chunk.clen, text + ulen, &dlen);
+		if (rc != LZO_E_OK || dlen != chunk.ulen) {
+			vfree(text);
+			rc = -EINVAL;
+			goto out_raw;
+		}
+		ulen += dlen;
+	}
+
+	*out = text;
+	*out_len = ulen;
+	rc = 0;
+out_raw:
+	vfree(raw);
+	return rc;
+}
+#else
+static inline int apanic_version_lzo(u32 version)
+{
+	return 0;
+}
+
+static inline int apanic_inflate(struct mtd_info *mtd, unsigned int off,
+				 unsigned int len, char **out, size_t *out_len)
+{
+	return -EINVAL;
+}
+#endif
+
 static void mtd_panic_notify_add(struct mtd_info *mtd)
 {
 	struct apanic_data *ctx = &drv_ctx;
@@ -302,6 +448,12 @@ static void mtd_panic_notify_add(struct mtd_info *mtd)
 	if (strcmp(mtd->name, CONFIG_APANIC_PLABEL))
 		return;
 
+	if (mtd->writesize > APANIC_STAGE_SIZE) {
+		printk(KERN_ERR "apanic: %u byte pages are too large\n",
+		       mtd->writesize);
+		return;
+	}
+
 	ctx->mtd = mtd;
 
 	alloc_bbt(mtd, apanic_bbt);
@@ -335,7 +487,7 @@ static void mtd_panic_notify_add(struct mtd_info *mtd)
 		return;
 	}
 
-	if (hdr->version != PHDR_VERSION) {
+	if (hdr->version != PHDR_VERSION && !apanic_version_lzo(hdr->version)) {
 		printk(KERN_INFO "apanic: Version mismatch (%d != %d)\n",
 		       hdr->version, PHDR_VERSION);
 		mtd_panic_erase();
@@ -343,11 +495,27 @@ static void mtd_panic_notify_add(struct mtd_info *mtd)
 	}
 
 	memcpy(&ctx->curr, hdr, sizeof(struct panic_header));
+	hdr = &ctx->curr;
 
 	printk(KERN_INFO "apanic: c(%u, %u) t(%u, %u)\n",
 	       hdr->console_offset, hdr->console_length,
 	       hdr->threads_offset, hdr->threads_length);
 
+	if (hdr->version == PHDR_VERSION_LZO) {
+		if (hdr->console_length &&
+		    apanic_inflate(mtd, hdr->console_offset,
+				   hdr->console_length, &ctx->inflated[0],
+				   &ctx->inflated_len[0]))
+			printk(KERN_ERR "apanic: Bad compressed console\n");
+		if (hdr->threads_length &&
+		    apanic_inflate(mtd, hdr->threads_offset,
+				   hdr->threads_length, &ctx->inflated[1],
+				   &ctx->inflated_len[1]))
+			printk(KERN_ERR "apanic: Bad compressed threads\n");
+		hdr->console_length = ctx->inflated_len[0];
+		hdr->threads_length = ctx->inflated_len[1];
+	}
+
 	if (hdr->console_length) {
 		ctx->apanic_console = create_proc_entry("apanic_console",
 						      S_IFREG | S_IRUGO, NULL);
@@ -402,11 +570,17 @@ static struct mtd_notifier mtd_panic_notifier = {
 
 static int in_panic = 0;
 
-static int apanic_writeflashpage(struct mtd_info *mtd, loff_t to,
-				 const u_char *buf)
+/*
+ * Writes @len bytes, a multiple of the page size, at @to. Bad blocks are
+ * remapped, so each write stays within one erase block.
+ * Returns the number of bytes written
+ */
+static int apanic_writeflash(struct mtd_info *mtd, loff_t to,
+			     const u_char *buf, size_t len)
 {
+	size_t done = 0, n, wlen;
+	loff_t phys;
 	int rc;
-	size_t wlen;
 	int panic = in_interrupt() | in_atomic();
 
 	if (panic && !mtd->panic_write) {
@@ -417,32 +591,108 @@ static int apanic_writeflashpage(struct mtd_info *mtd, loff_t to,
 		return 0;
 	}
 
-	to = phy_offset(mtd, to);
-	if (to == APANIC_INVALID_OFFSET) {
-		printk(KERN_EMERG "apanic: write to invalid address\n");
-		return 0;
-	}
+	while (done < len) {
+		n = mtd->erasesize - ((to + done) & (mtd->erasesize - 1));
+		n = min(n, len - done);
 
-	if (panic)
-		rc = mtd->panic_write(mtd, to, mtd->writesize, &wlen, buf);
-	else
-		rc = mtd->write(mtd, to, mtd->writesize, &wlen, buf);
+		phys = phy_offset(mtd, to + done);
+		if (phys == APANIC_INVALID_OFFSET) {
+			printk(KERN_EMERG "apanic: write to invalid address\n");
+			break;
+		}
 
-	if (rc) {
-		printk(KERN_EMERG
-		       "%s: Error writing data to flash (%d)\n",
-		       __func__, rc);
-		return rc;
+		if (panic)
+			rc = mtd->panic_write(mtd, phys, n, &wlen, buf + done);
+		else
+			rc = mtd->write(mtd, phys, n, &wlen, buf + done);
+
+		if (rc) {
+			printk(KERN_EMERG
+			       "%s: Error writing data to flash (%d)\n",
+			       __func__, rc);
+			return rc;
+		}
+		done += wlen;
+		if (wlen != n)
+			break;
 	}
 
-	return wlen;
+	return done;
 }
 
 extern int log_buf_copy(char *dest, int idx, int len);
 extern void log_buf_clear(void);
 
 /*
- * Writes the contents of the console to the specified offset in flash.
+ * Writes the whole pages staged so far, or everything padded out to a
+ * page if @final, and keeps the rest for the next write.
+ */
+static int apanic_flush_stage(struct mtd_info *mtd, int final)
+{
+	struct apanic_data *ctx = &drv_ctx;
+	size_t n, rem;
+	int rc;
+
+	if (final) {
+		n = ALIGN(ctx->stage_len, mtd->writesize);
+		memset(ctx->stage + ctx->stage_len, 0, n - ctx->stage_len);
+	} else {
+		n = ctx->stage_len & ~(mtd->writesize - 1);
+	}
+	if (!n)
+		return 0;
+
+	rc = apanic_writeflash(mtd, ctx->stage_off, ctx->stage, n);
+	if (rc != (int) n) {
+		printk(KERN_EMERG "apanic: Flash write failed (%d)\n", rc);
+		return -EIO;
+	}
+
+	rem = final ? 0 : ctx->stage_len - n;
+	memmove(ctx->stage, ctx->stage + n, rem);
+	ctx->stage_len = rem;
+	ctx->stage_off += n;
+	return 0;
+}
+
+#ifdef CONFIG_APANIC_LZO
+/* Compresses @len bytes from lzo_in onto the stage as one chunk */
+static int apanic_stage_chunk(struct mtd_info *mtd, size_t len)
+{
+	struct apanic_data *ctx = &drv_ctx;
+	struct apanic_chunk chunk;
+	size_t clen;
+	int rc;
+
+	if (APANIC_STAGE_SIZE - ctx->stage_len <
+	    sizeof(chunk) + lzo1x_worst_compress(APANIC_CHUNK_SIZE)) {
+		rc = apanic_flush_stage(mtd, 0);
+		if (rc)
+			return rc;
+	}
+
+	rc = lzo1x_1_compress(ctx->lzo_in, len,
+			      ctx->stage + ctx->stage_len + sizeof(chunk),
+			      &clen, ctx->lzo_wrkmem);
+	if (rc != LZO_E_OK)
+		return -EINVAL;
+
+	chunk.clen = clen;
+	chunk.ulen = len;
+	memcpy(ctx->stage + ctx->stage_len, &chunk, sizeof(chunk));
+	ctx->stage_len += sizeof(chunk) + clen;
+	return 0;
+}
+#else
+static inline int apanic_stage_chunk(struct mtd_info *mtd, size_t len)
+{
+	return -EINVAL;
+}
+#endif
+
+/*
+ * Writes the contents of the console to the specified offset in flash,
+ * compressed if the LZO buffers are there.
  * Returns number of bytes written
  */
 static int apanic_write_console(struct mtd_info *mtd, unsigned int off)
@@ -450,38 +700,51 @@ static int apanic_write_console(struct mtd_info *mtd, unsigned int off)
 	struct apanic_data *ctx = &drv_ctx;
 	int saved_oip;
 	int idx = 0;
-	int rc, rc2;
-	unsigned int last_chunk = 0;
+	size_t space;
+	char *dst;
+	int rc;
 
-	while (!last_chunk) {
-		saved_oip = oops_in_progress;
-		oops_in_progress = 1;
-		rc = log_buf_copy(ctx->bounce, idx, mtd->writesize);
-		if (rc < 0)
-			break;
+	ctx->stage_off = off;
+	ctx->stage_len = 0;
 
-		if (rc != mtd->writesize)
-			last_chunk = rc;
+	for (;;) {
+		if (ctx->lzo_in) {
+			dst = ctx->lzo_in;
+			space = APANIC_CHUNK_SIZE;
+		} else {
+			dst = ctx->stage + ctx->stage_len;
+			space = APANIC_STAGE_SIZE - ctx->stage_len;
+		}
 
+		saved_oip = oops_in_progress;
+		oops_in_progress = 1;
+		rc = log_buf_copy(dst, idx, space);
 		oops_in_progress = saved_oip;
 		if (rc <= 0)
 			break;
-		if (rc != mtd->writesize)
-			memset(ctx->bounce + rc, 0, mtd->writesize - rc);
-
-		rc2 = apanic_writeflashpage(mtd, off, ctx->bounce);
-		if (rc2 <= 0) {
-			printk(KERN_EMERG
-			       "apanic: Flash write failed (%d)\n", rc2);
-			return idx;
+		idx += rc;
+
+		if (ctx->lzo_in) {
+			if (apanic_stage_chunk(mtd, rc))
+				goto out;
+		} else {
+			ctx->stage_len += rc;
+			if (ctx->stage_len == APANIC_STAGE_SIZE &&
+			    apanic_flush_stage(mtd, 0))
+				goto out;
 		}
-		if (!last_chunk)
-			idx += rc2;
-		else
-			idx += last_chunk;
-		off += rc2;
+
+		if (rc != space)
+			break;
 	}
-	return idx;
+
+	/* the stream ends where the data does, not at the padding */
+	rc = ctx->stage_off - off + ctx->stage_len;
+	if (apanic_flush_stage(mtd, 1))
+		goto out;
+	return rc;
+out:
+	return ctx->stage_off - off;
 }
 
 static int apanic(struct notifier_block *this, unsigned long event,
@@ -504,7 +767,7 @@ static int apanic(struct notifier_block *this, unsigned long event,
 #endif
 	touch_softlockup_watchdog();
 
-	if (!ctx->mtd)
+	if (!ctx->mtd || !ctx->stage)
 		goto out;
 
 	if (ctx->curr.magic) {
@@ -547,7 +810,7 @@ static int apanic(struct notifier_block *this, unsigned long event,
 	 */
 	memset(ctx->bounce, 0, PAGE_SIZE);
 	hdr->magic = PANIC_MAGIC;
-	hdr->version = PHDR_VERSION;
+	hdr->version = ctx->lzo_in ? PHDR_VERSION_LZO : PHDR_VERSION;
 
 	hdr->console_offset = console_offset;
 	hdr->console_length = console_len;
@@ -555,7 +818,7 @@ static int apanic(struct notifier_block *this, unsigned long event,
 	hdr->threads_offset = threads_offset;
 	hdr->threads_length = threads_len;
 
-	rc = apanic_writeflashpage(ctx->mtd, 0, ctx->bounce);
+	rc = apanic_writeflash(ctx->mtd, 0, ctx->bounce, ctx->mtd->writesize);
 	if (rc <= 0) {
 		printk(KERN_EMERG "apanic: Header write failed (%d)\n",
 		       rc);
@@ -597,6 +860,21 @@ int __init apanic_init(void)
 	debugfs_create_file("apanic", 0644, NULL, NULL, &panic_dbg_fops);
 	memset(&drv_ctx, 0, sizeof(drv_ctx));
 	drv_ctx.bounce = (void *) __get_free_page(GFP_KERNEL);
+	drv_ctx.stage = (void *) __get_free_pages(GFP_KERNEL,
+					get_order(APANIC_STAGE_SIZE));
+	if (!drv_ctx.stage)
+		printk(KERN_ERR "apanic: No memory for the write buffer\n");
+#ifdef CONFIG_APANIC_LZO
+	drv_ctx.lzo_in = vmalloc(APANIC_CHUNK_SIZE);
+	drv_ctx.lzo_wrkmem = vmalloc(LZO1X_1_MEM_COMPRESS);
+	if (!drv_ctx.lzo_in || !drv_ctx.lzo_wrkmem) {
+		printk(KERN_ERR "apanic: No memory to compress, writing raw\n");
+		vfree(drv_ctx.lzo_in);
+		vfree(drv_ctx.lzo_wrkmem);
+		drv_ctx.lzo_in = NULL;
+		drv_ctx.lzo_wrkmem = NULL;
+	}
+#endif
 	INIT_WORK(&proc_removal_work, apanic_remove_proc_work);
 	printk(KERN_INFO "Android kernel panic handler initialized (bind=%s)\n",
 	       CONFIG_APANIC_PLABEL);
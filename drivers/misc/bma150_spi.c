@@ -22,6 +22,8 @@
 #include <asm/gpio.h>
 #include <linux/earlysuspend.h>
 #include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/workqueue.h>
 #include <mach/atmega_microp.h>
 
 /*#define EARLY_SUSPEND_BMA 1*/
@@ -45,6 +47,16 @@ struct device_attribute dev_attr_##_name = __ATTR(_name, _mode, _show, _store)
 static int debug_flag;
 static char update_user_calibrate_data;
 
+static struct mutex batch_mutex;
+static DECLARE_WAIT_QUEUE_HEAD(batch_wq);
+static struct bma150_sample batch_buf[BMA_BATCH_SIZE];
+static unsigned int batch_head, batch_tail;	/* free running */
+static struct bma150_batch batch_cfg;
+static unsigned long batch_deadline;
+static int batch_ready;
+static void spi_bma150_batch_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(batch_work, spi_bma150_batch_work);
+
 static int spi_microp_enable(uint8_t on)
 {
 	int ret;
@@ -266,6 +278,99 @@ static int __spi_bma150_set_mode(char mode)
 }
 
 
+/*
+ * Sample into batch_buf and wake the reader only when the batch is due,
+ * so the daemon sleeps in poll() for latency_ms instead of asking for
+ * every sample. The chip has no FIFO of its own, so the sampling itself
+ * still runs on the apps processor.
+ */
+static void spi_bma150_batch_work(struct work_struct *work)
+{
+	struct bma150_sample *s;
+	short rbuf[3];
+
+	if (spi_bma150_TransRBuff(rbuf) < 0)
+		goto resched;
+
+	mutex_lock(&batch_mutex);
+	if (batch_head - batch_tail == BMA_BATCH_SIZE)
+		batch_tail++;
+	s = &batch_buf[batch_head++ % BMA_BATCH_SIZE];
+	s->time_ns = ktime_to_ns(ktime_get());
+	s->x = rbuf[0];
+	s->y = rbuf[1];
+	s->z = rbuf[2];
+	s->reserved = 0;
+
+	if (batch_head - batch_tail == 1)
+		batch_deadline = jiffies + msecs_to_jiffies(batch_cfg.latency_ms);
+	if (batch_head - batch_tail == BMA_BATCH_SIZE ||
+	    time_after_eq(jiffies, batch_deadline)) {
+		batch_ready = 1;
+		wake_up_interruptible(&batch_wq);
+	}
+	mutex_unlock(&batch_mutex);
+
+resched:
+	if (batch_cfg.interval_ms)
+		schedule_delayed_work(&batch_work,
+				      msecs_to_jiffies(batch_cfg.interval_ms));
+}
+
+static void spi_bma150_batch_start(const struct bma150_batch *cfg)
+{
+	batch_cfg.interval_ms = 0;
+	cancel_delayed_work_sync(&batch_work);
+
+	mutex_lock(&batch_mutex);
+	batch_head = batch_tail = 0;
+	batch_ready = 0;
+	batch_cfg = *cfg;
+	mutex_unlock(&batch_mutex);
+
+	if (batch_cfg.interval_ms)
+		schedule_delayed_work(&batch_work, 0);
+}
+
+static ssize_t spi_bma150_read(struct file *file, char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	struct bma150_sample *s;
+	size_t done = 0;
+	int ret;
+
+	if (count < sizeof(*s))
+		return -EINVAL;
+
+	if (!batch_ready && (file->f_flags & O_NONBLOCK))
+		return -EAGAIN;
+	ret = wait_event_interruptible(batch_wq, batch_ready);
+	if (ret)
+		return ret;
+
+	mutex_lock(&batch_mutex);
+	while (batch_tail != batch_head && done + sizeof(*s) <= count) {
+		s = &batch_buf[batch_tail % BMA_BATCH_SIZE];
+		if (copy_to_user(buf + done, s, sizeof(*s))) {
+			ret = -EFAULT;
+			break;
+		}
+		batch_tail++;
+		done += sizeof(*s);
+	}
+	if (batch_tail == batch_head)
+		batch_ready = 0;
+	mutex_unlock(&batch_mutex);
+
+	return done ? done : ret;
+}
+
+static unsigned int spi_bma150_poll(struct file *file, poll_table *wait)
+{
+	poll_wait(file, &batch_wq, wait);
+	return batch_ready ? POLLIN | POLLRDNORM : 0;
+}
+
 static int spi_bma150_open(struct inode *inode, struct file *file)
 {
 	return nonseekable_open(inode, file);
@@ -273,6 +378,9 @@ static int spi_bma150_open(struct inode *inode, struct file *file)
 
 static int spi_bma150_release(struct inode *inode, struct file *file)
 {
+	struct bma150_batch off = { 0, 0 };
+
+	spi_bma150_batch_start(&off);
 	return 0;
 }
 
@@ -287,6 +395,7 @@ static int spi_bma150_ioctl(struct inode *inode, struct file *file, unsigned int
 	int ret = -1;
 	short buf[8], temp;
 	int kbuf = 0;
+	struct bma150_batch batch;
 
 	DIF("%s: cmd = 0x%x\n", __func__, cmd);
 
@@ -307,6 +416,10 @@ static int spi_bma150_ioctl(struct inode *inode, struct file *file, unsigned int
 		if (copy_from_user(&kbuf, argp, sizeof(kbuf)))
 			return -EFAULT;
 		break;
+	case BMA_IOCTL_SET_BATCH:
+		if (copy_from_user(&batch, argp, sizeof(batch)))
+			return -EFAULT;
+		break;
 	default:
 		break;
 	}
@@ -382,6 +495,9 @@ static int spi_bma150_ioctl(struct inode *inode, struct file *file, unsigned int
 	case BMA_IOCTL_SET_UPDATE_USER_CALI_DATA:
 			update_user_calibrate_data = rwbuf[0];
 		break;
+	case BMA_IOCTL_SET_BATCH:
+		spi_bma150_batch_start(&batch);
+		break;
 
 	default:
 		return -ENOTTY;
@@ -428,6 +544,8 @@ static struct file_operations spi_bma_fops = {
 	.owner = THIS_MODULE,
 	.open = spi_bma150_open,
 	.release = spi_bma150_release,
+	.read = spi_bma150_read,
+	.poll = spi_bma150_poll,
 	.ioctl = spi_bma150_ioctl,
 };
 
@@ -469,6 +587,20 @@ static void bma150_early_resume(struct early_suspend *handler)
 
 #else /* EARLY_SUSPEND_BMA */
 
+/* The microP cannot be read once interrupts are off */
+static int bma150_prepare_suspend(struct device *device)
+{
+	cancel_delayed_work_sync(&batch_work);
+	return 0;
+}
+
+static int bma150_complete_resume(struct device *device)
+{
+	if (batch_cfg.interval_ms)
+		schedule_delayed_work(&batch_work, 0);
+	return 0;
+}
+
 static int bma150_suspend(struct device *device)
 {
 	int ret = 0;
@@ -699,6 +831,7 @@ static int spi_gsensor_initial(void)
 
 	mutex_init(&gsensor_RW_mutex);
 	mutex_init(&gsensor_set_mode_mutex);
+	mutex_init(&batch_mutex);
 
 
 	ret = spi_microp_enable(1);
@@ -764,6 +897,8 @@ static int spi_bma150_remove(struct platform_device *pdev)
 
 #ifndef EARLY_SUSPEND_BMA
 static struct dev_pm_ops bma150_pm_ops = {
+	.suspend = bma150_prepare_suspend,
+	.resume = bma150_complete_resume,
 	.suspend_noirq = bma150_suspend,
 	.resume_noirq = bma150_resume,
 };
@@ -775,6 +910,7 @@ static struct platform_driver spi_bma150_driver = {
 	.driver		= {
 		.name		= BMA150_G_SENSOR_NAME,
 		.owner		= THIS_MODULE,
+		.async_probe	= true,
 #ifndef EARLY_SUSPEND_BMA
 		.pm 		= &bma150_pm_ops
 #endif
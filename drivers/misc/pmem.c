@@ -24,6 +24,7 @@
 #include <linux/android_pmem.h>
 #include <linux/mempolicy.h>
 #include <linux/kobject.h>
+#include <linux/math64.h>
 #ifdef CONFIG_MEMORY_HOTPLUG
 #include <linux/memory.h>
 #include <linux/memory_hotplug.h>
@@ -33,6 +34,10 @@
 #include <asm/cacheflush.h>
 #include <asm/sizes.h>
 #include <linux/pm_runtime.h>
+#ifdef CONFIG_CMA
+#include <linux/workqueue.h>
+#include <linux/pageblock-flags.h>
+#endif
 
 #define PMEM_MAX_USER_SPACE_DEVICES (10)
 #define PMEM_MAX_KERNEL_SPACE_DEVICES (2)
@@ -40,6 +45,8 @@
 	(PMEM_MAX_USER_SPACE_DEVICES + PMEM_MAX_KERNEL_SPACE_DEVICES)
 
 #define PMEM_MAX_ORDER (128)
+/* orders a buddy block can actually have, num_entries is 32 bit */
+#define PMEM_BUDDY_NR_ORDERS (32)
 #define PMEM_MIN_ALLOC PAGE_SIZE
 
 #define PMEM_INITIAL_NUM_BITMAP_ALLOCATIONS (64)
@@ -95,6 +102,8 @@ struct pmem_data {
 	struct list_head region_list;
 	/* a linked list of data so we can access them for debugging */
 	struct list_head list;
+	/* PMEM_CACHE_POLICY_* of the user mapping */
+	unsigned int cache_policy;
 #if PMEM_DEBUG
 	int ref;
 #endif
@@ -103,6 +112,9 @@ struct pmem_data {
 struct pmem_bits {
 	unsigned allocated:1;		/* 1 if allocated, 0 if free */
 	unsigned order:7;		/* size of the region in pmem space */
+	/* free list of this order, only valid for free block heads */
+	int next;
+	int prev;
 };
 
 struct pmem_region_node {
@@ -202,6 +214,9 @@ struct pmem_info {
 			 */
 
 			struct pmem_bits *buddy_bitmap;
+			/* first free block of each order, -1 if none */
+			int free_list[PMEM_BUDDY_NR_ORDERS];
+			unsigned int nr_free[PMEM_BUDDY_NR_ORDERS];
 		} buddy_bestfit;
 
 		struct {
@@ -237,6 +252,25 @@ struct pmem_info {
 
 	long (*ioctl)(struct file *, unsigned int, unsigned long);
 	int (*release)(struct inode *, struct file *);
+
+#ifdef CONFIG_CMA
+	/* movable regions are lent to the page allocator while idle */
+	struct {
+		/* pageblock aligned part of the region that is lent */
+		unsigned long start_pfn;
+		unsigned long nr_pages;
+		/* set while the page allocator owns the pages */
+		int lent;
+		/* live allocations, protected by arena_mutex */
+		int allocs;
+		struct delayed_work lend_work;
+		/* the allocator's own allocate and free */
+		int (*allocate)(const int,
+				const unsigned long,
+				const unsigned int);
+		int (*free)(int, int);
+	} movable;
+#endif
 };
 #define to_pmem_info_id(a) (container_of(a, struct pmem_info, kobj)->id)
 
@@ -478,9 +512,50 @@ static ssize_t show_pmem_buddy_bitmap_dump(int id, char *buf)
 }
 RO_PMEM_ATTR(buddy_bitmap_dump);
 
+static ssize_t show_pmem_free_blocks(int id, char *buf)
+{
+	int ret, order;
+
+	mutex_lock(&pmem[id].arena_mutex);
+	ret = scnprintf(buf, PAGE_SIZE, "order\tlength\tfree blocks\n");
+
+	for (order = 0; order < PMEM_BUDDY_NR_ORDERS; order++)
+		if (pmem[id].allocator.buddy_bestfit.nr_free[order])
+			ret += scnprintf(buf + ret, PAGE_SIZE - ret,
+				"%d\t%lu\t%u\n", order,
+				(1UL << order) * pmem[id].quantum,
+				pmem[id].allocator.buddy_bestfit.nr_free[order]);
+
+	mutex_unlock(&pmem[id].arena_mutex);
+	return ret;
+}
+RO_PMEM_ATTR(free_blocks);
+
+/*
+ * How badly the free space is split up: the share of it that is not in
+ * the largest free block, i.e. 0 when all free space is contiguous.
+ */
+static ssize_t show_pmem_fragmentation(int id, char *buf)
+{
+	struct pmem_freespace fs;
+	unsigned long pct = 0;
+
+	mutex_lock(&pmem[id].arena_mutex);
+	pmem[id].free_space(id, &fs);
+	mutex_unlock(&pmem[id].arena_mutex);
+
+	if (fs.total)
+		pct = 100 - div_u64((u64)fs.largest * 100, fs.total);
+
+	return scnprintf(buf, PAGE_SIZE, "free %lu largest %lu "
+		"fragmentation %lu%%\n", fs.total, fs.largest, pct);
+}
+RO_PMEM_ATTR(fragmentation);
+
 #define PMEM_BITMAP_BUDDY_BESTFIT_COMMON_SYSFS_ATTRS \
 	&pmem_attr_quantum_size.attr, \
-	&pmem_attr_total_entries.attr
+	&pmem_attr_total_entries.attr, \
+	&pmem_attr_fragmentation.attr
 
 static struct attribute *pmem_buddy_bestfit_attrs[] = {
 	PMEM_COMMON_SYSFS_ATTRS,
@@ -488,6 +563,7 @@ static struct attribute *pmem_buddy_bestfit_attrs[] = {
 	PMEM_BITMAP_BUDDY_BESTFIT_COMMON_SYSFS_ATTRS,
 
 	&pmem_attr_buddy_bitmap_dump.attr,
+	&pmem_attr_free_blocks.attr,
 
 	NULL
 };
@@ -634,6 +710,40 @@ static int pmem_free_space_all_or_nothing(int id,
 }
 
 
+/*
+ * Free blocks of each order are kept on a doubly linked list threaded
+ * through the buddy bitmap by index, so that allocation does not have to
+ * walk the whole region and a buddy can be unlinked when it is merged.
+ */
+static void pmem_buddy_list_add(int id, int index)
+{
+	struct pmem_bits *bits = pmem[id].allocator.buddy_bestfit.buddy_bitmap;
+	int order = bits[index].order;
+	int head = pmem[id].allocator.buddy_bestfit.free_list[order];
+
+	bits[index].prev = -1;
+	bits[index].next = head;
+	if (head >= 0)
+		bits[head].prev = index;
+	pmem[id].allocator.buddy_bestfit.free_list[order] = index;
+	pmem[id].allocator.buddy_bestfit.nr_free[order]++;
+}
+
+static void pmem_buddy_list_del(int id, int index)
+{
+	struct pmem_bits *bits = pmem[id].allocator.buddy_bestfit.buddy_bitmap;
+	int order = bits[index].order;
+
+	if (bits[index].prev >= 0)
+		bits[bits[index].prev].next = bits[index].next;
+	else
+		pmem[id].allocator.buddy_bestfit.free_list[order] =
+			bits[index].next;
+	if (bits[index].next >= 0)
+		bits[bits[index].next].prev = bits[index].prev;
+	pmem[id].allocator.buddy_bestfit.nr_free[order]--;
+}
+
 static int pmem_free_buddy_bestfit(int id, int index)
 {
 	/* caller should hold the lock on arena_mutex! */
@@ -649,10 +759,11 @@ static int pmem_free_buddy_bestfit(int id, int index)
 	 */
 	do {
 		int buddy = PMEM_BUDDY_INDEX(id, curr);
-		if (buddy < pmem[id].num_entries &&
+		if (buddy >= 0 && buddy < pmem[id].num_entries &&
 		    PMEM_IS_FREE_BUDDY(id, buddy) &&
 		    PMEM_BUDDY_ORDER(id, buddy) ==
 				PMEM_BUDDY_ORDER(id, curr)) {
+			pmem_buddy_list_del(id, buddy);
 			PMEM_BUDDY_ORDER(id, buddy)++;
 			PMEM_BUDDY_ORDER(id, curr)++;
 			curr = min(buddy, curr);
@@ -661,6 +772,8 @@ static int pmem_free_buddy_bestfit(int id, int index)
 		}
 	} while (curr < pmem[id].num_entries);
 
+	pmem_buddy_list_add(id, curr);
+
 	return 0;
 }
 
@@ -669,19 +782,18 @@ static int pmem_free_space_buddy_bestfit(int id,
 		struct pmem_freespace *fs)
 {
 	/* caller should hold the lock on arena_mutex! */
-	int curr;
+	int order;
 	unsigned long size;
 	fs->total = 0;
 	fs->largest = 0;
 
-	for (curr = 0; curr < pmem[id].num_entries;
-	     curr = PMEM_BUDDY_NEXT_INDEX(id, curr)) {
-		if (PMEM_IS_FREE_BUDDY(id, curr)) {
-			size = PMEM_BUDDY_LEN(id, curr);
-			if (size > fs->largest)
-				fs->largest = size;
-			fs->total += size;
-		}
+	for (order = 0; order < PMEM_BUDDY_NR_ORDERS; order++) {
+		if (!pmem[id].allocator.buddy_bestfit.nr_free[order])
+			continue;
+		size = (1UL << order) * pmem[id].quantum;
+		fs->largest = size;
+		fs->total += size *
+			pmem[id].allocator.buddy_bestfit.nr_free[order];
 	}
 	return 0;
 }
@@ -783,47 +895,23 @@ static int pmem_free_system(int id, int index)
 
 static int pmem_free_space_bitmap(int id, struct pmem_freespace *fs)
 {
-	int i, j;
-	int max_allocs = pmem[id].allocator.bitmap.bitmap_allocs;
-	int alloc_start = 0;
-	int next_alloc;
-	unsigned long size = 0;
+	/* caller should hold the lock on arena_mutex! */
+	unsigned long *bitp = (unsigned long *)pmem[id].allocator.bitmap.bitmap;
+	unsigned long start, end, size;
 
 	fs->total = 0;
 	fs->largest = 0;
 
-	for (i = 0; i < max_allocs; i++) {
-
-		int alloc_quanta = 0;
-		int alloc_idx = 0;
-		next_alloc = pmem[id].num_entries;
-
-		/* Look for the lowest bit where next allocation starts */
-		for (j = 0; j < max_allocs; j++) {
-			const int curr_alloc = pmem[id].allocator.
-						bitmap.bitm_alloc[j].bit;
-			if (curr_alloc != -1) {
-				if (alloc_start == curr_alloc)
-					alloc_idx = j;
-				if (alloc_start >= curr_alloc)
-					continue;
-				if (curr_alloc < next_alloc)
-					next_alloc = curr_alloc;
-			}
-		}
-		alloc_quanta = pmem[id].allocator.bitmap.
-				bitm_alloc[alloc_idx].quanta;
-		size = (next_alloc - (alloc_start + alloc_quanta)) *
-				pmem[id].quantum;
+	/* Walk the runs of free quanta, one word at a time */
+	for (start = find_first_zero_bit(bitp, pmem[id].num_entries);
+	     start < pmem[id].num_entries;
+	     start = find_next_zero_bit(bitp, pmem[id].num_entries, end)) {
+		end = find_next_bit(bitp, pmem[id].num_entries, start);
+		size = (end - start) * pmem[id].quantum;
 
 		if (size > fs->largest)
 			fs->largest = size;
 		fs->total += size;
-
-		if (next_alloc == pmem[id].num_entries)
-			break;
-		else
-			alloc_start = next_alloc;
 	}
 
 	return 0;
@@ -929,6 +1017,7 @@ static int pmem_open(struct inode *inode, struct file *file)
 	}
 	data->flags = 0;
 	data->index = -1;
+	data->cache_policy = PMEM_CACHE_POLICY_DEFAULT;
 	data->task = NULL;
 	data->vma = NULL;
 	data->pid = 0;
@@ -984,31 +1073,19 @@ static int pmem_allocator_buddy_bestfit(const int id,
 
 	DLOG("buddy bestfit\n");
 	order = pmem_order(len, id);
-	if (order > PMEM_MAX_ORDER)
+	if (order >= PMEM_BUDDY_NR_ORDERS)
 		goto out;
 
 	DLOG("order %lx\n", order);
 
-	/* Look through the bitmap.
-	 * 	If a free slot of the correct order is found, use it.
-	 * 	Otherwise, use the best fit (smallest with size > order) slot.
+	/* Take a free block of the correct order if there is one.
+	 * 	Otherwise, use the best fit (smallest with size > order) block.
 	 */
-	for (curr = 0;
-	     curr < pmem[id].num_entries;
-	     curr = PMEM_BUDDY_NEXT_INDEX(id, curr))
-		if (PMEM_IS_FREE_BUDDY(id, curr)) {
-			if (PMEM_BUDDY_ORDER(id, curr) ==
-					(unsigned char)order) {
-				/* set the not free bit and clear others */
-				best_fit = curr;
-				break;
-			}
-			if (PMEM_BUDDY_ORDER(id, curr) >
-					(unsigned char)order &&
-			    (best_fit < 0 ||
-			     PMEM_BUDDY_ORDER(id, curr) <
-					PMEM_BUDDY_ORDER(id, best_fit)))
-				best_fit = curr;
+	for (curr = order; curr < PMEM_BUDDY_NR_ORDERS; curr++)
+		if (pmem[id].allocator.buddy_bestfit.free_list[curr] >= 0) {
+			best_fit =
+				pmem[id].allocator.buddy_bestfit.free_list[curr];
+			break;
 		}
 
 	/* if best_fit < 0, there are no suitable slots; return an error */
@@ -1020,8 +1097,10 @@ static int pmem_allocator_buddy_bestfit(const int id,
 		goto out;
 	}
 
+	pmem_buddy_list_del(id, best_fit);
+
 	/* now partition the best fit:
-	 * 	split the slot into 2 buddies of order - 1
+	 * 	split the slot into 2 buddies of order - 1, freeing the upper
 	 * 	repeat until the slot is of the correct order
 	 */
 	while (PMEM_BUDDY_ORDER(id, best_fit) > (unsigned char)order) {
@@ -1029,6 +1108,9 @@ static int pmem_allocator_buddy_bestfit(const int id,
 		PMEM_BUDDY_ORDER(id, best_fit) -= 1;
 		buddy = PMEM_BUDDY_INDEX(id, best_fit);
 		PMEM_BUDDY_ORDER(id, buddy) = PMEM_BUDDY_ORDER(id, best_fit);
+		pmem[id].allocator.buddy_bestfit.buddy_bitmap[buddy].allocated =
+			0;
+		pmem_buddy_list_add(id, buddy);
 	}
 	pmem[id].allocator.buddy_bestfit.buddy_bitmap[best_fit].allocated = 1;
 out:
@@ -1333,16 +1415,30 @@ static int pmem_allocator_system(const int id,
 	return (int)list;
 }
 
-static pgprot_t phys_mem_access_prot(struct file *file, pgprot_t vma_prot)
+/* is the user mapping of this file cacheable */
+static int pmem_file_cached(struct file *file)
 {
+	struct pmem_data *data = file->private_data;
 	int id = get_id(file);
+
+	switch (data->cache_policy) {
+	case PMEM_CACHE_POLICY_UNCACHED:
+		return 0;
+	case PMEM_CACHE_POLICY_CACHED:
+		return 1;
+	}
+	return pmem[id].cached && !(file->f_flags & O_SYNC);
+}
+
+static pgprot_t phys_mem_access_prot(struct file *file, pgprot_t vma_prot)
+{
 #ifdef pgprot_writecombine
-	if (pmem[id].cached == 0 || file->f_flags & O_SYNC)
+	if (!pmem_file_cached(file))
 		/* on ARMv6 and ARMv7 this expands to Normal Noncached */
 		return pgprot_writecombine(vma_prot);
 #endif
 #ifdef pgprot_ext_buffered
-	else if (pmem[id].buffered)
+	if (pmem[get_id(file)].buffered)
 		return pgprot_ext_buffered(vma_prot);
 #endif
 	return vma_prot;
@@ -1832,15 +1928,15 @@ void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 	void *vaddr;
 	struct pmem_region_node *region_node;
 	struct list_head *elt;
-	void *flush_start, *flush_end;
+	unsigned long alloc_len;
 #ifdef CONFIG_OUTER_CACHE
-	unsigned long phy_start, phy_end;
+	unsigned long phy_start;
 #endif
 	if (!is_pmem_file(file))
 		return;
 
 	id = get_id(file);
-	if (!pmem[id].cached)
+	if (!pmem_file_cached(file))
 		return;
 
 	/* is_pmem_file fails if !file */
@@ -1853,53 +1949,41 @@ void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 	vaddr = pmem_start_vaddr(id, data);
 
 	if (pmem[id].allocator_type == PMEM_ALLOCATORTYPE_SYSTEM) {
-		dmac_flush_range(vaddr,
-			(void *)((unsigned long)vaddr +
-				 ((struct alloc_list *)(data->index))->size));
+		alloc_len = ((struct alloc_list *)(data->index))->size;
 #ifdef CONFIG_OUTER_CACHE
 		phy_start = pmem_start_addr_system(id, data);
-
-		phy_end = phy_start +
-			((struct alloc_list *)(data->index))->size;
-
-		outer_flush_range(phy_start, phy_end);
 #endif
-		goto end;
-	}
-	/* if this isn't a submmapped file, flush the whole thing */
-	if (unlikely(!(data->flags & PMEM_FLAGS_CONNECTED))) {
-		dmac_flush_range(vaddr, vaddr + pmem[id].len(id, data));
+	} else {
+		alloc_len = pmem[id].len(id, data);
 #ifdef CONFIG_OUTER_CACHE
 		phy_start = (unsigned long)vaddr -
 				(unsigned long)pmem[id].vbase + pmem[id].base;
-
-		phy_end  =  phy_start + pmem[id].len(id, data);
-
-		outer_flush_range(phy_start, phy_end);
 #endif
-		goto end;
 	}
-	/* otherwise, flush the region of the file we are drawing */
-	list_for_each(elt, &data->region_list) {
-		region_node = list_entry(elt, struct pmem_region_node, list);
-		if ((offset >= region_node->region.offset) &&
-		    ((offset + len) <= (region_node->region.offset +
-			region_node->region.len))) {
-			flush_start = vaddr + region_node->region.offset;
-			flush_end = flush_start + region_node->region.len;
-			dmac_flush_range(flush_start, flush_end);
-#ifdef CONFIG_OUTER_CACHE
 
-			phy_start = (unsigned long)flush_start -
-				(unsigned long)pmem[id].vbase + pmem[id].base;
+	/* a submmapped file may only flush within one of its regions */
+	if (data->flags & PMEM_FLAGS_CONNECTED) {
+		list_for_each(elt, &data->region_list) {
+			region_node = list_entry(elt, struct pmem_region_node,
+						 list);
+			if ((offset >= region_node->region.offset) &&
+			    ((offset + len) <= (region_node->region.offset +
+				region_node->region.len)))
+				break;
+		}
+		if (elt == &data->region_list)
+			goto end;
+	}
 
-			phy_end  =  phy_start + region_node->region.len;
+	/* flush just the span the caller touched */
+	if (offset >= alloc_len)
+		goto end;
+	len = min(len, alloc_len - offset);
 
-			outer_flush_range(phy_start, phy_end);
+	dmac_flush_range(vaddr + offset, vaddr + offset + len);
+#ifdef CONFIG_OUTER_CACHE
+	outer_flush_range(phy_start + offset, phy_start + offset + len);
 #endif
-			break;
-		}
-	}
 end:
 	up_read(&data->sem);
 }
@@ -1926,7 +2010,7 @@ int pmem_cache_maint(struct file *file, unsigned int cmd,
 	data = file->private_data;
 	id = get_id(file);
 
-	if (!pmem[id].cached)
+	if (!pmem_file_cached(file))
 		return 0;
 
 	offset = pmem_addr->offset;
@@ -1944,8 +2028,14 @@ int pmem_cache_maint(struct file *file, unsigned int cmd,
 	if (offset + length > pmem_len)
 		return -EINVAL;
 
-	vaddr = pmem_addr->vaddr;
-	paddr = pmem_start_addr + offset;
+	/* whole cache lines, an invalidate must not drop the neighbours'
+	 * dirty data in a line it only partly covers */
+	vaddr = pmem_addr->vaddr & ~(L1_CACHE_BYTES - 1);
+	paddr = (pmem_start_addr + offset) & ~(L1_CACHE_BYTES - 1);
+	if (cmd == PMEM_INV_CACHES &&
+	    ((pmem_addr->vaddr | length) & (L1_CACHE_BYTES - 1)))
+		cmd = PMEM_CLEAN_INV_CACHES;
+	length = ALIGN(length + (pmem_addr->vaddr - vaddr), L1_CACHE_BYTES);
 
 	DLOG("pmem cache maint on dev %s(id: %d)"
 		"(vaddr %lx paddr %lx len %lu bytes)\n",
@@ -2599,6 +2689,23 @@ static long pmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case PMEM_CONNECT:
 		DLOG("connect\n");
 		return pmem_connect(arg, file);
+	case PMEM_SET_CACHE_POLICY:
+		{
+			int ret = 0;
+
+			if (arg > PMEM_CACHE_POLICY_CACHED)
+				return -EINVAL;
+
+			down_write(&data->sem);
+			/* the mapping is already set up */
+			if (data->flags & (PMEM_FLAGS_MASTERMAP |
+					PMEM_FLAGS_SUBMAP))
+				ret = -EBUSY;
+			else
+				data->cache_policy = arg;
+			up_write(&data->sem);
+			return ret;
+		}
 	case PMEM_CLEAN_INV_CACHES:
 	case PMEM_CLEAN_CACHES:
 	case PMEM_INV_CACHES:
@@ -2801,6 +2908,143 @@ static int pmem_memory_callback(struct notifier_block *self,
 }
 #endif
 
+#ifdef CONFIG_CMA
+/* how long a movable region stays idle before it is lent out again */
+#define PMEM_LEND_DELAY		(10 * HZ)
+
+/* caller should hold the lock on arena_mutex! */
+static int pmem_reclaim_movable(int id)
+{
+	unsigned long start = pmem[id].movable.start_pfn;
+	unsigned long nr = pmem[id].movable.nr_pages;
+	void *vaddr;
+	int ret;
+
+	ret = alloc_contig_range(start, start + nr);
+	if (ret) {
+		pr_err("pmem: %s: unable to take back %lu lent pages (%d)\n",
+			pmem[id].name, nr, ret);
+		return ret;
+	}
+	pmem[id].movable.lent = 0;
+
+	/* don't hand the page allocator's leftovers to pmem clients, and
+	 * don't leave dirty lines in the lowmem alias */
+	vaddr = page_address(pfn_to_page(start));
+	memset(vaddr, 0, nr << PAGE_SHIFT);
+	dmac_flush_range(vaddr, vaddr + (nr << PAGE_SHIFT));
+	outer_flush_range(start << PAGE_SHIFT, (start + nr) << PAGE_SHIFT);
+
+	DLOG("took back %lu pages of %s\n", nr, pmem[id].name);
+	return 0;
+}
+
+static void pmem_lend_work(struct work_struct *work)
+{
+	struct pmem_info *info = container_of(to_delayed_work(work),
+			struct pmem_info, movable.lend_work);
+	unsigned long start = info->movable.start_pfn;
+	unsigned long nr = info->movable.nr_pages;
+	void *vaddr;
+
+	mutex_lock(&info->arena_mutex);
+	if (info->movable.allocs || info->movable.lent)
+		goto out;
+
+	/* nothing cached from the last pmem client may be written back
+	 * over the pages once someone else owns them */
+	vaddr = page_address(pfn_to_page(start));
+	dmac_flush_range(vaddr, vaddr + (nr << PAGE_SHIFT));
+	outer_flush_range(start << PAGE_SHIFT, (start + nr) << PAGE_SHIFT);
+
+	free_contig_range(start, nr);
+	info->movable.lent = 1;
+	DLOG("lent %lu pages of %s\n", nr, info->name);
+out:
+	mutex_unlock(&info->arena_mutex);
+}
+
+static int pmem_allocate_movable(const int id,
+		const unsigned long len,
+		const unsigned int align)
+{
+	/* caller should hold the lock on arena_mutex! */
+	int index;
+
+	if (pmem[id].movable.lent && pmem_reclaim_movable(id))
+		return -1;
+
+	index = pmem[id].movable.allocate(id, len, align);
+	if (index != -1)
+		pmem[id].movable.allocs++;
+	return index;
+}
+
+static int pmem_free_movable(int id, int index)
+{
+	/* caller should hold the lock on arena_mutex! */
+	int ret = pmem[id].movable.free(id, index);
+
+	if (!ret && !--pmem[id].movable.allocs)
+		schedule_delayed_work(&pmem[id].movable.lend_work,
+			PMEM_LEND_DELAY);
+	return ret;
+}
+
+/*
+ * Lend the pageblock aligned part of a movable region to the page
+ * allocator. The pages serve movable allocations until the first
+ * pmem allocation migrates them away.
+ */
+static void pmem_setup_movable(int id)
+{
+	unsigned long start = ALIGN(pmem[id].base >> PAGE_SHIFT,
+				pageblock_nr_pages);
+	unsigned long end = ((pmem[id].base + pmem[id].size) >> PAGE_SHIFT)
+				& ~(pageblock_nr_pages - 1);
+	unsigned long pfn;
+
+	if (start >= end) {
+		pr_warning("pmem: %s: region smaller than a pageblock, "
+			"not lending it\n", pmem[id].name);
+		return;
+	}
+
+	for (pfn = start; pfn < end; pfn++) {
+		struct page *page;
+
+		if (!pfn_valid(pfn))
+			break;
+		page = pfn_to_page(pfn);
+		if (!PageReserved(page) || PageHighMem(page))
+			break;
+	}
+	if (pfn < end) {
+		pr_err("pmem: %s: movable region must be reserved lowmem, "
+			"not lending it. Check your board file.\n",
+			pmem[id].name);
+		return;
+	}
+
+	pmem[id].movable.start_pfn = start;
+	pmem[id].movable.nr_pages = end - start;
+	pmem[id].movable.allocs = 0;
+	INIT_DELAYED_WORK(&pmem[id].movable.lend_work, pmem_lend_work);
+
+	pmem[id].movable.allocate = pmem[id].allocate;
+	pmem[id].movable.free = pmem[id].free;
+	pmem[id].allocate = pmem_allocate_movable;
+	pmem[id].free = pmem_free_movable;
+
+	for (pfn = start; pfn < end; pfn += pageblock_nr_pages)
+		init_cma_reserved_pageblock(pfn_to_page(pfn));
+	pmem[id].movable.lent = 1;
+
+	pr_info("pmem: %s: lending %lu KB to the page allocator\n",
+		pmem[id].name, (end - start) << (PAGE_SHIFT - 10));
+}
+#endif
+
 int pmem_setup(struct android_pmem_platform_data *pdata,
 	       long (*ioctl)(struct file *, unsigned int, unsigned long),
 	       int (*release)(struct inode *, struct file *))
@@ -2931,9 +3175,15 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 		memset(pmem[id].allocator.buddy_bestfit.buddy_bitmap, 0,
 			sizeof(struct pmem_bits) * pmem[id].num_entries);
 
+		for (i = 0; i < PMEM_BUDDY_NR_ORDERS; i++) {
+			pmem[id].allocator.buddy_bestfit.free_list[i] = -1;
+			pmem[id].allocator.buddy_bestfit.nr_free[i] = 0;
+		}
+
 		for (i = sizeof(pmem[id].num_entries) * 8 - 1; i >= 0; i--)
 			if ((pmem[id].num_entries) &  1<<i) {
 				PMEM_BUDDY_ORDER(id, index) = i;
+				pmem_buddy_list_add(id, index);
 				index = PMEM_BUDDY_NEXT_INDEX(id, index);
 			}
 		pmem[id].allocate = pmem_allocator_buddy_bestfit;
@@ -3072,6 +3322,12 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 
 	pmem[id].garbage_pfn = page_to_pfn(alloc_page(GFP_KERNEL));
 
+#ifdef CONFIG_CMA
+	if (pdata->movable && !is_kernel_memtype &&
+		(pmem[id].allocator_type != PMEM_ALLOCATORTYPE_SYSTEM))
+		pmem_setup_movable(id);
+#endif
+
 	return 0;
 
 error_cant_remap:
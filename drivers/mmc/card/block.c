@@ -35,6 +35,7 @@
 #include <linux/delay.h>
 
 #include <linux/mmc/card.h>
+#include <linux/mmc/core.h>
 #include <linux/mmc/host.h>
 #include <linux/mmc/mmc.h>
 #include <linux/mmc/sd.h>
@@ -291,85 +292,295 @@ static void remove_card(struct mmc_host *host)
 	mmc_schedule_card_removal_work(&host->remove, 0);
 }
 
-static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
+/* The radio partitions are never written, so never erase them either */
+static int mmc_blk_radio_range(struct mmc_card *card, unsigned int from,
+			       unsigned int nr)
+{
+#if defined(CONFIG_ARCH_MSM7X30)
+	if (board_emmc_boot() && mmc_card_mmc(card)) {
+		if (from < 131073)
+			return 1;
+#if defined(CONFIG_ARCH_MSM7230)
+		if (from + nr > 143362 && from < 163328)
+			return 1;
+#endif
+	}
+#endif
+	return 0;
+}
+
+static int mmc_blk_issue_discard_rq(struct mmc_queue *mq,
+				    struct request *req)
 {
 	struct mmc_blk_data *md = mq->data;
 	struct mmc_card *card = md->queue.card;
+	unsigned int from, nr, arg;
+	int err;
+
+	from = blk_rq_pos(req);
+	nr = blk_rq_sectors(req);
+
+	if (mmc_blk_radio_range(card, from, nr)) {
+		pr_err("ERROR! Attemp to discard radio partition start %u "
+		       "size %u\n", from, nr);
+		err = -EIO;
+	} else {
+		arg = mmc_can_trim(card) ? MMC_TRIM_ARG : MMC_ERASE_ARG;
+		err = mmc_erase(card, from, nr, arg);
+	}
+
+	spin_lock_irq(&md->lock);
+	__blk_end_request(req, err, blk_rq_bytes(req));
+	spin_unlock_irq(&md->lock);
+
+	return err ? 0 : 1;
+}
+
+static int mmc_blk_issue_flush_rq(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	int err;
+
+	err = mmc_flush_cache(md->queue.card);
+
+	spin_lock_irq(&md->lock);
+	__blk_end_request_all(req, err);
+	spin_unlock_irq(&md->lock);
+
+	return err ? 0 : 1;
+}
+
+static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *req);
+
+/*
+ * Packed writes (eMMC 4.5). Writes queued behind the current one are
+ * sent with it in a single CMD25, after a header block that gives the
+ * address and length of each, so the card takes them as one transfer
+ * instead of paying the command and programming overhead for each.
+ */
+
+/* Entries that fit in the header block, the first 8 bytes are its own */
+#define MMC_BLK_PACKED_MAX	(512 / 8 - 1)
+
+/* Status bits that mean some of a packed write did not make it */
+#define MMC_BLK_PACKED_ERRORS	(R1_OUT_OF_RANGE | R1_ADDRESS_ERROR | \
+				 R1_BLOCK_LEN_ERROR | R1_WP_VIOLATION | \
+				 R1_CARD_ECC_FAILED | R1_CC_ERROR | R1_ERROR)
+
+static int mmc_blk_packable(struct mmc_card *card, struct request *req)
+{
+	/* radio partition writes are caught by the single request path */
+	return blk_fs_request(req) && rq_data_dir(req) == WRITE &&
+	       !blk_discard_rq(req) && !blk_barrier_rq(req) &&
+	       !blk_fua_rq(req) &&
+	       !mmc_blk_radio_range(card, blk_rq_pos(req),
+				    blk_rq_sectors(req));
+}
+
+/*
+ * Take the writes that can go out with req off the queue and onto
+ * mq->packed_list, req first. Returns the number of writes in the
+ * list, or 0 if req is to be issued on its own.
+ */
+static unsigned int mmc_blk_prep_packed_list(struct mmc_queue *mq,
+					     struct request *req)
+{
+	struct request_queue *q = mq->queue;
+	struct mmc_card *card = mq->card;
+	struct mmc_host *host = card->host;
+	struct request *next;
+	unsigned int max_nr, max_blocks, blocks, segs;
+
+	if (!mq->packed_hdr || !mmc_blk_packable(card, req))
+		return 0;
+
+	max_nr = min_t(unsigned int, card->ext_csd.max_packed_writes,
+		       MMC_BLK_PACKED_MAX);
+	/* the CMD23 block count is 16 bits */
+	max_blocks = min_t(unsigned int, host->max_blk_count, 0xffff);
+
+	/* the header takes a block and a segment of its own */
+	blocks = blk_rq_sectors(req) + 1;
+	segs = req->nr_phys_segments + 1;
+	if (blocks > max_blocks || segs > host->max_phys_segs)
+		return 0;
+
+	mq->packed_nr = 1;
+	list_add_tail(&req->queuelist, &mq->packed_list);
+
+	spin_lock_irq(q->queue_lock);
+	while (mq->packed_nr < max_nr) {
+		next = blk_queue_plugged(q) ? NULL : blk_peek_request(q);
+		if (!next || !mmc_blk_packable(card, next))
+			break;
+		if (blocks + blk_rq_sectors(next) > max_blocks ||
+		    segs + next->nr_phys_segments > host->max_phys_segs)
+			break;
+
+		blk_start_request(next);
+		list_add_tail(&next->queuelist, &mq->packed_list);
+		blocks += blk_rq_sectors(next);
+		segs += next->nr_phys_segments;
+		mq->packed_nr++;
+	}
+	spin_unlock_irq(q->queue_lock);
+
+	if (mq->packed_nr == 1) {
+		list_del_init(&req->queuelist);
+		mq->packed_nr = 0;
+		return 0;
+	}
+
+	/* the request mapped ahead is now part of the pack */
+	mmc_queue_drop_prep(mq);
+
+	return mq->packed_nr;
+}
+
+static int mmc_blk_packed_write(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_card *card = mq->card;
 	struct mmc_blk_request brq;
-	int ret = 1, disable_multi = 0, card_no_ready = 0;
-	int err = 0;
-	int try_recovery = 1, do_reinit = 0, do_remove = 0;
+	struct mmc_command cmd;
+	struct request *prq;
+	u32 *hdr = mq->packed_hdr;
+	unsigned int blocks = 1, sg_len = 1, i = 1;
+	unsigned long timeout;
+	DECLARE_COMPLETION_ONSTACK(complete);
+	int err;
 
-#ifdef CONFIG_MMC_BLOCK_DEFERRED_RESUME
-	int retries = 3;
-	if (mmc_bus_needs_resume(card->host)) {
-		err = mmc_resume_bus(card->host);
-		if (err) {
-			if (mmc_card_sd(card))
-				remove_card(card->host);
-			spin_lock_irq(&md->lock);
-			__blk_end_request_all(req, -EIO);
-			spin_unlock_irq(&md->lock);
-			return 0;
-		}
-		mmc_blk_set_blksize(md, card);
+	memset(hdr, 0, 512);
+	hdr[0] = cpu_to_le32((mq->packed_nr << 16) |
+			     (MMC_PACKED_CMD_WR << 8) | MMC_PACKED_CMD_VER);
 
-		if (mmc_card_mmc(card)) {
-			struct mmc_command cmd;
+	sg_set_buf(&mq->sg[0], hdr, 512);
+	list_for_each_entry(prq, &mq->packed_list, queuelist) {
+		hdr[i * 2] = cpu_to_le32(blk_rq_sectors(prq));
+		hdr[i * 2 + 1] = cpu_to_le32(blk_rq_pos(prq));
+		i++;
+		blocks += blk_rq_sectors(prq);
 
-			unsigned long delay = jiffies + HZ;
-			int j = 0;
-			do {
-				int err;
-				cmd.opcode = MMC_SEND_STATUS;
-				cmd.arg = mq->card->rca << 16;
-				cmd.flags = MMC_RSP_R1 | MMC_CMD_AC;
+		/* blk_rq_map_sg() ends the list it maps, this one goes on */
+		mq->sg[sg_len - 1].page_link &= ~0x02;
+		sg_len += blk_rq_map_sg(mq->queue, prq, &mq->sg[sg_len]);
+	}
 
-				mmc_claim_host(mq->card->host);
-				err = mmc_wait_for_cmd(mq->card->host, &cmd, 5);
-				mmc_release_host(mq->card->host);
+	memset(&cmd, 0, sizeof(struct mmc_command));
+	cmd.opcode = MMC_SET_BLOCK_COUNT;
+	cmd.arg = MMC_CMD23_ARG_PACKED | blocks;
+	cmd.flags = MMC_RSP_R1 | MMC_CMD_AC;
+	err = mmc_wait_for_cmd(card->host, &cmd, 0);
+	if (err)
+		return err;
+
+	/* the block count is set, the transfer needs no stop command */
+	memset(&brq, 0, sizeof(struct mmc_blk_request));
+	brq.mrq.cmd = &brq.cmd;
+	brq.mrq.data = &brq.data;
+	brq.cmd.opcode = MMC_WRITE_MULTIPLE_BLOCK;
+	brq.cmd.arg = blk_rq_pos(req);
+	brq.cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+	brq.data.blksz = 512;
+	brq.data.blocks = blocks;
+	brq.data.flags = MMC_DATA_WRITE;
+	brq.data.sg = mq->sg;
+	brq.data.sg_len = sg_len;
+	mmc_set_data_timeout(&brq.data, card);
+
+	mmc_start_req(card->host, &brq.mrq, &complete);
+	wait_for_completion_io(&complete);
+
+	if (brq.cmd.error || brq.data.error) {
+		printk(KERN_ERR "%s: error %d/%d in packed write of %u "
+		       "requests\n", req->rq_disk->disk_name, brq.cmd.error,
+		       brq.data.error, mq->packed_nr);
+		return brq.cmd.error ? brq.cmd.error : brq.data.error;
+	}
 
-				if (err) {
-				printk(KERN_ERR "failed to get status(%d)!!\n"
-						, err);
-					msleep(5);
-					retries--;
-					continue;
-				}
-				if (time_after(jiffies, delay) && (fls(j) > 10)) {
-					if ((cmd.resp[0] & R1_READY_FOR_DATA) &&
-						(R1_CURRENT_STATE(cmd.resp[0]) == 4)) {
-						printk(KERN_ERR "Timeout but get card ready j = %d\n", j);
-						break;
-					}
-					card_no_ready++;
-					printk(KERN_ERR
-						"Failed to get card ready %d\n",
-						card_no_ready);
-					break;
-				}
-				j++;
-			} while (retries &&
-				(!(cmd.resp[0] & R1_READY_FOR_DATA) ||
-				(R1_CURRENT_STATE(cmd.resp[0]) == 7)));
-		}
+	/* wait for the card to program the lot */
+	timeout = jiffies + 10 * HZ;
+	do {
+		memset(&cmd, 0, sizeof(struct mmc_command));
+		cmd.opcode = MMC_SEND_STATUS;
+		cmd.arg = card->rca << 16;
+		cmd.flags = MMC_RSP_R1 | MMC_CMD_AC;
+		err = mmc_wait_for_cmd(card->host, &cmd, 5);
+		if (err)
+			return err;
+		if (time_after(jiffies, timeout))
+			return -ETIMEDOUT;
+	} while (!(cmd.resp[0] & R1_READY_FOR_DATA) ||
+		 R1_CURRENT_STATE(cmd.resp[0]) == 7);
+
+	if ((brq.cmd.resp[0] | cmd.resp[0]) & MMC_BLK_PACKED_ERRORS) {
+		printk(KERN_ERR "%s: packed write of %u requests failed, "
+		       "card status %#x\n", req->rq_disk->disk_name,
+		       mq->packed_nr, cmd.resp[0]);
+		return -EIO;
 	}
 
-	if (mmc_bus_fails_resume(card->host) || card_no_ready ||
-		!retries) {
+	return 0;
+}
+
+/*
+ * Issue the writes on mq->packed_list. If the packed write fails, each
+ * of them is written again on its own, which finds out which ones are
+ * good and retries or fails them as usual. Must be called with the
+ * host claimed.
+ */
+static int mmc_blk_issue_packed_rq(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct request *prq, *tmp;
+	int err, ret = 1;
+
+	err = mmc_blk_packed_write(mq, req);
+	if (!err) {
+		card->wr_pack_stats.packed_cmds++;
+		card->wr_pack_stats.packed_reqs += mq->packed_nr;
+	} else {
+		card->wr_pack_stats.fallbacks++;
+	}
+
+	list_for_each_entry_safe(prq, tmp, &mq->packed_list, queuelist) {
+		list_del_init(&prq->queuelist);
+		if (err) {
+			mq->req = prq;
+			if (!mmc_blk_issue_rw_rq(mq, prq))
+				ret = 0;
+			continue;
+		}
+
 		spin_lock_irq(&md->lock);
-		__blk_end_request_all(req, -EIO);
+		__blk_end_request(prq, 0, blk_rq_bytes(prq));
 		spin_unlock_irq(&md->lock);
-
-		return 0;
 	}
-#endif
+	mq->packed_nr = 0;
 
-	mmc_claim_host(card->host);
+	return ret;
+}
+
+/*
+ * Read or write one request, one host transfer at a time. Must be called
+ * with the host claimed.
+ */
+static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_blk_request brq;
+	int ret = 1, disable_multi = 0, card_no_ready = 0;
+	int err = 0;
+	int try_recovery = 1, do_reinit = 0, do_remove = 0;
+
+	if (rq_data_dir(req) == WRITE)
+		card->wr_pack_stats.single_reqs++;
 
 	do {
 		struct mmc_command cmd;
 		u32 readcmd, writecmd, status = 0;
+		DECLARE_COMPLETION_ONSTACK(complete);
 
 		memset(&brq, 0, sizeof(struct mmc_blk_request));
 		brq.mrq.cmd = &brq.cmd;
@@ -456,8 +667,11 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 
 		mmc_set_data_timeout(&brq.data, card);
 
+		/* mapped ahead while the previous request was running */
+		brq.data.sg_len = mmc_queue_take_prep(mq, &brq.data.host_cookie);
 		brq.data.sg = mq->sg;
-		brq.data.sg_len = mmc_queue_map_sg(mq);
+		if (!brq.data.sg_len)
+			brq.data.sg_len = mmc_queue_map_sg(mq);
 
 		/*
 		 * Adjust the sg list so it is the same size as the
@@ -480,7 +694,13 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 
 		mmc_queue_bounce_pre(mq);
 
-		mmc_wait_for_req(card->host, &brq.mrq);
+		mmc_start_req(card->host, &brq.mrq, &complete);
+		if (!disable_multi)
+			mmc_queue_prep_next(mq);
+		wait_for_completion_io(&complete);
+
+		if (brq.data.host_cookie)
+			mmc_post_req(card->host, &brq.mrq, brq.data.error);
 
 		mmc_queue_bounce_post(mq);
 
@@ -655,8 +875,6 @@ recovery:
 		spin_unlock_irq(&md->lock);
 	} while (ret);
 
-	mmc_release_host(card->host);
-
 	return 1;
 
  cmd_err:
@@ -683,8 +901,6 @@ recovery:
 		spin_unlock_irq(&md->lock);
 	}
 
-	mmc_release_host(card->host);
-
 	spin_lock_irq(&md->lock);
 	while (ret)
 		ret = __blk_end_request(req, -EIO, blk_rq_cur_bytes(req));
@@ -693,6 +909,96 @@ recovery:
 	return 0;
 }
 
+static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	int ret;
+
+#ifdef CONFIG_MMC_BLOCK_DEFERRED_RESUME
+	int card_no_ready = 0, err;
+	int retries = 3;
+	if (mmc_bus_needs_resume(card->host)) {
+		err = mmc_resume_bus(card->host);
+		if (err) {
+			if (mmc_card_sd(card))
+				remove_card(card->host);
+			mmc_queue_drop_prep(mq);
+			spin_lock_irq(&md->lock);
+			__blk_end_request_all(req, -EIO);
+			spin_unlock_irq(&md->lock);
+			return 0;
+		}
+		mmc_blk_set_blksize(md, card);
+
+		if (mmc_card_mmc(card)) {
+			struct mmc_command cmd;
+
+			unsigned long delay = jiffies + HZ;
+			int j = 0;
+			do {
+				int err;
+				cmd.opcode = MMC_SEND_STATUS;
+				cmd.arg = mq->card->rca << 16;
+				cmd.flags = MMC_RSP_R1 | MMC_CMD_AC;
+
+				mmc_claim_host(mq->card->host);
+				err = mmc_wait_for_cmd(mq->card->host, &cmd, 5);
+				mmc_release_host(mq->card->host);
+
+				if (err) {
+				printk(KERN_ERR "failed to get status(%d)!!\n"
+						, err);
+					msleep(5);
+					retries--;
+					continue;
+				}
+				if (time_after(jiffies, delay) && (fls(j) > 10)) {
+					if ((cmd.resp[0] & R1_READY_FOR_DATA) &&
+						(R1_CURRENT_STATE(cmd.resp[0]) == 4)) {
+						printk(KERN_ERR "Timeout but get card ready j = %d\n", j);
+						break;
+					}
+					card_no_ready++;
+					printk(KERN_ERR
+						"Failed to get card ready %d\n",
+						card_no_ready);
+					break;
+				}
+				j++;
+			} while (retries &&
+				(!(cmd.resp[0] & R1_READY_FOR_DATA) ||
+				(R1_CURRENT_STATE(cmd.resp[0]) == 7)));
+		}
+	}
+
+	if (mmc_bus_fails_resume(card->host) || card_no_ready ||
+		!retries) {
+		mmc_queue_drop_prep(mq);
+		spin_lock_irq(&md->lock);
+		__blk_end_request_all(req, -EIO);
+		spin_unlock_irq(&md->lock);
+
+		return 0;
+	}
+#endif
+
+	mmc_claim_host(card->host);
+
+	if (blk_discard_rq(req))
+		ret = mmc_blk_issue_discard_rq(mq, req);
+	else if (mmc_req_is_flush(req))
+		ret = mmc_blk_issue_flush_rq(mq, req);
+	else if (mmc_blk_prep_packed_list(mq, req))
+		ret = mmc_blk_issue_packed_rq(mq, req);
+	else
+		ret = mmc_blk_issue_rw_rq(mq, req);
+
+	mmc_release_host(card->host);
+
+	return ret;
+}
+
 
 static inline int mmc_blk_readonly(struct mmc_card *card)
 {
@@ -17,6 +17,7 @@
 #include <linux/scatterlist.h>
 #include <linux/delay.h>
 
+#include <linux/mmc/core.h>
 #include <linux/mmc/mmc.h>
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
@@ -26,6 +27,9 @@
 
 #define MMC_QUEUE_BOUNCESZ	65536
 
+/* Upper bound on the erase groups covered by one discard request */
+#define MMC_QUEUE_DISCARD_GROUPS	64
+
 #define MMC_QUEUE_SUSPENDED	(1 << 0)
 
 /*
@@ -34,9 +38,9 @@
 static int mmc_prep_request(struct request_queue *q, struct request *req)
 {
 	/*
-	 * We only like normal block requests.
+	 * We only like normal block requests, and cache flushes.
 	 */
-	if (!blk_fs_request(req)) {
+	if (!blk_fs_request(req) && !mmc_req_is_flush(req)) {
 		blk_dump_rq_flags(req, "MMC bad request");
 		return BLKPREP_KILL;
 	}
@@ -46,6 +50,12 @@ static int mmc_prep_request(struct request_queue *q, struct request *req)
 	return BLKPREP_OK;
 }
 
+static void mmc_prepare_flush(struct request_queue *q, struct request *req)
+{
+	req->cmd_type = REQ_TYPE_LINUX_BLOCK;
+	req->cmd[0] = REQ_LB_OP_FLUSH;
+}
+
 static int mmc_queue_thread(void *d)
 {
 	struct mmc_queue *mq = d;
@@ -68,6 +78,7 @@ static int mmc_queue_thread(void *d)
 		if (!req) {
 			if (kthread_should_stop()) {
 				set_current_state(TASK_RUNNING);
+				mmc_queue_drop_prep(mq);
 				break;
 			}
 			up(&mq->thread_sem);
@@ -171,11 +182,28 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 
 	mq->queue->queuedata = mq;
 	mq->req = NULL;
+	INIT_LIST_HEAD(&mq->packed_list);
 
 	blk_queue_prep_rq(mq->queue, mmc_prep_request);
-	blk_queue_ordered(mq->queue, QUEUE_ORDERED_DRAIN, NULL);
+	/* with the cache on, barriers need the data flushed around them */
+	if (card->ext_csd.cache_ctrl)
+		blk_queue_ordered(mq->queue, QUEUE_ORDERED_DRAIN_FLUSH,
+				  mmc_prepare_flush);
+	else
+		blk_queue_ordered(mq->queue, QUEUE_ORDERED_DRAIN, NULL);
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, mq->queue);
 
+	if (mmc_can_erase(card)) {
+		queue_flag_set_unlocked(QUEUE_FLAG_DISCARD, mq->queue);
+		/*
+		 * Keep each erase to a bounded number of whole erase
+		 * groups so that it does not hold the queue for long.
+		 */
+		blk_queue_max_discard_sectors(mq->queue,
+			card->erase_size * MMC_QUEUE_DISCARD_GROUPS);
+		mq->queue->limits.discard_granularity = card->erase_size << 9;
+	}
+
 #ifdef CONFIG_MMC_BLOCK_BOUNCE
 	if (host->max_hw_segs == 1) {
 		unsigned int bouncesz;
@@ -237,6 +265,25 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 			goto cleanup_queue;
 		}
 		sg_init_table(mq->sg, host->max_phys_segs);
+
+		/*
+		 * A second list lets the next request be mapped while the
+		 * current one is transferred, for hosts that can make use
+		 * of it. Not having one only costs that overlap.
+		 */
+		if (host->ops->pre_req) {
+			mq->prep_sg = kmalloc(sizeof(struct scatterlist) *
+				host->max_phys_segs, GFP_KERNEL);
+			if (mq->prep_sg)
+				sg_init_table(mq->prep_sg,
+					host->max_phys_segs);
+		}
+
+		/* packing needs the data of every write in one sg list */
+		if (mmc_card_mmc(card) && mmc_card_blockaddr(card) &&
+		    card->ext_csd.max_packed_writes > 1 &&
+		    (host->caps & MMC_CAP_PACKED_WR))
+			mq->packed_hdr = kmalloc(512, GFP_KERNEL);
 	}
 
 	init_MUTEX(&mq->thread_sem);
@@ -265,6 +312,10 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
  	if (mq->sg)
 		kfree(mq->sg);
 	mq->sg = NULL;
+	kfree(mq->prep_sg);
+	mq->prep_sg = NULL;
+	kfree(mq->packed_hdr);
+	mq->packed_hdr = NULL;
 	if (mq->bounce_buf)
 		kfree(mq->bounce_buf);
 	mq->bounce_buf = NULL;
@@ -296,6 +347,12 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	kfree(mq->sg);
 	mq->sg = NULL;
 
+	kfree(mq->prep_sg);
+	mq->prep_sg = NULL;
+
+	kfree(mq->packed_hdr);
+	mq->packed_hdr = NULL;
+
 	if (mq->bounce_buf)
 		kfree(mq->bounce_buf);
 	mq->bounce_buf = NULL;
@@ -416,3 +473,103 @@ void mmc_queue_bounce_post(struct mmc_queue *mq)
 	local_irq_restore(flags);
 }
 
+
+/*
+ * Map the request queued behind the current one and hand it to the host
+ * to set up its DMA while the current request is on the bus, so that
+ * the next transfer can be started as soon as this one completes.
+ * Called with the current request started and the host claimed.
+ */
+void mmc_queue_prep_next(struct mmc_queue *mq)
+{
+	struct request_queue *q = mq->queue;
+	struct mmc_host *host = mq->card->host;
+	struct mmc_data *data = &mq->prep_data;
+	struct mmc_request mrq;
+	struct request *req = NULL;
+
+	if (!mq->prep_sg || mq->prep_req)
+		return;
+
+	spin_lock_irq(q->queue_lock);
+	if (!blk_queue_plugged(q))
+		req = blk_peek_request(q);
+	/*
+	 * The issue path does not split requests this size, a peeked
+	 * request is on the dispatch list and will not grow any more.
+	 */
+	if (req && blk_fs_request(req) && !blk_discard_rq(req) &&
+	    blk_rq_sectors(req) <= host->max_blk_count) {
+		memset(data, 0, sizeof(struct mmc_data));
+		data->sg = mq->prep_sg;
+		data->sg_len = blk_rq_map_sg(q, req, mq->prep_sg);
+		mq->prep_req = req;
+		mq->prep_pos = blk_rq_pos(req);
+		mq->prep_sectors = blk_rq_sectors(req);
+	}
+	spin_unlock_irq(q->queue_lock);
+
+	if (!mq->prep_req)
+		return;
+
+	data->blksz = 512;
+	data->blocks = mq->prep_sectors;
+	if (rq_data_dir(mq->prep_req) == READ)
+		data->flags = MMC_DATA_READ;
+	else
+		data->flags = MMC_DATA_WRITE;
+
+	memset(&mrq, 0, sizeof(struct mmc_request));
+	mrq.data = data;
+	mmc_pre_req(host, &mrq);
+
+	/* nothing to gain if the host could not prepare it */
+	if (!data->host_cookie)
+		mq->prep_req = NULL;
+}
+
+/*
+ * If the current request is the one prepared by mmc_queue_prep_next()
+ * and has not changed since, switch to its sg list. Returns the sg
+ * length and the host cookie to issue it with, or 0 when the request
+ * has to be mapped as usual. A request prepared for another request
+ * is kept, it is still queued and will be issued later.
+ */
+unsigned int mmc_queue_take_prep(struct mmc_queue *mq, s32 *cookie)
+{
+	struct scatterlist *sg;
+
+	if (!mq->prep_req || mq->prep_req != mq->req)
+		return 0;
+
+	if (mq->prep_pos != blk_rq_pos(mq->req) ||
+	    mq->prep_sectors != blk_rq_sectors(mq->req)) {
+		mmc_queue_drop_prep(mq);
+		return 0;
+	}
+
+	sg = mq->sg;
+	mq->sg = mq->prep_sg;
+	mq->prep_sg = sg;
+	mq->prep_req = NULL;
+
+	*cookie = mq->prep_data.host_cookie;
+	return mq->prep_data.sg_len;
+}
+
+/*
+ * Release a prepared request that is not going to be issued with its
+ * prepared mapping.
+ */
+void mmc_queue_drop_prep(struct mmc_queue *mq)
+{
+	struct mmc_request mrq;
+
+	if (!mq->prep_req)
+		return;
+
+	memset(&mrq, 0, sizeof(struct mmc_request));
+	mrq.data = &mq->prep_data;
+	mmc_post_req(mq->card->host, &mrq, -ECANCELED);
+	mq->prep_req = NULL;
+}
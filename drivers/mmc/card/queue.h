@@ -1,6 +1,8 @@
 #ifndef MMC_QUEUE_H
 #define MMC_QUEUE_H
 
+#include <linux/blkdev.h>
+
 struct request;
 struct task_struct;
 
@@ -17,11 +19,26 @@ struct mmc_queue {
 	char			*bounce_buf;
 	struct scatterlist	*bounce_sg;
 	unsigned int		bounce_sg_len;
+	struct scatterlist	*prep_sg;	/* sg of the prepared request */
+	struct request		*prep_req;	/* next request, already mapped */
+	sector_t		prep_pos;
+	unsigned int		prep_sectors;
+	struct mmc_data		prep_data;
+	u32			*packed_hdr;	/* header block of packed writes */
+	struct list_head	packed_list;	/* writes packed with req */
+	unsigned int		packed_nr;
 #ifdef CONFIG_MMC_BLOCK_PARANOID_RESUME
 	int			check_status;
 #endif
 };
 
+/* Cache flushes come from the barrier sequence, see mmc_prepare_flush() */
+static inline int mmc_req_is_flush(struct request *req)
+{
+	return req->cmd_type == REQ_TYPE_LINUX_BLOCK &&
+	       req->cmd[0] == REQ_LB_OP_FLUSH;
+}
+
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *);
 extern void mmc_cleanup_queue(struct mmc_queue *);
 extern void mmc_queue_suspend(struct mmc_queue *);
@@ -31,6 +48,10 @@ extern unsigned int mmc_queue_map_sg(struct mmc_queue *);
 extern void mmc_queue_bounce_pre(struct mmc_queue *);
 extern void mmc_queue_bounce_post(struct mmc_queue *);
 
+extern void mmc_queue_prep_next(struct mmc_queue *);
+extern unsigned int mmc_queue_take_prep(struct mmc_queue *, s32 *);
+extern void mmc_queue_drop_prep(struct mmc_queue *);
+
 extern int mmc_schedule_card_removal_work(struct delayed_work *work,
 				     unsigned long delay);
 #endif
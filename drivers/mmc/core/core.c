@@ -211,6 +211,55 @@ static void mmc_wait_done(struct mmc_request *mrq)
 	complete(mrq->done_data);
 }
 
+/**
+ *	mmc_start_req - start a request without waiting for it
+ *	@host: MMC host to start the request
+ *	@mrq: MMC request to start
+ *	@done: completion signalled when the request has finished
+ *
+ *	Like mmc_wait_for_req(), but returns as soon as the request has
+ *	been handed to the host, so that the caller can prepare the next
+ *	request with mmc_pre_req() before it waits on @done.
+ */
+void mmc_start_req(struct mmc_host *host, struct mmc_request *mrq,
+		   struct completion *done)
+{
+	mrq->done_data = done;
+	mrq->done = mmc_wait_done;
+
+	mmc_start_request(host, mrq);
+}
+EXPORT_SYMBOL(mmc_start_req);
+
+/**
+ *	mmc_pre_req - prepare the data of a request ahead of time
+ *	@host: MMC host to prepare the request for
+ *	@mrq: MMC request to prepare
+ *
+ *	Lets the host map the data of @mrq while another request is
+ *	being transferred. The request must later be passed to
+ *	mmc_post_req(), whether it was issued or not.
+ */
+void mmc_pre_req(struct mmc_host *host, struct mmc_request *mrq)
+{
+	if (host->ops->pre_req)
+		host->ops->pre_req(host, mrq);
+}
+EXPORT_SYMBOL(mmc_pre_req);
+
+/**
+ *	mmc_post_req - release a request prepared with mmc_pre_req()
+ *	@host: MMC host the request was prepared for
+ *	@mrq: MMC request that was prepared
+ *	@err: non-zero if the request was dropped or failed
+ */
+void mmc_post_req(struct mmc_host *host, struct mmc_request *mrq, int err)
+{
+	if (host->ops->post_req)
+		host->ops->post_req(host, mrq, err);
+}
+EXPORT_SYMBOL(mmc_post_req);
+
 struct msmsdcc_host;
 void msmsdcc_request_end(struct msmsdcc_host *host, struct mmc_request *mrq);
 void msmsdcc_stop_data(struct msmsdcc_host *host);
@@ -233,10 +282,7 @@ void mmc_wait_for_req(struct mmc_host *host, struct mmc_request *mrq)
 
 	DECLARE_COMPLETION_ONSTACK(complete);
 
-	mrq->done_data = &complete;
-	mrq->done = mmc_wait_done;
-
-	mmc_start_request(host, mrq);
+	mmc_start_req(host, mrq, &complete);
 
 #ifdef CONFIG_WIMAX
 #ifdef CONFIG_WIMAX_MMC
@@ -400,6 +446,170 @@ unsigned int mmc_align_data_size(struct mmc_card *card, unsigned int sz)
 }
 EXPORT_SYMBOL(mmc_align_data_size);
 
+/**
+ *	mmc_can_erase - check if a card can erase or trim
+ *	@card: card to check
+ *
+ *	Only MMC cards are handled, SD cards use different erase commands.
+ */
+int mmc_can_erase(struct mmc_card *card)
+{
+	return mmc_card_mmc(card) && (card->csd.cmdclass & CCC_ERASE) &&
+		card->erase_size;
+}
+EXPORT_SYMBOL(mmc_can_erase);
+
+/**
+ *	mmc_can_trim - check if a card can trim single write blocks
+ *	@card: card to check
+ */
+int mmc_can_trim(struct mmc_card *card)
+{
+	return mmc_can_erase(card) &&
+		(card->ext_csd.sec_feature_support & EXT_CSD_SEC_GB_CL_EN);
+}
+EXPORT_SYMBOL(mmc_can_trim);
+
+static int mmc_do_erase(struct mmc_card *card, unsigned int from,
+			unsigned int to, unsigned int arg)
+{
+	struct mmc_command cmd;
+	int err;
+
+	if (!mmc_card_blockaddr(card)) {
+		from <<= 9;
+		to <<= 9;
+	}
+
+	memset(&cmd, 0, sizeof(struct mmc_command));
+	cmd.opcode = MMC_ERASE_GROUP_START;
+	cmd.arg = from;
+	cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_AC;
+	err = mmc_wait_for_cmd(card->host, &cmd, 0);
+	if (err) {
+		printk(KERN_ERR "%s: erase group start error %d, "
+		       "status %#x\n", mmc_hostname(card->host), err,
+		       cmd.resp[0]);
+		return -EIO;
+	}
+
+	memset(&cmd, 0, sizeof(struct mmc_command));
+	cmd.opcode = MMC_ERASE_GROUP_END;
+	cmd.arg = to;
+	cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_AC;
+	err = mmc_wait_for_cmd(card->host, &cmd, 0);
+	if (err) {
+		printk(KERN_ERR "%s: erase group end error %d, status %#x\n",
+		       mmc_hostname(card->host), err, cmd.resp[0]);
+		return -EIO;
+	}
+
+	memset(&cmd, 0, sizeof(struct mmc_command));
+	cmd.opcode = MMC_ERASE;
+	cmd.arg = arg;
+	cmd.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+	err = mmc_wait_for_cmd(card->host, &cmd, 0);
+	if (err) {
+		printk(KERN_ERR "%s: erase error %d, status %#x\n",
+		       mmc_hostname(card->host), err, cmd.resp[0]);
+		return -EIO;
+	}
+
+	if (mmc_host_is_spi(card->host))
+		return 0;
+
+	/* Wait for the card to leave the programming state */
+	do {
+		memset(&cmd, 0, sizeof(struct mmc_command));
+		cmd.opcode = MMC_SEND_STATUS;
+		cmd.arg = card->rca << 16;
+		cmd.flags = MMC_RSP_R1 | MMC_CMD_AC;
+		/* Do not retry else we can't see errors */
+		err = mmc_wait_for_cmd(card->host, &cmd, 0);
+		if (err || (cmd.resp[0] & 0xFDF92000)) {
+			printk(KERN_ERR "%s: error %d requesting status %#x\n",
+			       mmc_hostname(card->host), err, cmd.resp[0]);
+			return -EIO;
+		}
+	} while (!(cmd.resp[0] & R1_READY_FOR_DATA) ||
+		 R1_CURRENT_STATE(cmd.resp[0]) == 7);
+
+	return 0;
+}
+
+/**
+ *	mmc_erase - erase or trim sectors
+ *	@card: card to erase
+ *	@from: first sector to erase
+ *	@nr: number of sectors to erase
+ *	@arg: MMC_ERASE_ARG or MMC_TRIM_ARG
+ *
+ *	An erase only works on whole erase groups, so the range is shrunk
+ *	to the groups it fully covers and may end up empty. A trim works
+ *	on write blocks and is done as asked. The caller must claim the
+ *	host.
+ */
+int mmc_erase(struct mmc_card *card, unsigned int from, unsigned int nr,
+	      unsigned int arg)
+{
+	unsigned int rem, to;
+
+	if (!mmc_can_erase(card))
+		return -EOPNOTSUPP;
+
+	if (arg == MMC_TRIM_ARG && !mmc_can_trim(card))
+		return -EOPNOTSUPP;
+
+	if (arg == MMC_ERASE_ARG) {
+		rem = from % card->erase_size;
+		if (rem) {
+			rem = card->erase_size - rem;
+			if (nr <= rem)
+				return 0;
+			from += rem;
+			nr -= rem;
+		}
+		nr -= nr % card->erase_size;
+	}
+
+	if (nr == 0)
+		return 0;
+
+	to = from + nr;
+	if (to <= from)
+		return -EINVAL;
+
+	/* 'from' and 'to' are inclusive */
+	return mmc_do_erase(card, from, to - 1, arg);
+}
+EXPORT_SYMBOL(mmc_erase);
+
+/**
+ *	mmc_flush_cache - write the card's volatile cache back to flash
+ *	@card: card to flush
+ *
+ *	Does nothing unless mmc_init_card() turned the cache on. Must be
+ *	called with the host claimed.
+ */
+int mmc_flush_cache(struct mmc_card *card)
+{
+	int err;
+
+	if (!mmc_card_mmc(card) || !card->ext_csd.cache_ctrl)
+		return 0;
+
+	err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+			 EXT_CSD_FLUSH_CACHE, 1);
+	if (err)
+		printk(KERN_ERR "%s: cache flush error %d\n",
+		       mmc_hostname(card->host), err);
+	else
+		card->wr_pack_stats.flushes++;
+
+	return err;
+}
+EXPORT_SYMBOL(mmc_flush_cache);
+
 /**
  *	mmc_host_enable - enable a host.
  *	@host: mmc host to enable
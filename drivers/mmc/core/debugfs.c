@@ -247,6 +247,50 @@ static const struct file_operations mmc_dbg_ext_csd_fops = {
 	.release	= mmc_ext_csd_release,
 };
 
+static int mmc_wr_pack_stats_show(struct seq_file *s, void *data)
+{
+	struct mmc_card *card = s->private;
+	struct mmc_wr_pack_stats stats = card->wr_pack_stats;
+	unsigned int per_cmd = 0;
+
+	if (stats.packed_cmds)
+		per_cmd = stats.packed_reqs * 100 / stats.packed_cmds;
+
+	seq_printf(s, "cache:\t\t%s\n",
+		   card->ext_csd.cache_ctrl ? "on" : "off");
+	seq_printf(s, "packed_cmds:\t%u\n", stats.packed_cmds);
+	seq_printf(s, "packed_reqs:\t%u (%u.%02u per cmd)\n",
+		   stats.packed_reqs, per_cmd / 100, per_cmd % 100);
+	seq_printf(s, "single_reqs:\t%u\n", stats.single_reqs);
+	seq_printf(s, "fallbacks:\t%u\n", stats.fallbacks);
+	seq_printf(s, "flushes:\t%u\n", stats.flushes);
+
+	return 0;
+}
+
+static int mmc_wr_pack_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_wr_pack_stats_show, inode->i_private);
+}
+
+/* Any write clears the counts */
+static ssize_t mmc_wr_pack_stats_write(struct file *file,
+		const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	struct mmc_card *card = ((struct seq_file *)file->private_data)->private;
+
+	memset(&card->wr_pack_stats, 0, sizeof(card->wr_pack_stats));
+	return cnt;
+}
+
+static const struct file_operations mmc_dbg_wr_pack_stats_fops = {
+	.open		= mmc_wr_pack_stats_open,
+	.read		= seq_read,
+	.write		= mmc_wr_pack_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void mmc_add_card_debugfs(struct mmc_card *card)
 {
 	struct mmc_host	*host = card->host;
@@ -279,6 +323,11 @@ void mmc_add_card_debugfs(struct mmc_card *card)
 					&mmc_dbg_ext_csd_fops))
 			goto err;
 
+	if (mmc_card_mmc(card))
+		if (!debugfs_create_file("wr_pack_stats", S_IRUSR | S_IWUSR,
+					root, card, &mmc_dbg_wr_pack_stats_fops))
+			goto err;
+
 	return;
 
 err:
@@ -162,6 +162,15 @@ static int mmc_decode_csd(struct mmc_card *card)
 	csd->write_blkbits = UNSTUFF_BITS(resp, 22, 4);
 	csd->write_partial = UNSTUFF_BITS(resp, 21, 1);
 
+	if (csd->write_blkbits >= 9) {
+		unsigned int grp_size, grp_mult;
+
+		grp_size = UNSTUFF_BITS(resp, 42, 5);
+		grp_mult = UNSTUFF_BITS(resp, 37, 5);
+		csd->erase_size = (grp_size + 1) * (grp_mult + 1);
+		csd->erase_size <<= csd->write_blkbits - 9;
+	}
+
 	return 0;
 }
 
@@ -231,7 +240,7 @@ static int mmc_read_ext_csd(struct mmc_card *card)
 	}
 
 	card->ext_csd.rev = ext_csd[EXT_CSD_REV];
-	if (card->ext_csd.rev > 5) {
+	if (card->ext_csd.rev > 6) {
 		printk(KERN_ERR "%s: unrecognised EXT_CSD revision %d\n",
 			mmc_hostname(card->host), card->ext_csd.rev);
 		err = -EINVAL;
@@ -280,6 +289,26 @@ static int mmc_read_ext_csd(struct mmc_card *card)
 		if (sa_shift > 0 && sa_shift <= 0x17)
 			card->ext_csd.sa_timeout =
 					1 << ext_csd[EXT_CSD_S_A_TIMEOUT];
+
+		card->ext_csd.erase_group_def = ext_csd[EXT_CSD_ERASE_GROUP_DEF];
+		/* high capacity erase unit is in 512KB chunks */
+		card->ext_csd.hc_erase_size =
+					ext_csd[EXT_CSD_HC_ERASE_GRP_SIZE] << 10;
+	}
+
+	if (card->ext_csd.rev >= 4)
+		card->ext_csd.sec_feature_support =
+					ext_csd[EXT_CSD_SEC_FEATURE_SUPPORT];
+
+	/* eMMC 4.5 adds the volatile cache and packed commands */
+	if (card->ext_csd.rev >= 6) {
+		card->ext_csd.cache_size =
+			ext_csd[EXT_CSD_CACHE_SIZE + 0] << 0 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 1] << 8 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 2] << 16 |
+			ext_csd[EXT_CSD_CACHE_SIZE + 3] << 24;
+		card->ext_csd.max_packed_writes =
+			ext_csd[EXT_CSD_MAX_PACKED_WRITES];
 	}
 
 out:
@@ -444,6 +473,16 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 
 		if (card->ext_csd.sectors && (rocr & MMC_CARD_SECTOR_ADDR))
 			mmc_card_set_blockaddr(card);
+
+		/*
+		 * The high capacity erase group only applies once
+		 * ERASE_GROUP_DEF is set, otherwise the CSD one does.
+		 */
+		if ((card->ext_csd.erase_group_def & 1) &&
+		    card->ext_csd.hc_erase_size)
+			card->erase_size = card->ext_csd.hc_erase_size;
+		else
+			card->erase_size = card->csd.erase_size;
 	}
 
 	/*
@@ -510,6 +549,26 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 		}
 	}
 
+	/*
+	 * Turn the volatile cache on if the host lets the block driver
+	 * flush it. It is off again after every power cycle.
+	 */
+	card->ext_csd.cache_ctrl = 0;
+	if (card->ext_csd.cache_size && (host->caps & MMC_CAP_CACHE_CTRL)) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_CACHE_CTRL, 1);
+		if (err && err != -EBADMSG)
+			goto free_card;
+
+		if (err) {
+			printk(KERN_WARNING "%s: enabling the cache failed\n",
+			       mmc_hostname(card->host));
+			err = 0;
+		} else {
+			card->ext_csd.cache_ctrl = 1;
+		}
+	}
+
 	if (!oldcard)
 		host->card = card;
 
@@ -618,6 +677,9 @@ static int mmc_sleep(struct mmc_host *host)
 	int err = -ENOSYS;
 
 	if (card && card->ext_csd.rev >= 3) {
+		/* the card may lose power while asleep */
+		mmc_flush_cache(card);
+
 		err = mmc_card_sleepawake(host, 1);
 		if (err < 0)
 			pr_debug("%s: Error %d while putting card into sleep",
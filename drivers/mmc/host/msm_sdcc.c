@@ -85,6 +85,13 @@ static struct mmc_command dummy52cmd = {
 
 #define PIO_SPINMAX 30
 #define CMD_SPINMAX 20
+#define DATAEND_SPINMAX 10
+
+/*
+ * Poll for DATAEND from the DMA completion path when the previous data
+ * request finished no longer ago than this.
+ */
+#define DATAEND_POLL_WINDOW	(HZ / 100 ? HZ / 100 : 1)
 
 #define WRITE_WAIT_DAT0_MAX 10
 
@@ -450,6 +457,39 @@ msmsdcc_dma_exec_func(struct msm_dmov_cmd *cmd)
 	host->dma.active = 1;
 }
 
+static int
+msmsdcc_spin_on_status(struct msmsdcc_host *host, uint32_t mask, int maxspin)
+{
+	while (maxspin) {
+		if ((msmsdcc_readl(host, MMCISTATUS) & mask))
+			return 0;
+		udelay(1);
+		--maxspin;
+	}
+	return -ETIMEDOUT;
+}
+
+/*
+ * While requests are streaming, DATAEND follows the end of the DMA within
+ * microseconds. Picking it up here completes the request without another
+ * controller interrupt; after an idle spell the interrupt delivers it as
+ * before. Must hold host->lock.
+ */
+static void msmsdcc_poll_dataend(struct msmsdcc_host *host)
+{
+	if (!host->dataendpoll ||
+	    time_after(jiffies, host->last_data_done + DATAEND_POLL_WINDOW))
+		return;
+
+	if (msmsdcc_spin_on_status(host, MCI_DATAEND, DATAEND_SPINMAX)) {
+		host->stats.dataendpoll_misses++;
+		return;
+	}
+	msmsdcc_writel(host, MCI_DATAEND, MMCICLEAR);
+	host->curr.got_dataend = 1;
+	host->stats.dataendpoll_hits++;
+}
+
 static void
 msmsdcc_dma_complete_tlet(unsigned long data)
 {
@@ -501,6 +541,9 @@ msmsdcc_dma_complete_tlet(unsigned long data)
 	host->dma.sg = NULL;
 	host->dma.busy = 0;
 
+	if (!host->curr.got_dataend && !mrq->data->error)
+		msmsdcc_poll_dataend(host);
+
 	if (host->curr.got_dataend || mrq->data->error) {
 
 		if (mrq->data->error && !(host->curr.got_dataend)) {
@@ -514,6 +557,7 @@ msmsdcc_dma_complete_tlet(unsigned long data)
 		 * for this request, then complete it through here.
 		 */
 		msmsdcc_stop_data(host);
+		host->last_data_done = jiffies;
 
 		if (!mrq->data->error)
 			host->curr.data_xfered = host->curr.xfer_size;
@@ -565,27 +609,27 @@ static int validate_dma(struct msmsdcc_host *host, struct mmc_data *data)
 	return 0;
 }
 
-static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
+static inline enum dma_data_direction msmsdcc_dma_dir(struct mmc_data *data)
+{
+	return (data->flags & MMC_DATA_READ) ? DMA_FROM_DEVICE : DMA_TO_DEVICE;
+}
+
+/*
+ * Build the data mover box list for @data in @nc and map its
+ * scatterlist. Used for the request being started as well as, from
+ * pre_req, for the next one while a transfer is still running.
+ */
+static int msmsdcc_map_dma(struct msmsdcc_host *host, struct mmc_data *data,
+			   struct msmsdcc_nc_dmadata *nc,
+			   dma_addr_t cmd_busaddr)
 {
-	struct msmsdcc_nc_dmadata *nc;
 	dmov_box *box;
 	uint32_t rows;
 	uint32_t crci;
 	unsigned int n;
-	int i, rc;
+	int i;
 	struct scatterlist *sg = data->sg;
 
-	rc = validate_dma(host, data);
-	if (rc)
-		return rc;
-
-	host->dma.sg = data->sg;
-	host->dma.num_ents = data->sg_len;
-
-	BUG_ON(host->dma.num_ents > NR_SG); /* Prevent memory corruption */
-
-	nc = host->dma.nc;
-
 	if (host->pdev_id == 1)
 		crci = DMOV_SDC1_CRCI;
 	else if (host->pdev_id == 2)
@@ -598,28 +642,18 @@ static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
 	else if (host->pdev_id == 5)
 		crci = DMOV_SDC5_CRCI;
 #endif
-	else {
-		host->dma.sg = NULL;
-		host->dma.num_ents = 0;
-		return -ENOENT;
-	}
-
-	if (data->flags & MMC_DATA_READ)
-		host->dma.dir = DMA_FROM_DEVICE;
 	else
-		host->dma.dir = DMA_TO_DEVICE;
-
-	host->curr.user_pages = 0;
+		return -ENOENT;
 
 	box = &nc->cmd[0];
-	for (i = 0; i < host->dma.num_ents; i++) {
+	for (i = 0; i < data->sg_len; i++) {
 		box->cmd = CMD_MODE_BOX;
 
 		/* Initialize sg dma address */
 		sg->dma_address = page_to_dma(mmc_dev(host->mmc), sg_page(sg))
 					+ sg->offset;
 
-		if (i == (host->dma.num_ents - 1))
+		if (i == (data->sg_len - 1))
 			box->cmd |= CMD_LC;
 		rows = (sg_dma_len(sg) % MCI_FIFOSIZE) ?
 			(sg_dma_len(sg) / MCI_FIFOSIZE) + 1 :
@@ -651,28 +685,58 @@ static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
 	}
 
 	/* location of command block must be 64 bit aligned */
-	BUG_ON(host->dma.cmd_busaddr & 0x07);
+	BUG_ON(cmd_busaddr & 0x07);
 
-	nc->cmdptr = (host->dma.cmd_busaddr >> 3) | CMD_PTR_LP;
-	host->dma.hdr.cmdptr = DMOV_CMD_PTR_LIST |
-			       DMOV_CMD_ADDR(host->dma.cmdptr_busaddr);
-	host->dma.hdr.complete_func = msmsdcc_dma_complete_func;
+	nc->cmdptr = (cmd_busaddr >> 3) | CMD_PTR_LP;
 
-	n = dma_map_sg(mmc_dev(host->mmc), host->dma.sg,
-			host->dma.num_ents, host->dma.dir);
+	n = dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			msmsdcc_dma_dir(data));
 	/* dsb inside dma_map_sg will write nc out to mem as well */
 
-	if (n != host->dma.num_ents) {
+	if (n != data->sg_len) {
 		printk(KERN_ERR "%s: Unable to map in all sg elements\n",
 			mmc_hostname(host->mmc));
-		host->dma.sg = NULL;
-		host->dma.num_ents = 0;
 		return -ENOMEM;
 	}
 
 	return 0;
 }
 
+static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
+{
+	int rc;
+
+	rc = validate_dma(host, data);
+	if (rc)
+		return rc;
+
+	BUG_ON(data->sg_len > NR_SG); /* Prevent memory corruption */
+
+	if (data->host_cookie && data->host_cookie == host->dma.next_cookie) {
+		/* mapped by pre_req, switch to its descriptors */
+		swap(host->dma.nc, host->dma.next_nc);
+		swap(host->dma.cmd_busaddr, host->dma.next_cmd_busaddr);
+		swap(host->dma.cmdptr_busaddr, host->dma.next_cmdptr_busaddr);
+		host->dma.next_cookie = 0;
+	} else {
+		rc = msmsdcc_map_dma(host, data, host->dma.nc,
+				     host->dma.cmd_busaddr);
+		if (rc)
+			return rc;
+	}
+
+	host->dma.sg = data->sg;
+	host->dma.num_ents = data->sg_len;
+	host->dma.dir = msmsdcc_dma_dir(data);
+	host->curr.user_pages = 0;
+
+	host->dma.hdr.cmdptr = DMOV_CMD_PTR_LIST |
+			       DMOV_CMD_ADDR(host->dma.cmdptr_busaddr);
+	host->dma.hdr.complete_func = msmsdcc_dma_complete_func;
+
+	return 0;
+}
+
 static int
 snoop_cccr_abort(struct mmc_command *cmd)
 {
@@ -778,7 +842,8 @@ msmsdcc_start_data(struct msmsdcc_host *host, struct mmc_data *data,
 			host->cmd_c = c;
 		}
 		dsb();
-		msm_dmov_enqueue_cmd_ext(host->dma.channel, &host->dma.hdr);
+		msm_dmov_enqueue_cmd_prio(host->dma.channel, &host->dma.hdr,
+					  MSM_DMOV_PRIO_LOW);
 		if (data->flags & MMC_DATA_WRITE)
 			host->prog_scan = 1;
 	} else {
@@ -943,18 +1008,6 @@ msmsdcc_pio_write(struct msmsdcc_host *host, char *buffer,
 #endif
 }
 
-static int
-msmsdcc_spin_on_status(struct msmsdcc_host *host, uint32_t mask, int maxspin)
-{
-	while (maxspin) {
-		if ((msmsdcc_readl(host, MMCISTATUS) & mask))
-			return 0;
-		udelay(1);
-		--maxspin;
-	}
-	return -ETIMEDOUT;
-}
-
 static irqreturn_t
 msmsdcc_pio_irq(int irq, void *dev_id)
 {
@@ -1182,6 +1235,7 @@ msmsdcc_handle_irq_data(struct msmsdcc_host *host, u32 status,
 		}
 
 		msmsdcc_stop_data(host);
+		host->last_data_done = jiffies;
 		if (!data->error)
 			host->curr.data_xfered = host->curr.xfer_size;
 
@@ -1526,8 +1580,55 @@ static void msmsdcc_enable_sdio_irq(struct mmc_host *mmc, int enable)
 	spin_unlock_irqrestore(&host->lock, flags);
 }
 
+/*
+ * Map the next request and build its box list in the spare descriptors
+ * while the current one is transferred. Runs with the host claimed, so
+ * it cannot race with msmsdcc_config_dma() consuming the spare set.
+ */
+static void
+msmsdcc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq)
+{
+	struct msmsdcc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	data->host_cookie = 0;
+
+	if (host->dma.next_cookie || data->sg_len > NR_SG ||
+	    validate_dma(host, data))
+		return;
+
+	if (msmsdcc_map_dma(host, data, host->dma.next_nc,
+			    host->dma.next_cmd_busaddr))
+		return;
+
+	if (++host->dma.cookie <= 0)
+		host->dma.cookie = 1;
+	host->dma.next_cookie = host->dma.cookie;
+	data->host_cookie = host->dma.cookie;
+}
+
+static void
+msmsdcc_post_req(struct mmc_host *mmc, struct mmc_request *mrq, int err)
+{
+	struct msmsdcc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	/*
+	 * Only a request that was never started still owns the spare
+	 * descriptors, the DMA tasklet unmaps the ones that ran.
+	 */
+	if (data->host_cookie && data->host_cookie == host->dma.next_cookie) {
+		dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
+			     msmsdcc_dma_dir(data));
+		host->dma.next_cookie = 0;
+	}
+	data->host_cookie = 0;
+}
+
 static const struct mmc_host_ops msmsdcc_ops = {
 	.request	= msmsdcc_request,
+	.pre_req	= msmsdcc_pre_req,
+	.post_req	= msmsdcc_post_req,
 	.set_ios	= msmsdcc_set_ios,
 	.enable_sdio_irq = msmsdcc_enable_sdio_irq,
 
@@ -1543,6 +1644,8 @@ static int msmsdcc_sdc_get_status(struct mmc_host *mmc) {
 
 static const struct mmc_host_ops msmsdcc_ops_sd = {
 	.request	= msmsdcc_request,
+	.pre_req	= msmsdcc_pre_req,
+	.post_req	= msmsdcc_post_req,
 	.set_ios	= msmsdcc_set_ios,
 	.enable_sdio_irq = msmsdcc_enable_sdio_irq,
 	.get_cd = msmsdcc_sdc_get_status,
@@ -1626,18 +1729,24 @@ msmsdcc_init_dma(struct msmsdcc_host *host)
 	if (!host->dmares)
 		return -ENODEV;
 
+	/* a second set of descriptors is used by pre_req */
 	host->dma.nc = dma_alloc_coherent(NULL,
-					  sizeof(struct msmsdcc_nc_dmadata),
+					  sizeof(struct msmsdcc_nc_dmadata) * 2,
 					  &host->dma.nc_busaddr,
 					  GFP_KERNEL);
 	if (host->dma.nc == NULL) {
 		pr_err("Unable to allocate DMA buffer\n");
 		return -ENOMEM;
 	}
-	memset(host->dma.nc, 0x00, sizeof(struct msmsdcc_nc_dmadata));
+	memset(host->dma.nc, 0x00, sizeof(struct msmsdcc_nc_dmadata) * 2);
 	host->dma.cmd_busaddr = host->dma.nc_busaddr;
 	host->dma.cmdptr_busaddr = host->dma.nc_busaddr +
 				offsetof(struct msmsdcc_nc_dmadata, cmdptr);
+	host->dma.next_nc = host->dma.nc + 1;
+	host->dma.next_cmd_busaddr = host->dma.nc_busaddr +
+				sizeof(struct msmsdcc_nc_dmadata);
+	host->dma.next_cmdptr_busaddr = host->dma.next_cmd_busaddr +
+				offsetof(struct msmsdcc_nc_dmadata, cmdptr);
 #if defined(CONFIG_ARCH_MSM7X30)
 	if (is_mmc_platform(host->plat))
 		host->dma.channel = DMOV_NAND_CHAN;
@@ -1760,6 +1869,7 @@ msmsdcc_probe(struct platform_device *pdev)
 	host->curr.cmd = NULL;
 
 	host->cmdpoll = 1;
+	host->dataendpoll = 1;
 
 	host->base = ioremap(memres->start, PAGE_SIZE);
 	if (!host->base) {
@@ -1841,6 +1951,7 @@ msmsdcc_probe(struct platform_device *pdev)
 		mmc->caps |= MMC_CAP_SDIO_IRQ;
 
 	mmc->caps |= MMC_CAP_MMC_HIGHSPEED | MMC_CAP_SD_HIGHSPEED;
+	mmc->caps |= MMC_CAP_CACHE_CTRL | MMC_CAP_PACKED_WR;
 
 	mmc->max_phys_segs = NR_SG;
 	mmc->max_hw_segs = NR_SG;
@@ -1848,7 +1959,9 @@ msmsdcc_probe(struct platform_device *pdev)
 	mmc->max_blk_count = 65535;
 
 	mmc->max_req_size = 33554432;	/* MCI_DATA_LENGTH is 25 bits */
-	mmc->max_seg_size = mmc->max_req_size;
+	/* a segment has to fit the row count of a single box */
+	mmc->max_seg_size = (MCI_MAX_BOX_ROWS * MCI_FIFOSIZE) &
+				~(PAGE_SIZE - 1);
 
 	msmsdcc_writel(host, 0, MMCIMASK0);
 	msmsdcc_writel(host, 0x5e007ff, MMCICLEAR);
@@ -1988,7 +2101,7 @@ msmsdcc_probe(struct platform_device *pdev)
  pclk_put:
 	clk_put(host->pclk);
 
-	dma_free_coherent(NULL, sizeof(struct msmsdcc_nc_dmadata),
+	dma_free_coherent(NULL, sizeof(struct msmsdcc_nc_dmadata) * 2,
 			host->dma.nc, host->dma.nc_busaddr);
  host_free:
 	mmc_free_host(mmc);
@@ -2213,6 +2326,11 @@ msmsdcc_dbg_state_read(struct file *file, char __user *ubuf,
 			      host->curr.xfer_size, host->curr.xfer_remain,
 			      host->curr.data_xfered, host->dma.sg);
 	}
+	i += scnprintf(buf + i, max - i,
+		       "POLL: cmd %u/%u dataend %u/%u (hits/misses)\n",
+		       host->stats.cmdpoll_hits, host->stats.cmdpoll_misses,
+		       host->stats.dataendpoll_hits,
+		       host->stats.dataendpoll_misses);
 
 	return simple_read_from_buffer(ubuf, count, ppos, buf, i);
 }
@@ -165,7 +165,16 @@
 
 #define MCI_FIFOHALFSIZE (MCI_FIFOSIZE / 2)
 
-#define NR_SG		32
+/*
+ * Each scatterlist entry becomes one data mover box in a single chained
+ * command list with one completion, so the entry count is what bounds a
+ * request built from scattered pages: 128 pages covers the block layer's
+ * default 512KB request.
+ */
+#define NR_SG		128
+
+/* A box moves at most this many FIFO sized rows */
+#define MCI_MAX_BOX_ROWS	0xFFFF
 
 struct clk;
 
@@ -180,6 +189,13 @@ struct msmsdcc_dma_data {
 	dma_addr_t			cmd_busaddr;
 	dma_addr_t			cmdptr_busaddr;
 
+	/* descriptors of the request prepared ahead by pre_req */
+	struct msmsdcc_nc_dmadata	*next_nc;
+	dma_addr_t			next_cmd_busaddr;
+	dma_addr_t			next_cmdptr_busaddr;
+	s32				next_cookie;
+	s32				cookie;
+
 	struct msm_dmov_cmd		hdr;
 	enum dma_data_direction		dir;
 
@@ -216,6 +232,8 @@ struct msmsdcc_stats {
 	unsigned int cmds;
 	unsigned int cmdpoll_hits;
 	unsigned int cmdpoll_misses;
+	unsigned int dataendpoll_hits;
+	unsigned int dataendpoll_misses;
 };
 
 struct msmsdcc_host {
@@ -253,6 +271,8 @@ struct msmsdcc_host {
 	struct msmsdcc_dma_data	dma;
 	struct msmsdcc_pio_data	pio;
 	int			cmdpoll;
+	int			dataendpoll;
+	unsigned long		last_data_done;	/* jiffies */
 	struct msmsdcc_stats	stats;
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct early_suspend early_suspend;
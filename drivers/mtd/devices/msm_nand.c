@@ -20,6 +20,7 @@
 #include <linux/platform_device.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/dma-mapping.h>
 #include <linux/io.h>
 #include <linux/moduleparam.h>
@@ -32,12 +33,18 @@
 
 #include "msm_nand.h"
 
-#define MSM_NAND_DMA_BUFFER_SIZE SZ_4K
+#define MSM_NAND_DMA_BUFFER_SIZE SZ_8K
 #define MSM_NAND_DMA_BUFFER_SLOTS \
 	(MSM_NAND_DMA_BUFFER_SIZE / (sizeof(((atomic_t *)0)->counter) * 8))
 
 #define SUPPORT_WRONG_ECC_CONFIG 1
 
+/* pages chained into one data mover command pointer list */
+#define MSM_NAND_BATCH_PAGES 4
+
+/* erased_from[] value for blocks nothing is known about */
+#define MSM_NAND_ERASED_UNKNOWN 0xff
+
 #define MSM_NAND_CFG0_RAW 0xA80420C0
 #define MSM_NAND_CFG1_RAW 0x5045D
 
@@ -58,6 +65,11 @@ struct msm_nand_chip {
 	uint32_t ecc_buf_cfg;
 	uint32_t saved_ecc_buf_cfg;
 #endif
+	/* first page of each block known to be erased up to its end */
+	uint8_t *erased_from;
+	unsigned block_shift;
+	spinlock_t erased_lock;
+	unsigned erased_gen;
 };
 
 #define CFG1_WIDE_FLASH (1U << 1)
@@ -331,6 +343,113 @@ msm_nand_dma_map(struct device *dev, void *addr, size_t size,
 	return dma_map_page(dev, page, offset, size, dir);
 }
 
+/*
+ * Pages of a block are programmed in order, so once a page is known to
+ * be erased the rest of the block is as well until it is written.  The
+ * markers are learned from erases, writes and erased pages found by
+ * msm_nand_check_empty(), and let reads of such pages skip the flash.
+ * Only writes through this driver are tracked; the modem never programs
+ * the partitions exported here.
+ */
+static int msm_nand_range_erased(struct msm_nand_chip *chip, unsigned page,
+				 unsigned count)
+{
+	unsigned mask = (1U << chip->block_shift) - 1;
+	uint8_t from;
+
+	if (!chip->erased_from || !count)
+		return false;
+
+	while (count) {
+		from = chip->erased_from[page >> chip->block_shift];
+		if (from == MSM_NAND_ERASED_UNKNOWN || from > (page & mask))
+			return false;
+		/* skip to the next block */
+		if (count <= mask + 1 - (page & mask))
+			break;
+		count -= mask + 1 - (page & mask);
+		page = (page | mask) + 1;
+	}
+	return true;
+}
+
+/* pages [page, page + count) were erased (from 0) or programmed */
+static void msm_nand_erased_update(struct msm_nand_chip *chip, unsigned page,
+				   unsigned count, int erased, int err)
+{
+	unsigned mask = (1U << chip->block_shift) - 1;
+	unsigned last, blk;
+	unsigned long flags;
+
+	if (!chip->erased_from || !count)
+		return;
+
+	spin_lock_irqsave(&chip->erased_lock, flags);
+	chip->erased_gen++;
+	for (blk = page >> chip->block_shift;
+	     blk <= (page + count - 1) >> chip->block_shift; blk++) {
+		if (err) {
+			chip->erased_from[blk] = MSM_NAND_ERASED_UNKNOWN;
+			continue;
+		}
+		if (erased) {
+			chip->erased_from[blk] = 0;
+			continue;
+		}
+		last = min(page + count - 1, (blk << chip->block_shift) | mask);
+		if (chip->erased_from[blk] != MSM_NAND_ERASED_UNKNOWN &&
+		    chip->erased_from[blk] <= (last & mask))
+			chip->erased_from[blk] = (last & mask) + 1;
+	}
+	spin_unlock_irqrestore(&chip->erased_lock, flags);
+}
+
+/* page read back erased; ignored if anything was written meanwhile */
+static void msm_nand_erased_seen(struct msm_nand_chip *chip, unsigned page,
+				 unsigned gen)
+{
+	unsigned blk = page >> chip->block_shift;
+	unsigned idx = page & ((1U << chip->block_shift) - 1);
+	unsigned long flags;
+
+	if (!chip->erased_from)
+		return;
+
+	spin_lock_irqsave(&chip->erased_lock, flags);
+	if (gen == chip->erased_gen &&
+	    (chip->erased_from[blk] == MSM_NAND_ERASED_UNKNOWN ||
+	     chip->erased_from[blk] > idx))
+		chip->erased_from[blk] = idx;
+	spin_unlock_irqrestore(&chip->erased_lock, flags);
+}
+
+/*
+ * An erased page reads back as 0xff except for the 0x54 the controller
+ * leaves at offset 3 of each 516 byte codeword.  Compare a word at a
+ * time, the codewords are word sized multiples.
+ */
+static int msm_nand_page_empty(const uint8_t *buf, unsigned len)
+{
+	const uint32_t *word = (const uint32_t *)buf;
+	unsigned n, cw;
+
+	if ((unsigned long)buf & 3) {
+		for (n = 0; n < len; n++)
+			if (buf[n] != ((n % 516 == 3) ? 0x54 : 0xff))
+				return false;
+		return true;
+	}
+
+	for (cw = 0; cw < len / 4; cw += 516 / 4) {
+		if (word[cw] != cpu_to_le32(0x54ffffff))
+			return false;
+		for (n = cw + 1; n < min(cw + 516 / 4, len / 4); n++)
+			if (word[n] != 0xffffffff)
+				return false;
+	}
+	return true;
+}
+
 static int msm_nand_check_empty(struct mtd_info *mtd, struct mtd_oob_ops *ops,
 				unsigned long *uncorrected)
 {
@@ -349,11 +468,8 @@ static int msm_nand_check_empty(struct mtd_info *mtd, struct mtd_oob_ops *ops,
 	for_each_set_bit(p, uncorrected, page_count) {
 		if (datbuf) {
 			datbuf = ops->datbuf + p * mtd->writesize;
-			for (n = 0; n < mtd->writesize; n++) {
-				/* empty blocks read 0x54 at these offsets */
-				if (datbuf[n] != ((n % 516 == 3) ? 0x54 : 0xff))
-					return false;
-			}
+			if (!msm_nand_page_empty(datbuf, mtd->writesize))
+				return false;
 		}
 		if (oobbuf) {
 			n = p * oobsize;
@@ -375,28 +491,32 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 	struct msm_nand_chip *chip = mtd->priv;
 
 	struct {
-		dmov_s cmd[8 * 5 + 3];
-		unsigned cmdptr;
 		struct {
-			uint32_t cmd;
-			uint32_t addr0;
-			uint32_t addr1;
-			uint32_t chipsel;
-			uint32_t cfg0;
-			uint32_t cfg1;
-			uint32_t exec;
+			dmov_s cmd[8 * 5 + 3];
+			struct {
+				uint32_t cmd;
+				uint32_t addr0;
+				uint32_t addr1;
+				uint32_t chipsel;
+				uint32_t cfg0;
+				uint32_t cfg1;
+				uint32_t exec;
 #if SUPPORT_WRONG_ECC_CONFIG
-			uint32_t ecccfg;
-			uint32_t ecccfg_restore;
+				uint32_t ecccfg;
+				uint32_t ecccfg_restore;
 #endif
-			struct {
-				uint32_t flash_status;
-				uint32_t buffer_status;
-			} result[8];
-		} data;
+				struct {
+					uint32_t flash_status;
+					uint32_t buffer_status;
+				} result[8];
+			} data;
+		} __aligned(8) pg[MSM_NAND_BATCH_PAGES];
+		unsigned cmdptr[MSM_NAND_BATCH_PAGES];
 	} *dma_buffer;
+	typeof(dma_buffer->pg[0]) *pg;
 	dmov_s *cmd;
-	unsigned n;
+	unsigned n, p, batch;
+	uint32_t oob_left[MSM_NAND_BATCH_PAGES];
 	unsigned page = from >> chip->page_shift;
 	uint32_t oob_len = ops->ooblen;
 	uint32_t sectordatasize;
@@ -416,6 +536,7 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 	uint32_t total_uncorrected = 0;
 	unsigned long uncorrected_noalloc = 0;
 	unsigned long *uncorrected = &uncorrected_noalloc;
+	unsigned erased_gen = chip->erased_gen;
 
 	if (from & (mtd->writesize - 1)) {
 		pr_err("%s: unsupported from, 0x%llx\n",
@@ -468,6 +589,21 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 	pr_info("msm_nand_read_oob %llx %p %x %p %x\n",
 		from, ops->datbuf, ops->len, ops->oobbuf, ops->ooblen);
 #endif
+	if (ops->mode != MTD_OOB_RAW &&
+	    msm_nand_range_erased(chip, page, page_count)) {
+		/* what the controller would have returned for these pages */
+		sectoroobsize = (chip->last_sector + 1) * 4;
+		if (ops->mode != MTD_OOB_AUTO)
+			sectoroobsize += (chip->last_sector + 1) * 10;
+		if (ops->datbuf)
+			memset(ops->datbuf, 0xff, ops->len);
+		if (ops->oobbuf)
+			memset(ops->oobbuf, 0xff, ops->ooblen);
+		ops->retlen = mtd->writesize * page_count;
+		ops->oobretlen = ops->oobbuf ?
+			min(ops->ooblen, sectoroobsize * page_count) : 0;
+		return 0;
+	}
 	if (ops->datbuf) {
 		/* memset(ops->datbuf, 0x55, ops->len); */
 		data_dma_addr_curr = data_dma_addr =
@@ -509,224 +645,241 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 		oob_col >>= 1;
 
 	err = 0;
-	while (page_count-- > 0) {
-		cmd = dma_buffer->cmd;
-
-		/* CMD / ADDR0 / ADDR1 / CHIPSEL program values */
-		if (ops->mode != MTD_OOB_RAW) {
-			dma_buffer->data.cmd = MSM_NAND_CMD_PAGE_READ_ECC;
-			dma_buffer->data.cfg0 =
-				(chip->CFG0 & ~(7U << 6)) |
-				((chip->last_sector - start_sector) << 6);
-			dma_buffer->data.cfg1 = chip->CFG1;
-		} else {
-			dma_buffer->data.cmd = MSM_NAND_CMD_PAGE_READ;
-			dma_buffer->data.cfg0 =
-				(MSM_NAND_CFG0_RAW & ~(7U << 6)) |
-				(chip->last_sector << 6);
-			dma_buffer->data.cfg1 = MSM_NAND_CFG1_RAW |
-						(chip->CFG1 & CFG1_WIDE_FLASH);
-		}
-
-		dma_buffer->data.addr0 = (page << 16) | oob_col;
-		/* qc example is (page >> 16) && 0xff !? */
-		dma_buffer->data.addr1 = (page >> 16) & 0xff;
-		/* flash0 + undoc bit */
-		dma_buffer->data.chipsel = 0 | 4;
+	while (page_count > 0) {
+		batch = min_t(unsigned, page_count, MSM_NAND_BATCH_PAGES);
+
+		/* one command list per page, chained through cmdptr[] */
+		for (p = 0; p < batch; p++) {
+			pg = &dma_buffer->pg[p];
+			cmd = pg->cmd;
+
+			/* CMD / ADDR0 / ADDR1 / CHIPSEL program values */
+			if (ops->mode != MTD_OOB_RAW) {
+				pg->data.cmd = MSM_NAND_CMD_PAGE_READ_ECC;
+				pg->data.cfg0 =
+					(chip->CFG0 & ~(7U << 6)) |
+					((chip->last_sector - start_sector) << 6);
+				pg->data.cfg1 = chip->CFG1;
+			} else {
+				pg->data.cmd = MSM_NAND_CMD_PAGE_READ;
+				pg->data.cfg0 =
+					(MSM_NAND_CFG0_RAW & ~(7U << 6)) |
+					(chip->last_sector << 6);
+				pg->data.cfg1 = MSM_NAND_CFG1_RAW |
+							(chip->CFG1 & CFG1_WIDE_FLASH);
+			}
 
+			pg->data.addr0 = ((page + p) << 16) | oob_col;
+			/* qc example is (page >> 16) && 0xff !? */
+			pg->data.addr1 = ((page + p) >> 16) & 0xff;
+			/* flash0 + undoc bit */
+			pg->data.chipsel = 0 | 4;
 
-		/* GO bit for the EXEC register */
-		dma_buffer->data.exec = 1;
 
+			/* GO bit for the EXEC register */
+			pg->data.exec = 1;
 
-		BUILD_BUG_ON(8 != ARRAY_SIZE(dma_buffer->data.result));
 
-		for (n = start_sector; n <= chip->last_sector; n++) {
-			/* flash + buffer status return words */
-			dma_buffer->data.result[n].flash_status = 0xeeeeeeee;
-			dma_buffer->data.result[n].buffer_status = 0xeeeeeeee;
+			BUILD_BUG_ON(8 != ARRAY_SIZE(pg->data.result));
 
-			/* block on cmd ready, then
-			 * write CMD / ADDR0 / ADDR1 / CHIPSEL
-			 * regs in a burst
-			 */
-			cmd->cmd = DST_CRCI_NAND_CMD;
-			cmd->src = msm_virt_to_dma(chip, &dma_buffer->data.cmd);
-			cmd->dst = MSM_NAND_FLASH_CMD;
-			if (n == start_sector)
-				cmd->len = 16;
-			else
-				cmd->len = 4;
-			cmd++;
+			for (n = start_sector; n <= chip->last_sector; n++) {
+				/* flash + buffer status return words */
+				pg->data.result[n].flash_status = 0xeeeeeeee;
+				pg->data.result[n].buffer_status = 0xeeeeeeee;
 
-			if (n == start_sector) {
-				cmd->cmd = 0;
-				cmd->src = msm_virt_to_dma(chip,
-							&dma_buffer->data.cfg0);
-				cmd->dst = MSM_NAND_DEV0_CFG0;
-				cmd->len = 8;
+				/* block on cmd ready, then
+				 * write CMD / ADDR0 / ADDR1 / CHIPSEL
+				 * regs in a burst
+				 */
+				cmd->cmd = DST_CRCI_NAND_CMD;
+				cmd->src = msm_virt_to_dma(chip, &pg->data.cmd);
+				cmd->dst = MSM_NAND_FLASH_CMD;
+				if (n == start_sector)
+					cmd->len = 16;
+				else
+					cmd->len = 4;
 				cmd++;
-#if SUPPORT_WRONG_ECC_CONFIG
-				if (chip->saved_ecc_buf_cfg !=
-				    chip->ecc_buf_cfg) {
-					dma_buffer->data.ecccfg =
-						chip->ecc_buf_cfg;
+
+				if (n == start_sector) {
 					cmd->cmd = 0;
 					cmd->src = msm_virt_to_dma(chip,
-						      &dma_buffer->data.ecccfg);
-					cmd->dst = MSM_NAND_EBI2_ECC_BUF_CFG;
-					cmd->len = 4;
+								&pg->data.cfg0);
+					cmd->dst = MSM_NAND_DEV0_CFG0;
+					cmd->len = 8;
 					cmd++;
-				}
+#if SUPPORT_WRONG_ECC_CONFIG
+					if (chip->saved_ecc_buf_cfg !=
+					    chip->ecc_buf_cfg) {
+						pg->data.ecccfg =
+							chip->ecc_buf_cfg;
+						cmd->cmd = 0;
+						cmd->src = msm_virt_to_dma(chip,
+							      &pg->data.ecccfg);
+						cmd->dst = MSM_NAND_EBI2_ECC_BUF_CFG;
+						cmd->len = 4;
+						cmd++;
+					}
 #endif
-			}
-
-			/* kick the execute register */
-			cmd->cmd = 0;
-			cmd->src =
-				msm_virt_to_dma(chip, &dma_buffer->data.exec);
-			cmd->dst = MSM_NAND_EXEC_CMD;
-			cmd->len = 4;
-			cmd++;
-
-			/* block on data ready, then
-			 * read the status register
-			 */
-			cmd->cmd = SRC_CRCI_NAND_DATA;
-			cmd->src = MSM_NAND_FLASH_STATUS;
-			cmd->dst = msm_virt_to_dma(chip,
-						   &dma_buffer->data.result[n]);
-			/* MSM_NAND_FLASH_STATUS + MSM_NAND_BUFFER_STATUS */
-			cmd->len = 8;
-			cmd++;
-
-			/* read data block
-			 * (only valid if status says success)
-			 */
-			if (ops->datbuf) {
-				if (ops->mode != MTD_OOB_RAW)
-					sectordatasize =
-						(n < chip->last_sector) ?
-						516 : chip->last_sectorsz;
-				else
-					sectordatasize = 528;
+				}
 
+				/* kick the execute register */
 				cmd->cmd = 0;
-				cmd->src = MSM_NAND_FLASH_BUFFER;
-				cmd->dst = data_dma_addr_curr;
-				data_dma_addr_curr += sectordatasize;
-				cmd->len = sectordatasize;
+				cmd->src =
+					msm_virt_to_dma(chip, &pg->data.exec);
+				cmd->dst = MSM_NAND_EXEC_CMD;
+				cmd->len = 4;
 				cmd++;
-			}
 
-			if (ops->oobbuf && (n == chip->last_sector ||
-					    ops->mode != MTD_OOB_AUTO)) {
-				cmd->cmd = 0;
-				if (n == chip->last_sector) {
-					cmd->src = MSM_NAND_FLASH_BUFFER +
-						chip->last_sectorsz;
-					sectoroobsize =
-						(chip->last_sector + 1) * 4;
-					if (ops->mode != MTD_OOB_AUTO)
-						sectoroobsize += 10;
-				} else {
-					cmd->src = MSM_NAND_FLASH_BUFFER + 516;
-					sectoroobsize = 10;
-				}
+				/* block on data ready, then
+				 * read the status register
+				 */
+				cmd->cmd = SRC_CRCI_NAND_DATA;
+				cmd->src = MSM_NAND_FLASH_STATUS;
+				cmd->dst = msm_virt_to_dma(chip,
+							   &pg->data.result[n]);
+				/* MSM_NAND_FLASH_STATUS + MSM_NAND_BUFFER_STATUS */
+				cmd->len = 8;
+				cmd++;
 
-				cmd->dst = oob_dma_addr_curr;
-				if (sectoroobsize < oob_len)
-					cmd->len = sectoroobsize;
-				else
-					cmd->len = oob_len;
-				oob_dma_addr_curr += cmd->len;
-				oob_len -= cmd->len;
-				if (cmd->len > 0)
+				/* read data block
+				 * (only valid if status says success)
+				 */
+				if (ops->datbuf) {
+					if (ops->mode != MTD_OOB_RAW)
+						sectordatasize =
+							(n < chip->last_sector) ?
+							516 : chip->last_sectorsz;
+					else
+						sectordatasize = 528;
+
+					cmd->cmd = 0;
+					cmd->src = MSM_NAND_FLASH_BUFFER;
+					cmd->dst = data_dma_addr_curr;
+					data_dma_addr_curr += sectordatasize;
+					cmd->len = sectordatasize;
 					cmd++;
+				}
+
+				if (ops->oobbuf && (n == chip->last_sector ||
+						    ops->mode != MTD_OOB_AUTO)) {
+					cmd->cmd = 0;
+					if (n == chip->last_sector) {
+						cmd->src = MSM_NAND_FLASH_BUFFER +
+							chip->last_sectorsz;
+						sectoroobsize =
+							(chip->last_sector + 1) * 4;
+						if (ops->mode != MTD_OOB_AUTO)
+							sectoroobsize += 10;
+					} else {
+						cmd->src = MSM_NAND_FLASH_BUFFER + 516;
+						sectoroobsize = 10;
+					}
+
+					cmd->dst = oob_dma_addr_curr;
+					if (sectoroobsize < oob_len)
+						cmd->len = sectoroobsize;
+					else
+						cmd->len = oob_len;
+					oob_dma_addr_curr += cmd->len;
+					oob_len -= cmd->len;
+					if (cmd->len > 0)
+						cmd++;
+				}
 			}
-		}
 #if SUPPORT_WRONG_ECC_CONFIG
-		if (chip->saved_ecc_buf_cfg != chip->ecc_buf_cfg) {
-			dma_buffer->data.ecccfg_restore =
-				chip->saved_ecc_buf_cfg;
-			cmd->cmd = 0;
-			cmd->src = msm_virt_to_dma(chip,
-					      &dma_buffer->data.ecccfg_restore);
-			cmd->dst = MSM_NAND_EBI2_ECC_BUF_CFG;
-			cmd->len = 4;
-			cmd++;
-		}
+			if (chip->saved_ecc_buf_cfg != chip->ecc_buf_cfg) {
+				pg->data.ecccfg_restore =
+					chip->saved_ecc_buf_cfg;
+				cmd->cmd = 0;
+				cmd->src = msm_virt_to_dma(chip,
+						      &pg->data.ecccfg_restore);
+				cmd->dst = MSM_NAND_EBI2_ECC_BUF_CFG;
+				cmd->len = 4;
+				cmd++;
+			}
 #endif
 
-		BUILD_BUG_ON(8 * 5 + 3 != ARRAY_SIZE(dma_buffer->cmd));
-		BUG_ON(cmd - dma_buffer->cmd > ARRAY_SIZE(dma_buffer->cmd));
-		dma_buffer->cmd[0].cmd |= CMD_OCB;
-		cmd[-1].cmd |= CMD_OCU | CMD_LC;
+			BUG_ON(cmd - pg->cmd > ARRAY_SIZE(pg->cmd));
+			pg->cmd[0].cmd |= CMD_OCB;
+			cmd[-1].cmd |= CMD_OCU | CMD_LC;
 
-		dma_buffer->cmdptr =
-			(msm_virt_to_dma(chip, dma_buffer->cmd) >> 3)
-			| CMD_PTR_LP;
+			dma_buffer->cmdptr[p] =
+				msm_virt_to_dma(chip, pg->cmd) >> 3;
+			oob_left[p] = oob_len;
+		}
+		BUILD_BUG_ON(8 * 5 + 3 != ARRAY_SIZE(dma_buffer->pg[0].cmd));
+		dma_buffer->cmdptr[batch - 1] |= CMD_PTR_LP;
 
 		msm_dmov_exec_cmd(
 			chip->dma_channel, DMOV_CMD_PTR_LIST | DMOV_CMD_ADDR(
-				msm_virt_to_dma(chip, &dma_buffer->cmdptr)));
-
-		/* if any of the writes failed (0x10), or there
-		 * was a protection violation (0x100), we lose
-		 */
-		pageerr = 0;
-		page_corrected = 0;
-		for (n = start_sector; n <= chip->last_sector; n++) {
-			uint32_t buf_stat =
-				dma_buffer->data.result[n].buffer_status;
-			if (buf_stat & BUF_STAT_UNCORRECTABLE) {
-				total_uncorrected++;
-				uncorrected[BIT_WORD(pages_read)] |=
-							BIT_MASK(pages_read);
-				pageerr = -EBADMSG;
-				break;
+				msm_virt_to_dma(chip, dma_buffer->cmdptr)));
+
+		for (p = 0; p < batch; p++) {
+			pg = &dma_buffer->pg[p];
+
+			/* if any of the writes failed (0x10), or there
+			 * was a protection violation (0x100), we lose
+			 */
+			pageerr = 0;
+			page_corrected = 0;
+			for (n = start_sector; n <= chip->last_sector; n++) {
+				uint32_t buf_stat =
+					pg->data.result[n].buffer_status;
+				if (buf_stat & BUF_STAT_UNCORRECTABLE) {
+					total_uncorrected++;
+					uncorrected[BIT_WORD(pages_read)] |=
+								BIT_MASK(pages_read);
+					pageerr = -EBADMSG;
+					break;
+				}
+				if (pg->data.result[n].flash_status & 0x110) {
+					pageerr = -EIO;
+					break;
+				}
+				sector_corrected =buf_stat & BUF_STAT_NUM_ERRS_MASK;
+				page_corrected += sector_corrected;
+				if (sector_corrected > 1)
+					pageerr = -EUCLEAN;
 			}
-			if (dma_buffer->data.result[n].flash_status & 0x110) {
-				pageerr = -EIO;
-				break;
+			if ((!pageerr && page_corrected) || pageerr == -EUCLEAN) {
+				total_corrected += page_corrected;
+				/* not thread safe */
+				mtd->ecc_stats.corrected += page_corrected;
 			}
-			sector_corrected =buf_stat & BUF_STAT_NUM_ERRS_MASK;
-			page_corrected += sector_corrected;
-			if (sector_corrected > 1)
-				pageerr = -EUCLEAN;
-		}
-		if ((!pageerr && page_corrected) || pageerr == -EUCLEAN) {
-			total_corrected += page_corrected;
-			/* not thread safe */
-			mtd->ecc_stats.corrected += page_corrected;
-		}
-		if (pageerr && (pageerr != -EUCLEAN || err == 0))
-			err = pageerr;
+			if (pageerr && (pageerr != -EUCLEAN || err == 0))
+				err = pageerr;
 
 #if VERBOSE
-		pr_info("status: %x %x %x %x %x %x %x %x "
-			"%x %x %x %x %x %x %x %x\n",
-			dma_buffer->data.result[0].flash_status,
-			dma_buffer->data.result[0].buffer_status,
-			dma_buffer->data.result[1].flash_status,
-			dma_buffer->data.result[1].buffer_status,
-			dma_buffer->data.result[2].flash_status,
-			dma_buffer->data.result[2].buffer_status,
-			dma_buffer->data.result[3].flash_status,
-			dma_buffer->data.result[3].buffer_status,
-			dma_buffer->data.result[4].flash_status,
-			dma_buffer->data.result[4].buffer_status,
-			dma_buffer->data.result[5].flash_status,
-			dma_buffer->data.result[5].buffer_status,
-			dma_buffer->data.result[6].flash_status,
-			dma_buffer->data.result[6].buffer_status,
-			dma_buffer->data.result[7].flash_status,
-			dma_buffer->data.result[7].buffer_status);
+			pr_info("status: %x %x %x %x %x %x %x %x "
+				"%x %x %x %x %x %x %x %x\n",
+				pg->data.result[0].flash_status,
+				pg->data.result[0].buffer_status,
+				pg->data.result[1].flash_status,
+				pg->data.result[1].buffer_status,
+				pg->data.result[2].flash_status,
+				pg->data.result[2].buffer_status,
+				pg->data.result[3].flash_status,
+				pg->data.result[3].buffer_status,
+				pg->data.result[4].flash_status,
+				pg->data.result[4].buffer_status,
+				pg->data.result[5].flash_status,
+				pg->data.result[5].buffer_status,
+				pg->data.result[6].flash_status,
+				pg->data.result[6].buffer_status,
+				pg->data.result[7].flash_status,
+				pg->data.result[7].buffer_status);
 #endif
-		if (err && err != -EUCLEAN && err != -EBADMSG)
+			if (err && err != -EUCLEAN && err != -EBADMSG)
+				break;
+			pages_read++;
+			page++;
+		}
+		if (p < batch) {
+			/* later pages of the batch do not count as read */
+			oob_len = oob_left[p];
 			break;
-		pages_read++;
-		page++;
+		}
+		page_count -= batch;
 	}
 	msm_nand_release_dma_buffer(chip, dma_buffer, sizeof(*dma_buffer));
 
@@ -748,9 +901,12 @@ err_dma_map_oobbuf_failed:
 							pages_read;
 	ops->oobretlen = ops->ooblen - oob_len;
 
-	if (err == -EBADMSG && msm_nand_check_empty(mtd, ops, uncorrected))
+	if (err == -EBADMSG && msm_nand_check_empty(mtd, ops, uncorrected)) {
 		err = 0;
-	else if (total_uncorrected)
+		for_each_set_bit(n, uncorrected, pages_read)
+			msm_nand_erased_seen(chip, (from >> chip->page_shift) + n,
+					     erased_gen);
+	} else if (total_uncorrected)
 		mtd->ecc_stats.failed += total_uncorrected; /* not threadsafe */
 	if (uncorrected != &uncorrected_noalloc)
 		kfree(uncorrected);
@@ -787,26 +943,30 @@ msm_nand_write_oob(struct mtd_info *mtd, loff_t to, struct mtd_oob_ops *ops)
 {
 	struct msm_nand_chip *chip = mtd->priv;
 	struct {
-		dmov_s cmd[8 * 6 + 3];
-		unsigned cmdptr;
 		struct {
-			uint32_t cmd;
-			uint32_t addr0;
-			uint32_t addr1;
-			uint32_t chipsel;
-			uint32_t cfg0;
-			uint32_t cfg1;
-			uint32_t exec;
+			dmov_s cmd[8 * 6 + 3];
+			struct {
+				uint32_t cmd;
+				uint32_t addr0;
+				uint32_t addr1;
+				uint32_t chipsel;
+				uint32_t cfg0;
+				uint32_t cfg1;
+				uint32_t exec;
 #if SUPPORT_WRONG_ECC_CONFIG
-			uint32_t ecccfg;
-			uint32_t ecccfg_restore;
+				uint32_t ecccfg;
+				uint32_t ecccfg_restore;
 #endif
-			uint32_t flash_status[8];
-			uint32_t zeroes;
-		} data;
+				uint32_t flash_status[8];
+				uint32_t zeroes;
+			} data;
+		} __aligned(8) pg[MSM_NAND_BATCH_PAGES];
+		unsigned cmdptr[MSM_NAND_BATCH_PAGES];
 	} *dma_buffer;
+	typeof(dma_buffer->pg[0]) *pg;
 	dmov_s *cmd;
-	unsigned n;
+	unsigned n, p, batch;
+	uint32_t oob_left[MSM_NAND_BATCH_PAGES];
 	unsigned page = to >> chip->page_shift;
 	uint32_t oob_len = ops->ooblen;
 	uint32_t sectordatawritesize;
@@ -815,7 +975,7 @@ msm_nand_write_oob(struct mtd_info *mtd, loff_t to, struct mtd_oob_ops *ops)
 	dma_addr_t oob_dma_addr = 0;
 	dma_addr_t data_dma_addr_curr = 0;
 	dma_addr_t oob_dma_addr_curr = 0;
-	unsigned page_count;
+	unsigned page_count, pages_total;
 	unsigned pages_written = 0;
 
 	if (to & (mtd->writesize - 1)) {
@@ -885,200 +1045,219 @@ msm_nand_write_oob(struct mtd_info *mtd, loff_t to, struct mtd_oob_ops *ops)
 		page_count = ops->len / mtd->writesize;
 	else
 		page_count = ops->len / (mtd->writesize + mtd->oobsize);
+	pages_total = page_count;
 
 	wait_event(chip->wait_queue, (dma_buffer =
 			msm_nand_get_dma_buffer(chip, sizeof(*dma_buffer))));
 
-	while (page_count-- > 0) {
-		cmd = dma_buffer->cmd;
+	err = 0;
+	while (page_count > 0) {
+		batch = min_t(unsigned, page_count, MSM_NAND_BATCH_PAGES);
+
+		/* one command list per page, chained through cmdptr[] */
+		for (p = 0; p < batch; p++) {
+			pg = &dma_buffer->pg[p];
+			cmd = pg->cmd;
+
+			/* CMD / ADDR0 / ADDR1 / CHIPSEL program values */
+			if (ops->mode != MTD_OOB_RAW) {
+				pg->data.cfg0 = chip->CFG0;
+				pg->data.cfg1 = chip->CFG1;
+			} else {
+				pg->data.cfg0 =
+					(MSM_NAND_CFG0_RAW & ~(7U << 6)) |
+					(chip->last_sector << 6);
+				pg->data.cfg1 = MSM_NAND_CFG1_RAW |
+					(chip->CFG1 & CFG1_WIDE_FLASH);
+			}
 
-		/* CMD / ADDR0 / ADDR1 / CHIPSEL program values */
-		if (ops->mode != MTD_OOB_RAW) {
-			dma_buffer->data.cfg0 = chip->CFG0;
-			dma_buffer->data.cfg1 = chip->CFG1;
-		} else {
-			dma_buffer->data.cfg0 =
-				(MSM_NAND_CFG0_RAW & ~(7U << 6)) |
-				(chip->last_sector << 6);
-			dma_buffer->data.cfg1 = MSM_NAND_CFG1_RAW |
-				(chip->CFG1 & CFG1_WIDE_FLASH);
-		}
+			pg->data.cmd = MSM_NAND_CMD_PRG_PAGE;
+			pg->data.addr0 = (page + p) << 16;
+			pg->data.addr1 = ((page + p) >> 16) & 0xff;
+			pg->data.chipsel = 0 | 4; /* flash0 + undoc bit */
+			pg->data.zeroes = 0;
+
+
+				/* GO bit for the EXEC register */
+			pg->data.exec = 1;
+
+			BUILD_BUG_ON(8 != ARRAY_SIZE(pg->data.flash_status));
+
+			for (n = 0; n <= chip->last_sector ; n++) {
+				/* status return words */
+				pg->data.flash_status[n] = 0xeeeeeeee;
+				/* block on cmd ready, then
+				 * write CMD / ADDR0 / ADDR1 / CHIPSEL regs in a burst
+				 */
+				cmd->cmd = DST_CRCI_NAND_CMD;
+				cmd->src =
+					msm_virt_to_dma(chip, &pg->data.cmd);
+				cmd->dst = MSM_NAND_FLASH_CMD;
+				if (n == 0)
+					cmd->len = 16;
+				else
+					cmd->len = 4;
+				cmd++;
 
-		dma_buffer->data.cmd = MSM_NAND_CMD_PRG_PAGE;
-		dma_buffer->data.addr0 = page << 16;
-		dma_buffer->data.addr1 = (page >> 16) & 0xff;
-		dma_buffer->data.chipsel = 0 | 4; /* flash0 + undoc bit */
-		dma_buffer->data.zeroes = 0;
+				if (n == 0) {
+					cmd->cmd = 0;
+					cmd->src = msm_virt_to_dma(chip,
+								&pg->data.cfg0);
+					cmd->dst = MSM_NAND_DEV0_CFG0;
+					cmd->len = 8;
+					cmd++;
+#if SUPPORT_WRONG_ECC_CONFIG
+					if (chip->saved_ecc_buf_cfg !=
+					    chip->ecc_buf_cfg) {
+						pg->data.ecccfg =
+							chip->ecc_buf_cfg;
+						cmd->cmd = 0;
+						cmd->src = msm_virt_to_dma(chip,
+							      &pg->data.ecccfg);
+						cmd->dst = MSM_NAND_EBI2_ECC_BUF_CFG;
+						cmd->len = 4;
+						cmd++;
+					}
+#endif
+				}
 
+					/* write data block */
+				if (ops->mode != MTD_OOB_RAW)
+					sectordatawritesize = (n < chip->last_sector) ?
+						516 : chip->last_sectorsz;
+				else
+					sectordatawritesize = 528;
 
-			/* GO bit for the EXEC register */
-		dma_buffer->data.exec = 1;
+				cmd->cmd = 0;
+				cmd->src = data_dma_addr_curr;
+				data_dma_addr_curr += sectordatawritesize;
+				cmd->dst = MSM_NAND_FLASH_BUFFER;
+				cmd->len = sectordatawritesize;
+				cmd++;
 
-		BUILD_BUG_ON(8 != ARRAY_SIZE(dma_buffer->data.flash_status));
+				if (ops->oobbuf) {
+					if (n == chip->last_sector) {
+						cmd->cmd = 0;
+						cmd->src = oob_dma_addr_curr;
+						cmd->dst = MSM_NAND_FLASH_BUFFER +
+							chip->last_sectorsz;
+						cmd->len = 516 - chip->last_sectorsz;
+						if (oob_len <= cmd->len)
+							cmd->len = oob_len;
+						oob_dma_addr_curr += cmd->len;
+						oob_len -= cmd->len;
+						if (cmd->len > 0)
+							cmd++;
+					}
+					if (ops->mode != MTD_OOB_AUTO) {
+						/* skip ecc bytes in oobbuf */
+						if (oob_len < 10) {
+							oob_dma_addr_curr += 10;
+							oob_len -= 10;
+						} else {
+							oob_dma_addr_curr += oob_len;
+							oob_len = 0;
+						}
+					}
+				}
 
-		for (n = 0; n <= chip->last_sector ; n++) {
-			/* status return words */
-			dma_buffer->data.flash_status[n] = 0xeeeeeeee;
-			/* block on cmd ready, then
-			 * write CMD / ADDR0 / ADDR1 / CHIPSEL regs in a burst
-			 */
-			cmd->cmd = DST_CRCI_NAND_CMD;
-			cmd->src =
-				msm_virt_to_dma(chip, &dma_buffer->data.cmd);
-			cmd->dst = MSM_NAND_FLASH_CMD;
-			if (n == 0)
-				cmd->len = 16;
-			else
+				/* kick the execute register */
+				cmd->cmd = 0;
+				cmd->src =
+					msm_virt_to_dma(chip, &pg->data.exec);
+				cmd->dst = MSM_NAND_EXEC_CMD;
 				cmd->len = 4;
-			cmd++;
+				cmd++;
+
+				/* block on data ready, then
+				 * read the status register
+				 */
+				cmd->cmd = SRC_CRCI_NAND_DATA;
+				cmd->src = MSM_NAND_FLASH_STATUS;
+				cmd->dst = msm_virt_to_dma(chip,
+						     &pg->data.flash_status[n]);
+				cmd->len = 4;
+				cmd++;
 
-			if (n == 0) {
+				/* clear the status register in case the OP_ERR is set
+				 * due to the write, to work around a h/w bug */
 				cmd->cmd = 0;
 				cmd->src = msm_virt_to_dma(chip,
-							&dma_buffer->data.cfg0);
-				cmd->dst = MSM_NAND_DEV0_CFG0;
-				cmd->len = 8;
+							   &pg->data.zeroes);
+				cmd->dst = MSM_NAND_FLASH_STATUS;
+				cmd->len = 4;
 				cmd++;
-#if SUPPORT_WRONG_ECC_CONFIG
-				if (chip->saved_ecc_buf_cfg !=
-				    chip->ecc_buf_cfg) {
-					dma_buffer->data.ecccfg =
-						chip->ecc_buf_cfg;
-					cmd->cmd = 0;
-					cmd->src = msm_virt_to_dma(chip,
-						      &dma_buffer->data.ecccfg);
-					cmd->dst = MSM_NAND_EBI2_ECC_BUF_CFG;
-					cmd->len = 4;
-					cmd++;
-				}
-#endif
 			}
-
-				/* write data block */
-			if (ops->mode != MTD_OOB_RAW)
-				sectordatawritesize = (n < chip->last_sector) ?
-					516 : chip->last_sectorsz;
-			else
-				sectordatawritesize = 528;
-
-			cmd->cmd = 0;
-			cmd->src = data_dma_addr_curr;
-			data_dma_addr_curr += sectordatawritesize;
-			cmd->dst = MSM_NAND_FLASH_BUFFER;
-			cmd->len = sectordatawritesize;
-			cmd++;
-
-			if (ops->oobbuf) {
-				if (n == chip->last_sector) {
-					cmd->cmd = 0;
-					cmd->src = oob_dma_addr_curr;
-					cmd->dst = MSM_NAND_FLASH_BUFFER +
-						chip->last_sectorsz;
-					cmd->len = 516 - chip->last_sectorsz;
-					if (oob_len <= cmd->len)
-						cmd->len = oob_len;
-					oob_dma_addr_curr += cmd->len;
-					oob_len -= cmd->len;
-					if (cmd->len > 0)
-						cmd++;
-				}
-				if (ops->mode != MTD_OOB_AUTO) {
-					/* skip ecc bytes in oobbuf */
-					if (oob_len < 10) {
-						oob_dma_addr_curr += 10;
-						oob_len -= 10;
-					} else {
-						oob_dma_addr_curr += oob_len;
-						oob_len = 0;
-					}
-				}
+#if SUPPORT_WRONG_ECC_CONFIG
+			if (chip->saved_ecc_buf_cfg != chip->ecc_buf_cfg) {
+				pg->data.ecccfg_restore =
+					chip->saved_ecc_buf_cfg;
+				cmd->cmd = 0;
+				cmd->src = msm_virt_to_dma(chip,
+						      &pg->data.ecccfg_restore);
+				cmd->dst = MSM_NAND_EBI2_ECC_BUF_CFG;
+				cmd->len = 4;
+				cmd++;
 			}
+#endif
+			pg->cmd[0].cmd |= CMD_OCB;
+			cmd[-1].cmd |= CMD_OCU | CMD_LC;
+			BUG_ON(cmd - pg->cmd > ARRAY_SIZE(pg->cmd));
 
-			/* kick the execute register */
-			cmd->cmd = 0;
-			cmd->src =
-				msm_virt_to_dma(chip, &dma_buffer->data.exec);
-			cmd->dst = MSM_NAND_EXEC_CMD;
-			cmd->len = 4;
-			cmd++;
-
-			/* block on data ready, then
-			 * read the status register
-			 */
-			cmd->cmd = SRC_CRCI_NAND_DATA;
-			cmd->src = MSM_NAND_FLASH_STATUS;
-			cmd->dst = msm_virt_to_dma(chip,
-					     &dma_buffer->data.flash_status[n]);
-			cmd->len = 4;
-			cmd++;
-
-			/* clear the status register in case the OP_ERR is set
-			 * due to the write, to work around a h/w bug */
-			cmd->cmd = 0;
-			cmd->src = msm_virt_to_dma(chip,
-						   &dma_buffer->data.zeroes);
-			cmd->dst = MSM_NAND_FLASH_STATUS;
-			cmd->len = 4;
-			cmd++;
+			dma_buffer->cmdptr[p] =
+				msm_virt_to_dma(chip, pg->cmd) >> 3;
+			oob_left[p] = oob_len;
 		}
-#if SUPPORT_WRONG_ECC_CONFIG
-		if (chip->saved_ecc_buf_cfg != chip->ecc_buf_cfg) {
-			dma_buffer->data.ecccfg_restore =
-				chip->saved_ecc_buf_cfg;
-			cmd->cmd = 0;
-			cmd->src = msm_virt_to_dma(chip,
-					      &dma_buffer->data.ecccfg_restore);
-			cmd->dst = MSM_NAND_EBI2_ECC_BUF_CFG;
-			cmd->len = 4;
-			cmd++;
-		}
-#endif
-		dma_buffer->cmd[0].cmd |= CMD_OCB;
-		cmd[-1].cmd |= CMD_OCU | CMD_LC;
-		BUILD_BUG_ON(8 * 6 + 3 != ARRAY_SIZE(dma_buffer->cmd));
-		BUG_ON(cmd - dma_buffer->cmd > ARRAY_SIZE(dma_buffer->cmd));
-		dma_buffer->cmdptr =
-			(msm_virt_to_dma(chip, dma_buffer->cmd) >> 3) |
-			CMD_PTR_LP;
+		BUILD_BUG_ON(8 * 6 + 3 != ARRAY_SIZE(dma_buffer->pg[0].cmd));
+		dma_buffer->cmdptr[batch - 1] |= CMD_PTR_LP;
 
 		msm_dmov_exec_cmd(chip->dma_channel,
 			DMOV_CMD_PTR_LIST | DMOV_CMD_ADDR(
-				msm_virt_to_dma(chip, &dma_buffer->cmdptr)));
+				msm_virt_to_dma(chip, dma_buffer->cmdptr)));
 
-		/* if any of the writes failed (0x10), or there was a
-		 * protection violation (0x100), or the program success
-		 * bit (0x80) is unset, we lose
-		 */
-		err = 0;
-		for (n = 0; n <= chip->last_sector ; n++) {
-			if (dma_buffer->data.flash_status[n] & 0x110) {
-				if (dma_buffer->data.flash_status[n] & 0x10)
-					pr_err("msm_nand: critical write error,"
-					       " 0x%x(%d)\n", page, n);
-				err = -EIO;
-				break;
-			}
-			if (!(dma_buffer->data.flash_status[n] & 0x80)) {
-				err = -EIO;
-				break;
+		for (p = 0; p < batch; p++) {
+			pg = &dma_buffer->pg[p];
+
+			/* if any of the writes failed (0x10), or there was a
+			 * protection violation (0x100), or the program success
+			 * bit (0x80) is unset, we lose
+			 */
+			for (n = 0; n <= chip->last_sector ; n++) {
+				if (pg->data.flash_status[n] & 0x110) {
+					if (pg->data.flash_status[n] & 0x10)
+						pr_err("msm_nand: critical write error,"
+						       " 0x%x(%d)\n", page, n);
+					err = -EIO;
+					break;
+				}
+				if (!(pg->data.flash_status[n] & 0x80)) {
+					err = -EIO;
+					break;
+				}
 			}
-		}
 
 #if VERBOSE
-		pr_info("write page %d: status: %x %x %x %x %x %x %x %x\n",
-			page, dma_buffer->data.flash_status[0],
-			dma_buffer->data.flash_status[1],
-			dma_buffer->data.flash_status[2],
-			dma_buffer->data.flash_status[3],
-			dma_buffer->data.flash_status[4],
-			dma_buffer->data.flash_status[5],
-			dma_buffer->data.flash_status[6],
-			dma_buffer->data.flash_status[7]);
+			pr_info("write page %d: status: %x %x %x %x %x %x %x %x\n",
+				page, pg->data.flash_status[0],
+				pg->data.flash_status[1],
+				pg->data.flash_status[2],
+				pg->data.flash_status[3],
+				pg->data.flash_status[4],
+				pg->data.flash_status[5],
+				pg->data.flash_status[6],
+				pg->data.flash_status[7]);
 #endif
-		if (err)
+			if (err)
+				break;
+			pages_written++;
+			page++;
+		}
+		if (p < batch) {
+			/* later pages of the batch do not count as written */
+			oob_len = oob_left[p];
 			break;
-		pages_written++;
-		page++;
+		}
+		page_count -= batch;
 	}
 	if (ops->mode != MTD_OOB_RAW)
 		ops->retlen = mtd->writesize * pages_written;
@@ -1087,6 +1266,10 @@ msm_nand_write_oob(struct mtd_info *mtd, loff_t to, struct mtd_oob_ops *ops)
 
 	ops->oobretlen = ops->ooblen - oob_len;
 
+	/* a failed batch may have programmed pages past the failing one */
+	msm_nand_erased_update(chip, to >> chip->page_shift,
+			       err ? pages_total : pages_written, false, err);
+
 	msm_nand_release_dma_buffer(chip, dma_buffer, sizeof(*dma_buffer));
 
 	if (ops->oobbuf)
@@ -1206,6 +1389,7 @@ msm_nand_erase(struct mtd_info *mtd, struct erase_info *instr)
 		err = 0;
 
 	msm_nand_release_dma_buffer(chip, dma_buffer, sizeof(*dma_buffer));
+	msm_nand_erased_update(chip, page, 1, true, err);
 	if (err) {
 		pr_err("%s: erase failed, 0x%llx\n", __func__, instr->addr);
 		instr->fail_addr = instr->addr;
@@ -1522,6 +1706,20 @@ int msm_nand_scan(struct mtd_info *mtd, int maxchips)
 	chip->saved_ecc_buf_cfg = n;
 #endif
 
+	/* the erased page cache is an optimisation, run without it on -ENOMEM */
+	spin_lock_init(&chip->erased_lock);
+	chip->block_shift = ffs(mtd->erasesize) - 1 - chip->page_shift;
+	if (!chip->erased_from && (1U << chip->block_shift) <
+	    MSM_NAND_ERASED_UNKNOWN) {
+		chip->erased_from = kmalloc(mtd->size >>
+				(chip->block_shift + chip->page_shift),
+				GFP_KERNEL);
+		if (chip->erased_from)
+			memset(chip->erased_from, MSM_NAND_ERASED_UNKNOWN,
+			       mtd->size >> (chip->block_shift +
+					     chip->page_shift));
+	}
+
 	/* Fill in remaining MTD driver data */
 	mtd->type = MTD_NANDFLASH;
 	mtd->flags = MTD_CAP_NANDFLASH;
@@ -1556,7 +1754,7 @@ EXPORT_SYMBOL_GPL(msm_nand_scan);
  */
 void msm_nand_release(struct mtd_info *mtd)
 {
-	/* struct msm_nand_chip *this = mtd->priv; */
+	struct msm_nand_chip *chip = mtd->priv;
 
 #ifdef CONFIG_MTD_PARTITIONS
 	/* Deregister partitions */
@@ -1564,6 +1762,9 @@ void msm_nand_release(struct mtd_info *mtd)
 #endif
 	/* Deregister the device */
 	del_mtd_device(mtd);
+
+	kfree(chip->erased_from);
+	chip->erased_from = NULL;
 }
 EXPORT_SYMBOL_GPL(msm_nand_release);
 
@@ -1642,7 +1843,8 @@ static int __devinit msm_nand_probe(struct platform_device *pdev)
 	return 0;
 
 out_free_dma_buffer:
-	dma_free_coherent(/*dev*/ NULL, SZ_4K, info->msm_nand.dma_buffer,
+	dma_free_coherent(/*dev*/ NULL, MSM_NAND_DMA_BUFFER_SIZE,
+			  info->msm_nand.dma_buffer,
 			  info->msm_nand.dma_addr);
 out_free_info:
 	kfree(info);
@@ -1665,7 +1867,7 @@ static int __devexit msm_nand_remove(struct platform_device *pdev)
 			del_mtd_device(&info->mtd);
 
 		msm_nand_release(&info->mtd);
-		dma_free_coherent(/*dev*/ NULL, SZ_4K,
+		dma_free_coherent(/*dev*/ NULL, MSM_NAND_DMA_BUFFER_SIZE,
 				  info->msm_nand.dma_buffer,
 				  info->msm_nand.dma_addr);
 		kfree(info);
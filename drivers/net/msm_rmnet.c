@@ -38,12 +38,42 @@
 #define SMD_PORT_ETHER0 11
 #define POLL_DELAY 1000000 /* 1 second delay interval */
 
+#define RMNET_NAPI_WEIGHT 64
+#define RMNET_MAX_PACKET 1514
+#define RMNET_RX_BUF (RMNET_MAX_PACKET + NET_IP_ALIGN)
+#define RMNET_RX_POOL 32 /* transmitted skbs kept for receive */
+
+/*
+ * Transmit flow control. The queue is stopped once tx_limit bytes sit
+ * in the SMD FIFO and woken when the modem has read it down to half of
+ * that. The limit grows when the FIFO runs dry while the queue is
+ * stopped, and shrinks by the lowest backlog seen over a window in
+ * which the queue had to be stopped, so that only what the link needs
+ * waits in the modem.
+ */
+#define RMNET_TX_LIMIT_MIN (2 * RMNET_MAX_PACKET)
+#define RMNET_TX_LIMIT_INIT (4 * RMNET_MAX_PACKET)
+#define RMNET_TX_LIMIT_MAX (64 * 1024)
+#define RMNET_TX_WINDOW HZ
+
 struct rmnet_private
 {
 	smd_channel_t *ch;
 	struct net_device_stats stats;
 	const char *chname;
 	struct wake_lock wake_lock;
+	struct napi_struct napi;
+	struct sk_buff_head rx_pool;
+
+	spinlock_t tx_lock; /* protects the flow control state below */
+	unsigned int tx_limit;
+	unsigned int tx_low; /* lowest backlog seen in this window */
+	int tx_stopped; /* queue was stopped in this window */
+	unsigned long tx_window;
+	unsigned long tx_stops;
+	unsigned long tx_wakes;
+	unsigned long tx_starved;
+	unsigned long tx_full;
 #ifdef CONFIG_MSM_RMNET_DEBUG
 	ktime_t last_packet;
 	short active_countdown; /* Number of times left to check */
@@ -247,66 +277,142 @@ DEVICE_ATTR(awake_time_ms, 0444, awake_time_show, NULL);
 
 #endif
 
-/* Called in soft-irq context */
-static void smd_net_data_handler(unsigned long arg)
+static struct sk_buff *rmnet_alloc_rx_skb(struct net_device *dev, int sz)
 {
-	struct net_device *dev = (struct net_device *) arg;
 	struct rmnet_private *p = netdev_priv(dev);
 	struct sk_buff *skb;
-	void *ptr = 0;
+
+	skb = skb_dequeue(&p->rx_pool);
+	if (!skb)
+		skb = dev_alloc_skb(sz + NET_IP_ALIGN);
+	if (skb) {
+		skb->dev = dev;
+		skb_reserve(skb, NET_IP_ALIGN);
+	}
+	return skb;
+}
+
+/*
+ * Called in soft-irq context. Packets are copied straight from the SMD
+ * FIFO into the skb; the FIFO is shared memory that the modem refills,
+ * so it cannot be handed up the stack in place. The wake lock and the
+ * statistics and wakeup accounting are done once per poll.
+ */
+static int rmnet_poll(struct napi_struct *napi, int budget)
+{
+	struct rmnet_private *p = container_of(napi, struct rmnet_private, napi);
+	struct net_device *dev = napi->dev;
+	struct sk_buff *skb;
+	unsigned long rx_packets = 0, rx_bytes = 0;
+	void *ptr;
+	int done = 0;
 	int sz;
 
-	for (;;) {
+	while (done < budget) {
 		sz = smd_cur_packet_size(p->ch);
 		if (sz == 0) break;
 		if (smd_read_avail(p->ch) < sz) break;
+		done++;
 
-		if (sz > 1514) {
+		if (sz > RMNET_MAX_PACKET) {
 			pr_err("[RIL] rmnet_recv() discarding %d len\n", sz);
-			ptr = 0;
+			skb = NULL;
 		} else {
-			skb = dev_alloc_skb(sz + NET_IP_ALIGN);
-			if (skb == NULL) {
+			skb = rmnet_alloc_rx_skb(dev, sz);
+			if (skb == NULL)
 				pr_err("[RIL] rmnet_recv() cannot allocate skb\n");
-			} else {
-				skb->dev = dev;
-				skb_reserve(skb, NET_IP_ALIGN);
-				ptr = skb_put(skb, sz);
-				wake_lock_timeout(&p->wake_lock, HZ / 2);
-				if (smd_read(p->ch, ptr, sz) != sz) {
-					pr_err("[RIL] rmnet_recv() smd lied about avail?!");
-					ptr = 0;
-					dev_kfree_skb_irq(skb);
-				} else {
-					skb->protocol = eth_type_trans(skb, dev);
-					if (count_this_packet(ptr, skb->len)) {
-#ifdef CONFIG_MSM_RMNET_DEBUG
-						p->wakeups_rcv +=
-							rmnet_cause_wakeup(p);
-#endif
-						p->stats.rx_packets++;
-						p->stats.rx_bytes += skb->len;
-					}
-					netif_rx(skb);
-				}
-				continue;
-			}
 		}
-		if (smd_read(p->ch, ptr, sz) != sz)
+		if (skb == NULL) {
+			if (smd_read(p->ch, NULL, sz) != sz)
+				pr_err("[RIL] rmnet_recv() smd lied about avail?!");
+			continue;
+		}
+
+		ptr = skb_put(skb, sz);
+		if (smd_read(p->ch, ptr, sz) != sz) {
 			pr_err("[RIL] rmnet_recv() smd lied about avail?!");
+			dev_kfree_skb(skb);
+			continue;
+		}
+
+		skb->protocol = eth_type_trans(skb, dev);
+		if (count_this_packet(ptr, skb->len)) {
+			rx_packets++;
+			rx_bytes += skb->len;
+		}
+		napi_gro_receive(napi, skb);
+	}
+
+	if (done)
+		wake_lock_timeout(&p->wake_lock, HZ / 2);
+	if (rx_packets) {
+#ifdef CONFIG_MSM_RMNET_DEBUG
+		p->wakeups_rcv += rmnet_cause_wakeup(p);
+#endif
+		p->stats.rx_packets += rx_packets;
+		p->stats.rx_bytes += rx_bytes;
+	}
+
+	if (done < budget) {
+		napi_complete(napi);
+		/* a packet completed after the last check sent no new event */
+		sz = smd_cur_packet_size(p->ch);
+		if (sz && smd_read_avail(p->ch) >= sz)
+			napi_reschedule(napi);
 	}
+	return done;
 }
 
-static DECLARE_TASKLET(smd_net_data_tasklet, smd_net_data_handler, 0);
+/* Called on SMD events, which include the modem reading our data */
+static void rmnet_tx_update(struct net_device *dev)
+{
+	struct rmnet_private *p = netdev_priv(dev);
+	unsigned long flags;
+	unsigned int queued;
+
+	spin_lock_irqsave(&p->tx_lock, flags);
+	queued = smd_write_queued(p->ch);
+
+	if (netif_queue_stopped(dev) && queued == 0) {
+		/* the link went idle with packets waiting: too little queued */
+		p->tx_starved++;
+		p->tx_limit = min(p->tx_limit + RMNET_MAX_PACKET,
+				  (unsigned int) RMNET_TX_LIMIT_MAX);
+		p->tx_low = UINT_MAX;
+		p->tx_stopped = 0;
+		p->tx_window = jiffies;
+	} else {
+		if (queued < p->tx_low)
+			p->tx_low = queued;
+		if (time_after(jiffies, p->tx_window + RMNET_TX_WINDOW)) {
+			/* never drained below tx_low: that much was not needed */
+			if (p->tx_stopped && p->tx_low != UINT_MAX)
+				p->tx_limit = max(p->tx_limit - min(p->tx_low,
+							p->tx_limit),
+						  (unsigned int) RMNET_TX_LIMIT_MIN);
+			p->tx_low = UINT_MAX;
+			p->tx_stopped = 0;
+			p->tx_window = jiffies;
+		}
+	}
+
+	if (netif_running(dev) && netif_queue_stopped(dev) &&
+	    queued <= p->tx_limit / 2) {
+		p->tx_wakes++;
+		netif_wake_queue(dev);
+	}
+	spin_unlock_irqrestore(&p->tx_lock, flags);
+}
 
 static void smd_net_notify(void *_dev, unsigned event)
 {
+	struct rmnet_private *p = netdev_priv((struct net_device *) _dev);
+
 	if (event != SMD_EVENT_DATA)
 		return;
 
-	smd_net_data_tasklet.data = (unsigned long) _dev;
-
-	tasklet_schedule(&smd_net_data_tasklet);
+	rmnet_tx_update(_dev);
+	napi_schedule(&p->napi);
 }
 
 static int rmnet_open(struct net_device *dev)
@@ -315,11 +421,17 @@ static int rmnet_open(struct net_device *dev)
 	struct rmnet_private *p = netdev_priv(dev);
 
 	pr_info("[RIL] rmnet_open()\n");
+	napi_enable(&p->napi);
 	if (!p->ch) {
 		r = smd_open(p->chname, &p->ch, dev, smd_net_notify);
 
-		if (r < 0)
+		if (r < 0) {
+			napi_disable(&p->napi);
 			return -ENODEV;
+		}
+	} else {
+		/* the channel stays open while down; pick up what queued */
+		napi_schedule(&p->napi);
 	}
 
 	netif_start_queue(dev);
@@ -328,8 +440,12 @@ static int rmnet_open(struct net_device *dev)
 
 static int rmnet_stop(struct net_device *dev)
 {
+	struct rmnet_private *p = netdev_priv(dev);
+
 	pr_info("[RIL] rmnet_stop()\n");
 	netif_stop_queue(dev);
+	napi_disable(&p->napi);
+	skb_queue_purge(&p->rx_pool);
 	return 0;
 }
 
@@ -337,23 +453,67 @@ static int rmnet_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	struct rmnet_private *p = netdev_priv(dev);
 	smd_channel_t *ch = p->ch;
+	unsigned long flags;
+	unsigned int queued;
 
 	if (smd_write(ch, skb->data, skb->len) != skb->len) {
-		pr_err("[RIL] rmnet fifo full, dropping packet\n");
-	} else {
-		if (count_this_packet(skb->data, skb->len)) {
-			p->stats.tx_packets++;
-			p->stats.tx_bytes += skb->len;
+		/* the limit is past what the FIFO holds; hold the packet */
+		spin_lock_irqsave(&p->tx_lock, flags);
+		queued = smd_write_queued(ch);
+		p->tx_full++;
+		p->tx_stops++;
+		p->tx_stopped = 1;
+		p->tx_limit = max(queued, (unsigned int) RMNET_TX_LIMIT_MIN);
+		netif_stop_queue(dev);
+		spin_unlock_irqrestore(&p->tx_lock, flags);
+		return NETDEV_TX_BUSY;
+	}
+
+	if (count_this_packet(skb->data, skb->len)) {
+		p->stats.tx_packets++;
+		p->stats.tx_bytes += skb->len;
 #ifdef CONFIG_MSM_RMNET_DEBUG
-			p->wakeups_xmit += rmnet_cause_wakeup(p);
+		p->wakeups_xmit += rmnet_cause_wakeup(p);
 #endif
-		}
 	}
 
-	dev_kfree_skb_irq(skb);
+	spin_lock_irqsave(&p->tx_lock, flags);
+	queued = smd_write_queued(ch);
+	if (queued >= p->tx_limit) {
+		p->tx_stops++;
+		p->tx_stopped = 1;
+		netif_stop_queue(dev);
+	}
+	spin_unlock_irqrestore(&p->tx_lock, flags);
+
+	/* the data has been copied out, keep the buffer for receive */
+	if (skb_queue_len(&p->rx_pool) < RMNET_RX_POOL &&
+	    skb_recycle_check(skb, RMNET_RX_BUF))
+		skb_queue_head(&p->rx_pool, skb);
+	else
+		dev_kfree_skb_irq(skb);
 	return 0;
 }
 
+/* Show the transmit flow control state and counters */
+static ssize_t tx_queue_show(struct device *d, struct device_attribute *attr,
+			     char *buf)
+{
+	struct rmnet_private *p = netdev_priv(to_net_dev(d));
+	unsigned long flags;
+	ssize_t n;
+
+	spin_lock_irqsave(&p->tx_lock, flags);
+	n = sprintf(buf, "limit %u queued %d stops %lu wakes %lu "
+		    "starved %lu full %lu\n", p->tx_limit,
+		    p->ch ? smd_write_queued(p->ch) : 0, p->tx_stops,
+		    p->tx_wakes, p->tx_starved, p->tx_full);
+	spin_unlock_irqrestore(&p->tx_lock, flags);
+	return n;
+}
+
+static DEVICE_ATTR(tx_queue, 0444, tx_queue_show, NULL);
+
 static struct net_device_stats *rmnet_get_stats(struct net_device *dev)
 {
 	struct rmnet_private *p = netdev_priv(dev);
@@ -385,6 +545,7 @@ static void __init rmnet_setup(struct net_device *dev)
 	dev->watchdog_timeo = 20; /* ??? */
 
 	ether_setup(dev);
+	dev->features |= NETIF_F_GRO;
 
 	//dev->change_mtu = 0; /* ??? */
 
@@ -428,6 +589,12 @@ static int __init rmnet_init(void)
 		p = netdev_priv(dev);
 		p->chname = ch_name[n];
 		wake_lock_init(&p->wake_lock, WAKE_LOCK_SUSPEND, ch_name[n]);
+		skb_queue_head_init(&p->rx_pool);
+		netif_napi_add(dev, &p->napi, rmnet_poll, RMNET_NAPI_WEIGHT);
+		spin_lock_init(&p->tx_lock);
+		p->tx_limit = RMNET_TX_LIMIT_INIT;
+		p->tx_low = UINT_MAX;
+		p->tx_window = jiffies;
 #ifdef CONFIG_MSM_RMNET_DEBUG
 		p->timeout_us = timeout_us;
 		p->awake_time_ms = p->wakeups_xmit = p->wakeups_rcv = 0;
@@ -441,6 +608,8 @@ static int __init rmnet_init(void)
 			return ret;
 		}
 
+		if (device_create_file(d, &dev_attr_tx_queue))
+			continue;
 #ifdef CONFIG_MSM_RMNET_DEBUG
 		if (device_create_file(d, &dev_attr_timeout))
 			continue;
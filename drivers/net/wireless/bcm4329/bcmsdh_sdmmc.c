@@ -35,6 +35,9 @@
 #include <sdiovar.h>	/* ioctl/iovars */
 
 #include <linux/mmc/core.h>
+#include <linux/mmc/card.h>
+#include <linux/mmc/host.h>
+#include <linux/mmc/sdio.h>
 #include <linux/mmc/sdio_func.h>
 #include <linux/mmc/sdio_ids.h>
 
@@ -375,7 +378,8 @@ enum {
 	IOV_HCIREGS,
 	IOV_POWER,
 	IOV_CLOCK,
-	IOV_RXCHAIN
+	IOV_RXCHAIN,
+	IOV_SGENTRY_ALIGN
 };
 
 const bcm_iovar_t sdioh_iovars[] = {
@@ -394,6 +398,7 @@ const bcm_iovar_t sdioh_iovars[] = {
 	{"sd_mode", 	IOV_SDMODE, 	0,	IOVT_UINT32,	100},
 	{"sd_highspeed", IOV_HISPEED,	0,	IOVT_UINT32,	0 },
 	{"sd_rxchain",  IOV_RXCHAIN,    0, 	IOVT_BOOL,	0 },
+	{"sd_sgentry_align", IOV_SGENTRY_ALIGN, 0, IOVT_UINT32,	0 },
 	{NULL, 0, 0, 0, 0 }
 };
 
@@ -505,7 +510,12 @@ sdioh_iovar_op(sdioh_info_t *si, const char *name,
 	}
 
 	case IOV_GVAL(IOV_RXCHAIN):
-		int_val = FALSE;
+		int_val = TRUE;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_GVAL(IOV_SGENTRY_ALIGN):
+		int_val = SDIOH_SDMMC_SGENTRY_ALIGN;
 		bcopy(&int_val, arg, val_size);
 		break;
 
@@ -884,6 +894,104 @@ sdioh_request_word(sdioh_info_t *sd, uint cmd_type, uint rw, uint func, uint add
 	return ((err_ret == 0) ? SDIOH_API_RC_SUCCESS : SDIOH_API_RC_FAIL);
 }
 
+/*
+ * Map a packet chain into sd->sg_list for a single block mode CMD53.
+ * Returns the number of entries, or 0 if the chain cannot be sent that
+ * way and has to go out one packet at a time.
+ */
+static uint
+sdioh_chain_to_sg(sdioh_info_t *sd, struct sdio_func *sdio_func, void *pkt,
+                  uint *ttl_len)
+{
+	struct mmc_host *host = sdio_func->card->host;
+	uint blk_size = sdio_func->cur_blksize;
+	uint sg_count = 0;
+	void *pnext;
+
+	*ttl_len = 0;
+
+	if (!sdio_func->card->cccr.multi_block)
+		return 0;
+
+	sg_init_table(sd->sg_list, SDIOH_SDMMC_MAX_SG_ENTRIES);
+	for (pnext = pkt; pnext; pnext = PKTNEXT(sd->osh, pnext)) {
+		uint pkt_len = PKTLEN(sd->osh, pnext);
+
+		if (sg_count == SDIOH_SDMMC_MAX_SG_ENTRIES ||
+		    sg_count == host->max_hw_segs ||
+		    (pkt_len % SDIOH_SDMMC_SGENTRY_ALIGN) ||
+		    ((uint32)PKTDATA(sd->osh, pnext) & DMA_ALIGN_MASK))
+			return 0;
+
+		sg_set_buf(&sd->sg_list[sg_count++], PKTDATA(sd->osh, pnext),
+		           pkt_len);
+		*ttl_len += pkt_len;
+	}
+
+	/* CMD53 carries a 9 bit block count */
+	if (!blk_size || (*ttl_len % blk_size) ||
+	    (*ttl_len / blk_size) > MIN(host->max_blk_count, 511) ||
+	    *ttl_len > host->max_req_size)
+		return 0;
+
+	sg_mark_end(&sd->sg_list[sg_count - 1]);
+	return sg_count;
+}
+
+/*
+ * Send a whole packet chain, e.g. a glommed superframe, as one CMD53 so
+ * that the host moves it with a single chained DMA and one completion
+ * instead of a request per subframe. Called with the host claimed.
+ */
+static int
+sdioh_request_packet_chain(sdioh_info_t *sd, uint fifo, uint write,
+                           struct sdio_func *sdio_func, uint addr,
+                           uint sg_count, uint ttl_len)
+{
+	struct mmc_request mrq;
+	struct mmc_command cmd;
+	struct mmc_data data;
+
+	memset(&mrq, 0, sizeof(struct mmc_request));
+	memset(&cmd, 0, sizeof(struct mmc_command));
+	memset(&data, 0, sizeof(struct mmc_data));
+
+	mrq.cmd = &cmd;
+	mrq.data = &data;
+
+	cmd.opcode = SD_IO_RW_EXTENDED;
+	cmd.arg = write ? 0x80000000 : 0x00000000;
+	cmd.arg |= sdio_func->num << 28;
+	cmd.arg |= 0x08000000;			/* block mode */
+	cmd.arg |= fifo ? 0 : 0x04000000;	/* incrementing address */
+	cmd.arg |= (addr & 0x1FFFF) << 9;
+	cmd.arg |= ttl_len / sdio_func->cur_blksize;
+	cmd.flags = MMC_RSP_SPI_R5 | MMC_RSP_R5 | MMC_CMD_ADTC;
+
+	data.blksz = sdio_func->cur_blksize;
+	data.blocks = ttl_len / sdio_func->cur_blksize;
+	data.flags = write ? MMC_DATA_WRITE : MMC_DATA_READ;
+	data.sg = sd->sg_list;
+	data.sg_len = sg_count;
+
+	mmc_set_data_timeout(&data, sdio_func->card);
+
+	mmc_wait_for_req(sdio_func->card->host, &mrq);
+
+	if (cmd.error)
+		return cmd.error;
+	if (data.error)
+		return data.error;
+	if (cmd.resp[0] & R5_ERROR)
+		return -EIO;
+	if (cmd.resp[0] & R5_FUNCTION_NUMBER)
+		return -EINVAL;
+	if (cmd.resp[0] & R5_OUT_OF_RANGE)
+		return -ERANGE;
+
+	return 0;
+}
+
 static SDIOH_API_RC
 sdioh_request_packet(sdioh_info_t *sd, uint fix_inc, uint write, uint func,
                      uint addr, void *pkt)
@@ -902,6 +1010,25 @@ sdioh_request_packet(sdioh_info_t *sd, uint fix_inc, uint write, uint func,
 
 	/* Claim host controller */
 	sdio_claim_host(gInstance->func[func]);
+
+	if (PKTNEXT(sd->osh, pkt)) {
+		uint ttl_len;
+
+		SGCount = sdioh_chain_to_sg(sd, gInstance->func[func], pkt,
+		                            &ttl_len);
+		if (SGCount) {
+			err_ret = sdioh_request_packet_chain(sd, fifo, write,
+			                                     gInstance->func[func],
+			                                     addr, SGCount, ttl_len);
+			if (err_ret)
+				sd_err(("%s: %s chain of %d FAILED, addr=0x%05x, "
+				        "len=%d, ERR=0x%08x\n", __FUNCTION__,
+				        write ? "TX" : "RX", SGCount, addr,
+				        ttl_len, err_ret));
+			goto release;
+		}
+	}
+
 	for (pnext = pkt; pnext; pnext = PKTNEXT(sd->osh, pnext)) {
 		uint pkt_len = PKTLEN(sd->osh, pnext);
 		pkt_len += 3;
@@ -958,6 +1085,7 @@ sdioh_request_packet(sdioh_info_t *sd, uint fix_inc, uint write, uint func,
 
 	}
 
+release:
 	/* Release host controller */
 	sdio_release_host(gInstance->func[func]);
 
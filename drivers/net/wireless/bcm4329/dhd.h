@@ -459,7 +459,11 @@ void dhd_arp_offload_add_ip(dhd_pub_t *dhd, u32 ipaddr);
 #define DHD_BROADCAST_FILTER_NUM       1
 #define DHD_MULTICAST4_FILTER_NUM      2
 #define DHD_MULTICAST6_FILTER_NUM      3
+#define DHD_CUSTOM_FILTER_NUM          4	/* First slot for RXFILTER-SET */
+#define DHD_MAX_FILTER_NUM             12
+#define DHD_FILTER_LEN                 128
 extern int net_os_set_packet_filter(struct net_device *dev, int val);
 extern int net_os_rxfilter_add_remove(struct net_device *dev, int val, int num);
+extern int net_os_rxfilter_set(struct net_device *dev, int num, char *spec);
 
 #endif /* _dhd_h_ */
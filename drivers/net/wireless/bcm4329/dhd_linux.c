@@ -46,6 +46,7 @@
 #include <linux/inetdevice.h>
 #include <linux/mutex.h>
 #include <linux/sched.h>
+#include <linux/debugfs.h>
 
 #include <asm/uaccess.h>
 #include <asm/unaligned.h>
@@ -221,6 +222,9 @@ static struct notifier_block dhd_notifier = {
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 27)) && defined(CONFIG_PM_SLEEP)
 #include <linux/suspend.h>
 volatile bool dhd_mmc_suspend = FALSE;
+/* Blame the next received frame for the wakeup, until a second after resume */
+static volatile bool dhd_wake_check = FALSE;
+static volatile unsigned long dhd_wake_check_until;
 DECLARE_WAIT_QUEUE_HEAD(dhd_dpc_wait);
 #endif /* (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 27)) && defined(CONFIG_PM_SLEEP) */
 
@@ -254,6 +258,22 @@ extern int dhdcdc_set_ioctl(dhd_pub_t *dhd, int ifidx, uint cmd, void *buf, uint
 extern void dhd_pktfilter_offload_set(dhd_pub_t * dhd, char *arg);
 extern void dhd_pktfilter_offload_enable(dhd_pub_t * dhd, char *arg, int enable, int master_mode);
 #endif
+#ifdef ARP_OFFLOAD_SUPPORT
+extern void dhd_arp_offload_set(dhd_pub_t * dhd, int arp_mode);
+#endif
+
+/* Packets that woke the host from suspend, by type */
+typedef struct dhd_wake_stats {
+	u32 ucast;
+	u32 bcast;
+	u32 mcast;
+	u32 arp;
+	u32 ipv4;
+	u32 ipv6;
+	u32 eapol;
+	u32 event;
+	u32 other;
+} dhd_wake_stats_t;
 
 /* Interface control information */
 typedef struct dhd_if {
@@ -300,6 +320,10 @@ typedef struct dhd_info {
 	struct semaphore dpc_sem;
 	struct completion dpc_exited;
 
+	/* Receive frames handed to the stack from NAPI context, with GRO */
+	struct napi_struct rx_napi;
+	struct sk_buff_head rx_napi_queue;
+
 	/* Wakelocks */
 #ifdef CONFIG_HAS_WAKELOCK
 	struct wake_lock wl_wifi;   /* Wifi wakelock */
@@ -325,6 +349,14 @@ typedef struct dhd_info {
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct early_suspend early_suspend;
 #endif /* CONFIG_HAS_EARLYSUSPEND */
+
+	/* Patterns set with RXFILTER-SET, in the form dhd_pktfilter_offload_set takes */
+	char pktfilter_buf[DHD_MAX_FILTER_NUM - DHD_CUSTOM_FILTER_NUM][DHD_FILTER_LEN];
+
+	dhd_wake_stats_t wake_stats;
+#ifdef CONFIG_DEBUG_FS
+	struct dentry *debugfs_dir;
+#endif
 } dhd_info_t;
 
 /* Definitions to provide path to the firmware and nvram
@@ -366,6 +398,10 @@ module_param(dhd_arp_mode, uint, 0);
 uint dhd_arp_enable = TRUE;
 module_param(dhd_arp_enable, uint, 0);
 
+/* ARP offload agent mode while suspended: also answer for the host */
+uint dhd_arp_suspend_mode = 0xf;
+module_param(dhd_arp_suspend_mode, uint, 0);
+
 /* Global Pkt filter enable control */
 uint dhd_pkt_filter_enable = TRUE;
 module_param(dhd_pkt_filter_enable, uint, 0);
@@ -386,6 +422,10 @@ module_param(dhd_watchdog_prio, int, 0);
 int dhd_dpc_prio = 98;
 module_param(dhd_dpc_prio, int, 0);
 
+/* Deliver received frames through NAPI and GRO, 0 to use netif_rx */
+uint dhd_rx_napi = TRUE;
+module_param(dhd_rx_napi, uint, 0);
+
 /* DPC thread priority, -1 to use tasklet */
 extern int dhd_dongle_memsize;
 module_param(dhd_dongle_memsize, int, 0);
@@ -511,11 +551,14 @@ static int dhd_sleep_pm_callback(struct notifier_block *nfb, unsigned long actio
 	case PM_HIBERNATION_PREPARE:
 	case PM_SUSPEND_PREPARE:
 		dhd_mmc_suspend = TRUE;
+		dhd_wake_check_until = 0;
+		dhd_wake_check = TRUE;
 		ret = NOTIFY_OK;
 		break;
 	case PM_POST_HIBERNATION:
 	case PM_POST_SUSPEND:
 		dhd_mmc_suspend = FALSE;
+		dhd_wake_check_until = jiffies + HZ;
 		ret = NOTIFY_OK;
 		break;
 	}
@@ -576,6 +619,11 @@ static int dhd_set_suspend(int value, dhd_pub_t *dhd)
 
 			/* Enable packet filter, only allow unicast packet to send up */
 			dhd_set_packet_filter(1, dhd);
+#ifdef ARP_OFFLOAD_SUPPORT
+			/* Let the dongle answer ARP for us while asleep */
+			if (dhd_arp_enable)
+				dhd_arp_offload_set(dhd, dhd_arp_suspend_mode);
+#endif
 
 			/* if dtim skip setup as default force it to wake each thrid dtim
 			 *  for better power saving.
@@ -602,6 +650,10 @@ static int dhd_set_suspend(int value, dhd_pub_t *dhd)
 
 			/* disable pkt filter */
 			dhd_set_packet_filter(0, dhd);
+#ifdef ARP_OFFLOAD_SUPPORT
+			if (dhd_arp_enable)
+				dhd_arp_offload_set(dhd, dhd_arp_mode);
+#endif
 
 			/* restore pre-suspend setting for dtim_skip */
 			bcm_mkiovar("bcn_li_dtim", (char *)&dhd->dtim_skip,
@@ -1245,6 +1297,79 @@ dhd_txflowcontrol(dhd_pub_t *dhdp, int ifidx, bool state)
 		netif_wake_queue(net);
 }
 
+static void
+dhd_wake_account(dhd_info_t *dhd, struct sk_buff *skb)
+{
+	dhd_wake_stats_t *ws = &dhd->wake_stats;
+
+	if (skb->pkt_type == PACKET_BROADCAST)
+		ws->bcast++;
+	else if (skb->pkt_type == PACKET_MULTICAST)
+		ws->mcast++;
+	else
+		ws->ucast++;
+
+	switch (ntoh16(skb->protocol)) {
+	case ETHER_TYPE_ARP:
+		ws->arp++;
+		break;
+	case ETHER_TYPE_IP:
+		ws->ipv4++;
+		break;
+	case ETH_P_IPV6:
+		ws->ipv6++;
+		break;
+	case ETHER_TYPE_802_1X:
+		ws->eapol++;
+		break;
+	case ETHER_TYPE_BRCM:
+		ws->event++;
+		break;
+	default:
+		ws->other++;
+		break;
+	}
+}
+
+#ifdef CONFIG_DEBUG_FS
+static void
+dhd_debugfs_init(dhd_info_t *dhd)
+{
+	dhd_wake_stats_t *ws = &dhd->wake_stats;
+	struct dentry *wake;
+
+	dhd->debugfs_dir = debugfs_create_dir("dhd", NULL);
+	if (IS_ERR_OR_NULL(dhd->debugfs_dir)) {
+		dhd->debugfs_dir = NULL;
+		return;
+	}
+
+	wake = debugfs_create_dir("wake", dhd->debugfs_dir);
+	if (IS_ERR_OR_NULL(wake))
+		return;
+
+	debugfs_create_u32("ucast", 0444, wake, &ws->ucast);
+	debugfs_create_u32("bcast", 0444, wake, &ws->bcast);
+	debugfs_create_u32("mcast", 0444, wake, &ws->mcast);
+	debugfs_create_u32("arp", 0444, wake, &ws->arp);
+	debugfs_create_u32("ipv4", 0444, wake, &ws->ipv4);
+	debugfs_create_u32("ipv6", 0444, wake, &ws->ipv6);
+	debugfs_create_u32("eapol", 0444, wake, &ws->eapol);
+	debugfs_create_u32("event", 0444, wake, &ws->event);
+	debugfs_create_u32("other", 0444, wake, &ws->other);
+}
+
+static void
+dhd_debugfs_remove(dhd_info_t *dhd)
+{
+	debugfs_remove_recursive(dhd->debugfs_dir);
+	dhd->debugfs_dir = NULL;
+}
+#else
+static inline void dhd_debugfs_init(dhd_info_t *dhd) { }
+static inline void dhd_debugfs_remove(dhd_info_t *dhd) { }
+#endif /* CONFIG_DEBUG_FS */
+
 void
 dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 {
@@ -1289,6 +1414,13 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 		skb->dev = ifp->net;
 		skb->protocol = eth_type_trans(skb, skb->dev);
 
+		if (dhd_wake_check) {
+			dhd_wake_check = FALSE;
+			if (!dhd_wake_check_until ||
+			    time_before(jiffies, dhd_wake_check_until))
+				dhd_wake_account(dhd, skb);
+		}
+
 		if (skb->pkt_type == PACKET_MULTICAST) {
 			dhd->pub.rx_multicast++;
 		}
@@ -1320,7 +1452,9 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 		dhdp->dstats.rx_bytes += skb->len;
 		dhdp->rx_packets++; /* Local count */
 
-		if (in_interrupt()) {
+		if (dhd_rx_napi) {
+			skb_queue_tail(&dhd->rx_napi_queue, skb);
+		} else if (in_interrupt()) {
 			netif_rx(skb);
 		} else {
 			/* If the receive is not processed inside an ISR,
@@ -1340,9 +1474,44 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 #endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0) */
 		}
 	}
+
+	/* One softirq round for the whole batch; from the DPC thread,
+	 * local_bh_enable() runs it right away.
+	 */
+	if (dhd_rx_napi && !skb_queue_empty(&dhd->rx_napi_queue)) {
+		if (in_interrupt()) {
+			napi_schedule(&dhd->rx_napi);
+		} else {
+			local_bh_disable();
+			napi_schedule(&dhd->rx_napi);
+			local_bh_enable();
+		}
+	}
 	dhd_os_wake_lock_timeout_enable(dhdp);
 }
 
+static int
+dhd_rx_napi_poll(struct napi_struct *napi, int budget)
+{
+	dhd_info_t *dhd = container_of(napi, dhd_info_t, rx_napi);
+	struct sk_buff *skb;
+	int work = 0;
+
+	while (work < budget && (skb = skb_dequeue(&dhd->rx_napi_queue))) {
+		napi_gro_receive(napi, skb);
+		work++;
+	}
+
+	if (work < budget) {
+		napi_complete(napi);
+		/* Frames queued after the last dequeue found NAPI still scheduled */
+		if (!skb_queue_empty(&dhd->rx_napi_queue))
+			napi_schedule(napi);
+	}
+
+	return work;
+}
+
 void
 dhd_event(struct dhd_info *dhd, char *evpkt, int evlen, int ifidx)
 {
@@ -2098,6 +2267,11 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 	if (dhd_add_if(dhd, 0, (void *)net, net->name, NULL, 0, 0) == DHD_BAD_IF)
 		goto fail;
 
+	/* NAPI runs for the life of the driver, frames may arrive while down */
+	skb_queue_head_init(&dhd->rx_napi_queue);
+	netif_napi_add(net, &dhd->rx_napi, dhd_rx_napi_poll, 64);
+	napi_enable(&dhd->rx_napi);
+
 #if (LINUX_VERSION_CODE <= KERNEL_VERSION(2, 6, 31))
 	net->open = NULL;
 #else
@@ -2207,6 +2381,7 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 #endif
 
 	register_inetaddr_notifier(&dhd_notifier);
+	dhd_debugfs_init(dhd);
 
 	return &dhd->pub;
 
@@ -2227,6 +2402,7 @@ dhd_bus_start(dhd_pub_t *dhdp)
 	dhd_info_t *dhd = (dhd_info_t*)dhdp->info;
 #ifdef EMBEDDED_PLATFORM
 	char iovbuf[WL_EVENTING_MASK_LEN + 12];	/*  Room for "event_msgs" + '\0' + bitvec  */
+	int i;
 #endif /* EMBEDDED_PLATFORM */
 
 	ASSERT(dhd);
@@ -2312,12 +2488,11 @@ dhd_bus_start(dhd_pub_t *dhdp)
 /* enable dongle roaming event */
 	setbit(dhdp->eventmask, WLC_E_ROAM);
 
-	dhdp->pktfilter_count = 4;
+	dhdp->pktfilter_count = DHD_MAX_FILTER_NUM;
 	/* Setup filter to allow only unicast */
 	dhdp->pktfilter[0] = "100 0 0 0 0x01 0x00";
-	dhdp->pktfilter[1] = NULL;
-	dhdp->pktfilter[2] = NULL;
-	dhdp->pktfilter[3] = NULL;
+	for (i = 1; i < DHD_MAX_FILTER_NUM; i++)
+		dhdp->pktfilter[i] = NULL;
 #endif /* EMBEDDED_PLATFORM */
 
 	/* Bus is ready, do any protocol initialization */
@@ -2460,6 +2635,8 @@ dhd_net_attach(dhd_pub_t *dhdp, int ifidx)
 		temp_addr[0] |= 0x02;  /* set bit 2 , - Locally Administered address  */
 	}
 	net->hard_header_len = ETH_HLEN + dhd->pub.hdrlen;
+	if (dhd_rx_napi)
+		net->features |= NETIF_F_GRO;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 24)
 	net->ethtool_ops = &dhd_ethtool_ops;
 #endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 24) */
@@ -2553,6 +2730,7 @@ dhd_detach(dhd_pub_t *dhdp)
 			int i;
 
 			unregister_inetaddr_notifier(&dhd_notifier);
+			dhd_debugfs_remove(dhd);
 
 #if defined(CONFIG_HAS_EARLYSUSPEND)
 			if (dhd->early_suspend.suspend)
@@ -2599,6 +2777,12 @@ dhd_detach(dhd_pub_t *dhdp)
 			else
 				tasklet_kill(&dhd->tasklet);
 
+			if (dhd->rx_napi.poll) {
+				napi_disable(&dhd->rx_napi);
+				netif_napi_del(&dhd->rx_napi);
+				skb_queue_purge(&dhd->rx_napi_queue);
+			}
+
 			dhd_bus_detach(dhdp);
 
 			if (dhdp->prot)
@@ -3117,6 +3301,48 @@ int net_os_rxfilter_add_remove(struct net_device *dev, int add_remove, int num)
 	return ret;
 }
 
+/* Install pattern "<offset> <mask> <pattern>" in filter slot num, or clear
+ * the slot when spec is empty. With the master mode filters acting as an
+ * allowlist, each slot lets one more kind of frame wake the host while
+ * suspended: a multicast group, a protocol, a port.
+ */
+int net_os_rxfilter_set(struct net_device *dev, int num, char *spec)
+{
+	dhd_info_t *dhd = *(dhd_info_t **)netdev_priv(dev);
+	char *filterp;
+	int len;
+
+	if (!dhd)
+		return 0;
+	if ((num < DHD_CUSTOM_FILTER_NUM) || (num >= DHD_MAX_FILTER_NUM))
+		return -EINVAL;
+
+	filterp = dhd->pktfilter_buf[num - DHD_CUSTOM_FILTER_NUM];
+	while (*spec == ' ')
+		spec++;
+
+	dhd_os_proto_block(&dhd->pub);
+#ifdef PKT_FILTER_SUPPORT
+	/* Take the old pattern out of the dongle if it is in force */
+	if (dhd->pub.pktfilter[num] && dhd->pub.up && dhd->pub.in_suspend)
+		dhd_pktfilter_offload_enable(&dhd->pub, dhd->pub.pktfilter[num],
+			0, dhd_master_mode);
+#endif
+	dhd->pub.pktfilter[num] = NULL;
+
+	if (*spec) {
+		len = snprintf(filterp, DHD_FILTER_LEN, "%d 0 0 %s", 100 + num, spec);
+		if (len >= DHD_FILTER_LEN) {
+			dhd_os_proto_unblock(&dhd->pub);
+			return -EINVAL;
+		}
+		dhd->pub.pktfilter[num] = filterp;
+	}
+	dhd_os_proto_unblock(&dhd->pub);
+
+	return 0;
+}
+
 int net_os_set_packet_filter(struct net_device *dev, int val)
 {
 	dhd_info_t *dhd = *(dhd_info_t **)netdev_priv(dev);
@@ -82,6 +82,14 @@
 
 #define DHD_TXMINMAX	1	/* Max tx frames if rx still pending */
 
+#define DHD_TXGLOM	0	/* Default max frames per tx superframe, 0 is off */
+#define MAX_TXGLOM	8	/* Max frames in one tx superframe */
+#define MAX_TXGLOM_FRAME	2048	/* Largest frame packed into a superframe */
+#define DHD_IDLE_ADAPT_MAX	50	/* Longest traffic gap (ticks) the clock is held over */
+#define DHD_LOWLAT_TICKS	20	/* Ticks the clock is held after a voice frame */
+
+#define MAX_TXGLOM_BUF	(MAX_TXGLOM * MAX_TXGLOM_FRAME + 512 + DHD_SDALIGN)
+
 #define MEMBLOCK	2048		/* Block size used for downloading of dongle image */
 #define MAX_DATA_BUF	(32 * 1024)	/* Must be large enough to hold biggest possible glom */
 
@@ -160,6 +168,13 @@ typedef struct dhd_console {
 } dhd_console_t;
 #endif /* DHD_DEBUG */
 
+/* clkstate */
+#define CLK_NONE	0
+#define CLK_SDONLY	1
+#define CLK_PENDING	2	/* Not used yet */
+#define CLK_AVAIL	3
+#define CLK_STATES	4
+
 /* Private data for SDIO bus interaction */
 typedef struct dhd_bus {
 	dhd_pub_t	*dhd;
@@ -211,6 +226,8 @@ typedef struct dhd_bus {
 	uint8		*rxctl;			/* Aligned pointer into rxbuf */
 	uint8		*databuf;		/* Buffer for receiving big glom packet */
 	uint8		*dataptr;		/* Aligned pointer into databuf */
+	uint8		*txglombuf;		/* Buffer for building tx superframes */
+	uint8		*txglomptr;		/* Aligned pointer into txglombuf */
 	uint		rxlen;			/* Length of valid data in buffer */
 
 	uint8		sdpcm_ver;		/* Bus protocol reported by dongle */
@@ -241,8 +258,20 @@ typedef struct dhd_bus {
 	int32		sd_divisor;		/* Speed control to bus driver */
 	int32		sd_mode;		/* Mode control to bus driver */
 	int32		sd_rxchain;		/* If bcmsdh api accepts PKT chains */
+	int32		sd_sgentry_align;	/* Length granularity of chained PKTs */
 	bool		use_rxchain;		/* If dhd should use PKT chains */
 	bool		sleeping;		/* Is SDIO bus sleeping? */
+	bool		idleadapt;		/* Stretch idletime over usual traffic gaps */
+	int32		idlegap;		/* Average ticks between traffic bursts, x8 */
+	int32		idlequiet;		/* Ticks since the last data packet */
+	ulong		idlepkts;		/* Data packet count at the last tick */
+	int32		lowlat;			/* Ticks left of the low-latency hint */
+	uint32		clkstamp;		/* Uptime (ms) of the last clkstate change */
+	uint32		clkres[CLK_STATES];	/* Time (ms) spent in each clkstate */
+	uint		clktrans[CLK_STATES];	/* Entries into each clkstate */
+	uint32		sleepstamp;		/* Uptime (ms) of the last sleep change */
+	uint32		sleepres;		/* Time (ms) spent with the bus asleep */
+	uint		sleepcnt;		/* Number of bus sleeps */
 	bool		rxflow_mode;	/* Rx flow control mode */
 	bool		rxflow;			/* Is rx flow control on */
 	uint		prev_rxlim_hit;		/* Is prev rx limit exceeded (per dpc schedule) */
@@ -289,6 +318,8 @@ typedef struct dhd_bus {
 	uint		rxglomfail;		/* Failed deglom attempts */
 	uint		rxglomframes;		/* Number of glom frames (superframes) */
 	uint		rxglompkts;		/* Number of packets from glom frames */
+	uint		txglomframes;		/* Number of tx superframes */
+	uint		txglompkts;		/* Number of packets sent in superframes */
 	uint		f2rxhdrs;		/* Number of header reads */
 	uint		f2rxdata;		/* Number of frame data reads */
 	uint		f2txdata;		/* Number of f2 frame writes */
@@ -299,12 +330,6 @@ typedef struct dhd_bus {
 	bool		ctrl_frame_stat;
 } dhd_bus_t;
 
-/* clkstate */
-#define CLK_NONE	0
-#define CLK_SDONLY	1
-#define CLK_PENDING	2	/* Not used yet */
-#define CLK_AVAIL	3
-
 #define DHD_NOPMU(dhd)	(FALSE)
 
 #ifdef DHD_DEBUG
@@ -322,6 +347,7 @@ extern void dhd_os_wd_timer(void *bus, uint wdtick);
 uint dhd_txbound;
 uint dhd_rxbound;
 uint dhd_txminmax;
+uint dhd_txglom;
 
 /* override the RAM size if possible */
 #define DONGLE_MIN_MEMSIZE (128 *1024)
@@ -435,6 +461,7 @@ static void dhdsdio_release(dhd_bus_t *bus, osl_t *osh);
 static void dhdsdio_release_malloc(dhd_bus_t *bus, osl_t *osh);
 static void dhdsdio_disconnect(void *ptr);
 static bool dhdsdio_chipmatch(uint16 chipid);
+static int32 dhdsdio_idleticks(dhd_bus_t *bus);
 static bool dhdsdio_probe_attach(dhd_bus_t *bus, osl_t *osh, void *sdh,
                                  void * regsva, uint16  devid);
 static bool dhdsdio_probe_malloc(dhd_bus_t *bus, osl_t *osh, void *sdh);
@@ -489,6 +516,21 @@ dhdsdio_set_siaddr_window(dhd_bus_t *bus, uint32 address)
 }
 
 
+/* Charge the time since the last change to the old clkstate */
+static void
+dhdsdio_setclkstate(dhd_bus_t *bus, uint state)
+{
+	uint32 now = OSL_SYSUPTIME();
+
+	if (state == bus->clkstate)
+		return;
+
+	bus->clkres[bus->clkstate] += now - bus->clkstamp;
+	bus->clkstamp = now;
+	bus->clktrans[state]++;
+	bus->clkstate = state;
+}
+
 /* Turn backplane clock on or off */
 static int
 dhdsdio_htclk(dhd_bus_t *bus, bool on, bool pendok)
@@ -548,7 +590,7 @@ dhdsdio_htclk(dhd_bus_t *bus, bool on, bool pendok)
 			devctl |= SBSDIO_DEVCTL_CA_INT_ONLY;
 			bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_DEVICE_CTL, devctl, &err);
 			DHD_INFO(("CLKCTL: set PENDING\n"));
-			bus->clkstate = CLK_PENDING;
+			dhdsdio_setclkstate(bus, CLK_PENDING);
 			return BCME_OK;
 		} else if (bus->clkstate == CLK_PENDING) {
 			/* Cancel CA-only interrupt filter */
@@ -576,7 +618,7 @@ dhdsdio_htclk(dhd_bus_t *bus, bool on, bool pendok)
 
 
 		/* Mark clock available */
-		bus->clkstate = CLK_AVAIL;
+		dhdsdio_setclkstate(bus, CLK_AVAIL);
 		DHD_INFO(("CLKCTL: turned ON\n"));
 
 #if defined(DHD_DEBUG)
@@ -604,7 +646,7 @@ dhdsdio_htclk(dhd_bus_t *bus, bool on, bool pendok)
 			bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_DEVICE_CTL, devctl, &err);
 		}
 
-		bus->clkstate = CLK_SDONLY;
+		dhdsdio_setclkstate(bus, CLK_SDONLY);
 		bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_CHIPCLKCSR, clkreq, &err);
 		DHD_INFO(("CLKCTL: turned OFF\n"));
 		if (err) {
@@ -656,7 +698,7 @@ dhdsdio_sdclk(dhd_bus_t *bus, bool on)
 				return BCME_ERROR;
 			}
 		}
-		bus->clkstate = CLK_SDONLY;
+		dhdsdio_setclkstate(bus, CLK_SDONLY);
 	} else {
 		/* Stop or slow the SD clock itself */
 		if ((bus->sd_divisor == -1) || (bus->sd_mode == -1)) {
@@ -696,7 +738,7 @@ dhdsdio_sdclk(dhd_bus_t *bus, bool on)
 				return BCME_ERROR;
 			}
 		}
-		bus->clkstate = CLK_NONE;
+		dhdsdio_setclkstate(bus, CLK_NONE);
 	}
 
 	return BCME_OK;
@@ -782,7 +824,7 @@ dhdsdio_bussleep(dhd_bus_t *bus, bool sleep)
 	/* Going to sleep: set the alarm and turn off the lights... */
 	if (sleep) {
 		/* Don't sleep if something is pending */
-		if (bus->dpc_sched || bus->rxskip || pktq_len(&bus->txq))
+		if (bus->dpc_sched || bus->rxskip || pktq_len(&bus->txq) || bus->lowlat)
 			return BCME_BUSY;
 
 
@@ -811,6 +853,8 @@ dhdsdio_bussleep(dhd_bus_t *bus, bool sleep)
 
 		/* Change state */
 		bus->sleeping = TRUE;
+		bus->sleepstamp = OSL_SYSUPTIME();
+		bus->sleepcnt++;
 
 	} else {
 		/* Waking up: bus power up is ok, set local state */
@@ -839,6 +883,7 @@ dhdsdio_bussleep(dhd_bus_t *bus, bool sleep)
 
 		/* Change state */
 		bus->sleeping = FALSE;
+		bus->sleepres += OSL_SYSUPTIME() - bus->sleepstamp;
 
 		/* Enable interrupts again */
 		if (bus->intr && (bus->dhd->busstate == DHD_BUS_DATA)) {
@@ -887,6 +932,32 @@ dhd_enable_oob_intr(struct dhd_bus *bus, bool enable)
 	} while (0);
 
 
+/* Abort a failed F2 write and terminate the frame */
+static void
+dhdsdio_txabort(dhd_bus_t *bus)
+{
+	bcmsdh_info_t *sdh = bus->sdh;
+	int i;
+
+	bus->tx_sderrs++;
+
+	bcmsdh_abort(sdh, SDIO_FUNC_2);
+	bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_FRAMECTRL,
+	                 SFC_WF_TERM, NULL);
+	bus->f1regdata++;
+
+	for (i = 0; i < 3; i++) {
+		uint8 hi, lo;
+		hi = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
+		                     SBSDIO_FUNC1_WFRAMEBCHI, NULL);
+		lo = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
+		                     SBSDIO_FUNC1_WFRAMEBCLO, NULL);
+		bus->f1regdata += 2;
+		if ((hi == 0) && (lo == 0))
+			break;
+	}
+}
+
 /* Writes a HW/SW header into the packet and sends it. */
 /* Assumes: (a) header space already there, (b) caller holds lock */
 static int
@@ -900,7 +971,6 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 	uint retries = 0;
 	bcmsdh_info_t *sdh;
 	void *new;
-	int i;
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
@@ -1004,24 +1074,7 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 			/* On failure, abort the command and terminate the frame */
 			DHD_INFO(("%s: sdio error %d, abort command and terminate frame.\n",
 			          __FUNCTION__, ret));
-			bus->tx_sderrs++;
-
-			bcmsdh_abort(sdh, SDIO_FUNC_2);
-			bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_FRAMECTRL,
-			                 SFC_WF_TERM, NULL);
-			bus->f1regdata++;
-
-			for (i = 0; i < 3; i++) {
-				uint8 hi, lo;
-				hi = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
-				                     SBSDIO_FUNC1_WFRAMEBCHI, NULL);
-				lo = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
-				                     SBSDIO_FUNC1_WFRAMEBCLO, NULL);
-				bus->f1regdata += 2;
-				if ((hi == 0) && (lo == 0))
-					break;
-			}
-
+			dhdsdio_txabort(bus);
 		}
 		if (ret == 0) {
 			bus->tx_seq = (bus->tx_seq + 1) % SDPCM_SEQUENCE_WRAP;
@@ -1041,6 +1094,113 @@ done:
 	return ret;
 }
 
+/* Packs queued data frames, each with its own HW/SW header, into one
+ * superframe and sends it as a single F2 write. The dongle firmware
+ * has to accept superframes, so this is only used once enabled with
+ * the "txglom" iovar. Returns the number of frames taken off the queue.
+ * Assumes: caller holds lock
+ */
+static uint
+dhdsdio_txglom(dhd_bus_t *bus, uint8 tx_prec_map, uint maxframes)
+{
+	osl_t *osh = bus->dhd->osh;
+	void *pkts[MAX_TXGLOM];
+	void *pkt, *last = NULL;
+	uint8 *frame;
+	uint16 len;
+	uint32 swheader;
+	uint retries = 0;
+	uint total = 0, n, i;
+	int ret, prec_out;
+
+	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
+
+	for (n = 0; n < maxframes; n++) {
+		dhd_os_sdlock_txq(bus->dhd);
+		pkt = pktq_mdeq(&bus->txq, tx_prec_map, &prec_out);
+		dhd_os_sdunlock_txq(bus->dhd);
+		if (!pkt)
+			break;
+
+		/* Too big to pack, it goes out on its own after the rest */
+		if (PKTLEN(osh, pkt) > MAX_TXGLOM_FRAME) {
+			last = pkt;
+			break;
+		}
+
+		/* Each header is written into the copy with no extra pad */
+		frame = bus->txglomptr + total;
+		len = (uint16)ROUNDUP(PKTLEN(osh, pkt), DHD_SDALIGN);
+		bcopy(PKTDATA(osh, pkt), frame, PKTLEN(osh, pkt));
+		bzero(frame + PKTLEN(osh, pkt), len - PKTLEN(osh, pkt));
+
+		/* Length tag covers the pad, so it also locates the next frame */
+		*(uint16*)frame = htol16(len);
+		*(((uint16*)frame) + 1) = htol16(~len);
+
+		swheader = ((SDPCM_DATA_CHANNEL << SDPCM_CHANNEL_SHIFT) & SDPCM_CHANNEL_MASK) |
+		        ((bus->tx_seq + n) % SDPCM_SEQUENCE_WRAP) |
+		        ((SDPCM_HDRLEN << SDPCM_DOFFSET_SHIFT) & SDPCM_DOFFSET_MASK);
+		htol32_ua_store(swheader, frame + SDPCM_FRAMETAG_LEN);
+		htol32_ua_store(0, frame + SDPCM_FRAMETAG_LEN + sizeof(swheader));
+
+		pkts[n] = pkt;
+		total += len;
+	}
+
+	if (n) {
+		/* Raise len to next SDIO block to eliminate tail command */
+		if (bus->roundup && bus->blocksize && (total > bus->blocksize)) {
+			uint pad = bus->blocksize - (total % bus->blocksize);
+			if ((pad <= bus->roundup) && (pad < bus->blocksize))
+				total += pad;
+		}
+
+		do {
+			ret = dhd_bcmsdh_send_buf(bus, bcmsdh_cur_sbwad(bus->sdh), SDIO_FUNC_2,
+			                          F2SYNC, bus->txglomptr, total, NULL, NULL, NULL);
+			bus->f2txdata++;
+			ASSERT(ret != BCME_PENDING);
+
+			if (ret < 0) {
+				DHD_INFO(("%s: sdio error %d, abort command and terminate frame.\n",
+				          __FUNCTION__, ret));
+				dhdsdio_txabort(bus);
+			}
+		} while ((ret < 0) && retrydata && retries++ < TXRETRIES);
+
+		if (ret == 0) {
+			bus->tx_seq = (bus->tx_seq + n) % SDPCM_SEQUENCE_WRAP;
+			bus->txglomframes++;
+			bus->txglompkts += n;
+		}
+
+		for (i = 0; i < n; i++) {
+			pkt = pkts[i];
+			PKTPULL(osh, pkt, SDPCM_HDRLEN);
+			if (ret)
+				bus->dhd->tx_errors++;
+			else
+				bus->dhd->dstats.tx_bytes += PKTLEN(osh, pkt);
+			dhd_os_sdunlock(bus->dhd);
+			dhd_txcomplete(bus->dhd, pkt, ret != 0);
+			dhd_os_sdlock(bus->dhd);
+			PKTFREE(osh, pkt, TRUE);
+		}
+	}
+
+	if (last) {
+		len = PKTLEN(osh, last) - SDPCM_HDRLEN;
+		if (dhdsdio_txpkt(bus, last, SDPCM_DATA_CHANNEL, TRUE))
+			bus->dhd->tx_errors++;
+		else
+			bus->dhd->dstats.tx_bytes += len;
+		n++;
+	}
+
+	return n;
+}
+
 int
 dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 {
@@ -1073,6 +1233,10 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 
 	prec = PRIO2PREC((PKTPRIO(pkt) & PRIOMASK));
 
+	/* Voice and network control frames ask for a low-latency bus */
+	if ((PKTPRIO(pkt) & PRIOMASK) >= PRIO_8021D_VO)
+		bus->lowlat = DHD_LOWLAT_TICKS;
+
 
 	/* Check for existing queue, current flow-control, pending event, or pending clock */
 	if (dhd_deferred_tx || bus->fcstate || pktq_len(&bus->txq) || bus->dpc_sched ||
@@ -1149,6 +1313,7 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 	int ret = 0, prec_out;
 	uint cnt = 0;
 	uint datalen;
+	uint glom;
 	uint8 tx_prec_map;
 
 	dhd_pub_t *dhd = bus->dhd;
@@ -1160,24 +1325,40 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 
 	/* Send frames until the limit or some other event */
 	for (cnt = 0; (cnt < maxframes) && DATAOK(bus); cnt++) {
-		dhd_os_sdlock_txq(bus->dhd);
-		if ((pkt = pktq_mdeq(&bus->txq, tx_prec_map, &prec_out)) == NULL) {
+		/* Pack as many as are queued, within the dongle's window */
+		glom = 0;
+		if (bus->txglomptr) {
+			glom = MIN(dhd_txglom, maxframes - cnt);
+			glom = MIN(glom, (uint8)(bus->tx_max - bus->tx_seq));
+			dhd_os_sdlock_txq(bus->dhd);
+			glom = MIN(glom, (uint)pktq_mlen(&bus->txq, tx_prec_map));
 			dhd_os_sdunlock_txq(bus->dhd);
-			break;
 		}
-		dhd_os_sdunlock_txq(bus->dhd);
-		datalen = PKTLEN(bus->dhd->osh, pkt) - SDPCM_HDRLEN;
+
+		if (glom > 1) {
+			if ((glom = dhdsdio_txglom(bus, tx_prec_map, glom)) == 0)
+				break;
+			cnt += glom - 1;
+		} else {
+			dhd_os_sdlock_txq(bus->dhd);
+			if ((pkt = pktq_mdeq(&bus->txq, tx_prec_map, &prec_out)) == NULL) {
+				dhd_os_sdunlock_txq(bus->dhd);
+				break;
+			}
+			dhd_os_sdunlock_txq(bus->dhd);
+			datalen = PKTLEN(bus->dhd->osh, pkt) - SDPCM_HDRLEN;
 
 #ifndef SDTEST
-		ret = dhdsdio_txpkt(bus, pkt, SDPCM_DATA_CHANNEL, TRUE);
+			ret = dhdsdio_txpkt(bus, pkt, SDPCM_DATA_CHANNEL, TRUE);
 #else
-		ret = dhdsdio_txpkt(bus, pkt,
-		        (bus->ext_loop ? SDPCM_TEST_CHANNEL : SDPCM_DATA_CHANNEL), TRUE);
+			ret = dhdsdio_txpkt(bus, pkt,
+			        (bus->ext_loop ? SDPCM_TEST_CHANNEL : SDPCM_DATA_CHANNEL), TRUE);
 #endif
-		if (ret)
-			bus->dhd->tx_errors++;
-		else
-			bus->dhd->dstats.tx_bytes += datalen;
+			if (ret)
+				bus->dhd->tx_errors++;
+			else
+				bus->dhd->dstats.tx_bytes += datalen;
+		}
 
 		/* In poll mode, need to check for other events */
 		if (!bus->intr && cnt)
@@ -1431,6 +1612,8 @@ enum {
 	IOV_IDLECLOCK,
 	IOV_SD1IDLE,
 	IOV_SLEEP,
+	IOV_TXGLOM,
+	IOV_IDLEADAPT,
 	IOV_VARS
 };
 
@@ -1439,6 +1622,7 @@ const bcm_iovar_t dhdsdio_iovars[] = {
 	{"sleep",	IOV_SLEEP,	0,	IOVT_BOOL,	0 },
 	{"pollrate",	IOV_POLLRATE,	0,	IOVT_UINT32,	0 },
 	{"idletime",	IOV_IDLETIME,	0,	IOVT_INT32,	0 },
+	{"idleadapt",	IOV_IDLEADAPT,	0,	IOVT_BOOL,	0 },
 	{"idleclock",	IOV_IDLECLOCK,	0,	IOVT_INT32,	0 },
 	{"sd1idle",	IOV_SD1IDLE,	0,	IOVT_BOOL,	0 },
 	{"membytes",	IOV_MEMBYTES,	0,	IOVT_BUFFER,	2 * sizeof(int) },
@@ -1451,6 +1635,7 @@ const bcm_iovar_t dhdsdio_iovars[] = {
 	{"alignctl",	IOV_ALIGNCTL,	0,	IOVT_BOOL,	0 },
 	{"sdalign",	IOV_SDALIGN,	0,	IOVT_BOOL,	0 },
 	{"devreset",	IOV_DEVRESET,	0,	IOVT_BOOL,	0 },
+	{"txglom",	IOV_TXGLOM,	0,	IOVT_UINT32,	0 },
 #ifdef DHD_DEBUG
 	{"sdreg",	IOV_SDREG,	0,	IOVT_BUFFER,	sizeof(sdreg_t) },
 	{"sbreg",	IOV_SBREG,	0,	IOVT_BUFFER,	sizeof(sdreg_t) },
@@ -1490,6 +1675,8 @@ void
 dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 {
 	dhd_bus_t *bus = dhdp->bus;
+	uint32 now, res;
+	int i;
 
 	bcm_bprintf(strbuf, "Bus SDIO structure:\n");
 	bcm_bprintf(strbuf, "hostintmask 0x%08x intstatus 0x%08x sdpcm_ver %d\n",
@@ -1512,6 +1699,8 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 	            bus->fc_rcvd, bus->fc_xoff, bus->fc_xon);
 	bcm_bprintf(strbuf, "rxglomfail %d, rxglomframes %d, rxglompkts %d\n",
 	            bus->rxglomfail, bus->rxglomframes, bus->rxglompkts);
+	bcm_bprintf(strbuf, "txglomframes %d, txglompkts %d\n",
+	            bus->txglomframes, bus->txglompkts);
 	bcm_bprintf(strbuf, "f2rx (hdrs/data) %d (%d/%d), f2tx %d f1regs %d\n",
 	            (bus->f2rxhdrs + bus->f2rxdata), bus->f2rxhdrs, bus->f2rxdata,
 	            bus->f2txdata, bus->f1regdata);
@@ -1566,6 +1755,21 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 #endif /* DHD_DEBUG */
 	bcm_bprintf(strbuf, "clkstate %d activity %d idletime %d idlecount %d sleeping %d\n",
 	            bus->clkstate, bus->activity, bus->idletime, bus->idlecount, bus->sleeping);
+	bcm_bprintf(strbuf, "idleadapt %d idlegap %d idlequiet %d idleticks %d lowlat %d\n",
+	            bus->idleadapt, bus->idlegap >> 3, bus->idlequiet, dhdsdio_idleticks(bus),
+	            bus->lowlat);
+	now = OSL_SYSUPTIME();
+	for (i = 0; i < CLK_STATES; i++) {
+		res = bus->clkres[i];
+		if (i == bus->clkstate)
+			res += now - bus->clkstamp;
+		bcm_bprintf(strbuf, "clkstate %d: %u ms, %u entries\n",
+		            i, res, bus->clktrans[i]);
+	}
+	res = bus->sleepres;
+	if (bus->sleeping)
+		res += now - bus->sleepstamp;
+	bcm_bprintf(strbuf, "bus sleep: %u ms, %u entries\n", res, bus->sleepcnt);
 }
 
 void
@@ -1578,6 +1782,11 @@ dhd_bus_clearcounts(dhd_pub_t *dhdp)
 	bus->rx_hdrfail = bus->rx_badhdr = bus->rx_badseq = 0;
 	bus->tx_sderrs = bus->fc_rcvd = bus->fc_xoff = bus->fc_xon = 0;
 	bus->rxglomfail = bus->rxglomframes = bus->rxglompkts = 0;
+	bus->txglomframes = bus->txglompkts = 0;
+	bzero(bus->clkres, sizeof(bus->clkres));
+	bzero(bus->clktrans, sizeof(bus->clktrans));
+	bus->clkstamp = bus->sleepstamp = OSL_SYSUPTIME();
+	bus->sleepres = bus->sleepcnt = 0;
 	bus->f2rxhdrs = bus->f2rxdata = bus->f2txdata = bus->f1regdata = 0;
 }
 
@@ -2053,6 +2262,16 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 		}
 		break;
 
+	case IOV_GVAL(IOV_IDLEADAPT):
+		int_val = (int32)bus->idleadapt;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_IDLEADAPT):
+		bus->idleadapt = bool_val;
+		bus->idlecount = 0;
+		break;
+
 	case IOV_GVAL(IOV_IDLECLOCK):
 		int_val = (int32)bus->idleclock;
 		bcopy(&int_val, arg, val_size);
@@ -2344,6 +2563,32 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 
 		break;
 
+	case IOV_GVAL(IOV_TXGLOM):
+		int_val = (int32)dhd_txglom;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_TXGLOM):
+		if ((uint)int_val > MAX_TXGLOM) {
+			bcmerror = BCME_RANGE;
+			break;
+		}
+		if (int_val > 1 && !bus->txglombuf) {
+			if (!(bus->txglombuf = MALLOC(bus->dhd->osh, MAX_TXGLOM_BUF))) {
+				DHD_ERROR(("%s: MALLOC of %d-byte txglombuf failed\n",
+				           __FUNCTION__, MAX_TXGLOM_BUF));
+				bcmerror = BCME_NOMEM;
+				break;
+			}
+			if ((uintptr)bus->txglombuf % DHD_SDALIGN)
+				bus->txglomptr = bus->txglombuf +
+				        (DHD_SDALIGN - ((uintptr)bus->txglombuf % DHD_SDALIGN));
+			else
+				bus->txglomptr = bus->txglombuf;
+		}
+		dhd_txglom = (uint)int_val;
+		break;
+
 	default:
 		bcmerror = BCME_UNSUPPORTED;
 		break;
@@ -3048,6 +3293,10 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 				totlen = ROUNDUP(totlen, bus->blocksize);
 			}
 
+			/* Chained reads need every subframe on the host's granularity */
+			if (sublen % bus->sd_sgentry_align)
+				usechain = FALSE;
+
 			/* Allocate/chain packet for next subframe */
 			if ((pnext = PKTGET(osh, sublen + DHD_SDALIGN, FALSE)) == NULL) {
 				DHD_ERROR(("%s: PKTGET failed, num %d len %d\n",
@@ -4078,7 +4327,7 @@ dhdsdio_dpc(dhd_bus_t *bus)
 				           __FUNCTION__, err));
 				bus->dhd->busstate = DHD_BUS_DOWN;
 			}
-			bus->clkstate = CLK_AVAIL;
+			dhdsdio_setclkstate(bus, CLK_AVAIL);
 		} else {
 			goto clkwait;
 		}
@@ -4564,6 +4813,43 @@ dhdsdio_testrcv(dhd_bus_t *bus, void *pkt, uint seq)
 }
 #endif /* SDTEST */
 
+/* Follow the gaps between data traffic, one sample per watchdog tick */
+static void
+dhdsdio_idlestats(dhd_bus_t *bus)
+{
+	ulong pkts = bus->dhd->tx_packets + bus->dhd->rx_packets;
+
+	if (bus->lowlat)
+		bus->lowlat--;
+
+	if (pkts == bus->idlepkts) {
+		if (bus->idlequiet < DHD_IDLE_ADAPT_MAX)
+			bus->idlequiet++;
+		return;
+	}
+
+	/* Traffic resumed: fold the gap into the running average */
+	if (bus->idlequiet)
+		bus->idlegap += bus->idlequiet - (bus->idlegap >> 3);
+	bus->idlequiet = 0;
+	bus->idlepkts = pkts;
+}
+
+/* Quiet ticks before the clock goes down: a gap the traffic usually has
+ * costs a clock bounce, so the timeout is stretched to cover it. Gaps too
+ * long to be worth holding the clock for fall back to idletime.
+ */
+static int32
+dhdsdio_idleticks(dhd_bus_t *bus)
+{
+	int32 gap = bus->idlegap >> 3;
+
+	if ((gap < bus->idletime) || (gap >= DHD_IDLE_ADAPT_MAX))
+		return bus->idletime;
+
+	return MIN(gap + (gap >> 1), DHD_IDLE_ADAPT_MAX);
+}
+
 extern bool
 dhd_bus_watchdog(dhd_pub_t *dhdp)
 {
@@ -4638,9 +4924,17 @@ dhd_bus_watchdog(dhd_pub_t *dhdp)
 	}
 #endif
 
+	dhdsdio_idlestats(bus);
+
 	/* On idle timeout clear activity flag and/or turn off clock */
 	if ((bus->idletime > 0) && (bus->clkstate == CLK_AVAIL)) {
-		if (++bus->idlecount >= bus->idletime) {
+		if (bus->idleadapt) {
+			/* Hold the clock over gaps the traffic usually has */
+			if (!bus->lowlat && bus->idlequiet >= dhdsdio_idleticks(bus)) {
+				bus->activity = FALSE;
+				dhdsdio_clkctl(bus, CLK_NONE, FALSE);
+			}
+		} else if (++bus->idlecount >= bus->idletime) {
 			bus->idlecount = 0;
 			if (bus->activity) {
 				bus->activity = FALSE;
@@ -4781,6 +5075,7 @@ dhdsdio_probe(uint16 venid, uint16 devid, uint16 bus_no, uint16 slot,
 	dhd_doflow = FALSE;
 	dhd_dongle_memsize = 0;
 	dhd_txminmax = DHD_TXMINMAX;
+	dhd_txglom = DHD_TXGLOM;
 
 	forcealign = TRUE;
 
@@ -5151,7 +5446,9 @@ dhdsdio_probe_init(dhd_bus_t *bus, osl_t *osh, void *sdh)
 
 	/* ...and initialize clock/power states */
 	bus->clkstate = CLK_SDONLY;
+	bus->clkstamp = bus->sleepstamp = OSL_SYSUPTIME();
 	bus->idletime = (int32)dhd_idletime;
+	bus->idleadapt = TRUE;
 	bus->idleclock = DHD_IDLE_ACTIVE;
 
 	/* Query the SD clock speed */
@@ -5196,6 +5493,11 @@ dhdsdio_probe_init(dhd_bus_t *bus, osl_t *osh, void *sdh)
 	}
 	bus->use_rxchain = (bool)bus->sd_rxchain;
 
+	if (bcmsdh_iovar_op(sdh, "sd_sgentry_align", NULL, 0,
+	                    &bus->sd_sgentry_align, sizeof(int32), FALSE) != BCME_OK ||
+	    bus->sd_sgentry_align <= 0)
+		bus->sd_sgentry_align = DHD_SDALIGN;
+
 	return TRUE;
 }
 
@@ -5284,6 +5586,11 @@ dhdsdio_release_malloc(dhd_bus_t *bus, osl_t *osh)
 #endif
 		bus->databuf = NULL;
 	}
+
+	if (bus->txglombuf) {
+		MFREE(osh, bus->txglombuf, MAX_TXGLOM_BUF);
+		bus->txglombuf = bus->txglomptr = NULL;
+	}
 }
 
 
@@ -27,6 +27,8 @@
 #ifndef __BCMSDH_SDMMC_H__
 #define __BCMSDH_SDMMC_H__
 
+#include <linux/scatterlist.h>
+
 #define sd_err(x)
 #define sd_trace(x)
 #define sd_info(x)
@@ -53,6 +55,19 @@ extern void sdioh_sdmmc_osfree(sdioh_info_t *sd);
 #define BLOCK_SIZE_4318 64
 #define BLOCK_SIZE_4328 512
 
+/* Packets of a chain issued as one scatter-gather CMD53 */
+#define SDIOH_SDMMC_MAX_SG_ENTRIES	32
+
+/*
+ * Each sg entry has to be a multiple of this. msm_sdcc moves DMA data
+ * in FIFO sized rows per entry.
+ */
+#ifdef CONFIG_MMC_MSM7X00A
+#define SDIOH_SDMMC_SGENTRY_ALIGN	64
+#else
+#define SDIOH_SDMMC_SGENTRY_ALIGN	4
+#endif
+
 /* internal return code */
 #define SUCCESS	0
 #define ERROR	1
@@ -85,6 +100,7 @@ struct sdioh_info {
 	uint		max_dma_len;
 	uint		max_dma_descriptors;	/* DMA Descriptors supported by this controller. */
 //	SDDMA_DESCRIPTOR	SGList[32];	/* Scatter/Gather DMA List */
+	struct scatterlist	sg_list[SDIOH_SDMMC_MAX_SG_ENTRIES];
 };
 
 /************************************************************
@@ -7284,6 +7284,12 @@ static int wl_iw_set_priv(
 			int filter_num = *(extra + strlen(RXFILTER_REMOVE_CMD) + 1) - '0';
 			ret = net_os_rxfilter_add_remove(dev, FALSE, filter_num);
 		}
+		else if (strnicmp(extra, RXFILTER_SET_CMD, strlen(RXFILTER_SET_CMD)) == 0) {
+			char *spec;
+			int filter_num = simple_strtol(extra + strlen(RXFILTER_SET_CMD) + 1,
+				&spec, 10);
+			ret = net_os_rxfilter_set(dev, filter_num, spec);
+		}
 #ifdef SOFTAP
 #ifdef SOFTAP_TLV_CFG
 		else if (strnicmp(extra, SOFTAP_SET_CMD, strlen(SOFTAP_SET_CMD)) == 0) {
@@ -57,6 +57,7 @@
 #define RXFILTER_STOP_CMD			"RXFILTER-STOP"
 #define RXFILTER_ADD_CMD			"RXFILTER-ADD"
 #define RXFILTER_REMOVE_CMD			"RXFILTER-REMOVE"
+#define RXFILTER_SET_CMD			"RXFILTER-SET"
 
 #define MAC2STR(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
 #define MACSTR "%02x:%02x:%02x:%02x:%02x:%02x"
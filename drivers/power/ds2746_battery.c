@@ -79,8 +79,14 @@ static struct ds2746_device_info *g_di_ptr = NULL;
 static int g_first_update_charger_ctl = 1;
 
 #define FAST_POLL	(1 * 30)
+#define MID_POLL	(2 * 60)
 #define SLOW_POLL	(10 * 60)
 #define PREDIC_POLL	20
+#define POLL_SLACK	20
+
+/* below these, sleeping polls stay frequent */
+#define SLOW_POLL_MIN_01P	150
+#define SLOW_POLL_MAX_MA	100
 
 #define HTC_BATTERY_I2C_DEBUG_ENABLE		0
 #define HTC_BATTERY_DS2746_DEBUG_ENABLE 	1
@@ -1147,10 +1153,29 @@ ssize_t htc_battery_show_attr(struct device_attribute *attr, char *buf)
 	return len;
 }
 
+/*
+ * Charging, a low battery and running awake all need the level to be
+ * followed closely. Asleep and discharging it moves slowly, more so the
+ * smaller the current, so the gauge is read less often.
+ */
+static int ds2746_poll_interval(struct ds2746_device_info *di)
+{
+	if (poweralg.battery.is_power_on_reset)
+		return PREDIC_POLL;
+	if (poweralg.charging_source != CONNECT_TYPE_NONE)
+		return FAST_POLL;
+	if (!di->slow_poll || poweralg.capacity_01p <= SLOW_POLL_MIN_01P)
+		return FAST_POLL;
+	if (abs(poweralg.battery.current_mA) > SLOW_POLL_MAX_MA)
+		return MID_POLL;
+	return SLOW_POLL;
+}
+
+/* the slack lets the alarm share a wakeup with other alarms */
 static void ds2746_program_alarm(struct ds2746_device_info *di, int seconds)
 {
 	ktime_t low_interval = ktime_set(seconds, 0);
-	ktime_t slack = ktime_set(20, 0);
+	ktime_t slack = ktime_set(max(seconds / 4, POLL_SLACK), 0);
 	ktime_t next;
 
 	next = ktime_add(di->last_poll, low_interval);
@@ -1283,10 +1308,7 @@ static void ds2746_battery_work(struct work_struct *work)
 	local_irq_save(flags);
 
 	wake_unlock(&di->work_wake_lock);
-	if (poweralg.battery.is_power_on_reset)
-		ds2746_program_alarm(di, PREDIC_POLL);
-	else
-		ds2746_program_alarm(di, FAST_POLL);
+	ds2746_program_alarm(di, ds2746_poll_interval(di));
 
 	local_irq_restore(flags);
 }
@@ -1384,8 +1406,8 @@ static int ds2746_suspend(struct device *dev)
 	 * we next resume.*/
 	if (poweralg.charging_source == CONNECT_TYPE_NONE) {
 		local_irq_save(flags);
-		ds2746_program_alarm(di, SLOW_POLL);
 		di->slow_poll = 1;
+		ds2746_program_alarm(di, ds2746_poll_interval(di));
 		local_irq_restore(flags);
 	}
 	/*gpio_direction_output(87, 0);*/
@@ -1406,8 +1428,8 @@ static void ds2746_resume(struct device *dev)
 	ndelay(100 * 1000);
 	if (di->slow_poll){
 		local_irq_save(flags);
-		ds2746_program_alarm(di, FAST_POLL);
 		di->slow_poll = 0;
+		ds2746_program_alarm(di, ds2746_poll_interval(di));
 		local_irq_restore(flags);
 	}
 }
@@ -56,6 +56,7 @@
 #include <linux/dmapool.h>
 #include <linux/wait.h>
 #include <linux/wakelock.h>
+#include <linux/pm_qos.h>
 #include <linux/workqueue.h>
 
 #include <asm/atomic.h>
@@ -105,6 +106,16 @@ struct msm_hs_tx {
 	dma_addr_t dma_base;
 };
 
+/* One chunk of received data, closed by a stale event or a full buffer */
+struct msm_hs_rx_buf {
+	unsigned char *buffer;
+	dma_addr_t rbuffer;
+	int count;
+	unsigned long errors;  /* UARTDM_SR error bits seen with this chunk */
+};
+
+#define UARTDM_RX_BUF_CNT 4
+
 struct msm_hs_rx {
 	enum flush_reason flush;
 	struct msm_dmov_cmd xfer;
@@ -113,11 +124,20 @@ struct msm_hs_rx {
 	u32 *command_ptr_ptr;
 	dma_addr_t mapped_cmd_ptr;
 	wait_queue_head_t wait;
-	dma_addr_t rbuffer;
-	unsigned char *buffer;
+	struct msm_hs_rx_buf buf[UARTDM_RX_BUF_CNT];
+	unsigned int head;  /* chunks completed by the data mover */
+	unsigned int tail;  /* chunks handed to the tty */
+	int stalled;  /* no free buffer, rearm once the work drains one */
+	ktime_t stale_time;
 	struct dma_pool *pool;
 	struct wake_lock wake_lock;
 	struct work_struct tty_work;
+
+	/* statistics */
+	unsigned long overruns;
+	unsigned long stalls;
+	unsigned int rearm_us_last;
+	unsigned int rearm_us_max;
 };
 
 /* optional RX GPIO IRQ low power wakeup */
@@ -152,11 +172,15 @@ struct msm_hs_port {
 	void (*exit_lpm_cb)(struct uart_port *);
 
 	struct wake_lock dma_wake_lock;  /* held while any DMA active */
+
+	/* bounds idle exit latency while the clock is on, if set */
+	s32 cpu_dma_latency;
+	struct pm_qos_request pm_qos_req;
 };
 
 #define MSM_UARTDM_BURST_SIZE 16   /* DM burst size (in bytes) */
 #define UARTDM_TX_BUF_SIZE UART_XMIT_SIZE
-#define UARTDM_RX_BUF_SIZE 512
+#define UARTDM_RX_BUF_SIZE 1024
 
 #define UARTDM_NR 2
 
@@ -196,11 +220,26 @@ static int msm_hs_request_port(struct uart_port *port)
 	return 0;
 }
 
+static ssize_t msm_hs_rx_stats_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct platform_device *pdev = to_platform_device(dev);
+	struct msm_hs_rx *rx = &q_uart_port[pdev->id].rx;
+
+	return sprintf(buf, "overruns %lu\nstalls %lu\n"
+		       "rearm_us_last %u\nrearm_us_max %u\n",
+		       rx->overruns, rx->stalls,
+		       rx->rearm_us_last, rx->rearm_us_max);
+}
+
+static DEVICE_ATTR(rx_stats, S_IRUGO, msm_hs_rx_stats_show, NULL);
+
 static int __devexit msm_hs_remove(struct platform_device *pdev)
 {
 
 	struct msm_hs_port *msm_uport;
 	struct device *dev;
+	int i;
 
 	if (pdev->id < 0 || pdev->id >= UARTDM_NR) {
 		printk(KERN_ERR "Invalid plaform device ID = %d\n", pdev->id);
@@ -210,10 +249,13 @@ static int __devexit msm_hs_remove(struct platform_device *pdev)
 	msm_uport = &q_uart_port[pdev->id];
 	dev = msm_uport->uport.dev;
 
+	device_remove_file(&pdev->dev, &dev_attr_rx_stats);
+
 	dma_unmap_single(dev, msm_uport->rx.mapped_cmd_ptr, sizeof(dmov_box),
 			 DMA_TO_DEVICE);
-	dma_pool_free(msm_uport->rx.pool, msm_uport->rx.buffer,
-		      msm_uport->rx.rbuffer);
+	for (i = 0; i < UARTDM_RX_BUF_CNT; i++)
+		dma_pool_free(msm_uport->rx.pool, msm_uport->rx.buf[i].buffer,
+			      msm_uport->rx.buf[i].rbuffer);
 	dma_pool_destroy(msm_uport->rx.pool);
 
 	dma_unmap_single(dev, msm_uport->rx.cmdptr_dmaaddr, sizeof(u32 *),
@@ -225,6 +267,8 @@ static int __devexit msm_hs_remove(struct platform_device *pdev)
 
 	wake_lock_destroy(&msm_uport->rx.wake_lock);
 	wake_lock_destroy(&msm_uport->dma_wake_lock);
+	if (msm_uport->cpu_dma_latency)
+		pm_qos_remove_request(&msm_uport->pm_qos_req);
 
 	uart_remove_one_port(&msm_hs_driver, &msm_uport->uport);
 	clk_put(msm_uport->clk);
@@ -242,12 +286,27 @@ static int __devexit msm_hs_remove(struct platform_device *pdev)
 	return 0;
 }
 
+/*
+ * Follows dma_wake_lock: while the clock is on, RX DMA can complete at
+ * any time and waking from power collapse would add milliseconds to the
+ * interrupt latency, enough to overrun the FIFO at BT baud rates.
+ */
+static void msm_hs_pm_qos_locked(struct msm_hs_port *msm_uport, int on)
+{
+	if (!msm_uport->cpu_dma_latency)
+		return;
+	pm_qos_update_request(&msm_uport->pm_qos_req,
+			      on ? msm_uport->cpu_dma_latency :
+			      PM_QOS_DEFAULT_VALUE);
+}
+
 static int msm_hs_init_clk_locked(struct uart_port *uport)
 {
 	int ret;
 	struct msm_hs_port *msm_uport = UARTDM_TO_MSM(uport);
 
 	wake_lock(&msm_uport->dma_wake_lock);
+	msm_hs_pm_qos_locked(msm_uport, 1);
 	ret = clk_enable(msm_uport->clk);
 	if (ret) {
 		printk(KERN_ERR "Error could not turn on UART clk\n");
@@ -561,7 +620,11 @@ static void msm_hs_stop_rx_locked(struct uart_port *uport)
 		wake_lock(&msm_uport->rx.wake_lock);
 		msm_dmov_flush(msm_uport->dma_rx_channel);
 	}
-	if (msm_uport->rx.flush != FLUSH_SHUTDOWN)
+	if (msm_uport->rx.stalled) {
+		/* no DMA in flight, so no callback will finish the stop */
+		msm_uport->rx.stalled = 0;
+		msm_uport->rx.flush = FLUSH_SHUTDOWN;
+	} else if (msm_uport->rx.flush != FLUSH_SHUTDOWN)
 		msm_uport->rx.flush = FLUSH_STOP;
 
 	clk_disable(msm_uport->clk);
@@ -617,13 +680,39 @@ static void msm_hs_submit_tx_locked(struct uart_port *uport)
 	/* Disable the tx_ready interrupt */
 	msm_uport->imr_reg &= ~UARTDM_ISR_TX_READY_BMSK;
 	msm_hs_write(uport, UARTDM_IMR_ADDR, msm_uport->imr_reg);
-	msm_dmov_enqueue_cmd(msm_uport->dma_tx_channel, &tx->xfer);
+	msm_dmov_enqueue_cmd_prio(msm_uport->dma_tx_channel, &tx->xfer,
+				  MSM_DMOV_PRIO_HIGH);
 }
 
-/* Start to receive the next chunk of data */
+/*
+ * Start to receive the next chunk of data into the next free buffer.
+ * If every buffer still waits for the tty work, leave the receiver
+ * off (auto RFR holds the sender back) and let the work rearm it.
+ */
 static void msm_hs_start_rx_locked(struct uart_port *uport)
 {
 	struct msm_hs_port *msm_uport = UARTDM_TO_MSM(uport);
+	struct msm_hs_rx *rx = &msm_uport->rx;
+
+	if (rx->head - rx->tail >= UARTDM_RX_BUF_CNT) {
+		if (!rx->stalled)
+			rx->stalls++;
+		rx->stalled = 1;
+		return;
+	}
+
+	if (rx->stale_time.tv64) {
+		rx->rearm_us_last = ktime_us_delta(ktime_get(),
+						   rx->stale_time);
+		if (rx->rearm_us_last > rx->rearm_us_max)
+			rx->rearm_us_max = rx->rearm_us_last;
+		rx->stale_time.tv64 = 0;
+	}
+
+	rx->command_ptr->dst_row_addr =
+		rx->buf[rx->head % UARTDM_RX_BUF_CNT].rbuffer;
+	dma_sync_single_for_device(uport->dev, rx->mapped_cmd_ptr,
+				   sizeof(dmov_box), DMA_TO_DEVICE);
 
 	msm_hs_write(uport, UARTDM_CR_ADDR, RESET_STALE_INT);
 	msm_hs_write(uport, UARTDM_DMRX_ADDR, UARTDM_RX_BUF_SIZE);
@@ -632,7 +721,8 @@ static void msm_hs_start_rx_locked(struct uart_port *uport)
 	msm_hs_write(uport, UARTDM_IMR_ADDR, msm_uport->imr_reg);
 
 	msm_uport->rx.flush = FLUSH_NONE;
-	msm_dmov_enqueue_cmd(msm_uport->dma_rx_channel, &msm_uport->rx.xfer);
+	msm_dmov_enqueue_cmd_prio(msm_uport->dma_rx_channel,
+				  &msm_uport->rx.xfer, MSM_DMOV_PRIO_HIGH);
 
 	/* might have finished RX and be ready to clock off */
 	hrtimer_start(&msm_uport->clk_off_timer, msm_uport->clk_off_delay,
@@ -695,15 +785,15 @@ static void msm_hs_dmov_rx_callback(struct msm_dmov_cmd *cmd_ptr,
 					unsigned int result,
 					struct msm_dmov_errdata *err)
 {
-	int retval;
 	int rx_count;
 	unsigned long status;
+	unsigned long errors = 0;
 	unsigned int error_f = 0;
 	unsigned long flags;
 	unsigned int flush;
-	struct tty_struct *tty;
 	struct uart_port *uport;
 	struct msm_hs_port *msm_uport;
+	struct msm_hs_rx_buf *chunk;
 
 	msm_uport = container_of(cmd_ptr, struct msm_hs_port, rx.xfer);
 	uport = &msm_uport->uport;
@@ -711,8 +801,6 @@ static void msm_hs_dmov_rx_callback(struct msm_dmov_cmd *cmd_ptr,
 	spin_lock_irqsave(&uport->lock, flags);
 	clk_enable(msm_uport->clk);
 
-	tty = uport->state->port.tty;
-
 	msm_hs_write(uport, UARTDM_CR_ADDR, STALE_EVENT_DISABLE);
 
 	status = msm_hs_read(uport, UARTDM_SR_ADDR);
@@ -720,8 +808,9 @@ static void msm_hs_dmov_rx_callback(struct msm_dmov_cmd *cmd_ptr,
 	/* overflow is not connect to data in a FIFO */
 	if (unlikely((status & UARTDM_SR_OVERRUN_BMSK) &&
 		     (uport->read_status_mask & CREAD))) {
-		tty_insert_flip_char(tty, 0, TTY_OVERRUN);
+		errors |= UARTDM_SR_OVERRUN_BMSK;
 		uport->icount.buf_overrun++;
+		msm_uport->rx.overruns++;
 		error_f = 1;
 	}
 
@@ -733,7 +822,7 @@ static void msm_hs_dmov_rx_callback(struct msm_dmov_cmd *cmd_ptr,
 		uport->icount.parity++;
 		error_f = 1;
 		if (uport->ignore_status_mask & IGNPAR)
-			tty_insert_flip_char(tty, 0, TTY_PARITY);
+			errors |= UARTDM_SR_PAR_FRAME_BMSK;
 	}
 
 	if (error_f)
@@ -753,9 +842,11 @@ static void msm_hs_dmov_rx_callback(struct msm_dmov_cmd *cmd_ptr,
 	rx_count = msm_hs_read(uport, UARTDM_RX_TOTAL_SNAP_ADDR);
 
 	if (0 != (uport->read_status_mask & CREAD)) {
-		retval = tty_insert_flip_string(tty, msm_uport->rx.buffer,
-						rx_count);
-		BUG_ON(retval != rx_count);
+		chunk = &msm_uport->rx.buf[msm_uport->rx.head %
+					   UARTDM_RX_BUF_CNT];
+		chunk->count = rx_count;
+		chunk->errors = errors;
+		msm_uport->rx.head++;
 	}
 
 	msm_hs_start_rx_locked(uport);
@@ -771,13 +862,70 @@ out:
 		queue_work(msm_hs_workqueue, &msm_uport->rx.tty_work);
 }
 
+static void msm_hs_insert_chunk(struct uart_port *uport,
+				struct msm_hs_rx_buf *chunk)
+{
+	struct tty_struct *tty = uport->state->port.tty;
+	int retval;
+
+	if (chunk->errors & UARTDM_SR_OVERRUN_BMSK)
+		tty_insert_flip_char(tty, 0, TTY_OVERRUN);
+	if (chunk->errors & UARTDM_SR_PAR_FRAME_BMSK)
+		tty_insert_flip_char(tty, 0, TTY_PARITY);
+
+	retval = tty_insert_flip_string(tty, chunk->buffer, chunk->count);
+	if (retval != chunk->count)
+		uport->icount.buf_overrun++;
+}
+
+/*
+ * Hand the completed chunks to the tty. The HCI line discipline takes
+ * them straight from the DMA buffers, anything else goes through the
+ * flip buffer. Error flags are only meaningful on the flip path.
+ */
 static void msm_hs_tty_flip_buffer_work(struct work_struct *work)
 {
 	struct msm_hs_port *msm_uport =
 			container_of(work, struct msm_hs_port, rx.tty_work);
-	struct tty_struct *tty = msm_uport->uport.state->port.tty;
+	struct uart_port *uport = &msm_uport->uport;
+	struct msm_hs_rx *rx = &msm_uport->rx;
+	struct tty_struct *tty = uport->state->port.tty;
+	struct tty_ldisc *ld;
+	unsigned long flags;
+	int direct;
 
+	/* chars injected on wakeup go first */
 	tty_flip_buffer_push(tty);
+
+	ld = tty_ldisc_ref(tty);
+	direct = ld && ld->ops->num == N_HCI && ld->ops->receive_buf;
+
+	spin_lock_irqsave(&uport->lock, flags);
+	while (rx->tail != rx->head) {
+		struct msm_hs_rx_buf *chunk =
+			&rx->buf[rx->tail % UARTDM_RX_BUF_CNT];
+
+		spin_unlock_irqrestore(&uport->lock, flags);
+		if (direct)
+			ld->ops->receive_buf(tty, chunk->buffer, NULL,
+					     chunk->count);
+		else
+			msm_hs_insert_chunk(uport, chunk);
+		spin_lock_irqsave(&uport->lock, flags);
+		rx->tail++;
+	}
+	if (rx->stalled) {
+		rx->stalled = 0;
+		clk_enable(msm_uport->clk);
+		msm_hs_start_rx_locked(uport);
+		clk_disable(msm_uport->clk);
+	}
+	spin_unlock_irqrestore(&uport->lock, flags);
+
+	if (ld)
+		tty_ldisc_deref(ld);
+	if (!direct)
+		tty_flip_buffer_push(tty);
 }
 
 /*
@@ -949,6 +1097,7 @@ static int msm_hs_check_clock_off_locked(struct uart_port *uport)
 	clk_disable(msm_uport->clk);
 	msm_uport->clk_state = MSM_HS_CLK_OFF;
 	wake_unlock(&msm_uport->dma_wake_lock);
+	msm_hs_pm_qos_locked(msm_uport, 0);
 	if (use_low_power_rx_wakeup(msm_uport)) {
 		msm_uport->rx_wakeup.ignore = 1;
 		enable_irq(msm_uport->rx_wakeup.irq);
@@ -1006,6 +1155,7 @@ static irqreturn_t msm_hs_isr(int irq, void *dev)
 					CLK_REQ_OFF_FLUSH_ISSUED;
 		if (rx->flush == FLUSH_NONE) {
 			rx->flush = FLUSH_DATA_READY;
+			rx->stale_time = ktime_get();
 			msm_dmov_flush(msm_uport->dma_rx_channel);
 		}
 	}
@@ -1085,6 +1235,7 @@ void msm_hs_request_clock_on_locked(struct uart_port *uport)
 	switch (msm_uport->clk_state) {
 	case MSM_HS_CLK_OFF:
 		wake_lock(&msm_uport->dma_wake_lock);
+		msm_hs_pm_qos_locked(msm_uport, 1);
 		clk_enable(msm_uport->clk);
 		disable_irq_nosync(msm_uport->rx_wakeup.irq);
 		/* fall-through */
@@ -1281,6 +1432,9 @@ static int msm_hs_startup(struct uart_port *uport)
 	spin_lock_irqsave(&uport->lock, flags);
 
 	msm_hs_write(uport, UARTDM_RFWR_ADDR, 0);
+	rx->head = rx->tail = 0;
+	rx->stalled = 0;
+	rx->stale_time.tv64 = 0;
 	msm_hs_start_rx_locked(uport);
 
 	spin_unlock_irqrestore(&uport->lock, flags);
@@ -1294,6 +1448,7 @@ static int uartdm_init_port(struct uart_port *uport)
 	struct msm_hs_port *msm_uport = UARTDM_TO_MSM(uport);
 	struct msm_hs_tx *tx = &msm_uport->tx;
 	struct msm_hs_rx *rx = &msm_uport->rx;
+	int i;
 
 	/* Allocate the command pointer. Needs to be 64 bit aligned */
 	tx->command_ptr = kmalloc(sizeof(dmov_box), GFP_KERNEL | __GFP_DMA);
@@ -1318,21 +1473,27 @@ static int uartdm_init_port(struct uart_port *uport)
 	rx->pool = dma_pool_create("rx_buffer_pool", uport->dev,
 				   UARTDM_RX_BUF_SIZE, 16, 0);
 
-	rx->buffer = dma_pool_alloc(rx->pool, GFP_KERNEL, &rx->rbuffer);
+	if (!rx->pool)
+		return -ENOMEM;
+	for (i = 0; i < UARTDM_RX_BUF_CNT; i++) {
+		rx->buf[i].buffer = dma_pool_alloc(rx->pool, GFP_KERNEL,
+						   &rx->buf[i].rbuffer);
+		if (!rx->buf[i].buffer)
+			return -ENOMEM;
+	}
 
 	/* Allocate the command pointer. Needs to be 64 bit aligned */
 	rx->command_ptr = kmalloc(sizeof(dmov_box), GFP_KERNEL | __GFP_DMA);
 
 	rx->command_ptr_ptr = kmalloc(sizeof(u32 *), GFP_KERNEL | __GFP_DMA);
 
-	if (!rx->command_ptr || !rx->command_ptr_ptr || !rx->pool ||
-	    !rx->buffer)
+	if (!rx->command_ptr || !rx->command_ptr_ptr)
 		return -ENOMEM;
 
 	rx->command_ptr->num_rows = ((UARTDM_RX_BUF_SIZE >> 4) << 16) |
 					 (UARTDM_RX_BUF_SIZE >> 4);
 
-	rx->command_ptr->dst_row_addr = rx->rbuffer;
+	rx->command_ptr->dst_row_addr = rx->buf[0].rbuffer;
 
 	rx->mapped_cmd_ptr = dma_map_single(uport->dev, rx->command_ptr,
 					    sizeof(dmov_box), DMA_TO_DEVICE);
@@ -1407,6 +1568,9 @@ static int msm_hs_probe(struct platform_device *pdev)
 	else
 		msm_uport->exit_lpm_cb = pdata->exit_lpm_cb;
 
+	if (pdata)
+		msm_uport->cpu_dma_latency = pdata->cpu_dma_latency;
+
 	resource = platform_get_resource_byname(pdev, IORESOURCE_DMA,
 						"uartdm_channels");
 	if (unlikely(!resource))
@@ -1444,8 +1608,21 @@ static int msm_hs_probe(struct platform_device *pdev)
 	msm_uport->clk_off_timer.function = msm_hs_clk_off_retry;
 	msm_uport->clk_off_delay = ktime_set(0, 1000000);  /* 1ms */
 
+	if (msm_uport->cpu_dma_latency)
+		pm_qos_add_request(&msm_uport->pm_qos_req,
+				   PM_QOS_CPU_DMA_LATENCY, PM_QOS_DEFAULT_VALUE);
+
 	uport->line = pdev->id;
-	return uart_add_one_port(&msm_hs_driver, uport);
+	ret = uart_add_one_port(&msm_hs_driver, uport);
+	if (unlikely(ret)) {
+		if (msm_uport->cpu_dma_latency)
+			pm_qos_remove_request(&msm_uport->pm_qos_req);
+		return ret;
+	}
+
+	if (device_create_file(&pdev->dev, &dev_attr_rx_stats))
+		dev_warn(&pdev->dev, "could not create rx_stats\n");
+	return 0;
 }
 
 static int __init msm_serial_hs_init(void)
@@ -1513,6 +1690,7 @@ static void msm_hs_shutdown(struct uart_port *uport)
 	clk_disable(msm_uport->clk);  /* to balance local clk_enable() */
 	if (msm_uport->clk_state != MSM_HS_CLK_OFF) {
 		wake_unlock(&msm_uport->dma_wake_lock);
+		msm_hs_pm_qos_locked(msm_uport, 0);
 		clk_disable(msm_uport->clk);  /* to balance clk_state */
 	}
 	msm_uport->clk_state = MSM_HS_CLK_PORT_OFF;
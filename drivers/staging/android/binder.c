@@ -19,7 +19,9 @@
 #include <linux/fdtable.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/lock_prof.h>
 #include <linux/miscdevice.h>
 #include <linux/mm.h>
 #include <linux/module.h>
@@ -38,6 +40,7 @@
 #include "binder.h"
 
 static DEFINE_MUTEX(binder_lock);
+static DEFINE_LOCK_PROF(binder_lock_prof, "binder_lock");
 static DEFINE_MUTEX(binder_deferred_lock);
 static DEFINE_MUTEX(binder_mmap_lock);
 
@@ -112,6 +115,10 @@ module_param_named(debug_mask, binder_debug_mask, uint, S_IWUSR | S_IRUGO);
 static bool binder_debug_no_lock;
 module_param_named(proc_no_lock, binder_debug_no_lock, bool, S_IWUSR | S_IRUGO);
 
+static int binder_max_retained_pages = 16;
+module_param_named(max_retained_pages, binder_max_retained_pages,
+		   int, S_IWUSR | S_IRUGO);
+
 static DECLARE_WAIT_QUEUE_HEAD(binder_user_error_wait);
 static int binder_stop_on_user_error;
 
@@ -171,6 +178,32 @@ static inline void binder_stats_created(enum binder_stat_types type)
 	binder_stats.obj_created[type]++;
 }
 
+/*
+ * Latency histograms, bucket n counts events that took less than 2^n
+ * usec (the last bucket is open ended).
+ */
+#define BINDER_LATENCY_BUCKETS 20
+
+struct binder_latency_stats {
+	u32 queue[BINDER_LATENCY_BUCKETS];	/* enqueue to dequeue */
+	u32 reply[BINDER_LATENCY_BUCKETS];	/* dequeue to BC_REPLY */
+	u32 starved;	/* proc work queued with no ready thread */
+};
+
+static inline void binder_latency_add(u32 *hist, ktime_t start)
+{
+	s64 delta = ktime_us_delta(ktime_get(), start);
+	int bucket;
+
+	if (delta <= 0)
+		bucket = 0;
+	else if (delta >= 1LL << (BINDER_LATENCY_BUCKETS - 1))
+		bucket = BINDER_LATENCY_BUCKETS - 1;
+	else
+		bucket = fls((u32)delta);
+	hist[bucket]++;
+}
+
 struct binder_transaction_log_entry {
 	int debug_id;
 	int call_type;
@@ -270,7 +303,8 @@ struct binder_buffer {
 	unsigned free:1;
 	unsigned allow_user_free:1;
 	unsigned async_transaction:1;
-	unsigned debug_id:29;
+	unsigned pinned:1;	/* backs a BINDER_TYPE_PAGES object */
+	unsigned debug_id:28;
 
 	struct binder_transaction *transaction;
 
@@ -301,12 +335,22 @@ struct binder_proc {
 	void *buffer;
 	ptrdiff_t user_buffer_offset;
 
+	/*
+	 * alloc_lock protects the buffer allocator state below (buffers,
+	 * free_buffers, allocated_buffers, free_async_space and pages).
+	 * It nests inside binder_lock, but may also be taken on its own:
+	 * binder_transaction drops binder_lock while it allocates a buffer
+	 * in the target and copies the payload into it. Allocated buffers
+	 * are only ever removed with both locks held.
+	 */
+	struct mutex alloc_lock;
 	struct list_head buffers;
 	struct rb_root free_buffers;
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
 
 	struct page **pages;
+	int retained_pages;	/* mapped pages in free buffers */
 	size_t buffer_size;
 	uint32_t buffer_free;
 	struct list_head todo;
@@ -319,6 +363,9 @@ struct binder_proc {
 	int ready_threads;
 	long default_priority;
 	struct dentry *debugfs_entry;
+	struct binder_latency_stats latency;
+	int tmp_ref;		/* pins proc while binder_lock is dropped */
+	unsigned is_dead:1;	/* released, but still pinned by tmp_ref */
 };
 
 enum {
@@ -361,12 +408,30 @@ struct binder_transaction {
 	unsigned int	flags;
 	long	priority;
 	long	saved_priority;
+	/* scheduler policy and rt priority, inherited across sync calls */
+	int	policy;
+	int	rt_priority;
+	int	saved_policy;
+	int	saved_rt_priority;
 	uid_t	sender_euid;
+	ktime_t	timestamp;	/* queued, or delivered if awaiting reply */
 };
 
 static void
 binder_defer_work(struct binder_proc *proc, enum binder_deferred_state defer);
 
+/*
+ * Drop a reference taken with proc->tmp_ref++. Must be called with
+ * binder_lock held. Frees the proc if binder_deferred_release ran while
+ * the reference was held.
+ */
+static void binder_proc_dec_tmpref(struct binder_proc *proc)
+{
+	proc->tmp_ref--;
+	if (proc->is_dead && !proc->tmp_ref)
+		kfree(proc);
+}
+
 /*
  * copied from get_unused_fd_flags
  */
@@ -522,6 +587,57 @@ static void binder_set_nice(long nice)
 	binder_user_error("binder: %d RLIMIT_NICE not set\n", current->pid);
 }
 
+static inline int binder_is_rt_policy(int policy)
+{
+	return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+static void binder_set_policy(int policy, int rt_priority)
+{
+	struct sched_param param = { .sched_priority = rt_priority };
+
+	if (current->policy == policy && current->rt_priority == rt_priority)
+		return;
+	if (sched_setscheduler_nocheck(current, policy, &param))
+		binder_user_error("binder: %d failed to set policy %d prio %d\n",
+				  current->pid, policy, rt_priority);
+}
+
+/*
+ * Give the servicing thread the caller's priority for a synchronous
+ * transaction. RT callers lend their policy and rt priority, so that a
+ * SCHED_FIFO client is not stuck behind a CFS scheduled binder thread.
+ */
+static void binder_inherit_priority(struct binder_transaction *t,
+				    struct binder_node *target_node)
+{
+	t->saved_priority = task_nice(current);
+	t->saved_policy = current->policy;
+	t->saved_rt_priority = current->rt_priority;
+	if (!(t->flags & TF_ONE_WAY) && binder_is_rt_policy(t->policy) &&
+	    (!binder_is_rt_policy(current->policy) ||
+	     current->rt_priority < t->rt_priority))
+		binder_set_policy(t->policy, t->rt_priority);
+
+	if (t->priority < target_node->min_priority &&
+	    !(t->flags & TF_ONE_WAY))
+		binder_set_nice(t->priority);
+	else if (!(t->flags & TF_ONE_WAY) ||
+		 t->saved_priority > target_node->min_priority)
+		binder_set_nice(target_node->min_priority);
+}
+
+/*
+ * Undo binder_inherit_priority when replying to t. Transactions nest on
+ * the thread's transaction stack, so restoring what was saved when t was
+ * received also unwinds nested inheritance in order.
+ */
+static void binder_restore_priority(struct binder_transaction *t)
+{
+	binder_set_policy(t->saved_policy, t->saved_rt_priority);
+	binder_set_nice(t->saved_priority);
+}
+
 static size_t binder_buffer_size(struct binder_proc *proc,
 				 struct binder_buffer *buffer)
 {
@@ -614,19 +730,65 @@ static struct binder_buffer *binder_buffer_lookup(struct binder_proc *proc,
 	return NULL;
 }
 
+static struct binder_buffer *binder_pinned_buffer_lookup(
+	struct binder_proc *proc, void __user *user_ptr)
+{
+	struct rb_node *n = proc->allocated_buffers.rb_node;
+	struct binder_buffer *buffer;
+	struct binder_buffer *found = NULL;
+	void *kern_ptr;
+
+	kern_ptr = user_ptr - proc->user_buffer_offset;
+
+	while (n) {
+		buffer = rb_entry(n, struct binder_buffer, rb_node);
+		BUG_ON(buffer->free);
+
+		if ((void *)buffer < kern_ptr) {
+			found = buffer;
+			n = n->rb_right;
+		} else
+			n = n->rb_left;
+	}
+	if (found && found->pinned &&
+	    (void *)PAGE_ALIGN((uintptr_t)found->data) == kern_ptr)
+		return found;
+	return NULL;
+}
+
+/*
+ * Populate (allocate > 0) or release (allocate <= 0) the pages backing
+ * [start, end) of the binder area.
+ *
+ * When allocating, pages are taken from src_pages (an extra reference
+ * is taken on each) if it is set, and allocated otherwise. Each run of
+ * missing pages is mapped into the kernel with a single map_vm_area
+ * call. Pages that are still mapped because they were retained by an
+ * earlier release are reused as they are.
+ *
+ * A release with allocate == 0 keeps up to binder_max_retained_pages
+ * pages per proc mapped, so that the next allocation in the same range
+ * does not have to allocate and map them again. allocate < 0 always
+ * releases the pages; it is used for pages borrowed from another
+ * process.
+ */
 static int binder_update_page_range(struct binder_proc *proc, int allocate,
 				    void *start, void *end,
-				    struct vm_area_struct *vma)
+				    struct vm_area_struct *vma,
+				    struct page **src_pages)
 {
 	void *page_addr;
+	void *run_end;
 	unsigned long user_page_addr;
 	struct vm_struct tmp_area;
 	struct page **page;
+	struct page **run;
 	struct mm_struct *mm;
+	int ret;
 
 	binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "binder: %d: %s pages %p-%p\n", proc->pid,
-		     allocate ? "allocate" : "free", start, end);
+		     allocate > 0 ? "allocate" : "free", start, end);
 
 	if (end <= start)
 		return 0;
@@ -646,7 +808,7 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		}
 	}
 
-	if (allocate == 0)
+	if (allocate <= 0)
 		goto free_range;
 
 	if (vma == NULL) {
@@ -655,36 +817,73 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		goto err_no_vma;
 	}
 
-	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
-		int ret;
-		struct page **page_array_ptr;
-		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+	if (src_pages) {
+		/* retained pages cannot be reused for borrowed ones */
+		for (page_addr = start; page_addr < end;
+		     page_addr += PAGE_SIZE) {
+			page = &proc->pages[(page_addr - proc->buffer) /
+					    PAGE_SIZE];
+			if (*page == NULL)
+				continue;
+			zap_page_range(vma, (uintptr_t)page_addr +
+				proc->user_buffer_offset, PAGE_SIZE, NULL);
+			unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
+			put_page(*page);
+			*page = NULL;
+			proc->retained_pages--;
+		}
+	}
 
-		BUG_ON(*page);
-		*page = alloc_page(GFP_KERNEL | __GFP_ZERO);
-		if (*page == NULL) {
-			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
-			       "for page at %p\n", proc->pid, page_addr);
-			goto err_alloc_page_failed;
+	for (page_addr = start; page_addr < end; page_addr = run_end) {
+		run = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (*run) {
+			/* still mapped since it was last released */
+			BUG_ON(proc->retained_pages <= 0);
+			proc->retained_pages--;
+			run_end = page_addr + PAGE_SIZE;
+			continue;
 		}
+
+		for (run_end = page_addr, page = run;
+		     run_end < end && *page == NULL;
+		     run_end += PAGE_SIZE, page++) {
+			if (src_pages) {
+				*page = src_pages[(run_end - start) /
+						  PAGE_SIZE];
+				get_page(*page);
+			} else
+				*page = alloc_page(GFP_KERNEL | __GFP_ZERO);
+			if (*page == NULL) {
+				printk(KERN_ERR "binder: %d: binder_alloc_buf "
+				       "failed for page at %p\n",
+				       proc->pid, run_end);
+				goto err_alloc_page_failed;
+			}
+		}
+
 		tmp_area.addr = page_addr;
-		tmp_area.size = PAGE_SIZE + PAGE_SIZE /* guard page? */;
-		page_array_ptr = page;
-		ret = map_vm_area(&tmp_area, PAGE_KERNEL, &page_array_ptr);
+		tmp_area.size = run_end - page_addr + PAGE_SIZE /* guard page? */;
+		page = run;
+		ret = map_vm_area(&tmp_area, PAGE_KERNEL, &page);
 		if (ret) {
 			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
-			       "to map page at %p in kernel\n",
-			       proc->pid, page_addr);
+			       "to map pages at %p-%p in kernel\n",
+			       proc->pid, page_addr, run_end);
 			goto err_map_kernel_failed;
 		}
 		user_page_addr =
 			(uintptr_t)page_addr + proc->user_buffer_offset;
-		ret = vm_insert_page(vma, user_page_addr, page[0]);
-		if (ret) {
-			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
-			       "to map page at %lx in userspace\n",
-			       proc->pid, user_page_addr);
-			goto err_vm_insert_page_failed;
+		for (page = run; user_page_addr <
+		     (uintptr_t)run_end + proc->user_buffer_offset;
+		     user_page_addr += PAGE_SIZE, page++) {
+			ret = vm_insert_page(vma, user_page_addr, *page);
+			if (ret) {
+				printk(KERN_ERR "binder: %d: binder_alloc_buf "
+				       "failed to map page at %lx in "
+				       "userspace\n", proc->pid,
+				       user_page_addr);
+				goto err_vm_insert_page_failed;
+			}
 		}
 		/* vm_insert_page does not seem to increment the refcount */
 	}
@@ -694,20 +893,38 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	}
 	return 0;
 
+err_vm_insert_page_failed:
+	if (user_page_addr > (uintptr_t)page_addr + proc->user_buffer_offset)
+		zap_page_range(vma, (uintptr_t)page_addr +
+			proc->user_buffer_offset, user_page_addr -
+			((uintptr_t)page_addr + proc->user_buffer_offset),
+			NULL);
+	unmap_kernel_range((unsigned long)page_addr, run_end - page_addr);
+err_map_kernel_failed:
+err_alloc_page_failed:
+	for (page = run; page < run + (run_end - page_addr) / PAGE_SIZE;
+	     page++) {
+		put_page(*page);
+		*page = NULL;
+	}
+	/* release the runs that were set up before the failing one */
+	end = page_addr;
+
 free_range:
 	for (page_addr = end - PAGE_SIZE; page_addr >= start;
 	     page_addr -= PAGE_SIZE) {
 		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (allocate == 0 &&
+		    proc->retained_pages < binder_max_retained_pages) {
+			proc->retained_pages++;
+			continue;
+		}
 		if (vma)
 			zap_page_range(vma, (uintptr_t)page_addr +
 				proc->user_buffer_offset, PAGE_SIZE, NULL);
-err_vm_insert_page_failed:
 		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
-err_map_kernel_failed:
-		__free_page(*page);
+		put_page(*page);
 		*page = NULL;
-err_alloc_page_failed:
-		;
 	}
 err_no_vma:
 	if (mm) {
@@ -717,9 +934,18 @@ err_no_vma:
 	return -ENOMEM;
 }
 
-static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
-					      size_t data_size,
-					      size_t offsets_size, int is_async)
+/*
+ * Must be called with proc->alloc_lock held. With nr_pages set, the
+ * buffer data is laid out so that nr_pages page aligned pages, taken
+ * from pages, start at PAGE_ALIGN(buffer->data); data_size and
+ * offsets_size are ignored in that case.
+ */
+static struct binder_buffer *__binder_alloc_buf(struct binder_proc *proc,
+						size_t data_size,
+						size_t offsets_size,
+						int is_async,
+						struct page **pages,
+						int nr_pages)
 {
 	struct rb_node *n = proc->free_buffers.rb_node;
 	struct binder_buffer *buffer;
@@ -727,6 +953,7 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 	struct rb_node *best_fit = NULL;
 	void *has_page_addr;
 	void *end_page_addr;
+	void *pinned_end_addr;
 	size_t size;
 
 	if (proc->vma == NULL) {
@@ -735,6 +962,11 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 		return NULL;
 	}
 
+	if (nr_pages) {
+		/* worst case, before the data start is known */
+		data_size = (nr_pages + 1) * PAGE_SIZE;
+		offsets_size = 0;
+	}
 	size = ALIGN(data_size, sizeof(void *)) +
 		ALIGN(offsets_size, sizeof(void *));
 
@@ -776,6 +1008,11 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 		buffer = rb_entry(best_fit, struct binder_buffer, rb_node);
 		buffer_size = binder_buffer_size(proc, buffer);
 	}
+	if (nr_pages) {
+		data_size = size = PAGE_ALIGN((uintptr_t)buffer->data) -
+			(uintptr_t)buffer->data + nr_pages * PAGE_SIZE;
+		offsets_size = 0;
+	}
 
 	binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "binder: %d: binder_alloc_buf size %zd got buff"
@@ -783,7 +1020,7 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 
 	has_page_addr =
 		(void *)(((uintptr_t)buffer->data + buffer_size) & PAGE_MASK);
-	if (n == NULL) {
+	if (size != buffer_size) {
 		if (size + sizeof(struct binder_buffer) + 4 >= buffer_size)
 			buffer_size = size; /* no room for other buffers */
 		else
@@ -793,9 +1030,19 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 		(void *)PAGE_ALIGN((uintptr_t)buffer->data + buffer_size);
 	if (end_page_addr > has_page_addr)
 		end_page_addr = has_page_addr;
+	pinned_end_addr = (void *)PAGE_ALIGN((uintptr_t)buffer->data) +
+		nr_pages * PAGE_SIZE;
 	if (binder_update_page_range(proc, 1,
-	    (void *)PAGE_ALIGN((uintptr_t)buffer->data), end_page_addr, NULL))
+	    (void *)PAGE_ALIGN((uintptr_t)buffer->data), pinned_end_addr,
+	    NULL, pages))
 		return NULL;
+	if (binder_update_page_range(proc, 1, pinned_end_addr, end_page_addr,
+	    NULL, NULL)) {
+		binder_update_page_range(proc, -1,
+			(void *)PAGE_ALIGN((uintptr_t)buffer->data),
+			pinned_end_addr, NULL, NULL);
+		return NULL;
+	}
 
 	rb_erase(best_fit, &proc->free_buffers);
 	buffer->free = 0;
@@ -812,6 +1059,7 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 	buffer->data_size = data_size;
 	buffer->offsets_size = offsets_size;
 	buffer->async_transaction = is_async;
+	buffer->pinned = !!nr_pages;
 	if (is_async) {
 		proc->free_async_space -= size + sizeof(struct binder_buffer);
 		binder_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
@@ -823,6 +1071,14 @@ static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 	return buffer;
 }
 
+static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
+					      size_t data_size,
+					      size_t offsets_size, int is_async)
+{
+	return __binder_alloc_buf(proc, data_size, offsets_size, is_async,
+				  NULL, 0);
+}
+
 static void *buffer_start_page(struct binder_buffer *buffer)
 {
 	return (void *)((uintptr_t)buffer & PAGE_MASK);
@@ -876,10 +1132,13 @@ static void binder_delete_free_buffer(struct binder_proc *proc,
 		binder_update_page_range(proc, 0, free_page_start ?
 			buffer_start_page(buffer) : buffer_end_page(buffer),
 			(free_page_end ? buffer_end_page(buffer) :
-			buffer_start_page(buffer)) + PAGE_SIZE, NULL);
+			buffer_start_page(buffer)) + PAGE_SIZE, NULL, NULL);
 	}
 }
 
+/*
+ * Must be called with binder_lock and proc->alloc_lock held.
+ */
 static void binder_free_buf(struct binder_proc *proc,
 			    struct binder_buffer *buffer)
 {
@@ -909,10 +1168,10 @@ static void binder_free_buf(struct binder_proc *proc,
 			     proc->free_async_space);
 	}
 
-	binder_update_page_range(proc, 0,
+	binder_update_page_range(proc, buffer->pinned ? -1 : 0,
 		(void *)PAGE_ALIGN((uintptr_t)buffer->data),
 		(void *)(((uintptr_t)buffer->data + buffer_size) & PAGE_MASK),
-		NULL);
+		NULL, NULL);
 	rb_erase(&buffer->rb_node, &proc->allocated_buffers);
 	buffer->free = 1;
 	if (!list_is_last(&buffer->entry, &proc->buffers)) {
@@ -1379,6 +1638,23 @@ static void binder_transaction_buffer_release(struct binder_proc *proc,
 				task_close_fd(proc, fp->handle);
 			break;
 
+		case BINDER_TYPE_PAGES: {
+			struct binder_buffer *pinned;
+
+			mutex_lock(&proc->alloc_lock);
+			pinned = binder_pinned_buffer_lookup(proc, fp->buffer);
+			if (pinned) {
+				binder_debug(BINDER_DEBUG_TRANSACTION,
+					     "        pages %p size %zd\n",
+					     fp->buffer, fp->length);
+				binder_free_buf(proc, pinned);
+			} else
+				printk(KERN_ERR "binder: transaction release "
+				       "%d bad pages %p\n", debug_id,
+				       fp->buffer);
+			mutex_unlock(&proc->alloc_lock);
+		} break;
+
 		default:
 			printk(KERN_ERR "binder: transaction release %d bad "
 			       "object type %lx\n", debug_id, fp->type);
@@ -1387,6 +1663,82 @@ static void binder_transaction_buffer_release(struct binder_proc *proc,
 	}
 }
 
+/*
+ * Map the shared pages described by a BINDER_TYPE_PAGES object into
+ * target_proc's binder area and point fp->buffer at the new location.
+ */
+static int binder_transaction_pages(struct binder_proc *proc,
+				    struct binder_thread *thread,
+				    struct binder_proc *target_proc,
+				    struct flat_binder_object *fp,
+				    int is_async, int debug_id)
+{
+	unsigned long start = (uintptr_t)fp->buffer;
+	struct binder_buffer *buffer;
+	struct page **pages;
+	int nr_pages;
+	int got;
+	int i;
+
+	if (fp->length == 0 || !IS_ALIGNED(start, PAGE_SIZE) ||
+	    !IS_ALIGNED(fp->length, PAGE_SIZE) ||
+	    fp->length > target_proc->buffer_size / 2) {
+		binder_user_error("binder: %d:%d got transaction with invalid "
+			"pages %p size %zd\n", proc->pid, thread->pid,
+			fp->buffer, fp->length);
+		return -EINVAL;
+	}
+	nr_pages = fp->length / PAGE_SIZE;
+	pages = kmalloc(sizeof(*pages) * nr_pages, GFP_KERNEL);
+	if (pages == NULL)
+		return -ENOMEM;
+
+	down_read(&current->mm->mmap_sem);
+	got = get_user_pages(current, current->mm, start, nr_pages, 0, 0,
+			     pages, NULL);
+	up_read(&current->mm->mmap_sem);
+
+	buffer = NULL;
+	if (got < nr_pages) {
+		binder_user_error("binder: %d:%d got transaction with "
+			"unmapped pages %p size %zd\n", proc->pid,
+			thread->pid, fp->buffer, fp->length);
+		goto out;
+	}
+	for (i = 0; i < nr_pages; i++) {
+		/* only shared (e.g. ashmem) pages can be mapped elsewhere */
+		if (PageAnon(pages[i])) {
+			binder_user_error("binder: %d:%d got transaction with "
+				"private pages %p size %zd\n", proc->pid,
+				thread->pid, fp->buffer, fp->length);
+			goto out;
+		}
+	}
+
+	mutex_lock(&target_proc->alloc_lock);
+	buffer = __binder_alloc_buf(target_proc, 0, 0, is_async,
+				    pages, nr_pages);
+	if (buffer) {
+		buffer->allow_user_free = 0;
+		buffer->debug_id = debug_id;
+		buffer->transaction = NULL;
+		buffer->target_node = NULL;
+		fp->buffer = (void __user *)
+			PAGE_ALIGN((uintptr_t)buffer->data) +
+			target_proc->user_buffer_offset;
+	}
+	mutex_unlock(&target_proc->alloc_lock);
+
+	binder_debug(BINDER_DEBUG_TRANSACTION,
+		     "        pages %lx size %zd -> %p\n", start, fp->length,
+		     buffer ? fp->buffer : NULL);
+out:
+	for (i = 0; i < got; i++)
+		put_page(pages[i]);
+	kfree(pages);
+	return buffer ? 0 : -ENOMEM;
+}
+
 static void binder_transaction(struct binder_proc *proc,
 			       struct binder_thread *thread,
 			       struct binder_transaction_data *tr, int reply)
@@ -1401,6 +1753,7 @@ static void binder_transaction(struct binder_proc *proc,
 	wait_queue_head_t *target_wait;
 	struct binder_transaction *in_reply_to = NULL;
 	struct binder_transaction_log_entry *e;
+	const char *copy_failed;
 	uint32_t return_error;
 
 	e = binder_transaction_log_add(&binder_transaction_log);
@@ -1420,7 +1773,7 @@ static void binder_transaction(struct binder_proc *proc,
 			return_error = BR_FAILED_REPLY;
 			goto err_empty_call_stack;
 		}
-		binder_set_nice(in_reply_to->saved_priority);
+		binder_restore_priority(in_reply_to);
 		if (in_reply_to->to_thread != thread) {
 			binder_user_error("binder: %d:%d got reply transaction "
 				"with bad transaction stack,"
@@ -1435,6 +1788,7 @@ static void binder_transaction(struct binder_proc *proc,
 			goto err_bad_call_stack;
 		}
 		thread->transaction_stack = in_reply_to->to_parent;
+		binder_latency_add(proc->latency.reply, in_reply_to->timestamp);
 		target_thread = in_reply_to->from;
 		if (target_thread == NULL) {
 			return_error = BR_DEAD_REPLY;
@@ -1493,21 +1847,8 @@ static void binder_transaction(struct binder_proc *proc,
 				return_error = BR_FAILED_REPLY;
 				goto err_bad_call_stack;
 			}
-			while (tmp) {
-				if (tmp->from && tmp->from->proc == target_proc)
-					target_thread = tmp->from;
-				tmp = tmp->from_parent;
-			}
 		}
 	}
-	if (target_thread) {
-		e->to_thread = target_thread->pid;
-		target_list = &target_thread->todo;
-		target_wait = &target_thread->wait;
-	} else {
-		target_list = &target_proc->todo;
-		target_wait = &target_proc->wait;
-	}
 	e->to_proc = target_proc->pid;
 
 	/* TODO: reuse incoming transaction for reply */
@@ -1551,37 +1892,100 @@ static void binder_transaction(struct binder_proc *proc,
 		t->from = NULL;
 	t->sender_euid = proc->tsk->cred->euid;
 	t->to_proc = target_proc;
-	t->to_thread = target_thread;
 	t->code = tr->code;
 	t->flags = tr->flags;
 	t->priority = task_nice(current);
+	t->policy = current->policy;
+	t->rt_priority = current->rt_priority;
+
+	/*
+	 * Allocating the target buffer and copying the payload into it
+	 * are the expensive parts of a transaction and only touch the
+	 * target's allocator, so do them without binder_lock. The target
+	 * proc is pinned and the target node holds a local strong ref for
+	 * t->buffer->target_node; everything else is revalidated below.
+	 */
+	if (target_node)
+		binder_inc_node(target_node, 1, 0, NULL);
+	target_proc->tmp_ref++;
+	mutex_unlock(&binder_lock);
+
+	copy_failed = NULL;
+	mutex_lock(&target_proc->alloc_lock);
 	t->buffer = binder_alloc_buf(target_proc, tr->data_size,
 		tr->offsets_size, !reply && (t->flags & TF_ONE_WAY));
+	if (t->buffer) {
+		t->buffer->allow_user_free = 0;
+		t->buffer->debug_id = t->debug_id;
+		t->buffer->transaction = t;
+		t->buffer->target_node = target_node;
+
+		offp = (size_t *)(t->buffer->data +
+				  ALIGN(tr->data_size, sizeof(void *)));
+
+		if (copy_from_user(t->buffer->data, tr->data.ptr.buffer,
+				   tr->data_size))
+			copy_failed = "data";
+		else if (copy_from_user(offp, tr->data.ptr.offsets,
+					tr->offsets_size))
+			copy_failed = "offsets";
+	}
+	mutex_unlock(&target_proc->alloc_lock);
+	lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
+
+	if (target_proc->is_dead) {
+		/* binder_deferred_release already freed t->buffer */
+		return_error = BR_DEAD_REPLY;
+		goto err_dead_proc;
+	}
 	if (t->buffer == NULL) {
 		return_error = BR_FAILED_REPLY;
 		goto err_binder_alloc_buf_failed;
 	}
-	t->buffer->allow_user_free = 0;
-	t->buffer->debug_id = t->debug_id;
-	t->buffer->transaction = t;
-	t->buffer->target_node = target_node;
-	if (target_node)
-		binder_inc_node(target_node, 1, 0, NULL);
-
-	offp = (size_t *)(t->buffer->data + ALIGN(tr->data_size, sizeof(void *)));
-
-	if (copy_from_user(t->buffer->data, tr->data.ptr.buffer, tr->data_size)) {
+	if (copy_failed) {
 		binder_user_error("binder: %d:%d got transaction with invalid "
-			"data ptr\n", proc->pid, thread->pid);
+			"%s ptr\n", proc->pid, thread->pid, copy_failed);
 		return_error = BR_FAILED_REPLY;
 		goto err_copy_data_failed;
 	}
-	if (copy_from_user(offp, tr->data.ptr.offsets, tr->offsets_size)) {
-		binder_user_error("binder: %d:%d got transaction with invalid "
-			"offsets ptr\n", proc->pid, thread->pid);
-		return_error = BR_FAILED_REPLY;
-		goto err_copy_data_failed;
+
+	if (reply) {
+		target_thread = in_reply_to->from;
+		if (target_thread == NULL) {
+			return_error = BR_DEAD_REPLY;
+			goto err_dead_target_thread;
+		}
+		if (target_thread->transaction_stack != in_reply_to) {
+			binder_user_error("binder: %d:%d got reply transaction "
+				"with bad target transaction stack %d, "
+				"expected %d\n",
+				proc->pid, thread->pid,
+				target_thread->transaction_stack ?
+				target_thread->transaction_stack->debug_id : 0,
+				in_reply_to->debug_id);
+			return_error = BR_FAILED_REPLY;
+			in_reply_to = NULL;
+			target_thread = NULL;
+			goto err_dead_target_thread;
+		}
+	} else if (!(tr->flags & TF_ONE_WAY) && thread->transaction_stack) {
+		struct binder_transaction *tmp;
+		tmp = thread->transaction_stack;
+		while (tmp) {
+			if (tmp->from && tmp->from->proc == target_proc)
+				target_thread = tmp->from;
+			tmp = tmp->from_parent;
+		}
 	}
+	if (target_thread) {
+		e->to_thread = target_thread->pid;
+		target_list = &target_thread->todo;
+		target_wait = &target_thread->wait;
+	} else {
+		target_list = &target_proc->todo;
+		target_wait = &target_proc->wait;
+	}
+	t->to_thread = target_thread;
 	if (!IS_ALIGNED(tr->offsets_size, sizeof(size_t))) {
 		binder_user_error("binder: %d:%d got transaction with "
 			"invalid offsets size, %zd\n",
@@ -1720,6 +2124,15 @@ static void binder_transaction(struct binder_proc *proc,
 			fp->handle = target_fd;
 		} break;
 
+		case BINDER_TYPE_PAGES:
+			if (binder_transaction_pages(proc, thread, target_proc,
+					fp, !reply && (t->flags & TF_ONE_WAY),
+					t->debug_id)) {
+				return_error = BR_FAILED_REPLY;
+				goto err_map_pages_failed;
+			}
+			break;
+
 		default:
 			binder_user_error("binder: %d:%d got transactio"
 				"n with invalid object type, %lx\n",
@@ -1746,13 +2159,18 @@ static void binder_transaction(struct binder_proc *proc,
 			target_node->has_async_transaction = 1;
 	}
 	t->work.type = BINDER_WORK_TRANSACTION;
+	t->timestamp = ktime_get();
+	if (target_list == &target_proc->todo && !target_proc->ready_threads)
+		target_proc->latency.starved++;
 	list_add_tail(&t->work.entry, target_list);
 	tcomplete->type = BINDER_WORK_TRANSACTION_COMPLETE;
 	list_add_tail(&tcomplete->entry, &thread->todo);
 	if (target_wait)
 		wake_up_interruptible(target_wait);
+	target_proc->tmp_ref--;
 	return;
 
+err_map_pages_failed:
 err_get_unused_fd_failed:
 err_fget_failed:
 err_fd_not_allowed:
@@ -1761,11 +2179,19 @@ err_binder_get_ref_failed:
 err_binder_new_node_failed:
 err_bad_object_type:
 err_bad_offset:
+err_dead_target_thread:
 err_copy_data_failed:
 	binder_transaction_buffer_release(target_proc, t->buffer, offp);
 	t->buffer->transaction = NULL;
+	mutex_lock(&target_proc->alloc_lock);
 	binder_free_buf(target_proc, t->buffer);
+	mutex_unlock(&target_proc->alloc_lock);
+	target_node = NULL; /* dropped by binder_transaction_buffer_release */
 err_binder_alloc_buf_failed:
+	if (target_node)
+		binder_dec_node(target_node, 1, 0);
+err_dead_proc:
+	binder_proc_dec_tmpref(target_proc);
 	kfree(tcomplete);
 	binder_stats_deleted(BINDER_STAT_TRANSACTION_COMPLETE);
 err_alloc_tcomplete_failed:
@@ -1946,7 +2372,9 @@ int binder_thread_write(struct binder_proc *proc, struct binder_thread *thread,
 				return -EFAULT;
 			ptr += sizeof(void *);
 
+			mutex_lock(&proc->alloc_lock);
 			buffer = binder_buffer_lookup(proc, data_ptr);
+			mutex_unlock(&proc->alloc_lock);
 			if (buffer == NULL) {
 				binder_user_error("binder: %d:%d "
 					"BC_FREE_BUFFER u%p no match\n",
@@ -1977,7 +2405,9 @@ int binder_thread_write(struct binder_proc *proc, struct binder_thread *thread,
 					list_move_tail(buffer->target_node->async_todo.next, &thread->todo);
 			}
 			binder_transaction_buffer_release(proc, buffer, NULL);
+			mutex_lock(&proc->alloc_lock);
 			binder_free_buf(proc, buffer);
+			mutex_unlock(&proc->alloc_lock);
 			break;
 		}
 
@@ -2271,7 +2701,7 @@ retry:
 		} else
 			ret = wait_event_interruptible(thread->wait, binder_has_thread_work(thread));
 	}
-	mutex_lock(&binder_lock);
+	lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 	if (wait_for_proc_work)
 		proc->ready_threads--;
 	thread->looper &= ~BINDER_LOOPER_STATE_WAITING;
@@ -2422,13 +2852,7 @@ retry:
 			struct binder_node *target_node = t->buffer->target_node;
 			tr.target.ptr = target_node->ptr;
 			tr.cookie =  target_node->cookie;
-			t->saved_priority = task_nice(current);
-			if (t->priority < target_node->min_priority &&
-			    !(t->flags & TF_ONE_WAY))
-				binder_set_nice(t->priority);
-			else if (!(t->flags & TF_ONE_WAY) ||
-				 t->saved_priority > target_node->min_priority)
-				binder_set_nice(target_node->min_priority);
+			binder_inherit_priority(t, target_node);
 			cmd = BR_TRANSACTION;
 		} else {
 			tr.target.ptr = NULL;
@@ -2475,8 +2899,10 @@ retry:
 			     tr.data.ptr.buffer, tr.data.ptr.offsets);
 
 		list_del(&t->work.entry);
+		binder_latency_add(proc->latency.queue, t->timestamp);
 		t->buffer->allow_user_free = 1;
 		if (cmd == BR_TRANSACTION && !(t->flags & TF_ONE_WAY)) {
+			t->timestamp = ktime_get();
 			t->to_parent = thread->transaction_stack;
 			t->to_thread = thread;
 			thread->transaction_stack = t;
@@ -2615,7 +3041,7 @@ static unsigned int binder_poll(struct file *filp,
 	struct binder_thread *thread = NULL;
 	int wait_for_proc_work;
 
-	mutex_lock(&binder_lock);
+	lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 	thread = binder_get_thread(proc);
 
 	wait_for_proc_work = thread->transaction_stack == NULL &&
@@ -2652,7 +3078,7 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	if (ret)
 		return ret;
 
-	mutex_lock(&binder_lock);
+	lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 	thread = binder_get_thread(proc);
 	if (thread == NULL) {
 		ret = -ENOMEM;
@@ -2855,7 +3281,7 @@ static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 	vma->vm_ops = &binder_vm_ops;
 	vma->vm_private_data = proc;
 
-	if (binder_update_page_range(proc, 1, proc->buffer, proc->buffer + PAGE_SIZE, vma)) {
+	if (binder_update_page_range(proc, 1, proc->buffer, proc->buffer + PAGE_SIZE, vma, NULL)) {
 		ret = -ENOMEM;
 		failure_string = "alloc small buf";
 		goto err_alloc_small_buf_failed;
@@ -2930,8 +3356,9 @@ static int binder_open(struct inode *nodp, struct file *filp)
 	proc->tsk = current;
 	INIT_LIST_HEAD(&proc->todo);
 	init_waitqueue_head(&proc->wait);
+	mutex_init(&proc->alloc_lock);
 	proc->default_priority = task_nice(current);
-	mutex_lock(&binder_lock);
+	lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 	binder_stats_created(BINDER_STAT_PROC);
 	hlist_add_head(&proc->proc_node, &binder_procs);
 	proc->pid = current->group_leader->pid;
@@ -3075,6 +3502,8 @@ static void binder_deferred_release(struct binder_proc *proc)
 	binder_release_work(&proc->todo);
 	buffers = 0;
 
+	mutex_lock(&proc->alloc_lock);
+	proc->is_dead = 1;
 	while ((n = rb_first(&proc->allocated_buffers))) {
 		struct binder_buffer *buffer = rb_entry(n, struct binder_buffer,
 							rb_node);
@@ -3106,13 +3535,14 @@ static void binder_deferred_release(struct binder_proc *proc)
 					     page_addr);
 				unmap_kernel_range((unsigned long)page_addr,
 					PAGE_SIZE);
-				__free_page(proc->pages[i]);
+				put_page(proc->pages[i]);
 				page_count++;
 			}
 		}
 		kfree(proc->pages);
 		vfree(proc->buffer);
 	}
+	mutex_unlock(&proc->alloc_lock);
 
 	put_task_struct(proc->tsk);
 
@@ -3123,7 +3553,9 @@ static void binder_deferred_release(struct binder_proc *proc)
 		     proc->pid, threads, nodes, incoming_refs, outgoing_refs,
 		     active_transactions, buffers, page_count);
 
-	kfree(proc);
+	/* binder_transaction may still hold a reference on the target */
+	if (!proc->tmp_ref)
+		kfree(proc);
 }
 
 static void binder_deferred_func(struct work_struct *work)
@@ -3133,7 +3565,7 @@ static void binder_deferred_func(struct work_struct *work)
 
 	int defer;
 	do {
-		mutex_lock(&binder_lock);
+		lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 		mutex_lock(&binder_deferred_lock);
 		if (!hlist_empty(&binder_deferred_list)) {
 			proc = hlist_entry(binder_deferred_list.first,
@@ -3341,9 +3773,11 @@ static void print_binder_proc(struct seq_file *m,
 			print_binder_ref(m, rb_entry(n, struct binder_ref,
 						     rb_node_desc));
 	}
+	mutex_lock(&proc->alloc_lock);
 	for (n = rb_first(&proc->allocated_buffers); n != NULL; n = rb_next(n))
 		print_binder_buffer(m, "  buffer",
 				    rb_entry(n, struct binder_buffer, rb_node));
+	mutex_unlock(&proc->alloc_lock);
 	list_for_each_entry(w, &proc->todo, entry)
 		print_binder_work(m, "  ", "  pending transaction", w);
 	list_for_each_entry(w, &proc->delivered_death, entry) {
@@ -3559,12 +3993,14 @@ static char *procfs_print_binder_proc(char *buf, char *end,
 					       rb_entry(n, struct binder_ref,
 							rb_node_desc));
 	}
+	mutex_lock(&proc->alloc_lock);
 	for (n = rb_first(&proc->allocated_buffers);
 	     n != NULL && buf < end;
 	     n = rb_next(n))
 		buf = procfs_print_binder_buffer(buf, end, "  buffer",
 					  rb_entry(n, struct binder_buffer,
 						   rb_node));
+	mutex_unlock(&proc->alloc_lock);
 	list_for_each_entry(w, &proc->todo, entry) {
 		if (buf >= end)
 			break;
@@ -3702,9 +4138,12 @@ static void print_binder_proc_stats(struct seq_file *m,
 	seq_printf(m, "  refs: %d s %d w %d\n", count, strong, weak);
 
 	count = 0;
+	mutex_lock(&proc->alloc_lock);
 	for (n = rb_first(&proc->allocated_buffers); n != NULL; n = rb_next(n))
 		count++;
+	mutex_unlock(&proc->alloc_lock);
 	seq_printf(m, "  buffers: %d\n", count);
+	seq_printf(m, "  retained pages: %d\n", proc->retained_pages);
 
 	count = 0;
 	list_for_each_entry(w, &proc->todo, entry) {
@@ -3730,7 +4169,7 @@ static int binder_state_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 
 	seq_puts(m, "binder state:\n");
 
@@ -3753,7 +4192,7 @@ static int binder_stats_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 
 	seq_puts(m, "binder stats:\n");
 
@@ -3773,7 +4212,7 @@ static int binder_transactions_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 
 	seq_puts(m, "binder transactions:\n");
 	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
@@ -3789,7 +4228,7 @@ static int binder_proc_show(struct seq_file *m, void *unused)
 	int do_lock = !binder_debug_no_lock;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 	seq_puts(m, "binder proc state:\n");
 	print_binder_proc(m, proc, 1);
 	if (do_lock)
@@ -3797,6 +4236,41 @@ static int binder_proc_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static void print_binder_latency_hist(struct seq_file *m, const char *name,
+				      u32 *hist)
+{
+	int i;
+
+	seq_printf(m, "  %s:", name);
+	for (i = 0; i < BINDER_LATENCY_BUCKETS - 1; i++)
+		if (hist[i])
+			seq_printf(m, " <%lu:%u", 1UL << i, hist[i]);
+	if (hist[i])
+		seq_printf(m, " >=%lu:%u", 1UL << (i - 1), hist[i]);
+	seq_puts(m, "\n");
+}
+
+static int binder_latency_show(struct seq_file *m, void *unused)
+{
+	struct binder_proc *proc;
+	struct hlist_node *pos;
+	int do_lock = !binder_debug_no_lock;
+
+	if (do_lock)
+		lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
+
+	seq_puts(m, "binder latency (usec):\n");
+	hlist_for_each_entry(proc, pos, &binder_procs, proc_node) {
+		seq_printf(m, "proc %d\n", proc->pid);
+		seq_printf(m, "  starved: %u\n", proc->latency.starved);
+		print_binder_latency_hist(m, "queue", proc->latency.queue);
+		print_binder_latency_hist(m, "reply", proc->latency.reply);
+	}
+	if (do_lock)
+		mutex_unlock(&binder_lock);
+	return 0;
+}
+
 static void print_binder_transaction_log_entry(struct seq_file *m,
 					struct binder_transaction_log_entry *e)
 {
@@ -3911,11 +4385,17 @@ static char *procfs_print_binder_proc_stats(char *buf, char *end,
 		return buf;
 
 	count = 0;
+	mutex_lock(&proc->alloc_lock);
 	for (n = rb_first(&proc->allocated_buffers); n != NULL; n = rb_next(n))
 		count++;
+	mutex_unlock(&proc->alloc_lock);
 	buf += snprintf(buf, end - buf, "  buffers: %d\n", count);
 	if (buf >= end)
 		return buf;
+	buf += snprintf(buf, end - buf, "  retained pages: %d\n",
+			proc->retained_pages);
+	if (buf >= end)
+		return buf;
 
 	count = 0;
 	list_for_each_entry(w, &proc->todo, entry) {
@@ -3952,7 +4432,7 @@ static int procfs_binder_read_proc_state(char *page, char **start, off_t off,
 		return 0;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 
 	buf += snprintf(buf, end - buf, "binder state:\n");
 
@@ -3998,7 +4478,7 @@ static int procfs_binder_read_proc_stats(char *page, char **start, off_t off,
 		return 0;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 
 	p += snprintf(p, PAGE_SIZE, "binder stats:\n");
 
@@ -4039,7 +4519,7 @@ static int procfs_binder_read_proc_transactions(char *page, char **start, off_t
 		return 0;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 
 	buf += snprintf(buf, end - buf, "binder transactions:\n");
 	hlist_for_each_entry(proc, pos, &binder_procs, proc_node) {
@@ -4075,7 +4555,7 @@ static int procfs_binder_read_proc_proc(char *page, char **start, off_t off,
 		return 0;
 
 	if (do_lock)
-		mutex_lock(&binder_lock);
+		lock_prof_mutex_lock(&binder_lock, &binder_lock_prof);
 	p += snprintf(p, PAGE_SIZE, "binder proc state:\n");
 	p = procfs_print_binder_proc(p, page + PAGE_SIZE, proc, 1);
 	if (do_lock)
@@ -4165,6 +4645,7 @@ BINDER_DEBUG_ENTRY(state);
 BINDER_DEBUG_ENTRY(stats);
 BINDER_DEBUG_ENTRY(transactions);
 BINDER_DEBUG_ENTRY(transaction_log);
+BINDER_DEBUG_ENTRY(latency);
 
 static int __init binder_init(void)
 {
@@ -4174,6 +4655,8 @@ static int __init binder_init(void)
 	if (!binder_deferred_workqueue)
 		return -ENOMEM;
 
+	lock_prof_register(&binder_lock_prof);
+
 	binder_debugfs_dir_entry_root = debugfs_create_dir("binder", NULL);
 	if (binder_debugfs_dir_entry_root)
 		binder_debugfs_dir_entry_proc = debugfs_create_dir("proc",
@@ -4204,6 +4687,11 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    &binder_transaction_log,
 				    &binder_transaction_log_fops);
+		debugfs_create_file("latency",
+				    S_IRUGO,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_latency_fops);
 		debugfs_create_file("failed_transaction_log",
 				    S_IRUGO,
 				    binder_debugfs_dir_entry_root,
@@ -32,6 +32,7 @@ enum {
 	BINDER_TYPE_HANDLE	= B_PACK_CHARS('s', 'h', '*', B_TYPE_LARGE),
 	BINDER_TYPE_WEAK_HANDLE	= B_PACK_CHARS('w', 'h', '*', B_TYPE_LARGE),
 	BINDER_TYPE_FD		= B_PACK_CHARS('f', 'd', '*', B_TYPE_LARGE),
+	BINDER_TYPE_PAGES	= B_PACK_CHARS('p', 'g', '*', B_TYPE_LARGE),
 };
 
 enum {
@@ -45,6 +46,12 @@ enum {
  * contains offsets into the data where these structures occur.  The Binder
  * driver takes care of re-writing the structure type and data as it moves
  * between processes.
+ *
+ * A BINDER_TYPE_PAGES object describes a page aligned range of shared,
+ * file backed sender memory (e.g. an ashmem mapping). Instead of copying
+ * it, the driver maps the same pages read-only into the receiver's binder
+ * area and rewrites 'buffer' to point there. The mapping is released
+ * together with the transaction buffer that carried the object.
  */
 struct flat_binder_object {
 	/* 8 bytes for large_flat_header. */
@@ -55,10 +62,14 @@ struct flat_binder_object {
 	union {
 		void		*binder;	/* local object */
 		signed long	handle;		/* remote object */
+		void		*buffer;	/* BINDER_TYPE_PAGES range */
 	};
 
 	/* extra data associated with local object */
-	void			*cookie;
+	union {
+		void		*cookie;
+		size_t		length;		/* BINDER_TYPE_PAGES length */
+	};
 };
 
 /*
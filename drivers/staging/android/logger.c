@@ -20,11 +20,14 @@
 #include <linux/sched.h>
 #include <linux/module.h>
 #include <linux/fs.h>
+#include <linux/lock_prof.h>
 #include <linux/miscdevice.h>
 #include <linux/uaccess.h>
 #include <linux/poll.h>
 #include <linux/slab.h>
 #include <linux/time.h>
+#include <linux/vmalloc.h>
+#include <linux/lzo.h>
 #include "logger.h"
 
 #include <asm/ioctls.h>
@@ -35,6 +38,10 @@
  * This structure lives from module insertion until module removal, so it does
  * not need additional reference counting. The structure is protected by the
  * mutex 'mutex'.
+ *
+ * User memory is never touched with the mutex held: writers gather their
+ * payload before taking it and readers copy entries out through a private
+ * buffer, so the critical sections are plain memcpy()s that cannot fault.
  */
 struct logger_log {
 	unsigned char 		*buffer;/* the ring buffer itself */
@@ -45,8 +52,19 @@ struct logger_log {
 	size_t			w_off;	/* current write head offset */
 	size_t			head;	/* new readers start here */
 	size_t			size;	/* size of the log */
+#ifdef CONFIG_ANDROID_LOGGER_SPILL
+	unsigned char		*spill;	/* compressed history, also 'size' */
+	size_t			s_head;	/* oldest chunk in 'spill' */
+	size_t			s_off;	/* spill write offset */
+	size_t			s_len;	/* bytes used in 'spill' */
+	unsigned char		*stage;	/* evicted entries not yet compressed */
+	size_t			stage_len; /* bytes used in 'stage' */
+#endif
 };
 
+/* One profile covers the mutexes of all the logs */
+static DEFINE_LOCK_PROF(logger_lock_prof, "logger");
+
 /*
  * struct logger_reader - a logging device open for reading
  *
@@ -57,8 +75,16 @@ struct logger_reader {
 	struct logger_log	*log;	/* associated log */
 	struct list_head	list;	/* entry in logger_log's list */
 	size_t			r_off;	/* current read head offset */
+	struct mutex		buf_mutex; /* serializes users of 'buf' */
+	unsigned char		buf[LOGGER_ENTRY_MAX_LEN]; /* read bounce */
 };
 
+/*
+ * Payloads up to this size are gathered on the writer's stack, larger ones
+ * in a temporary allocation.
+ */
+#define LOGGER_WRITE_STACK_LEN	256
+
 /* logger_offset - returns index 'n' into the log via (optimized) modulus */
 #define logger_offset(n)	((n) & (log->size - 1))
 
@@ -108,15 +134,13 @@ static __u32 get_entry_len(struct logger_log *log, size_t off)
 }
 
 /*
- * do_read_log_to_user - reads exactly 'count' bytes from 'log' into the
- * user-space buffer 'buf'. Returns 'count' on success.
+ * do_read_log - reads exactly 'count' bytes from 'log' into the reader's
+ * bounce buffer and advances the read head.
  *
  * Caller must hold log->mutex.
  */
-static ssize_t do_read_log_to_user(struct logger_log *log,
-				   struct logger_reader *reader,
-				   char __user *buf,
-				   size_t count)
+static void do_read_log(struct logger_log *log, struct logger_reader *reader,
+			size_t count)
 {
 	size_t len;
 
@@ -126,20 +150,16 @@ static ssize_t do_read_log_to_user(struct logger_log *log,
 	 * the log, whichever comes first.
 	 */
 	len = min(count, log->size - reader->r_off);
-	if (copy_to_user(buf, log->buffer + reader->r_off, len))
-		return -EFAULT;
+	memcpy(reader->buf, log->buffer + reader->r_off, len);
 
 	/*
 	 * Second, we read any remaining bytes, starting back at the head of
 	 * the log.
 	 */
 	if (count != len)
-		if (copy_to_user(buf + len, log->buffer, count - len))
-			return -EFAULT;
+		memcpy(reader->buf + len, log->buffer, count - len);
 
 	reader->r_off = logger_offset(reader->r_off + count);
-
-	return count;
 }
 
 /*
@@ -166,9 +186,12 @@ start:
 	while (1) {
 		prepare_to_wait(&log->wq, &wait, TASK_INTERRUPTIBLE);
 
-		mutex_lock(&log->mutex);
-		ret = (log->w_off == reader->r_off);
-		mutex_unlock(&log->mutex);
+		/*
+		 * Unlocked peek; a stale answer either gets rechecked under
+		 * the mutex below or is followed by the writer's wakeup, as
+		 * we are already on the wait queue.
+		 */
+		ret = (ACCESS_ONCE(log->w_off) == ACCESS_ONCE(reader->r_off));
 		if (!ret)
 			break;
 
@@ -189,7 +212,7 @@ start:
 	if (ret)
 		return ret;
 
-	mutex_lock(&log->mutex);
+	lock_prof_mutex_lock(&log->mutex, &logger_lock_prof);
 
 	/* is there still something to read or did we race? */
 	if (unlikely(log->w_off == reader->r_off)) {
@@ -205,7 +228,15 @@ start:
 	}
 
 	/* get exactly one entry from the log */
-	ret = do_read_log_to_user(log, reader, buf, ret);
+	mutex_lock(&reader->buf_mutex);
+	do_read_log(log, reader, ret);
+	mutex_unlock(&log->mutex);
+
+	if (copy_to_user(buf, reader->buf, ret))
+		ret = -EFAULT;
+	mutex_unlock(&reader->buf_mutex);
+
+	return ret;
 
 out:
 	mutex_unlock(&log->mutex);
@@ -249,6 +280,169 @@ static inline int clock_interval(size_t a, size_t b, size_t c)
 	return 0;
 }
 
+#ifdef CONFIG_ANDROID_LOGGER_SPILL
+
+/*
+ * Evicted entries are batched into chunks of up to this many bytes before
+ * being compressed into the spill ring; it must hold the largest entry and
+ * its compressed form must fit in the smallest log.
+ */
+#define LOGGER_SPILL_CHUNK	(16*1024)
+
+/* compressor state, shared by all logs and protected by logger_spill_mutex */
+static DEFINE_MUTEX(logger_spill_mutex);
+static unsigned char logger_spill_wrkmem[LZO1X_1_MEM_COMPRESS];
+static unsigned char logger_spill_out[lzo1x_worst_compress(LOGGER_SPILL_CHUNK)];
+
+/*
+ * spill_read - copies 'count' bytes starting at 'off' out of the spill ring
+ */
+static void spill_read(struct logger_log *log, size_t off, void *buf,
+		       size_t count)
+{
+	size_t len = min(count, log->size - off);
+
+	memcpy(buf, log->spill + off, len);
+	if (count != len)
+		memcpy(buf + len, log->spill, count - len);
+}
+
+/*
+ * spill_write - appends 'count' bytes to the spill ring
+ */
+static void spill_write(struct logger_log *log, const void *buf, size_t count)
+{
+	size_t len = min(count, log->size - log->s_off);
+
+	memcpy(log->spill + log->s_off, buf, len);
+	if (count != len)
+		memcpy(log->spill, buf + len, count - len);
+
+	log->s_off = logger_offset(log->s_off + count);
+	log->s_len += count;
+}
+
+/*
+ * spill_flush - compresses the staged entries into a new chunk, dropping
+ * the oldest chunks to make room for it
+ *
+ * The caller needs to hold log->mutex.
+ */
+static void spill_flush(struct logger_log *log)
+{
+	struct logger_spill_chunk chunk;
+	size_t clen;
+
+	if (!log->stage_len)
+		return;
+
+	mutex_lock(&logger_spill_mutex);
+
+	if (unlikely(lzo1x_1_compress(log->stage, log->stage_len,
+				      logger_spill_out, &clen,
+				      logger_spill_wrkmem) != LZO_E_OK))
+		goto out;
+
+	while (log->size - log->s_len < sizeof(chunk) + clen) {
+		struct logger_spill_chunk old;
+		size_t len;
+
+		spill_read(log, log->s_head, &old, sizeof(old));
+		len = sizeof(old) + old.len;
+		log->s_head = logger_offset(log->s_head + len);
+		log->s_len -= len;
+	}
+
+	chunk.len = clen;
+	chunk.orig_len = log->stage_len;
+	spill_write(log, &chunk, sizeof(chunk));
+	spill_write(log, logger_spill_out, clen);
+
+out:
+	mutex_unlock(&logger_spill_mutex);
+	log->stage_len = 0;
+}
+
+/*
+ * logger_spill - stages the entries in [off, end) of the log, which are
+ * about to be overwritten, for the compressed history
+ *
+ * The caller needs to hold log->mutex.
+ */
+static void logger_spill(struct logger_log *log, size_t off, size_t end)
+{
+	while (off != end) {
+		size_t count = get_entry_len(log, off);
+		size_t len = min(count, log->size - off);
+
+		if (log->stage_len + count > LOGGER_SPILL_CHUNK)
+			spill_flush(log);
+
+		memcpy(log->stage + log->stage_len, log->buffer + off, len);
+		if (count != len)
+			memcpy(log->stage + log->stage_len + len, log->buffer,
+			       count - len);
+
+		log->stage_len += count;
+		off = logger_offset(off + count);
+	}
+}
+
+/*
+ * logger_spill_reset - drops the compressed history
+ *
+ * The caller needs to hold log->mutex.
+ */
+static void logger_spill_reset(struct logger_log *log)
+{
+	log->s_head = log->s_off = log->s_len = 0;
+	log->stage_len = 0;
+}
+
+/*
+ * logger_read_spill - implements LOGGER_READ_SPILL
+ *
+ * The history is snapshotted under log->mutex and copied out after dropping
+ * it, so a slow or faulting reader does not hold up writers.
+ */
+static long logger_read_spill(struct logger_log *log, void __user *arg)
+{
+	unsigned char *snap;
+	size_t len;
+	long ret;
+
+	snap = vmalloc(log->size);
+	if (!snap)
+		return -ENOMEM;
+
+	lock_prof_mutex_lock(&log->mutex, &logger_lock_prof);
+	spill_flush(log);
+	len = log->s_len;
+	spill_read(log, log->s_head, snap, len);
+	mutex_unlock(&log->mutex);
+
+	ret = len;
+	if (copy_to_user(arg, snap, len))
+		ret = -EFAULT;
+
+	vfree(snap);
+
+	return ret;
+}
+
+#else
+
+static inline void logger_spill(struct logger_log *log, size_t off,
+				size_t end)
+{
+}
+
+static inline void logger_spill_reset(struct logger_log *log)
+{
+}
+
+#endif /* CONFIG_ANDROID_LOGGER_SPILL */
+
 /*
  * fix_up_readers - walk the list of all readers and "fix up" any who were
  * lapped by the writer; also do the same for the default "start head".
@@ -263,8 +457,12 @@ static void fix_up_readers(struct logger_log *log, size_t len)
 	size_t new = logger_offset(old + len);
 	struct logger_reader *reader;
 
-	if (clock_interval(old, new, log->head))
-		log->head = get_next_entry(log, log->head, len);
+	if (clock_interval(old, new, log->head)) {
+		size_t next = get_next_entry(log, log->head, len);
+
+		logger_spill(log, log->head, next);
+		log->head = next;
+	}
 
 	list_for_each_entry(reader, &log->readers, list)
 		if (clock_interval(old, new, reader->r_off))
@@ -290,32 +488,6 @@ static void do_write_log(struct logger_log *log, const void *buf, size_t count)
 
 }
 
-/*
- * do_write_log_user - writes 'len' bytes from the user-space buffer 'buf' to
- * the log 'log'
- *
- * The caller needs to hold log->mutex.
- *
- * Returns 'count' on success, negative error code on failure.
- */
-static ssize_t do_write_log_from_user(struct logger_log *log,
-				      const void __user *buf, size_t count)
-{
-	size_t len;
-
-	len = min(count, log->size - log->w_off);
-	if (len && copy_from_user(log->buffer + log->w_off, buf, len))
-		return -EFAULT;
-
-	if (count != len)
-		if (copy_from_user(log->buffer, buf + len, count - len))
-			return -EFAULT;
-
-	log->w_off = logger_offset(log->w_off + count);
-
-	return count;
-}
-
 /*
  * logger_aio_write - our write method, implementing support for write(),
  * writev(), and aio_write(). Writes are our fast path, and we try to optimize
@@ -325,7 +497,8 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 			 unsigned long nr_segs, loff_t ppos)
 {
 	struct logger_log *log = file_get_log(iocb->ki_filp);
-	size_t orig = log->w_off;
+	unsigned char stack_buf[LOGGER_WRITE_STACK_LEN];
+	unsigned char *payload = stack_buf;
 	struct logger_entry header;
 	struct timespec now;
 	ssize_t ret = 0;
@@ -342,41 +515,56 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	if (unlikely(!header.len))
 		return 0;
 
-	mutex_lock(&log->mutex);
-
-	/*
-	 * Fix up any readers, pulling them forward to the first readable
-	 * entry after (what will be) the new write offset. We do this now
-	 * because if we partially fail, we can end up with clobbered log
-	 * entries that encroach on readable buffer.
-	 */
-	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
-
-	do_write_log(log, &header, sizeof(struct logger_entry));
+	if (header.len > sizeof(stack_buf)) {
+		payload = kmalloc(header.len, GFP_KERNEL);
+		if (unlikely(!payload))
+			return -ENOMEM;
+	}
 
-	while (nr_segs-- > 0) {
+	/* gather the whole entry from the vectors before taking the mutex */
+	while (nr_segs-- > 0 && ret < header.len) {
 		size_t len;
-		ssize_t nr;
 
 		/* figure out how much of this vector we can keep */
 		len = min_t(size_t, iov->iov_len, header.len - ret);
 
-		/* write out this segment's payload */
-		nr = do_write_log_from_user(log, iov->iov_base, len);
-		if (unlikely(nr < 0)) {
-			log->w_off = orig;
-			mutex_unlock(&log->mutex);
-			return nr;
+		if (unlikely(copy_from_user(payload + ret, iov->iov_base,
+					    len))) {
+			ret = -EFAULT;
+			goto out;
 		}
 
 		iov++;
-		ret += nr;
+		ret += len;
 	}
 
+	lock_prof_mutex_lock(&log->mutex, &logger_lock_prof);
+
+	/*
+	 * Fix up any readers, pulling them forward to the first readable
+	 * entry after (what will be) the new write offset. We do this now
+	 * because if we partially fail, we can end up with clobbered log
+	 * entries that encroach on readable buffer.
+	 */
+	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
+
+	do_write_log(log, &header, sizeof(struct logger_entry));
+	do_write_log(log, payload, header.len);
+
 	mutex_unlock(&log->mutex);
 
-	/* wake up any blocked readers */
-	wake_up_interruptible(&log->wq);
+	/*
+	 * Wake up any blocked readers. Readers get on the wait queue before
+	 * peeking at w_off; the barrier pairs with the one in
+	 * prepare_to_wait() so an empty queue means nobody can miss this entry.
+	 */
+	smp_mb();
+	if (waitqueue_active(&log->wq))
+		wake_up_interruptible(&log->wq);
+
+out:
+	if (payload != stack_buf)
+		kfree(payload);
 
 	return ret;
 }
@@ -409,9 +597,10 @@ static int logger_open(struct inode *inode, struct file *file)
 			return -ENOMEM;
 
 		reader->log = log;
+		mutex_init(&reader->buf_mutex);
 		INIT_LIST_HEAD(&reader->list);
 
-		mutex_lock(&log->mutex);
+		lock_prof_mutex_lock(&log->mutex, &logger_lock_prof);
 		reader->r_off = log->head;
 		list_add_tail(&reader->list, &log->readers);
 		mutex_unlock(&log->mutex);
@@ -433,7 +622,7 @@ static int logger_release(struct inode *ignored, struct file *file)
 	if (file->f_mode & FMODE_READ) {
 		struct logger_reader *reader = file->private_data;
 		struct logger_log *log = reader->log;
-		mutex_lock(&log->mutex);
+		lock_prof_mutex_lock(&log->mutex, &logger_lock_prof);
 		list_del(&reader->list);
 		mutex_unlock(&log->mutex);
 		kfree(reader);
@@ -465,7 +654,7 @@ static unsigned int logger_poll(struct file *file, poll_table *wait)
 
 	poll_wait(file, &log->wq, wait);
 
-	mutex_lock(&log->mutex);
+	lock_prof_mutex_lock(&log->mutex, &logger_lock_prof);
 	if (log->w_off != reader->r_off)
 		ret |= POLLIN | POLLRDNORM;
 	mutex_unlock(&log->mutex);
@@ -479,7 +668,15 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	struct logger_reader *reader;
 	long ret = -ENOTTY;
 
-	mutex_lock(&log->mutex);
+#ifdef CONFIG_ANDROID_LOGGER_SPILL
+	if (cmd == LOGGER_READ_SPILL) {
+		if (!(file->f_mode & FMODE_READ))
+			return -EBADF;
+		return logger_read_spill(log, (void __user *) arg);
+	}
+#endif
+
+	lock_prof_mutex_lock(&log->mutex, &logger_lock_prof);
 
 	switch (cmd) {
 	case LOGGER_GET_LOG_BUF_SIZE:
@@ -515,6 +712,7 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		list_for_each_entry(reader, &log->readers, list)
 			reader->r_off = log->w_off;
 		log->head = log->w_off;
+		logger_spill_reset(log);
 		ret = 0;
 		break;
 	}
@@ -535,6 +733,18 @@ static const struct file_operations logger_fops = {
 	.release = logger_release,
 };
 
+#ifdef CONFIG_ANDROID_LOGGER_SPILL
+#define LOGGER_SPILL_BUFFERS(VAR, SIZE) \
+static unsigned char _spill_ ## VAR[SIZE]; \
+static unsigned char _stage_ ## VAR[LOGGER_SPILL_CHUNK];
+#define LOGGER_SPILL_INIT(VAR) \
+	.spill = _spill_ ## VAR, \
+	.stage = _stage_ ## VAR,
+#else
+#define LOGGER_SPILL_BUFFERS(VAR, SIZE)
+#define LOGGER_SPILL_INIT(VAR)
+#endif
+
 /*
  * Defines a log structure with name 'NAME' and a size of 'SIZE' bytes, which
  * must be a power of two, greater than LOGGER_ENTRY_MAX_LEN, and less than
@@ -542,8 +752,10 @@ static const struct file_operations logger_fops = {
  */
 #define DEFINE_LOGGER_DEVICE(VAR, NAME, SIZE) \
 static unsigned char _buf_ ## VAR[SIZE]; \
+LOGGER_SPILL_BUFFERS(VAR, SIZE) \
 static struct logger_log VAR = { \
 	.buffer = _buf_ ## VAR, \
+	LOGGER_SPILL_INIT(VAR) \
 	.misc = { \
 		.minor = MISC_DYNAMIC_MINOR, \
 		.name = NAME, \
@@ -601,6 +813,8 @@ static int __init logger_init(void)
 {
 	int ret;
 
+	lock_prof_register(&logger_lock_prof);
+
 	ret = init_log(&log_main);
 	if (unlikely(ret))
 		goto out;
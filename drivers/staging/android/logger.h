@@ -45,6 +45,20 @@ struct logger_entry {
 #define LOGGER_GET_LOG_LEN		_IO(__LOGGERIO, 2) /* used log len */
 #define LOGGER_GET_NEXT_ENTRY_LEN	_IO(__LOGGERIO, 3) /* next entry len */
 #define LOGGER_FLUSH_LOG		_IO(__LOGGERIO, 4) /* flush log */
+#define LOGGER_READ_SPILL		_IO(__LOGGERIO, 5) /* compressed history */
+
+/*
+ * LOGGER_READ_SPILL copies the log's compressed history, oldest first, into
+ * the user buffer passed as the argument, which must hold at least
+ * LOGGER_GET_LOG_BUF_SIZE bytes, and returns the number of bytes copied. The
+ * history is a sequence of chunks, each of which decompresses (LZO1X) to
+ * 'orig_len' bytes of whole logger_entry records.
+ */
+struct logger_spill_chunk {
+	__u16		len;		/* length of the compressed data */
+	__u16		orig_len;	/* length once decompressed */
+	unsigned char	data[0];	/* the LZO1X compressed entries */
+};
 
 #endif /* _LINUX_LOGGER_H */
 
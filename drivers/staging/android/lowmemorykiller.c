@@ -16,6 +16,17 @@
  * percentage of the cached memory is locked this can be very inaccurate
  * and processes may not get killed until the normal oom killer is triggered.
  *
+ * /dev/lowmem_pressure reports how close the system is to these thresholds
+ * so user-space can trim caches before anything is killed. Each read returns
+ * the current level as an int, from 0 (no pressure) up to the number of
+ * minfree slots, blocking until the level differs from the one last read on
+ * that file; poll() signals the change. A slot counts as reached once both
+ * free and file memory are within notify_margin percent above its minfree.
+ *
+ * With the memory controller, a task whose memory cgroup is over its soft
+ * limit is killed ahead of larger ones with the same oom_adj, so apps kept
+ * within their own memcg limits are the last to go.
+ *
  * Copyright (C) 2007-2008 Google, Inc.
  *
  * This software is licensed under the terms of the GNU General Public
@@ -32,9 +43,15 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
+#include <linux/memcontrol.h>
 #include <linux/oom.h>
 #include <linux/sched.h>
 #include <linux/notifier.h>
+#include <linux/spinlock.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/poll.h>
+#include <linux/uaccess.h>
 
 #define DEBUG_LEVEL_DEATHPENDING 6
 
@@ -64,6 +81,10 @@ static size_t lowmem_minfile[6] = {
 };
 static int lowmem_minfile_size = 6;
 
+static int lowmem_notify_margin = 25;
+static int lowmem_pressure;
+static DECLARE_WAIT_QUEUE_HEAD(lowmem_pressure_wait);
+
 static struct task_struct *lowmem_deathpending;
 static unsigned long lowmem_deathpending_timeout;
 static uint32_t lowmem_check_filepages = 0;
@@ -76,6 +97,51 @@ static uint32_t lowmem_check_filepages = 0;
 		}					\
 	} while (0)
 
+/*
+ * Thread group leaders hashed by oom_adj, so the shrinker only looks at the
+ * tasks it may kill. The buckets are kept current from fork, exit, exec and
+ * oom_adj writes; lowmem_adj_lock nests inside tasklist_lock and siglock.
+ */
+static DEFINE_SPINLOCK(lowmem_adj_lock);
+static struct hlist_head lowmem_adj_buckets[OOM_ADJUST_MAX - OOM_DISABLE + 1];
+
+static void __lowmem_adj_update(struct task_struct *p)
+{
+	hlist_del_init(&p->lowmem_node);
+	if (p->flags & PF_EXITING)
+		return;
+	hlist_add_head(&p->lowmem_node,
+		       &lowmem_adj_buckets[p->signal->oom_adj - OOM_DISABLE]);
+}
+
+/* called with tasklist_lock held for writing, before 'p' is visible */
+void lowmem_adj_fork(struct task_struct *p)
+{
+	INIT_HLIST_NODE(&p->lowmem_node);
+	if (!thread_group_leader(p))
+		return;
+
+	spin_lock(&lowmem_adj_lock);
+	__lowmem_adj_update(p);
+	spin_unlock(&lowmem_adj_lock);
+}
+
+/* 'p' is a group leader whose oom_adj may have changed */
+void lowmem_adj_update(struct task_struct *p)
+{
+	spin_lock(&lowmem_adj_lock);
+	__lowmem_adj_update(p);
+	spin_unlock(&lowmem_adj_lock);
+}
+
+/* called from do_exit() once PF_EXITING is set and the mm is gone */
+void lowmem_adj_exit(struct task_struct *p)
+{
+	spin_lock(&lowmem_adj_lock);
+	hlist_del_init(&p->lowmem_node);
+	spin_unlock(&lowmem_adj_lock);
+}
+
 static int
 task_notify_func(struct notifier_block *self, unsigned long val, void *data);
 
@@ -133,16 +199,117 @@ static void dump_deathpending(struct task_struct *t_deathpending)
 	read_unlock(&tasklist_lock);
 }
 
+static int lowmem_pressure_level(int other_free, int other_file)
+{
+	int i;
+	int array_size = ARRAY_SIZE(lowmem_adj);
+
+	if (lowmem_adj_size < array_size)
+		array_size = lowmem_adj_size;
+	if (lowmem_minfree_size < array_size)
+		array_size = lowmem_minfree_size;
+	for (i = 0; i < array_size; i++) {
+		size_t minfree = lowmem_minfree[i] +
+				 lowmem_minfree[i] * lowmem_notify_margin / 100;
+
+		if (other_free < minfree && other_file < minfree)
+			return array_size - i;
+	}
+	return 0;
+}
+
+static void lowmem_update_pressure(int other_free, int other_file)
+{
+	int level = lowmem_pressure_level(other_free, other_file);
+
+	if (level != lowmem_pressure) {
+		lowmem_print(3, "pressure %d -> %d\n", lowmem_pressure, level);
+		lowmem_pressure = level;
+		wake_up_interruptible(&lowmem_pressure_wait);
+	}
+}
+
+/*
+ * The shrinker only runs while the VM is reclaiming, so readers refresh
+ * the level themselves to notice pressure going away.
+ */
+static int lowmem_current_pressure(void)
+{
+	lowmem_update_pressure(global_page_state(NR_FREE_PAGES),
+			       global_page_state(NR_FILE_PAGES) -
+			       global_page_state(NR_SHMEM));
+	return lowmem_pressure;
+}
+
+static int lowmem_pressure_open(struct inode *inode, struct file *file)
+{
+	/* the first read reports the current level right away */
+	file->private_data = (void *)-1L;
+	return nonseekable_open(inode, file);
+}
+
+static ssize_t lowmem_pressure_read(struct file *file, char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	int last = (long)file->private_data;
+	int level;
+	int ret;
+
+	if (count < sizeof(level))
+		return -EINVAL;
+
+	if (file->f_flags & O_NONBLOCK) {
+		level = lowmem_current_pressure();
+		if (level == last)
+			return -EAGAIN;
+	} else {
+		ret = wait_event_interruptible(lowmem_pressure_wait,
+				(level = lowmem_current_pressure()) != last);
+		if (ret)
+			return ret;
+	}
+
+	if (copy_to_user(buf, &level, sizeof(level)))
+		return -EFAULT;
+	file->private_data = (void *)(long)level;
+	return sizeof(level);
+}
+
+static unsigned int lowmem_pressure_poll(struct file *file, poll_table *wait)
+{
+	poll_wait(file, &lowmem_pressure_wait, wait);
+	if (lowmem_current_pressure() != (long)file->private_data)
+		return POLLIN | POLLRDNORM;
+	return 0;
+}
+
+static const struct file_operations lowmem_pressure_fops = {
+	.owner = THIS_MODULE,
+	.open = lowmem_pressure_open,
+	.read = lowmem_pressure_read,
+	.poll = lowmem_pressure_poll,
+};
+
+static struct miscdevice lowmem_pressure_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "lowmem_pressure",
+	.fops = &lowmem_pressure_fops,
+};
+
 static int lowmem_shrink(struct shrinker *s, int nr_to_scan, gfp_t gfp_mask)
 {
 	struct task_struct *p;
+	struct hlist_node *node;
 	struct task_struct *selected = NULL;
 	int rem = 0;
 	int tasksize;
 	int i;
 	int min_adj = OOM_ADJUST_MAX + 1;
 	int selected_tasksize = 0;
+	unsigned long selected_excess = 0;
+	unsigned long excess;
 	int selected_oom_adj;
+	int oom_adj;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 	int other_free = global_page_state(NR_FREE_PAGES);
 	int other_file = global_page_state(NR_FILE_PAGES) -
@@ -150,6 +317,8 @@ static int lowmem_shrink(struct shrinker *s, int nr_to_scan, gfp_t gfp_mask)
 	int lru_file = global_page_state(NR_ACTIVE_FILE) +
 			global_page_state(NR_INACTIVE_FILE);
 
+	lowmem_update_pressure(other_free, other_file);
+
 	/*
 	 * If we already have a death outstanding, then
 	 * bail out right away; indicating to vmscan
@@ -192,41 +361,49 @@ static int lowmem_shrink(struct shrinker *s, int nr_to_scan, gfp_t gfp_mask)
 		return rem;
 	}
 	selected_oom_adj = min_adj;
+	if (min_adj < OOM_DISABLE)
+		min_adj = OOM_DISABLE;
 
-	read_lock(&tasklist_lock);
-	for_each_process(p) {
-		struct mm_struct *mm;
-		struct signal_struct *sig;
-		int oom_adj;
+	/*
+	 * The highest non-empty bucket holds the candidates; within it the
+	 * largest task over its memcg soft limit is killed, or failing that
+	 * the largest task.
+	 */
+	spin_lock(&lowmem_adj_lock);
+	for (oom_adj = OOM_ADJUST_MAX; oom_adj >= min_adj && !selected;
+	     oom_adj--) {
+		hlist_for_each_entry(p, node,
+				&lowmem_adj_buckets[oom_adj - OOM_DISABLE],
+				lowmem_node) {
+			struct mm_struct *mm;
 
-		task_lock(p);
-		mm = p->mm;
-		sig = p->signal;
-		if (!mm || !sig) {
-			task_unlock(p);
-			continue;
-		}
-		oom_adj = sig->oom_adj;
-		if (oom_adj < min_adj) {
-			task_unlock(p);
-			continue;
-		}
-		tasksize = get_mm_rss(mm);
-		task_unlock(p);
-		if (tasksize <= 0)
-			continue;
-		if (selected) {
-			if (oom_adj < selected_oom_adj)
+			task_lock(p);
+			mm = p->mm;
+			if (!mm) {
+				task_unlock(p);
 				continue;
-			if (oom_adj == selected_oom_adj &&
-			    tasksize <= selected_tasksize)
+			}
+			tasksize = get_mm_rss(mm);
+			excess = mm_mem_cgroup_soft_limit_excess(mm);
+			task_unlock(p);
+			if (tasksize <= 0)
 				continue;
+			if (selected) {
+				if (!excess && selected_excess)
+					continue;
+				if (!excess == !selected_excess &&
+				    tasksize <= selected_tasksize)
+					continue;
+			}
+			selected = p;
+			selected_tasksize = tasksize;
+			selected_excess = excess;
+			selected_oom_adj = oom_adj;
+			lowmem_print(2, "select %d (%s), adj %d, size %d, "
+				     "over soft limit %lu, to kill\n",
+				     p->pid, p->comm, oom_adj, tasksize,
+				     excess);
 		}
-		selected = p;
-		selected_tasksize = tasksize;
-		selected_oom_adj = oom_adj;
-		lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
-			     p->pid, p->comm, oom_adj, tasksize);
 	}
 	if (selected) {
 		lowmem_print(1, "send sigkill to %d (%s), adj %d, size %d\n",
@@ -234,12 +411,18 @@ static int lowmem_shrink(struct shrinker *s, int nr_to_scan, gfp_t gfp_mask)
 			     selected_oom_adj, selected_tasksize);
 		lowmem_deathpending = selected;
 		lowmem_deathpending_timeout = jiffies + HZ;
-		force_sig(SIGKILL, selected);
+		get_task_struct(selected);
 		rem -= selected_tasksize;
 	}
+	spin_unlock(&lowmem_adj_lock);
+
+	/* siglock nests outside lowmem_adj_lock */
+	if (selected) {
+		force_sig(SIGKILL, selected);
+		put_task_struct(selected);
+	}
 	lowmem_print(4, "lowmem_shrink %d, %x, return %d\n",
 		     nr_to_scan, gfp_mask, rem);
-	read_unlock(&tasklist_lock);
 	return rem;
 }
 
@@ -250,6 +433,11 @@ static struct shrinker lowmem_shrinker = {
 
 static int __init lowmem_init(void)
 {
+	int ret;
+
+	ret = misc_register(&lowmem_pressure_dev);
+	if (ret)
+		return ret;
 	task_free_register(&task_nb);
 	register_shrinker(&lowmem_shrinker);
 	return 0;
@@ -258,6 +446,7 @@ static int __init lowmem_init(void)
 static void __exit lowmem_exit(void)
 {
 	unregister_shrinker(&lowmem_shrinker);
+	misc_deregister(&lowmem_pressure_dev);
 	task_free_unregister(&task_nb);
 }
 
@@ -266,6 +455,8 @@ module_param_array_named(adj, lowmem_adj, int, &lowmem_adj_size,
 			 S_IRUGO | S_IWUSR);
 module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 			 S_IRUGO | S_IWUSR);
+module_param_named(notify_margin, lowmem_notify_margin, int,
+		   S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
 
 module_param_named(check_filepages , lowmem_check_filepages, uint,
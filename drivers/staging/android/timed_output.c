@@ -19,12 +19,95 @@
 #include <linux/device.h>
 #include <linux/fs.h>
 #include <linux/err.h>
+#include <linux/hrtimer.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 #include "timed_output.h"
 
 static struct class *timed_output_class;
 static atomic_t device_count;
 
+#define TIMED_OUTPUT_PATTERN_STEPS	32
+#define TIMED_OUTPUT_STEP_MAX_MS	15000
+
+/*
+ * A pattern is played from an hrtimer against absolute edge times, so
+ * the time the driver takes to switch the output does not add up over
+ * the pattern. Each edge costs one call to ->output().
+ */
+struct timed_output_pattern {
+	struct timed_output_dev *tdev;
+	struct hrtimer timer;
+	struct work_struct work;
+	spinlock_t lock;
+	struct {
+		unsigned int ms;
+		int level;
+	} step[TIMED_OUTPUT_PATTERN_STEPS];
+	int count;
+	int cur;
+	int repeat;
+	int level;
+	int applied;
+	ktime_t edge;
+};
+
+static void timed_output_pattern_work(struct work_struct *work)
+{
+	struct timed_output_pattern *p =
+		container_of(work, struct timed_output_pattern, work);
+	unsigned long flags;
+	int level;
+
+	spin_lock_irqsave(&p->lock, flags);
+	level = p->level;
+	spin_unlock_irqrestore(&p->lock, flags);
+
+	if (level != p->applied) {
+		p->tdev->output(p->tdev, level);
+		p->applied = level;
+	}
+}
+
+static enum hrtimer_restart timed_output_pattern_timer(struct hrtimer *timer)
+{
+	struct timed_output_pattern *p =
+		container_of(timer, struct timed_output_pattern, timer);
+	enum hrtimer_restart ret = HRTIMER_RESTART;
+	unsigned long flags;
+
+	spin_lock_irqsave(&p->lock, flags);
+	if (++p->cur == p->count && p->repeat)
+		p->cur = 0;
+	if (p->cur < p->count) {
+		p->level = p->step[p->cur].level;
+		p->edge = ktime_add_ns(p->edge,
+			(u64)p->step[p->cur].ms * NSEC_PER_MSEC);
+		hrtimer_set_expires(timer, p->edge);
+	} else {
+		p->level = 0;
+		ret = HRTIMER_NORESTART;
+	}
+	spin_unlock_irqrestore(&p->lock, flags);
+
+	schedule_work(&p->work);
+	return ret;
+}
+
+static void timed_output_pattern_stop(struct timed_output_pattern *p)
+{
+	unsigned long flags;
+
+	hrtimer_cancel(&p->timer);
+	spin_lock_irqsave(&p->lock, flags);
+	p->count = 0;
+	p->level = 0;
+	spin_unlock_irqrestore(&p->lock, flags);
+	schedule_work(&p->work);
+}
+
 static ssize_t enable_show(struct device *dev, struct device_attribute *attr,
 		char *buf)
 {
@@ -44,6 +127,8 @@ static ssize_t enable_store(
 	if (sscanf(buf, "%d", &value) != 1)
 		return -EINVAL;
 
+	if (tdev->pattern)
+		timed_output_pattern_stop(tdev->pattern);
 	tdev->enable(tdev, value);
 
 	return size;
@@ -73,7 +158,96 @@ static ssize_t voltage_level_store(
 	return size;
 }
 
+static ssize_t pattern_show(struct device *dev, struct device_attribute *attr,
+		char *buf)
+{
+	struct timed_output_dev *tdev = dev_get_drvdata(dev);
+	struct timed_output_pattern *p = tdev->pattern;
+	unsigned long flags;
+	char *s = buf;
+	int i;
+
+	spin_lock_irqsave(&p->lock, flags);
+	for (i = 0; i < p->count; i++)
+		s += sprintf(s, "%u@%d ", p->step[i].ms, p->step[i].level);
+	if (p->count && p->repeat)
+		s += sprintf(s, "r");
+	spin_unlock_irqrestore(&p->lock, flags);
+	s += sprintf(s, "\n");
+
+	return s - buf;
+}
+
+/*
+ * "ms[@level] ms[@level] ... [r]": durations alternating on and off,
+ * starting with on. On steps without a level use the current voltage
+ * level, "r" repeats the pattern until enable or pattern is written.
+ */
+static ssize_t pattern_store(
+		struct device *dev, struct device_attribute *attr,
+		const char *buf, size_t size)
+{
+	struct timed_output_dev *tdev = dev_get_drvdata(dev);
+	struct timed_output_pattern *p = tdev->pattern;
+	unsigned int ms[TIMED_OUTPUT_PATTERN_STEPS];
+	int level[TIMED_OUTPUT_PATTERN_STEPS];
+	int on_level = tdev->get_level ? tdev->get_level(tdev) : 1;
+	int count = 0, repeat = 0, n, i;
+	unsigned long flags;
+
+	while (*buf) {
+		buf = skip_spaces(buf);
+		if (!*buf)
+			break;
+		if (*buf == 'r') {
+			repeat = 1;
+			buf++;
+			continue;
+		}
+		if (count == TIMED_OUTPUT_PATTERN_STEPS || repeat)
+			return -EINVAL;
+		if (sscanf(buf, "%u%n", &ms[count], &n) != 1)
+			return -EINVAL;
+		buf += n;
+		level[count] = (count & 1) ? 0 : on_level;
+		if (*buf == '@') {
+			if (sscanf(buf + 1, "%d%n", &level[count], &n) != 1 ||
+			    level[count] < 0)
+				return -EINVAL;
+			buf += n + 1;
+		}
+		if (ms[count] > TIMED_OUTPUT_STEP_MAX_MS)
+			ms[count] = TIMED_OUTPUT_STEP_MAX_MS;
+		count++;
+	}
+
+	tdev->enable(tdev, 0);
+	hrtimer_cancel(&p->timer);
+
+	spin_lock_irqsave(&p->lock, flags);
+	for (i = 0; i < count; i++) {
+		p->step[i].ms = ms[i];
+		p->step[i].level = level[i];
+	}
+	p->count = count;
+	p->repeat = repeat;
+	p->cur = 0;
+	if (count) {
+		p->level = p->step[0].level;
+		p->edge = ktime_add_ns(ktime_get(),
+			(u64)p->step[0].ms * NSEC_PER_MSEC);
+		hrtimer_start(&p->timer, p->edge, HRTIMER_MODE_ABS);
+	} else {
+		p->level = 0;
+	}
+	spin_unlock_irqrestore(&p->lock, flags);
+	schedule_work(&p->work);
+
+	return size;
+}
+
 static DEVICE_ATTR(enable, S_IRUGO | S_IWUSR, enable_show, enable_store);
+static DEVICE_ATTR(pattern, S_IRUGO | S_IWUSR, pattern_show, pattern_store);
 static DEVICE_ATTR(voltage_level, S_IRUGO | S_IWUSR, voltage_level_show, voltage_level_store);
 
 static int create_timed_output_class(void)
@@ -115,10 +289,33 @@ int timed_output_dev_register(struct timed_output_dev *tdev)
 			goto err_create_file;
 	}
 
+	if (tdev->output) {
+		struct timed_output_pattern *p;
+
+		p = kzalloc(sizeof(*p), GFP_KERNEL);
+		if (!p) {
+			ret = -ENOMEM;
+			goto err_create_file;
+		}
+		p->tdev = tdev;
+		spin_lock_init(&p->lock);
+		INIT_WORK(&p->work, timed_output_pattern_work);
+		hrtimer_init(&p->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+		p->timer.function = timed_output_pattern_timer;
+		tdev->pattern = p;
+
+		ret = device_create_file(tdev->dev, &dev_attr_pattern);
+		if (ret < 0)
+			goto err_create_pattern;
+	}
+
 	dev_set_drvdata(tdev->dev, tdev);
 	tdev->state = 0;
 	return 0;
 
+err_create_pattern:
+	kfree(tdev->pattern);
+	tdev->pattern = NULL;
 err_create_file:
 	device_destroy(timed_output_class, MKDEV(0, tdev->index));
 	printk(KERN_ERR "timed_output: Failed to register driver %s\n",
@@ -132,6 +329,13 @@ void timed_output_dev_unregister(struct timed_output_dev *tdev)
 {
 	device_remove_file(tdev->dev, &dev_attr_enable);
 	device_remove_file(tdev->dev, &dev_attr_voltage_level);
+	if (tdev->pattern) {
+		device_remove_file(tdev->dev, &dev_attr_pattern);
+		hrtimer_cancel(&tdev->pattern->timer);
+		cancel_work_sync(&tdev->pattern->work);
+		kfree(tdev->pattern);
+		tdev->pattern = NULL;
+	}
 	device_destroy(timed_output_class, MKDEV(0, tdev->index));
 	dev_set_drvdata(tdev->dev, NULL);
 }
@@ -16,6 +16,8 @@
 #ifndef _LINUX_TIMED_OUTPUT_H
 #define _LINUX_TIMED_OUTPUT_H
 
+struct timed_output_pattern;
+
 struct timed_output_dev {
 	const char	*name;
 
@@ -31,10 +33,17 @@ struct timed_output_dev {
 	/* returns the current voltage */
 	int	(*get_level)(struct timed_output_dev *sdev);
 
+	/*
+	 * drive the output at level (0 is off) with no timer of its own;
+	 * may sleep. Enables the pattern attribute.
+	 */
+	void	(*output)(struct timed_output_dev *sdev, int level);
+
 	/* private data */
 	struct device	*dev;
 	int		index;
 	int		state;
+	struct timed_output_pattern *pattern;
 };
 
 extern int timed_output_dev_register(struct timed_output_dev *dev);
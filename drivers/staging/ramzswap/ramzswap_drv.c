@@ -23,6 +23,8 @@
 #include <linux/device.h>
 #include <linux/genhd.h>
 #include <linux/highmem.h>
+#include <linux/jhash.h>
+#include <linux/log2.h>
 #include <linux/slab.h>
 #include <linux/lzo.h>
 #include <linux/string.h>
@@ -35,9 +37,16 @@
 /* Globals */
 static int ramzswap_major;
 static struct ramzswap *devices;
+static struct workqueue_struct *ramzswap_wq;
 
 /* Module params (documentation at end) */
 static unsigned int num_devices;
+static unsigned int num_streams;
+static int dedup = 1;
+static unsigned int wb_interval = 30;
+static unsigned int wb_cold = 600;
+static unsigned int wb_max_pages = 1024;
+static unsigned int compact_interval = 60;
 
 static int rzs_test_flag(struct ramzswap *rzs, u32 index,
 			enum rzs_pageflags flag)
@@ -57,21 +66,108 @@ static void rzs_clear_flag(struct ramzswap *rzs, u32 index,
 	rzs->table[index].flags &= ~BIT(flag);
 }
 
-static int page_zero_filled(void *ptr)
+static int page_same_filled(void *ptr, unsigned long *element)
 {
 	unsigned int pos;
 	unsigned long *page;
 
 	page = (unsigned long *)ptr;
 
-	for (pos = 0; pos != PAGE_SIZE / sizeof(*page); pos++) {
-		if (page[pos])
+	for (pos = 1; pos != PAGE_SIZE / sizeof(*page); pos++) {
+		if (page[pos] != page[0])
 			return 0;
 	}
 
+	*element = page[0];
 	return 1;
 }
 
+/*
+ * Dedup index: every compressed object is entered under the hash of the
+ * page it came from. A new page with the same hash and the same
+ * compressed bytes takes a reference on the object instead of storing
+ * another copy. LZO is deterministic, so identical pages always compress
+ * to identical objects.
+ */
+static struct rzs_dedup_entry *ramzswap_dedup_get(struct ramzswap *rzs,
+			u32 hash, const void *src, size_t clen)
+{
+	struct rzs_dedup_entry *entry;
+	struct hlist_node *n;
+	struct zobj_header *zheader;
+	int same;
+
+	hlist_for_each_entry(entry, n, &rzs->dedup_table[hash & rzs->dedup_mask],
+			node) {
+		if (entry->hash != hash)
+			continue;
+
+		zheader = zs_map_object(rzs->mem_pool, entry->page,
+					entry->offset, KM_USER1);
+		same = zheader->size == clen + sizeof(*zheader) &&
+			!memcmp(zheader + 1, src, clen);
+		zs_unmap_object(rzs->mem_pool, entry->page, entry->offset,
+				zheader, KM_USER1);
+
+		if (same) {
+			entry->refcount++;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static int ramzswap_dedup_add(struct ramzswap *rzs, u32 hash,
+			struct page *page, u16 offset)
+{
+	struct rzs_dedup_entry *entry;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO);
+	if (!entry)
+		return -ENOMEM;
+
+	entry->page = page;
+	entry->offset = offset;
+	entry->hash = hash;
+	entry->refcount = 1;
+
+	spin_lock(&rzs->dedup_lock);
+	hlist_add_head(&entry->node, &rzs->dedup_table[hash & rzs->dedup_mask]);
+	spin_unlock(&rzs->dedup_lock);
+
+	return 0;
+}
+
+/* Drop a reference, returns 1 if the object itself should be freed */
+static int ramzswap_dedup_put(struct ramzswap *rzs, u32 hash,
+			struct page *page, u16 offset)
+{
+	struct rzs_dedup_entry *entry, *unused = NULL;
+	struct hlist_node *n;
+	int last = 1;
+
+	spin_lock(&rzs->dedup_lock);
+	hlist_for_each_entry(entry, n, &rzs->dedup_table[hash & rzs->dedup_mask],
+			node) {
+		if (entry->page != page || entry->offset != offset)
+			continue;
+
+		if (--entry->refcount) {
+			last = 0;
+		} else {
+			hlist_del(&entry->node);
+			unused = entry;
+		}
+		break;
+	}
+	spin_unlock(&rzs->dedup_lock);
+
+	kfree(unused);
+
+	return last;
+}
+
 static void ramzswap_set_disksize(struct ramzswap *rzs, size_t totalram_bytes)
 {
 	if (!rzs->disksize) {
@@ -126,7 +222,7 @@ static void ramzswap_ioctl_get_stats(struct ramzswap *rzs,
 	size_t succ_writes, mem_used;
 	unsigned int good_compress_perc = 0, no_compress_perc = 0;
 
-	mem_used = xv_get_total_size_bytes(rzs->mem_pool)
+	mem_used = zs_get_total_size_bytes(rzs->mem_pool)
 			+ (rs->pages_expand << PAGE_SHIFT);
 	succ_writes = rzs_stat64_read(rzs, &rs->num_writes) -
 			rzs_stat64_read(rzs, &rs->failed_writes);
@@ -158,14 +254,117 @@ static void ramzswap_ioctl_get_stats(struct ramzswap *rzs,
 #endif /* CONFIG_RAMZSWAP_STATS */
 }
 
-static void ramzswap_free_page(struct ramzswap *rzs, size_t index)
+static int ramzswap_ioctl_get_stream_stats(struct ramzswap *rzs,
+			struct ramzswap_ioctl_stream_stats *s)
+{
+	if (s->stream >= rzs->num_streams)
+		return -EINVAL;
+
+	s->num_streams = rzs->num_streams;
+
+#if defined(CONFIG_RAMZSWAP_STATS)
+	{
+	struct ramzswap_stream *stream = &rzs->streams[s->stream];
+
+
+	mutex_lock(&stream->lock);
+	s->num_compress = stream->num_compress;
+	s->compr_data_size = stream->compr_size;
+	s->contended = stream->contended;
+	mutex_unlock(&stream->lock);
+	}
+#endif
+
+	return 0;
+}
+
+static int ramzswap_ioctl_get_class_stats(struct ramzswap *rzs,
+			struct ramzswap_ioctl_class_stats *s)
+{
+	struct zs_class_stats cs;
+	int ret;
+
+	ret = zs_get_class_stats(rzs->mem_pool, s->class, &cs);
+	if (ret)
+		return ret;
+
+	s->num_classes = zs_get_nr_classes();
+	s->size = cs.size;
+	s->pages_per_zspage = cs.pages_per_zspage;
+	s->objs_per_zspage = cs.objs_per_zspage;
+	s->zspages = cs.zspages;
+	s->objs_used = cs.objs_used;
+#if defined(CONFIG_RAMZSWAP_STATS)
+	s->num_migrated = rzs_stat64_read(rzs, &rzs->stats.num_migrated);
+#else
+	s->num_migrated = 0;
+#endif
+
+	return 0;
+}
+
+/*
+ * Take an idle compression stream, starting with the one for this CPU,
+ * and only wait if all of them are busy.
+ */
+static struct ramzswap_stream *ramzswap_get_stream(struct ramzswap *rzs)
 {
-	u32 clen;
-	void *obj;
+	struct ramzswap_stream *stream;
+	unsigned int i, first;
+
+	first = raw_smp_processor_id() % rzs->num_streams;
+
+	for (i = 0; i < rzs->num_streams; i++) {
+		stream = &rzs->streams[(first + i) % rzs->num_streams];
+		if (mutex_trylock(&stream->lock))
+			return stream;
+	}
+
+	stream = &rzs->streams[first];
+	mutex_lock(&stream->lock);
+#if defined(CONFIG_RAMZSWAP_STATS)
+	stream->contended++;
+#endif
+
+	return stream;
+}
+
+static void ramzswap_put_stream(struct ramzswap_stream *stream)
+{
+	mutex_unlock(&stream->lock);
+}
+
+static void __ramzswap_free_page(struct ramzswap *rzs, size_t index)
+{
+	u32 clen, hash;
+	struct zobj_header *zheader;
 
 	struct page *page = rzs->table[index].page;
 	u32 offset = rzs->table[index].offset;
 
+	/* A copy to the backing device in flight is discarded */
+	rzs_clear_flag(rzs, index, RZS_WRITEBACK);
+	rzs->table[index].age = 0;
+
+	if (rzs_test_flag(rzs, index, RZS_BACKED)) {
+		clear_bit(rzs->table[index].element, rzs->backing_map);
+		rzs_clear_flag(rzs, index, RZS_BACKED);
+		rzs->table[index].element = 0;
+		spin_lock(&rzs->stat64_lock);
+		rzs_stat_dec(&rzs->stats.pages_backed);
+		spin_unlock(&rzs->stat64_lock);
+		return;
+	}
+
+	if (rzs_test_flag(rzs, index, RZS_SAME)) {
+		rzs_clear_flag(rzs, index, RZS_SAME);
+		rzs->table[index].element = 0;
+		spin_lock(&rzs->stat64_lock);
+		rzs_stat_dec(&rzs->stats.pages_same);
+		spin_unlock(&rzs->stat64_lock);
+		return;
+	}
+
 	if (unlikely(!page)) {
 		/*
 		 * No memory is allocated for zero filled pages.
@@ -173,7 +372,9 @@ static void ramzswap_free_page(struct ramzswap *rzs, size_t index)
 		 */
 		if (rzs_test_flag(rzs, index, RZS_ZERO)) {
 			rzs_clear_flag(rzs, index, RZS_ZERO);
+			spin_lock(&rzs->stat64_lock);
 			rzs_stat_dec(&rzs->stats.pages_zero);
+			spin_unlock(&rzs->stat64_lock);
 		}
 		return;
 	}
@@ -182,26 +383,53 @@ static void ramzswap_free_page(struct ramzswap *rzs, size_t index)
 		clen = PAGE_SIZE;
 		__free_page(page);
 		rzs_clear_flag(rzs, index, RZS_UNCOMPRESSED);
+		spin_lock(&rzs->stat64_lock);
 		rzs_stat_dec(&rzs->stats.pages_expand);
+		spin_unlock(&rzs->stat64_lock);
 		goto out;
 	}
 
-	obj = kmap_atomic(page, KM_USER0) + offset;
-	clen = xv_get_object_size(obj) - sizeof(struct zobj_header);
-	kunmap_atomic(obj, KM_USER0);
+	zheader = zs_map_object(rzs->mem_pool, page, offset, KM_USER0);
+	clen = zheader->size - sizeof(*zheader);
+	hash = zheader->hash;
+	zs_unmap_object(rzs->mem_pool, page, offset, zheader, KM_USER0);
+
+	if (rzs_test_flag(rzs, index, RZS_DEDUP)) {
+		rzs_clear_flag(rzs, index, RZS_DEDUP);
+		if (!ramzswap_dedup_put(rzs, hash, page, offset)) {
+			/* Other slots still use the object */
+			spin_lock(&rzs->stat64_lock);
+			if (clen <= PAGE_SIZE / 2)
+				rzs_stat_dec(&rzs->stats.good_compress);
+			rzs_stat_dec(&rzs->stats.pages_dedup);
+			rzs_stat_dec(&rzs->stats.pages_stored);
+			spin_unlock(&rzs->stat64_lock);
+			goto clear;
+		}
+	}
 
-	xv_free(rzs->mem_pool, page, offset);
-	if (clen <= PAGE_SIZE / 2)
-		rzs_stat_dec(&rzs->stats.good_compress);
+	zs_free(rzs->mem_pool, page, offset);
 
 out:
+	spin_lock(&rzs->stat64_lock);
+	if (clen <= PAGE_SIZE / 2)
+		rzs_stat_dec(&rzs->stats.good_compress);
 	rzs->stats.compr_size -= clen;
 	rzs_stat_dec(&rzs->stats.pages_stored);
+	spin_unlock(&rzs->stat64_lock);
 
+clear:
 	rzs->table[index].page = NULL;
 	rzs->table[index].offset = 0;
 }
 
+static void ramzswap_free_page(struct ramzswap *rzs, size_t index)
+{
+	write_lock(&rzs->table_lock);
+	__ramzswap_free_page(rzs, index);
+	write_unlock(&rzs->table_lock);
+}
+
 static int handle_zero_page(struct bio *bio)
 {
 	void *user_mem;
@@ -218,6 +446,29 @@ static int handle_zero_page(struct bio *bio)
 	return 0;
 }
 
+static int handle_same_page(struct ramzswap *rzs, struct bio *bio)
+{
+	u32 index;
+	unsigned int pos;
+	unsigned long *user_mem;
+	unsigned long element;
+	struct page *page = bio->bi_io_vec[0].bv_page;
+
+	index = bio->bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	element = rzs->table[index].element;
+
+	user_mem = kmap_atomic(page, KM_USER0);
+	for (pos = 0; pos != PAGE_SIZE / sizeof(*user_mem); pos++)
+		user_mem[pos] = element;
+	kunmap_atomic(user_mem, KM_USER0);
+
+	flush_dcache_page(page);
+
+	set_bit(BIO_UPTODATE, &bio->bi_flags);
+	bio_endio(bio, 0);
+	return 0;
+}
+
 static int handle_uncompressed_page(struct ramzswap *rzs, struct bio *bio)
 {
 	u32 index;
@@ -268,7 +519,7 @@ static int ramzswap_read(struct ramzswap *rzs, struct bio *bio)
 	size_t clen;
 	struct page *page;
 	struct zobj_header *zheader;
-	unsigned char *user_mem, *cmem;
+	unsigned char *user_mem;
 
 	rzs_stat64_inc(rzs, &rzs->stats.num_reads);
 
@@ -278,6 +529,19 @@ static int ramzswap_read(struct ramzswap *rzs, struct bio *bio)
 	if (rzs_test_flag(rzs, index, RZS_ZERO))
 		return handle_zero_page(bio);
 
+	if (rzs_test_flag(rzs, index, RZS_SAME))
+		return handle_same_page(rzs, bio);
+
+	/* Moved to the backing device, let the block layer resubmit there */
+	if (rzs_test_flag(rzs, index, RZS_BACKED)) {
+		bio->bi_bdev = rzs->backing_bdev;
+		bio->bi_sector = rzs->table[index].element <<
+					SECTORS_PER_PAGE_SHIFT;
+		return 1;
+	}
+
+	rzs->table[index].age = 0;
+
 	/* Requested page is not present in compressed area */
 	if (!rzs->table[index].page)
 		return handle_ramzswap_fault(rzs, bio);
@@ -289,16 +553,16 @@ static int ramzswap_read(struct ramzswap *rzs, struct bio *bio)
 	user_mem = kmap_atomic(page, KM_USER0);
 	clen = PAGE_SIZE;
 
-	cmem = kmap_atomic(rzs->table[index].page, KM_USER1) +
-			rzs->table[index].offset;
+	zheader = zs_map_object(rzs->mem_pool, rzs->table[index].page,
+				rzs->table[index].offset, KM_USER1);
 
-	ret = lzo1x_decompress_safe(
-		cmem + sizeof(*zheader),
-		xv_get_object_size(cmem) - sizeof(*zheader),
+	ret = lzo1x_decompress_safe((unsigned char *)(zheader + 1),
+		zheader->size - sizeof(*zheader),
 		user_mem, &clen);
 
+	zs_unmap_object(rzs->mem_pool, rzs->table[index].page,
+			rzs->table[index].offset, zheader, KM_USER1);
 	kunmap_atomic(user_mem, KM_USER0);
-	kunmap_atomic(cmem, KM_USER1);
 
 	/* should NEVER happen */
 	if (unlikely(ret != LZO_E_OK)) {
@@ -326,36 +590,59 @@ static int ramzswap_write(struct ramzswap *rzs, struct bio *bio)
 	size_t clen;
 	struct zobj_header *zheader;
 	struct page *page, *page_store;
+	struct ramzswap_stream *stream;
+	struct rzs_dedup_entry *entry;
 	unsigned char *user_mem, *cmem, *src;
+	unsigned long element;
+	int uncompressed = 0, shared;
+	u32 hash = 0;
 
 	rzs_stat64_inc(rzs, &rzs->stats.num_writes);
 
 	page = bio->bi_io_vec[0].bv_page;
 	index = bio->bi_sector >> SECTORS_PER_PAGE_SHIFT;
 
-	src = rzs->compress_buffer;
-
-	mutex_lock(&rzs->lock);
+	/* A slot that is overwritten without a free must not stay backed */
+	if (rzs->table[index].page || rzs->table[index].flags)
+		ramzswap_free_page(rzs, index);
 
 	user_mem = kmap_atomic(page, KM_USER0);
-	if (page_zero_filled(user_mem)) {
+	if (page_same_filled(user_mem, &element)) {
 		kunmap_atomic(user_mem, KM_USER0);
-		mutex_unlock(&rzs->lock);
-		rzs_stat_inc(&rzs->stats.pages_zero);
-		rzs_set_flag(rzs, index, RZS_ZERO);
+		spin_lock(&rzs->stat64_lock);
+		if (element)
+			rzs_stat_inc(&rzs->stats.pages_same);
+		else
+			rzs_stat_inc(&rzs->stats.pages_zero);
+		spin_unlock(&rzs->stat64_lock);
+		if (element) {
+			/* Flag first, writeback tells values from pages by it */
+			rzs_set_flag(rzs, index, RZS_SAME);
+			smp_wmb();
+			rzs->table[index].element = element;
+		} else {
+			rzs_set_flag(rzs, index, RZS_ZERO);
+		}
 
 		set_bit(BIO_UPTODATE, &bio->bi_flags);
 		bio_endio(bio, 0);
 		return 0;
 	}
+	if (rzs->dedup_table)
+		hash = jhash2((u32 *)user_mem, PAGE_SIZE / sizeof(u32), 0);
+	kunmap_atomic(user_mem, KM_USER0);
+
+	stream = ramzswap_get_stream(rzs);
+	src = stream->buffer;
 
+	user_mem = kmap_atomic(page, KM_USER0);
 	ret = lzo1x_1_compress(user_mem, PAGE_SIZE, src, &clen,
-				rzs->compress_workmem);
+				stream->workmem);
 
 	kunmap_atomic(user_mem, KM_USER0);
 
 	if (unlikely(ret != LZO_E_OK)) {
-		mutex_unlock(&rzs->lock);
+		ramzswap_put_stream(stream);
 		pr_err("Compression failed! err=%d\n", ret);
 		rzs_stat64_inc(rzs, &rzs->stats.failed_writes);
 		goto out;
@@ -370,7 +657,7 @@ static int ramzswap_write(struct ramzswap *rzs, struct bio *bio)
 		clen = PAGE_SIZE;
 		page_store = alloc_page(GFP_NOIO | __GFP_HIGHMEM);
 		if (unlikely(!page_store)) {
-			mutex_unlock(&rzs->lock);
+			ramzswap_put_stream(stream);
 			pr_info("Error allocating memory for incompressible "
 				"page: %u\n", index);
 			rzs_stat64_inc(rzs, &rzs->stats.failed_writes);
@@ -378,17 +665,42 @@ static int ramzswap_write(struct ramzswap *rzs, struct bio *bio)
 		}
 
 		offset = 0;
-		rzs_set_flag(rzs, index, RZS_UNCOMPRESSED);
+		uncompressed = 1;
+		spin_lock(&rzs->stat64_lock);
 		rzs_stat_inc(&rzs->stats.pages_expand);
-		rzs->table[index].page = page_store;
+		spin_unlock(&rzs->stat64_lock);
 		src = kmap_atomic(page, KM_USER0);
 		goto memstore;
 	}
 
-	if (xv_malloc(rzs->mem_pool, clen + sizeof(*zheader),
-			&rzs->table[index].page, &offset,
+	if (rzs->dedup_table) {
+		spin_lock(&rzs->dedup_lock);
+		entry = ramzswap_dedup_get(rzs, hash, src, clen);
+		if (entry) {
+			rzs_set_flag(rzs, index, RZS_DEDUP);
+			rzs->table[index].offset = entry->offset;
+			smp_wmb();
+			rzs->table[index].page = entry->page;
+		}
+		spin_unlock(&rzs->dedup_lock);
+
+		if (entry) {
+			ramzswap_put_stream(stream);
+
+			spin_lock(&rzs->stat64_lock);
+			rzs_stat_inc(&rzs->stats.pages_dedup);
+			rzs_stat_inc(&rzs->stats.pages_stored);
+			if (clen <= PAGE_SIZE / 2)
+				rzs_stat_inc(&rzs->stats.good_compress);
+			spin_unlock(&rzs->stat64_lock);
+			goto done;
+		}
+	}
+
+	if (zs_malloc(rzs->mem_pool, clen + sizeof(*zheader),
+			&page_store, &offset,
 			GFP_NOIO | __GFP_HIGHMEM)) {
-		mutex_unlock(&rzs->lock);
+		ramzswap_put_stream(stream);
 		pr_info("Error allocating memory for compressed "
 			"page: %u, size=%zu\n", index, clen);
 		rzs_stat64_inc(rzs, &rzs->stats.failed_writes);
@@ -396,34 +708,56 @@ static int ramzswap_write(struct ramzswap *rzs, struct bio *bio)
 	}
 
 memstore:
-	rzs->table[index].offset = offset;
-
-	cmem = kmap_atomic(rzs->table[index].page, KM_USER1) +
-			rzs->table[index].offset;
-
-#if 0
-	/* Back-reference needed for memory defragmentation */
-	if (!rzs_test_flag(rzs, index, RZS_UNCOMPRESSED)) {
-		zheader = (struct zobj_header *)cmem;
+	if (unlikely(uncompressed)) {
+		cmem = kmap_atomic(page_store, KM_USER1);
+		memcpy(cmem, src, clen);
+		kunmap_atomic(cmem, KM_USER1);
+		kunmap_atomic(src, KM_USER0);
+	} else {
+		zheader = zs_map_object(rzs->mem_pool, page_store, offset,
+					KM_USER1);
+		/* Back-reference used by compaction */
 		zheader->table_idx = index;
-		cmem += sizeof(*zheader);
+		zheader->hash = hash;
+		zheader->size = clen + sizeof(*zheader);
+		memcpy(zheader + 1, src, clen);
+		zs_unmap_object(rzs->mem_pool, page_store, offset, zheader,
+				KM_USER1);
 	}
-#endif
 
-	memcpy(cmem, src, clen);
+	shared = !uncompressed && rzs->dedup_table &&
+		 !ramzswap_dedup_add(rzs, hash, page_store, offset);
 
-	kunmap_atomic(cmem, KM_USER1);
-	if (unlikely(rzs_test_flag(rzs, index, RZS_UNCOMPRESSED)))
-		kunmap_atomic(src, KM_USER0);
+	write_lock(&rzs->table_lock);
+	if (unlikely(uncompressed))
+		rzs_set_flag(rzs, index, RZS_UNCOMPRESSED);
+	else if (shared)
+		rzs_set_flag(rzs, index, RZS_DEDUP);
+
+	/*
+	 * Publish the page last: the writeback scan takes any slot with a
+	 * page, so its flags and contents have to be complete by then.
+	 */
+	rzs->table[index].offset = offset;
+	smp_wmb();
+	rzs->table[index].page = page_store;
+	write_unlock(&rzs->table_lock);
 
 	/* Update stats */
+#if defined(CONFIG_RAMZSWAP_STATS)
+	stream->num_compress++;
+	stream->compr_size += clen;
+#endif
+	ramzswap_put_stream(stream);
+
+	spin_lock(&rzs->stat64_lock);
 	rzs->stats.compr_size += clen;
 	rzs_stat_inc(&rzs->stats.pages_stored);
 	if (clen <= PAGE_SIZE / 2)
 		rzs_stat_inc(&rzs->stats.good_compress);
+	spin_unlock(&rzs->stat64_lock);
 
-	mutex_unlock(&rzs->lock);
-
+done:
 	set_bit(BIO_UPTODATE, &bio->bi_flags);
 	bio_endio(bio, 0);
 	return 0;
@@ -433,6 +767,355 @@ out:
 	return 0;
 }
 
+/*
+ * Background writeback to the backing device.
+ *
+ * Every wb_interval seconds all slots are scanned. Incompressible pages,
+ * and pages that have not been read for wb_cold seconds, are copied out
+ * in batches of up to RZS_WB_BATCH pages, written to free pages of the
+ * backing device as contiguously as the free map allows, and then
+ * dropped from RAM. Reads of such a slot are remapped to the backing
+ * device. Slots freed while their copy is in flight just lose the copy.
+ */
+static int ramzswap_wb_candidate(struct ramzswap *rzs, size_t index,
+			unsigned int cold)
+{
+	struct table *t = &rzs->table[index];
+
+	if (!t->page)
+		return 0;
+	smp_rmb();
+
+	if (t->flags & (BIT(RZS_ZERO) | BIT(RZS_SAME) |
+			BIT(RZS_BACKED) | BIT(RZS_WRITEBACK)))
+		return 0;
+
+	if (rzs_test_flag(rzs, index, RZS_UNCOMPRESSED))
+		return 1;
+
+	return cold && t->age >= cold;
+}
+
+/* Called with table_lock held for writing */
+static int ramzswap_wb_copy(struct ramzswap *rzs, size_t index,
+			struct page *dst)
+{
+	struct page *page = rzs->table[index].page;
+	u32 offset = rzs->table[index].offset;
+	struct zobj_header *zheader;
+	unsigned char *cmem, *dmem;
+	size_t clen = PAGE_SIZE;
+	int ret = LZO_E_OK;
+
+	dmem = kmap_atomic(dst, KM_USER1);
+
+	if (rzs_test_flag(rzs, index, RZS_UNCOMPRESSED)) {
+		cmem = kmap_atomic(page, KM_USER0);
+		memcpy(dmem, cmem, PAGE_SIZE);
+		kunmap_atomic(cmem, KM_USER0);
+	} else {
+		zheader = zs_map_object(rzs->mem_pool, page, offset, KM_USER0);
+		ret = lzo1x_decompress_safe((unsigned char *)(zheader + 1),
+			zheader->size - sizeof(*zheader), dmem, &clen);
+		zs_unmap_object(rzs->mem_pool, page, offset, zheader, KM_USER0);
+	}
+
+	kunmap_atomic(dmem, KM_USER1);
+
+	return ret == LZO_E_OK && clen == PAGE_SIZE ? 0 : -EIO;
+}
+
+static void ramzswap_wb_end_io(struct bio *bio, int err)
+{
+	complete(bio->bi_private);
+}
+
+/* Write nr pages to consecutive backing pages starting at blk */
+static int ramzswap_wb_write(struct ramzswap *rzs, struct page **pages,
+			int nr, unsigned long blk)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct bio *bio;
+	int added, ret;
+
+	while (nr) {
+		bio = bio_alloc(GFP_NOIO, nr);
+		if (!bio)
+			return -ENOMEM;
+
+		bio->bi_bdev = rzs->backing_bdev;
+		bio->bi_sector = blk << SECTORS_PER_PAGE_SHIFT;
+		bio->bi_end_io = ramzswap_wb_end_io;
+		bio->bi_private = &done;
+
+		for (added = 0; added < nr; added++)
+			if (bio_add_page(bio, pages[added], PAGE_SIZE, 0) !=
+					PAGE_SIZE)
+				break;
+
+		if (!added) {
+			bio_put(bio);
+			return -EIO;
+		}
+
+		init_completion(&done);
+		submit_bio(WRITE, bio);
+		wait_for_completion(&done);
+
+		ret = test_bit(BIO_UPTODATE, &bio->bi_flags) ? 0 : -EIO;
+		bio_put(bio);
+		if (ret)
+			return ret;
+
+		pages += added;
+		nr -= added;
+		blk += added;
+	}
+
+	return 0;
+}
+
+static void ramzswap_wb_flush(struct ramzswap *rzs, int nr)
+{
+	unsigned long blk;
+	int i = 0, j, run, err;
+
+	while (i < nr) {
+		/* Take as long a free run as is there for the rest */
+		write_lock(&rzs->table_lock);
+		blk = find_next_zero_bit(rzs->backing_map, rzs->backing_pages,
+					rzs->backing_hint);
+		if (blk >= rzs->backing_pages)
+			blk = find_first_zero_bit(rzs->backing_map,
+						rzs->backing_pages);
+		run = 0;
+		while (blk < rzs->backing_pages && i + run < nr &&
+		       blk + run < rzs->backing_pages &&
+		       !test_bit(blk + run, rzs->backing_map)) {
+			set_bit(blk + run, rzs->backing_map);
+			run++;
+		}
+		rzs->backing_hint = blk + run;
+		write_unlock(&rzs->table_lock);
+
+		err = run ? ramzswap_wb_write(rzs, &rzs->wb_pages[i], run, blk) :
+				-ENOSPC;
+		if (!run)
+			run = nr - i;
+
+		write_lock(&rzs->table_lock);
+		for (j = 0; j < run; j++) {
+			u32 index = rzs->wb_index[i + j];
+
+			if (err || !rzs_test_flag(rzs, index, RZS_WRITEBACK)) {
+				rzs_clear_flag(rzs, index, RZS_WRITEBACK);
+				if (err != -ENOSPC)
+					clear_bit(blk + j, rzs->backing_map);
+				continue;
+			}
+
+			__ramzswap_free_page(rzs, index);
+			rzs_set_flag(rzs, index, RZS_BACKED);
+			rzs->table[index].element = blk + j;
+			spin_lock(&rzs->stat64_lock);
+			rzs_stat_inc(&rzs->stats.pages_backed);
+			spin_unlock(&rzs->stat64_lock);
+		}
+		write_unlock(&rzs->table_lock);
+
+		if (err)
+			pr_debug("Writeback of %d pages failed: %d\n", run, err);
+		i += run;
+	}
+}
+
+static void ramzswap_wb_work(struct work_struct *work)
+{
+	struct ramzswap *rzs = container_of(to_delayed_work(work),
+					struct ramzswap, wb_work);
+	size_t index, num_pages = rzs->disksize >> PAGE_SHIFT;
+	unsigned int cold = 0, budget = wb_max_pages;
+	int nr = 0;
+
+	if (wb_cold)
+		cold = min(DIV_ROUND_UP(wb_cold, max(wb_interval, 1U)), 255U);
+
+	/* Slot 0 is the swap header */
+	for (index = 1; index < num_pages; index++) {
+		if (budget && ramzswap_wb_candidate(rzs, index, cold)) {
+			write_lock(&rzs->table_lock);
+			if (ramzswap_wb_candidate(rzs, index, cold) &&
+			    !ramzswap_wb_copy(rzs, index, rzs->wb_pages[nr])) {
+				rzs_set_flag(rzs, index, RZS_WRITEBACK);
+				rzs->wb_index[nr++] = index;
+				budget--;
+			}
+			write_unlock(&rzs->table_lock);
+
+			if (nr == RZS_WB_BATCH) {
+				ramzswap_wb_flush(rzs, nr);
+				nr = 0;
+			}
+		}
+
+		/* Racy, a read resetting the age at the same time wins either way */
+		if (rzs->table[index].page && rzs->table[index].age < 255)
+			rzs->table[index].age++;
+
+		if (!(index % 1024))
+			cond_resched();
+	}
+
+	if (nr)
+		ramzswap_wb_flush(rzs, nr);
+
+	queue_delayed_work(ramzswap_wq, &rzs->wb_work,
+			max(wb_interval, 1U) * HZ);
+}
+
+static void ramzswap_wb_exit(struct ramzswap *rzs)
+{
+	int i;
+
+	if (!rzs->backing_bdev)
+		return;
+
+	cancel_delayed_work_sync(&rzs->wb_work);
+
+	for (i = 0; i < RZS_WB_BATCH; i++) {
+		if (rzs->wb_pages[i])
+			__free_page(rzs->wb_pages[i]);
+		rzs->wb_pages[i] = NULL;
+	}
+
+	vfree(rzs->backing_map);
+	rzs->backing_map = NULL;
+
+	close_bdev_exclusive(rzs->backing_bdev, FMODE_READ | FMODE_WRITE);
+	rzs->backing_bdev = NULL;
+}
+
+static int ramzswap_wb_init(struct ramzswap *rzs)
+{
+	struct block_device *bdev;
+	size_t map_bytes;
+	int i;
+
+	bdev = open_bdev_exclusive(rzs->backing_name,
+				FMODE_READ | FMODE_WRITE, rzs);
+	if (IS_ERR(bdev)) {
+		pr_err("Error opening backing device %s\n", rzs->backing_name);
+		return PTR_ERR(bdev);
+	}
+
+	rzs->backing_pages = i_size_read(bdev->bd_inode) >> PAGE_SHIFT;
+	map_bytes = BITS_TO_LONGS(rzs->backing_pages) * sizeof(long);
+	rzs->backing_map = vmalloc(map_bytes);
+	if (!rzs->backing_map) {
+		close_bdev_exclusive(bdev, FMODE_READ | FMODE_WRITE);
+		return -ENOMEM;
+	}
+	memset(rzs->backing_map, 0, map_bytes);
+	rzs->backing_hint = 0;
+
+	/* Writeback runs under memory pressure, keep its pages around */
+	rzs->backing_bdev = bdev;
+	for (i = 0; i < RZS_WB_BATCH; i++) {
+		rzs->wb_pages[i] = alloc_page(GFP_KERNEL);
+		if (!rzs->wb_pages[i]) {
+			ramzswap_wb_exit(rzs);
+			return -ENOMEM;
+		}
+	}
+
+	queue_delayed_work(ramzswap_wq, &rzs->wb_work,
+			max(wb_interval, 1U) * HZ);
+
+	pr_info("Writing back to %s (%lu kB)\n", rzs->backing_name,
+		rzs->backing_pages << (PAGE_SHIFT - 10));
+	return 0;
+}
+
+/*
+ * Compaction. Freed objects leave holes in the allocator's zspages that
+ * only fill up again with objects of the same size class. Every
+ * compact_interval seconds, objects are moved out of the sparsest zspages
+ * so that those can be given back. Each object finds the slot pointing
+ * at it through zobj_header.table_idx; objects shared by several slots
+ * stay where they are.
+ */
+static int ramzswap_move_object(void *priv, void *obj,
+			struct page *old_page, u32 old_offset,
+			struct page *new_page, u32 new_offset)
+{
+	struct ramzswap *rzs = priv;
+	struct zobj_header *zheader = obj;
+	u32 index = zheader->table_idx;
+	struct rzs_dedup_entry *entry;
+	struct hlist_node *n;
+	int ret = -EBUSY;
+
+	/* Also catches objects whose writer has not published them yet */
+	if (index >= rzs->disksize >> PAGE_SHIFT ||
+	    rzs->table[index].page != old_page ||
+	    rzs->table[index].offset != old_offset ||
+	    rzs->table[index].flags & (BIT(RZS_UNCOMPRESSED) | BIT(RZS_ZERO) |
+				BIT(RZS_SAME) | BIT(RZS_BACKED)))
+		return -EINVAL;
+
+	if (!rzs_test_flag(rzs, index, RZS_DEDUP)) {
+		ret = 0;
+		goto out;
+	}
+
+	spin_lock(&rzs->dedup_lock);
+	hlist_for_each_entry(entry, n,
+			&rzs->dedup_table[zheader->hash & rzs->dedup_mask],
+			node) {
+		if (entry->page != old_page || entry->offset != old_offset)
+			continue;
+
+		if (entry->refcount == 1) {
+			entry->page = new_page;
+			entry->offset = new_offset;
+			ret = 0;
+		}
+		break;
+	}
+	spin_unlock(&rzs->dedup_lock);
+
+	if (ret)
+		return ret;
+
+out:
+	rzs->table[index].page = new_page;
+	rzs->table[index].offset = new_offset;
+	rzs_stat64_inc(rzs, &rzs->stats.num_migrated);
+
+	return 0;
+}
+
+static void ramzswap_compact_work(struct work_struct *work)
+{
+	struct ramzswap *rzs = container_of(to_delayed_work(work),
+					struct ramzswap, compact_work);
+	unsigned int moved;
+
+	/* Readers and frees wait while objects move, so move a few at once */
+	do {
+		write_lock(&rzs->table_lock);
+		moved = zs_compact(rzs->mem_pool, ramzswap_move_object, rzs,
+				RZS_COMPACT_BATCH);
+		write_unlock(&rzs->table_lock);
+
+		cond_resched();
+	} while (moved == RZS_COMPACT_BATCH);
+
+	if (compact_interval)
+		queue_delayed_work(ramzswap_wq, &rzs->compact_work,
+				compact_interval * HZ);
+}
+
 /*
  * Check if request is within bounds and page aligned.
  */
@@ -473,7 +1156,9 @@ static int ramzswap_make_request(struct request_queue *queue, struct bio *bio)
 
 	switch (bio_data_dir(bio)) {
 	case READ:
+		read_lock(&rzs->table_lock);
 		ret = ramzswap_read(rzs, bio);
+		read_unlock(&rzs->table_lock);
 		break;
 
 	case WRITE:
@@ -491,12 +1176,22 @@ static void reset_device(struct ramzswap *rzs)
 	/* Do not accept any new I/O request */
 	rzs->init_done = 0;
 
+	cancel_delayed_work_sync(&rzs->compact_work);
+	ramzswap_wb_exit(rzs);
+
 	/* Free various per-device buffers */
-	kfree(rzs->compress_workmem);
-	free_pages((unsigned long)rzs->compress_buffer, 1);
+	if (rzs->streams) {
+		unsigned int i;
 
-	rzs->compress_workmem = NULL;
-	rzs->compress_buffer = NULL;
+		for (i = 0; i < rzs->num_streams; i++) {
+			kfree(rzs->streams[i].workmem);
+			free_pages((unsigned long)rzs->streams[i].buffer, 1);
+		}
+		kfree(rzs->streams);
+	}
+
+	rzs->streams = NULL;
+	rzs->num_streams = 0;
 
 	/* Free all pages that are still in this ramzswap device */
 	for (index = 0; index < rzs->disksize >> PAGE_SHIFT; index++) {
@@ -506,19 +1201,38 @@ static void reset_device(struct ramzswap *rzs)
 		page = rzs->table[index].page;
 		offset = rzs->table[index].offset;
 
-		if (!page)
+		/* Shared objects are freed once, from the dedup index */
+		if (!page || rzs_test_flag(rzs, index, RZS_SAME) ||
+		    rzs_test_flag(rzs, index, RZS_BACKED) ||
+		    rzs_test_flag(rzs, index, RZS_DEDUP))
 			continue;
 
 		if (unlikely(rzs_test_flag(rzs, index, RZS_UNCOMPRESSED)))
 			__free_page(page);
 		else
-			xv_free(rzs->mem_pool, page, offset);
+			zs_free(rzs->mem_pool, page, offset);
+	}
+
+	if (rzs->dedup_table) {
+		struct rzs_dedup_entry *entry;
+		struct hlist_node *n, *tmp;
+
+		for (index = 0; index <= rzs->dedup_mask; index++) {
+			hlist_for_each_entry_safe(entry, n, tmp,
+					&rzs->dedup_table[index], node) {
+				zs_free(rzs->mem_pool, entry->page,
+					entry->offset);
+				kfree(entry);
+			}
+		}
+		vfree(rzs->dedup_table);
+		rzs->dedup_table = NULL;
 	}
 
 	vfree(rzs->table);
 	rzs->table = NULL;
 
-	xv_destroy_pool(rzs->mem_pool);
+	zs_destroy_pool(rzs->mem_pool);
 	rzs->mem_pool = NULL;
 
 	/* Reset stats */
@@ -530,6 +1244,7 @@ static void reset_device(struct ramzswap *rzs)
 static int ramzswap_ioctl_init_device(struct ramzswap *rzs)
 {
 	int ret;
+	unsigned int i;
 	size_t num_pages;
 	struct page *page;
 	union swap_header *swap_header;
@@ -541,18 +1256,34 @@ static int ramzswap_ioctl_init_device(struct ramzswap *rzs)
 
 	ramzswap_set_disksize(rzs, totalram_pages << PAGE_SHIFT);
 
-	rzs->compress_workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
-	if (!rzs->compress_workmem) {
-		pr_err("Error allocating compressor working memory!\n");
+	rzs->num_streams = num_streams ? num_streams : num_online_cpus();
+	rzs->num_streams = min(rzs->num_streams, max_num_streams);
+	rzs->streams = kzalloc(rzs->num_streams * sizeof(*rzs->streams),
+				GFP_KERNEL);
+	if (!rzs->streams) {
+		pr_err("Error allocating compression streams\n");
 		ret = -ENOMEM;
 		goto fail;
 	}
 
-	rzs->compress_buffer = (void *)__get_free_pages(__GFP_ZERO, 1);
-	if (!rzs->compress_buffer) {
-		pr_err("Error allocating compressor buffer space\n");
-		ret = -ENOMEM;
-		goto fail;
+	for (i = 0; i < rzs->num_streams; i++) {
+		struct ramzswap_stream *stream = &rzs->streams[i];
+
+		mutex_init(&stream->lock);
+
+		stream->workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
+		if (!stream->workmem) {
+			pr_err("Error allocating compressor working memory!\n");
+			ret = -ENOMEM;
+			goto fail;
+		}
+
+		stream->buffer = (void *)__get_free_pages(__GFP_ZERO, 1);
+		if (!stream->buffer) {
+			pr_err("Error allocating compressor buffer space\n");
+			ret = -ENOMEM;
+			goto fail;
+		}
 	}
 
 	num_pages = rzs->disksize >> PAGE_SHIFT;
@@ -566,6 +1297,21 @@ static int ramzswap_ioctl_init_device(struct ramzswap *rzs)
 	}
 	memset(rzs->table, 0, num_pages * sizeof(*rzs->table));
 
+	if (dedup) {
+		size_t buckets = roundup_pow_of_two(max_t(size_t,
+						num_pages / 4, 256));
+
+		rzs->dedup_table = vmalloc(buckets * sizeof(struct hlist_head));
+		if (rzs->dedup_table) {
+			for (i = 0; i < buckets; i++)
+				INIT_HLIST_HEAD(&rzs->dedup_table[i]);
+			rzs->dedup_mask = buckets - 1;
+		} else {
+			pr_info("No memory for the dedup index, "
+				"continuing without it\n");
+		}
+	}
+
 	page = alloc_page(__GFP_ZERO);
 	if (!page) {
 		pr_err("Error allocating swap header page\n");
@@ -584,13 +1330,23 @@ static int ramzswap_ioctl_init_device(struct ramzswap *rzs)
 	/* ramzswap devices sort of resembles non-rotational disks */
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, rzs->disk->queue);
 
-	rzs->mem_pool = xv_create_pool();
+	rzs->mem_pool = zs_create_pool();
 	if (!rzs->mem_pool) {
 		pr_err("Error creating memory pool\n");
 		ret = -ENOMEM;
 		goto fail;
 	}
 
+	if (rzs->backing_name[0]) {
+		ret = ramzswap_wb_init(rzs);
+		if (ret)
+			goto fail;
+	}
+
+	if (compact_interval)
+		queue_delayed_work(ramzswap_wq, &rzs->compact_work,
+				compact_interval * HZ);
+
 	rzs->init_done = 1;
 
 	pr_debug("Initialization done!\n");
@@ -655,6 +1411,58 @@ static int ramzswap_ioctl(struct block_device *bdev, fmode_t mode,
 		kfree(stats);
 		break;
 	}
+	case RZSIO_SET_BACKING_DEV:
+		if (rzs->init_done) {
+			ret = -EBUSY;
+			goto out;
+		}
+		if (copy_from_user(rzs->backing_name, (void *)arg,
+					RZS_BACKING_NAME_LEN)) {
+			ret = -EFAULT;
+			goto out;
+		}
+		rzs->backing_name[RZS_BACKING_NAME_LEN - 1] = '\0';
+		pr_info("Backing device set to %s\n", rzs->backing_name);
+		break;
+
+	case RZSIO_GET_STREAM_STATS:
+	{
+		struct ramzswap_ioctl_stream_stats stats;
+
+		if (!rzs->init_done) {
+			ret = -ENOTTY;
+			goto out;
+		}
+		if (copy_from_user(&stats, (void *)arg, sizeof(stats))) {
+			ret = -EFAULT;
+			goto out;
+		}
+		ret = ramzswap_ioctl_get_stream_stats(rzs, &stats);
+		if (ret)
+			goto out;
+		if (copy_to_user((void *)arg, &stats, sizeof(stats)))
+			ret = -EFAULT;
+		break;
+	}
+	case RZSIO_GET_CLASS_STATS:
+	{
+		struct ramzswap_ioctl_class_stats stats;
+
+		if (!rzs->init_done) {
+			ret = -ENOTTY;
+			goto out;
+		}
+		if (copy_from_user(&stats, (void *)arg, sizeof(stats))) {
+			ret = -EFAULT;
+			goto out;
+		}
+		ret = ramzswap_ioctl_get_class_stats(rzs, &stats);
+		if (ret)
+			goto out;
+		if (copy_to_user((void *)arg, &stats, sizeof(stats)))
+			ret = -EFAULT;
+		break;
+	}
 	case RZSIO_INIT:
 		ret = ramzswap_ioctl_init_device(rzs);
 		break;
@@ -703,8 +1511,11 @@ static int create_device(struct ramzswap *rzs, int device_id)
 {
 	int ret = 0;
 
-	mutex_init(&rzs->lock);
 	spin_lock_init(&rzs->stat64_lock);
+	spin_lock_init(&rzs->dedup_lock);
+	rwlock_init(&rzs->table_lock);
+	INIT_DELAYED_WORK(&rzs->compact_work, ramzswap_compact_work);
+	INIT_DELAYED_WORK(&rzs->wb_work, ramzswap_wb_work);
 
 	rzs->queue = blk_alloc_queue(GFP_KERNEL);
 	if (!rzs->queue) {
@@ -770,11 +1581,17 @@ static int __init ramzswap_init(void)
 		goto out;
 	}
 
+	ramzswap_wq = create_singlethread_workqueue("ramzswap");
+	if (!ramzswap_wq) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
 	ramzswap_major = register_blkdev(0, "ramzswap");
 	if (ramzswap_major <= 0) {
 		pr_warning("Unable to get major number\n");
 		ret = -EBUSY;
-		goto out;
+		goto destroy_wq;
 	}
 
 	if (!num_devices) {
@@ -803,6 +1620,8 @@ free_devices:
 		destroy_device(&devices[--dev_id]);
 unregister:
 	unregister_blkdev(ramzswap_major, "ramzswap");
+destroy_wq:
+	destroy_workqueue(ramzswap_wq);
 out:
 	return ret;
 }
@@ -821,6 +1640,7 @@ static void __exit ramzswap_exit(void)
 	}
 
 	unregister_blkdev(ramzswap_major, "ramzswap");
+	destroy_workqueue(ramzswap_wq);
 
 	kfree(devices);
 	pr_debug("Cleanup done!\n");
@@ -828,6 +1648,21 @@ static void __exit ramzswap_exit(void)
 
 module_param(num_devices, uint, 0);
 MODULE_PARM_DESC(num_devices, "Number of ramzswap devices");
+module_param(dedup, bool, 0);
+MODULE_PARM_DESC(dedup, "Store identical pages only once");
+module_param(wb_interval, uint, 0644);
+MODULE_PARM_DESC(wb_interval, "Seconds between writeback scans");
+module_param(wb_cold, uint, 0644);
+MODULE_PARM_DESC(wb_cold,
+	"Write back pages not read for this many seconds (0: only incompressible)");
+module_param(wb_max_pages, uint, 0644);
+MODULE_PARM_DESC(wb_max_pages, "Pages written back per scan, at most");
+module_param(compact_interval, uint, 0644);
+MODULE_PARM_DESC(compact_interval,
+	"Seconds between compaction runs (0: no compaction)");
+module_param(num_streams, uint, 0);
+MODULE_PARM_DESC(num_streams,
+	"Compression streams per device (default: one per online CPU)");
 
 module_init(ramzswap_init);
 module_exit(ramzswap_exit);
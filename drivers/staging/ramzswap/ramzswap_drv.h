@@ -17,15 +17,17 @@
 
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "ramzswap_ioctl.h"
-#include "xvmalloc.h"
+#include "zsmalloc.h"
 
 /*
  * Some arbitrary value. This is just to catch
  * invalid value for num_devices module parameter.
  */
 static const unsigned max_num_devices = 32;
+static const unsigned max_num_streams = 32;
 
 /*
  * Stored at beginning of each compressed object.
@@ -34,9 +36,9 @@ static const unsigned max_num_devices = 32;
  * object. This is required to support memory defragmentation.
  */
 struct zobj_header {
-#if 0
 	u32 table_idx;
-#endif
+	u32 hash;	/* of the uncompressed page, for the dedup index */
+	u16 size;	/* of the object, header included */
 };
 
 /*-- Configurable parameters */
@@ -52,10 +54,16 @@ static const unsigned max_zpage_size = PAGE_SIZE / 4 * 3;
 
 /*
  * NOTE: max_zpage_size must be less than or equal to:
- *   XV_MAX_ALLOC_SIZE - sizeof(struct zobj_header)
- * otherwise, xv_malloc() would always return failure.
+ *   ZS_MAX_ALLOC_SIZE - sizeof(struct zobj_header)
+ * otherwise, zs_malloc() would always return failure.
  */
 
+/* Pages written to the backing device per bio, at most */
+#define RZS_WB_BATCH		32
+
+/* Objects moved per table_lock hold while compacting */
+#define RZS_COMPACT_BATCH	64
+
 /*-- End of configurable params */
 
 #define SECTOR_SHIFT		9
@@ -71,6 +79,18 @@ enum rzs_pageflags {
 	/* Page consists entirely of zeros */
 	RZS_ZERO,
 
+	/* Page is one repeated word, kept in table[page_no].element */
+	RZS_SAME,
+
+	/* Compressed object is shared through the dedup index */
+	RZS_DEDUP,
+
+	/* Page lives on the backing device, at table[page_no].element */
+	RZS_BACKED,
+
+	/* Page is being copied to the backing device */
+	RZS_WRITEBACK,
+
 	__NR_RZS_PAGEFLAGS,
 };
 
@@ -81,9 +101,12 @@ enum rzs_pageflags {
  * These table entries must fit exactly in a page.
  */
 struct table {
-	struct page *page;
+	union {
+		struct page *page;
+		unsigned long element;	/* RZS_SAME value, RZS_BACKED page */
+	};
 	u16 offset;
-	u8 count;	/* object ref count (not yet used) */
+	u8 age;		/* writeback rounds since the last read */
 	u8 flags;
 } __attribute__((aligned(4)));
 
@@ -100,19 +123,52 @@ struct ramzswap_stats {
 	u64 invalid_io;		/* non-swap I/O requests */
 	u64 notify_free;	/* no. of swap slot free notifications */
 	u32 pages_zero;		/* no. of zero filled pages */
+	u32 pages_same;		/* no. of pages filled with one other word */
+	u32 pages_dedup;	/* no. of pages sharing an existing object */
+	u32 pages_backed;	/* no. of pages moved to the backing device */
+	u64 num_migrated;	/* objects moved by compaction */
 	u32 pages_stored;	/* no. of pages currently stored */
 	u32 good_compress;	/* % of pages with compression ratio<=50% */
 	u32 pages_expand;	/* % of incompressible pages */
 #endif
 };
 
+/*
+ * One per distinct compressed object, hashed on the content of the page
+ * it was made from. Slots holding the same content share the object.
+ */
+struct rzs_dedup_entry {
+	struct hlist_node node;
+	struct page *page;
+	u32 refcount;
+	u32 hash;
+	u16 offset;
+};
+
+/*
+ * A compressor context. Writers take any idle one so that several pages
+ * can be compressed at the same time.
+ */
+struct ramzswap_stream {
+	struct mutex lock;
+	void *workmem;
+	void *buffer;
+#if defined(CONFIG_RAMZSWAP_STATS)
+	u64 num_compress;	/* pages compressed with this stream */
+	u64 compr_size;		/* and their total compressed size */
+	u64 contended;		/* writers that found all streams busy */
+#endif
+};
+
 struct ramzswap {
-	struct xv_pool *mem_pool;
-	void *compress_workmem;
-	void *compress_buffer;
+	struct zs_pool *mem_pool;
+	struct ramzswap_stream *streams;
+	unsigned int num_streams;
 	struct table *table;
-	spinlock_t stat64_lock;	/* protect 64-bit stats */
-	struct mutex lock;
+	struct hlist_head *dedup_table;
+	unsigned long dedup_mask;
+	spinlock_t dedup_lock;
+	spinlock_t stat64_lock;	/* protect stats shared by all streams */
 	struct request_queue *queue;
 	struct gendisk *disk;
 	int init_done;
@@ -123,6 +179,26 @@ struct ramzswap {
 	 */
 	size_t disksize;	/* bytes */
 
+	/*
+	 * Taken for reading by the read path and for writing whenever a
+	 * slot is freed, published, moved by compaction or written back.
+	 */
+	rwlock_t table_lock;
+	struct delayed_work compact_work;
+
+	/*
+	 * Optional backing device. Incompressible and cold pages are
+	 * moved there in the background.
+	 */
+	char backing_name[RZS_BACKING_NAME_LEN];
+	struct block_device *backing_bdev;
+	unsigned long *backing_map;	/* used pages of backing_bdev */
+	unsigned long backing_pages;
+	unsigned long backing_hint;
+	struct delayed_work wb_work;
+	struct page *wb_pages[RZS_WB_BATCH];
+	u32 wb_index[RZS_WB_BATCH];
+
 	struct ramzswap_stats stats;
 };
 
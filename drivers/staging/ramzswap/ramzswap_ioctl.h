@@ -15,6 +15,8 @@
 #ifndef _RAMZSWAP_IOCTL_H_
 #define _RAMZSWAP_IOCTL_H_
 
+#define RZS_BACKING_NAME_LEN	64
+
 struct ramzswap_ioctl_stats {
 	u64 disksize;		/* user specified or equal to backing swap
 				 * size (if present) */
@@ -34,9 +36,31 @@ struct ramzswap_ioctl_stats {
 	u64 mem_used_total;
 } __attribute__ ((packed, aligned(4)));
 
+struct ramzswap_ioctl_stream_stats {
+	u32 stream;		/* in: stream to report */
+	u32 num_streams;	/* out: streams on this device */
+	u64 num_compress;	/* pages compressed with this stream */
+	u64 compr_data_size;	/* their compressed size */
+	u64 contended;		/* writes that waited for this stream */
+} __attribute__ ((packed, aligned(4)));
+
+struct ramzswap_ioctl_class_stats {
+	u32 class;		/* in: size class to report */
+	u32 num_classes;	/* out: size classes of the allocator */
+	u32 size;		/* object size of this class */
+	u32 pages_per_zspage;	/* pages allocated together */
+	u32 objs_per_zspage;	/* objects that fit in them */
+	u32 zspages;		/* zspages currently allocated */
+	u64 objs_used;		/* objects currently allocated */
+	u64 num_migrated;	/* objects moved by compaction, all classes */
+} __attribute__ ((packed, aligned(4)));
+
 #define RZSIO_SET_DISKSIZE_KB	_IOW('z', 0, size_t)
 #define RZSIO_GET_STATS		_IOR('z', 1, struct ramzswap_ioctl_stats)
 #define RZSIO_INIT		_IO('z', 2)
 #define RZSIO_RESET		_IO('z', 3)
+#define RZSIO_GET_STREAM_STATS	_IOWR('z', 4, struct ramzswap_ioctl_stream_stats)
+#define RZSIO_SET_BACKING_DEV	_IOW('z', 5, char[RZS_BACKING_NAME_LEN])
+#define RZSIO_GET_CLASS_STATS	_IOWR('z', 6, struct ramzswap_ioctl_class_stats)
 
 #endif
@@ -0,0 +1,514 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+/*
+ * Objects are served from size classes ZS_SIZE_CLASS_DELTA bytes apart.
+ * Each class carves zspages (one to ZS_MAX_PAGES_PER_ZSPAGE 0-order,
+ * possibly highmem, pages) into equal slots, so there is no per-object
+ * header and no splitting or merging of free blocks. Each class has its
+ * own lock. Objects may cross a page boundary within their zspage; those
+ * are mapped by copying through a per-cpu buffer.
+ *
+ * Freed slots leave holes in zspages; zs_compact() moves objects out of
+ * the emptiest zspages of a class into the fullest ones, with the help
+ * of the user who has to update its references.
+ */
+
+#include <linux/bitops.h>
+#include <linux/errno.h>
+#include <linux/highmem.h>
+#include <linux/init.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/cpumask.h>
+
+#include "zsmalloc.h"
+#include "zsmalloc_int.h"
+
+static unsigned int get_class_idx(u32 size)
+{
+	if (size <= ZS_MIN_ALLOC_SIZE)
+		return 0;
+
+	return DIV_ROUND_UP(size - ZS_MIN_ALLOC_SIZE, ZS_SIZE_CLASS_DELTA);
+}
+
+/* Number of pages per zspage that wastes the least at its end */
+static unsigned int get_pages_per_zspage(u32 size)
+{
+	unsigned int i, best = 1, best_used = 0;
+
+	for (i = 1; i <= ZS_MAX_PAGES_PER_ZSPAGE; i++) {
+		u32 zspage_size = i * PAGE_SIZE;
+		u32 used = zspage_size - zspage_size % size;
+		u32 used_pct = used * 100 / zspage_size;
+
+		if (used_pct > best_used) {
+			best_used = used_pct;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+static struct zspage *get_zspage(struct page *page)
+{
+	return (struct zspage *)page_private(page);
+}
+
+static void obj_location(struct zspage *zspage, struct size_class *class,
+			unsigned int obj, struct page **page, u32 *offset)
+{
+	unsigned long pos = (unsigned long)obj * class->size;
+
+	*page = zspage->pages[pos >> PAGE_SHIFT];
+	*offset = pos & ~PAGE_MASK;
+}
+
+static unsigned int obj_index(struct size_class *class, struct page *page,
+			u32 offset)
+{
+	return ((page->index << PAGE_SHIFT) + offset) / class->size;
+}
+
+static void free_zspage(struct zs_pool *pool, struct size_class *class,
+			struct zspage *zspage)
+{
+	unsigned int i;
+
+	for (i = 0; i < class->pages_per_zspage; i++) {
+		struct page *page = zspage->pages[i];
+
+		if (!page)
+			continue;
+
+		set_page_private(page, 0);
+		page->index = 0;
+		__free_page(page);
+		atomic_dec(&pool->total_pages);
+	}
+
+	kfree(zspage);
+}
+
+static struct zspage *alloc_zspage(struct zs_pool *pool,
+			struct size_class *class, unsigned int class_idx,
+			gfp_t flags)
+{
+	struct zspage *zspage;
+	unsigned int i;
+
+	zspage = kzalloc(sizeof(*zspage), flags & ~__GFP_HIGHMEM);
+	if (!zspage)
+		return NULL;
+
+	INIT_LIST_HEAD(&zspage->list);
+	zspage->class_idx = class_idx;
+
+	for (i = 0; i < class->pages_per_zspage; i++) {
+		struct page *page = alloc_page(flags);
+
+		if (!page) {
+			free_zspage(pool, class, zspage);
+			return NULL;
+		}
+
+		set_page_private(page, (unsigned long)zspage);
+		page->index = i;
+		zspage->pages[i] = page;
+		atomic_inc(&pool->total_pages);
+	}
+
+	return zspage;
+}
+
+/* Called with class->lock held */
+static unsigned int take_obj(struct size_class *class, struct zspage *zspage)
+{
+	unsigned int obj;
+
+	obj = find_first_zero_bit(zspage->used, class->objs_per_zspage);
+	__set_bit(obj, zspage->used);
+
+	if (++zspage->inuse == class->objs_per_zspage)
+		list_move(&zspage->list, &class->full);
+	class->objs_used++;
+
+	return obj;
+}
+
+/*
+ * Called with class->lock held. Returns 1 if the zspage became empty and
+ * was taken off the lists, the caller then frees it.
+ */
+static int put_obj(struct size_class *class, struct zspage *zspage,
+			unsigned int obj)
+{
+	__clear_bit(obj, zspage->used);
+
+	if (zspage->inuse-- == class->objs_per_zspage)
+		list_move(&zspage->list, &class->partial);
+	class->objs_used--;
+
+	if (zspage->inuse)
+		return 0;
+
+	list_del(&zspage->list);
+	class->nr_zspages--;
+	return 1;
+}
+
+/**
+ * zs_create_pool - Create a memory pool.
+ */
+struct zs_pool *zs_create_pool(void)
+{
+	struct zs_pool *pool;
+	unsigned int i;
+	int cpu;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	for (i = 0; i < ZS_NR_CLASSES; i++) {
+		struct size_class *class = &pool->classes[i];
+
+		spin_lock_init(&class->lock);
+		class->size = ZS_MIN_ALLOC_SIZE + i * ZS_SIZE_CLASS_DELTA;
+		class->pages_per_zspage = get_pages_per_zspage(class->size);
+		class->objs_per_zspage = class->pages_per_zspage * PAGE_SIZE /
+						class->size;
+		INIT_LIST_HEAD(&class->partial);
+		INIT_LIST_HEAD(&class->full);
+	}
+
+	pool->map_buf = kzalloc(nr_cpu_ids * sizeof(void *), GFP_KERNEL);
+	pool->compact_buf = kmalloc(ZS_MAX_ALLOC_SIZE, GFP_KERNEL);
+	if (!pool->map_buf || !pool->compact_buf)
+		goto fail;
+
+	for_each_possible_cpu(cpu) {
+		pool->map_buf[cpu] = kmalloc(ZS_MAX_ALLOC_SIZE, GFP_KERNEL);
+		if (!pool->map_buf[cpu])
+			goto fail;
+	}
+
+	return pool;
+
+fail:
+	zs_destroy_pool(pool);
+	return NULL;
+}
+
+/**
+ * zs_destroy_pool - Free a pool and whatever is still allocated from it.
+ */
+void zs_destroy_pool(struct zs_pool *pool)
+{
+	struct zspage *zspage, *tmp;
+	unsigned int i;
+	int cpu;
+
+	for (i = 0; i < ZS_NR_CLASSES; i++) {
+		struct size_class *class = &pool->classes[i];
+
+		list_for_each_entry_safe(zspage, tmp, &class->partial, list)
+			free_zspage(pool, class, zspage);
+		list_for_each_entry_safe(zspage, tmp, &class->full, list)
+			free_zspage(pool, class, zspage);
+	}
+
+	if (pool->map_buf) {
+		for_each_possible_cpu(cpu)
+			kfree(pool->map_buf[cpu]);
+		kfree(pool->map_buf);
+	}
+	kfree(pool->compact_buf);
+	kfree(pool);
+}
+
+/**
+ * zs_malloc - Allocate an object of given size from pool.
+ * @pool: pool to allocate from
+ * @size: size of object to allocate
+ * @page: page where the object starts
+ * @offset: offset of the object within that page
+ *
+ * On success, <page, offset> identifies the allocated object; map it
+ * with zs_map_object() to access it. The object may extend into the
+ * next page.
+ *
+ * Returns 0 on success, -errno otherwise.
+ */
+int zs_malloc(struct zs_pool *pool, u32 size, struct page **page,
+			u32 *offset, gfp_t flags)
+{
+	struct size_class *class;
+	struct zspage *zspage;
+	unsigned int class_idx, obj;
+
+	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
+		return -EINVAL;
+
+	class_idx = get_class_idx(size);
+	class = &pool->classes[class_idx];
+
+	spin_lock(&class->lock);
+	if (list_empty(&class->partial)) {
+		spin_unlock(&class->lock);
+
+		zspage = alloc_zspage(pool, class, class_idx, flags);
+		if (unlikely(!zspage))
+			return -ENOMEM;
+
+		spin_lock(&class->lock);
+		list_add(&zspage->list, &class->partial);
+		class->nr_zspages++;
+	}
+
+	zspage = list_first_entry(&class->partial, struct zspage, list);
+	obj = take_obj(class, zspage);
+	obj_location(zspage, class, obj, page, offset);
+	spin_unlock(&class->lock);
+
+	return 0;
+}
+
+/**
+ * zs_free - Free an object allocated with zs_malloc().
+ */
+void zs_free(struct zs_pool *pool, struct page *page, u32 offset)
+{
+	struct zspage *zspage = get_zspage(page);
+	struct size_class *class = &pool->classes[zspage->class_idx];
+	int empty;
+
+	spin_lock(&class->lock);
+	empty = put_obj(class, zspage, obj_index(class, page, offset));
+	spin_unlock(&class->lock);
+
+	if (empty)
+		free_zspage(pool, class, zspage);
+}
+
+/**
+ * zs_map_object - Get a pointer to an object.
+ *
+ * Like kmap_atomic(), this must be paired with zs_unmap_object() before
+ * sleeping. Objects crossing a page boundary are copied into a per-cpu
+ * buffer and written back on unmap, so only one such object can be
+ * mapped at a time.
+ */
+void *zs_map_object(struct zs_pool *pool, struct page *page, u32 offset,
+			enum km_type type)
+{
+	struct zspage *zspage = get_zspage(page);
+	u32 size = pool->classes[zspage->class_idx].size;
+	u32 first = PAGE_SIZE - offset;
+	unsigned char *buf, *addr;
+
+	if (offset + size <= PAGE_SIZE)
+		return (unsigned char *)kmap_atomic(page, type) + offset;
+
+	buf = pool->map_buf[get_cpu()];
+
+	addr = kmap_atomic(page, type);
+	memcpy(buf, addr + offset, first);
+	kunmap_atomic(addr, type);
+
+	addr = kmap_atomic(zspage->pages[page->index + 1], type);
+	memcpy(buf + first, addr, size - first);
+	kunmap_atomic(addr, type);
+
+	return buf;
+}
+
+void zs_unmap_object(struct zs_pool *pool, struct page *page, u32 offset,
+			void *obj, enum km_type type)
+{
+	struct zspage *zspage = get_zspage(page);
+	u32 size = pool->classes[zspage->class_idx].size;
+	u32 first = PAGE_SIZE - offset;
+	unsigned char *buf = obj, *addr;
+
+	if (offset + size <= PAGE_SIZE) {
+		kunmap_atomic(obj, type);
+		return;
+	}
+
+	addr = kmap_atomic(page, type);
+	memcpy(addr + offset, buf, first);
+	kunmap_atomic(addr, type);
+
+	addr = kmap_atomic(zspage->pages[page->index + 1], type);
+	memcpy(addr, buf + first, size - first);
+	kunmap_atomic(addr, type);
+
+	put_cpu();
+}
+
+/* Move one object of src, called with class->lock held */
+static int move_obj(struct zs_pool *pool, struct size_class *class,
+			struct zspage *src, unsigned int obj,
+			struct zspage *dst, zs_move_fn move, void *priv)
+{
+	struct page *old_page, *new_page;
+	u32 old_offset, new_offset;
+	unsigned int new_obj;
+	void *addr;
+
+	obj_location(src, class, obj, &old_page, &old_offset);
+
+	new_obj = take_obj(class, dst);
+	obj_location(dst, class, new_obj, &new_page, &new_offset);
+
+	addr = zs_map_object(pool, old_page, old_offset, KM_USER0);
+	memcpy(pool->compact_buf, addr, class->size);
+	zs_unmap_object(pool, old_page, old_offset, addr, KM_USER0);
+
+	addr = zs_map_object(pool, new_page, new_offset, KM_USER0);
+	memcpy(addr, pool->compact_buf, class->size);
+	zs_unmap_object(pool, new_page, new_offset, addr, KM_USER0);
+
+	if (move(priv, pool->compact_buf, old_page, old_offset,
+			new_page, new_offset)) {
+		/* dst had a free object, so it cannot become empty here */
+		put_obj(class, dst, new_obj);
+		return -EBUSY;
+	}
+
+	return put_obj(class, src, obj);
+}
+
+/* The partial zspage, other than skip, with the fewest or most objects */
+static struct zspage *find_partial(struct size_class *class,
+			struct zspage *skip, int fullest)
+{
+	struct zspage *zspage, *found = NULL;
+
+	list_for_each_entry(zspage, &class->partial, list) {
+		if (zspage == skip)
+			continue;
+		if (!found || (fullest ? zspage->inuse > found->inuse :
+					 zspage->inuse < found->inuse))
+			found = zspage;
+	}
+
+	return found;
+}
+
+static unsigned int compact_class(struct zs_pool *pool,
+			struct size_class *class, zs_move_fn move, void *priv,
+			unsigned int budget)
+{
+	struct zspage *src, *dst, *zspage;
+	unsigned int obj, moved = 0;
+	u32 free_objs;
+	int ret;
+
+	spin_lock(&class->lock);
+	while (moved < budget) {
+		src = find_partial(class, NULL, 0);
+		if (!src)
+			break;
+
+		/* Only worth it if src can be emptied into the others */
+		free_objs = 0;
+		list_for_each_entry(zspage, &class->partial, list)
+			if (zspage != src)
+				free_objs += class->objs_per_zspage -
+						zspage->inuse;
+		if (free_objs < src->inuse)
+			break;
+
+		ret = 0;
+		while (!ret && moved < budget) {
+			obj = find_first_bit(src->used, class->objs_per_zspage);
+			dst = find_partial(class, src, 1);
+			if (obj >= class->objs_per_zspage || !dst)
+				break;
+
+			ret = move_obj(pool, class, src, obj, dst, move, priv);
+			if (ret >= 0)
+				moved++;
+		}
+
+		if (ret < 0) {
+			/* Some object is pinned by its user, try again later */
+			break;
+		}
+
+		if (ret > 0) {
+			spin_unlock(&class->lock);
+			free_zspage(pool, class, src);
+			spin_lock(&class->lock);
+		}
+	}
+	spin_unlock(&class->lock);
+
+	return moved;
+}
+
+/**
+ * zs_compact - Move objects out of sparsely used zspages.
+ * @pool: pool to compact
+ * @move: called for every object moved, must update its references
+ * @priv: passed to @move
+ * @budget: maximum number of objects to move
+ *
+ * Callers must serialise zs_compact() on a pool and must keep the objects
+ * from being freed or accessed while it runs. Returns the number of
+ * objects moved.
+ */
+unsigned int zs_compact(struct zs_pool *pool, zs_move_fn move, void *priv,
+			unsigned int budget)
+{
+	unsigned int i, moved = 0;
+
+	for (i = 0; i < ZS_NR_CLASSES && moved < budget; i++)
+		moved += compact_class(pool, &pool->classes[i], move, priv,
+					budget - moved);
+
+	return moved;
+}
+
+u64 zs_get_total_size_bytes(struct zs_pool *pool)
+{
+	return (u64)atomic_read(&pool->total_pages) << PAGE_SHIFT;
+}
+
+unsigned int zs_get_nr_classes(void)
+{
+	return ZS_NR_CLASSES;
+}
+
+int zs_get_class_stats(struct zs_pool *pool, unsigned int class_idx,
+			struct zs_class_stats *stats)
+{
+	struct size_class *class;
+
+	if (class_idx >= ZS_NR_CLASSES)
+		return -EINVAL;
+
+	class = &pool->classes[class_idx];
+
+	spin_lock(&class->lock);
+	stats->size = class->size;
+	stats->pages_per_zspage = class->pages_per_zspage;
+	stats->objs_per_zspage = class->objs_per_zspage;
+	stats->zspages = class->nr_zspages;
+	stats->objs_used = class->objs_used;
+	spin_unlock(&class->lock);
+
+	return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZS_MALLOC_H_
+#define _ZS_MALLOC_H_
+
+#include <linux/types.h>
+#include <linux/highmem.h>
+
+struct zs_pool;
+
+struct zs_class_stats {
+	u32 size;		/* object size of this class */
+	u32 pages_per_zspage;
+	u32 objs_per_zspage;
+	u32 zspages;		/* allocated zspages */
+	u64 objs_used;		/* objects currently allocated */
+};
+
+/*
+ * Called by zs_compact() once an object has been copied to its new
+ * location. obj points to a copy of its contents. Return 0 if all
+ * references were switched to the new location, anything else leaves
+ * the object where it was.
+ */
+typedef int (*zs_move_fn)(void *priv, void *obj,
+			struct page *old_page, u32 old_offset,
+			struct page *new_page, u32 new_offset);
+
+struct zs_pool *zs_create_pool(void);
+void zs_destroy_pool(struct zs_pool *pool);
+
+int zs_malloc(struct zs_pool *pool, u32 size, struct page **page,
+			u32 *offset, gfp_t flags);
+void zs_free(struct zs_pool *pool, struct page *page, u32 offset);
+
+void *zs_map_object(struct zs_pool *pool, struct page *page, u32 offset,
+			enum km_type type);
+void zs_unmap_object(struct zs_pool *pool, struct page *page, u32 offset,
+			void *obj, enum km_type type);
+
+unsigned int zs_compact(struct zs_pool *pool, zs_move_fn move, void *priv,
+			unsigned int budget);
+
+u64 zs_get_total_size_bytes(struct zs_pool *pool);
+unsigned int zs_get_nr_classes(void);
+int zs_get_class_stats(struct zs_pool *pool, unsigned int class,
+			struct zs_class_stats *stats);
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZS_MALLOC_INT_H_
+#define _ZS_MALLOC_INT_H_
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+
+/* User configurable params */
+
+#define ZS_MIN_ALLOC_SIZE	32
+#define ZS_MAX_ALLOC_SIZE	PAGE_SIZE
+
+/* Size classes are separated by ZS_SIZE_CLASS_DELTA bytes */
+#define ZS_SIZE_CLASS_DELTA	16
+#define ZS_NR_CLASSES		((ZS_MAX_ALLOC_SIZE - ZS_MIN_ALLOC_SIZE) \
+					/ ZS_SIZE_CLASS_DELTA + 1)
+
+/*
+ * A zspage is this many 0-order pages at most. More pages waste less
+ * at the end of the zspage but make each zspage harder to empty.
+ */
+#define ZS_MAX_PAGES_PER_ZSPAGE	4
+
+/* End of user params */
+
+#define ZS_MAX_OBJS_PER_ZSPAGE	(ZS_MAX_PAGES_PER_ZSPAGE * PAGE_SIZE \
+					/ ZS_MIN_ALLOC_SIZE)
+
+/*
+ * Objects of one class packed back to back over a few pages, possibly
+ * across page boundaries. Each page points back to its zspage through
+ * page_private() and knows its position through page->index.
+ */
+struct zspage {
+	struct list_head list;		/* in class partial or full list */
+	struct page *pages[ZS_MAX_PAGES_PER_ZSPAGE];
+	u16 inuse;
+	u16 class_idx;
+	DECLARE_BITMAP(used, ZS_MAX_OBJS_PER_ZSPAGE);
+};
+
+struct size_class {
+	spinlock_t lock;
+	u32 size;
+	u16 pages_per_zspage;
+	u16 objs_per_zspage;
+	struct list_head partial;	/* zspages with free objects */
+	struct list_head full;
+	u32 nr_zspages;
+	u64 objs_used;
+};
+
+struct zs_pool {
+	struct size_class classes[ZS_NR_CLASSES];
+	atomic_t total_pages;
+
+	/* Objects crossing a page boundary are mapped through these */
+	void **map_buf;		/* one page per possible cpu */
+	void *compact_buf;	/* zs_compact() callers are serialised */
+};
+
+#endif
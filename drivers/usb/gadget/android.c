@@ -19,8 +19,11 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/fs.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
 #include <linux/kernel.h>
+#include <linux/seq_file.h>
 #include <linux/utsname.h>
 #include <linux/platform_device.h>
 #include <linux/pm_qos.h>
@@ -134,6 +137,10 @@ struct android_usb_function {
 	int (*ctrlrequest)(struct android_usb_function *,
 					struct usb_composite_dev *,
 					const struct usb_ctrlrequest *);
+
+	/* Time taken by the last bind_config and unbind_config, in us */
+	unsigned int bind_us;
+	unsigned int unbind_us;
 };
 
 struct android_usb_function_holder {
@@ -183,6 +190,9 @@ struct android_usb_function_holder {
 * @list_item: This driver supports more than one android gadget device (for
 *    example in order to support multiple USB cores), therefore this is
 *    a item in a linked list of android devices.
+* @stop_us: Time taken by the last disconnect and configuration teardown.
+* @start_us: Time taken by the last configuration setup and connect.
+* @switches: Number of function changes made while enabled.
 */
 struct android_dev {
 	const char *name;
@@ -209,6 +219,10 @@ struct android_dev {
 
 	/* A list node inside the android_dev_list */
 	struct list_head list_item;
+
+	unsigned int stop_us;
+	unsigned int start_us;
+	unsigned int switches;
 };
 
 struct android_configuration {
@@ -1903,7 +1917,10 @@ android_bind_enabled_functions(struct android_dev *dev,
 	int ret;
 
 	list_for_each_entry(f_holder, &conf->enabled_functions, enabled_list) {
+		ktime_t start = ktime_get();
+
 		ret = f_holder->f->bind_config(f_holder->f, c);
+		f_holder->f->bind_us = ktime_us_delta(ktime_get(), start);
 		if (ret) {
 			pr_err("%s: %s failed", __func__, f_holder->f->name);
 			return ret;
@@ -1921,8 +1938,11 @@ android_unbind_enabled_functions(struct android_dev *dev,
 		container_of(c, struct android_configuration, usb_config);
 
 	list_for_each_entry(f_holder, &conf->enabled_functions, enabled_list) {
+		ktime_t start = ktime_get();
+
 		if (f_holder->f->unbind_config)
 			f_holder->f->unbind_config(f_holder->f, c);
+		f_holder->f->unbind_us = ktime_us_delta(ktime_get(), start);
 	}
 }
 
@@ -2030,6 +2050,62 @@ functions_show(struct device *pdev, struct device_attribute *attr, char *buf)
 	return buff - buf;
 }
 
+/* Bind the enabled functions and connect. Must hold dev->mutex */
+static void android_gadget_start(struct android_dev *dev)
+{
+	struct usb_composite_dev *cdev = dev->cdev;
+	struct android_usb_function_holder *f_holder;
+	struct android_configuration *conf;
+	bool audio_enabled = false;
+	ktime_t start = ktime_get();
+
+	/*
+	 * Update values in composite driver's copy of
+	 * device descriptor.
+	 */
+	cdev->desc.idVendor = device_desc.idVendor;
+	cdev->desc.idProduct = device_desc.idProduct;
+	cdev->desc.bcdDevice = device_desc.bcdDevice;
+	cdev->desc.bDeviceClass = device_desc.bDeviceClass;
+	cdev->desc.bDeviceSubClass = device_desc.bDeviceSubClass;
+	cdev->desc.bDeviceProtocol = device_desc.bDeviceProtocol;
+
+	/* Audio dock accessory is unable to enumerate device if
+	 * pull-up is enabled immediately. The enumeration is
+	 * reliable with 100 msec delay.
+	 */
+	list_for_each_entry(conf, &dev->configs, list_item)
+		list_for_each_entry(f_holder, &conf->enabled_functions,
+					enabled_list) {
+			if (f_holder->f->enable)
+				f_holder->f->enable(f_holder->f);
+			if (!strncmp(f_holder->f->name,
+					"audio_source", 12))
+				audio_enabled = true;
+		}
+	if (audio_enabled)
+		msleep(100);
+	android_enable(dev);
+	dev->start_us = ktime_us_delta(ktime_get(), start);
+}
+
+/* Disconnect and unbind the enabled functions. Must hold dev->mutex */
+static void android_gadget_stop(struct android_dev *dev)
+{
+	struct android_usb_function_holder *f_holder;
+	struct android_configuration *conf;
+	ktime_t start = ktime_get();
+
+	android_disable(dev);
+	list_for_each_entry(conf, &dev->configs, list_item)
+		list_for_each_entry(f_holder, &conf->enabled_functions,
+					enabled_list) {
+			if (f_holder->f->disable)
+				f_holder->f->disable(f_holder->f);
+		}
+	dev->stop_us = ktime_us_delta(ktime_get(), start);
+}
+
 static ssize_t
 functions_store(struct device *pdev, struct device_attribute *attr,
 			       const char *buff, size_t size)
@@ -2041,14 +2117,19 @@ functions_store(struct device *pdev, struct device_attribute *attr,
 	struct android_usb_function_holder *f_holder;
 	char *name;
 	char buf[256], *b;
+	bool enabled;
 	int err;
 
 	mutex_lock(&dev->mutex);
 
-	if (dev->enabled) {
-		mutex_unlock(&dev->mutex);
-		return -EBUSY;
-	}
+	/*
+	 * Changing the functions of an enabled gadget switches over in
+	 * one soft reconnect, rather than user space disabling it,
+	 * writing the functions and enabling it again.
+	 */
+	enabled = dev->enabled;
+	if (enabled)
+		android_gadget_stop(dev);
 
 	/* Clear previous enabled list */
 	list_for_each_entry(conf, &dev->configs, list_item) {
@@ -2099,6 +2180,11 @@ functions_store(struct device *pdev, struct device_attribute *attr,
 		free_android_config(dev, conf);
 	}
 
+	if (enabled) {
+		android_gadget_start(dev);
+		dev->switches++;
+	}
+
 	mutex_unlock(&dev->mutex);
 
 	return size;
@@ -2117,10 +2203,7 @@ static ssize_t enable_store(struct device *pdev, struct device_attribute *attr,
 {
 	struct android_dev *dev = dev_get_drvdata(pdev);
 	struct usb_composite_dev *cdev = dev->cdev;
-	struct android_usb_function_holder *f_holder;
-	struct android_configuration *conf;
 	int enabled = 0;
-	bool audio_enabled = false;
 	static DEFINE_RATELIMIT_STATE(rl, 10*HZ, 1);
 
 
@@ -2131,42 +2214,10 @@ static ssize_t enable_store(struct device *pdev, struct device_attribute *attr,
 
 	sscanf(buff, "%d", &enabled);
 	if (enabled && !dev->enabled) {
-		/*
-		 * Update values in composite driver's copy of
-		 * device descriptor.
-		 */
-		cdev->desc.idVendor = device_desc.idVendor;
-		cdev->desc.idProduct = device_desc.idProduct;
-		cdev->desc.bcdDevice = device_desc.bcdDevice;
-		cdev->desc.bDeviceClass = device_desc.bDeviceClass;
-		cdev->desc.bDeviceSubClass = device_desc.bDeviceSubClass;
-		cdev->desc.bDeviceProtocol = device_desc.bDeviceProtocol;
-
-		/* Audio dock accessory is unable to enumerate device if
-		 * pull-up is enabled immediately. The enumeration is
-		 * reliable with 100 msec delay.
-		 */
-		list_for_each_entry(conf, &dev->configs, list_item)
-			list_for_each_entry(f_holder, &conf->enabled_functions,
-						enabled_list) {
-				if (f_holder->f->enable)
-					f_holder->f->enable(f_holder->f);
-				if (!strncmp(f_holder->f->name,
-						"audio_source", 12))
-					audio_enabled = true;
-			}
-		if (audio_enabled)
-			msleep(100);
-		android_enable(dev);
+		android_gadget_start(dev);
 		dev->enabled = true;
 	} else if (!enabled && dev->enabled) {
-		android_disable(dev);
-		list_for_each_entry(conf, &dev->configs, list_item)
-			list_for_each_entry(f_holder, &conf->enabled_functions,
-						enabled_list) {
-				if (f_holder->f->disable)
-					f_holder->f->disable(f_holder->f);
-			}
+		android_gadget_stop(dev);
 		dev->enabled = false;
 	} else if (__ratelimit(&rl)) {
 		pr_err("android_usb: already %s\n",
@@ -2789,6 +2840,61 @@ static struct platform_driver android_platform_driver = {
 	.id_table = android_id_table,
 };
 
+#if defined(CONFIG_DEBUG_FS)
+static struct dentry *android_debugfs_dent;
+
+static int android_timings_show(struct seq_file *m, void *unused)
+{
+	struct android_usb_function **functions = supported_functions;
+	struct android_usb_function *f;
+	struct android_dev *dev;
+
+	list_for_each_entry(dev, &android_dev_list, list_item) {
+		mutex_lock(&dev->mutex);
+		seq_printf(m, "%s: stop %u us, start %u us, %u switches\n",
+			   dev->name, dev->stop_us, dev->start_us,
+			   dev->switches);
+		mutex_unlock(&dev->mutex);
+	}
+
+	seq_printf(m, "%-16s %10s %10s\n", "function", "bind_us",
+		   "unbind_us");
+	while ((f = *functions++))
+		seq_printf(m, "%-16s %10u %10u\n", f->name, f->bind_us,
+			   f->unbind_us);
+	return 0;
+}
+
+static int android_timings_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, android_timings_show, NULL);
+}
+
+static const struct file_operations android_timings_fops = {
+	.open		= android_timings_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void android_debugfs_init(void)
+{
+	android_debugfs_dent = debugfs_create_dir("android_usb", 0);
+	if (IS_ERR_OR_NULL(android_debugfs_dent))
+		return;
+	debugfs_create_file("timings", 0444, android_debugfs_dent, NULL,
+			    &android_timings_fops);
+}
+
+static void android_debugfs_remove(void)
+{
+	debugfs_remove_recursive(android_debugfs_dent);
+}
+#else
+static inline void android_debugfs_init(void) {}
+static inline void android_debugfs_remove(void) {}
+#endif
+
 static int __init init(void)
 {
 	int ret;
@@ -2806,14 +2912,17 @@ static int __init init(void)
 	if (ret) {
 		pr_err("%s(): Failed to register android"
 				 "platform driver\n", __func__);
+		return ret;
 	}
 
-	return ret;
+	android_debugfs_init();
+	return 0;
 }
 module_init(init);
 
 static void __exit cleanup(void)
 {
+	android_debugfs_remove();
 	platform_driver_unregister(&android_platform_driver);
 }
 module_exit(cleanup);
@@ -55,6 +55,17 @@ static char *rmnet_data_ch = CONFIG_RMNET_SMD_DATA_CHANNEL;
 module_param(rmnet_data_ch, charp, S_IRUGO);
 MODULE_PARM_DESC(rmnet_data_ch, "RmNet data SMD channel");
 
+/* Batch the modem interrupts for data fifo updates while data is flowing */
+static unsigned rmnet_data_coalesce_bytes = 4096;
+module_param(rmnet_data_coalesce_bytes, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rmnet_data_coalesce_bytes,
+		"Bytes moved before the modem is interrupted, 0 disables");
+
+static unsigned rmnet_data_coalesce_usecs = 500;
+module_param(rmnet_data_coalesce_usecs, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rmnet_data_coalesce_usecs,
+		"Longest delay of a batched modem interrupt");
+
 #define RMNET_SMD_ACM_CTRL_DTR	(1 << 0)
 
 #define RMNET_SMD_NOTIFY_INTERVAL	5
@@ -648,47 +659,85 @@ static void rmnet_smd_start_rx(struct rmnet_smd_dev *dev)
 	spin_unlock_irqrestore(&dev->lock, flags);
 }
 
+/* Copy one packet from the data fifo straight into the request buffer */
+static int rmnet_smd_read_pkt(struct smd_channel *ch, void *buf, int sz)
+{
+	void *ptr;
+	int len, n = 0;
+
+	while (n < sz) {
+		len = smd_read_reserve(ch, &ptr);
+		if (len <= 0)
+			break;
+		len = min(len, sz - n);
+		memcpy(buf + n, ptr, len);
+		smd_read_commit(ch, len);
+		n += len;
+	}
+
+	return n;
+}
+
 static void rmnet_data_tx_tlet(unsigned long arg)
 {
 	struct rmnet_smd_dev *dev = (struct rmnet_smd_dev *) arg;
 	struct usb_composite_dev *cdev = dev->cdev;
 	struct usb_request *req;
+	struct list_head *pos, *tmp;
+	LIST_HEAD(pool);
+	unsigned long sent = 0;
 	int status;
 	int sz;
 	unsigned long flags;
 
-	while (1) {
+	/* Take all idle requests at once rather than one lock per packet */
+	spin_lock_irqsave(&dev->lock, flags);
+	list_splice_init(&dev->tx_idle, &pool);
+	spin_unlock_irqrestore(&dev->lock, flags);
 
+	if (list_empty(&pool)) {
+		DBG(cdev, "rmnet data Tx buffers full\n");
+		return;
+	}
+
+	while (!list_empty(&pool)) {
 		sz = smd_cur_packet_size(dev->smd_data.ch);
 		if (sz == 0)
 			break;
 		if (smd_read_avail(dev->smd_data.ch) < sz)
 			break;
 
-		spin_lock_irqsave(&dev->lock, flags);
-		if (list_empty(&dev->tx_idle)) {
-			spin_unlock_irqrestore(&dev->lock, flags);
-			DBG(cdev, "rmnet data Tx buffers full\n");
-			break;
+		req = list_first_entry(&pool, struct usb_request, list);
+		if (sz > RMNET_TX_REQ_SIZE) {
+			ERROR(cdev, "rmnet tx data packet too big %d\n", sz);
+			/* drain the packet so the channel does not stall */
+			while (sz > 0) {
+				status = rmnet_smd_read_pkt(dev->smd_data.ch,
+					req->buf, min(sz, RMNET_TX_REQ_SIZE));
+				if (status <= 0)
+					break;
+				sz -= status;
+			}
+			continue;
 		}
-		req = list_first_entry(&dev->tx_idle, struct usb_request, list);
-		list_del(&req->list);
-		spin_unlock_irqrestore(&dev->lock, flags);
 
-		req->length = smd_read(dev->smd_data.ch, req->buf, sz);
+		list_del(&req->list);
+		req->length = rmnet_smd_read_pkt(dev->smd_data.ch, req->buf, sz);
 		status = usb_ep_queue(dev->epin, req, GFP_ATOMIC);
 		if (status) {
 			ERROR(cdev, "rmnet tx data enqueue err %d\n", status);
-			spin_lock_irqsave(&dev->lock, flags);
-			list_add_tail(&req->list, &dev->tx_idle);
-			spin_unlock_irqrestore(&dev->lock, flags);
+			list_add(&req->list, &pool);
 			break;
 		}
-		spin_lock_irqsave(&dev->lock, flags);
-		dev->dpkts_from_modem++;
-		spin_unlock_irqrestore(&dev->lock, flags);
+		sent++;
 	}
 
+	spin_lock_irqsave(&dev->lock, flags);
+	/* completions may have returned requests meanwhile, keep them after */
+	list_for_each_safe(pos, tmp, &pool)
+		list_move_tail(pos, &dev->tx_idle);
+	dev->dpkts_from_modem += sent;
+	spin_unlock_irqrestore(&dev->lock, flags);
 }
 
 static void rmnet_data_rx_tlet(unsigned long arg)
@@ -927,6 +976,8 @@ static void rmnet_smd_connect_work(struct work_struct *w)
 	}
 	wait_event(dev->smd_data.wait, test_bit(CH_OPENED,
 				&dev->smd_data.flags));
+	smd_set_coalesce(dev->smd_data.ch, rmnet_data_coalesce_bytes,
+			rmnet_data_coalesce_usecs);
 
 	atomic_set(&dev->online, 1);
 	/* Queue Rx data requests */
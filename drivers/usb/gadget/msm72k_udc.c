@@ -75,6 +75,16 @@ static const char *const ep_name[] = {
 /*To release the wakelock from debugfs*/
 static int release_wlocks;
 
+/* Interrupt threshold in micro frames (0, 1, 2, 4, 8, 16, 32 or 64) */
+static unsigned int itc;
+module_param(itc, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(itc, "interrupt threshold control, in micro frames");
+
+/* Only the last IN dTD primed in one go raises a completion interrupt */
+static unsigned int ioc_batch = 1;
+module_param(ioc_batch, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(ioc_batch, "interrupt once per batch of IN transfers");
+
 struct msm_request {
 	struct usb_request req;
 
@@ -121,6 +131,12 @@ struct msm_endpoint {
 	unsigned actual_prime_fail_count;
 	unsigned long dTD_workaround_fail_count;
 
+	/* completion stats */
+	unsigned long primes;
+	unsigned long irqs;
+	unsigned long completions;
+	unsigned long max_batch;
+
 	unsigned wedged:1;
 	/* pointers to DMA transfer list area */
 	/* these are allocated from the usb_info dma space */
@@ -661,14 +677,21 @@ static void usb_ept_start(struct msm_endpoint *ept)
 	struct usb_info *ui = ept->ui;
 	struct msm_request *req = ept->req;
 	unsigned n = 1 << ept->bit;
+	unsigned ioc;
 
 	BUG_ON(req->live);
 
+	/* OUT transfers may end early on a short packet and the host may
+	 * then wait for us, so every OUT dTD still interrupts
+	 */
+	ioc = (ioc_batch && (ept->flags & EPT_FLAG_IN) && ept->num) ?
+		0 : INFO_IOC;
+
 	while (req) {
 		req->live = 1;
 		/* prepare the transaction descriptor item for the hardware */
-		req->item->info =
-			INFO_BYTES(req->req.length) | INFO_IOC | INFO_ACTIVE;
+		req->item->info = INFO_BYTES(req->req.length) | INFO_ACTIVE |
+			(req->next ? ioc : INFO_IOC);
 		req->item->page0 = req->dma;
 		req->item->page1 = (req->dma + 0x1000) & 0xfffff000;
 		req->item->page2 = (req->dma + 0x2000) & 0xfffff000;
@@ -697,6 +720,7 @@ static void usb_ept_start(struct msm_endpoint *ept)
 	 * but it leads to high cpu usage.
 	 */
 	writel_relaxed(n, USB_ENDPTPRIME);
+	ept->primes++;
 	mod_timer(&ept->prime_timer, EPT_PRIME_CHECK_DELAY);
 }
 
@@ -1147,6 +1171,49 @@ ack:
 	ep0_setup_ack(ui);
 }
 
+/* Complete the request at the head of the endpoint queue. Called with
+ * ui->lock held, which is dropped around the gadget's completion callback.
+ */
+static void ept_retire_req(struct msm_endpoint *ept, struct msm_request *req,
+			   unsigned info, unsigned long *flags)
+{
+	struct usb_info *ui = ept->ui;
+
+	del_timer(&ept->prime_timer);
+	/* advance ept queue to the next request */
+	ept->req = req->next;
+	if (ept->req == 0)
+		ept->last = 0;
+
+	dma_unmap_single(NULL, req->dma, req->req.length,
+			 (ept->flags & EPT_FLAG_IN) ?
+			 DMA_TO_DEVICE : DMA_FROM_DEVICE);
+
+	if (info & (INFO_HALTED | INFO_BUFFER_ERROR | INFO_TXN_ERROR)) {
+		/* XXX pass on more specific error code */
+		req->req.status = -EIO;
+		req->req.actual = 0;
+		dev_err(&ui->pdev->dev,
+			"ept %d %s error. info=%08x\n",
+		       ept->num,
+		       (ept->flags & EPT_FLAG_IN) ? "in" : "out",
+		       info);
+	} else {
+		req->req.status = 0;
+		req->req.actual =
+			req->req.length - ((info >> 16) & 0x7FFF);
+	}
+	req->busy = 0;
+	req->live = 0;
+	ept->completions++;
+
+	if (req->req.complete) {
+		spin_unlock_irqrestore(&ui->lock, *flags);
+		req->req.complete(&ept->ep, &req->req);
+		spin_lock_irqsave(&ui->lock, *flags);
+	}
+}
+
 static void handle_endpoint(struct usb_info *ui, unsigned bit)
 {
 	struct msm_endpoint *ept = ui->ept + bit;
@@ -1155,6 +1222,7 @@ static void handle_endpoint(struct usb_info *ui, unsigned bit)
 	int req_dequeue = 1;
 	int dtd_update_fail_count_chk = 10;
 	int check_bit = 0;
+	unsigned long batch = 0;
 	unsigned info;
 
 	/*
@@ -1165,6 +1233,7 @@ static void handle_endpoint(struct usb_info *ui, unsigned bit)
 
 	/* expire all requests that are no longer active */
 	spin_lock_irqsave(&ui->lock, flags);
+	ept->irqs++;
 	while ((req = ept->req)) {
 		/* if we've processed all live requests, time to
 		 * restart the hardware on the next non-live request
@@ -1202,39 +1271,11 @@ dequeue:
 		}
 		req_dequeue = 0;
 
-		del_timer(&ept->prime_timer);
-		/* advance ept queue to the next request */
-		ept->req = req->next;
-		if (ept->req == 0)
-			ept->last = 0;
-
-		dma_unmap_single(NULL, req->dma, req->req.length,
-				 (ept->flags & EPT_FLAG_IN) ?
-				 DMA_TO_DEVICE : DMA_FROM_DEVICE);
-
-		if (info & (INFO_HALTED | INFO_BUFFER_ERROR | INFO_TXN_ERROR)) {
-			/* XXX pass on more specific error code */
-			req->req.status = -EIO;
-			req->req.actual = 0;
-			dev_err(&ui->pdev->dev,
-				"ept %d %s error. info=%08x\n",
-			       ept->num,
-			       (ept->flags & EPT_FLAG_IN) ? "in" : "out",
-			       info);
-		} else {
-			req->req.status = 0;
-			req->req.actual =
-				req->req.length - ((info >> 16) & 0x7FFF);
-		}
-		req->busy = 0;
-		req->live = 0;
-
-		if (req->req.complete) {
-			spin_unlock_irqrestore(&ui->lock, flags);
-			req->req.complete(&ept->ep, &req->req);
-			spin_lock_irqsave(&ui->lock, flags);
-		}
+		ept_retire_req(ept, req, info, &flags);
+		batch++;
 	}
+	if (batch > ept->max_batch)
+		ept->max_batch = batch;
 	spin_unlock_irqrestore(&ui->lock, flags);
 }
 
@@ -1474,8 +1515,10 @@ static void usb_reset(struct usb_info *ui)
 	else
 		otg->reset(ui->xceiv, 1);
 
-	/* set usb controller interrupt threshold to zero*/
-	writel((readl(USB_USBCMD) & ~USBCMD_ITC_MASK) | USBCMD_ITC(0),
+	/* set usb controller interrupt threshold */
+	if (itc > 64 || (itc & (itc - 1)))
+		itc = 0;
+	writel((readl(USB_USBCMD) & ~USBCMD_ITC_MASK) | USBCMD_ITC(itc),
 							USB_USBCMD);
 
 	writel(ui->dma, USB_ENDPOINTLISTADDR);
@@ -2081,6 +2124,61 @@ const struct file_operations prime_fail_ops = {
 	.write = debug_reprime_ep,
 };
 
+static ssize_t debug_ept_stats_read(struct file *file, char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	struct usb_info *ui = file->private_data;
+	char *buf = debug_buffer;
+	unsigned long flags;
+	struct msm_endpoint *ept;
+	int n;
+	int i = 0;
+
+	spin_lock_irqsave(&ui->lock, flags);
+	for (n = 0; n < 32; n++) {
+		ept = ui->ept + n;
+		if (ept->ep.maxpacket == 0)
+			continue;
+
+		i += scnprintf(buf + i, PAGE_SIZE - i,
+			"ept%d %s primes=%lu irqs=%lu completions=%lu "
+					"max_batch=%lu\n",
+			ept->num, (ept->flags & EPT_FLAG_IN) ? "in " : "out",
+			ept->primes, ept->irqs, ept->completions,
+			ept->max_batch);
+	}
+	spin_unlock_irqrestore(&ui->lock, flags);
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, i);
+}
+
+static ssize_t debug_ept_stats_reset(struct file *file,
+			const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct usb_info *ui = file->private_data;
+	unsigned long flags;
+	struct msm_endpoint *ept;
+	int n;
+
+	spin_lock_irqsave(&ui->lock, flags);
+	for (n = 0; n < 32; n++) {
+		ept = ui->ept + n;
+		ept->primes = 0;
+		ept->irqs = 0;
+		ept->completions = 0;
+		ept->max_batch = 0;
+	}
+	spin_unlock_irqrestore(&ui->lock, flags);
+
+	return count;
+}
+
+const struct file_operations debug_ept_stats_ops = {
+	.open = debug_open,
+	.read = debug_ept_stats_read,
+	.write = debug_ept_stats_reset,
+};
+
 static ssize_t debug_prop_chg_write(struct file *file,
 		const char __user *buf, size_t count, loff_t *ppos)
 {
@@ -2145,6 +2243,8 @@ static void usb_debugfs_init(struct usb_info *ui)
 						&prime_fail_ops);
 	debugfs_create_file("proprietary_chg", 0666, dent, ui,
 						&debug_prop_chg_ops);
+	debugfs_create_file("ept_stats", 0644, dent, ui,
+						&debug_ept_stats_ops);
 }
 #else
 static void usb_debugfs_init(struct usb_info *ui) {}
@@ -2263,6 +2363,20 @@ static int msm72k_dequeue(struct usb_ep *_ep, struct usb_request *_req)
 			udelay(100);
 	} while (readl(USB_ENDPTSTAT) & (1 << ep->bit));
 
+	/* requests ahead of this one may have finished without raising an
+	 * interrupt; complete them now rather than reprime them below
+	 */
+	while ((temp_req = ep->req) && temp_req != req && temp_req->live) {
+		dma_coherent_post_ops();
+		if (temp_req->item->info & INFO_ACTIVE)
+			break;
+		ept_retire_req(ep, temp_req, temp_req->item->info, &flags);
+	}
+	if (!req->busy) {
+		spin_unlock_irqrestore(&ui->lock, flags);
+		return 0;
+	}
+
 	req->req.status = 0;
 	req->busy = 0;
 
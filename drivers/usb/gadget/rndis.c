@@ -1040,28 +1040,62 @@ static rndis_resp_t *rndis_add_response(int configNr, u32 length)
 	return r;
 }
 
+/*
+ * One transfer may carry several REMOTE_NDIS_PACKET_MSGs back to back, up
+ * to the MaxPacketsPerTransfer we announced; all but the last are queued
+ * as clones of the transfer's skb.
+ */
 int rndis_rm_hdr(struct gether *port,
 			struct sk_buff *skb,
 			struct sk_buff_head *list)
 {
+	struct sk_buff *skb2;
+	u32 msg_len, data_offset, data_len;
 	/* tmp points to a struct rndis_packet_msg_type */
-	__le32 *tmp = (void *)skb->data;
+	__le32 *tmp;
 
-	/* MessageType, MessageLength */
-	if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
-			!= get_unaligned(tmp++)) {
-		dev_kfree_skb_any(skb);
-		return -EINVAL;
-	}
-	tmp++;
+	for (;;) {
+		tmp = (void *)skb->data;
+		if (skb->len < sizeof(struct rndis_packet_msg_type)) {
+			dev_kfree_skb_any(skb);
+			return -EINVAL;
+		}
+
+		/* MessageType, MessageLength */
+		if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
+				!= get_unaligned(tmp++)) {
+			dev_kfree_skb_any(skb);
+			return -EINVAL;
+		}
+		msg_len = get_unaligned_le32(tmp++);
+
+		/* DataOffset, DataLength */
+		data_offset = get_unaligned_le32(tmp++) + 8;
+		data_len = get_unaligned_le32(tmp++);
+		if (msg_len > skb->len || data_offset > msg_len ||
+				data_len > msg_len - data_offset) {
+			dev_kfree_skb_any(skb);
+			return -EOVERFLOW;
+		}
+
+		/* the last message may be followed by padding only */
+		if (skb->len - msg_len < sizeof(struct rndis_packet_msg_type))
+			break;
+
+		skb2 = skb_clone(skb, GFP_ATOMIC);
+		if (!skb2) {
+			dev_kfree_skb_any(skb);
+			return -ENOMEM;
+		}
+		skb_pull(skb2, data_offset);
+		skb_trim(skb2, data_len);
+		skb_queue_tail(list, skb2);
 
-	/* DataOffset, DataLength */
-	if (!skb_pull(skb, get_unaligned_le32(tmp++) + 8)) {
-		dev_kfree_skb_any(skb);
-		return -EOVERFLOW;
+		skb_pull(skb, msg_len);
 	}
-	skb_trim(skb, get_unaligned_le32(tmp++));
 
+	skb_pull(skb, data_offset);
+	skb_trim(skb, data_len);
 	skb_queue_tail(list, skb);
 	return 0;
 }
@@ -233,7 +233,8 @@ static struct fsg_lun *fsg_lun_from_dev(struct device *dev)
 #define DELAYED_STATUS	(EP0_BUFSIZE + 999)	/* An impossibly large value */
 
 #ifdef CONFIG_USB_CSW_HACK
-#define fsg_num_buffers		4
+/* The early CSW waits for all buffers to drain; use at least 4 of them */
+#define fsg_num_buffers		max(CONFIG_USB_GADGET_STORAGE_NUM_BUFFERS, 4)
 #else
 #ifdef CONFIG_USB_GADGET_DEBUG_FILES
 
@@ -255,10 +256,10 @@ MODULE_PARM_DESC(num_buffers, "Number of pipeline buffers");
 /* check if fsg_num_buffers is within a valid range */
 static inline int fsg_num_buffers_validate(void)
 {
-	if (fsg_num_buffers >= 2 && fsg_num_buffers <= 4)
+	if (fsg_num_buffers >= 2 && fsg_num_buffers <= 32)
 		return 0;
 	pr_err("fsg_num_buffers %u is out of range (%d to %d)\n",
-	       fsg_num_buffers, 2 ,4);
+	       fsg_num_buffers, 2, 32);
 	return -EINVAL;
 }
 
@@ -722,6 +723,15 @@ static int fsg_lun_open(struct fsg_lun *curlun, const char *filename)
 		goto out;
 	}
 
+	/*
+	 * The host mostly streams large sequential reads, open up the
+	 * readahead window as POSIX_FADV_SEQUENTIAL would so the medium
+	 * is read ahead of the next READ command.
+	 */
+	spin_lock(&filp->f_lock);
+	filp->f_ra.ra_pages = filp->f_mapping->backing_dev_info->ra_pages * 2;
+	spin_unlock(&filp->f_lock);
+
 	get_file(filp);
 	curlun->ro = ro;
 	curlun->filp = filp;
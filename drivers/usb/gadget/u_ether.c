@@ -19,6 +19,7 @@
 #include <linux/ctype.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
+#include <linux/hrtimer.h>
 
 #include "u_ether.h"
 
@@ -66,6 +67,7 @@ struct eth_dev {
 	int			no_tx_req_used;
 	int			tx_skb_hold_count;
 	u32			tx_req_bufsize;
+	struct hrtimer		tx_timer;	/* sends a held multi packet req */
 
 	struct sk_buff_head	rx_frames;
 
@@ -95,6 +97,20 @@ static unsigned qmult = 10;
 module_param(qmult, uint, S_IRUGO|S_IWUSR);
 MODULE_PARM_DESC(qmult, "queue length multiplier at high/super speed");
 
+static unsigned tx_aggr_max = TX_SKB_HOLD_THRESHOLD;
+module_param(tx_aggr_max, uint, S_IRUGO);
+MODULE_PARM_DESC(tx_aggr_max, "max packets per multi packet tx transfer");
+
+static unsigned tx_aggr_timeout_us = 500;
+module_param(tx_aggr_timeout_us, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(tx_aggr_timeout_us,
+		"max time a partly filled tx transfer is held, 0 for no limit");
+
+/* room one packet takes in a multi packet tx transfer */
+#define TX_PKT_LEN(net)	((net)->mtu + sizeof(struct ethhdr) \
+				/* size of rndis_packet_msg_type */ \
+				+ 44 + 22)
+
 /* for dual-speed hardware, use deeper queues at high/super speed */
 static inline int qlen(struct usb_gadget *gadget)
 {
@@ -230,6 +246,9 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 */
 	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
 	size += dev->port_usb->header_len;
+	/* room for every packet the host may bundle in one transfer */
+	if (dev->port_usb->ul_max_pkts_per_xfer > 1)
+		size *= dev->port_usb->ul_max_pkts_per_xfer;
 	size += out->maxpacket - 1;
 	size -= size % out->maxpacket;
 
@@ -471,15 +490,81 @@ static void eth_work(struct work_struct *work)
 		DBG(dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
+/* Queue the partly filled multi packet request at the head of tx_reqs */
+static void tx_send_held(struct eth_dev *dev)
+{
+	struct usb_request	*req;
+	struct usb_ep		*in;
+	unsigned long		flags;
+	int			length;
+	int			retval;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (!dev->port_usb || list_empty(&dev->tx_reqs)) {
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		return;
+	}
+	req = container_of(dev->tx_reqs.next, struct usb_request, list);
+	if (!req->length) {
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		return;
+	}
+	list_del(&req->list);
+	dev->tx_skb_hold_count = 0;
+	in = dev->port_usb->in_ep;
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	length = req->length;
+
+	/* NCM requires no zlp if transfer is dwNtbInMaxSize */
+	if (dev->port_usb->is_fixed &&
+		length == dev->port_usb->fixed_in_len &&
+		(length % in->maxpacket) == 0)
+		req->zero = 0;
+	else
+		req->zero = 1;
+
+	/* use zlp framing on tx for strict CDC-Ether conformance,
+	 * though any robust network rx path ignores extra padding.
+	 * and some hardware doesn't like to write zlps.
+	 */
+	if (req->zero && !dev->zlp && (length % in->maxpacket) == 0) {
+		req->zero = 0;
+		length++;
+	}
+
+	req->length = length;
+	retval = usb_ep_queue(in, req, GFP_ATOMIC);
+	switch (retval) {
+	default:
+		DBG(dev, "tx queue err %d\n", retval);
+		dev->net->stats.tx_dropped++;
+		spin_lock_irqsave(&dev->req_lock, flags);
+		req->length = 0;
+		list_add_tail(&req->list, &dev->tx_reqs);
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		break;
+	case 0:
+		spin_lock_irqsave(&dev->req_lock, flags);
+		dev->no_tx_req_used++;
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		dev->net->trans_start = jiffies;
+	}
+}
+
+static enum hrtimer_restart tx_timer_expired(struct hrtimer *timer)
+{
+	struct eth_dev	*dev = container_of(timer, struct eth_dev, tx_timer);
+
+	tx_send_held(dev);
+	return HRTIMER_NORESTART;
+}
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
 	struct eth_dev	*dev;
 	struct net_device *net;
-	struct usb_request *new_req;
-	struct usb_ep *in;
-	int length;
-	int retval;
 
 	if (!ep->driver_data) {
 		usb_ep_free_request(ep, req);
@@ -516,56 +601,10 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 	if (dev->port_usb->multi_pkt_xfer) {
 		dev->no_tx_req_used--;
 		req->length = 0;
-		in = dev->port_usb->in_ep;
+		spin_unlock(&dev->req_lock);
 
-		if (!list_empty(&dev->tx_reqs)) {
-			new_req = container_of(dev->tx_reqs.next,
-					struct usb_request, list);
-			list_del(&new_req->list);
-			spin_unlock(&dev->req_lock);
-			if (new_req->length > 0) {
-				length = new_req->length;
-
-				/* NCM requires no zlp if transfer is
-				 * dwNtbInMaxSize */
-				if (dev->port_usb->is_fixed &&
-					length == dev->port_usb->fixed_in_len &&
-					(length % in->maxpacket) == 0)
-					new_req->zero = 0;
-				else
-					new_req->zero = 1;
-
-				/* use zlp framing on tx for strict CDC-Ether
-				 * conformance, though any robust network rx
-				 * path ignores extra padding. and some hardware
-				 * doesn't like to write zlps.
-				 */
-				if (new_req->zero && !dev->zlp &&
-						(length % in->maxpacket) == 0) {
-					new_req->zero = 0;
-					length++;
-				}
-
-				new_req->length = length;
-				retval = usb_ep_queue(in, new_req, GFP_ATOMIC);
-				switch (retval) {
-				default:
-					DBG(dev, "tx queue err %d\n", retval);
-					break;
-				case 0:
-					spin_lock(&dev->req_lock);
-					dev->no_tx_req_used++;
-					spin_unlock(&dev->req_lock);
-					net->trans_start = jiffies;
-				}
-			} else {
-				spin_lock(&dev->req_lock);
-				list_add(&new_req->list, &dev->tx_reqs);
-				spin_unlock(&dev->req_lock);
-			}
-		} else {
-			spin_unlock(&dev->req_lock);
-		}
+		/* one finished, so the held request can go out */
+		tx_send_held(dev);
 	} else {
 		spin_unlock(&dev->req_lock);
 		dev_kfree_skb_any(skb);
@@ -585,12 +624,7 @@ static void alloc_tx_buffer(struct eth_dev *dev)
 	struct list_head	*act;
 	struct usb_request	*req;
 
-	dev->tx_req_bufsize = (TX_SKB_HOLD_THRESHOLD *
-				(dev->net->mtu
-				+ sizeof(struct ethhdr)
-				/* size of rndis_packet_msg_type */
-				+ 44
-				+ 22));
+	dev->tx_req_bufsize = max(tx_aggr_max, 1U) * TX_PKT_LEN(dev->net);
 
 	list_for_each(act, &dev->tx_reqs) {
 		req = container_of(act, struct usb_request, list);
@@ -699,10 +733,21 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		dev_kfree_skb_any(skb);
 
 		spin_lock_irqsave(&dev->req_lock, flags);
-		if (dev->tx_skb_hold_count < TX_SKB_HOLD_THRESHOLD) {
+		if (dev->tx_skb_hold_count < tx_aggr_max &&
+		    length + TX_PKT_LEN(net) <= dev->tx_req_bufsize &&
+		    (!dev->port_usb->dl_max_xfer_size ||
+		     length + TX_PKT_LEN(net) <= dev->port_usb->dl_max_xfer_size)) {
 			if (dev->no_tx_req_used > TX_REQ_THRESHOLD) {
 				list_add(&req->list, &dev->tx_reqs);
 				spin_unlock_irqrestore(&dev->req_lock, flags);
+
+				/* bound the wait for the next completion */
+				if (tx_aggr_timeout_us &&
+				    !hrtimer_active(&dev->tx_timer))
+					hrtimer_start(&dev->tx_timer,
+						ns_to_ktime(tx_aggr_timeout_us *
+							NSEC_PER_USEC),
+						HRTIMER_MODE_REL);
 				goto success;
 			}
 		}
@@ -962,6 +1007,8 @@ int gether_setup_name(struct usb_gadget *g, u8 ethaddr[ETH_ALEN],
 	INIT_WORK(&dev->rx_work, process_rx_w);
 	INIT_LIST_HEAD(&dev->tx_reqs);
 	INIT_LIST_HEAD(&dev->rx_reqs);
+	hrtimer_init(&dev->tx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dev->tx_timer.function = tx_timer_expired;
 
 	skb_queue_head_init(&dev->rx_frames);
 
@@ -1136,6 +1183,7 @@ void gether_disconnect(struct gether *link)
 
 	netif_stop_queue(dev->net);
 	netif_carrier_off(dev->net);
+	hrtimer_cancel(&dev->tx_timer);
 
 	/* disable endpoints, forcing (synchronous) completion
 	 * of all pending i/o.  then free the request objects
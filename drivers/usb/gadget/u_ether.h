@@ -56,6 +56,10 @@ struct gether {
 /* Max number of SKB packets to be used to create Multi Packet RNDIS */
 #define TX_SKB_HOLD_THRESHOLD		3
 	bool				multi_pkt_xfer;
+	/* largest transfer the host takes, 0 when it did not say */
+	u32				dl_max_xfer_size;
+	/* packets the host may bundle into one OUT transfer */
+	u32				ul_max_pkts_per_xfer;
 	struct sk_buff			*(*wrap)(struct gether *port,
 						struct sk_buff *skb);
 	int				(*unwrap)(struct gether *port,
@@ -1897,6 +1897,7 @@ irqreturn_t mdp_isr(int irq, void *ptr)
 	struct mdp_hist_mgmt *mgmt = NULL;
 	int i, ret;
 	int vsync_isr, disabled_clocks;
+	int chained;
 	/* Ensure all the register write are complete */
 	mb();
 
@@ -2060,6 +2061,13 @@ irqreturn_t mdp_isr(int irq, void *ptr)
 #ifdef	CONFIG_FB_MSM_MDP31
 		MDP_OUTP(MDP_BASE + 0x00100, 0xFFFF);
 #endif
+		/* start the next blit of a batch, if any */
+		spin_lock_irqsave(&mdp_spin_lock, flag);
+		chained = mdp_ppp_waiting && mdp_ppp_batch_next();
+		spin_unlock_irqrestore(&mdp_spin_lock, flag);
+		if (chained)
+			goto out;
+
 		mdp_pipe_ctrl(MDP_PPP_BLOCK, MDP_BLOCK_POWER_OFF, TRUE);
 		spin_lock_irqsave(&mdp_spin_lock, flag);
 		if (mdp_ppp_waiting) {
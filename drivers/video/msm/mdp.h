@@ -745,6 +745,27 @@ void mdp_set_dma_pan_info(struct fb_info *info, struct mdp_dirty_region *dirty,
 void mdp_dma_pan_update(struct fb_info *info);
 void mdp_refresh_screen(unsigned long data);
 int mdp_ppp_blit(struct fb_info *info, struct mdp_blit_req *req);
+#ifdef CONFIG_FB_MSM_MDP31
+void mdp_ppp_outp(unsigned char *addr, uint32 data);
+#define MDP_PPP_OUTP(addr, data) mdp_ppp_outp((addr), (uint32)(data))
+int mdp_ppp_batch_begin(struct msm_fb_data_type *mfd);
+int mdp_ppp_batch_end(void);
+int mdp_ppp_batch_next(void);
+#else
+#define MDP_PPP_OUTP(addr, data) MDP_OUTP((addr), (data))
+static inline int mdp_ppp_batch_begin(struct msm_fb_data_type *mfd)
+{
+	return -ENODEV;
+}
+static inline int mdp_ppp_batch_end(void)
+{
+	return 0;
+}
+static inline int mdp_ppp_batch_next(void)
+{
+	return 0;
+}
+#endif
 void mdp_lcd_update_workqueue_handler(struct work_struct *work);
 void mdp_vsync_resync_workqueue_handler(struct work_struct *work);
 void mdp_dma2_update(struct msm_fb_data_type *mfd);
@@ -401,11 +401,14 @@ struct mdp4_statistic {
 	ulong kickoff_dmap;
 	ulong kickoff_dmae;
 	ulong kickoff_dmas;
+	ulong kickoff_cursor;
 	ulong blt_dsi_cmd;	/* blt */
 	ulong blt_dsi_video;	/* blt */
 	ulong blt_lcdc;	/* blt */
 	ulong blt_dtv;	/* blt */
 	ulong blt_mddi;	/* blt */
+	ulong static_screen;
+	ulong blend_cached[MDP4_MIXER_MAX];
 	ulong overlay_set[MDP4_MIXER_MAX];
 	ulong overlay_unset[MDP4_MIXER_MAX];
 	ulong overlay_play[MDP4_MIXER_MAX];
@@ -582,6 +585,7 @@ int mdp4_overlay_dsi_state_get(void);
 void mdp4_overlay_rgb_setup(struct mdp4_overlay_pipe *pipe);
 void mdp4_overlay_reg_flush(struct mdp4_overlay_pipe *pipe, int all);
 void mdp4_mixer_blend_setup(int mixer);
+void mdp4_mixer_blend_cache_reset(int mixer);
 void mdp4_mixer_blend_cfg(int);
 struct mdp4_overlay_pipe *mdp4_overlay_stage_pipe(int mixer, int stage);
 void mdp4_mixer_stage_up(struct mdp4_overlay_pipe *pipe, int commit);
@@ -602,6 +606,8 @@ int mdp4_overlay_play_wait(struct fb_info *info,
 	struct msmfb_overlay_data *req);
 int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req);
 int mdp4_overlay_commit(struct fb_info *info);
+int mdp4_overlay_play_list(struct fb_info *info,
+		struct msmfb_overlay_data *req, int cnt, int commit);
 struct mdp4_overlay_pipe *mdp4_overlay_pipe_alloc(int ptype, int mixer);
 void mdp4_overlay_dma_commit(int mixer);
 void mdp4_overlay_vsync_commit(struct mdp4_overlay_pipe *pipe);
@@ -1000,6 +1006,7 @@ int mdp4_calc_blt_mdp_bw(struct msm_fb_data_type *mfd,
 int mdp4_overlay_mdp_perf_req(struct msm_fb_data_type *mfd,
 				struct mdp4_overlay_pipe *plist);
 void mdp4_overlay_mdp_perf_upd(struct msm_fb_data_type *mfd, int flag);
+void mdp4_overlay_mdp_perf_static(struct msm_fb_data_type *mfd, int enable);
 int mdp4_update_base_blend(struct msm_fb_data_type *mfd,
 				struct mdp_blend_cfg *mdp_blend_cfg);
 int mdp4_update_writeback_format(struct msm_fb_data_type *mfd,
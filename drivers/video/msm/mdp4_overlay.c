@@ -48,11 +48,26 @@
 static struct msm_fb_data_type *mdp4_mfd;
 #endif
 
+/* Everything of a staged pipe mdp4_mixer_blend_setup() depends on */
+struct mdp4_blend_key {
+	u32 pipe_ndx;
+	u32 src_format;
+	u32 alpha;
+	u32 alpha_enable;
+	u32 is_fg;
+	u32 transp;
+	u32 flags;
+	u32 op_mode;
+};
+
 struct mdp4_overlay_ctrl {
 	struct mdp4_overlay_pipe plist[OVERLAY_PIPE_MAX];
 	struct mdp4_overlay_pipe *stage[MDP4_MIXER_MAX][MDP4_MIXER_STAGE_MAX];
 	struct mdp4_overlay_pipe *baselayer[MDP4_MIXER_MAX];
 	struct blend_cfg blend[MDP4_MIXER_MAX][MDP4_MIXER_STAGE_MAX];
+	struct mdp4_blend_key blend_key[MDP4_MIXER_MAX][MDP4_MIXER_STAGE_MAX];
+	uint32 blend_key_op[MDP4_MIXER_MAX];
+	int blend_key_valid[MDP4_MIXER_MAX];
 	struct mdp4_overlay_pipe sf_plist[MDP4_MIXER_MAX][OVERLAY_PIPE_MAX];
 	struct mdp_mixer_cfg mdp_mixer_cfg[MDP4_MIXER_MAX];
 	uint32 mixer_cfg[MDP4_MIXER_MAX];
@@ -123,6 +138,10 @@ struct mdp4_overlay_perf {
 struct mdp4_overlay_perf perf_request;
 struct mdp4_overlay_perf perf_current;
 
+/* static screen bus vote in place, see mdp4_overlay_mdp_perf_static() */
+static int perf_static;
+static DEFINE_MUTEX(perf_static_mutex);
+
 static struct ion_client *display_iclient;
 
 static void mdp4_overlay_bg_solidfill(struct blend_cfg *blend);
@@ -2105,6 +2124,56 @@ void mdp4_mixer_blend_cfg(int mixer)
 	}
 }
 
+void mdp4_mixer_blend_cache_reset(int mixer)
+{
+	int i;
+
+	for (i = 0; i < MDP4_MIXER_MAX; i++) {
+		if (mixer < 0 || mixer == i)
+			ctrl->blend_key_valid[i] = 0;
+	}
+}
+
+/*
+ * Returns 1 if the layer stack of the mixer blends exactly like the one
+ * last programmed, otherwise records the new stack and returns 0.
+ */
+static int mdp4_mixer_blend_cached(int mixer)
+{
+	struct mdp4_blend_key key[MDP4_MIXER_STAGE_MAX];
+	struct mdp4_overlay_pipe *pipe;
+	uint32 base_op;
+	int i;
+
+	memset(key, 0, sizeof(key));
+	for (i = MDP4_MIXER_STAGE_BASE; i < MDP4_MIXER_STAGE_MAX; i++) {
+		pipe = ctrl->stage[mixer][i];
+		if (pipe == NULL)
+			continue;
+		key[i].pipe_ndx = pipe->pipe_ndx;
+		key[i].src_format = pipe->src_format;
+		key[i].alpha = pipe->alpha;
+		key[i].alpha_enable = pipe->alpha_enable;
+		key[i].is_fg = pipe->is_fg;
+		key[i].transp = pipe->transp;
+		key[i].flags = pipe->flags & MDP_BLEND_FG_PREMULT;
+		key[i].op_mode = pipe->op_mode & (MDP4_OP_SCALEX_EN |
+			MDP4_OP_SCALEY_EN | MDP4_OP_SCALEX_PIXEL_RPT |
+			MDP4_OP_SCALEY_PIXEL_RPT);
+	}
+	base_op = ctrl->blend[mixer][MDP4_MIXER_STAGE_BASE].op;
+
+	if (ctrl->blend_key_valid[mixer] &&
+		ctrl->blend_key_op[mixer] == base_op &&
+		!memcmp(ctrl->blend_key[mixer], key, sizeof(key)))
+		return 1;
+
+	memcpy(ctrl->blend_key[mixer], key, sizeof(key));
+	ctrl->blend_key_op[mixer] = base_op;
+	ctrl->blend_key_valid[mixer] = 1;
+	return 0;
+}
+
 /*
  * D(i+1) = Ks * S + Kd * D(i)
  */
@@ -2124,6 +2193,20 @@ void mdp4_mixer_blend_setup(int mixer)
 		return;
 	}
 
+	if (mdp4_mixer_blend_cached(mixer)) {
+		/* pipe setup rewrote the format, solid fill has to follow */
+		mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_ON, FALSE);
+		blend = &ctrl->blend[mixer][MDP4_MIXER_STAGE0];
+		for (i = MDP4_MIXER_STAGE0; i < MDP4_MIXER_STAGE_MAX; i++) {
+			if (blend->solidfill_pipe)
+				mdp4_overlay_bg_solidfill(blend);
+			blend++;
+		}
+		mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_OFF, FALSE);
+		mdp4_stat.blend_cached[mixer]++;
+		return;
+	}
+
 	blend = &ctrl->blend[mixer][MDP4_MIXER_STAGE0];
 	base_premulti = ctrl->blend[mixer][MDP4_MIXER_STAGE_BASE].op &
 		MDP4_BLEND_FG_ALPHA_BG_CONST;
@@ -3049,6 +3132,10 @@ void mdp4_overlay_mdp_perf_upd(struct msm_fb_data_type *mfd,
 	if (!mdp4_extn_disp)
 		perf_cur->use_ov_blt[1] = 0;
 
+	/* new frame, leave the static screen vote before anything else */
+	if (flag && perf_static)
+		mdp4_overlay_mdp_perf_static(mfd, 0);
+
 	if (flag) {
 		if (perf_req->mdp_clk_rate > perf_cur->mdp_clk_rate) {
 			mdp_set_core_clk(perf_req->mdp_clk_rate);
@@ -3170,6 +3257,36 @@ void mdp4_overlay_mdp_perf_upd(struct msm_fb_data_type *mfd,
 	return;
 }
 
+/*
+ * Called by msm_fb once no new frame arrived for a while.  The mdp keeps
+ * fetching the same layers at the same rate, so the average vote stays,
+ * but the instantaneous headroom (MDP4_BW_IB_FACTOR) only covers frame
+ * updates and pipe reconfiguration.  Drop ib to the ab level until the
+ * next perf update restores the current vote.
+ */
+void mdp4_overlay_mdp_perf_static(struct msm_fb_data_type *mfd, int enable)
+{
+	struct mdp4_overlay_perf *perf_cur = &perf_current;
+
+	mutex_lock(&perf_static_mutex);
+	if (enable == perf_static || !perf_cur->mdp_ab_bw)
+		goto out;
+
+	if (enable)
+		mdp_bus_scale_update_request(perf_cur->mdp_ab_bw,
+			perf_cur->mdp_ab_bw);
+	else
+		mdp_bus_scale_update_request(perf_cur->mdp_ab_bw,
+			perf_cur->mdp_ib_bw);
+
+	pr_debug("%s: static screen %d ab=%d ib=%d\n", __func__, enable,
+		perf_cur->mdp_ab_bw, perf_cur->mdp_ib_bw);
+	perf_static = enable;
+	mdp4_stat.static_screen += enable;
+out:
+	mutex_unlock(&perf_static_mutex);
+}
+
 static int get_img(struct msmfb_data *img, struct fb_info *info,
 	struct mdp4_overlay_pipe *pipe, unsigned int plane,
 	unsigned long *start, unsigned long *len, struct file **srcp_file,
@@ -3526,45 +3643,26 @@ void mdp4_overlay_vsync_commit(struct mdp4_overlay_pipe *pipe)
 	mdp4_mixer_stage_up(pipe, 0);
 }
 
-int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
+/*
+ * Latch the buffer addresses of @req into @pipe.  Called with ov_mutex
+ * held; nothing reaches the hardware until the pipe is queued.
+ */
+static int mdp4_overlay_play_setup(struct fb_info *info,
+		struct mdp4_overlay_pipe *pipe, struct msmfb_overlay_data *req)
 {
-	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
 	struct msmfb_data *img;
-	struct mdp4_overlay_pipe *pipe;
 	ulong start, addr;
 	ulong len = 0;
 	struct ion_handle *srcp0_ihdl = NULL;
 	struct ion_handle *srcp1_ihdl = NULL, *srcp2_ihdl = NULL;
 	uint32_t overlay_version = 0;
-	int ret = 0;
-
-	if (mfd == NULL)
-		return -ENODEV;
-
-	if (!mfd->panel_power_on) /* suspended */
-		return -EPERM;
-
-	pipe = mdp4_overlay_ndx2pipe(req->id);
-	if (pipe == NULL) {
-		mdp4_stat.err_play++;
-		return -ENODEV;
-	}
-
-	if (pipe->pipe_type == OVERLAY_TYPE_BF) {
-		mdp4_overlay_borderfill_stage_up(pipe);
-		mdp4_mixer_stage_commit(pipe->mixer_num);
-		return 0;
-	}
-
-	mutex_lock(&mfd->dma->ov_mutex);
 
 	img = &req->data;
 	get_img(img, info, pipe, 0, &start, &len, &pipe->srcp0_file,
 		&pipe->put0_need, &srcp0_ihdl);
 	if (len == 0) {
 		pr_err("%s: pmem Error\n", __func__);
-		ret = -1;
-		goto end;
+		return -1;
 	}
 
 	addr = start + img->offset;
@@ -3587,8 +3685,7 @@ int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
 				&srcp1_ihdl);
 			if (len == 0) {
 				pr_err("%s: Error to get plane1\n", __func__);
-				ret = -EINVAL;
-				goto end;
+				return -EINVAL;
 			}
 			pipe->srcp1_addr = start + img->offset;
 		} else if (pipe->frame_format ==
@@ -3621,8 +3718,7 @@ int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
 				&srcp1_ihdl);
 			if (len == 0) {
 				pr_err("%s: Error to get plane1\n", __func__);
-				ret = -EINVAL;
-				goto end;
+				return -EINVAL;
 			}
 			pipe->srcp1_addr = start + img->offset;
 
@@ -3632,8 +3728,7 @@ int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
 				&srcp2_ihdl);
 			if (len == 0) {
 				pr_err("%s: Error to get plane2\n", __func__);
-				ret = -EINVAL;
-				goto end;
+				return -EINVAL;
 			}
 			pipe->srcp2_addr = start + img->offset;
 		} else {
@@ -3668,8 +3763,11 @@ int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
 		}
 	}
 
-	mdp4_overlay_mdp_perf_req(mfd, ctrl->plist);
+	return 0;
+}
 
+static void mdp4_overlay_pipe_queue(struct mdp4_overlay_pipe *pipe)
+{
 	if (pipe->mixer_num == MDP4_MIXER0) {
 		if (ctrl->panel_mode & MDP4_PANEL_DSI_CMD) {
 			/* cndx = 0 */
@@ -3695,28 +3793,49 @@ int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
 			mdp4_wfd_pipe_queue(0, pipe);/* cndx = 0 */
 	}
 
-	mutex_unlock(&mfd->dma->ov_mutex);
-	return ret;
-
-end:
-	mutex_unlock(&mfd->dma->ov_mutex);
-
-	return ret;
 }
 
-int mdp4_overlay_commit(struct fb_info *info)
+int mdp4_overlay_play(struct fb_info *info, struct msmfb_overlay_data *req)
 {
-	int ret = 0;
 	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+	struct mdp4_overlay_pipe *pipe;
+	int ret;
 
 	if (mfd == NULL)
 		return -ENODEV;
 
 	if (!mfd->panel_power_on) /* suspended */
-		return -EINVAL;
+		return -EPERM;
+
+	pipe = mdp4_overlay_ndx2pipe(req->id);
+	if (pipe == NULL) {
+		mdp4_stat.err_play++;
+		return -ENODEV;
+	}
+
+	if (pipe->pipe_type == OVERLAY_TYPE_BF) {
+		mdp4_overlay_borderfill_stage_up(pipe);
+		mdp4_mixer_stage_commit(pipe->mixer_num);
+		return 0;
+	}
 
 	mutex_lock(&mfd->dma->ov_mutex);
 
+	ret = mdp4_overlay_play_setup(info, pipe, req);
+	if (ret == 0) {
+		mdp4_overlay_mdp_perf_req(mfd, ctrl->plist);
+		mdp4_overlay_pipe_queue(pipe);
+	}
+
+	mutex_unlock(&mfd->dma->ov_mutex);
+
+	return ret;
+}
+
+static int mdp4_overlay_commit_locked(struct msm_fb_data_type *mfd)
+{
+	int ret = 0;
+
 	mdp4_overlay_mdp_perf_upd(mfd, 1);
 
 	msm_fb_wait_for_fence(mfd);
@@ -3738,7 +3857,7 @@ int mdp4_overlay_commit(struct fb_info *info)
 		mdp4_dtv_pipe_commit(0, 1);
 		break;
 	case WRITEBACK_PANEL:
-		mdp4_wfd_pipe_commit(mfd, 0, 1);
+		mdp4_wfd_pipe_commit(mfd, 0, 0);
 		break;
 	default:
 		pr_err("Panel Not Supported for Commit");
@@ -3749,6 +3868,82 @@ int mdp4_overlay_commit(struct fb_info *info)
 
 	mdp4_overlay_mdp_perf_upd(mfd, 0);
 
+	return ret;
+}
+
+int mdp4_overlay_commit(struct fb_info *info)
+{
+	int ret;
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+
+	if (mfd == NULL)
+		return -ENODEV;
+
+	if (!mfd->panel_power_on) /* suspended */
+		return -EINVAL;
+
+	mutex_lock(&mfd->dma->ov_mutex);
+	ret = mdp4_overlay_commit_locked(mfd);
+	mutex_unlock(&mfd->dma->ov_mutex);
+
+	return ret;
+}
+
+/*
+ * Play a whole frame worth of layers with a single call, optionally
+ * committing it as well.  Every buffer is latched first and bandwidth is
+ * requested once for the resulting pipe set; only then are the pipes
+ * staged and queued, so a bad layer leaves the previous frame untouched
+ * and the frame reaches the mixer with one flush.
+ */
+int mdp4_overlay_play_list(struct fb_info *info,
+		struct msmfb_overlay_data *req, int cnt, int commit)
+{
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+	struct mdp4_overlay_pipe *pipe[MDP_OVERLAY_LIST_MAX];
+	int i, ret = 0;
+
+	if (mfd == NULL)
+		return -ENODEV;
+
+	if (!mfd->panel_power_on) /* suspended */
+		return -EPERM;
+
+	if (cnt <= 0 || cnt > MDP_OVERLAY_LIST_MAX)
+		return -EINVAL;
+
+	mutex_lock(&mfd->dma->ov_mutex);
+
+	for (i = 0; i < cnt; i++) {
+		pipe[i] = mdp4_overlay_ndx2pipe(req[i].id);
+		if (pipe[i] == NULL) {
+			mdp4_stat.err_play++;
+			ret = -ENODEV;
+			goto end;
+		}
+
+		if (pipe[i]->pipe_type == OVERLAY_TYPE_BF)
+			continue;
+
+		ret = mdp4_overlay_play_setup(info, pipe[i], &req[i]);
+		if (ret)
+			goto end;
+	}
+
+	mdp4_overlay_mdp_perf_req(mfd, ctrl->plist);
+
+	for (i = 0; i < cnt; i++) {
+		if (pipe[i]->pipe_type == OVERLAY_TYPE_BF) {
+			mdp4_overlay_borderfill_stage_up(pipe[i]);
+			mdp4_mixer_stage_commit(pipe[i]->mixer_num);
+			continue;
+		}
+		mdp4_overlay_pipe_queue(pipe[i]);
+	}
+
+	if (commit)
+		ret = mdp4_overlay_commit_locked(mfd);
+end:
 	mutex_unlock(&mfd->dma->ov_mutex);
 
 	return ret;
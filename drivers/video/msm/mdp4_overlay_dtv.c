@@ -705,9 +705,11 @@ int mdp4_dtv_off(struct platform_device *pdev)
 	atomic_set(&vctrl->vsync_resume, 0);
 
 	/* wait for one vsycn time to make sure
-	 * previous stage_commit had been kicked in
+	 * previous stage_commit had been kicked in; with the timing
+	 * generator not started yet no commit can be pending
 	 */
-	msleep(20);     /* >= 17 ms */
+	if (dtv_enabled)
+		msleep(20);     /* >= 17 ms */
 
 	complete_all(&vctrl->vsync_comp);
 
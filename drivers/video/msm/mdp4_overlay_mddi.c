@@ -56,8 +56,13 @@ static struct vsycn_ctrl {
 	atomic_t suspend;
 	int wait_vsync_cnt;
 	int blt_change;
+	int roi_change;
+	uint32 roi_xy;
+	uint32 roi_w;
+	uint32 roi_h;
 	int blt_free;
 	int blt_end;
+	int cursor_pending;
 	int sysfs_created;
 	struct mutex update_lock;
 	struct completion ov_comp;
@@ -147,6 +152,38 @@ static void mdp4_mddi_blt_dmap_update(struct mdp4_overlay_pipe *pipe)
 static void mdp4_mddi_wait4dmap(int cndx);
 static void mdp4_mddi_wait4ov(int cndx);
 
+/*
+ * Resend the frame currently on screen so that a cursor change reaches
+ * the panel.  Nothing is queued or staged, pipes, mixer and dma_p keep
+ * their programming and the engine is only started again.  In blt mode
+ * the last composed frame is still in the writeback buffer, so only
+ * dmap runs; it is accounted as an overlay pass that has already
+ * completed to keep the ov and dmap counters in step.
+ * Called with vctrl->spin_lock held.
+ */
+static void mdp4_mddi_cursor_kick(struct vsycn_ctrl *vctrl,
+				  struct mdp4_overlay_pipe *pipe)
+{
+	vctrl->cursor_pending = 0;
+	vctrl->pan_display++;
+	if (pipe->ov_blt_addr) {
+		pipe->dmap_cnt--;	/* buffer sent last */
+		mdp4_mddi_blt_dmap_update(pipe);
+		pipe->dmap_cnt++;
+		vctrl->ov_koff++;
+		vctrl->ov_done++;
+	}
+	INIT_COMPLETION(vctrl->dmap_comp);
+	vsync_irq_enable(INTR_DMA_P_DONE, MDP_DMAP_TERM);
+	vctrl->dmap_koff++;
+	mdp4_stat.kickoff_cursor++;
+	if (pipe->ov_blt_addr)
+		outpdw(MDP_BASE + 0x000c, 0); /* kickoff dmap engine */
+	else
+		outpdw(MDP_BASE + 0x0004, 0); /* kickoff overlay engine */
+	mb(); /* make sure kickoff executed */
+}
+
 static void mdp4_mddi_do_blt(struct msm_fb_data_type *mfd, int enable)
 {
 	unsigned long flags;
@@ -330,10 +367,13 @@ int mdp4_mddi_pipe_commit(int cndx, int wait)
 		}
 	}
 
-	if (vctrl->blt_change) {
+	if (vctrl->blt_change || vctrl->roi_change) {
 		mdp4_overlayproc_cfg(pipe);
 		mdp4_overlay_dmap_xy(pipe);
+		/* partial update, place the roi on the panel */
+		MDP_OUTP(MDP_BASE + 0x90010, vctrl->roi_xy);
 		vctrl->blt_change = 0;
+		vctrl->roi_change = 0;
 	}
 
 	pipe = vp->plist;
@@ -568,6 +608,10 @@ void mdp4_dmap_done_mddi(int cndx)
 	if (diff <= 0) {
 		if (vctrl->blt_wait)
 			vctrl->blt_wait = 0;
+		/* a cursor change came in while this frame was sent */
+		if (vctrl->cursor_pending && vctrl->ov_koff == vctrl->ov_done &&
+		    !atomic_read(&vctrl->suspend))
+			mdp4_mddi_cursor_kick(vctrl, pipe);
 		spin_unlock(&vctrl->spin_lock);
 		return;
 	}
@@ -795,13 +839,40 @@ void mdp4_mddi_base_swap(int cndx, struct mdp4_overlay_pipe *pipe)
 	vctrl->base_pipe = pipe;
 }
 
+/*
+ * The mixer roi follows the base layer, so the transfer can only be cut
+ * down to the dirty region while nothing is staged on top of it (the
+ * other pipes are positioned relative to the roi) and the overlay is in
+ * direct out mode (the writeback buffer is sized for the full frame).
+ */
+static int mdp4_mddi_partial_ok(struct mdp4_overlay_pipe *pipe)
+{
+	int i;
+
+#ifdef CONFIG_MACH_GLACIER
+	/* base layer may be flipped, see mdp4_overlay_rgb_setup() */
+	return 0;
+#endif
+	if (pipe->is_3d || pipe->ov_blt_addr)
+		return 0;
+
+	for (i = MDP4_MIXER_STAGE0; i < MDP4_MIXER_STAGE_MAX; i++) {
+		if (mdp4_overlay_stage_pipe(pipe->mixer_num, i))
+			return 0;
+	}
+
+	return 1;
+}
+
 static void mdp4_overlay_setup_pipe_addr(struct msm_fb_data_type *mfd,
 			struct mdp4_overlay_pipe *pipe)
 {
 	MDPIBUF *iBuf = &mfd->ibuf;
+	struct vsycn_ctrl *vctrl = &vsync_ctrl_db[0];
 	struct fb_info *fbi;
 	int bpp;
 	uint8 *src;
+	uint32 roi_xy = 0;
 
 	/* whole screen for base layer */
 	src = (uint8 *) iBuf->buf;
@@ -826,12 +897,37 @@ static void mdp4_overlay_setup_pipe_addr(struct msm_fb_data_type *mfd,
 		pipe->dst_h = fbi->var.yres;
 		pipe->dst_w = fbi->var.xres;
 		pipe->srcp0_ystride = fbi->fix.line_length;
+
+		if ((iBuf->dma_w != fbi->var.xres ||
+			iBuf->dma_h != fbi->var.yres) &&
+			mdp4_mddi_partial_ok(pipe)) {
+			bpp = fbi->var.bits_per_pixel / 8;
+			src += iBuf->dma_x * bpp +
+				iBuf->dma_y * pipe->srcp0_ystride;
+			pipe->src_height = iBuf->dma_h;
+			pipe->src_width = iBuf->dma_w;
+			pipe->src_h = iBuf->dma_h;
+			pipe->src_w = iBuf->dma_w;
+			pipe->dst_h = iBuf->dma_h;
+			pipe->dst_w = iBuf->dma_w;
+			roi_xy = (iBuf->dma_y << 16) | iBuf->dma_x;
+		}
 	}
 	pipe->src_y = 0;
 	pipe->src_x = 0;
 	pipe->dst_y = 0;
 	pipe->dst_x = 0;
 	pipe->srcp0_addr = (uint32)src;
+
+	/* reprogram the mixer and dma_p whenever the roi moves or resizes */
+	if (roi_xy != vctrl->roi_xy ||
+		pipe->src_width != vctrl->roi_w ||
+		pipe->src_height != vctrl->roi_h) {
+		vctrl->roi_xy = roi_xy;
+		vctrl->roi_w = pipe->src_width;
+		vctrl->roi_h = pipe->src_height;
+		vctrl->roi_change++;
+	}
 }
 
 void mdp4_overlay_update_mddi(struct msm_fb_data_type *mfd)
@@ -1031,6 +1127,7 @@ int mdp4_mddi_off(struct platform_device *pdev)
 	need_wait = 0;
 	mutex_lock(&vctrl->update_lock);
 	atomic_set(&vctrl->suspend, 1);
+	vctrl->cursor_pending = 0;
 
 	complete_all(&vctrl->vsync_comp);
 
@@ -1106,13 +1203,34 @@ void mdp_mddi_overlay_suspend(struct msm_fb_data_type *mfd)
 	}
 }
 
+/* called with vctrl->update_lock held */
+static void mdp4_mddi_clk_on(struct vsycn_ctrl *vctrl)
+{
+	unsigned long flags;
+	int clk_set_on = 0;
+
+	spin_lock_irqsave(&vctrl->spin_lock, flags);
+	vctrl->clk_control = 0;
+	if (!vctrl->clk_enabled) {
+		clk_set_on = 1;
+		vctrl->clk_enabled = 1;
+		vctrl->expire_tick = VSYNC_EXPIRE_TICK;
+	}
+	spin_unlock_irqrestore(&vctrl->spin_lock, flags);
+
+	if (clk_set_on) {
+		pr_debug("%s: SET_CLK_ON\n", __func__);
+		mdp_clk_ctrl(1);
+		vsync_irq_enable(INTR_PRIMARY_RDPTR, MDP_PRIM_RDPTR_TERM);
+	}
+}
+
 void mdp4_mddi_overlay(struct msm_fb_data_type *mfd)
 {
 	int cndx = 0;
 	struct vsycn_ctrl *vctrl;
 	struct mdp4_overlay_pipe *pipe;
 	unsigned long flags;
-	int clk_set_on = 0;
 
 	mutex_lock(&mfd->dma->ov_mutex);
 	vctrl = &vsync_ctrl_db[cndx];
@@ -1138,20 +1256,9 @@ void mdp4_mddi_overlay(struct msm_fb_data_type *mfd)
 	}
 
 	spin_lock_irqsave(&vctrl->spin_lock, flags);
-	vctrl->clk_control = 0;
 	vctrl->pan_display++;
-	if (!vctrl->clk_enabled) {
-		clk_set_on = 1;
-		vctrl->clk_enabled = 1;
-		vctrl->expire_tick = VSYNC_EXPIRE_TICK;
-	}
 	spin_unlock_irqrestore(&vctrl->spin_lock, flags);
-
-	if (clk_set_on) {
-		pr_debug("%s: SET_CLK_ON\n", __func__);
-		mdp_clk_ctrl(1);
-		vsync_irq_enable(INTR_PRIMARY_RDPTR, MDP_PRIM_RDPTR_TERM);
-	}
+	mdp4_mddi_clk_on(vctrl);
 
 	mutex_unlock(&vctrl->update_lock);
 
@@ -1167,14 +1274,47 @@ void mdp4_mddi_overlay(struct msm_fb_data_type *mfd)
 	mutex_unlock(&mfd->dma->ov_mutex);
 }
 
+/*
+ * The cursor is blended by dma_p, so a cursor update never has to go
+ * through pipe queue and commit: the registers are written and the
+ * current frame is sent again.  Updates arriving while a transfer is in
+ * flight are collapsed into one resend from the dmap done interrupt,
+ * which keeps mouse movement at no more than one transfer per frame.
+ */
 int mdp4_mddi_overlay_cursor(struct fb_info *info, struct fb_cursor *cursor)
 {
 	struct msm_fb_data_type *mfd = info->par;
+	struct vsycn_ctrl *vctrl = &vsync_ctrl_db[0];
+	struct mdp4_overlay_pipe *pipe;
+	unsigned long flags;
 
 	mutex_lock(&mfd->dma->ov_mutex);
-	if (mfd && mfd->panel_power_on) {
-		mdp_hw_cursor_update(info, cursor);
+	if (!mfd->panel_power_on)
+		goto out;
+
+	if (mdp_hw_cursor_update(info, cursor))
+		goto out;
+
+	pipe = vctrl->base_pipe;
+	if (pipe == NULL)
+		goto out;
+
+	mutex_lock(&vctrl->update_lock);
+	if (atomic_read(&vctrl->suspend)) {
+		mutex_unlock(&vctrl->update_lock);
+		goto out;
 	}
+	mdp4_mddi_clk_on(vctrl);
+
+	spin_lock_irqsave(&vctrl->spin_lock, flags);
+	if (vctrl->dmap_koff != vctrl->dmap_done ||
+	    vctrl->ov_koff != vctrl->ov_done)
+		vctrl->cursor_pending = 1;
+	else
+		mdp4_mddi_cursor_kick(vctrl, pipe);
+	spin_unlock_irqrestore(&vctrl->spin_lock, flags);
+	mutex_unlock(&vctrl->update_lock);
+out:
 	mutex_unlock(&mfd->dma->ov_mutex);
 	return 0;
 }
@@ -62,6 +62,7 @@ static struct vsycn_ctrl {
 	struct mdp4_overlay_pipe *base_pipe;
 	struct vsync_update vlist[2];
 	struct work_struct clk_work;
+	struct msmfb_writeback_data_list *wb_node;	/* being written */
 } vsync_ctrl_db[MAX_CONTROLLER];
 
 static void vsync_irq_enable(int intr, int term)
@@ -93,6 +94,7 @@ static void mdp4_wfd_queue_wakeup(struct msm_fb_data_type *mfd,
 		struct msmfb_writeback_data_list *node);
 static void mdp4_wfd_dequeue_update(struct msm_fb_data_type *mfd,
 		struct msmfb_writeback_data_list **wfdnode);
+static void mdp4_wfd_wait4prev(int cndx);
 
 int mdp4_overlay_writeback_on(struct platform_device *pdev)
 {
@@ -190,6 +192,9 @@ int mdp4_overlay_writeback_off(struct platform_device *pdev)
 		return ret;
 	}
 
+	/* hand the frame still being written back to the client */
+	mdp4_wfd_wait4prev(cndx);
+
 	/* sanity check, free pipes besides base layer */
 	mdp4_overlay_unset_mixer(pipe->mixer_num);
 	mdp4_mixer_stage_down(pipe, 1);
@@ -354,6 +359,8 @@ int mdp4_wfd_pipe_commit(struct msm_fb_data_type *mfd,
 	vp->update_cnt = 0;     /* reset */
 	mutex_unlock(&vctrl->update_lock);
 
+	mdp4_wfd_wait4prev(cndx);
+
 	mdp4_wfd_dequeue_update(mfd, &node);
 
 	/* free previous committed iommu back to pool */
@@ -384,6 +391,7 @@ int mdp4_wfd_pipe_commit(struct msm_fb_data_type *mfd,
 	pipe = vctrl->base_pipe;
 	spin_lock_irqsave(&vctrl->spin_lock, flags);
 	vctrl->ov_koff++;
+	vctrl->wb_node = node;
 	INIT_COMPLETION(vctrl->ov_comp);
 	vsync_irq_enable(INTR_OVERLAY2_DONE, MDP_OVERLAY2_TERM);
 	pr_debug("%s: kickoff\n", __func__);
@@ -396,18 +404,36 @@ int mdp4_wfd_pipe_commit(struct msm_fb_data_type *mfd,
 	mdp4_stat.overlay_commit[pipe->mixer_num]++;
 
 	if (wait)
-		mdp4_wfd_wait4ov(cndx);
-
-	mdp4_wfd_queue_wakeup(mfd, node);
+		mdp4_wfd_wait4prev(cndx);
 
 	return cnt;
 }
 
+/*
+ * Move the buffer of a completed writeback to the busy queue. Called
+ * from both the done work and the next commit, whoever comes first.
+ */
+static void mdp4_wfd_retire(struct vsycn_ctrl *vctrl)
+{
+	struct msmfb_writeback_data_list *node = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&vctrl->spin_lock, flags);
+	if (vctrl->ov_koff == vctrl->ov_done) {
+		node = vctrl->wb_node;
+		vctrl->wb_node = NULL;
+	}
+	spin_unlock_irqrestore(&vctrl->spin_lock, flags);
+
+	mdp4_wfd_queue_wakeup(vctrl->mfd, node);
+}
+
 static void clk_ctrl_work(struct work_struct *work)
 {
 	struct vsycn_ctrl *vctrl =
 		container_of(work, typeof(*vctrl), clk_work);
 	mdp_clk_ctrl(0);
+	mdp4_wfd_retire(vctrl);
 }
 
 void mdp4_wfd_init(int cndx)
@@ -448,6 +474,30 @@ static void mdp4_wfd_wait4ov(int cndx)
 	wait_for_completion(&vctrl->ov_comp);
 }
 
+/*
+ * The commit does not wait for the writeback it kicked off. The next
+ * one must not reprogram the pipes and the output address while the
+ * previous frame is still being written, so wait for it here and
+ * retire its buffer.
+ */
+static void mdp4_wfd_wait4prev(int cndx)
+{
+	struct vsycn_ctrl *vctrl;
+	unsigned long flags;
+	int busy;
+
+	vctrl = &vsync_ctrl_db[cndx];
+
+	spin_lock_irqsave(&vctrl->spin_lock, flags);
+	busy = (vctrl->ov_koff != vctrl->ov_done);
+	spin_unlock_irqrestore(&vctrl->spin_lock, flags);
+
+	if (busy)
+		mdp4_wfd_wait4ov(cndx);
+
+	mdp4_wfd_retire(vctrl);
+}
+
 
 void mdp4_overlay2_done_wfd(struct mdp_dma_data *dma)
 {
@@ -487,7 +537,7 @@ void mdp4_writeback_overlay(struct msm_fb_data_type *mfd)
 
 	mdp4_overlay_mdp_perf_upd(mfd, 1);
 
-	mdp4_wfd_pipe_commit(mfd, 0, 1);
+	mdp4_wfd_pipe_commit(mfd, 0, 0);
 
 	mdp4_overlay_mdp_perf_upd(mfd, 0);
 
@@ -792,10 +842,11 @@ static void mdp4_wfd_dequeue_update(struct msm_fb_data_type *mfd,
 static void mdp4_wfd_queue_wakeup(struct msm_fb_data_type *mfd,
 			struct msmfb_writeback_data_list *node)
 {
-
-	if (mfd && !mfd->panel_power_on)
-		return;
-
+	/*
+	 * A writeback may complete after the panel has been turned off,
+	 * its buffer still has to go back to the client or stop waits
+	 * on writeback_active_cnt forever.
+	 */
 	if (node == NULL)
 		return;
 
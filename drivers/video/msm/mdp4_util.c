@@ -202,6 +202,8 @@ void mdp4_sw_reset(ulong bits)
 
 	while (inpdw(MDP_BASE + 0x001c) & bits) /* self clear when complete */
 		;
+	/* blend registers are back to their reset values */
+	mdp4_mixer_blend_cache_reset(-1);
 	/* MDP cmd block disable */
 	mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_OFF, FALSE);
 
@@ -1315,6 +1317,8 @@ void mdp4_mixer_blend_init(mixer_num)
 	else
 		overlay_base = MDP_BASE + MDP4_OVERLAYPROC0_BASE;/* 0x10000 */
 
+	mdp4_mixer_blend_cache_reset(mixer_num);
+
 	mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_ON, FALSE);
 
 	/* stage 0 to stage 2 */
@@ -394,8 +394,12 @@ static ssize_t mdp_stat_read(
 					mdp4_stat.kickoff_ov1);
 	bp += len;
 	dlen -= len;
-	len = snprintf(bp, dlen, "dmae: %08lu\n\n",
+	len = snprintf(bp, dlen, "dmae: %08lu\n",
 					mdp4_stat.kickoff_dmae);
+	bp += len;
+	dlen -= len;
+	len = snprintf(bp, dlen, "cursor: %08lu\n\n",
+					mdp4_stat.kickoff_cursor);
 
 	bp += len;
 	dlen -= len;
@@ -463,6 +467,15 @@ static ssize_t mdp_stat_read(
 	len = snprintf(bp, dlen, "rgb3:   %08lu\n\n", mdp4_stat.pipe[4]);
 	bp += len;
 	dlen -= len;
+	len = snprintf(bp, dlen, "static_screen: %08lu\n",
+					mdp4_stat.static_screen);
+	bp += len;
+	dlen -= len;
+	len = snprintf(bp, dlen, "blend_cached: mixer0: %08lu\tmixer1: %08lu\n\n",
+					mdp4_stat.blend_cached[0],
+					mdp4_stat.blend_cached[1]);
+	bp += len;
+	dlen -= len;
 	len = snprintf(bp, dlen, "wait4vsync: ");
 	bp += len;
 	dlen -= len;
@@ -32,6 +32,7 @@
 #include <asm/system.h>
 #include <asm/mach-types.h>
 #include <linux/semaphore.h>
+#include <linux/slab.h>
 #include <linux/msm_kgsl.h>
 
 #include "mdp.h"
@@ -62,6 +63,198 @@ extern uint32 mdp_plv[];
 extern struct semaphore mdp_ppp_mutex;
 static struct ion_client *ppp_display_iclient;
 
+#ifdef CONFIG_FB_MSM_MDP31
+extern struct completion mdp_ppp_comp;
+extern boolean mdp_ppp_waiting;
+
+/*
+ * Blit batching.  While a batch is open the register writes of each blit
+ * are recorded instead of being sent to the hardware, the kickoff only
+ * marks the end of an operation.  When the batch is closed the first
+ * operation is programmed and started, the PPP done interrupt programs
+ * and starts the next one, and only the last one completes mdp_ppp_comp.
+ * The writes are replayed in the order they were recorded so every
+ * operation sees the same register state as it would have unbatched.
+ */
+#define MDP_PPP_BATCH_OPS	32
+#define MDP_PPP_BATCH_REGS	2048
+/* worst case for one blit, two scale tables reloaded */
+#define MDP_PPP_OP_REGS		(4 * 32 + 64)
+
+struct mdp_ppp_reg {
+	unsigned char *addr;
+	uint32 val;
+};
+
+static struct {
+	struct task_struct *owner;
+	struct msm_fb_data_type *mfd;
+	struct mdp_ppp_reg *regs;
+	int nregs;
+	int op_end[MDP_PPP_BATCH_OPS];
+	int nops;
+	int next;
+	struct file *files[2 * MDP_PPP_BATCH_OPS];
+	struct ion_handle *ihdls[2 * MDP_PPP_BATCH_OPS];
+	int nimgs;
+} ppp_batch;
+
+void put_img(struct file *p_src_file, struct ion_handle *p_ihdl);
+
+static inline int mdp_ppp_batching(void)
+{
+	return ppp_batch.owner == current;
+}
+
+void mdp_ppp_outp(unsigned char *addr, uint32 data)
+{
+	if (!mdp_ppp_batching()) {
+		outpdw(addr, data);
+		return;
+	}
+
+	if (WARN_ON(ppp_batch.nregs >= MDP_PPP_BATCH_REGS))
+		return;
+	ppp_batch.regs[ppp_batch.nregs].addr = addr;
+	ppp_batch.regs[ppp_batch.nregs].val = data;
+	ppp_batch.nregs++;
+}
+
+/* Called with mdp_spin_lock held, returns 1 if an operation was started */
+int mdp_ppp_batch_next(void)
+{
+	int i;
+
+	if (ppp_batch.next >= ppp_batch.nops)
+		return 0;
+
+	i = ppp_batch.next ? ppp_batch.op_end[ppp_batch.next - 1] : 0;
+	for (; i < ppp_batch.op_end[ppp_batch.next]; i++)
+		outpdw(ppp_batch.regs[i].addr, ppp_batch.regs[i].val);
+	ppp_batch.next++;
+
+	wmb();
+	outpdw(MDP_BASE + 0x30, 0x1000);
+	return 1;
+}
+
+static int mdp_ppp_batch_flush(void)
+{
+	unsigned long flag;
+	int i, ret = 0;
+
+	if (ppp_batch.nops == 0)
+		goto release;
+
+	mdp_pipe_ctrl(MDP_PPP_BLOCK, MDP_BLOCK_POWER_ON, FALSE);
+	mdp_enable_irq(MDP_PPP_TERM);
+	INIT_COMPLETION(mdp_ppp_comp);
+	spin_lock_irqsave(&mdp_spin_lock, flag);
+	mdp_ppp_waiting = TRUE;
+	ppp_batch.next = 0;
+	mdp_ppp_batch_next();
+	spin_unlock_irqrestore(&mdp_spin_lock, flag);
+
+	if (!wait_for_completion_timeout(&mdp_ppp_comp, 5 * HZ)) {
+		pr_err("%s: timed out after %d of %d blits\n", __func__,
+			ppp_batch.next, ppp_batch.nops);
+		spin_lock_irqsave(&mdp_spin_lock, flag);
+		ppp_batch.next = ppp_batch.nops;
+		mdp_ppp_waiting = FALSE;
+		spin_unlock_irqrestore(&mdp_spin_lock, flag);
+		mdp_pipe_ctrl(MDP_PPP_BLOCK, MDP_BLOCK_POWER_OFF, FALSE);
+		ret = -ETIMEDOUT;
+	}
+	mdp_disable_irq(MDP_PPP_TERM);
+
+release:
+	for (i = 0; i < ppp_batch.nimgs; i++)
+		put_img(ppp_batch.files[i], ppp_batch.ihdls[i]);
+	ppp_batch.nimgs = 0;
+	ppp_batch.nregs = 0;
+	ppp_batch.nops = 0;
+	ppp_batch.next = 0;
+	return ret;
+}
+
+/* Make room for one more blit, running what is queued if needed */
+static void mdp_ppp_batch_reserve(void)
+{
+	if (ppp_batch.nops >= MDP_PPP_BATCH_OPS ||
+		ppp_batch.nimgs + 2 > ARRAY_SIZE(ppp_batch.files) ||
+		ppp_batch.nregs + MDP_PPP_OP_REGS > MDP_PPP_BATCH_REGS)
+		mdp_ppp_batch_flush();
+}
+
+static int mdp_ppp_batch_kickoff(void)
+{
+	if (!mdp_ppp_batching())
+		return 0;
+
+	ppp_batch.op_end[ppp_batch.nops++] = ppp_batch.nregs;
+	return 1;
+}
+
+static void mdp_ppp_batch_put_img(struct file *p_src_file,
+	struct ion_handle *src_ihdl, struct file *p_dst_file,
+	struct ion_handle *dst_ihdl)
+{
+	ppp_batch.files[ppp_batch.nimgs] = p_src_file;
+	ppp_batch.ihdls[ppp_batch.nimgs++] = src_ihdl;
+	ppp_batch.files[ppp_batch.nimgs] = p_dst_file;
+	ppp_batch.ihdls[ppp_batch.nimgs++] = dst_ihdl;
+}
+
+int mdp_ppp_batch_begin(struct msm_fb_data_type *mfd)
+{
+	if (ppp_batch.regs == NULL) {
+		ppp_batch.regs = kmalloc(MDP_PPP_BATCH_REGS *
+			sizeof(struct mdp_ppp_reg), GFP_KERNEL);
+		if (ppp_batch.regs == NULL)
+			return -ENOMEM;
+	}
+
+	down(&mdp_ppp_mutex);
+	/* MDP cmd block enable */
+	mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_ON, FALSE);
+	ppp_batch.mfd = mfd;
+	ppp_batch.owner = current;
+	return 0;
+}
+
+int mdp_ppp_batch_end(void)
+{
+	int ret;
+
+	ret = mdp_ppp_batch_flush();
+	ppp_batch.owner = NULL;
+	/* MDP cmd block disable */
+	mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_OFF, FALSE);
+	up(&mdp_ppp_mutex);
+	return ret;
+}
+#else
+static inline int mdp_ppp_batching(void)
+{
+	return 0;
+}
+
+static inline void mdp_ppp_batch_reserve(void)
+{
+}
+
+static inline int mdp_ppp_batch_kickoff(void)
+{
+	return 0;
+}
+
+static inline void mdp_ppp_batch_put_img(struct file *p_src_file,
+	struct ion_handle *src_ihdl, struct file *p_dst_file,
+	struct ion_handle *dst_ihdl)
+{
+}
+#endif
+
 int mdp_get_bytes_per_pixel(uint32_t format,
 				 struct msm_fb_data_type *mfd)
 {
@@ -524,14 +717,14 @@ static void mdp_ppp_setbg(MDPIBUF *iBuf)
 	 * 0x01d4: bg src PPP config
 	 * 0x01d8: unpack pattern
 	 */
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x01c0, bg0_addr);
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x01c4, bg1_addr);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x01c0, bg0_addr);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x01c4, bg1_addr);
 
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x01cc,
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x01cc,
 		 (bg1_ystride << 16) | bg0_ystride);
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x01d4, ppp_src_cfg_reg);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x01d4, ppp_src_cfg_reg);
 
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x01d8, unpack_pattern);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x01d8, unpack_pattern);
 }
 
 #define IS_PSEUDOPLNR(img) ((img == MDP_Y_CRCB_H2V2) | \
@@ -976,7 +1169,7 @@ struct mdp_blit_req *req, struct file *p_src_file, struct file *p_dst_file)
 #ifdef CONFIG_FB_MSM_MDP31
 		ppp_operation_reg |= PPP_OP_CONVERT_MATRIX_SECONDARY |
 					PPP_OP_DST_RGB;
-		MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0240, 0);
+		MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0240, 0);
 #endif
 
 		if (ppp_lookUp_enable) {
@@ -992,7 +1185,7 @@ struct mdp_blit_req *req, struct file *p_src_file, struct file *p_dst_file)
 #ifdef CONFIG_FB_MSM_MDP31
 		ppp_operation_reg |= PPP_OP_CONVERT_MATRIX_PRIMARY |
 					PPP_OP_DST_YCBCR;
-		MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0240, 0x1e);
+		MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0240, 0x1e);
 #endif
 
 		if (ppp_lookUp_enable) {
@@ -1098,27 +1291,28 @@ struct mdp_blit_req *req, struct file *p_src_file, struct file *p_dst_file)
 	 * 0x0124: PPP source config register
 	 * 0x0128: unpacked pattern from lsb to msb (eg. RGB->BGR)
 	 */
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0108, (iBuf->roi.height << 16 |
-						      iBuf->roi.width));
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x010c, src0); /* comp.plane 0 */
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0110, src1); /* comp.plane 1 */
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x011c,
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0108,
+		 (iBuf->roi.height << 16 | iBuf->roi.width));
+	/* comp.plane 0 and 1 */
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x010c, src0);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0110, src1);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x011c,
 		 (src0_y1stride << 16 | src0_ystride));
 
 	/* setup for rgb 565 */
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0124, ppp_src_cfg_reg);
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0128, packPattern);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0124, ppp_src_cfg_reg);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0128, packPattern);
 	/*
 	 * 0x0138: PPP destination operation register
 	 * 0x014c: constant_alpha|transparent_color
 	 * 0x0150: PPP destination config register
 	 * 0x0154: PPP packing pattern
 	 */
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0138, ppp_operation_reg);
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x014c, alpha << 24 | (tpVal &
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0138, ppp_operation_reg);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x014c, alpha << 24 | (tpVal &
 								0xffffff));
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0150, ppp_dst_cfg_reg);
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0154, dst_packPattern);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0150, ppp_dst_cfg_reg);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0154, dst_packPattern);
 
 	/*
 	 * 0x0164: ROI height and width
@@ -1126,17 +1320,19 @@ struct mdp_blit_req *req, struct file *p_src_file, struct file *p_dst_file)
 	 * 0x016c: Component Plane 1 starting addr
 	 * 0x0178: Component Plane 1/0 y stride
 	 */
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0164,
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0164,
 		 (dst_roi_height << 16 | dst_roi_width));
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0168, dest0);
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x016c, dest1);
-	MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0178,
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0168, dest0);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x016c, dest1);
+	MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0178,
 		 (dest0_ystride << 16 | dest0_ystride));
 
 	flush_imgs(req, inpBpp, iBuf->bpp, p_src_file, p_dst_file);
 #ifdef	CONFIG_FB_MSM_MDP31
-	MDP_OUTP(MDP_BASE + 0x00100, 0xFF00);
+	MDP_PPP_OUTP(MDP_BASE + 0x00100, 0xFF00);
 #endif
+	if (mdp_ppp_batch_kickoff())
+		return;
 	mdp_pipe_kickoff(MDP_PPP_TERM, mfd);
 }
 
@@ -1453,6 +1649,15 @@ static int mdp_ppp_blit_addr(struct fb_info *info, struct mdp_blit_req *req,
 #endif
 	}
 
+	if (mdp_ppp_batching()) {
+		mdp_ppp_batch_reserve();
+		mdp_start_ppp(mfd, &iBuf, req, p_src_file, p_dst_file);
+		/* the images are released once the batch has run */
+		mdp_ppp_batch_put_img(p_src_file, *src_ihdl,
+			p_dst_file, *dst_ihdl);
+		return 0;
+	}
+
 	down(&mdp_ppp_mutex);
 	/* MDP cmd block enable */
 	mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_ON, FALSE);
@@ -46,6 +46,17 @@ static uint32 mdp_scale_0p6_to_0p8_mode;
 static uint32 mdp_scale_0p4_to_0p6_mode;
 static uint32 mdp_scale_0p2_to_0p4_mode;
 
+/*
+ * Phase registers last programmed.  They keep their value across blits,
+ * so consecutive blits with the same scaling skip both the calculation
+ * and the register writes.
+ */
+static struct {
+	uint32 in_w, in_h, out_w, out_h;
+	boolean rot90;
+	boolean valid;
+} mdp_scale_phase;
+
 /* -------- All scaling range, "pixel repeat" -------- */
 static int16 mdp_scale_pixel_repeat_C0[MDP_SCALE_COEFF_NUM] = {
 	0, 0, 0, 0, 0, 0, 0, 0,
@@ -205,17 +216,19 @@ static void mdp_update_scale_table(int index, int16 *c0, int16 *c1,
 		val =
 		    ((MDP_SCALE_COEFF_MASK & c1[i]) << 16) |
 		    (MDP_SCALE_COEFF_MASK & c0[i]);
-		writel(val, MDP_PPP_SCALE_COEFF_LSBn(index));
+		MDP_PPP_OUTP(MDP_PPP_SCALE_COEFF_LSBn(index), val);
 		val =
 		    ((MDP_SCALE_COEFF_MASK & c3[i]) << 16) |
 		    (MDP_SCALE_COEFF_MASK & c2[i]);
-		writel(val, MDP_PPP_SCALE_COEFF_MSBn(index));
+		MDP_PPP_OUTP(MDP_PPP_SCALE_COEFF_MSBn(index), val);
 		index++;
 	}
 }
 
 void mdp_init_scale_table(void)
 {
+	mdp_scale_phase.valid = FALSE;
+
 	mdp_scale_0p2_to_0p4_mode = MDP_SCALE_FIR;
 	mdp_update_scale_table(MDP_SCALE_0P2_TO_0P4_INDEX,
 			       mdp_scale_0p2_to_0p4_C0,
@@ -459,7 +472,7 @@ void mdp_set_scale(MDPIBUF *iBuf,
 	uint32 dst_roi_width_scale;
 	uint32 dst_roi_height_scale;
 	struct phase_val pval;
-	boolean use_pr;
+	boolean use_pr, rot90;
 	uint32 ppp_scale_config = 0;
 
 	if (!inputRGB)
@@ -480,22 +493,37 @@ void mdp_set_scale(MDPIBUF *iBuf,
 			*pppop_reg_ptr |=
 			    (PPP_OP_SCALE_Y_ON | PPP_OP_SCALE_X_ON);
 
-			mdp_calc_scaleInitPhase_3p1(iBuf->roi.width,
-						    iBuf->roi.height,
-						    dst_roi_width,
-						    dst_roi_height,
-						    iBuf->mdpImg.
-						    mdpOp & MDPOP_ROT90, 1, 1,
-						    &pval);
-
-			MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x013c,
-				 pval.phase_init_x);
-			MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0140,
-				 pval.phase_init_y);
-			MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0144,
-				 pval.phase_step_x);
-			MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0148,
-				 pval.phase_step_y);
+			rot90 = (iBuf->mdpImg.mdpOp & MDPOP_ROT90) ?
+				TRUE : FALSE;
+			if (!mdp_scale_phase.valid ||
+			    mdp_scale_phase.in_w != iBuf->roi.width ||
+			    mdp_scale_phase.in_h != iBuf->roi.height ||
+			    mdp_scale_phase.out_w != dst_roi_width ||
+			    mdp_scale_phase.out_h != dst_roi_height ||
+			    mdp_scale_phase.rot90 != rot90) {
+				mdp_calc_scaleInitPhase_3p1(iBuf->roi.width,
+							    iBuf->roi.height,
+							    dst_roi_width,
+							    dst_roi_height,
+							    rot90, 1, 1,
+							    &pval);
+
+				MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x013c,
+					 pval.phase_init_x);
+				MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0140,
+					 pval.phase_init_y);
+				MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0144,
+					 pval.phase_step_x);
+				MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0148,
+					 pval.phase_step_y);
+
+				mdp_scale_phase.in_w = iBuf->roi.width;
+				mdp_scale_phase.in_h = iBuf->roi.height;
+				mdp_scale_phase.out_w = dst_roi_width;
+				mdp_scale_phase.out_h = dst_roi_height;
+				mdp_scale_phase.rot90 = rot90;
+				mdp_scale_phase.valid = TRUE;
+			}
 
 			/* disable the pixel repeat option for scaling */
 			use_pr = false;
@@ -731,11 +759,11 @@ void mdp_set_scale(MDPIBUF *iBuf,
 
 			if (iBuf->mdpImg.mdpOp & MDPOP_SHARPENING) {
 				ppp_scale_config |= BIT(7);
-				MDP_OUTP(MDP_BASE + 0x50020,
+				MDP_PPP_OUTP(MDP_BASE + 0x50020,
 						iBuf->mdpImg.sp_value);
 			}
 
-			MDP_OUTP(MDP_BASE + 0x10230, ppp_scale_config);
+			MDP_PPP_OUTP(MDP_BASE + 0x10230, ppp_scale_config);
 		} else {
 			iBuf->mdpImg.mdpOp &= ~(MDPOP_ASCALE);
 		}
@@ -753,8 +781,9 @@ void mdp_adjust_start_addr(uint8 **src0,
 {
 	switch (layer) {
 	case 0:
-		MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0200, (y << 16) | (x));
-		MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0208,
+		MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0200,
+			 (y << 16) | (x));
+		MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0208,
 			 (height << 16) | (width));
 		break;
 
@@ -767,13 +796,15 @@ void mdp_adjust_start_addr(uint8 **src0,
 			height = iBuf->roi.dst_height;
 		}
 
-		MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0204, (y << 16) | (x));
-		MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x020c,
+		MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x0204,
+			 (y << 16) | (x));
+		MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x020c,
 			 (height << 16) | (width));
 		break;
 
 	case 2:
-		MDP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x019c, (y << 16) | (x));
+		MDP_PPP_OUTP(MDP_CMD_DEBUG_ACCESS_BASE + 0x019c,
+			 (y << 16) | (x));
 		break;
 	}
 }
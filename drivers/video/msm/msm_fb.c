@@ -119,6 +119,8 @@ static int mdp_bl_scale_config(struct msm_fb_data_type *mfd,
 static void msm_fb_scale_bl(__u32 *bl_lvl);
 static void msm_fb_commit_wq_handler(struct work_struct *work);
 static int msm_fb_pan_idle(struct msm_fb_data_type *mfd);
+static void msm_fb_acq_timer_cb(unsigned long data);
+static void msm_fb_idle_work(struct work_struct *work);
 
 #ifdef MSM_FB_ENABLE_DBGFS
 
@@ -317,9 +319,20 @@ static ssize_t msm_fb_msm_fb_type(struct device *dev,
 	return ret;
 }
 
+static ssize_t msm_fb_flip_done(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", mfd->flip_count);
+}
+
 static DEVICE_ATTR(msm_fb_type, S_IRUGO, msm_fb_msm_fb_type, NULL);
+static DEVICE_ATTR(flip_done, S_IRUGO, msm_fb_flip_done, NULL);
 static struct attribute *msm_fb_attrs[] = {
 	&dev_attr_msm_fb_type.attr,
+	&dev_attr_flip_done.attr,
 	NULL,
 };
 static struct attribute_group msm_fb_attr_group = {
@@ -343,6 +356,52 @@ static void msm_fb_remove_sysfs(struct platform_device *pdev)
 	sysfs_remove_group(&mfd->fbi->dev->kobj, &msm_fb_attr_group);
 }
 
+static unsigned long msm_fb_idle_timeout(struct msm_fb_data_type *mfd)
+{
+	u32 fps = mfd->panel_info.frame_rate ? : 60;
+
+	return msecs_to_jiffies(mfd->idle_frames * 1000 / fps);
+}
+
+/*
+ * Static screen detection.  Every new frame only stamps last_frame, the
+ * work rearms itself for the remaining time so the pan path never has
+ * to cancel it.  Once the screen has not changed for idle_frames vsync
+ * periods the mdp drops its bus vote to the static screen level, the
+ * next frame restores it from the perf update.
+ */
+static void msm_fb_idle_kick(struct msm_fb_data_type *mfd)
+{
+	if (mfd->index != 0 || !mfd->idle_frames)
+		return;
+
+	mfd->last_frame = jiffies;
+	schedule_delayed_work(&mfd->idle_work, msm_fb_idle_timeout(mfd));
+}
+
+static void msm_fb_idle_work(struct work_struct *work)
+{
+	struct msm_fb_data_type *mfd = container_of(to_delayed_work(work),
+				struct msm_fb_data_type, idle_work);
+	unsigned long timeout = msm_fb_idle_timeout(mfd);
+	unsigned long idle = jiffies - mfd->last_frame;
+
+	if (!mfd->panel_power_on || !mfd->idle_frames)
+		return;
+
+	if (idle < timeout) {
+		schedule_delayed_work(&mfd->idle_work, timeout - idle);
+		return;
+	}
+
+#ifdef CONFIG_FB_MSM_MDP40
+	/* serialized against the perf update of a frame being committed */
+	mutex_lock(&mfd->dma->ov_mutex);
+	mdp4_overlay_mdp_perf_static(mfd, 1);
+	mutex_unlock(&mfd->dma->ov_mutex);
+#endif
+}
+
 static void bl_workqueue_handler(struct work_struct *work);
 
 static int msm_fb_probe(struct platform_device *pdev)
@@ -874,6 +933,7 @@ static int msm_fb_blank_sub(int blank_mode, struct fb_info *info,
 			mfd->panel_power_on = FALSE;
 			cancel_delayed_work_sync(&mfd->backlight_worker);
 			bl_updated = 0;
+			cancel_delayed_work(&mfd->idle_work);
 
 			msleep(16);
 			ret = pdata->off(mfd->pdev);
@@ -1378,7 +1438,15 @@ static int msm_fb_register(struct msm_fb_data_type *mfd)
 	init_completion(&mfd->commit_comp);
 	mutex_init(&mfd->sync_mutex);
 	INIT_WORK(&mfd->commit_work, msm_fb_commit_wq_handler);
-	mfd->msm_fb_backup = kzalloc(sizeof(struct msm_fb_backup_type),
+	setup_timer(&mfd->acq_timer, msm_fb_acq_timer_cb, (unsigned long)mfd);
+	spin_lock_init(&mfd->damage_lock);
+	INIT_DELAYED_WORK(&mfd->idle_work, msm_fb_idle_work);
+	/* one second at 60fps */
+	mfd->idle_frames = 60;
+	init_waitqueue_head(&mfd->flip_wq);
+	mutex_init(&mfd->flip_mutex);
+	/* queued flip and the copy the commit work is running on */
+	mfd->msm_fb_backup = kzalloc(2 * sizeof(struct msm_fb_backup_type),
 		GFP_KERNEL);
 	if (mfd->msm_fb_backup == 0) {
 		pr_err("error: not enough memory!\n");
@@ -1520,6 +1588,8 @@ static int msm_fb_register(struct msm_fb_data_type *mfd)
 						   panel_power_on);
 			msm_fb_debugfs_file_create(sub_dir, "ref_cnt",
 						   (u32 *) &mfd->ref_cnt);
+			msm_fb_debugfs_file_create(sub_dir, "idle_frames",
+						   &mfd->idle_frames);
 			msm_fb_debugfs_file_create(sub_dir, "fb_imgType",
 						   (u32 *) &mfd->fb_imgType);
 			msm_fb_debugfs_file_create(sub_dir,
@@ -1698,6 +1768,9 @@ int msm_fb_wait_for_fence(struct msm_fb_data_type *mfd)
 	int i, ret = 0;
 	/* buf sync */
 	for (i = 0; i < mfd->acq_fen_cnt; i++) {
+		/* Drop an async waiter still queued from msm_fb_queue_commit */
+		sync_fence_cancel_async(mfd->acq_fen[i],
+			&mfd->acq_waiter[i].waiter);
 		ret = sync_fence_wait(mfd->acq_fen[i], WAIT_FENCE_TIMEOUT);
 		sync_fence_put(mfd->acq_fen[i]);
 		if (ret < 0) {
@@ -1709,6 +1782,64 @@ int msm_fb_wait_for_fence(struct msm_fb_data_type *mfd)
 	mfd->acq_fen_cnt = 0;
 	return ret;
 }
+
+static void msm_fb_commit_kick(struct msm_fb_data_type *mfd)
+{
+	if (atomic_xchg(&mfd->commit_armed, 0)) {
+		del_timer(&mfd->acq_timer);
+		schedule_work(&mfd->commit_work);
+	}
+}
+
+static void msm_fb_acq_fence_signaled(struct sync_fence *fence,
+				      struct sync_fence_waiter *waiter)
+{
+	struct msm_fb_fence_waiter *w =
+		container_of(waiter, struct msm_fb_fence_waiter, waiter);
+
+	if (atomic_dec_and_test(&w->mfd->acq_pending))
+		msm_fb_commit_kick(w->mfd);
+}
+
+static void msm_fb_acq_timer_cb(unsigned long data)
+{
+	msm_fb_commit_kick((struct msm_fb_data_type *)data);
+}
+
+/*
+ * Queue the commit work once every acquire fence has signaled rather than
+ * letting the work block in sync_fence_wait.  The callbacks run from the
+ * context that signals the fence (for GPU buffers the kgsl timestamp
+ * event), so the commit is started as soon as the producer is done and
+ * no shared worker sleeps meanwhile.  The timer keeps the old timeout
+ * behaviour for fences that never signal.  Called with sync_mutex held.
+ */
+static void msm_fb_queue_commit(struct msm_fb_data_type *mfd)
+{
+	int i;
+
+	/* Hold a bias so the commit can't start while arming the waiters */
+	atomic_set(&mfd->acq_pending, 1);
+	atomic_set(&mfd->commit_armed, 1);
+
+	for (i = 0; i < mfd->acq_fen_cnt; i++) {
+		struct msm_fb_fence_waiter *w = &mfd->acq_waiter[i];
+
+		w->mfd = mfd;
+		sync_fence_waiter_init(&w->waiter, msm_fb_acq_fence_signaled);
+
+		atomic_inc(&mfd->acq_pending);
+		if (sync_fence_wait_async(mfd->acq_fen[i], &w->waiter))
+			atomic_dec(&mfd->acq_pending);
+	}
+
+	if (atomic_dec_and_test(&mfd->acq_pending))
+		msm_fb_commit_kick(mfd);
+	else
+		mod_timer(&mfd->acq_timer,
+			jiffies + msecs_to_jiffies(WAIT_FENCE_TIMEOUT));
+}
+
 int msm_fb_signal_timeline(struct msm_fb_data_type *mfd)
 {
 	mutex_lock(&mfd->sync_mutex);
@@ -1759,6 +1890,31 @@ static int msm_fb_pan_idle(struct msm_fb_data_type *mfd)
 	}
 	return ret;
 }
+/*
+ * Wait for the flip slot and return with sync_mutex held.  One flip may
+ * be on its way to the panel while the next one is queued behind it, so
+ * the caller only blocks once it runs two frames ahead of scan out.
+ */
+static int msm_fb_flip_wait_slot(struct msm_fb_data_type *mfd)
+{
+	int ret;
+
+	for (;;) {
+		ret = wait_event_interruptible_timeout(mfd->flip_wq,
+			!mfd->flip_queued,
+			msecs_to_jiffies(WAIT_FENCE_TIMEOUT));
+		if (ret < 0)
+			return ret;
+		if (ret == 0)
+			pr_err("%s: wait for flip slot timeout\n", __func__);
+
+		mutex_lock(&mfd->sync_mutex);
+		if (!mfd->flip_queued)
+			return 0;
+		mutex_unlock(&mfd->sync_mutex);
+	}
+}
+
 static int msm_fb_pan_display_ex(struct fb_var_screeninfo *var,
 			      struct fb_info *info, u32 wait_for_finish)
 {
@@ -1783,9 +1939,10 @@ static int msm_fb_pan_display_ex(struct fb_var_screeninfo *var,
 
 	if (var->yoffset > (info->var.yres_virtual - info->var.yres))
 		return -EINVAL;
-	msm_fb_pan_idle(mfd);
 
-	mutex_lock(&mfd->sync_mutex);
+	ret = msm_fb_flip_wait_slot(mfd);
+	if (ret)
+		return ret;
 
 	if (info->fix.xpanstep)
 		info->var.xoffset =
@@ -1798,9 +1955,13 @@ static int msm_fb_pan_display_ex(struct fb_var_screeninfo *var,
 	fb_backup = (struct msm_fb_backup_type *)mfd->msm_fb_backup;
 	memcpy(&fb_backup->info, info, sizeof(struct fb_info));
 	memcpy(&fb_backup->var, var, sizeof(struct fb_var_screeninfo));
-	mfd->is_committing = 1;
-	INIT_COMPLETION(mfd->commit_comp);
-	schedule_work(&mfd->commit_work);
+	mfd->flip_queued = 1;
+	mfd->flips_unsignaled++;
+	if (!mfd->is_committing) {
+		mfd->is_committing = 1;
+		INIT_COMPLETION(mfd->commit_comp);
+	}
+	msm_fb_queue_commit(mfd);
 	mutex_unlock(&mfd->sync_mutex);
 	if (wait_for_finish)
 		msm_fb_pan_idle(mfd);
@@ -1813,6 +1974,94 @@ static int msm_fb_pan_display(struct fb_var_screeninfo *var,
 	return msm_fb_pan_display_ex(var, info, TRUE);
 }
 
+static void msm_fb_damage_union(struct mdp_dirty_region *dst,
+				 struct mdp_dirty_region *src)
+{
+	__u32 x2 = max(dst->xoffset + dst->width, src->xoffset + src->width);
+	__u32 y2 = max(dst->yoffset + dst->height, src->yoffset + src->height);
+
+	dst->xoffset = min(dst->xoffset, src->xoffset);
+	dst->yoffset = min(dst->yoffset, src->yoffset);
+	dst->width = x2 - dst->xoffset;
+	dst->height = y2 - dst->yoffset;
+}
+
+/*
+ * Fold the damage posted with MSMFB_DAMAGE_SET since the last pan into
+ * the dirty region of this one.  Returns NULL (full frame) when neither
+ * was given.
+ */
+static struct mdp_dirty_region *msm_fb_take_damage(
+	struct msm_fb_data_type *mfd, struct mdp_dirty_region *dirty,
+	struct mdp_dirty_region *buf)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&mfd->damage_lock, flags);
+	if (mfd->damage_valid) {
+		if (dirty)
+			msm_fb_damage_union(dirty, &mfd->damage);
+		else
+			*buf = mfd->damage;
+		mfd->damage_valid = 0;
+		dirty = buf;
+	}
+	spin_unlock_irqrestore(&mfd->damage_lock, flags);
+
+	return dirty;
+}
+
+static int msmfb_damage_set(struct fb_info *info, void __user *argp)
+{
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+	struct mdp_damage damage;
+	struct mdp_rect rects[MDP_DAMAGE_MAX];
+	struct mdp_dirty_region box, r;
+	unsigned long flags;
+	int i, n = 0;
+
+	if (copy_from_user(&damage, argp, sizeof(damage)))
+		return -EFAULT;
+
+	if (damage.num_rects == 0 || damage.num_rects > MDP_DAMAGE_MAX)
+		return -EINVAL;
+
+	if (copy_from_user(rects, damage.rects,
+			damage.num_rects * sizeof(struct mdp_rect)))
+		return -EFAULT;
+
+	for (i = 0; i < damage.num_rects; i++) {
+		/* clip to the visible area, drop empty rectangles */
+		if (rects[i].x >= info->var.xres ||
+			rects[i].y >= info->var.yres)
+			continue;
+		r.xoffset = rects[i].x;
+		r.yoffset = rects[i].y;
+		r.width = min(rects[i].w, info->var.xres - rects[i].x);
+		r.height = min(rects[i].h, info->var.yres - rects[i].y);
+		if (r.width == 0 || r.height == 0)
+			continue;
+
+		if (n++)
+			msm_fb_damage_union(&box, &r);
+		else
+			box = r;
+	}
+
+	if (n == 0)
+		return 0;
+
+	spin_lock_irqsave(&mfd->damage_lock, flags);
+	if (mfd->damage_valid)
+		msm_fb_damage_union(&mfd->damage, &box);
+	else
+		mfd->damage = box;
+	mfd->damage_valid = 1;
+	spin_unlock_irqrestore(&mfd->damage_lock, flags);
+
+	return 0;
+}
+
 static int msm_fb_pan_display_sub(struct fb_var_screeninfo *var,
 			      struct fb_info *info)
 {
@@ -1880,6 +2129,8 @@ static int msm_fb_pan_display_sub(struct fb_var_screeninfo *var,
 
 		dirtyPtr = &dirty;
 	}
+	dirtyPtr = msm_fb_take_damage(mfd, dirtyPtr, &dirty);
+
 	complete(&mfd->msmfb_update_notify);
 	mutex_lock(&msm_fb_notify_update_sem);
 	if (mfd->msmfb_no_update_notify_timer.function)
@@ -1890,15 +2141,17 @@ static int msm_fb_pan_display_sub(struct fb_var_screeninfo *var,
 	mutex_unlock(&msm_fb_notify_update_sem);
 
 	down(&msm_fb_pan_sem);
-	msm_fb_wait_for_fence(mfd);
 	if (info->node == 0 && !(mfd->cont_splash_done)) { /* primary */
 		mdp_set_dma_pan_info(info, NULL, TRUE);
 		if (msm_fb_blank_sub(FB_BLANK_UNBLANK, info, mfd->op_enable)) {
 			pr_err("%s: can't turn on display!\n", __func__);
+			mutex_lock(&mfd->sync_mutex);
 			if (mfd->timeline) {
 				sw_sync_timeline_inc(mfd->timeline, 2);
 				mfd->timeline_value += 2;
 			}
+			mutex_unlock(&mfd->sync_mutex);
+			up(&msm_fb_pan_sem);
 			return -EINVAL;
 		}
 	}
@@ -1909,6 +2162,7 @@ static int msm_fb_pan_display_sub(struct fb_var_screeninfo *var,
 	mdp_dma_pan_update(info);
 	msm_fb_signal_timeline(mfd);
 	up(&msm_fb_pan_sem);
+	msm_fb_idle_kick(mfd);
 
 	if (unset_bl_level && !bl_updated)
 		schedule_delayed_work(&mfd->backlight_worker,
@@ -1930,14 +2184,42 @@ static void msm_fb_commit_wq_handler(struct work_struct *work)
 
 	mfd = container_of(work, struct msm_fb_data_type, commit_work);
 	fb_backup = (struct msm_fb_backup_type *)mfd->msm_fb_backup;
-	var = &fb_backup->var;
-	info = &fb_backup->info;
-	msm_fb_pan_display_sub(var, info);
+
+	/*
+	 * Consume the acquire fences and take a private copy of the flip,
+	 * then release the slot so the next frame can be queued while this
+	 * one is pushed out.  flip_mutex covers the private copy, a requeued
+	 * work may start on another cpu before this one returns.
+	 */
+	mutex_lock(&mfd->flip_mutex);
+	msm_fb_wait_for_fence(mfd);
 	mutex_lock(&mfd->sync_mutex);
-	mfd->is_committing = 0;
-	complete_all(&mfd->commit_comp);
+	memcpy(fb_backup + 1, fb_backup, sizeof(struct msm_fb_backup_type));
+	mfd->flip_queued = 0;
 	mutex_unlock(&mfd->sync_mutex);
+	wake_up_interruptible_all(&mfd->flip_wq);
 
+	var = &fb_backup[1].var;
+	info = &fb_backup[1].info;
+	msm_fb_pan_display_sub(var, info);
+
+	mutex_lock(&mfd->sync_mutex);
+	/*
+	 * Until here release fences are created one flip later, dropping
+	 * late can only hold a buffer for an extra frame, never free it
+	 * while it is still scanned out.
+	 */
+	if (mfd->flips_unsignaled)
+		mfd->flips_unsignaled--;
+	mfd->flip_count++;
+	/* another flip queued meanwhile will requeue this work */
+	if (!mfd->flip_queued) {
+		mfd->is_committing = 0;
+		complete_all(&mfd->commit_comp);
+	}
+	mutex_unlock(&mfd->sync_mutex);
+	mutex_unlock(&mfd->flip_mutex);
+	sysfs_notify(&mfd->fbi->dev->kobj, NULL, "flip_done");
 }
 
 static int msm_fb_check_var(struct fb_var_screeninfo *var, struct fb_info *info)
@@ -2881,6 +3163,7 @@ static int msmfb_blit(struct fb_info *info, void __user *p)
 	struct mdp_blit_req_list req_list_header;
 
 	int count, i, req_list_count;
+	int batched, ret = 0;
 	if (bf_supported &&
 		(info->node == 1 || info->node == 2)) {
 		pr_err("%s: no pan display for fb%d.",
@@ -2918,6 +3201,13 @@ static int msmfb_blit(struct fb_info *info, void __user *p)
 		msm_fb_ensure_memory_coherency_before_dma(info,
 				req_list, req_list_count);
 
+		/*
+		 * Queue the whole window to the PPP and run it back to back
+		 * where the hardware supports it, otherwise each blit runs
+		 * and completes on its own.
+		 */
+		batched = !mdp_ppp_batch_begin(info->par);
+
 		/*
 		 * Do the blit DMA, if required -- returning early only if
 		 * there is a failure.
@@ -2925,17 +3215,23 @@ static int msmfb_blit(struct fb_info *info, void __user *p)
 		for (i = 0; i < req_list_count; i++) {
 			if (!(req_list[i].flags & MDP_NO_BLIT)) {
 				/* Do the actual blit. */
-				int ret = mdp_blit(info, &(req_list[i]));
+				ret = mdp_blit(info, &(req_list[i]));
 
 				/*
 				 * Note that early returns don't guarantee
 				 * memory coherency.
 				 */
 				if (ret)
-					return ret;
+					break;
 			}
 		}
 
+		/* blits queued ahead of a failing one still run */
+		if (batched && mdp_ppp_batch_end() && !ret)
+			ret = -EIO;
+		if (ret)
+			return ret;
+
 		/*
 		 * Ensure that CPU cache and other internal CPU state is
 		 * updated to reflect any change in memory modified by MDP blit
@@ -3076,22 +3372,11 @@ static int msmfb_overlay_commit(struct fb_info *info)
 	return mdp4_overlay_commit(info);
 }
 
-static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
+static int msmfb_overlay_play_begin(struct fb_info *info)
 {
-	int	ret;
-	struct msmfb_overlay_data req;
 	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
 
-	if (mfd->overlay_play_enable == 0)	/* nothing to do */
-		return 0;
-
-	ret = copy_from_user(&req, argp, sizeof(req));
-	if (ret) {
-		printk(KERN_ERR "%s:msmfb_overlay_play ioctl failed \n",
-			__func__);
-		return ret;
-	}
-
+	msm_fb_idle_kick(mfd);
 	complete(&mfd->msmfb_update_notify);
 	mutex_lock(&msm_fb_notify_update_sem);
 	if (mfd->msmfb_no_update_notify_timer.function)
@@ -3109,7 +3394,12 @@ static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
 		}
 	}
 
-	ret = mdp4_overlay_play(info, &req);
+	return 0;
+}
+
+static void msmfb_overlay_play_end(struct fb_info *info)
+{
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
 
 	if (unset_bl_level && !bl_updated)
 		schedule_delayed_work(&mfd->backlight_worker,
@@ -3117,10 +3407,79 @@ static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
 
 	if (info->node == 0 && (mfd->cont_splash_done)) /* primary */
 		mdp_free_splash_buffer(mfd);
+}
+
+static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
+{
+	int	ret;
+	struct msmfb_overlay_data req;
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+
+	if (mfd->overlay_play_enable == 0)	/* nothing to do */
+		return 0;
+
+	ret = copy_from_user(&req, argp, sizeof(req));
+	if (ret) {
+		printk(KERN_ERR "%s:msmfb_overlay_play ioctl failed \n",
+			__func__);
+		return ret;
+	}
+
+	ret = msmfb_overlay_play_begin(info);
+	if (ret)
+		return ret;
+
+	ret = mdp4_overlay_play(info, &req);
+
+	msmfb_overlay_play_end(info);
 
 	return ret;
 }
 
+static int msmfb_overlay_play_list(struct fb_info *info, unsigned long *argp)
+{
+	int ret;
+	struct mdp_overlay_list list;
+	struct msmfb_overlay_data *req;
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+
+	if (mfd->overlay_play_enable == 0)	/* nothing to do */
+		return 0;
+
+	ret = copy_from_user(&list, argp, sizeof(list));
+	if (ret) {
+		pr_err("%s:copy_from_user failed\n", __func__);
+		return -EFAULT;
+	}
+
+	if (list.num_overlays == 0 ||
+		list.num_overlays > MDP_OVERLAY_LIST_MAX)
+		return -EINVAL;
+
+	req = kmalloc(list.num_overlays * sizeof(*req), GFP_KERNEL);
+	if (req == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(req, list.overlay_list,
+			list.num_overlays * sizeof(*req))) {
+		pr_err("%s:copy_from_user failed\n", __func__);
+		ret = -EFAULT;
+		goto done;
+	}
+
+	ret = msmfb_overlay_play_begin(info);
+	if (ret)
+		goto done;
+
+	ret = mdp4_overlay_play_list(info, req, list.num_overlays,
+		list.flags & MDP_OVERLAY_LIST_COMMIT);
+
+	msmfb_overlay_play_end(info);
+done:
+	kfree(req);
+	return ret;
+}
+
 static int msmfb_overlay_play_enable(struct fb_info *info, unsigned long *argp)
 {
 	int	ret, enable;
@@ -3567,7 +3926,7 @@ static int msmfb_handle_buf_sync_ioctl(struct msm_fb_data_type *mfd,
 		msm_fb_wait_for_fence(mfd);
 
 	mfd->cur_rel_sync_pt = sw_sync_pt_create(mfd->timeline,
-			mfd->timeline_value + 2);
+			mfd->timeline_value + 2 + mfd->flips_unsignaled);
 	if (mfd->cur_rel_sync_pt == NULL) {
 		pr_err("%s: cannot create sync point", __func__);
 		ret = -ENOMEM;
@@ -3633,7 +3992,7 @@ static int buf_fence_process(struct msm_fb_data_type *mfd,
 	if (ret)
 		goto buf_fence_err_1;
 	mfd->cur_rel_sync_pt = sw_sync_pt_create(mfd->timeline,
-			mfd->timeline_value + 2);
+			mfd->timeline_value + 2 + mfd->flips_unsignaled);
 	if (mfd->cur_rel_sync_pt == NULL) {
 		pr_err("%s: cannot create sync point", __func__);
 		ret = -ENOMEM;
@@ -3680,6 +4039,13 @@ static int msmfb_display_commit(struct fb_info *info,
 		return ret;
 	}
 	buf_fence = &disp_commit.buf_fence;
+
+	/* the queued flip still owns the acquire fences */
+	ret = msm_fb_flip_wait_slot(mfd);
+	if (ret)
+		return ret;
+	mutex_unlock(&mfd->sync_mutex);
+
 	if (buf_fence->acq_fen_fd_cnt > 0)
 		ret = buf_fence_process(mfd, buf_fence);
 	if ((!ret) && (buf_fence->rel_fen_fd[0] > 0))
@@ -3737,6 +4103,12 @@ static int msm_fb_ioctl(struct fb_info *info, unsigned int cmd,
 	case MSMFB_OVERLAY_PLAY:
 		ret = msmfb_overlay_play(info, argp);
 		break;
+	case MSMFB_OVERLAY_PLAY_LIST:
+		ret = msmfb_overlay_play_list(info, argp);
+		break;
+	case MSMFB_DAMAGE_SET:
+		ret = msmfb_damage_set(info, argp);
+		break;
 	case MSMFB_OVERLAY_PLAY_ENABLE:
 		ret = msmfb_overlay_play_enable(info, argp);
 		break;
@@ -38,6 +38,7 @@
 #include <linux/fb.h>
 #include <linux/list.h>
 #include <linux/types.h>
+#include <linux/sync.h>
 
 #include <linux/msm_mdp.h>
 #ifdef CONFIG_HAS_EARLYSUSPEND
@@ -48,6 +49,13 @@
 #include "mdp.h"
 
 #define MSM_FB_DEFAULT_PAGE_SIZE 2
+
+struct msm_fb_data_type;
+
+struct msm_fb_fence_waiter {
+	struct sync_fence_waiter waiter;
+	struct msm_fb_data_type *mfd;
+};
 #define MFD_KEY  0x11161126
 #define MSM_FB_MAX_DEV_LIST 32
 
@@ -192,7 +200,7 @@ struct msm_fb_data_type {
 	u32 mem_hid;
 	u32 mdp_rev;
 	u32 writeback_state;
-	bool writeback_active_cnt;
+	int writeback_active_cnt;
 	int cont_splash_done;
 	void *copy_splash_buf;
 	unsigned char *copy_splash_phys;
@@ -213,6 +221,21 @@ struct msm_fb_data_type {
 	struct completion commit_comp;
 	u32 is_committing;
 	struct work_struct commit_work;
+	struct msm_fb_fence_waiter acq_waiter[MDP_MAX_FENCE_FD];
+	atomic_t acq_pending;
+	atomic_t commit_armed;
+	struct timer_list acq_timer;
+	spinlock_t damage_lock;
+	struct mdp_dirty_region damage;
+	int damage_valid;
+	int flip_queued;
+	int flips_unsignaled;
+	u32 flip_count;
+	wait_queue_head_t flip_wq;
+	struct mutex flip_mutex;
+	struct delayed_work idle_work;
+	unsigned long last_frame;
+	u32 idle_frames;
 	void *msm_fb_backup;
 };
 struct msm_fb_backup_type {
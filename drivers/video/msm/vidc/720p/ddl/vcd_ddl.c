@@ -521,6 +521,7 @@ u32 ddl_encode_frame(u32 *ddl_handle,
 	ddl->input_frame = *input_frame;
 	ddl->output_frame = *output_bit;
 
+	ddl->codec_data.encoder.frame_start = ktime_get();
 	ddl_encode_frame_run(ddl);
 	return VCD_S_SUCCESS;
 }
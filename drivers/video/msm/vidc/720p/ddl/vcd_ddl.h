@@ -12,6 +12,7 @@
  */
 #ifndef _VCD_DDL_H_
 #define _VCD_DDL_H_
+#include <linux/hrtimer.h>
 #include "vcd_ddl_api.h"
 #include "vcd_ddl_utils.h"
 #include "vcd_ddl_firmware.h"
@@ -55,6 +56,8 @@
 #define DDL_FREE_CLIENT      2
 #define DDL_ACTIVE_CLIENT    3
 
+#define MDP_MIN_TILE_HEIGHT 96
+
 #define DDL_INVALID_CHANNEL_ID  ((u32)~0)
 #define DDL_INVALID_CODEC_TYPE ((u32)~0)
 
@@ -159,6 +162,7 @@ struct ddl_encoder_data {
 	u32 dynmic_prop_change_req;
 	u32 ext_enc_control_val;
 	struct vidc_720p_enc_frame_info enc_frame_info;
+	ktime_t frame_start;
 	struct ddl_buf_addr enc_dpb_addr;
 	struct ddl_buf_addr seq_header;
 	struct vcd_buffer_requirement input_buf_req;
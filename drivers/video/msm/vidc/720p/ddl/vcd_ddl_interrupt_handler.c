@@ -368,6 +368,7 @@ static void ddl_encoder_frame_run_callback(struct ddl_context
 	struct ddl_client_context *ddl = ddl_context->current_ddl;
 	struct ddl_encoder_data *encoder = &(ddl->codec_data.encoder);
 	u32 eos_present = false;
+	u32 latency;
 
 	if (!DDLCLIENT_STATE_IS(ddl, DDL_CLIENT_WAIT_FOR_FRAME_DONE)
 		) {
@@ -378,6 +379,15 @@ static void ddl_encoder_frame_run_callback(struct ddl_context
 
 	VIDC_LOG_STRING("ENC_FRM_RUN_DONE");
 
+	/* Frame run command to frame done, for the vidc debugfs */
+	latency = (u32) ktime_to_us(ktime_sub(ktime_get(),
+					      encoder->frame_start));
+	vidc_enc_latency_us = latency;
+	vidc_enc_latency_avg_us = vidc_enc_latency_avg_us ?
+		(vidc_enc_latency_avg_us * 7 + latency) / 8 : latency;
+	if (latency > vidc_enc_latency_max_us)
+		vidc_enc_latency_max_us = latency;
+
 	ddl_move_command_state(ddl_context, DDL_CMD_INVALID);
 	vidc_720p_enc_frame_info(&encoder->enc_frame_info);
 
@@ -1707,6 +1707,24 @@ void ddl_set_default_decoder_buffer_req(struct ddl_decoder_data *decoder,
 		min_dpb = decoder->min_dpb_num;
 	}
 
+	/*
+	 * Tiled output is fetched by the MDP overlay straight from the
+	 * decoder buffer, which reads whole tile rows down to a minimum
+	 * frame height. Size small clips for that so the buffer can be
+	 * displayed without an intermediate copy.
+	 */
+	if (decoder->buf_format.buffer_format == VCD_BUFFER_FORMAT_TILE_4x2 &&
+		frame_size->height < MDP_MIN_TILE_HEIGHT) {
+		struct vcd_property_frame_size mdp_frame_size = *frame_size;
+
+		mdp_frame_size.height = MDP_MIN_TILE_HEIGHT;
+		y_cb_cr_size = max(y_cb_cr_size,
+			ddl_get_yuv_buffer_size(&mdp_frame_size,
+				&decoder->buf_format,
+				(!decoder->progressive_only),
+				decoder->codec.codec));
+	}
+
 	if (decoder->idr_only_decoding)
 		min_dpb = 1;
 
@@ -18,6 +18,8 @@
 
 extern u32 vidc_msg_pmem;
 extern u32 vidc_msg_timing;
+extern u32 vidc_enc_latency_us, vidc_enc_latency_avg_us;
+extern u32 vidc_enc_latency_max_us;
 
 enum timing_data {
 	DEC_OP_TIME,
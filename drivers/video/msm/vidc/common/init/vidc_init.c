@@ -63,6 +63,7 @@ static irqreturn_t vidc_isr(int irq, void *dev);
 static spinlock_t vidc_spin_lock;
 
 u32 vidc_msg_timing, vidc_msg_pmem, vidc_msg_register;
+u32 vidc_enc_latency_us, vidc_enc_latency_avg_us, vidc_enc_latency_max_us;
 
 #ifdef VIDC_ENABLE_DBGFS
 struct dentry *vidc_debugfs_root;
@@ -312,6 +313,12 @@ static int __init vidc_init(void)
 				(u32 *) &vidc_msg_pmem);
 		vidc_debugfs_file_create(root, "vidc_msg_register",
 				(u32 *) &vidc_msg_register);
+		vidc_debugfs_file_create(root, "vidc_enc_latency_us",
+				(u32 *) &vidc_enc_latency_us);
+		vidc_debugfs_file_create(root, "vidc_enc_latency_avg_us",
+				(u32 *) &vidc_enc_latency_avg_us);
+		vidc_debugfs_file_create(root, "vidc_enc_latency_max_us",
+				(u32 *) &vidc_enc_latency_max_us);
 	}
 #endif
 	return 0;
@@ -33,11 +33,22 @@
 #include <linux/bootmem.h>
 #include <linux/fs_struct.h>
 #include <linux/hardirq.h>
+#include <linux/workqueue.h>
 #include "internal.h"
 
 int sysctl_vfs_cache_pressure __read_mostly = 25;
 EXPORT_SYMBOL_GPL(sysctl_vfs_cache_pressure);
 
+/*
+ * Most unused negative dentries allowed on the LRUs, 0 for no limit.
+ * Failed lookups, as a package scan probing for files that mostly do not
+ * exist, would otherwise fill the cache with them.
+ */
+int sysctl_negative_dentry_limit __read_mostly;
+
+/* LRU entries looked at per superblock by one trim of negative dentries */
+#define NEGATIVE_DENTRY_SCAN	4096
+
  __cacheline_aligned_in_smp DEFINE_SPINLOCK(dcache_lock);
 __cacheline_aligned_in_smp DEFINE_SEQLOCK(rename_lock);
 
@@ -107,6 +118,8 @@ static void dentry_iput(struct dentry * dentry)
 	struct inode *inode = dentry->d_inode;
 	if (inode) {
 		dentry->d_inode = NULL;
+		if (!list_empty(&dentry->d_lru))
+			dentry_stat.nr_negative++;
 		list_del_init(&dentry->d_alias);
 		spin_unlock(&dentry->d_lock);
 		spin_unlock(&dcache_lock);
@@ -124,12 +137,17 @@ static void dentry_iput(struct dentry * dentry)
 
 /*
  * dentry_lru_(add|add_tail|del|del_init) must be called with dcache_lock held.
+ * dentry_stat.nr_negative counts the negative dentries among those on the
+ * LRUs; d_inode only changes under dcache_lock, the count is kept in step
+ * there.
  */
 static void dentry_lru_add(struct dentry *dentry)
 {
 	list_add(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
 	dentry->d_sb->s_nr_dentry_unused++;
 	dentry_stat.nr_unused++;
+	if (!dentry->d_inode)
+		dentry_stat.nr_negative++;
 }
 
 static void dentry_lru_add_tail(struct dentry *dentry)
@@ -137,6 +155,8 @@ static void dentry_lru_add_tail(struct dentry *dentry)
 	list_add_tail(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
 	dentry->d_sb->s_nr_dentry_unused++;
 	dentry_stat.nr_unused++;
+	if (!dentry->d_inode)
+		dentry_stat.nr_negative++;
 }
 
 static void dentry_lru_del(struct dentry *dentry)
@@ -145,6 +165,8 @@ static void dentry_lru_del(struct dentry *dentry)
 		list_del(&dentry->d_lru);
 		dentry->d_sb->s_nr_dentry_unused--;
 		dentry_stat.nr_unused--;
+		if (!dentry->d_inode)
+			dentry_stat.nr_negative--;
 	}
 }
 
@@ -154,9 +176,21 @@ static void dentry_lru_del_init(struct dentry *dentry)
 		list_del_init(&dentry->d_lru);
 		dentry->d_sb->s_nr_dentry_unused--;
 		dentry_stat.nr_unused--;
+		if (!dentry->d_inode)
+			dentry_stat.nr_negative--;
 	}
 }
 
+/* Must hold dcache_lock */
+static int negative_dentries_over_limit(void)
+{
+	return sysctl_negative_dentry_limit &&
+	       dentry_stat.nr_negative > sysctl_negative_dentry_limit;
+}
+
+static void prune_negative_dentries(struct work_struct *work);
+static DECLARE_WORK(negative_dentry_work, prune_negative_dentries);
+
 /**
  * d_kill - kill dentry and return parent
  * @dentry: dentry to kill
@@ -243,6 +277,8 @@ repeat:
   	if (list_empty(&dentry->d_lru)) {
   		dentry->d_flags |= DCACHE_REFERENCED;
 		dentry_lru_add(dentry);
+		if (!dentry->d_inode && negative_dentries_over_limit())
+			schedule_work(&negative_dentry_work);
   	}
  	spin_unlock(&dentry->d_lock);
 	spin_unlock(&dcache_lock);
@@ -448,6 +484,34 @@ static void prune_one_dentry(struct dentry * dentry)
 	}
 }
 
+/*
+ * Free the dentries on @list, a private list of dentries taken off an
+ * LRU, that are still unused.  Must be called with dcache_lock held; it
+ * is dropped and retaken on the way.
+ */
+static void shrink_dentry_list(struct list_head *list)
+{
+	struct dentry *dentry;
+
+	while (!list_empty(list)) {
+		dentry = list_entry(list->prev, struct dentry, d_lru);
+		dentry_lru_del_init(dentry);
+		spin_lock(&dentry->d_lock);
+		/*
+		 * We found an inuse dentry which was not removed from
+		 * the LRU because of laziness during lookup.  Do not free
+		 * it - just keep it off the LRU list.
+		 */
+		if (atomic_read(&dentry->d_count)) {
+			spin_unlock(&dentry->d_lock);
+			continue;
+		}
+		prune_one_dentry(dentry);
+		/* dentry->d_lock was dropped in prune_one_dentry() */
+		cond_resched_lock(&dcache_lock);
+	}
+}
+
 /*
  * Shrink the dentry LRU on a given superblock.
  * @sb   : superblock to shrink dentry LRU.
@@ -499,23 +563,7 @@ restart:
 			cond_resched_lock(&dcache_lock);
 		}
 	}
-	while (!list_empty(&tmp)) {
-		dentry = list_entry(tmp.prev, struct dentry, d_lru);
-		dentry_lru_del_init(dentry);
-		spin_lock(&dentry->d_lock);
-		/*
-		 * We found an inuse dentry which was not removed from
-		 * the LRU because of laziness during lookup.  Do not free
-		 * it - just keep it off the LRU list.
-		 */
-		if (atomic_read(&dentry->d_count)) {
-			spin_unlock(&dentry->d_lock);
-			continue;
-		}
-		prune_one_dentry(dentry);
-		/* dentry->d_lock was dropped in prune_one_dentry() */
-		cond_resched_lock(&dcache_lock);
-	}
+	shrink_dentry_list(&tmp);
 	if (count == NULL && !list_empty(&sb->s_dentry_lru))
 		goto restart;
 	if (count != NULL)
@@ -602,6 +650,74 @@ static void prune_dcache(int count)
 	spin_unlock(&dcache_lock);
 }
 
+/*
+ * Free up to *@count of the oldest unused negative dentries of @sb.
+ * Positive dentries met on the way keep their place on the LRU.
+ * Must be called with dcache_lock held.
+ */
+static void __prune_negative_dentries_sb(struct super_block *sb, int *count)
+{
+	LIST_HEAD(skipped);
+	LIST_HEAD(tmp);
+	struct dentry *dentry;
+	int scan = NEGATIVE_DENTRY_SCAN;
+
+	while (*count > 0 && scan-- && !list_empty(&sb->s_dentry_lru)) {
+		dentry = list_entry(sb->s_dentry_lru.prev,
+				struct dentry, d_lru);
+		if (dentry->d_inode || atomic_read(&dentry->d_count)) {
+			list_move(&dentry->d_lru, &skipped);
+		} else {
+			list_move_tail(&dentry->d_lru, &tmp);
+			(*count)--;
+		}
+		cond_resched_lock(&dcache_lock);
+	}
+	shrink_dentry_list(&tmp);
+	list_splice_tail(&skipped, &sb->s_dentry_lru);
+}
+
+/*
+ * Bring the negative dentries back a tenth under the limit, so that the
+ * work does not run again for every further failed lookup.
+ */
+static void prune_negative_dentries(struct work_struct *work)
+{
+	struct super_block *sb, *n;
+	int count;
+
+	spin_lock(&dcache_lock);
+	if (!negative_dentries_over_limit())
+		goto out;
+	count = dentry_stat.nr_negative - sysctl_negative_dentry_limit +
+		sysctl_negative_dentry_limit / 10;
+
+	spin_lock(&sb_lock);
+	list_for_each_entry_safe(sb, n, &super_blocks, s_list) {
+		if (list_empty(&sb->s_instances))
+			continue;
+		if (sb->s_nr_dentry_unused == 0)
+			continue;
+		sb->s_count++;
+		spin_unlock(&sb_lock);
+		/* as in prune_dcache(), stay away from an unmount */
+		if (down_read_trylock(&sb->s_umount)) {
+			if (sb->s_root != NULL)
+				__prune_negative_dentries_sb(sb, &count);
+			up_read(&sb->s_umount);
+		}
+		spin_lock(&sb_lock);
+		/* lock was dropped, must reset next */
+		list_safe_reset_next(sb, n, s_list);
+		__put_super(sb);
+		if (count <= 0)
+			break;
+	}
+	spin_unlock(&sb_lock);
+out:
+	spin_unlock(&dcache_lock);
+}
+
 /**
  * shrink_dcache_sb - shrink dcache for a superblock
  * @sb: superblock
@@ -991,8 +1107,11 @@ EXPORT_SYMBOL(d_alloc_name);
 /* the caller must hold dcache_lock */
 static void __d_instantiate(struct dentry *dentry, struct inode *inode)
 {
-	if (inode)
+	if (inode) {
 		list_add(&dentry->d_alias, &inode->i_dentry);
+		if (!list_empty(&dentry->d_lru))
+			dentry_stat.nr_negative--;
+	}
 	dentry->d_inode = inode;
 	fsnotify_d_instantiate(dentry, inode);
 }
@@ -2324,6 +2443,10 @@ static void __init dcache_init(void)
 	
 	register_shrinker(&dcache_shrinker);
 
+	/* let negative dentries take up to about 1% of memory */
+	sysctl_negative_dentry_limit = totalram_pages * (PAGE_SIZE / 100) /
+				       sizeof(struct dentry);
+
 	/* Hash may have been set up in dcache_init_early */
 	if (!hashdist)
 		return;
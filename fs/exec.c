@@ -55,6 +55,8 @@
 #include <linux/fsnotify.h>
 #include <linux/fs_struct.h>
 #include <linux/pipe_fs_i.h>
+#include <linux/oom.h>
+#include <linux/launch_prefetch.h>
 
 #include <asm/uaccess.h>
 #include <asm/mmu_context.h>
@@ -893,6 +895,7 @@ static int de_thread(struct task_struct *tsk)
 
 		tsk->group_leader = tsk;
 		leader->group_leader = tsk;
+		lowmem_adj_update(tsk);
 
 		tsk->exit_signal = SIGCHLD;
 
@@ -1024,6 +1027,8 @@ int flush_old_exec(struct linux_binprm * bprm)
 
 	bprm->mm = NULL;		/* We're using it now */
 
+	launch_prefetch_exec(current->mm);
+
 	set_fs(USER_DS);
 	current->flags &= ~PF_RANDOMIZE;
 	flush_thread();
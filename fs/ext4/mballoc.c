@@ -24,6 +24,8 @@
 #include "mballoc.h"
 #include <linux/debugfs.h>
 #include <linux/slab.h>
+#include <linux/genhd.h>
+#include <linux/workqueue.h>
 #include <trace/events/ext4.h>
 
 /*
@@ -338,6 +340,7 @@
 static struct kmem_cache *ext4_pspace_cachep;
 static struct kmem_cache *ext4_ac_cachep;
 static struct kmem_cache *ext4_free_ext_cachep;
+static struct workqueue_struct *ext4_discard_wq;
 
 /* We create slab caches for groupinfo data structures based on the
  * superblock block size.  There will be one per mounted filesystem for
@@ -351,6 +354,7 @@ static void ext4_mb_generate_from_pa(struct super_block *sb, void *bitmap,
 static void ext4_mb_generate_from_freelist(struct super_block *sb, void *bitmap,
 						ext4_group_t group);
 static void release_blocks_on_commit(journal_t *journal, transaction_t *txn);
+static void ext4_discard_work(struct work_struct *work);
 
 static inline void *mb_correct_addr_and_bit(int *bit, void *addr)
 {
@@ -2496,6 +2500,8 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
 	sbi->s_mb_group_prealloc = MB_DEFAULT_GROUP_PREALLOC;
+	sbi->s_mb_discard_delay = MB_DEFAULT_DISCARD_DELAY;
+	INIT_DELAYED_WORK(&sbi->s_discard_work, ext4_discard_work);
 
 	sbi->s_locality_groups = alloc_percpu(struct ext4_locality_group);
 	if (sbi->s_locality_groups == NULL) {
@@ -2553,6 +2559,9 @@ int ext4_mb_release(struct super_block *sb)
 	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	struct kmem_cache *cachep = get_groupinfo_cache(sb->s_blocksize_bits);
 
+	/* the journal is gone, nothing can flag groups any more */
+	cancel_delayed_work_sync(&sbi->s_discard_work);
+
 	if (sbi->s_group_info) {
 		for (i = 0; i < ngroups; i++) {
 			grinfo = ext4_get_group_info(sb, i);
@@ -2606,20 +2615,189 @@ int ext4_mb_release(struct super_block *sb)
 	return 0;
 }
 
-static inline void ext4_issue_discard(struct super_block *sb,
+static int ext4_issue_discard(struct super_block *sb,
 		ext4_group_t block_group, ext4_grpblk_t block, int count)
 {
 	int ret;
 	ext4_fsblk_t discard_block;
+	sector_t sector, nr_sects;
 
 	discard_block = block + ext4_group_first_block_no(sb, block_group);
 	trace_ext4_discard_blocks(sb,
 			(unsigned long long) discard_block, count);
-	ret = sb_issue_discard(sb, discard_block, count);
-	if (ret == EOPNOTSUPP) {
+
+	/*
+	 * The freed blocks are not reused until the buddy says so, no
+	 * barrier is needed to order the discard against the journal.
+	 */
+	sector = discard_block << (sb->s_blocksize_bits - 9);
+	nr_sects = (sector_t)count << (sb->s_blocksize_bits - 9);
+	ret = blkdev_issue_discard(sb->s_bdev, sector, nr_sects, GFP_NOFS,
+				   BLKDEV_IFL_WAIT);
+	if (ret == -EOPNOTSUPP) {
 		ext4_warning(sb, "discard not supported, disabling");
 		clear_opt(EXT4_SB(sb)->s_mount_opt, DISCARD);
 	}
+	return ret;
+}
+
+/*
+ * Returns true if the whole disk under @sb has not seen a request since
+ * the last call, and remembers the current count for the next one.
+ */
+static int ext4_discard_disk_idle(struct super_block *sb)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct hd_struct *part = &sb->s_bdev->bd_disk->part0;
+	unsigned long ios;
+	int idle;
+
+	ios = part_stat_read(part, ios[READ]) +
+		part_stat_read(part, ios[WRITE]);
+	idle = ios == sbi->s_discard_ios && !part_in_flight(part);
+	sbi->s_discard_ios = ios;
+
+	return idle;
+}
+
+/*
+ * Blocks of @group that line up with the device's discard granularity.
+ * The freed space is trimmed in whole erase units, so that the card can
+ * reclaim them without copying live data out first.
+ */
+static ext4_grpblk_t ext4_discard_unit(struct super_block *sb,
+				       ext4_group_t group,
+				       ext4_grpblk_t *phase)
+{
+	struct request_queue *q = bdev_get_queue(sb->s_bdev);
+	sector_t part_start = get_start_sect(sb->s_bdev);
+	unsigned int sects_per_block = sb->s_blocksize >> 9;
+	ext4_grpblk_t unit;
+	u64 base;
+
+	*phase = 0;
+	unit = q->limits.discard_granularity >> sb->s_blocksize_bits;
+	if (unit <= 1 || part_start % sects_per_block)
+		return 1;
+
+	base = ext4_group_first_block_no(sb, group) +
+		part_start / sects_per_block;
+	*phase = do_div(base, unit);
+	return unit;
+}
+
+/*
+ * Discard the free space of @group, keeping each range marked in use in
+ * the buddy while its discard is in flight so that it is not handed out.
+ */
+static int ext4_trim_group(struct super_block *sb, ext4_group_t group)
+{
+	struct ext4_buddy e4b;
+	struct ext4_free_extent ex;
+	ext4_grpblk_t start, next, first, last, max, unit, phase;
+	ext4_fsblk_t end;
+	void *bitmap;
+	int ret;
+
+	ret = ext4_mb_load_buddy(sb, group, &e4b);
+	if (ret)
+		return ret;
+	bitmap = e4b.bd_bitmap;
+
+	max = EXT4_BLOCKS_PER_GROUP(sb);
+	end = ext4_blocks_count(EXT4_SB(sb)->s_es) -
+		ext4_group_first_block_no(sb, group);
+	if (end < max)
+		max = end;
+	unit = ext4_discard_unit(sb, group, &phase);
+
+	ext4_lock_group(sb, group);
+	for (start = 0; start < max; start = next + 1) {
+		start = mb_find_next_zero_bit(bitmap, max, start);
+		if (start >= max)
+			break;
+		next = mb_find_next_bit(bitmap, max, start);
+
+		first = start;
+		if ((phase + first) % unit)
+			first += unit - (phase + first) % unit;
+		last = next - (phase + next) % unit;
+		if (last <= first)
+			continue;
+
+		ex.fe_group = group;
+		ex.fe_start = first;
+		ex.fe_len = last - first;
+		mb_mark_used(&e4b, &ex);
+		ext4_unlock_group(sb, group);
+
+		ret = ext4_issue_discard(sb, group, first, last - first);
+
+		ext4_lock_group(sb, group);
+		mb_free_blocks(NULL, &e4b, first, last - first);
+		if (ret)
+			break;
+	}
+	ext4_unlock_group(sb, group);
+
+	ext4_mb_unload_buddy(&e4b);
+	return ret;
+}
+
+/*
+ * Discard the groups that had blocks freed, while the disk stays idle.
+ * When it gets busy the remaining groups stay flagged for the next run.
+ */
+static void ext4_discard_work(struct work_struct *work)
+{
+	struct ext4_sb_info *sbi = container_of(work, struct ext4_sb_info,
+						s_discard_work.work);
+	struct super_block *sb = sbi->s_sb;
+	struct hd_struct *part = &sb->s_bdev->bd_disk->part0;
+	ext4_group_t group, ngroups = ext4_get_groups_count(sb);
+	struct ext4_group_info *grp;
+	int ret;
+
+	if (!ext4_discard_disk_idle(sb))
+		goto again;
+
+	for (group = 0; group < ngroups; group++) {
+		if (!test_opt(sb, DISCARD))
+			return;
+
+		grp = ext4_get_group_info(sb, group);
+		if (!test_and_clear_bit(EXT4_GROUP_INFO_NEED_TRIM_BIT,
+					&grp->bb_state))
+			continue;
+
+		ret = ext4_trim_group(sb, group);
+		if (ret && ret != -EOPNOTSUPP)
+			set_bit(EXT4_GROUP_INFO_NEED_TRIM_BIT, &grp->bb_state);
+		if (ret == -EOPNOTSUPP)
+			return;
+
+		if (part_in_flight(part))
+			goto again;
+	}
+
+	/* do not count our own discards against the next idle check */
+	ext4_discard_disk_idle(sb);
+	return;
+again:
+	queue_delayed_work(ext4_discard_wq, &sbi->s_discard_work,
+			   msecs_to_jiffies(sbi->s_mb_discard_delay));
+}
+
+/* Called with blocks of @group freed, the discard waits for the disk */
+static void ext4_discard_later(struct super_block *sb, ext4_group_t group)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+
+	set_bit(EXT4_GROUP_INFO_NEED_TRIM_BIT,
+		&ext4_get_group_info(sb, group)->bb_state);
+	if (queue_delayed_work(ext4_discard_wq, &sbi->s_discard_work,
+			       msecs_to_jiffies(sbi->s_mb_discard_delay)))
+		ext4_discard_disk_idle(sb);
 }
 
 /*
@@ -2642,8 +2820,7 @@ static void release_blocks_on_commit(journal_t *journal, transaction_t *txn)
 			 entry->count, entry->group, entry);
 
 		if (test_opt(sb, DISCARD))
-			ext4_issue_discard(sb, entry->group,
-					entry->start_blk, entry->count);
+			ext4_discard_later(sb, entry->group);
 
 		err = ext4_mb_load_buddy(sb, entry->group, &e4b);
 		/* we expect to find existing buddy because it's pinned */
@@ -2734,6 +2911,14 @@ int __init init_ext4_mballoc(void)
 		kmem_cache_destroy(ext4_ac_cachep);
 		return -ENOMEM;
 	}
+
+	ext4_discard_wq = create_singlethread_workqueue("ext4-discard");
+	if (ext4_discard_wq == NULL) {
+		kmem_cache_destroy(ext4_pspace_cachep);
+		kmem_cache_destroy(ext4_ac_cachep);
+		kmem_cache_destroy(ext4_free_ext_cachep);
+		return -ENOMEM;
+	}
 	ext4_create_debugfs_entry();
 	return 0;
 }
@@ -2749,6 +2934,7 @@ void exit_ext4_mballoc(void)
 	kmem_cache_destroy(ext4_pspace_cachep);
 	kmem_cache_destroy(ext4_ac_cachep);
 	kmem_cache_destroy(ext4_free_ext_cachep);
+	destroy_workqueue(ext4_discard_wq);
 
 	for (i = 0; i < NR_GRPINFO_CACHES; i++) {
 		struct kmem_cache *cachep = ext4_groupinfo_caches[i];
@@ -4704,7 +4890,7 @@ do_more:
 		mb_free_blocks(inode, &e4b, bit, count);
 		ext4_mb_return_to_preallocation(inode, &e4b, block, count);
 		if (test_opt(sb, DISCARD))
-			ext4_issue_discard(sb, block_group, bit, count);
+			ext4_discard_later(sb, block_group);
 	}
 
 	ret = ext4_free_blks_count(sb, gdp) + count;
@@ -94,6 +94,11 @@ extern u8 mb_enable_debug;
  */
 #define MB_DEFAULT_GROUP_PREALLOC	512
 
+/*
+ * freed blocks are discarded once the disk has been idle this long, in ms
+ */
+#define MB_DEFAULT_DISCARD_DELAY	5000
+
 
 struct ext4_free_data {
 	/* this links the free block information from group_info */
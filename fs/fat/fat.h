@@ -7,6 +7,7 @@
 #include <linux/fs.h>
 #include <linux/mutex.h>
 #include <linux/ratelimit.h>
+#include <linux/workqueue.h>
 #include <linux/msdos_fs.h>
 
 /*
@@ -86,6 +87,17 @@ struct msdos_sb_info {
 
 	struct ratelimit_state ratelimit;
 
+	/*
+	 * One bit per cluster, set while the cluster is free. It is filled
+	 * in by free_map_work after mount and only used for allocation
+	 * once free_map_ready is set. Protected by fat_lock.
+	 */
+	unsigned long *free_map;
+	int free_map_ready;
+	int free_map_stop;
+	struct work_struct free_map_work;
+	struct super_block *free_map_sb;
+
 	spinlock_t inode_hash_lock;
 	struct hlist_head inode_hashtable[FAT_HASH_SIZE];
 };
@@ -108,6 +120,7 @@ struct msdos_inode_info {
 	int i_start;		/* first cluster or 0 */
 	int i_logstart;		/* logical first cluster */
 	int i_attrs;		/* unused attribute bits */
+	int i_alloc_hint;	/* cluster after the last one allocated */
 	loff_t i_pos;		/* on-disk position of directory entry or 0 */
 	struct hlist_node i_fat_hash;	/* hash by i_location */
 	struct inode vfs_inode;
@@ -300,6 +313,10 @@ extern int fat_alloc_clusters(struct inode *inode, int *cluster,
 			      int nr_cluster);
 extern int fat_free_clusters(struct inode *inode, int cluster);
 extern int fat_count_free_clusters(struct super_block *sb);
+extern void fat_free_map_start(struct super_block *sb);
+extern void fat_free_map_stop(struct super_block *sb);
+extern int fat_free_map_init(void);
+extern void fat_free_map_exit(void);
 
 /* fat/file.c */
 extern long fat_generic_ioctl(struct file *filp, unsigned int cmd,
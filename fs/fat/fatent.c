@@ -7,6 +7,8 @@
 #include <linux/fs.h>
 #include <linux/msdos_fs.h>
 #include <linux/blkdev.h>
+#include <linux/bitmap.h>
+#include <linux/vmalloc.h>
 #include "fat.h"
 
 struct fatent_operations {
@@ -452,6 +454,125 @@ static void fat_collect_bhs(struct buffer_head **bhs, int *nr_bhs,
 	}
 }
 
+/* New regular files start on a free run of this size if there is one */
+#define FAT_ALLOC_RUN_SIZE	(1024 * 1024)
+
+/* Next free cluster at or after @entry, wrapping around; -1 if none */
+static int fat_map_next_free(struct msdos_sb_info *sbi, int entry)
+{
+	unsigned long next;
+
+	if (entry < FAT_START_ENT || entry >= sbi->max_cluster)
+		entry = FAT_START_ENT;
+
+	next = find_next_bit(sbi->free_map, sbi->max_cluster, entry);
+	if (next < sbi->max_cluster)
+		return next;
+
+	next = find_next_bit(sbi->free_map, entry, FAT_START_ENT);
+	if (next < entry)
+		return next;
+	return -1;
+}
+
+/* First run of @len free clusters at or after @start, wrapping; -1 if none */
+static int fat_map_find_run(struct msdos_sb_info *sbi, int start, int len)
+{
+	unsigned long max = sbi->max_cluster, pos, end;
+	int wrapped = 0;
+
+	if (start < FAT_START_ENT || start >= max)
+		start = FAT_START_ENT;
+
+	pos = start;
+	for (;;) {
+		pos = find_next_bit(sbi->free_map, max, pos);
+		if (pos >= max) {
+			if (wrapped)
+				return -1;
+			wrapped = 1;
+			pos = FAT_START_ENT;
+			continue;
+		}
+		if (wrapped && pos >= start)
+			return -1;
+
+		end = find_next_zero_bit(sbi->free_map, max, pos);
+		if (end - pos >= len)
+			return pos;
+		pos = end;
+	}
+}
+
+/*
+ * fat_alloc_clusters() using the free cluster bitmap instead of reading
+ * the FAT to find free entries. A file continues from its last cluster,
+ * and a new regular file starts on a free run of FAT_ALLOC_RUN_SIZE that
+ * prev_free then skips, so files written at the same time do not
+ * interleave. Returns -ENOSPC if the bitmap has no free cluster left.
+ */
+static int fat_alloc_clusters_map(struct inode *inode, int *cluster,
+				  int nr_cluster, struct fat_entry *fatent,
+				  struct buffer_head **bhs, int *nr_bhs,
+				  int *idx_clus)
+{
+	struct super_block *sb = inode->i_sb;
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	struct msdos_inode_info *i = MSDOS_I(inode);
+	struct fatent_operations *ops = sbi->fatent_ops;
+	struct fat_entry prev_ent;
+	int entry, hinted, err;
+
+	entry = -1;
+	if (!i->i_start && S_ISREG(inode->i_mode)) {
+		int len = max(FAT_ALLOC_RUN_SIZE >> sbi->cluster_bits, 1);
+
+		entry = fat_map_find_run(sbi, sbi->prev_free + 1, len);
+		if (entry >= 0)
+			sbi->prev_free = entry + len - 1;
+	} else if (i->i_alloc_hint >= FAT_START_ENT &&
+		   i->i_alloc_hint < sbi->max_cluster &&
+		   test_bit(i->i_alloc_hint, sbi->free_map)) {
+		entry = i->i_alloc_hint;
+	}
+	hinted = entry >= 0;
+	if (!hinted)
+		entry = sbi->prev_free + 1;
+
+	fatent_init(&prev_ent);
+	while (*idx_clus < nr_cluster) {
+		entry = fat_map_next_free(sbi, entry);
+		if (entry < 0)
+			return -ENOSPC;
+
+		err = fat_ent_read(inode, fatent, entry);
+		if (err < 0)
+			return err;
+		__clear_bit(entry, sbi->free_map);
+		if (err != FAT_ENT_FREE)
+			continue;	/* stale bit, the FAT is what counts */
+
+		/* make the cluster chain */
+		ops->ent_put(fatent, FAT_ENT_EOF);
+		if (prev_ent.nr_bhs)
+			ops->ent_put(&prev_ent, entry);
+
+		fat_collect_bhs(bhs, nr_bhs, fatent);
+
+		if (!hinted || entry > sbi->prev_free)
+			sbi->prev_free = entry;
+		if (sbi->free_clusters != -1)
+			sbi->free_clusters--;
+		sb->s_dirt = 1;
+
+		cluster[(*idx_clus)++] = entry;
+		prev_ent = *fatent;
+		entry++;
+	}
+
+	return 0;
+}
+
 int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 {
 	struct super_block *sb = inode->i_sb;
@@ -474,6 +595,15 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	count = FAT_START_ENT;
 	fatent_init(&prev_ent);
 	fatent_init(&fatent);
+
+	if (sbi->free_map_ready) {
+		err = fat_alloc_clusters_map(inode, cluster, nr_cluster, &fatent,
+					     bhs, &nr_bhs, &idx_clus);
+		if (err == -ENOSPC)
+			goto no_space;
+		goto out;
+	}
+
 	fatent_set_entry(&fatent, sbi->prev_free + 1);
 	while (count < sbi->max_cluster) {
 		if (fatent.entry >= sbi->max_cluster)
@@ -492,6 +622,8 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 				ops->ent_put(&fatent, FAT_ENT_EOF);
 				if (prev_ent.nr_bhs)
 					ops->ent_put(&prev_ent, entry);
+				if (sbi->free_map)
+					__clear_bit(entry, sbi->free_map);
 
 				fat_collect_bhs(bhs, &nr_bhs, &fatent);
 
@@ -517,6 +649,7 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 		} while (fat_ent_next(sbi, &fatent));
 	}
 
+no_space:
 	/* Couldn't allocate the free entries */
 	sbi->free_clusters = 0;
 	sbi->free_clus_valid = 1;
@@ -524,6 +657,8 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	err = -ENOSPC;
 
 out:
+	if (!err)
+		MSDOS_I(inode)->i_alloc_hint = cluster[nr_cluster - 1] + 1;
 	unlock_fat(sbi);
 	fatent_brelse(&fatent);
 	if (!err) {
@@ -584,6 +719,8 @@ int fat_free_clusters(struct inode *inode, int cluster)
 		}
 
 		ops->ent_put(&fatent, FAT_ENT_FREE);
+		if (sbi->free_map)
+			__set_bit(fatent.entry, sbi->free_map);
 		if (sbi->free_clusters != -1) {
 			sbi->free_clusters++;
 			sb->s_dirt = 1;
@@ -646,6 +783,10 @@ int fat_count_free_clusters(struct super_block *sb)
 	unsigned long reada_blocks, reada_mask, cur_block;
 	int err = 0, free;
 
+	/* the bitmap build counts the free clusters as it goes */
+	if (sbi->free_map && !sbi->free_clus_valid)
+		flush_work(&sbi->free_map_work);
+
 	lock_fat(sbi);
 	if (sbi->free_clusters != -1 && sbi->free_clus_valid)
 		goto out;
@@ -682,3 +823,109 @@ out:
 	unlock_fat(sbi);
 	return err;
 }
+
+static struct workqueue_struct *fat_free_map_wq;
+
+/*
+ * Fills in the free cluster bitmap one FAT block at a time, taking
+ * fat_lock per block so allocations and frees can go on meanwhile: they
+ * update the bits of blocks already read, and the blocks not read yet
+ * are picked up in their new state.
+ */
+static void fat_free_map_build(struct work_struct *work)
+{
+	struct msdos_sb_info *sbi = container_of(work, struct msdos_sb_info,
+						 free_map_work);
+	struct super_block *sb = sbi->free_map_sb;
+	struct fatent_operations *ops = sbi->fatent_ops;
+	struct fat_entry fatent;
+	unsigned long reada_blocks, reada_mask, cur_block;
+
+	reada_blocks = FAT_READA_SIZE >> sb->s_blocksize_bits;
+	reada_mask = reada_blocks - 1;
+	cur_block = 0;
+
+	fatent_init(&fatent);
+	fatent_set_entry(&fatent, FAT_START_ENT);
+	while (fatent.entry < sbi->max_cluster) {
+		if (sbi->free_map_stop)
+			goto out;
+
+		/* readahead of fat blocks */
+		if ((cur_block & reada_mask) == 0) {
+			unsigned long rest = sbi->fat_length - cur_block;
+			fat_ent_reada(sb, &fatent, min(reada_blocks, rest));
+		}
+		cur_block++;
+
+		lock_fat(sbi);
+		if (fat_ent_read_block(sb, &fatent)) {
+			unlock_fat(sbi);
+			goto out;
+		}
+		do {
+			if (ops->ent_get(&fatent) == FAT_ENT_FREE)
+				__set_bit(fatent.entry, sbi->free_map);
+			else
+				__clear_bit(fatent.entry, sbi->free_map);
+		} while (fat_ent_next(sbi, &fatent));
+		unlock_fat(sbi);
+
+		cond_resched();
+	}
+
+	lock_fat(sbi);
+	sbi->free_clusters = bitmap_weight(sbi->free_map, sbi->max_cluster);
+	sbi->free_clus_valid = 1;
+	sbi->free_map_ready = 1;
+	sb->s_dirt = 1;
+	unlock_fat(sbi);
+out:
+	fatent_brelse(&fatent);
+}
+
+/*
+ * Called at mount time. Without the memory for the bitmap, allocation
+ * keeps scanning the FAT.
+ */
+void fat_free_map_start(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	size_t size = BITS_TO_LONGS(sbi->max_cluster) * sizeof(long);
+
+	sbi->free_map = vmalloc(size);
+	if (!sbi->free_map)
+		return;
+	memset(sbi->free_map, 0, size);
+
+	sbi->free_map_sb = sb;
+	INIT_WORK(&sbi->free_map_work, fat_free_map_build);
+	queue_work(fat_free_map_wq, &sbi->free_map_work);
+}
+
+void fat_free_map_stop(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+
+	if (!sbi->free_map)
+		return;
+
+	sbi->free_map_stop = 1;
+	cancel_work_sync(&sbi->free_map_work);
+	vfree(sbi->free_map);
+	sbi->free_map = NULL;
+	sbi->free_map_ready = 0;
+}
+
+int __init fat_free_map_init(void)
+{
+	fat_free_map_wq = create_singlethread_workqueue("fat_free_map");
+	if (!fat_free_map_wq)
+		return -ENOMEM;
+	return 0;
+}
+
+void fat_free_map_exit(void)
+{
+	destroy_workqueue(fat_free_map_wq);
+}
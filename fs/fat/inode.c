@@ -492,6 +492,8 @@ static void fat_put_super(struct super_block *sb)
 
 	lock_kernel();
 
+	fat_free_map_stop(sb);
+
 	if (sb->s_dirt)
 		fat_write_super(sb);
 
@@ -517,6 +519,7 @@ static struct inode *fat_alloc_inode(struct super_block *sb)
 	ei = kmem_cache_alloc(fat_inode_cachep, GFP_NOFS);
 	if (!ei)
 		return NULL;
+	ei->i_alloc_hint = 0;
 	return &ei->vfs_inode;
 }
 
@@ -1518,6 +1521,8 @@ int fat_fill_super(struct super_block *sb, void *data, int silent,
 		goto out_fail;
 	}
 
+	fat_free_map_start(sb);
+
 	return 0;
 
 out_invalid:
@@ -1600,12 +1605,18 @@ static int __init init_fat_fs(void)
 	if (err)
 		return err;
 
-	err = fat_init_inodecache();
+	err = fat_free_map_init();
 	if (err)
 		goto failed;
 
+	err = fat_init_inodecache();
+	if (err)
+		goto failed_free_map;
+
 	return 0;
 
+failed_free_map:
+	fat_free_map_exit();
 failed:
 	fat_cache_destroy();
 	return err;
@@ -1613,6 +1624,7 @@ failed:
 
 static void __exit exit_fat_fs(void)
 {
+	fat_free_map_exit();
 	fat_cache_destroy();
 	fat_destroy_inodecache();
 }
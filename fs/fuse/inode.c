@@ -534,6 +534,7 @@ void fuse_conn_init(struct fuse_conn *fc)
 	INIT_LIST_HEAD(&fc->entry);
 	atomic_set(&fc->num_waiting, 0);
 	fc->max_background = FUSE_DEFAULT_MAX_BACKGROUND;
+	fc->max_pages = FUSE_MAX_PAGES_PER_REQ;
 	fc->congestion_threshold = FUSE_DEFAULT_CONGESTION_THRESHOLD;
 	fc->khctr = 0;
 	fc->polled_files = RB_ROOT;
@@ -830,6 +831,14 @@ static void process_init_reply(struct fuse_conn *fc, struct fuse_req *req)
 		fc->minor = arg->minor;
 		fc->max_write = arg->minor < 5 ? 4096 : arg->max_write;
 		fc->max_write = max_t(unsigned, 4096, fc->max_write);
+		/*
+		 * A filesystem asking for writes above the default request
+		 * size gets requests that large for reads and writes.
+		 */
+		if (fc->big_writes)
+			fc->max_pages = clamp_t(unsigned,
+				DIV_ROUND_UP(fc->max_write, PAGE_CACHE_SIZE),
+				FUSE_MAX_PAGES_PER_REQ, FUSE_MAX_MAX_PAGES);
 		fc->conn_init = 1;
 	}
 	fc->blocked = 0;
@@ -16,6 +16,7 @@
 #include <linux/writeback.h>
 #include <linux/buffer_head.h>
 #include <linux/falloc.h>
+#include <linux/namei.h>
 
 #include <asm/ioctls.h>
 
@@ -540,6 +541,104 @@ static int ioctl_fsthaw(struct file *filp)
 	return thaw_super(sb);
 }
 
+struct prefetch_dir_buf {
+	char *names;		/* NUL terminated, one after another */
+	unsigned int used;
+};
+
+static int prefetch_dir_filldir(void *__buf, const char *name, int namlen,
+				loff_t offset, u64 ino, unsigned int d_type)
+{
+	struct prefetch_dir_buf *buf = __buf;
+
+	if (name[0] == '.' && (namlen == 1 || (namlen == 2 && name[1] == '.')))
+		return 0;
+	/* full: readdir stops here and hands this entry out next time */
+	if (buf->used + namlen + 1 > PAGE_SIZE)
+		return -EINVAL;
+
+	memcpy(buf->names + buf->used, name, namlen);
+	buf->names[buf->used + namlen] = '\0';
+	buf->used += namlen + 1;
+	return 0;
+}
+
+/*
+ * Without help from the filesystem: read the directory a page of names
+ * at a time and look each name up, which leaves its dentry in the dcache
+ * and its inode in the icache.
+ */
+static int generic_prefetch_dir(struct file *filp)
+{
+	struct dentry *parent = filp->f_path.dentry;
+	struct inode *dir = parent->d_inode;
+	struct prefetch_dir_buf buf;
+	int error;
+
+	buf.names = (char *)__get_free_page(GFP_KERNEL);
+	if (!buf.names)
+		return -ENOMEM;
+
+	filp->f_pos = 0;
+	for (;;) {
+		struct dentry *dentry;
+		unsigned int off, len;
+
+		buf.used = 0;
+		error = vfs_readdir(filp, prefetch_dir_filldir, &buf);
+		if (error || !buf.used)
+			break;
+
+		mutex_lock(&dir->i_mutex);
+		for (off = 0; off < buf.used; off += len + 1) {
+			len = strlen(buf.names + off);
+			dentry = lookup_one_len(buf.names + off, parent, len);
+			if (!IS_ERR(dentry))
+				dput(dentry);
+			if (fatal_signal_pending(current)) {
+				error = -EINTR;
+				break;
+			}
+		}
+		mutex_unlock(&dir->i_mutex);
+		if (error)
+			break;
+		cond_resched();
+	}
+
+	free_page((unsigned long)buf.names);
+	return error;
+}
+
+/*
+ * Bring a whole directory's dentries and inodes into the caches in one
+ * pass, ahead of a scan that will stat or open most of its entries.  A
+ * filesystem that can do it for less than a lookup per name, from what
+ * its readdir already has in hand, provides ->prefetch_dir().
+ */
+static int ioctl_prefetch_dir(struct file *filp)
+{
+	struct inode *inode = filp->f_path.dentry->d_inode;
+	loff_t pos;
+	int error;
+
+	if (!S_ISDIR(inode->i_mode))
+		return -ENOTDIR;
+	if (!filp->f_op || !filp->f_op->readdir)
+		return -ENOTTY;
+	if (!(filp->f_mode & FMODE_READ))
+		return -EBADF;
+
+	if (filp->f_op->prefetch_dir)
+		return filp->f_op->prefetch_dir(filp);
+
+	/* the caller's place in the directory is not disturbed */
+	pos = filp->f_pos;
+	error = generic_prefetch_dir(filp);
+	filp->f_pos = pos;
+	return error;
+}
+
 /*
  * When you add any new common ioctls to the switches above and below
  * please update compat_sys_ioctl() too.
@@ -590,6 +689,10 @@ int do_vfs_ioctl(struct file *filp, unsigned int fd, unsigned int cmd,
 		error = ioctl_fsthaw(filp);
 		break;
 
+	case FIPREFETCHDIR:
+		error = ioctl_prefetch_dir(filp);
+		break;
+
 	case FS_IOC_FIEMAP:
 		return ioctl_fiemap(filp, arg);
 
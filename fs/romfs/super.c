@@ -138,8 +138,120 @@ static int romfs_readpage(struct file *file, struct page *page)
 	return ret;
 }
 
+#ifdef CONFIG_ROMFS_ON_MTD
+/* Most pages romfs_readpages() reads from the MTD in one transfer */
+#define ROMFS_MTD_READ_PAGES	8
+
+/* Bounce buffer for those transfers, allocated on first use */
+static DEFINE_MUTEX(romfs_mtd_buf_mutex);
+static void *romfs_mtd_buf;
+
+static int romfs_readpage_filler(void *data, struct page *page)
+{
+	return romfs_readpage(data, page);
+}
+
+/*
+ * Fill a run of pages with consecutive indices, locked and in the page
+ * cache, from one read of the medium.  Must hold romfs_mtd_buf_mutex.
+ */
+static void romfs_read_run(struct inode *inode, struct page **run,
+			   unsigned int nr)
+{
+	loff_t offset = page_offset(run[0]), size = i_size_read(inode);
+	unsigned long len = 0, chunk;
+	unsigned int i;
+	void *buf;
+	int ret = 0;
+
+	if (offset < size) {
+		len = min_t(loff_t, size - offset, nr << PAGE_SHIFT);
+		ret = romfs_dev_read(inode->i_sb,
+				     ROMFS_I(inode)->i_dataoffset + offset,
+				     romfs_mtd_buf, len);
+	}
+
+	for (i = 0; i < nr; i++) {
+		struct page *page = run[i];
+
+		if (ret < 0) {
+			SetPageError(page);
+		} else {
+			chunk = 0;
+			if (len > i << PAGE_SHIFT)
+				chunk = min_t(unsigned long,
+					      len - (i << PAGE_SHIFT), PAGE_SIZE);
+
+			buf = kmap_atomic(page, KM_USER0);
+			memcpy(buf, romfs_mtd_buf + (i << PAGE_SHIFT), chunk);
+			memset(buf + chunk, 0, PAGE_SIZE - chunk);
+			kunmap_atomic(buf, KM_USER0);
+			flush_dcache_page(page);
+			SetPageUptodate(page);
+		}
+		unlock_page(page);
+		page_cache_release(page);
+	}
+}
+
+/*
+ * NAND cannot be addressed by the CPU, so a romfs image on it cannot be
+ * executed in place and its pages have to be read into the page cache.
+ * A file's data is contiguous on the medium though, so readahead reads
+ * a run of pages with one MTD transfer rather than one per page, and
+ * the driver sets up its DMA once for the lot.
+ */
+static int romfs_readpages(struct file *file, struct address_space *mapping,
+			   struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct page *run[ROMFS_MTD_READ_PAGES];
+	unsigned int nr = 0;
+
+	if (!inode->i_sb->s_mtd)
+		return read_cache_pages(mapping, pages, romfs_readpage_filler,
+					file);
+
+	mutex_lock(&romfs_mtd_buf_mutex);
+	if (!romfs_mtd_buf)
+		romfs_mtd_buf = kmalloc(ROMFS_MTD_READ_PAGES * PAGE_SIZE,
+					GFP_KERNEL | __GFP_NOWARN);
+	if (!romfs_mtd_buf) {
+		mutex_unlock(&romfs_mtd_buf_mutex);
+		return read_cache_pages(mapping, pages, romfs_readpage_filler,
+					file);
+	}
+
+	while (!list_empty(pages)) {
+		struct page *page = list_entry(pages->prev, struct page, lru);
+
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index,
+					  GFP_KERNEL)) {
+			page_cache_release(page);
+			continue;
+		}
+
+		if (nr && (nr == ROMFS_MTD_READ_PAGES ||
+			   page->index != run[nr - 1]->index + 1)) {
+			romfs_read_run(inode, run, nr);
+			nr = 0;
+		}
+		run[nr++] = page;
+	}
+	if (nr)
+		romfs_read_run(inode, run, nr);
+
+	mutex_unlock(&romfs_mtd_buf_mutex);
+	return 0;
+}
+#endif
+
 static const struct address_space_operations romfs_aops = {
-	.readpage	= romfs_readpage
+	.readpage	= romfs_readpage,
+#ifdef CONFIG_ROMFS_ON_MTD
+	.readpages	= romfs_readpages,
+#endif
 };
 
 /*
@@ -645,6 +757,9 @@ static void __exit exit_romfs_fs(void)
 {
 	unregister_filesystem(&romfs_fs_type);
 	kmem_cache_destroy(romfs_inode_cachep);
+#ifdef CONFIG_ROMFS_ON_MTD
+	kfree(romfs_mtd_buf);
+#endif
 }
 
 module_init(init_romfs_fs);
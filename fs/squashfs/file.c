@@ -371,6 +371,115 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 }
 
 
+/*
+ * Decompress a datablock straight into the page cache pages it covers,
+ * instead of into an intermediate buffer that is then copied.  Pages that
+ * are already uptodate, or that cannot be grabbed without blocking, get
+ * their part of the block decompressed into a scratch page instead.
+ * On success all the pages are unlocked, on failure target_page is left
+ * locked for the caller.
+ */
+static int squashfs_readpage_block(struct page *target_page, u64 block,
+	int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = start_index | mask;
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int i, n, pages, missing = 0, res = -ENOMEM;
+	struct page **page;
+	void **pageaddr, *scratch = NULL;
+
+	if (end_index > file_end)
+		end_index = file_end;
+	pages = end_index - start_index + 1;
+
+	page = kmalloc(pages * (sizeof(*page) + sizeof(*pageaddr)), GFP_KERNEL);
+	if (page == NULL)
+		return res;
+	pageaddr = (void **) (page + pages);
+
+	/* Try to grab all the pages covered by the Squashfs block */
+	for (i = 0, n = start_index; i < pages; i++, n++) {
+		page[i] = (n == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+
+		if (page[i] && page[i] != target_page &&
+						PageUptodate(page[i])) {
+			unlock_page(page[i]);
+			page_cache_release(page[i]);
+			page[i] = NULL;
+		}
+
+		if (page[i] == NULL)
+			missing++;
+	}
+
+	if (missing) {
+		scratch = kmalloc(PAGE_CACHE_SIZE, GFP_KERNEL);
+		if (scratch == NULL)
+			goto release_pages;
+	}
+
+	for (i = 0; i < pages; i++)
+		pageaddr[i] = page[i] ? kmap(page[i]) : scratch;
+
+	res = squashfs_read_data(inode->i_sb, pageaddr, block, bsize, NULL,
+		msblk->block_size, pages);
+
+	for (i = 0; i < pages; i++) {
+		int avail;
+
+		if (page[i] == NULL)
+			continue;
+
+		/* zero the tail of the file's last page */
+		if (res >= 0) {
+			avail = clamp_t(int, res - i * PAGE_CACHE_SIZE, 0,
+				PAGE_CACHE_SIZE);
+			memset(pageaddr[i] + avail, 0, PAGE_CACHE_SIZE - avail);
+		}
+		kunmap(page[i]);
+	}
+
+	if (res < 0) {
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+		goto release_pages;
+	}
+
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL)
+			continue;
+
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		if (page[i] != target_page)
+			page_cache_release(page[i]);
+	}
+
+	kfree(scratch);
+	kfree(page);
+	return 0;
+
+release_pages:
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL || page[i] == target_page)
+			continue;
+
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+
+	kfree(scratch);
+	kfree(page);
+	return res;
+}
+
+
 static int squashfs_readpage(struct file *file, struct page *page)
 {
 	struct inode *inode = page->mapping->host;
@@ -412,15 +521,9 @@ static int squashfs_readpage(struct file *file, struct page *page)
 			/*
 			 * Read and decompress datablock.
 			 */
-			buffer = squashfs_get_datablock(inode->i_sb,
-								block, bsize);
-			if (buffer->error) {
-				ERROR("Unable to read page, block %llx, size %x"
-					"\n", block, bsize);
-				squashfs_cache_put(buffer);
+			if (squashfs_readpage_block(page, block, bsize))
 				goto error_out;
-			}
-			bytes = buffer->length;
+			return 0;
 		}
 	} else {
 		/*
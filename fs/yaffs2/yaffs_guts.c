@@ -298,10 +298,10 @@ int yaffs_IsManagedTempBuffer(yaffs_Device *dev, const __u8 *buffer)
  *  Simple hash function. Needs to have a reasonable spread
  */
 
-static Y_INLINE int yaffs_HashFunction(int n)
+static Y_INLINE int yaffs_HashFunction(yaffs_Device *dev, int n)
 {
 	n = abs(n);
-	return n % YAFFS_NOBJECT_BUCKETS;
+	return n % dev->nObjectBuckets;
 }
 
 /*
@@ -612,8 +612,123 @@ static __u16 yaffs_CalcNameSum(const YCHAR *name)
 	return sum;
 }
 
+/*
+ * Directory name index.
+ * Large directories get a table of their children hashed by name sum the
+ * first time they are searched, so lookups only compare names that can
+ * match.  Objects whose name is not known from the sum (lost+found, no
+ * name or no header yet) sit on an extra list that is always searched.
+ */
+static struct ylist_head *yaffs_NameIndexList(yaffs_Object *dir,
+					yaffs_Object *obj)
+{
+	yaffs_DirectoryStructure *ds = &dir->variant.directoryVariant;
+
+	if (obj->objectId == YAFFS_OBJECTID_LOSTNFOUND ||
+		!obj->sum || obj->hdrChunk <= 0)
+		return &ds->nameIndex[ds->nameIndexMask + 1];
+
+	return &ds->nameIndex[obj->sum & ds->nameIndexMask];
+}
+
+static void yaffs_FreeNameIndex(yaffs_Object *dir)
+{
+	yaffs_DirectoryStructure *ds = &dir->variant.directoryVariant;
+	struct ylist_head *lh, *n;
+	__u32 i;
+
+	if (!ds->nameIndex)
+		return;
+
+	for (i = 0; i <= ds->nameIndexMask + 1; i++)
+		ylist_for_each_safe(lh, n, &ds->nameIndex[i])
+			ylist_del_init(lh);
+
+	YFREE(ds->nameIndex);
+	ds->nameIndex = NULL;
+	ds->nameIndexCount = 0;
+}
+
+static void yaffs_NameIndexAdd(yaffs_Object *dir, yaffs_Object *obj)
+{
+	yaffs_DirectoryStructure *ds = &dir->variant.directoryVariant;
+
+	if (dir->variantType != YAFFS_OBJECT_TYPE_DIRECTORY || !ds->nameIndex)
+		return;
+
+	ylist_add(&obj->nameLink, yaffs_NameIndexList(dir, obj));
+	ds->nameIndexCount++;
+
+	/* Drop an overloaded index, the next lookup builds a larger one */
+	if (ds->nameIndexCount >
+		YAFFS_NAME_INDEX_LOAD * (int)(ds->nameIndexMask + 1) &&
+		ds->nameIndexMask + 1 < YAFFS_MAX_NAME_BUCKETS)
+		yaffs_FreeNameIndex(dir);
+}
+
+static void yaffs_NameIndexRemove(yaffs_Object *dir, yaffs_Object *obj)
+{
+	yaffs_DirectoryStructure *ds = &dir->variant.directoryVariant;
+
+	if (dir->variantType != YAFFS_OBJECT_TYPE_DIRECTORY || !ds->nameIndex ||
+		ylist_empty(&obj->nameLink))
+		return;
+
+	ylist_del_init(&obj->nameLink);
+	ds->nameIndexCount--;
+}
+
+static void yaffs_BuildNameIndex(yaffs_Object *dir)
+{
+	yaffs_DirectoryStructure *ds = &dir->variant.directoryVariant;
+	struct ylist_head *index;
+	struct ylist_head *i;
+	yaffs_Object *l;
+	int nChildren = 0;
+	__u32 nBuckets = 16;
+	__u32 b;
+
+	ylist_for_each(i, &ds->children)
+		nChildren++;
+
+	if (nChildren < YAFFS_NAME_INDEX_MIN)
+		return;
+
+	while (nBuckets * YAFFS_NAME_INDEX_LOAD < nChildren &&
+		nBuckets < YAFFS_MAX_NAME_BUCKETS)
+		nBuckets <<= 1;
+
+	index = YMALLOC((nBuckets + 1) * sizeof(struct ylist_head));
+	if (!index)
+		return;
+
+	for (b = 0; b <= nBuckets; b++)
+		YINIT_LIST_HEAD(&index[b]);
+
+	/* Load lazy objects first so that their sums are known */
+	ylist_for_each(i, &ds->children)
+		yaffs_CheckObjectDetailsLoaded(ylist_entry(i, yaffs_Object,
+							siblings));
+
+	ds->nameIndex = index;
+	ds->nameIndexMask = nBuckets - 1;
+	ds->nameIndexCount = 0;
+	ylist_for_each(i, &ds->children) {
+		l = ylist_entry(i, yaffs_Object, siblings);
+		ylist_add(&l->nameLink, yaffs_NameIndexList(dir, l));
+		ds->nameIndexCount++;
+	}
+}
+
 void yaffs_SetObjectName(yaffs_Object *obj, const YCHAR *name)
 {
+	yaffs_Object *parent = obj->parent;
+	int indexed = parent &&
+		parent->variantType == YAFFS_OBJECT_TYPE_DIRECTORY &&
+		!ylist_empty(&obj->nameLink);
+
+	if (indexed)
+		yaffs_NameIndexRemove(parent, obj);
 #ifdef CONFIG_YAFFS_SHORT_NAMES_IN_RAM
 	memset(obj->shortName, 0, sizeof(YCHAR) * (YAFFS_SHORT_NAME_LENGTH+1));
 	if (name && yaffs_strnlen(name,YAFFS_SHORT_NAME_LENGTH+1) <= YAFFS_SHORT_NAME_LENGTH)
@@ -622,6 +737,8 @@ void yaffs_SetObjectName(yaffs_Object *obj, const YCHAR *name)
 		obj->shortName[0] = _Y('\0');
 #endif
 	obj->sum = yaffs_CalcNameSum(name);
+	if (indexed)
+		yaffs_NameIndexAdd(parent, obj);
 }
 
 void yaffs_SetObjectNameFromOH(yaffs_Object *obj, const yaffs_ObjectHeader *oh)
@@ -667,6 +784,24 @@ static void yaffs_FreeTnode(yaffs_Device *dev, yaffs_Tnode *tn)
 
 static void yaffs_DeinitialiseTnodesAndObjects(yaffs_Device *dev)
 {
+	struct ylist_head *lh;
+	yaffs_Object *obj;
+	__u32 i;
+
+	/* objects go with the allocator, the name indexes do not */
+	for (i = 0; i < dev->nObjectBuckets; i++) {
+		ylist_for_each(lh, &dev->objectBucket[i].list) {
+			obj = ylist_entry(lh, yaffs_Object, hashLink);
+			if (obj->variantType == YAFFS_OBJECT_TYPE_DIRECTORY)
+				yaffs_FreeNameIndex(obj);
+		}
+	}
+
+	if (dev->objectBucket != dev->initialObjectBucket)
+		YFREE(dev->objectBucket);
+	dev->objectBucket = dev->initialObjectBucket;
+	dev->nObjectBuckets = YAFFS_NOBJECT_BUCKETS;
+
 	yaffs_DeinitialiseRawTnodesAndObjects(dev);
 	dev->nObjects = 0;
 	dev->nTnodes = 0;
@@ -1237,6 +1372,7 @@ static yaffs_Object *yaffs_AllocateEmptyObject(yaffs_Device *dev)
 		obj->variantType = YAFFS_OBJECT_TYPE_UNKNOWN;
 		YINIT_LIST_HEAD(&(obj->hardLinks));
 		YINIT_LIST_HEAD(&(obj->hashLink));
+		YINIT_LIST_HEAD(&obj->nameLink);
 		YINIT_LIST_HEAD(&obj->siblings);
 
 
@@ -1244,6 +1380,7 @@ static yaffs_Object *yaffs_AllocateEmptyObject(yaffs_Device *dev)
 		if (dev->rootDir) {
 			obj->parent = dev->rootDir;
 			ylist_add(&(obj->siblings), &dev->rootDir->variant.directoryVariant.children);
+			yaffs_NameIndexAdd(dev->rootDir, obj);
 		}
 
 		/* Add it to the lost and found directory.
@@ -1290,7 +1427,7 @@ static void yaffs_UnhashObject(yaffs_Object *obj)
 	/* If it is still linked into the bucket list, free from the list */
 	if (!ylist_empty(&obj->hashLink)) {
 		ylist_del_init(&obj->hashLink);
-		bucket = yaffs_HashFunction(obj->objectId);
+		bucket = yaffs_HashFunction(dev, obj->objectId);
 		dev->objectBucket[bucket].count--;
 	}
 }
@@ -1320,6 +1457,9 @@ static void yaffs_FreeObject(yaffs_Object *obj)
 
 	yaffs_UnhashObject(obj);
 
+	if (obj->variantType == YAFFS_OBJECT_TYPE_DIRECTORY)
+		yaffs_FreeNameIndex(obj);
+
 	yaffs_FreeRawObject(dev,obj);
 	dev->nObjects--;
 	dev->nCheckpointBlocksRequired = 0; /* force recalculation*/
@@ -1341,6 +1481,8 @@ static void yaffs_InitialiseTnodesAndObjects(yaffs_Device *dev)
 
 	yaffs_InitialiseRawTnodesAndObjects(dev);
 
+	dev->objectBucket = dev->initialObjectBucket;
+	dev->nObjectBuckets = YAFFS_NOBJECT_BUCKETS;
 	for (i = 0; i < YAFFS_NOBJECT_BUCKETS; i++) {
 		YINIT_LIST_HEAD(&dev->objectBucket[i].list);
 		dev->objectBucket[i].count = 0;
@@ -1360,7 +1502,7 @@ static int yaffs_FindNiceObjectBucket(yaffs_Device *dev)
 
 	for (i = 0; i < 10 && lowest > 4; i++) {
 		dev->bucketFinder++;
-		dev->bucketFinder %= YAFFS_NOBJECT_BUCKETS;
+		dev->bucketFinder %= dev->nObjectBuckets;
 		if (dev->objectBucket[dev->bucketFinder].count < lowest) {
 			lowest = dev->objectBucket[dev->bucketFinder].count;
 			l = dev->bucketFinder;
@@ -1388,7 +1530,7 @@ static int yaffs_CreateNewObjectNumber(yaffs_Device *dev)
 
 	while (!found) {
 		found = 1;
-		n += YAFFS_NOBJECT_BUCKETS;
+		n += dev->nObjectBuckets;
 		if (1 || dev->objectBucket[bucket].count > 0) {
 			ylist_for_each(i, &dev->objectBucket[bucket].list) {
 				/* If there is already one in the list */
@@ -1403,18 +1545,66 @@ static int yaffs_CreateNewObjectNumber(yaffs_Device *dev)
 	return n;
 }
 
+/*
+ * Rehash the objects into a table four times the size.  Object numbers
+ * are handed out as bucket + k * nObjectBuckets, which stays consistent
+ * with a table that is a multiple of the old one.  If there is no memory
+ * the old table is kept, it only gets slower.
+ */
+static void yaffs_GrowObjectBuckets(yaffs_Device *dev)
+{
+	yaffs_ObjectBucket *newBucket;
+	__u32 nNew = dev->nObjectBuckets * 4;
+	struct ylist_head *lh, *n;
+	yaffs_Object *obj;
+	__u32 i;
+	int bucket;
+
+	newBucket = YMALLOC(nNew * sizeof(yaffs_ObjectBucket));
+	if (!newBucket)
+		return;
+
+	for (i = 0; i < nNew; i++) {
+		YINIT_LIST_HEAD(&newBucket[i].list);
+		newBucket[i].count = 0;
+	}
+
+	for (i = 0; i < dev->nObjectBuckets; i++) {
+		ylist_for_each_safe(lh, n, &dev->objectBucket[i].list) {
+			obj = ylist_entry(lh, yaffs_Object, hashLink);
+			bucket = abs(obj->objectId) % nNew;
+			ylist_del(lh);
+			ylist_add(lh, &newBucket[bucket].list);
+			newBucket[bucket].count++;
+		}
+	}
+
+	if (dev->objectBucket != dev->initialObjectBucket)
+		YFREE(dev->objectBucket);
+	dev->objectBucket = newBucket;
+	dev->nObjectBuckets = nNew;
+	dev->bucketFinder = 0;
+
+	T(YAFFS_TRACE_OS, (TSTR("yaffs: %d objects, %d hash buckets" TENDSTR),
+		dev->nObjects, nNew));
+}
+
 static void yaffs_HashObject(yaffs_Object *in)
 {
-	int bucket = yaffs_HashFunction(in->objectId);
 	yaffs_Device *dev = in->myDev;
+	int bucket = yaffs_HashFunction(dev, in->objectId);
 
 	ylist_add(&in->hashLink, &dev->objectBucket[bucket].list);
 	dev->objectBucket[bucket].count++;
+
+	if (dev->nObjects > YAFFS_OBJECT_BUCKET_LOAD * dev->nObjectBuckets &&
+		dev->nObjectBuckets < YAFFS_MAX_OBJECT_BUCKETS)
+		yaffs_GrowObjectBuckets(dev);
 }
 
 yaffs_Object *yaffs_FindObjectByNumber(yaffs_Device *dev, __u32 number)
 {
-	int bucket = yaffs_HashFunction(number);
+	int bucket = yaffs_HashFunction(dev, number);
 	struct ylist_head *i;
 	yaffs_Object *in;
 
@@ -2373,6 +2563,53 @@ static int yaffs_GarbageCollectBlock(yaffs_Device *dev, int block,
  * for garbage collection.
  */
 
+/*
+ * Background victim selection for yaffs2.  Weigh the chunks a collection
+ * reclaims and the age of the block against the chunks it has to copy,
+ * (free * age) / (used + 1), so that cold, mostly valid blocks are not
+ * copied over and over while young blocks are still being invalidated
+ * by their writers.  The background thread has the time to look at
+ * every block.
+ */
+static unsigned yaffs_FindBlockByCostBenefit(yaffs_Device *dev, int threshold)
+{
+	int i;
+	int pagesUsed;
+	unsigned selected = 0;
+	__u64 gain;
+	__u64 bestGain = 0;
+	__u32 bestCost = 1;
+	yaffs_BlockInfo *bi = dev->blockInfo;
+
+	for (i = dev->internalStartBlock; i <= dev->internalEndBlock; i++, bi++) {
+		pagesUsed = bi->pagesInUse - bi->softDeletions;
+
+		if (bi->blockState != YAFFS_BLOCK_STATE_FULL ||
+			pagesUsed >= dev->param.nChunksPerBlock ||
+			pagesUsed > threshold ||
+			!yaffs2_BlockNotDisqualifiedFromGC(dev, bi))
+			continue;
+
+		gain = (__u64)(dev->param.nChunksPerBlock - pagesUsed) *
+			(dev->sequenceNumber - bi->sequenceNumber + 1);
+
+		/* gain / (pagesUsed + 1) > bestGain / bestCost */
+		if (!selected ||
+			gain * bestCost > bestGain * (pagesUsed + 1)) {
+			selected = i;
+			bestGain = gain;
+			bestCost = pagesUsed + 1;
+			dev->gcPagesInUse = pagesUsed;
+		}
+	}
+
+	return selected;
+}
+
+/*
+ * background is 0 for collection from the write path, otherwise it is
+ * one more than the urgency the background thread asked for.
+ */
 static unsigned yaffs_FindBlockForGarbageCollection(yaffs_Device *dev,
 					int aggressive,
 					int background)
@@ -2434,7 +2671,10 @@ static unsigned yaffs_FindBlockForGarbageCollection(yaffs_Device *dev,
 		} else {
 			int maxThreshold;
 
-			if(background)
+			if(background > 2)
+				/* below the free block watermark, take anything */
+				maxThreshold = dev->param.nChunksPerBlock - 1;
+			else if(background)
 				maxThreshold = dev->param.nChunksPerBlock/2;
 			else
 				maxThreshold = dev->param.nChunksPerBlock/8;
@@ -2444,6 +2684,8 @@ static unsigned yaffs_FindBlockForGarbageCollection(yaffs_Device *dev,
 
 			threshold = background ?
 				(dev->gcNotDone + 2) * 2 : 0;
+			if(background > 2)
+				threshold = maxThreshold;
 			if(threshold <YAFFS_GC_PASSIVE_THRESHOLD)
 				threshold = YAFFS_GC_PASSIVE_THRESHOLD;
 			if(threshold > maxThreshold)
@@ -2452,6 +2694,13 @@ static unsigned yaffs_FindBlockForGarbageCollection(yaffs_Device *dev,
 			iterations = nBlocks / 16 + 1;
 			if (iterations > 100)
 				iterations = 100;
+
+			if(background && dev->param.isYaffs2) {
+				selected = yaffs_FindBlockByCostBenefit(dev,
+							threshold);
+				dev->gcDirtiest = selected;
+				iterations = 0;
+			}
 		}
 
 		for (i = 0;
@@ -2477,7 +2726,8 @@ static unsigned yaffs_FindBlockForGarbageCollection(yaffs_Device *dev,
 			}
 		}
 
-		if(dev->gcDirtiest > 0 && dev->gcPagesInUse <= threshold)
+		if(!selected && dev->gcDirtiest > 0 &&
+			dev->gcPagesInUse <= threshold)
 			selected = dev->gcDirtiest;
 	}
 
@@ -2639,7 +2889,7 @@ int yaffs_BackgroundGarbageCollect(yaffs_Device *dev, unsigned urgency)
 
 	T(YAFFS_TRACE_BACKGROUND, (TSTR("Background gc %u" TENDSTR),urgency));
 
-	yaffs_CheckGarbageCollection(dev, 1);
+	yaffs_CheckGarbageCollection(dev, 1 + urgency);
 	return erasedChunks > dev->nFreeChunks/2;
 }
 
@@ -3176,10 +3426,101 @@ int yaffs_UpdateObjectHeader(yaffs_Object *in, const YCHAR *name, int force,
  *   In Linux, the page cache provides read buffering aand the short op cache provides write
  *   buffering.
  *
- *   There are a limited number (~10) of cache chunks per device so that we don't
- *   need a very intelligent search.
+ *   The number of cache chunks is set per mount.  Lookups go through a small
+ *   hash on object and chunk id, everything else is a plain scan.  Dirty chunks
+ *   are written back in object and chunk order so a file ends up laid out
+ *   sequentially in the blocks being filled.
  */
 
+static Y_INLINE struct ylist_head *yaffs_CacheHashList(yaffs_Device *dev,
+					const yaffs_Object *obj, int chunkId)
+{
+	return &dev->srCacheHash[(obj->objectId * 31 + chunkId) &
+				dev->srCacheHashMask];
+}
+
+static void yaffs_AttachChunkCache(yaffs_Device *dev, yaffs_ChunkCache *cache,
+				yaffs_Object *obj, int chunkId)
+{
+	/* A clean cache picked for reuse is still hashed under its old chunk */
+	ylist_del(&cache->hashLink);
+	cache->object = obj;
+	cache->chunkId = chunkId;
+	ylist_add(&cache->hashLink, yaffs_CacheHashList(dev, obj, chunkId));
+}
+
+static void yaffs_DetachChunkCache(yaffs_ChunkCache *cache)
+{
+	cache->object = NULL;
+	ylist_del_init(&cache->hashLink);
+}
+
+static Y_INLINE int yaffs_ChunkCacheBefore(const yaffs_ChunkCache *a,
+					const yaffs_ChunkCache *b)
+{
+	if (a->object->objectId != b->object->objectId)
+		return a->object->objectId < b->object->objectId;
+	return a->chunkId < b->chunkId;
+}
+
+/* Collect the dirty chunks of obj (or of everything if obj is NULL), sorted */
+static int yaffs_SortDirtyChunkCaches(yaffs_Device *dev, yaffs_Object *obj)
+{
+	yaffs_ChunkCache **sorted = dev->srCacheSort;
+	yaffs_ChunkCache *cache;
+	int n = 0;
+	int i, j;
+
+	for (i = 0; i < dev->param.nShortOpCaches; i++) {
+		cache = &dev->srCache[i];
+		if (!cache->object || !cache->dirty ||
+		    (obj && cache->object != obj))
+			continue;
+
+		for (j = n; j > 0 && yaffs_ChunkCacheBefore(cache, sorted[j - 1]); j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = cache;
+		n++;
+	}
+
+	return n;
+}
+
+/* Write back what yaffs_SortDirtyChunkCaches() collected, in order */
+static void yaffs_WriteSortedChunkCaches(yaffs_Device *dev, int n)
+{
+	yaffs_ChunkCache *cache;
+	int chunkWritten;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		cache = dev->srCacheSort[i];
+
+		/* Writing may garbage collect, which can invalidate entries */
+		if (!cache->object || !cache->dirty)
+			continue;
+
+		if (cache->locked)
+			break;
+
+		chunkWritten = yaffs_WriteChunkDataToObject(cache->object,
+							cache->chunkId,
+							cache->data,
+							cache->nBytes, 1);
+		if (chunkWritten <= 0)
+			break;
+
+		cache->dirty = 0;
+		yaffs_DetachChunkCache(cache);
+	}
+
+	if (i < n) {
+		/* Hoosterman, disk full while writing cache out. */
+		T(YAFFS_TRACE_ERROR,
+		  (TSTR("yaffs tragedy: no space during cache write" TENDSTR)));
+	}
+}
+
 static int yaffs_ObjectHasCachedWriteData(yaffs_Object *obj)
 {
 	yaffs_Device *dev = obj->myDev;
@@ -3201,52 +3542,10 @@ static int yaffs_ObjectHasCachedWriteData(yaffs_Object *obj)
 static void yaffs_FlushFilesChunkCache(yaffs_Object *obj)
 {
 	yaffs_Device *dev = obj->myDev;
-	int lowest = -99;	/* Stop compiler whining. */
-	int i;
-	yaffs_ChunkCache *cache;
-	int chunkWritten = 0;
-	int nCaches = obj->myDev->param.nShortOpCaches;
-
-	if (nCaches > 0) {
-		do {
-			cache = NULL;
-
-			/* Find the dirty cache for this object with the lowest chunk id. */
-			for (i = 0; i < nCaches; i++) {
-				if (dev->srCache[i].object == obj &&
-				    dev->srCache[i].dirty) {
-					if (!cache
-					    || dev->srCache[i].chunkId <
-					    lowest) {
-						cache = &dev->srCache[i];
-						lowest = cache->chunkId;
-					}
-				}
-			}
-
-			if (cache && !cache->locked) {
-				/* Write it out and free it up */
-
-				chunkWritten =
-				    yaffs_WriteChunkDataToObject(cache->object,
-								 cache->chunkId,
-								 cache->data,
-								 cache->nBytes,
-								 1);
-				cache->dirty = 0;
-				cache->object = NULL;
-			}
-
-		} while (cache && chunkWritten > 0);
-
-		if (cache) {
-			/* Hoosterman, disk full while writing cache out. */
-			T(YAFFS_TRACE_ERROR,
-			  (TSTR("yaffs tragedy: no space during cache write" TENDSTR)));
-
-		}
-	}
 
+	if (dev->param.nShortOpCaches > 0)
+		yaffs_WriteSortedChunkCaches(dev,
+				yaffs_SortDirtyChunkCaches(dev, obj));
 }
 
 /*yaffs_FlushEntireDeviceCache(dev)
@@ -3256,26 +3555,10 @@ static void yaffs_FlushFilesChunkCache(yaffs_Object *obj)
 
 void yaffs_FlushEntireDeviceCache(yaffs_Device *dev)
 {
-	yaffs_Object *obj;
-	int nCaches = dev->param.nShortOpCaches;
-	int i;
-
-	/* Find a dirty object in the cache and flush it...
-	 * until there are no further dirty objects.
-	 */
-	do {
-		obj = NULL;
-		for (i = 0; i < nCaches && !obj; i++) {
-			if (dev->srCache[i].object &&
-			    dev->srCache[i].dirty)
-				obj = dev->srCache[i].object;
-
-		}
-		if (obj)
-			yaffs_FlushFilesChunkCache(obj);
-
-	} while (obj);
-
+	/* One pass over all dirty chunks, ordered by object then chunk */
+	if (dev->param.nShortOpCaches > 0)
+		yaffs_WriteSortedChunkCaches(dev,
+				yaffs_SortDirtyChunkCaches(dev, NULL));
 }
 
 
@@ -3354,14 +3637,17 @@ static yaffs_ChunkCache *yaffs_FindChunkCache(const yaffs_Object *obj,
 					      int chunkId)
 {
 	yaffs_Device *dev = obj->myDev;
-	int i;
+	struct ylist_head *i;
+	yaffs_ChunkCache *cache;
+
 	if (dev->param.nShortOpCaches > 0) {
-		for (i = 0; i < dev->param.nShortOpCaches; i++) {
-			if (dev->srCache[i].object == obj &&
-			    dev->srCache[i].chunkId == chunkId) {
+		ylist_for_each(i, yaffs_CacheHashList(dev, obj, chunkId)) {
+			cache = ylist_entry(i, yaffs_ChunkCache, hashLink);
+			if (cache->object == obj &&
+			    cache->chunkId == chunkId) {
 				dev->cacheHits++;
 
-				return &dev->srCache[i];
+				return cache;
 			}
 		}
 	}
@@ -3402,7 +3688,7 @@ static void yaffs_InvalidateChunkCache(yaffs_Object *object, int chunkId)
 		yaffs_ChunkCache *cache = yaffs_FindChunkCache(object, chunkId);
 
 		if (cache)
-			cache->object = NULL;
+			yaffs_DetachChunkCache(cache);
 	}
 }
 
@@ -3418,7 +3704,7 @@ static void yaffs_InvalidateWholeChunkCache(yaffs_Object *in)
 		/* Invalidate it. */
 		for (i = 0; i < dev->param.nShortOpCaches; i++) {
 			if (dev->srCache[i].object == in)
-				dev->srCache[i].object = NULL;
+				yaffs_DetachChunkCache(&dev->srCache[i]);
 		}
 	}
 }
@@ -3476,8 +3762,7 @@ int yaffs_ReadDataFromFile(yaffs_Object *in, __u8 *buffer, loff_t offset,
 
 				if (!cache) {
 					cache = yaffs_GrabChunkCache(in->myDev);
-					cache->object = in;
-					cache->chunkId = chunk;
+					yaffs_AttachChunkCache(dev, cache, in, chunk);
 					cache->dirty = 0;
 					cache->locked = 0;
 					yaffs_ReadChunkDataFromObject(in, chunk,
@@ -3603,8 +3888,7 @@ int yaffs_DoWriteDataToFile(yaffs_Object *in, const __u8 *buffer, loff_t offset,
 				if (!cache
 				    && yaffs_CheckSpaceForAllocation(dev, 1)) {
 					cache = yaffs_GrabChunkCache(dev);
-					cache->object = in;
-					cache->chunkId = chunk;
+					yaffs_AttachChunkCache(dev, cache, in, chunk);
 					cache->dirty = 0;
 					cache->locked = 0;
 					yaffs_ReadChunkDataFromObject(in, chunk,
@@ -4263,7 +4547,7 @@ static void yaffs_FixHangingObjects(yaffs_Device *dev)
 	 * Make sure it is rooted.
 	 */
 
-	for (i = 0; i <  YAFFS_NOBJECT_BUCKETS; i++) {
+	for (i = 0; i < dev->nObjectBuckets; i++) {
 		ylist_for_each_safe(lh, n, &dev->objectBucket[i].list) {
 			if (lh) {
 				obj = ylist_entry(lh, yaffs_Object, hashLink);
@@ -4478,6 +4762,8 @@ static void yaffs_RemoveObjectFromDirectory(yaffs_Object *obj)
 		dev->param.removeObjectCallback(obj);
 
 
+	if (parent)
+		yaffs_NameIndexRemove(parent, obj);
 	ylist_del_init(&obj->siblings);
 	obj->parent = NULL;
 	
@@ -4517,6 +4803,7 @@ void yaffs_AddObjectToDirectory(yaffs_Object *directory,
 	/* Now add it */
 	ylist_add(&obj->siblings, &directory->variant.directoryVariant.children);
 	obj->parent = directory;
+	yaffs_NameIndexAdd(directory, obj);
 
 	if (directory == obj->myDev->unlinkedDir
 			|| directory == obj->myDev->deletedDir) {
@@ -4529,6 +4816,58 @@ void yaffs_AddObjectToDirectory(yaffs_Object *directory,
 	yaffs_VerifyObjectInDirectory(obj);
 }
 
+static yaffs_Object *yaffs_FindObjectInNameIndex(yaffs_Object *directory,
+						const YCHAR *name, int sum)
+{
+	yaffs_DirectoryStructure *ds = &directory->variant.directoryVariant;
+	struct ylist_head *i, *n, *list;
+	YCHAR buffer[YAFFS_MAX_NAME_LENGTH + 1];
+	yaffs_Object *l;
+
+	ylist_for_each(i, &ds->nameIndex[sum & ds->nameIndexMask]) {
+		l = ylist_entry(i, yaffs_Object, nameLink);
+
+		if (l->parent != directory)
+			YBUG();
+
+		if (yaffs_SumCompare(l->sum, sum)) {
+			yaffs_GetObjectName(l, buffer,
+					    YAFFS_MAX_NAME_LENGTH + 1);
+			if (yaffs_strncmp(name, buffer, YAFFS_MAX_NAME_LENGTH) == 0)
+				return l;
+		}
+	}
+
+	/* Same checks as the linear search for the ones not hashed by sum */
+	ylist_for_each_safe(i, n, &ds->nameIndex[ds->nameIndexMask + 1]) {
+		l = ylist_entry(i, yaffs_Object, nameLink);
+
+		if (l->parent != directory)
+			YBUG();
+
+		yaffs_CheckObjectDetailsLoaded(l);
+
+		if (l->objectId == YAFFS_OBJECTID_LOSTNFOUND) {
+			if (yaffs_strcmp(name, YAFFS_LOSTNFOUND_NAME) == 0)
+				return l;
+		} else if (yaffs_SumCompare(l->sum, sum) || l->hdrChunk <= 0) {
+			yaffs_GetObjectName(l, buffer,
+					    YAFFS_MAX_NAME_LENGTH + 1);
+			if (yaffs_strncmp(name, buffer, YAFFS_MAX_NAME_LENGTH) == 0)
+				return l;
+		}
+
+		/* Its header has been written since, file it by sum */
+		list = yaffs_NameIndexList(directory, l);
+		if (list != &ds->nameIndex[ds->nameIndexMask + 1]) {
+			ylist_del(&l->nameLink);
+			ylist_add(&l->nameLink, list);
+		}
+	}
+
+	return NULL;
+}
+
 yaffs_Object *yaffs_FindObjectByName(yaffs_Object *directory,
 				     const YCHAR *name)
 {
@@ -4559,6 +4898,11 @@ yaffs_Object *yaffs_FindObjectByName(yaffs_Object *directory,
 
 	sum = yaffs_CalcNameSum(name);
 
+	if (!directory->variant.directoryVariant.nameIndex)
+		yaffs_BuildNameIndex(directory);
+	if (directory->variant.directoryVariant.nameIndex)
+		return yaffs_FindObjectInNameIndex(directory, name, sum);
+
 	ylist_for_each(i, &directory->variant.directoryVariant.children) {
 		if (i) {
 			l = ylist_entry(i, yaffs_Object, siblings);
@@ -5293,6 +5637,8 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 		init_failed = 1;
 
 	dev->srCache = NULL;
+	dev->srCacheHash = NULL;
+	dev->srCacheSort = NULL;
 	dev->gcCleanupList = NULL;
 
 
@@ -5300,20 +5646,35 @@ int yaffs_GutsInitialise(yaffs_Device *dev)
 	    dev->param.nShortOpCaches > 0) {
 		int i;
 		void *buf;
-		int srCacheBytes = dev->param.nShortOpCaches * sizeof(yaffs_ChunkCache);
+		int srCacheBytes;
+		__u32 nHash = 1;
 
 		if (dev->param.nShortOpCaches > YAFFS_MAX_SHORT_OP_CACHES)
 			dev->param.nShortOpCaches = YAFFS_MAX_SHORT_OP_CACHES;
 
+		srCacheBytes = dev->param.nShortOpCaches * sizeof(yaffs_ChunkCache);
+		while (nHash < dev->param.nShortOpCaches)
+			nHash <<= 1;
+
 		dev->srCache =  YMALLOC(srCacheBytes);
+		dev->srCacheHash = YMALLOC(nHash * sizeof(struct ylist_head));
+		dev->srCacheSort = YMALLOC(dev->param.nShortOpCaches *
+					sizeof(yaffs_ChunkCache *));
+		dev->srCacheHashMask = nHash - 1;
 
 		buf = (__u8 *) dev->srCache;
+		if (!dev->srCacheHash || !dev->srCacheSort)
+			buf = NULL;
 
 		if (dev->srCache)
 			memset(dev->srCache, 0, srCacheBytes);
 
+		for (i = 0; i < nHash && buf; i++)
+			YINIT_LIST_HEAD(&dev->srCacheHash[i]);
+
 		for (i = 0; i < dev->param.nShortOpCaches && buf; i++) {
 			dev->srCache[i].object = NULL;
+			YINIT_LIST_HEAD(&dev->srCache[i].hashLink);
 			dev->srCache[i].lastUse = 0;
 			dev->srCache[i].dirty = 0;
 			dev->srCache[i].data = buf = YMALLOC_DMA(dev->param.totalBytesPerChunk);
@@ -5439,6 +5800,11 @@ void yaffs_Deinitialise(yaffs_Device *dev)
 			dev->srCache = NULL;
 		}
 
+		YFREE(dev->srCacheHash);
+		dev->srCacheHash = NULL;
+		YFREE(dev->srCacheSort);
+		dev->srCacheSort = NULL;
+
 		YFREE(dev->gcCleanupList);
 
 		for (i = 0; i < YAFFS_N_TEMP_BUFFERS; i++)
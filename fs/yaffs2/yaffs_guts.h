@@ -59,6 +59,14 @@
 #define YAFFS_ALLOCATION_NLINKS		100
 
 #define YAFFS_NOBJECT_BUCKETS		256
+/* The object table grows by 4 when it averages this many per bucket */
+#define YAFFS_OBJECT_BUCKET_LOAD	4
+#define YAFFS_MAX_OBJECT_BUCKETS	4096
+
+/* Directories with this many entries get a name index on lookup */
+#define YAFFS_NAME_INDEX_MIN		32
+#define YAFFS_NAME_INDEX_LOAD		4
+#define YAFFS_MAX_NAME_BUCKETS		1024
 
 
 #define YAFFS_OBJECT_SPACE		0x40000
@@ -88,7 +96,8 @@
 #define YAFFS_SEQUENCE_CHECKPOINT_DATA  0x21
 
 
-#define YAFFS_MAX_SHORT_OP_CACHES	20
+#define YAFFS_MAX_SHORT_OP_CACHES	128
+#define YAFFS_DEFAULT_SHORT_OP_CACHES	32
 
 #define YAFFS_N_TEMP_BUFFERS		6
 
@@ -114,6 +123,7 @@
 /* ChunkCache is used for short read/write operations.*/
 typedef struct {
 	struct yaffs_ObjectStruct *object;
+	struct ylist_head hashLink;	/* entry in dev->srCacheHash */
 	int chunkId;
 	int lastUse;
 	int dirty;
@@ -377,6 +387,9 @@ typedef struct {
 typedef struct {
 	struct ylist_head children;     /* list of child links */
 	struct ylist_head dirty;	/* Entry for list of dirty directories */
+	struct ylist_head *nameIndex;	/* children by name sum, built on lookup */
+	__u32 nameIndexMask;
+	int nameIndexCount;
 } yaffs_DirectoryStructure;
 
 typedef struct {
@@ -427,6 +440,7 @@ struct yaffs_ObjectStruct {
 	struct yaffs_DeviceStruct *myDev;       /* The device I'm on */
 
 	struct ylist_head hashLink;     /* list of objects in this hash bucket */
+	struct ylist_head nameLink;	/* entry in the parent's name index */
 
 	struct ylist_head hardLinks;    /* all the equivalent hard linked objects */
 
@@ -687,7 +701,9 @@ struct yaffs_DeviceStruct {
 
 	int nHardLinks;
 
-	yaffs_ObjectBucket objectBucket[YAFFS_NOBJECT_BUCKETS];
+	yaffs_ObjectBucket *objectBucket;	/* nObjectBuckets entries */
+	__u32 nObjectBuckets;
+	yaffs_ObjectBucket initialObjectBucket[YAFFS_NOBJECT_BUCKETS];
 	__u32 bucketFinder;
 
 	int nFreeChunks;
@@ -720,6 +736,9 @@ struct yaffs_DeviceStruct {
 
 	yaffs_ChunkCache *srCache;
 	int srLastUse;
+	struct ylist_head *srCacheHash;	/* caches by object and chunk */
+	__u32 srCacheHashMask;
+	yaffs_ChunkCache **srCacheSort;	/* scratch for ordered flushes */
 
 	/* Stuff for background deletion and unlinked files.*/
 	yaffs_Object *unlinkedDir;	/* Directory where unlinked and deleted files live. */
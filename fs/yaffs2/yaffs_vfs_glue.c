@@ -175,6 +175,8 @@ unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
 unsigned int yaffs_auto_checkpoint = 1;
 unsigned int yaffs_gc_control = 1;
 unsigned int yaffs_bg_enable = 1;
+unsigned int yaffs_bg_checkpoint = 30; /* idle seconds, 0 to disable */
+unsigned int yaffs_bg_gc_watermark = 16; /* erased blocks above reserve */
 
 /* Module Parameters */
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
@@ -183,6 +185,8 @@ module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
 module_param(yaffs_gc_control, uint, 0644);
 module_param(yaffs_bg_enable, uint, 0644);
+module_param(yaffs_bg_checkpoint, uint, 0644);
+module_param(yaffs_bg_gc_watermark, uint, 0644);
 #else
 MODULE_PARM(yaffs_traceMask, "i");
 MODULE_PARM(yaffs_wr_attempts, "i");
@@ -244,6 +248,7 @@ static int yaffs_sync_object(struct file *file, struct dentry *dentry,
 #endif
 
 static int yaffs_readdir(struct file *f, void *dirent, filldir_t filldir);
+static int yaffs_prefetch_dir(struct file *f);
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
 static int yaffs_create(struct inode *dir, struct dentry *dentry, int mode,
@@ -461,6 +466,7 @@ static const struct file_operations yaffs_dir_operations = {
 	.readdir = yaffs_readdir,
 	.fsync = yaffs_sync_object,
 	.llseek = yaffs_dir_llseek,
+	.prefetch_dir = yaffs_prefetch_dir,
 };
 
 static const struct super_operations yaffs_super_ops = {
@@ -1668,6 +1674,73 @@ out:
 	return retVal;
 }
 
+/*
+ * Readdir-plus for FIPREFETCHDIR. All of a directory's objects are in
+ * memory, so give each child its dentry and inode straight from the
+ * object instead of letting the VFS look every name up, which would
+ * walk the directory's children once per name.
+ */
+static int yaffs_prefetch_dir(struct file *f)
+{
+	struct dentry *parent = f->f_dentry;
+	struct inode *dir = parent->d_inode;
+	yaffs_Object *obj = yaffs_DentryToObject(parent);
+	yaffs_Device *dev = obj->myDev;
+	struct yaffs_SearchContext *sc;
+	int retVal = 0;
+
+	char name[YAFFS_MAX_NAME_LENGTH + 1];
+
+	/* keeps the children from being unlinked or renamed meanwhile */
+	mutex_lock(&dir->i_mutex);
+	yaffs_GrossLock(dev);
+
+	sc = yaffs_NewSearch(obj);
+	if (!sc) {
+		retVal = -ENOMEM;
+		goto out;
+	}
+
+	while (sc->nextReturn) {
+		yaffs_Object *l = yaffs_GetEquivalentObject(sc->nextReturn);
+		struct dentry *dentry;
+		struct inode *inode;
+		struct qstr this;
+
+		yaffs_GetObjectName(sc->nextReturn, name,
+				    YAFFS_MAX_NAME_LENGTH + 1);
+
+		/* Can't hold gross lock when calling yaffs_get_inode() */
+		yaffs_GrossUnlock(dev);
+
+		this.name = name;
+		this.len = strlen(name);
+		dentry = d_hash_and_lookup(parent, &this);
+		if (!dentry) {
+			dentry = d_alloc(parent, &this);
+			if (!dentry) {
+				retVal = -ENOMEM;
+				yaffs_GrossLock(dev);
+				break;
+			}
+			inode = yaffs_get_inode(dir->i_sb, l->yst_mode, 0, l);
+			if (inode)
+				d_add(dentry, inode);
+		}
+		dput(dentry);
+
+		yaffs_GrossLock(dev);
+		yaffs_SearchAdvance(sc);
+	}
+
+	yaffs_EndSearch(sc);
+out:
+	yaffs_GrossUnlock(dev);
+	mutex_unlock(&dir->i_mutex);
+
+	return retVal;
+}
+
 
 
 /*
@@ -2253,6 +2326,13 @@ static unsigned yaffs_bg_gc_urgency(yaffs_Device *dev)
 		return 0;
 	else if(scatteredFree < (dev->param.nChunksPerBlock * 2))
 		return 0;
+	/*
+	 * Keep a margin of erased blocks so that writes rarely have to
+	 * collect inline, that is what makes foreground latency spike.
+	 */
+	else if(dev->nErasedBlocks <
+		dev->param.nReservedBlocks + (int)yaffs_bg_gc_watermark)
+		return 2;
 	else if(erasedChunks > dev->nFreeChunks/2)
 		return 0;
 	else if(erasedChunks > dev->nFreeChunks/4)
@@ -2312,6 +2392,30 @@ void yaffs_background_waker(unsigned long data)
 	wake_up_process((struct task_struct *)data);
 }
 
+/*
+ * A checkpoint is only written on sync or unmount and is dropped by the
+ * first write after it, so a crash almost always means a full scan at
+ * the next mount.  Once the device has seen no page writes for
+ * yaffs_bg_checkpoint seconds write one from here, so that a partition
+ * which is idle when power is lost mounts from the checkpoint.
+ */
+static void yaffs_BackgroundCheckpoint(yaffs_Device *dev)
+{
+	struct super_block *sb = yaffs_DeviceToLC(dev)->superBlock;
+
+	/* the unmount path holds s_umount while it stops this thread */
+	if (!sb || !down_read_trylock(&sb->s_umount))
+		return;
+
+	if (!(sb->s_flags & MS_RDONLY)) {
+		T(YAFFS_TRACE_BACKGROUND | YAFFS_TRACE_CHECKPOINT,
+			(TSTR("yaffs_background checkpoint\n")));
+		yaffs_do_sync_fs(sb, 1);
+	}
+
+	up_read(&sb->s_umount);
+}
+
 static int yaffs_BackgroundThread(void *data)
 {
 	yaffs_Device *dev = (yaffs_Device *)data;
@@ -2319,8 +2423,11 @@ static int yaffs_BackgroundThread(void *data)
 	unsigned long now = jiffies;
 	unsigned long next_dir_update = now;
 	unsigned long next_gc = now;
+	unsigned long next_checkpoint = now;
 	unsigned long expires;
 	unsigned int urgency;
+	__u32 last_writes = dev->nPageWrites;
+	int do_checkpoint;
 
 	int gcResult;
 	struct timer_list timer;
@@ -2368,11 +2475,30 @@ static int yaffs_BackgroundThread(void *data)
 				*/
 				next_gc = next_dir_update;
 		}
+
+		do_checkpoint = 0;
+		if (yaffs_bg_checkpoint && !dev->isCheckpointed) {
+			if (dev->nPageWrites != last_writes) {
+				last_writes = dev->nPageWrites;
+				next_checkpoint = now + yaffs_bg_checkpoint * HZ;
+			} else if (time_after(now, next_checkpoint)) {
+				do_checkpoint = 1;
+				next_checkpoint = now + yaffs_bg_checkpoint * HZ;
+			}
+		}
 		yaffs_GrossUnlock(dev);
+
+		if (do_checkpoint) {
+			yaffs_BackgroundCheckpoint(dev);
+			last_writes = dev->nPageWrites;
+		}
 #if 1
 		expires = next_dir_update;
 		if (time_before(next_gc,expires))
 			expires = next_gc;
+		if (yaffs_bg_checkpoint && !dev->isCheckpointed &&
+		    time_before(next_checkpoint, expires))
+			expires = next_checkpoint;
 		if(time_before(expires,now))
 			expires = now + HZ;
 
@@ -2606,6 +2732,7 @@ typedef struct {
 	int skip_checkpoint_read;
 	int skip_checkpoint_write;
 	int no_cache;
+	int cache_chunks;
 	int tags_ecc_on;
 	int tags_ecc_overridden;
 	int lazy_loading_enabled;
@@ -2660,7 +2787,16 @@ static int yaffs_parse_options(yaffs_options *options, const char *options_str)
 			options->empty_lost_and_found_overridden=1;
 		} else if (!strcmp(cur_opt, "no-cache"))
 			options->no_cache = 1;
-		else if (!strcmp(cur_opt, "no-checkpoint-read"))
+		else if (!strncmp(cur_opt, "cache=", 6)) {
+			options->cache_chunks =
+				simple_strtoul(cur_opt + 6, NULL, 0);
+			if (options->cache_chunks < 1 ||
+			    options->cache_chunks > YAFFS_MAX_SHORT_OP_CACHES) {
+				printk(KERN_INFO "yaffs: Bad cache size \"%s\"\n",
+					cur_opt);
+				error = 1;
+			}
+		} else if (!strcmp(cur_opt, "no-checkpoint-read"))
 			options->skip_checkpoint_read = 1;
 		else if (!strcmp(cur_opt, "no-checkpoint-write"))
 			options->skip_checkpoint_write = 1;
@@ -2916,7 +3052,12 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 	param->nChunksPerBlock = YAFFS_CHUNKS_PER_BLOCK;
 	param->totalBytesPerChunk = YAFFS_BYTES_PER_CHUNK;
 	param->nReservedBlocks = 5;
-	param->nShortOpCaches = (options.no_cache) ? 0 : 10;
+	if (options.no_cache)
+		param->nShortOpCaches = 0;
+	else if (options.cache_chunks)
+		param->nShortOpCaches = options.cache_chunks;
+	else
+		param->nShortOpCaches = YAFFS_DEFAULT_SHORT_OP_CACHES;
 	param->inbandTags = options.inband_tags;
 
 #ifdef CONFIG_YAFFS_DISABLE_LAZY_LOAD
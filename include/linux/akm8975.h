@@ -85,6 +85,14 @@ Defines a value to be set in the Control Registers (\c CNTL) of AK8975. */
 /* Get raw magnetic vector flag */
 #define ECS_IOCTL_APP_GET_MVFLAG       _IOR(AKMIO, 0x1A, short)
 
+/*
+ * Batch reports for up to this many ms (0: report each sample at once).
+ * Batched samples are each followed by MSC_RAW carrying how many us
+ * before the flush they were taken.
+ */
+#define ECS_IOCTL_APP_SET_BATCH        _IOW(AKMIO, 0x1B, short)
+#define ECS_IOCTL_APP_GET_BATCH        _IOR(AKMIO, 0x1C, short)
+
 struct akm8975_platform_data {
 	short layouts[4][3][3];
 	short irq_trigger;
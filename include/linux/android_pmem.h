@@ -61,6 +61,17 @@
 
 #define PMEM_GET_FREE_SPACE	_IOW(PMEM_IOCTL_MAGIC, 14, unsigned int)
 #define PMEM_ALLOCATE_ALIGNED	_IOW(PMEM_IOCTL_MAGIC, 15, unsigned int)
+/* Sets how this file's allocation is mapped to user space, pass one of
+ * the PMEM_CACHE_POLICY values below. Must be done before mmap. Cached
+ * mappings are kept coherent with PMEM_CLEAN_CACHES and friends over
+ * just the span that was touched.
+ */
+#define PMEM_SET_CACHE_POLICY	_IOW(PMEM_IOCTL_MAGIC, 16, unsigned int)
+
+#define PMEM_CACHE_POLICY_DEFAULT	0 /* as the region, O_SYNC uncached */
+#define PMEM_CACHE_POLICY_UNCACHED	1 /* write combined */
+#define PMEM_CACHE_POLICY_CACHED	2 /* write back */
+
 struct pmem_region {
 	unsigned long offset;
 	unsigned long len;
@@ -156,6 +167,11 @@ struct android_pmem_platform_data
 	unsigned buffered;
 	/* This PMEM is on memory that may be powered off */
 	unsigned unstable;
+	/* Lend the region to the page allocator for movable pages while
+	 * no pmem allocation is outstanding (CONFIG_CMA). The region must
+	 * lie inside a memory bank, be pageblock aligned and be reserved
+	 * with reserve_bootmem() from the board's map_io. */
+	unsigned movable;
 };
 
 int pmem_setup(struct android_pmem_platform_data *pdata,
@@ -303,6 +303,7 @@ struct atmel_i2c_platform_data {
 	uint8_t abs_width_max;
 	int gpio_irq;
 	int (*power)(int on);
+	s32 cpu_dma_latency;	/* PM QoS bound while touched, 0 for none */
 	int8_t config_T6[6];
 	int8_t config_T7[3];
 	int8_t config_T8[10];
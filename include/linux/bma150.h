@@ -59,6 +59,25 @@
 #define BMA_IOCTL_WRITE_CALI_VALUE      _IOW(BMAIO, 0x3b, int)
 #define BMA_IOCTL_GET_UPDATE_USER_CALI_DATA	_IOR(BMAIO, 0x3c, short)
 #define BMA_IOCTL_SET_UPDATE_USER_CALI_DATA	_IOW(BMAIO, 0x3d, short)
+#define BMA_IOCTL_SET_BATCH	_IOW(BMAIO, 0x3e, struct bma150_batch)
+
+/*
+ * Batching: the driver samples every interval_ms and read() returns
+ * struct bma150_sample records once latency_ms has passed since the
+ * oldest one or the buffer is full. interval_ms = 0 stops it.
+ */
+struct bma150_batch {
+	unsigned int interval_ms;
+	unsigned int latency_ms;
+};
+
+struct bma150_sample {
+	long long time_ns;	/* CLOCK_MONOTONIC */
+	short x, y, z;
+	short reserved;
+};
+
+#define BMA_BATCH_SIZE		64
 
 /* range and bandwidth */
 /*#define BMA_RANGE_2G			0
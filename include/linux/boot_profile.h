@@ -0,0 +1,32 @@
+#ifndef _LINUX_BOOT_PROFILE_H
+#define _LINUX_BOOT_PROFILE_H
+
+#include <linux/init.h>
+#include <linux/hrtimer.h>
+
+struct device;
+struct device_driver;
+
+#ifdef CONFIG_BOOT_PROFILE
+static inline ktime_t boot_profile_start(void)
+{
+	return ktime_get();
+}
+
+extern void boot_profile_initcall(initcall_t fn, ktime_t start, int ret);
+extern void boot_profile_probe(struct device_driver *drv, struct device *dev,
+			       ktime_t start, int ret);
+#else
+static inline ktime_t boot_profile_start(void)
+{
+	return ktime_set(0, 0);
+}
+
+static inline void boot_profile_initcall(initcall_t fn, ktime_t start,
+					 int ret) { }
+static inline void boot_profile_probe(struct device_driver *drv,
+				      struct device *dev, ktime_t start,
+				      int ret) { }
+#endif
+
+#endif /* _LINUX_BOOT_PROFILE_H */
@@ -201,6 +201,52 @@ int lock_policy_rwsem_write(int cpu);
 void unlock_policy_rwsem_read(int cpu);
 void unlock_policy_rwsem_write(int cpu);
 
+/* Relative power of one frequency, for cpufreq_energy_register() */
+struct cpufreq_energy_state {
+	unsigned int frequency;	/* kHz */
+	unsigned int power;
+};
+
+#ifdef CONFIG_CPU_FREQ_ENERGY_MODEL
+int cpufreq_energy_register(const struct cpumask *cpus,
+			    const struct cpufreq_energy_state *states,
+			    unsigned int nr_states);
+unsigned int cpufreq_energy_efficient_freq(struct cpufreq_policy *policy,
+					   unsigned int freq);
+#else
+static inline int cpufreq_energy_register(const struct cpumask *cpus,
+			const struct cpufreq_energy_state *states,
+			unsigned int nr_states)
+{
+	return 0;
+}
+static inline unsigned int
+cpufreq_energy_efficient_freq(struct cpufreq_policy *policy, unsigned int freq)
+{
+	return freq;
+}
+#endif
+
+/* Called in atomic context when a touch or key press starts a boost */
+#ifdef CONFIG_CPU_FREQ_INPUT_BOOST
+int cpufreq_register_input_boost_notifier(struct notifier_block *nb);
+int cpufreq_unregister_input_boost_notifier(struct notifier_block *nb);
+int cpufreq_input_boost_active(void);
+#else
+static inline int cpufreq_register_input_boost_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+static inline int cpufreq_unregister_input_boost_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+static inline int cpufreq_input_boost_active(void)
+{
+	return 0;
+}
+#endif
+
 
 /*********************************************************************
  *                      CPUFREQ DRIVER INTERFACE                     *
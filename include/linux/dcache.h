@@ -41,7 +41,8 @@ struct dentry_stat_t {
 	int nr_unused;
 	int age_limit;          /* age in seconds */
 	int want_pages;         /* pages requested by system */
-	int dummy[2];
+	int nr_negative;        /* unused negative dentries */
+	int dummy;
 };
 extern struct dentry_stat_t dentry_stat;
 
@@ -393,5 +394,6 @@ extern struct vfsmount *lookup_mnt(struct path *);
 extern struct dentry *lookup_create(struct nameidata *nd, int is_dir);
 
 extern int sysctl_vfs_cache_pressure;
+extern int sysctl_negative_dentry_limit;
 
 #endif	/* __LINUX_DCACHE_H */
@@ -129,6 +129,7 @@ struct device_driver {
 	const char		*mod_name;	/* used for built-in modules */
 
 	bool suppress_bind_attrs;	/* disables bind/unbind via sysfs */
+	bool async_probe;		/* attach devices from an async thread */
 
 	const struct of_device_id	*of_match_table;
 
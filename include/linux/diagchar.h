@@ -39,6 +39,7 @@
 #define USB_MODE			1
 #define MEMORY_DEVICE_MODE		2
 #define NO_LOGGING_MODE			3
+#define CAPTURE_MODE			4
 #define MAX_SYNC_OBJ_NAME_SIZE		32
 
 /* different values that go in for diag_data_type */
@@ -52,6 +53,43 @@
 #define DIAG_IOCTL_SWITCH_LOGGING	7
 #define DIAG_IOCTL_GET_DELAYED_RSP_ID 	8
 #define DIAG_IOCTL_LSM_DEINIT		9
+#define DIAG_IOCTL_CAPTURE_MASK		10
+
+/*
+ * CAPTURE_MODE: matching modem log and event packets, HDLC decoded and
+ * without crc, are stored in a ring mapped with mmap() on /dev/diag.
+ * The mapping starts with struct diag_capture_hdr, records start at
+ * data_offset. Each record is a struct diag_capture_rec padded to 4
+ * bytes; a record of type DIAG_CAPTURE_WRAP means continue at offset 0.
+ * head == tail means empty, readers advance tail past what they consumed.
+ */
+#define DIAG_CAPTURE_LOG		0
+#define DIAG_CAPTURE_EVENT		1
+#define DIAG_CAPTURE_WRAP		0xffff
+
+#define DIAG_CAPTURE_LOG_CODES		0x10000
+#define DIAG_CAPTURE_EVENT_IDS		0x1000
+
+struct diag_capture_mask {
+	uint32_t type;		/* DIAG_CAPTURE_LOG or DIAG_CAPTURE_EVENT */
+	uint32_t first;		/* first and last log code / event id */
+	uint32_t last;
+	uint32_t enable;
+};
+
+struct diag_capture_hdr {
+	uint32_t size;
+	uint32_t data_offset;
+	uint32_t head;		/* advanced by the kernel */
+	uint32_t tail;		/* advanced by the reader */
+	uint32_t dropped;	/* records lost to a full ring */
+};
+
+struct diag_capture_rec {
+	uint16_t len;
+	uint16_t type;
+	uint8_t data[0];
+};
 
 
 struct bindpkt_params {
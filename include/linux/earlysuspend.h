@@ -29,6 +29,8 @@
  * the suspend handlers have already been called without a matching call to the
  * resume handlers, the suspend handler will be called directly from
  * register_early_suspend. This direct call can violate the normal level order.
+ * Handlers registered at the same level may run concurrently, a handler that
+ * depends on another one must use a different level.
  */
 enum {
 	EARLY_SUSPEND_LEVEL_BLANK_SCREEN = 50,
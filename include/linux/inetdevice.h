@@ -37,6 +37,8 @@ enum
 	IPV4_DEVCONF_ACCEPT_LOCAL,
 	IPV4_DEVCONF_SRC_VMARK,
 	IPV4_DEVCONF_PROXY_ARP_PVLAN,
+	IPV4_DEVCONF_TCP_RMEM_DEF,
+	IPV4_DEVCONF_TCP_RMEM_MAX,
 	__IPV4_DEVCONF_MAX
 };
 
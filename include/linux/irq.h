@@ -170,8 +170,12 @@ struct irq_2_iommu;
  * @threads_active:	number of irqaction threads currently running
  * @wait_for_threads:	wait queue for sync_irq to wait for threaded handlers
  * @dir:		/proc/irq/ procfs entry
+ * @duration_hist:	handler run times, bucket n counts [2^(n-1), 2^n) us
+ * @duration_max_ns:	longest handler run
  * @name:		flow handler name for /proc/interrupts output
  */
+#define IRQ_DURATION_BUCKETS	12
+
 struct irq_desc {
 	unsigned int		irq;
 	struct timer_rand_state *timer_rand_state;
@@ -205,6 +209,10 @@ struct irq_desc {
 	wait_queue_head_t       wait_for_threads;
 #ifdef CONFIG_PROC_FS
 	struct proc_dir_entry	*dir;
+#endif
+#ifdef CONFIG_IRQ_DURATION_HIST
+	unsigned int		duration_hist[IRQ_DURATION_BUCKETS];
+	u64			duration_max_ns;
 #endif
 	const char		*name;
 } ____cacheline_internodealigned_in_smp;
@@ -0,0 +1,71 @@
+/*
+ * include/linux/launch_prefetch.h
+ *
+ * Records the file pages a freshly exec'd program faults in, and reads
+ * a saved list of them back in one sorted batch.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ */
+
+#ifndef _LINUX_LAUNCH_PREFETCH_H
+#define _LINUX_LAUNCH_PREFETCH_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/* Pages of the file open as @fd, starting at page @start */
+struct launch_prefetch_range {
+	__s32 fd;
+	__u32 nr_pages;
+	__u64 start;
+};
+
+struct launch_prefetch_replay {
+	__u32 nr_ranges;
+	__u32 pad;
+	__u64 ranges;		/* struct launch_prefetch_range * */
+};
+
+#define LAUNCH_PREFETCH_MAX_RANGES	8192
+
+#define __LAUNCH_PREFETCH_IOC	0x7a
+
+/* Trace the next exec for this many seconds; 0 stops a trace */
+#define LAUNCH_PREFETCH_TRACE	_IOW(__LAUNCH_PREFETCH_IOC, 1, __u32)
+#define LAUNCH_PREFETCH_REPLAY	_IOW(__LAUNCH_PREFETCH_IOC, 2, \
+				     struct launch_prefetch_replay)
+
+#ifdef __KERNEL__
+
+struct mm_struct;
+struct vm_area_struct;
+
+#ifdef CONFIG_LAUNCH_PREFETCH
+extern struct mm_struct *launch_prefetch_mm;
+
+extern void launch_prefetch_exec(struct mm_struct *mm);
+extern void __launch_prefetch_fault(struct vm_area_struct *vma,
+				    unsigned long index);
+
+static inline void launch_prefetch_fault(struct vm_area_struct *vma,
+					 unsigned long index)
+{
+	if (unlikely(vma->vm_mm == launch_prefetch_mm))
+		__launch_prefetch_fault(vma, index);
+}
+#else
+static inline void launch_prefetch_exec(struct mm_struct *mm)
+{
+}
+
+static inline void launch_prefetch_fault(struct vm_area_struct *vma,
+					 unsigned long index)
+{
+}
+#endif
+
+#endif /* __KERNEL__ */
+
+#endif /* _LINUX_LAUNCH_PREFETCH_H */
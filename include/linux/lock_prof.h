@@ -0,0 +1,137 @@
+/*
+ * include/linux/lock_prof.h
+ *
+ * Sampling contention profiler for individual hot locks.
+ *
+ * A lock is profiled by defining a struct lock_prof for it, registering
+ * it, and taking the lock through the lock_prof_*() wrappers. Nothing is
+ * measured until a sampling rate is written to its debugfs file; then
+ * one in that many contended acquisitions is timed and its wait time and
+ * call site recorded. Uncontended acquisitions are never timed.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _LINUX_LOCK_PROF_H
+#define _LINUX_LOCK_PROF_H
+
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+
+#ifdef CONFIG_LOCK_PROF
+
+/* Wait times in power of two microsecond buckets, the last open ended */
+#define LOCK_PROF_HIST_BUCKETS	16
+#define LOCK_PROF_SITES		8
+
+struct lock_prof_site {
+	unsigned long ip;
+	unsigned int count;
+	u64 wait_ns;
+};
+
+struct lock_prof {
+	const char *name;
+	unsigned int sample;		/* time 1 in sample contentions */
+	unsigned int skip;
+	spinlock_t lock;		/* protects the statistics below */
+	unsigned long contended;
+	unsigned long sampled;
+	u64 wait_ns;
+	u64 max_ns;
+	unsigned int hist[LOCK_PROF_HIST_BUCKETS];
+	struct lock_prof_site sites[LOCK_PROF_SITES];
+	struct list_head list;
+};
+
+#define DEFINE_LOCK_PROF(_var, _name)					\
+	struct lock_prof _var = {					\
+		.name = _name,						\
+		.lock = __SPIN_LOCK_UNLOCKED(_var.lock),		\
+		.list = LIST_HEAD_INIT(_var.list),			\
+	}
+
+extern void lock_prof_register(struct lock_prof *prof);
+extern int lock_prof_contended(struct lock_prof *prof);
+extern void lock_prof_record(struct lock_prof *prof, unsigned long long start,
+			     unsigned long ip);
+
+/*
+ * The wrappers are macros so that _THIS_IP_ names the caller's lock
+ * site, which is what the call site table reports.
+ */
+#define lock_prof_mutex_lock(m, prof)					\
+do {									\
+	if (likely(!(prof)->sample)) {					\
+		mutex_lock(m);						\
+	} else if (!mutex_trylock(m)) {					\
+		if (lock_prof_contended(prof)) {			\
+			unsigned long long __start = sched_clock();	\
+			mutex_lock(m);					\
+			lock_prof_record(prof, __start, _THIS_IP_);	\
+		} else {						\
+			mutex_lock(m);					\
+		}							\
+	}								\
+} while (0)
+
+#define lock_prof_spin_lock(l, prof)					\
+do {									\
+	if (likely(!(prof)->sample)) {					\
+		spin_lock(l);						\
+	} else if (!spin_trylock(l)) {					\
+		if (lock_prof_contended(prof)) {			\
+			unsigned long long __start = sched_clock();	\
+			spin_lock(l);					\
+			lock_prof_record(prof, __start, _THIS_IP_);	\
+		} else {						\
+			spin_lock(l);					\
+		}							\
+	}								\
+} while (0)
+
+#define lock_prof_spin_lock_irqsave(l, flags, prof)			\
+do {									\
+	if (likely(!(prof)->sample)) {					\
+		spin_lock_irqsave(l, flags);				\
+	} else if (!spin_trylock_irqsave(l, flags)) {			\
+		if (lock_prof_contended(prof)) {			\
+			unsigned long long __start = sched_clock();	\
+			spin_lock_irqsave(l, flags);			\
+			lock_prof_record(prof, __start, _THIS_IP_);	\
+		} else {						\
+			spin_lock_irqsave(l, flags);			\
+		}							\
+	}								\
+} while (0)
+
+#else /* !CONFIG_LOCK_PROF */
+
+struct lock_prof {
+};
+
+#define DEFINE_LOCK_PROF(_var, _name)	struct lock_prof _var = { }
+
+static inline void lock_prof_register(struct lock_prof *prof)
+{
+}
+
+#define lock_prof_mutex_lock(m, prof)					\
+	do { (void)(prof); mutex_lock(m); } while (0)
+#define lock_prof_spin_lock(l, prof)					\
+	do { (void)(prof); spin_lock(l); } while (0)
+#define lock_prof_spin_lock_irqsave(l, flags, prof)			\
+	do { (void)(prof); spin_lock_irqsave(l, flags); } while (0)
+
+#endif /* CONFIG_LOCK_PROF */
+
+#endif /* _LINUX_LOCK_PROF_H */
@@ -34,6 +34,7 @@ struct mmc_csd {
 	unsigned int		read_blkbits;
 	unsigned int		write_blkbits;
 	unsigned int		capacity;
+	unsigned int		erase_size;	/* In sectors */
 	unsigned int		read_partial:1,
 				read_misalign:1,
 				write_partial:1,
@@ -45,6 +46,21 @@ struct mmc_ext_csd {
 	unsigned int		sa_timeout;		/* Units: 100ns */
 	unsigned int		hs_max_dtr;
 	unsigned int		sectors;
+	u8			erase_group_def;
+	u8			sec_feature_support;
+	unsigned int		hc_erase_size;		/* In sectors */
+	unsigned int		cache_size;		/* Units: KB */
+	unsigned int		cache_ctrl:1;		/* cache enabled */
+	u8			max_packed_writes;
+};
+
+/* How the block driver sent writes, see the card's wr_pack_stats */
+struct mmc_wr_pack_stats {
+	unsigned int		packed_cmds;	/* packed CMD25s */
+	unsigned int		packed_reqs;	/* writes sent in them */
+	unsigned int		single_reqs;	/* writes sent on their own */
+	unsigned int		fallbacks;	/* packed CMD25s that failed */
+	unsigned int		flushes;	/* cache flushes */
 };
 
 struct sd_scr {
@@ -111,6 +127,7 @@ struct mmc_card {
 	u32			raw_scr[2];	/* raw card SCR */
 	struct mmc_cid		cid;		/* card identification */
 	struct mmc_csd		csd;		/* card specific */
+	unsigned int		erase_size;	/* erase size in sectors */
 	struct mmc_ext_csd	ext_csd;	/* mmc v4 extended card specific */
 	struct sd_scr		scr;		/* extra SD information */
 	struct sd_switch_caps	sw_caps;	/* switch (CMD6) caps */
@@ -125,6 +142,8 @@ struct mmc_card {
 
 	struct dentry		*debugfs_root;
 	unsigned int		removed;
+
+	struct mmc_wr_pack_stats wr_pack_stats;
 };
 
 #define mmc_card_mmc(c)		((c)->type == MMC_TYPE_MMC)
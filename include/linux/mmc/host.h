@@ -84,6 +84,17 @@ struct mmc_host_ops {
 	int (*enable)(struct mmc_host *host);
 	int (*disable)(struct mmc_host *host, int lazy);
 	void	(*request)(struct mmc_host *host, struct mmc_request *req);
+	/*
+	 * It is optional for the host to implement pre_req and post_req in
+	 * order to support double buffering of requests: pre_req prepares
+	 * (maps, builds descriptors for) the data of a request while another
+	 * request is still active, post_req is called once the prepared
+	 * request has completed or will not be issued at all and releases
+	 * whatever pre_req set up and request did not already release.
+	 */
+	void	(*pre_req)(struct mmc_host *host, struct mmc_request *req);
+	void	(*post_req)(struct mmc_host *host, struct mmc_request *req,
+			    int err);
 	/*
 	 * Avoid calling these three functions too often or in a "fast path",
 	 * since underlaying controller might implement them in an expensive
@@ -157,6 +168,8 @@ struct mmc_host {
 #define MMC_CAP_DISABLE		(1 << 7)	/* Can the host be disabled */
 #define MMC_CAP_NONREMOVABLE	(1 << 8)	/* Nonremovable e.g. eMMC */
 #define MMC_CAP_WAIT_WHILE_BUSY	(1 << 9)	/* Waits while card is busy */
+#define MMC_CAP_CACHE_CTRL	(1 << 10)	/* Can use the eMMC cache */
+#define MMC_CAP_PACKED_WR	(1 << 11)	/* Can do packed writes */
 
 	mmc_pm_flag_t		pm_caps;	/* supported pm features */
 
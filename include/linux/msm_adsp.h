@@ -29,6 +29,14 @@ struct adsp_command_t {
 	uint8_t *data;
 };
 
+/* ADSP_IOCTL_WRITE_COMMANDS */
+#define ADSP_MAX_BATCH_COMMANDS 16
+
+struct adsp_command_batch_t {
+	uint32_t count;		/* up to ADSP_MAX_BATCH_COMMANDS */
+	struct adsp_command_t *cmds;
+};
+
 /* ADSP_IOCTL_GET_EVENT */
 struct adsp_event_t {
 	uint16_t type;		/* 1 == event (RPC), 0 == message (adsp) */
@@ -81,4 +89,8 @@ struct adsp_pmem_info {
 #define ADSP_IOCTL_LINK_TASK \
 	_IOW(ADSP_IOCTL_MAGIC, 16, unsigned)
 
+/* Returns the number of commands written */
+#define ADSP_IOCTL_WRITE_COMMANDS \
+	_IOW(ADSP_IOCTL_MAGIC, 17, struct adsp_command_batch_t *)
+
 #endif
@@ -120,9 +120,22 @@
 					 struct msm_acdb_cmd_device)
 #define AUDIO_GET_ACDB_BLK             _IOW(AUDIO_IOCTL_MAGIC, 96,  \
 					 struct msm_acdb_cmd_device)
+#define AUDIO_GET_PRESENTATION_DELAY   _IOR(AUDIO_IOCTL_MAGIC, 97, unsigned)
+#define AUDIO_MMAP_NEXT_PERIOD         _IOWR(AUDIO_IOCTL_MAGIC, 98, \
+					 struct msm_audio_mmap_period)
 
 #define	AUDIO_MAX_COMMON_IOCTL_NUM	100
 
+/* AUDIO_SET_AAC_CONFIG shares its number with AUDIO_REGISTER_PMEM, so
+ * decoders taking pmem buffers, like the LPA one, use these instead.
+ */
+#define AUDIO_SET_AAC_LP_CONFIG        _IOW(AUDIO_IOCTL_MAGIC, \
+					 (AUDIO_MAX_COMMON_IOCTL_NUM + 0), \
+					 struct msm_audio_aac_config)
+#define AUDIO_GET_AAC_LP_CONFIG        _IOR(AUDIO_IOCTL_MAGIC, \
+					 (AUDIO_MAX_COMMON_IOCTL_NUM + 1), \
+					 struct msm_audio_aac_config)
+
 #define HANDSET_MIC			0x01
 #define HANDSET_SPKR			0x02
 #define HEADSET_MIC			0x03
@@ -286,6 +299,17 @@ struct msm_audio_stats {
 	uint32_t unused[2];
 };
 
+/* Period of an mmap()ed stream handed over by AUDIO_MMAP_NEXT_PERIOD.
+ * On entry @size gives back the period obtained by the previous call:
+ * bytes written for playback, non-zero to release it for capture. On
+ * return @offset and @size describe the next period, relative to the
+ * start of the mapping.
+ */
+struct msm_audio_mmap_period {
+	uint32_t offset;
+	uint32_t size;
+};
+
 struct msm_audio_pmem_info {
 	int fd;
 	void *vaddr;
@@ -83,6 +83,9 @@
 #define AUDIO_SET_AGC        _IOW(AUDIO_IOCTL_MAGIC, 90, unsigned)
 #define AUDIO_SET_NS         _IOW(AUDIO_IOCTL_MAGIC, 91, unsigned)
 #define AUDIO_SET_TX_IIR     _IOW(AUDIO_IOCTL_MAGIC, 92, unsigned)
+#define AUDIO_GET_PRESENTATION_DELAY _IOR(AUDIO_IOCTL_MAGIC, 97, unsigned)
+#define AUDIO_MMAP_NEXT_PERIOD _IOWR(AUDIO_IOCTL_MAGIC, 98, \
+				struct msm_audio_mmap_period)
 
 #define	AUDIO_MAX_COMMON_IOCTL_NUM	100
 
@@ -154,6 +157,17 @@ struct msm_audio_stats {
 	uint32_t unused[2];
 };
 
+/* Period of an mmap()ed stream handed over by AUDIO_MMAP_NEXT_PERIOD.
+ * On entry @size gives back the period obtained by the previous call:
+ * bytes written for playback, non-zero to release it for capture. On
+ * return @offset and @size describe the next period, relative to the
+ * start of the mapping.
+ */
+struct msm_audio_mmap_period {
+	uint32_t offset;
+	uint32_t size;
+};
+
 struct msm_audio_pmem_info {
 	int fd;
 	void *vaddr;
@@ -648,6 +648,31 @@ struct kgsl_gpumem_sync_cache {
 #define IOCTL_KGSL_GPUMEM_SYNC_CACHE \
 	_IOW(KGSL_IOC_TYPE, 0x37, struct kgsl_gpumem_sync_cache)
 
+/*
+ * struct kgsl_ringbuffer_issueibcmds_batch - argument to
+ * IOCTL_KGSL_RINGBUFFER_ISSUEIBCMDS_BATCH
+ * @cmds: Userspace pointer to an array of struct kgsl_ringbuffer_issueibcmds
+ * @count: Number of entries in @cmds, at most KGSL_IBCMDS_BATCH_MAX
+ * @flags: Reserved, must be 0
+ *
+ * Submit commands for one or more draw contexts in a single call.  Each
+ * entry is handled as by IOCTL_KGSL_RINGBUFFER_ISSUEIBCMDS and gets its
+ * timestamp written back, but the batch is handed to the GPU in one go
+ * and only the last entry raises an interrupt when it retires.
+ */
+struct kgsl_ringbuffer_issueibcmds_batch {
+	unsigned int cmds;
+	unsigned int count;
+	unsigned int flags;
+/* private: reserved for future use*/
+	unsigned int __pad[2]; /* For future binary compatibility */
+};
+
+#define KGSL_IBCMDS_BATCH_MAX 32
+
+#define IOCTL_KGSL_RINGBUFFER_ISSUEIBCMDS_BATCH \
+	_IOWR(KGSL_IOC_TYPE, 0x38, struct kgsl_ringbuffer_issueibcmds_batch)
+
 #ifdef __KERNEL__
 #ifdef CONFIG_MSM_KGSL_DRM
 int kgsl_gem_obj_addr(int drm_fd, int handle, unsigned long *start,
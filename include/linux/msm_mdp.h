@@ -79,6 +79,9 @@
 #define MSMFB_WRITEBACK_SET_MIRRORING_HINT _IOW(MSMFB_IOCTL_MAGIC, 167, \
 						unsigned int)
 #define MSMFB_ASYNC_BLIT              _IOW(MSMFB_IOCTL_MAGIC, 168, unsigned int)
+#define MSMFB_OVERLAY_PLAY_LIST _IOW(MSMFB_IOCTL_MAGIC, 169, \
+						struct mdp_overlay_list)
+#define MSMFB_DAMAGE_SET _IOW(MSMFB_IOCTL_MAGIC, 170, struct mdp_damage)
 
 #define FB_TYPE_3D_PANEL 0x10101010
 #define MDP_IMGTYPE2_START 0x10000
@@ -201,6 +204,18 @@ struct mdp_rect {
 	uint32_t h;
 };
 
+#define MDP_DAMAGE_MAX	16
+
+/*
+ * Regions of the framebuffer changed since the last pan display.  They
+ * are merged into one bounding rectangle which command mode panels
+ * transfer instead of the full frame on the next pan.
+ */
+struct mdp_damage {
+	uint32_t num_rects;
+	struct mdp_rect *rects;
+};
+
 struct mdp_img {
 	uint32_t width;
 	uint32_t height;
@@ -801,6 +816,17 @@ struct mdp_display_commit {
 	struct mdp_buf_fence buf_fence;
 };
 
+#define MDP_OVERLAY_LIST_MAX	8
+
+/* Commit the frame once all the layers in the list are queued */
+#define MDP_OVERLAY_LIST_COMMIT	0x00000001
+
+struct mdp_overlay_list {
+	uint32_t flags;
+	uint32_t num_overlays;
+	struct msmfb_overlay_data *overlay_list;
+};
+
 struct mdp_page_protection {
 	uint32_t page_protection;
 };
@@ -14,6 +14,7 @@
 
 struct zonelist;
 struct notifier_block;
+struct task_struct;
 
 /*
  * Types of limitations to the nodes from which allocations may occur
@@ -43,5 +44,27 @@ static inline void oom_killer_enable(void)
 {
 	oom_killer_disabled = false;
 }
+
+/*
+ * The Android lowmemorykiller keeps thread group leaders indexed by oom_adj
+ * so it can pick a victim without walking the task list.
+ */
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+extern void lowmem_adj_fork(struct task_struct *p);
+extern void lowmem_adj_update(struct task_struct *p);
+extern void lowmem_adj_exit(struct task_struct *p);
+#else
+static inline void lowmem_adj_fork(struct task_struct *p)
+{
+}
+
+static inline void lowmem_adj_update(struct task_struct *p)
+{
+}
+
+static inline void lowmem_adj_exit(struct task_struct *p)
+{
+}
+#endif
 #endif /* __KERNEL__*/
 #endif /* _INCLUDE_LINUX_OOM_H */
@@ -102,4 +102,12 @@
 
 #define PR_MCE_KILL_GET 34
 
+/*
+ * Get/set whether a thread is latency sensitive: its wakeups preempt
+ * eagerly and it runs in short slices. arg2 is 0 or 1 for the set,
+ * arg3 the thread id, 0 for the calling thread.
+ */
+#define PR_SET_LATENCY_SENSITIVE	35
+#define PR_GET_LATENCY_SENSITIVE	36
+
 #endif /* _LINUX_PRCTL_H */
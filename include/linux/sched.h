@@ -1211,6 +1211,8 @@ struct task_struct {
 #endif
 
 	unsigned int policy;
+	/* preempt eagerly on wakeup, see sched_set_latency_sensitive() */
+	unsigned int latency_sensitive;
 	cpumask_t cpus_allowed;
 
 #ifdef CONFIG_PREEMPT_RCU
@@ -1231,6 +1233,9 @@ struct task_struct {
 
 	struct list_head tasks;
 	struct plist_node pushable_tasks;
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+	struct hlist_node lowmem_node;	/* group leaders, by oom_adj */
+#endif
 
 	struct mm_struct *mm, *active_mm;
 #if defined(SPLIT_RSS_COUNTING)
@@ -1931,6 +1936,10 @@ int sched_rt_handler(struct ctl_table *table, int write,
 
 extern unsigned int sysctl_sched_compat_yield;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+extern unsigned int sysctl_sched_cfs_bandwidth_slice;
+#endif
+
 #ifdef CONFIG_SCHED_AUTOGROUP
 extern unsigned int sysctl_sched_autogroup_enabled;
 
@@ -2494,6 +2503,8 @@ __trace_special(void *__tr, void *__data,
 
 extern long sched_setaffinity(pid_t pid, const struct cpumask *new_mask);
 extern long sched_getaffinity(pid_t pid, struct cpumask *mask);
+extern long sched_set_latency_sensitive(pid_t pid, int on);
+extern long sched_get_latency_sensitive(pid_t pid);
 
 extern void normalize_rt_tasks(void);
 
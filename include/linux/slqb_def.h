@@ -79,6 +79,15 @@ struct kmem_cache_list {
 				/* Protects nr_partial, nr_slabs, and partial */
 	spinlock_t		page_lock;
 
+				/* Freelist high watermark of this list, moves
+				 * between freebatch and the cache's hiwater */
+	int			hiwater;
+				/* Allocations, freelist misses and hiwater
+				 * flushes since hiwater was last adapted */
+	unsigned int		adapt_allocs;
+	unsigned int		adapt_misses;
+	unsigned int		adapt_flushes;
+
 #ifdef CONFIG_SMP
 	/*
 	 * In the case of per-cpu lists, remote_free is for objects freed by
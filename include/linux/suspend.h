@@ -6,6 +6,7 @@
 #include <linux/init.h>
 #include <linux/pm.h>
 #include <linux/mm.h>
+#include <linux/ktime.h>
 #include <asm/errno.h>
 
 #if defined(CONFIG_PM_SLEEP) && defined(CONFIG_VT) && defined(CONFIG_VT_CONSOLE)
@@ -340,4 +341,20 @@ static inline void unlock_system_sleep(void)
 }
 #endif
 
+#ifdef CONFIG_PM_SLEEP_PROFILE
+/*
+ * Record that @phase, or @name's callback for @phase if @name is not NULL,
+ * ran from @start until now. pm_profile_begin marks a new sleep cycle.
+ */
+extern void pm_profile_begin(void);
+extern ktime_t pm_profile_start(void);
+extern void pm_profile_record(const char *name, const char *phase,
+			      ktime_t start);
+#else
+static inline void pm_profile_begin(void) {}
+static inline void pm_profile_record(const char *name, const char *phase,
+				     ktime_t start) {}
+static inline ktime_t pm_profile_start(void) { return ktime_set(0, 0); }
+#endif
+
 #endif /* _LINUX_SUSPEND_H */
@@ -440,6 +440,8 @@ struct tcp_sock {
 		u32	seq;
 		u32	time;
 	} rcvq_space;
+	int	rcv_rmem_max;	/* Receive buffer ceiling of the route's
+				 * interface, 0 to use tcp_rmem[2] */
 
 /* TCP-specific MTU probe information. */
 	struct {
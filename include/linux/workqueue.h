@@ -180,13 +180,21 @@ static inline void destroy_work_on_stack(struct work_struct *work) { }
 	clear_bit(WORK_STRUCT_PENDING, work_data_bits(work))
 
 
+/*
+ * Workqueue flags. Single threaded workqueues that are not freezeable
+ * and not WQ_RT run on a shared pool of workers rather than a thread of
+ * their own; WQ_HIGHPRI picks the pool whose workers run at nice -20.
+ */
+#define WQ_RT		(1 << 0)	/* SCHED_FIFO worker threads */
+#define WQ_HIGHPRI	(1 << 1)
+
 extern struct workqueue_struct *
 __create_workqueue_key(const char *name, int singlethread,
-		       int freezeable, int rt, struct lock_class_key *key,
-		       const char *lock_name);
+		       int freezeable, unsigned int flags,
+		       struct lock_class_key *key, const char *lock_name);
 
 #ifdef CONFIG_LOCKDEP
-#define __create_workqueue(name, singlethread, freezeable, rt)	\
+#define __create_workqueue(name, singlethread, freezeable, flags)	\
 ({								\
 	static struct lock_class_key __key;			\
 	const char *__lock_name;				\
@@ -197,19 +205,21 @@ __create_workqueue_key(const char *name, int singlethread,
 		__lock_name = #name;				\
 								\
 	__create_workqueue_key((name), (singlethread),		\
-			       (freezeable), (rt), &__key,	\
+			       (freezeable), (flags), &__key,	\
 			       __lock_name);			\
 })
 #else
-#define __create_workqueue(name, singlethread, freezeable, rt)	\
-	__create_workqueue_key((name), (singlethread), (freezeable), (rt), \
+#define __create_workqueue(name, singlethread, freezeable, flags)	\
+	__create_workqueue_key((name), (singlethread), (freezeable), (flags), \
 			       NULL, NULL)
 #endif
 
 #define create_workqueue(name) __create_workqueue((name), 0, 0, 0)
-#define create_rt_workqueue(name) __create_workqueue((name), 0, 0, 1)
+#define create_rt_workqueue(name) __create_workqueue((name), 0, 0, WQ_RT)
 #define create_freezeable_workqueue(name) __create_workqueue((name), 1, 1, 0)
 #define create_singlethread_workqueue(name) __create_workqueue((name), 1, 0, 0)
+#define create_singlethread_hipri_workqueue(name)			\
+	__create_workqueue((name), 1, 0, WQ_HIGHPRI)
 
 extern void destroy_workqueue(struct workqueue_struct *wq);
 extern int is_workqueue_empty(struct workqueue_struct *wq);
@@ -101,6 +101,12 @@ extern int vm_dirty_ratio;
 extern unsigned long vm_dirty_bytes;
 extern unsigned int dirty_writeback_interval;
 extern unsigned int dirty_expire_interval;
+#ifdef CONFIG_HAS_EARLYSUSPEND
+extern int dirty_background_ratio_screen_off;
+extern int vm_dirty_ratio_screen_off;
+extern unsigned int dirty_writeback_interval_screen_off;
+extern unsigned int dirty_expire_interval_screen_off;
+#endif
 extern int vm_highmem_is_dirtyable;
 extern int block_dump;
 extern int laptop_mode;
@@ -266,6 +266,7 @@ struct msm_vfe_reg_cfg_cmd {
 enum msm_isp_buf_type {
 	ISP_PRIVATE_BUF,
 	ISP_SHARE_BUF,
+	ISP_ZSL_BUF,
 	MAX_ISP_BUF_TYPE,
 };
 
@@ -286,6 +287,20 @@ struct msm_isp_qbuf_info {
 	uint32_t dirty_buf;
 };
 
+/*
+ * Claim the frame of a zero shutter lag ring that was written closest
+ * to timestamp. The buffer stays out of the ring until it is given back
+ * with VIDIOC_MSM_ISP_ENQUEUE_BUF.
+ */
+struct msm_isp_zsl_claim_info {
+	uint32_t handle;
+	struct timeval timestamp;
+	/*Filled in by the driver*/
+	int buf_idx;
+	uint32_t frame_id;
+	struct timeval frame_timestamp;
+};
+
 struct msm_vfe_axi_src_state {
 	enum msm_vfe_input_src input_src;
 	uint32_t src_active;
@@ -414,4 +429,7 @@ struct msm_isp_event_data {
 #define VIDIOC_MSM_ISP_UPDATE_STREAM \
 	_IOWR('V', BASE_VIDIOC_PRIVATE+13, struct msm_vfe_axi_stream_update_cmd)
 
+#define VIDIOC_MSM_ISP_ZSL_CLAIM_BUF \
+	_IOWR('V', BASE_VIDIOC_PRIVATE+14, struct msm_isp_zsl_claim_info)
+
 #endif /* __MSMB_ISP__ */
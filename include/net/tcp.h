@@ -1025,6 +1025,14 @@ static inline int tcp_full_space(const struct sock *sk)
 	return tcp_win_from_space(sk->sk_rcvbuf); 
 }
 
+/* Autotuning ceiling for the receive buffer */
+static inline int tcp_rmem_max(const struct sock *sk)
+{
+	return tcp_sk(sk)->rcv_rmem_max ? : sysctl_tcp_rmem[2];
+}
+
+extern void tcp_init_rmem_profile(struct sock *sk, int established);
+
 static inline void tcp_openreq_init(struct request_sock *req,
 				    struct tcp_options_received *rx_opt,
 				    struct sk_buff *skb)
@@ -0,0 +1,42 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM acpuclock
+
+#if !defined(_TRACE_ACPUCLOCK_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_ACPUCLOCK_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(acpuclk_set_rate,
+
+	TP_PROTO(unsigned int from_khz, unsigned int to_khz, u32 vdd_us,
+		 u32 pll_us, u32 src_us, u32 total_us),
+
+	TP_ARGS(from_khz, to_khz, vdd_us, pll_us, src_us, total_us),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	from_khz	)
+		__field(	unsigned int,	to_khz		)
+		__field(	u32,		vdd_us		)
+		__field(	u32,		pll_us		)
+		__field(	u32,		src_us		)
+		__field(	u32,		total_us	)
+	),
+
+	TP_fast_assign(
+		__entry->from_khz	= from_khz;
+		__entry->to_khz		= to_khz;
+		__entry->vdd_us		= vdd_us;
+		__entry->pll_us		= pll_us;
+		__entry->src_us		= src_us;
+		__entry->total_us	= total_us;
+	),
+
+	TP_printk("%u -> %u kHz: vdd=%uus pll=%uus src=%uus total=%uus",
+		  __entry->from_khz, __entry->to_khz, __entry->vdd_us,
+		  __entry->pll_us, __entry->src_us, __entry->total_us)
+);
+
+#endif /* _TRACE_ACPUCLOCK_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,31 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM smd
+
+#if !defined(_TRACE_SMD_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SMD_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(smd_notify,
+
+	TP_PROTO(const char *name, unsigned int flags),
+
+	TP_ARGS(name, flags),
+
+	TP_STRUCT__entry(
+		__string(	name,		name		)
+		__field(	unsigned int,	flags		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->flags	= flags;
+	),
+
+	TP_printk("%s flags=%u", __get_str(name), __entry->flags)
+);
+
+#endif /* _TRACE_SMD_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,69 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM smem_log
+
+#if !defined(_TRACE_SMEM_LOG_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SMEM_LOG_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(smem_log_event,
+
+	TP_PROTO(u32 id, u32 timetick, u32 data1, u32 data2, u32 data3),
+
+	TP_ARGS(id, timetick, data1, data2, data3),
+
+	TP_STRUCT__entry(
+		__field(	u32,	id		)
+		__field(	u32,	timetick	)
+		__field(	u32,	data1		)
+		__field(	u32,	data2		)
+		__field(	u32,	data3		)
+	),
+
+	TP_fast_assign(
+		__entry->id		= id;
+		__entry->timetick	= timetick;
+		__entry->data1		= data1;
+		__entry->data2		= data2;
+		__entry->data3		= data3;
+	),
+
+	TP_printk("id=%08x tick=%08x data=%08x %08x %08x",
+		  __entry->id, __entry->timetick,
+		  __entry->data1, __entry->data2, __entry->data3)
+);
+
+TRACE_EVENT(smem_log_event6,
+
+	TP_PROTO(u32 id, u32 timetick, u32 data1, u32 data2, u32 data3,
+		 u32 data4, u32 data5, u32 data6),
+
+	TP_ARGS(id, timetick, data1, data2, data3, data4, data5, data6),
+
+	TP_STRUCT__entry(
+		__field(	u32,	id		)
+		__field(	u32,	timetick	)
+		__array(	u32,	data,	6	)
+	),
+
+	TP_fast_assign(
+		__entry->id		= id;
+		__entry->timetick	= timetick;
+		__entry->data[0]	= data1;
+		__entry->data[1]	= data2;
+		__entry->data[2]	= data3;
+		__entry->data[3]	= data4;
+		__entry->data[4]	= data5;
+		__entry->data[5]	= data6;
+	),
+
+	TP_printk("id=%08x tick=%08x data=%08x %08x %08x %08x %08x %08x",
+		  __entry->id, __entry->timetick,
+		  __entry->data[0], __entry->data[1], __entry->data[2],
+		  __entry->data[3], __entry->data[4], __entry->data[5])
+);
+
+#endif /* _TRACE_SMEM_LOG_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
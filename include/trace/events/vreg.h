@@ -0,0 +1,49 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM vreg
+
+#if !defined(_TRACE_VREG_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_VREG_H
+
+#include <linux/tracepoint.h>
+
+/* A vote sent to the modem; repeats of the cached state are not sent */
+DECLARE_EVENT_CLASS(vreg_vote,
+
+	TP_PROTO(const char *name, unsigned int val, int rc),
+
+	TP_ARGS(name, val, rc),
+
+	TP_STRUCT__entry(
+		__string(	name,		name		)
+		__field(	unsigned int,	val		)
+		__field(	int,		rc		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->val	= val;
+		__entry->rc	= rc;
+	),
+
+	TP_printk("%s val=%u rc=%d", __get_str(name), __entry->val,
+		  __entry->rc)
+);
+
+DEFINE_EVENT(vreg_vote, vreg_switch,
+
+	TP_PROTO(const char *name, unsigned int val, int rc),
+
+	TP_ARGS(name, val, rc)
+);
+
+DEFINE_EVENT(vreg_vote, vreg_set_level,
+
+	TP_PROTO(const char *name, unsigned int val, int rc),
+
+	TP_ARGS(name, val, rc)
+);
+
+#endif /* _TRACE_VREG_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
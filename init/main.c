@@ -70,6 +70,7 @@
 #include <linux/sfi.h>
 #include <linux/shmem_fs.h>
 #include <linux/slab.h>
+#include <linux/boot_profile.h>
 #include <trace/boot.h>
 
 #include <asm/io.h>
@@ -731,7 +732,7 @@ static struct boot_trace_ret ret;
 int do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
-	ktime_t calltime = { .tv64 = 0 }, delta, rettime;
+	ktime_t calltime = { .tv64 = 0 }, delta, rettime, start;
 
 	if (initcall_debug) {
 		call.caller = task_pid_nr(current);
@@ -741,7 +742,9 @@ int do_one_initcall(initcall_t fn)
 		enable_boot_trace();
 	}
 
+	start = boot_profile_start();
 	ret.result = fn();
+	boot_profile_initcall(fn, start, ret.result);
 
 	if (initcall_debug) {
 		disable_boot_trace();
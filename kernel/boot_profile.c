@@ -0,0 +1,160 @@
+/*
+ * kernel/boot_profile.c
+ *
+ * Boot profiler: records the start time and duration of every initcall
+ * and driver probe into a fixed table, readable from debugfs as
+ * boot_profile. Unlike initcall_debug nothing is printed, so recording
+ * does not itself slow the boot down, and probes run from async
+ * threads are recorded too, with the pid they ran in. Probes keep
+ * being recorded after boot, module loads included, until the table
+ * is full.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/boot_profile.h>
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <asm/atomic.h>
+
+#define BOOT_PROFILE_NAME_LEN	48
+
+enum {
+	BOOT_PROFILE_INITCALL,
+	BOOT_PROFILE_PROBE,
+};
+
+struct boot_profile_entry {
+	s64 start_us;
+	u32 duration_us;
+	pid_t pid;
+	int ret;
+	int type;
+	int valid;
+	char name[BOOT_PROFILE_NAME_LEN];
+};
+
+static struct boot_profile_entry entries[CONFIG_BOOT_PROFILE_ENTRIES];
+static atomic_t nr_entries = ATOMIC_INIT(0);
+
+static const char * const type_names[] = {
+	[BOOT_PROFILE_INITCALL]	= "initcall",
+	[BOOT_PROFILE_PROBE]	= "probe",
+};
+
+/* NULL once the table is full; async probes claim slots concurrently */
+static struct boot_profile_entry *boot_profile_get(int type, ktime_t start,
+						   int ret)
+{
+	struct boot_profile_entry *e;
+	int i = atomic_inc_return(&nr_entries) - 1;
+
+	if (i >= ARRAY_SIZE(entries)) {
+		atomic_set(&nr_entries, ARRAY_SIZE(entries));
+		return NULL;
+	}
+
+	e = &entries[i];
+	e->start_us = ktime_to_us(start);
+	e->duration_us = ktime_us_delta(ktime_get(), start);
+	e->pid = task_pid_nr(current);
+	e->ret = ret;
+	e->type = type;
+	return e;
+}
+
+void boot_profile_initcall(initcall_t fn, ktime_t start, int ret)
+{
+	struct boot_profile_entry *e;
+
+	e = boot_profile_get(BOOT_PROFILE_INITCALL, start, ret);
+	if (!e)
+		return;
+	snprintf(e->name, sizeof(e->name), "%pf", fn);
+	smp_wmb();
+	e->valid = 1;
+}
+
+void boot_profile_probe(struct device_driver *drv, struct device *dev,
+			ktime_t start, int ret)
+{
+	struct boot_profile_entry *e;
+
+	e = boot_profile_get(BOOT_PROFILE_PROBE, start, ret);
+	if (!e)
+		return;
+	snprintf(e->name, sizeof(e->name), "%s %s", drv->name, dev_name(dev));
+	smp_wmb();
+	e->valid = 1;
+}
+
+static void *boot_profile_seq_start(struct seq_file *m, loff_t *pos)
+{
+	int n = min_t(int, atomic_read(&nr_entries), ARRAY_SIZE(entries));
+
+	if (*pos == 0)
+		seq_puts(m, "# start_us duration_us pid ret type name\n");
+	return *pos < n ? &entries[*pos] : NULL;
+}
+
+static void *boot_profile_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	++*pos;
+	return boot_profile_seq_start(m, pos);
+}
+
+static void boot_profile_seq_stop(struct seq_file *m, void *v)
+{
+}
+
+static int boot_profile_seq_show(struct seq_file *m, void *v)
+{
+	struct boot_profile_entry *e = v;
+
+	/* a slot that is still being filled in */
+	if (!e->valid)
+		return 0;
+	smp_rmb();
+
+	seq_printf(m, "%lld %u %d %d %s %s\n", e->start_us, e->duration_us,
+		   e->pid, e->ret, type_names[e->type], e->name);
+	return 0;
+}
+
+static const struct seq_operations boot_profile_seq_ops = {
+	.start	= boot_profile_seq_start,
+	.next	= boot_profile_seq_next,
+	.stop	= boot_profile_seq_stop,
+	.show	= boot_profile_seq_show,
+};
+
+static int boot_profile_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &boot_profile_seq_ops);
+}
+
+static const struct file_operations boot_profile_fops = {
+	.open		= boot_profile_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init boot_profile_init(void)
+{
+	debugfs_create_file("boot_profile", 0444, NULL, NULL,
+			    &boot_profile_fops);
+	return 0;
+}
+late_initcall(boot_profile_init);
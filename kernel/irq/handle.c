@@ -358,6 +358,19 @@ static void warn_no_thread(unsigned int irq, struct irqaction *action)
 	       "but no thread function available.", irq, action->name);
 }
 
+#ifdef CONFIG_IRQ_DURATION_HIST
+static void note_irq_duration(unsigned int irq, u64 start)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	u64 ns = sched_clock() - start;
+	unsigned int us = ns > UINT_MAX ? UINT_MAX : (unsigned int)ns / 1000;
+
+	desc->duration_hist[min(fls(us), IRQ_DURATION_BUCKETS - 1)]++;
+	if (ns > desc->duration_max_ns)
+		desc->duration_max_ns = ns;
+}
+#endif
+
 /**
  * handle_IRQ_event - irq action chain handler
  * @irq:	the interrupt number
@@ -369,6 +382,9 @@ irqreturn_t handle_IRQ_event(unsigned int irq, struct irqaction *action)
 {
 	irqreturn_t ret, retval = IRQ_NONE;
 	unsigned int status = 0;
+#ifdef CONFIG_IRQ_DURATION_HIST
+	u64 start = sched_clock();
+#endif
 
 	do {
 		trace_irq_handler_entry(irq, action);
@@ -423,6 +439,9 @@ irqreturn_t handle_IRQ_event(unsigned int irq, struct irqaction *action)
 		add_interrupt_randomness(irq);
 	local_irq_disable();
 
+#ifdef CONFIG_IRQ_DURATION_HIST
+	note_irq_duration(irq, start);
+#endif
 	return retval;
 }
 
@@ -224,6 +224,51 @@ static const struct file_operations irq_spurious_proc_fops = {
 	.release	= single_release,
 };
 
+#ifdef CONFIG_IRQ_DURATION_HIST
+static int irq_duration_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+	int i;
+
+	seq_printf(m, "   <1 us %u\n", desc->duration_hist[0]);
+	for (i = 1; i < IRQ_DURATION_BUCKETS - 1; i++)
+		seq_printf(m, "%5u us %u\n", 1U << (i - 1),
+			   desc->duration_hist[i]);
+	seq_printf(m, ">=%3u us %u\n", 1U << (i - 1),
+		   desc->duration_hist[i]);
+	seq_printf(m, "max %llu ns\n", desc->duration_max_ns);
+	return 0;
+}
+
+static ssize_t irq_duration_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	struct inode *inode = file->f_path.dentry->d_inode;
+	struct irq_desc *desc = irq_to_desc((long) PDE(inode)->data);
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	memset(desc->duration_hist, 0, sizeof(desc->duration_hist));
+	desc->duration_max_ns = 0;
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	return count;
+}
+
+static int irq_duration_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_duration_proc_show, PDE(inode)->data);
+}
+
+static const struct file_operations irq_duration_proc_fops = {
+	.open		= irq_duration_proc_open,
+	.read		= seq_read,
+	.write		= irq_duration_proc_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -295,6 +340,11 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 
 	proc_create_data("spurious", 0444, desc->dir,
 			 &irq_spurious_proc_fops, (void *)(long)irq);
+
+#ifdef CONFIG_IRQ_DURATION_HIST
+	proc_create_data("duration", 0644, desc->dir,
+			 &irq_duration_proc_fops, (void *)(long)irq);
+#endif
 }
 
 #undef MAX_NAMELEN
@@ -13,6 +13,7 @@
  *
  */
 
+#include <linux/async.h>
 #include <linux/earlysuspend.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
@@ -27,6 +28,7 @@ enum {
 	DEBUG_USER_STATE = 1U << 0,
 	DEBUG_SUSPEND = 1U << 2,
 	DEBUG_NO_SUSPEND = 1U << 3,
+	DEBUG_TIMING = 1U << 4,
 };
 #ifdef CONFIG_NO_SUSPEND
 static int debug_mask = DEBUG_USER_STATE | DEBUG_NO_SUSPEND;
@@ -35,6 +37,10 @@ static int debug_mask = DEBUG_USER_STATE;
 #endif
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
+/* Run the handlers of one level concurrently, levels still run in order */
+static int parallel = 1;
+module_param_named(parallel, parallel, int, S_IRUGO | S_IWUSR | S_IWGRP);
+
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
 static void early_suspend(struct work_struct *work);
@@ -90,9 +96,96 @@ EXPORT_SYMBOL(unregister_early_suspend);
 void sys_sync_debug(void);
 #endif
 
-static void early_suspend(struct work_struct *work)
+static LIST_HEAD(early_suspend_domain);
+static DEFINE_SPINLOCK(timing_lock);
+static void (*slowest_fn)(struct early_suspend *h);
+static s64 slowest_us;
+
+static void call_handler(struct early_suspend *h, bool resume)
+{
+	void (*fn)(struct early_suspend *h) = resume ? h->resume : h->suspend;
+	unsigned long irqflags;
+	ktime_t start;
+	s64 us;
+
+	start = ktime_get();
+	fn(h);
+	us = ktime_to_us(ktime_sub(ktime_get(), start));
+
+	if (debug_mask & DEBUG_TIMING)
+		pr_info("%s: %pf level %d took %lld us\n",
+			resume ? "late_resume" : "early_suspend", fn,
+			h->level, us);
+
+	spin_lock_irqsave(&timing_lock, irqflags);
+	if (us >= slowest_us) {
+		slowest_us = us;
+		slowest_fn = fn;
+	}
+	spin_unlock_irqrestore(&timing_lock, irqflags);
+}
+
+static void async_suspend_handler(void *data, async_cookie_t cookie)
+{
+	call_handler(data, false);
+}
+
+static void async_resume_handler(void *data, async_cookie_t cookie)
+{
+	call_handler(data, true);
+}
+
+/*
+ * Suspend handlers run in low to high level order and resume handlers in
+ * the opposite order. Caller must hold early_suspend_lock.
+ */
+static void call_handlers(struct list_head *handlers, bool resume,
+			  const char *tag)
 {
+	struct list_head *node;
 	struct early_suspend *pos;
+	int pending = 0;
+	int count = 0;
+	int level = 0;
+	ktime_t start;
+
+	slowest_fn = NULL;
+	slowest_us = 0;
+	start = ktime_get();
+
+	for (node = resume ? handlers->prev : handlers->next; node != handlers;
+	     node = resume ? node->prev : node->next) {
+		pos = list_entry(node, struct early_suspend, link);
+		if (!(resume ? pos->resume : pos->suspend))
+			continue;
+
+		if (pending && pos->level != level) {
+			async_synchronize_full_domain(&early_suspend_domain);
+			pending = 0;
+		}
+		level = pos->level;
+		count++;
+
+		if (parallel) {
+			async_schedule_domain(resume ? async_resume_handler :
+					      async_suspend_handler, pos,
+					      &early_suspend_domain);
+			pending = 1;
+		} else
+			call_handler(pos, resume);
+	}
+	if (pending)
+		async_synchronize_full_domain(&early_suspend_domain);
+
+	if (slowest_fn)
+		pr_info("[R] %s: %d handlers took %lld us, slowest %pf "
+			"%lld us\n", tag, count,
+			ktime_to_us(ktime_sub(ktime_get(), start)),
+			slowest_fn, slowest_us);
+}
+
+static void early_suspend(struct work_struct *work)
+{
 	unsigned long irqflags;
 	int abort = 0;
 
@@ -118,10 +211,7 @@ static void early_suspend(struct work_struct *work)
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
-	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL)
-			pos->suspend(pos);
-	}
+	call_handlers(&early_suspend_handlers, false, "early_suspend");
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -150,7 +240,6 @@ abort:
 
 static void late_resume(struct work_struct *work)
 {
-	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
 
@@ -174,9 +263,7 @@ static void late_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
-	list_for_each_entry_reverse(pos, &early_suspend_handlers, link)
-		if (pos->resume != NULL)
-			pos->resume(pos);
+	call_handlers(&early_suspend_handlers, true, "late_resume");
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: done\n");
 
@@ -214,7 +301,6 @@ EXPORT_SYMBOL(unregister_onchg_suspend);
 
 static void onchg_suspend(struct work_struct *work)
 {
-	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
 
@@ -238,10 +324,7 @@ static void onchg_suspend(struct work_struct *work)
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("onchg_suspend: call handlers\n");
 
-	list_for_each_entry(pos, &onchg_suspend_handlers, link) {
-		if (pos->suspend != NULL)
-			pos->suspend(pos);
-	}
+	call_handlers(&onchg_suspend_handlers, false, "onchg_suspend");
 	mutex_unlock(&early_suspend_lock);
 
 abort:
@@ -250,7 +333,6 @@ abort:
 
 static void onchg_resume(struct work_struct *work)
 {
-	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
 
@@ -271,9 +353,7 @@ static void onchg_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("onchg_resume: call handlers\n");
-	list_for_each_entry_reverse(pos, &onchg_suspend_handlers, link)
-		if (pos->resume != NULL)
-			pos->resume(pos);
+	call_handlers(&onchg_suspend_handlers, true, "onchg_resume");
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("onchg_resume: done\n");
 abort:
@@ -0,0 +1,182 @@
+/*
+ * kernel/power/profile.c - Suspend and resume latency profiler.
+ *
+ * Each phase of a sleep cycle and each device callback is timed by its
+ * caller and handed to pm_profile_record(). The slowest records since
+ * boot, or since the last reset, are kept sorted; the phases of the last
+ * cycle are kept in the order they ran. Both are read from debugfs:
+ *
+ *   suspend_profile/slowest	write anything to clear it
+ *   suspend_profile/last	phases of the last cycle
+ *
+ * Records come from process context, from async suspend threads and with
+ * interrupts off (noirq callbacks, system devices, the platform's enter),
+ * so everything here is under a spinlock taken with _irqsave.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/suspend.h>
+
+#define PM_PROFILE_SLOWEST	32
+#define PM_PROFILE_PHASES	32
+#define PM_PROFILE_NAME_LEN	24
+
+struct pm_profile_entry {
+	char name[PM_PROFILE_NAME_LEN];	/* empty for a whole phase */
+	const char *phase;
+	unsigned int cycle;
+	u32 us;
+};
+
+static DEFINE_SPINLOCK(pm_profile_lock);
+static struct pm_profile_entry slowest[PM_PROFILE_SLOWEST];
+static int nr_slowest;
+static struct pm_profile_entry last[PM_PROFILE_PHASES];
+static int nr_last;
+static unsigned int cycle;
+
+void pm_profile_begin(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	cycle++;
+	nr_last = 0;
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+}
+
+ktime_t pm_profile_start(void)
+{
+	return ktime_get();
+}
+
+static void fill_entry(struct pm_profile_entry *e, const char *name,
+		       const char *phase, u32 us)
+{
+	strlcpy(e->name, name ? name : "", sizeof(e->name));
+	e->phase = phase;
+	e->cycle = cycle;
+	e->us = us;
+}
+
+void pm_profile_record(const char *name, const char *phase, ktime_t start)
+{
+	unsigned long flags;
+	s64 delta;
+	u32 us;
+	int i;
+
+	delta = ktime_to_us(ktime_sub(ktime_get(), start));
+	us = clamp_t(s64, delta, 0, UINT_MAX);
+
+	/* Most devices have nothing to do, keep them out of the list */
+	if (name && !us)
+		return;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+
+	if (!name && nr_last < PM_PROFILE_PHASES)
+		fill_entry(&last[nr_last++], name, phase, us);
+
+	/* Keep slowest[] sorted, slowest first */
+	if (nr_slowest == PM_PROFILE_SLOWEST) {
+		if (us <= slowest[nr_slowest - 1].us)
+			goto out;
+		nr_slowest--;
+	}
+	for (i = nr_slowest; i > 0 && slowest[i - 1].us < us; i--)
+		slowest[i] = slowest[i - 1];
+	fill_entry(&slowest[i], name, phase, us);
+	nr_slowest++;
+out:
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+}
+
+static void show_entries(struct seq_file *m, struct pm_profile_entry *e,
+			 int *nr)
+{
+	unsigned long flags;
+	int i;
+
+	seq_printf(m, "%-6s %10s  %-16s %s\n", "cycle", "usecs", "phase",
+		   "device");
+
+	/* seq_printf() only copies into the seq_file buffer */
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	for (i = 0; i < *nr; i++)
+		seq_printf(m, "%-6u %10u  %-16s %s\n", e[i].cycle, e[i].us,
+			   e[i].phase, e[i].name);
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+}
+
+static int slowest_show(struct seq_file *m, void *unused)
+{
+	show_entries(m, slowest, &nr_slowest);
+	return 0;
+}
+
+static int slowest_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, slowest_show, NULL);
+}
+
+static ssize_t slowest_write(struct file *file, const char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	nr_slowest = 0;
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+
+	return count;
+}
+
+static const struct file_operations slowest_fops = {
+	.open		= slowest_open,
+	.read		= seq_read,
+	.write		= slowest_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int last_show(struct seq_file *m, void *unused)
+{
+	show_entries(m, last, &nr_last);
+	return 0;
+}
+
+static int last_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, last_show, NULL);
+}
+
+static const struct file_operations last_fops = {
+	.open		= last_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init pm_profile_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("suspend_profile", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("slowest", S_IRUGO | S_IWUSR, dir, NULL,
+			    &slowest_fops);
+	debugfs_create_file("last", S_IRUGO, dir, NULL, &last_fops);
+	return 0;
+}
+late_initcall(pm_profile_init);
@@ -43,6 +43,7 @@
 #include <linux/kernel.h>
 
 #include <linux/uaccess.h>
+#include <linux/workqueue.h>
 
 /*
  * locking rule: all changes to constraints or notifiers lists
@@ -112,13 +113,25 @@ static struct pm_qos_object system_bus_freq_pm_qos = {
 	.type = PM_QOS_MAX,
 };
 
+/* kHz; the aggregate is the fastest speed any request needs */
+static BLOCKING_NOTIFIER_HEAD(cpu_freq_min_notifier);
+static struct pm_qos_object cpu_freq_min_pm_qos = {
+	.constraints = PLIST_HEAD_INIT(cpu_freq_min_pm_qos.constraints),
+	.notifiers = &cpu_freq_min_notifier,
+	.name = "cpu_freq_min",
+	.target_value = PM_QOS_CPU_FREQ_MIN_DEFAULT_VALUE,
+	.default_value = PM_QOS_CPU_FREQ_MIN_DEFAULT_VALUE,
+	.type = PM_QOS_MAX,
+};
+
 
 static struct pm_qos_object *pm_qos_array[] = {
 	&null_pm_qos,
 	&cpu_dma_pm_qos,
 	&network_lat_pm_qos,
 	&network_throughput_pm_qos,
-	&system_bus_freq_pm_qos
+	&system_bus_freq_pm_qos,
+	&cpu_freq_min_pm_qos
 };
 
 static ssize_t pm_qos_power_write(struct file *filp, const char __user *buf,
@@ -237,6 +250,18 @@ int pm_qos_request_active(struct pm_qos_request *req)
 }
 EXPORT_SYMBOL_GPL(pm_qos_request_active);
 
+/* Returns a timed request to the class default when its timeout expires */
+static void pm_qos_work_fn(struct work_struct *work)
+{
+	struct pm_qos_request *req = container_of(to_delayed_work(work),
+						  struct pm_qos_request,
+						  work);
+	struct pm_qos_object *o = pm_qos_array[req->pm_qos_class];
+
+	if (req->node.prio != o->default_value)
+		update_target(o, &req->node, 0, o->default_value);
+}
+
 /**
  * pm_qos_add_request - inserts new qos request into the list
  * @req: pointer to a preallocated handle
@@ -266,6 +291,7 @@ void pm_qos_add_request(struct pm_qos_request *req,
 		new_value = value;
 	plist_node_init(&req->node, new_value);
 	req->pm_qos_class = pm_qos_class;
+	INIT_DELAYED_WORK(&req->work, pm_qos_work_fn);
 	update_target(o, &req->node, 0, PM_QOS_DEFAULT_VALUE);
 }
 EXPORT_SYMBOL_GPL(pm_qos_add_request);
@@ -278,7 +304,8 @@ EXPORT_SYMBOL_GPL(pm_qos_add_request);
  * Updates an existing qos request for the pm_qos_class of parameters along
  * with updating the target pm_qos_class value.
  *
- * Attempts are made to make this code callable on hot code paths.
+ * Attempts are made to make this code callable on hot code paths.  It
+ * only sleeps when it has to cancel a pending pm_qos_update_request_timeout.
  */
 void pm_qos_update_request(struct pm_qos_request *req,
 			   s32 new_value)
@@ -294,6 +321,9 @@ void pm_qos_update_request(struct pm_qos_request *req,
 		return;
 	}
 
+	if (delayed_work_pending(&req->work))
+		cancel_delayed_work_sync(&req->work);
+
 	o = pm_qos_array[req->pm_qos_class];
 
 	if (new_value == PM_QOS_DEFAULT_VALUE)
@@ -306,6 +336,42 @@ void pm_qos_update_request(struct pm_qos_request *req,
 }
 EXPORT_SYMBOL_GPL(pm_qos_update_request);
 
+/**
+ * pm_qos_update_request_timeout - modifies an existing qos request for a time
+ * @req: handle to list element holding a pm_qos request to use
+ * @new_value: defines the temporal qos request
+ * @timeout_us: how long the request holds, in microseconds
+ *
+ * After @timeout_us the request falls back to the class default.  Calling
+ * it again before then restarts the timeout, so a driver can hold a
+ * latency bound across a burst of interrupts without tracking its end.
+ * Must be called from process context.
+ */
+void pm_qos_update_request_timeout(struct pm_qos_request *req, s32 new_value,
+				   unsigned long timeout_us)
+{
+	struct pm_qos_object *o;
+
+	if (!req)
+		return;
+
+	if (!pm_qos_request_active(req)) {
+		WARN(1, KERN_ERR "pm_qos_update_request_timeout() called for unknown object\n");
+		return;
+	}
+
+	cancel_delayed_work_sync(&req->work);
+
+	o = pm_qos_array[req->pm_qos_class];
+	if (new_value == PM_QOS_DEFAULT_VALUE)
+		new_value = o->default_value;
+	if (new_value != req->node.prio)
+		update_target(o, &req->node, 0, new_value);
+
+	schedule_delayed_work(&req->work, usecs_to_jiffies(timeout_us));
+}
+EXPORT_SYMBOL_GPL(pm_qos_update_request_timeout);
+
 /**
  * pm_qos_remove_request - modifies an existing qos request
  * @req: handle to request list element
@@ -327,6 +393,9 @@ void pm_qos_remove_request(struct pm_qos_request *req)
 		return;
 	}
 
+	if (delayed_work_pending(&req->work))
+		cancel_delayed_work_sync(&req->work);
+
 	o = pm_qos_array[req->pm_qos_class];
 	update_target(o, &req->node, 1, PM_QOS_DEFAULT_VALUE);
 	memset(req, 0, sizeof(*req));
@@ -487,9 +556,15 @@ static int __init pm_qos_power_init(void)
 		return 0;
 	}
 	ret = register_pm_qos_misc(&system_bus_freq_pm_qos);
-	if (ret < 0)
+	if (ret < 0) {
 		printk(KERN_ERR
 			"pm_qos_param: system_bus_freq setup failed\n");
+		return ret;
+	}
+	ret = register_pm_qos_misc(&cpu_freq_min_pm_qos);
+	if (ret < 0)
+		printk(KERN_ERR
+			"pm_qos_param: cpu_freq_min setup failed\n");
 
 	return ret;
 }
@@ -134,6 +134,7 @@ void __attribute__ ((weak)) arch_suspend_enable_irqs(void)
  */
 static int suspend_enter(suspend_state_t state)
 {
+	ktime_t calltime;
 	int error;
 
 	if (suspend_ops->prepare) {
@@ -142,7 +143,9 @@ static int suspend_enter(suspend_state_t state)
 			goto Platform_finish;
 	}
 
+	calltime = pm_profile_start();
 	error = dpm_suspend_noirq(PMSG_SUSPEND);
+	pm_profile_record(NULL, "suspend_noirq", calltime);
 	if (error) {
 		printk(KERN_ERR "PM: Some devices failed to power down\n");
 		goto Platform_finish;
@@ -164,13 +167,17 @@ static int suspend_enter(suspend_state_t state)
 	arch_suspend_disable_irqs();
 	BUG_ON(!irqs_disabled());
 
+	calltime = pm_profile_start();
 	error = sysdev_suspend(PMSG_SUSPEND);
+	pm_profile_record(NULL, "sysdev_suspend", calltime);
 	if (!error) {
 		if (!suspend_test(TEST_CORE) && pm_check_wakeup_events()) {
 			error = suspend_ops->enter(state);
 			events_check_enabled = false;
 		}
+		calltime = pm_profile_start();
 		sysdev_resume();
+		pm_profile_record(NULL, "sysdev_resume", calltime);
 	}
 
 	arch_suspend_enable_irqs();
@@ -183,7 +190,9 @@ static int suspend_enter(suspend_state_t state)
 	if (suspend_ops->wake)
 		suspend_ops->wake();
 
+	calltime = pm_profile_start();
 	dpm_resume_noirq(PMSG_RESUME);
+	pm_profile_record(NULL, "resume_noirq", calltime);
 
  Platform_finish:
 	if (suspend_ops->finish)
@@ -199,6 +208,7 @@ static int suspend_enter(suspend_state_t state)
  */
 int suspend_devices_and_enter(suspend_state_t state)
 {
+	ktime_t calltime;
 	int error;
 
 	if (!suspend_ops)
@@ -211,7 +221,9 @@ int suspend_devices_and_enter(suspend_state_t state)
 	}
 	suspend_console();
 	suspend_test_start();
+	calltime = pm_profile_start();
 	error = dpm_suspend_start(PMSG_SUSPEND);
+	pm_profile_record(NULL, "suspend", calltime);
 	if (error) {
 		printk(KERN_ERR "PM: Some devices failed to suspend\n");
 		goto Recover_platform;
@@ -224,7 +236,9 @@ int suspend_devices_and_enter(suspend_state_t state)
 
  Resume_devices:
 	suspend_test_start();
+	calltime = pm_profile_start();
 	dpm_resume_end(PMSG_RESUME);
+	pm_profile_record(NULL, "resume", calltime);
 	suspend_test_finish("resume devices");
 	resume_console();
  Close:
@@ -264,6 +278,7 @@ static void suspend_finish(void)
  */
 int enter_state(suspend_state_t state)
 {
+	ktime_t calltime;
 	int error;
 
 	if (!valid_state(state))
@@ -276,8 +291,11 @@ int enter_state(suspend_state_t state)
 	sys_sync();
 	printk("done.\n");
 
+	pm_profile_begin();
 	pr_debug("PM: Preparing system for %s sleep\n", pm_states[state]);
+	calltime = pm_profile_start();
 	error = suspend_prepare();
+	pm_profile_record(NULL, "freeze", calltime);
 	if (error)
 		goto Unlock;
 
@@ -291,7 +309,9 @@ int enter_state(suspend_state_t state)
 
  Finish:
 	pr_debug("PM: Finishing wakeup.\n");
+	calltime = pm_profile_start();
 	suspend_finish();
+	pm_profile_record(NULL, "thaw", calltime);
  Unlock:
 	mutex_unlock(&pm_mutex);
 	return error;
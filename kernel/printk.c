@@ -37,6 +37,8 @@
 #include <linux/ratelimit.h>
 #include <linux/kmsg_dump.h>
 #include <linux/syslog.h>
+#include <linux/kthread.h>
+#include <linux/wait.h>
 
 #include <asm/uaccess.h>
 
@@ -712,6 +714,15 @@ static inline int can_use_console(unsigned int cpu)
  * interrupts disabled. It should return with 'lockbuf_lock'
  * released but interrupts still disabled.
  */
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+static int printk_defer_console(void);
+#else
+static inline int printk_defer_console(void)
+{
+	return 0;
+}
+#endif
+
 static int acquire_console_semaphore_for_printk(unsigned int cpu)
 {
 	int retval = 0;
@@ -878,8 +889,14 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	 * The acquire_console_semaphore_for_printk() function
 	 * will release 'logbuf_lock' regardless of whether it
 	 * actually gets the semaphore or not.
+	 *
+	 * With a deferred console the consoles are left to the
+	 * flush thread instead.
 	 */
-	if (acquire_console_semaphore_for_printk(this_cpu))
+	if (printk_defer_console()) {
+		printk_cpu = UINT_MAX;
+		spin_unlock(&logbuf_lock);
+	} else if (acquire_console_semaphore_for_printk(this_cpu))
 		release_console_sem();
 
 	lockdep_on();
@@ -1106,13 +1123,72 @@ int is_console_locked(void)
 	return console_locked;
 }
 
+#define PRINTK_PENDING_WAKEUP	0x01
+#define PRINTK_PENDING_FLUSH	0x02
+
 static DEFINE_PER_CPU(int, printk_pending);
 
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+static DECLARE_WAIT_QUEUE_HEAD(printk_flush_wait);
+static struct task_struct *printk_flush_task;
+
+/*
+ * Called from vprintk() with logbuf_lock held. Output is only left to the
+ * flush thread once the system is up; boot, shutdown and oops messages
+ * still go to the consoles before printk() returns. The thread cannot be
+ * woken here, since printk() may be called with the runqueue locked, so
+ * printk_tick() does it on the next tick.
+ */
+static int printk_defer_console(void)
+{
+	if (!printk_flush_task || oops_in_progress ||
+	    system_state != SYSTEM_RUNNING)
+		return 0;
+
+	__this_cpu_or(printk_pending, PRINTK_PENDING_FLUSH);
+	return 1;
+}
+
+/* resume_console() flushes whatever was printed while suspended */
+static int printk_flush_thread(void *unused)
+{
+	for (;;) {
+		wait_event_interruptible(printk_flush_wait,
+				con_start != log_end && !console_suspended);
+		acquire_console_sem();
+		release_console_sem();
+	}
+	return 0;
+}
+
+static int __init printk_flush_init(void)
+{
+	struct task_struct *task;
+
+	task = kthread_run(printk_flush_thread, NULL, "kconsoled");
+	if (IS_ERR(task)) {
+		pr_err("printk: no console flush thread, output stays "
+		       "synchronous\n");
+		return PTR_ERR(task);
+	}
+	printk_flush_task = task;
+	return 0;
+}
+early_initcall(printk_flush_init);
+#endif
+
 void printk_tick(void)
 {
-	if (__get_cpu_var(printk_pending)) {
+	int pending = __get_cpu_var(printk_pending);
+
+	if (pending) {
 		__get_cpu_var(printk_pending) = 0;
-		wake_up_interruptible(&log_wait);
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+		if (pending & PRINTK_PENDING_FLUSH)
+			wake_up_interruptible(&printk_flush_wait);
+#endif
 	}
 }
 
@@ -1126,7 +1202,7 @@ int printk_needs_cpu(int cpu)
 void wake_up_klogd(void)
 {
 	if (waitqueue_active(&log_wait))
-		this_cpu_write(printk_pending, 1);
+		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
 }
 
 /**
@@ -1617,6 +1617,16 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			else
 				error = PR_MCE_KILL_DEFAULT;
 			break;
+		case PR_SET_LATENCY_SENSITIVE:
+			if (arg2 > 1 || arg4 | arg5)
+				return -EINVAL;
+			error = sched_set_latency_sensitive((pid_t)arg3, arg2);
+			break;
+		case PR_GET_LATENCY_SENSITIVE:
+			if (arg2 | arg4 | arg5)
+				return -EINVAL;
+			error = sched_get_latency_sensitive((pid_t)arg3);
+			break;
 		default:
 			error = -EINVAL;
 			break;
@@ -267,6 +267,8 @@ static int max_sched_shares_ratelimit = NSEC_PER_SEC; /* 1 second */
 #ifdef CONFIG_COMPACTION
 static int min_extfrag_threshold;
 static int max_extfrag_threshold = 1000;
+static int max_compact_order = MAX_ORDER - 1;
+static int max_compact_interval = 3600;
 #endif
 
 static struct ctl_table kern_table[] = {
@@ -376,6 +378,16 @@ static struct ctl_table kern_table[] = {
 		.mode		= 0644,
 		.proc_handler	= sched_rt_handler,
 	},
+#ifdef CONFIG_CFS_BANDWIDTH
+	{
+		.procname	= "sched_cfs_bandwidth_slice_us",
+		.data		= &sysctl_sched_cfs_bandwidth_slice,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &one,
+	},
+#endif
 	{
 		.procname	= "sched_compat_yield",
 		.data		= &sysctl_sched_compat_yield,
@@ -1064,6 +1076,40 @@ static struct ctl_table vm_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	{
+		.procname	= "dirty_background_ratio_screen_off",
+		.data		= &dirty_background_ratio_screen_off,
+		.maxlen		= sizeof(dirty_background_ratio_screen_off),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one_hundred,
+	},
+	{
+		.procname	= "dirty_ratio_screen_off",
+		.data		= &vm_dirty_ratio_screen_off,
+		.maxlen		= sizeof(vm_dirty_ratio_screen_off),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &one,
+		.extra2		= &one_hundred,
+	},
+	{
+		.procname	= "dirty_writeback_centisecs_screen_off",
+		.data		= &dirty_writeback_interval_screen_off,
+		.maxlen		= sizeof(dirty_writeback_interval_screen_off),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec,
+	},
+	{
+		.procname	= "dirty_expire_centisecs_screen_off",
+		.data		= &dirty_expire_interval_screen_off,
+		.maxlen		= sizeof(dirty_expire_interval_screen_off),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec,
+	},
+#endif
 	{
 		.procname	= "nr_pdflush_threads",
 		.data		= &nr_pdflush_threads,
@@ -1156,6 +1202,24 @@ static struct ctl_table vm_table[] = {
 		.extra1		= &min_extfrag_threshold,
 		.extra2		= &max_extfrag_threshold,
 	},
+	{
+		.procname	= "compact_reserve_order",
+		.data		= &sysctl_compact_reserve_order,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= sysctl_kcompactd_handler,
+		.extra1		= &zero,
+		.extra2		= &max_compact_order,
+	},
+	{
+		.procname	= "compact_interval",
+		.data		= &sysctl_compact_interval,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= sysctl_kcompactd_handler,
+		.extra1		= &zero,
+		.extra2		= &max_compact_interval,
+	},
 
 #endif /* CONFIG_COMPACTION */
 	{
@@ -1396,6 +1460,14 @@ static struct ctl_table fs_table[] = {
 		.mode		= 0444,
 		.proc_handler	= proc_dointvec,
 	},
+	{
+		.procname	= "negative-dentry-limit",
+		.data		= &sysctl_negative_dentry_limit,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+	},
 	{
 		.procname	= "overflowuid",
 		.data		= &fs_overflowuid,
@@ -97,6 +97,40 @@ int print_workqueue(void)
 	return 0;
 }
 
+/*
+ * Single threaded workqueues that neither freeze nor run at rt priority
+ * have no thread of their own; they share the workers of a pool. A cwq
+ * with work on it is put on the pool's ready list and is run by one
+ * worker at a time, so its works still run one by one in the order they
+ * were queued. Every cwq that becomes ready claims an idle worker or has
+ * the pool's manager start a new one, so a work that sleeps, even on the
+ * completion of a work on another pooled workqueue, never holds up the
+ * rest. Workers idle for WORKER_IDLE_TIMEOUT exit, down to one.
+ */
+#define WORKER_IDLE_TIMEOUT	(300 * HZ)
+
+struct worker_pool {
+	spinlock_t lock;
+	struct list_head ready;		/* cwqs waiting for a worker */
+	struct list_head idle;		/* idle pool_workers */
+	int nr_workers;
+	int nr_requested;		/* workers the manager is to start */
+	int next_id;
+	int nice;
+	const char *suffix;
+	struct task_struct *manager;
+};
+
+struct pool_worker {
+	struct list_head entry;
+	struct task_struct *task;
+};
+
+static struct worker_pool worker_pools[2] = {
+	{ .suffix = "",  .nice = 0 },
+	{ .suffix = "H", .nice = -20 },
+};
+
 /*
  * The per-CPU workqueue (if single thread, we always use the first
  * possible cpu).
@@ -111,6 +145,12 @@ struct cpu_workqueue_struct {
 
 	struct workqueue_struct *wq;
 	struct task_struct *thread;
+
+	/* pooled workqueues only, protected by lock */
+	struct worker_pool *pool;
+	struct list_head ready_entry;
+	int scheduled;			/* on pool->ready or being run */
+	struct task_struct *runner;
 } ____cacheline_aligned;
 
 /*
@@ -123,7 +163,7 @@ struct workqueue_struct {
 	const char *name;
 	int singlethread;
 	int freezeable;		/* Freeze threads during suspend */
-	int rt;
+	unsigned int flags;	/* WQ_* */
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map lockdep_map;
 #endif
@@ -306,10 +346,35 @@ struct cpu_workqueue_struct *get_wq_data(struct work_struct *work)
 	return (void *) (atomic_long_read(&work->data) & WORK_STRUCT_WQ_DATA_MASK);
 }
 
+/* must hold cwq->lock */
+static void pool_schedule_cwq(struct cpu_workqueue_struct *cwq)
+{
+	struct worker_pool *pool = cwq->pool;
+	struct pool_worker *worker;
+
+	if (cwq->scheduled)
+		return;
+	cwq->scheduled = 1;
+
+	spin_lock(&pool->lock);
+	list_add_tail(&cwq->ready_entry, &pool->ready);
+	if (!list_empty(&pool->idle)) {
+		worker = list_first_entry(&pool->idle, struct pool_worker,
+					  entry);
+		list_del_init(&worker->entry);
+		wake_up_process(worker->task);
+	} else {
+		pool->nr_requested++;
+		wake_up_process(pool->manager);
+	}
+	spin_unlock(&pool->lock);
+}
+
 static void insert_work(struct cpu_workqueue_struct *cwq,
 			struct work_struct *work, struct list_head *head)
 {
-	trace_workqueue_insertion(cwq->thread, work);
+	if (cwq->thread)
+		trace_workqueue_insertion(cwq->thread, work);
 
 	set_wq_data(work, cwq);
 	/*
@@ -318,7 +383,10 @@ static void insert_work(struct cpu_workqueue_struct *cwq,
 	 */
 	smp_wmb();
 	list_add_tail(&work->entry, head);
-	wake_up(&cwq->more_work);
+	if (cwq->pool)
+		pool_schedule_cwq(cwq);
+	else
+		wake_up(&cwq->more_work);
 }
 
 static void __queue_work(struct cpu_workqueue_struct *cwq,
@@ -461,7 +529,8 @@ static void run_workqueue(struct cpu_workqueue_struct *cwq)
 		 */
 		struct lockdep_map lockdep_map = work->lockdep_map;
 #endif
-		trace_workqueue_execution(cwq->thread, work);
+		if (cwq->thread)
+			trace_workqueue_execution(cwq->thread, work);
 		debug_work_deactivate(work);
 		cwq->current_work = work;
 		list_del_init(cwq->worklist.next);
@@ -523,6 +592,146 @@ static int worker_thread(void *__cwq)
 	return 0;
 }
 
+/* Run the ready cwqs of a pool until it has none left, then go idle. */
+static int pool_worker_thread(void *__pool)
+{
+	struct worker_pool *pool = __pool;
+	struct cpu_workqueue_struct *cwq;
+	struct pool_worker worker;
+	long timeout;
+
+	worker.task = current;
+	INIT_LIST_HEAD(&worker.entry);
+
+	spin_lock_irq(&pool->lock);
+	for (;;) {
+		while (!list_empty(&pool->ready)) {
+			cwq = list_first_entry(&pool->ready,
+					       struct cpu_workqueue_struct,
+					       ready_entry);
+			list_del_init(&cwq->ready_entry);
+			spin_unlock_irq(&pool->lock);
+
+			cwq->runner = current;
+			for (;;) {
+				run_workqueue(cwq);
+
+				spin_lock_irq(&cwq->lock);
+				if (list_empty(&cwq->worklist))
+					break;
+				spin_unlock_irq(&cwq->lock);
+			}
+			cwq->runner = NULL;
+			cwq->scheduled = 0;
+			/* destroy_workqueue() may free cwq once we unlock */
+			wake_up(&cwq->more_work);
+			spin_unlock_irq(&cwq->lock);
+
+			spin_lock_irq(&pool->lock);
+		}
+
+		/* whoever takes us off the idle list has work for us */
+		list_add(&worker.entry, &pool->idle);
+		__set_current_state(TASK_INTERRUPTIBLE);
+		spin_unlock_irq(&pool->lock);
+
+		timeout = schedule_timeout(WORKER_IDLE_TIMEOUT);
+
+		spin_lock_irq(&pool->lock);
+		if (list_empty(&worker.entry))
+			continue;
+		if (!timeout && pool->nr_workers > 1 &&
+		    list_empty(&pool->ready)) {
+			list_del(&worker.entry);
+			pool->nr_workers--;
+			break;
+		}
+		list_del_init(&worker.entry);
+	}
+	spin_unlock_irq(&pool->lock);
+
+	return 0;
+}
+
+/* Start the workers pool_schedule_cwq() asked for; it can not sleep. */
+static int pool_manager_thread(void *__pool)
+{
+	struct worker_pool *pool = __pool;
+	struct task_struct *p;
+
+	for (;;) {
+		spin_lock_irq(&pool->lock);
+		while (!pool->nr_requested) {
+			__set_current_state(TASK_INTERRUPTIBLE);
+			spin_unlock_irq(&pool->lock);
+			schedule();
+			spin_lock_irq(&pool->lock);
+		}
+		pool->nr_requested--;
+		spin_unlock_irq(&pool->lock);
+
+		p = kthread_create(pool_worker_thread, pool, "kworker/u:%d%s",
+				   pool->next_id++, pool->suffix);
+		if (IS_ERR(p)) {
+			/* retry, the ready cwq is still waiting */
+			spin_lock_irq(&pool->lock);
+			pool->nr_requested++;
+			spin_unlock_irq(&pool->lock);
+			schedule_timeout_interruptible(HZ / 10);
+			continue;
+		}
+
+		set_user_nice(p, pool->nice);
+		spin_lock_irq(&pool->lock);
+		pool->nr_workers++;
+		spin_unlock_irq(&pool->lock);
+		wake_up_process(p);
+	}
+
+	return 0;
+}
+
+static int __init init_worker_pool(struct worker_pool *pool)
+{
+	struct task_struct *p;
+
+	spin_lock_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->ready);
+	INIT_LIST_HEAD(&pool->idle);
+
+	p = kthread_create(pool_manager_thread, pool, "kworker/u:m%s",
+			   pool->suffix);
+	if (IS_ERR(p))
+		return PTR_ERR(p);
+	set_user_nice(p, pool->nice);
+	pool->manager = p;
+	wake_up_process(p);
+
+	return 0;
+}
+
+static struct worker_pool *wq_pool(struct workqueue_struct *wq)
+{
+	struct worker_pool *pool;
+
+	if (!wq->singlethread || wq->freezeable || (wq->flags & WQ_RT))
+		return NULL;
+
+	pool = &worker_pools[(wq->flags & WQ_HIGHPRI) ? 1 : 0];
+	return pool->manager ? pool : NULL;
+}
+
+static int cwq_idle(struct cpu_workqueue_struct *cwq)
+{
+	int idle;
+
+	spin_lock_irq(&cwq->lock);
+	idle = !cwq->scheduled;
+	spin_unlock_irq(&cwq->lock);
+
+	return idle;
+}
+
 struct wq_barrier {
 	struct work_struct	work;
 	struct completion	done;
@@ -558,6 +767,7 @@ static int flush_cpu_workqueue(struct cpu_workqueue_struct *cwq)
 	struct wq_barrier barr;
 
 	WARN_ON(cwq->thread == current);
+	WARN_ON(cwq->pool && cwq->runner == current);
 
 	spin_lock_irq(&cwq->lock);
 	if (!list_empty(&cwq->worklist) || cwq->current_work != NULL) {
@@ -1028,8 +1238,10 @@ static int create_workqueue_thread(struct cpu_workqueue_struct *cwq, int cpu)
 	 */
 	if (IS_ERR(p))
 		return PTR_ERR(p);
-	if (cwq->wq->rt)
+	if (wq->flags & WQ_RT)
 		sched_setscheduler_nocheck(p, SCHED_FIFO, &param);
+	else if (wq->flags & WQ_HIGHPRI)
+		set_user_nice(p, worker_pools[1].nice);
 	cwq->thread = p;
 
 	trace_workqueue_creation(cwq->thread, cpu);
@@ -1051,7 +1263,7 @@ static void start_workqueue_thread(struct cpu_workqueue_struct *cwq, int cpu)
 struct workqueue_struct *__create_workqueue_key(const char *name,
 						int singlethread,
 						int freezeable,
-						int rt,
+						unsigned int flags,
 						struct lock_class_key *key,
 						const char *lock_name)
 {
@@ -1073,13 +1285,16 @@ struct workqueue_struct *__create_workqueue_key(const char *name,
 	lockdep_init_map(&wq->lockdep_map, lock_name, key, 0);
 	wq->singlethread = singlethread;
 	wq->freezeable = freezeable;
-	wq->rt = rt;
+	wq->flags = flags;
 	INIT_LIST_HEAD(&wq->list);
 
 	if (singlethread) {
 		cwq = init_cpu_workqueue(wq, singlethread_cpu);
-		err = create_workqueue_thread(cwq, singlethread_cpu);
-		start_workqueue_thread(cwq, -1);
+		cwq->pool = wq_pool(wq);
+		if (!cwq->pool) {
+			err = create_workqueue_thread(cwq, singlethread_cpu);
+			start_workqueue_thread(cwq, -1);
+		}
 	} else {
 		cpu_maps_update_begin();
 		/*
@@ -1117,6 +1332,13 @@ EXPORT_SYMBOL_GPL(__create_workqueue_key);
 
 static void cleanup_workqueue_thread(struct cpu_workqueue_struct *cwq)
 {
+	if (cwq->pool) {
+		flush_cpu_workqueue(cwq);
+		/* let the worker that ran the barrier let go of cwq */
+		wait_event(cwq->more_work, cwq_idle(cwq));
+		return;
+	}
+
 	/*
 	 * Our caller is either destroy_workqueue() or CPU_POST_DEAD,
 	 * cpu_add_remove_lock protects cwq->thread.
@@ -1274,6 +1496,11 @@ void __init init_workqueues(void)
 	singlethread_cpu = cpumask_first(cpu_possible_mask);
 	cpu_singlethread_map = cpumask_of(singlethread_cpu);
 	hotcpu_notifier(workqueue_cpu_callback, 0);
+	/* without a manager a pool is not used, wqs get their own thread */
+	if (init_worker_pool(&worker_pools[0]) ||
+	    init_worker_pool(&worker_pools[1]))
+		printk(KERN_ERR "workqueue: no worker pool, "
+		       "using a thread per workqueue\n");
 	keventd_wq = create_workqueue("events");
 	BUG_ON(!keventd_wq);
 }
@@ -0,0 +1,163 @@
+/*
+ * LZ4 decompressor for the Linux kernel.
+ *
+ * Reads the legacy stream format written by "lz4 -l" and "lz4c -l": a
+ * little endian magic number followed by blocks, each prefixed with its
+ * compressed size as a 32-bit little endian value and decompressing to
+ * at most 8 MB. The stream has no end marker; it ends with the input,
+ * with a zero size or at the 4-byte uncompressed size appended by the
+ * kernel build.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifdef STATIC
+#include "lz4/lz4_decompress.c"
+#else
+#include <linux/decompress/unlz4.h>
+#endif
+
+#include <linux/types.h>
+#include <linux/lz4.h>
+#include <linux/decompress/mm.h>
+
+#include <linux/compiler.h>
+#include <asm/unaligned.h>
+
+#define LZ4_LEGACY_MAGIC	0x184c2102
+#define LZ4_LEGACY_BLOCK_SIZE	(8 << 20)
+
+STATIC inline int INIT unlz4(u8 *input, int in_len,
+				int (*fill) (void *, unsigned int),
+				int (*flush) (void *, unsigned int),
+				u8 *output, int *posp,
+				void (*error_fn) (char *x))
+{
+	const long in_size = lz4_worst_compress(LZ4_LEGACY_BLOCK_SIZE) + 4;
+	long avail, pos, base = 0, i;
+	u8 *in_buf, *out_buf;
+	size_t dst_len;
+	u32 src_len;
+	int ret = -1, r;
+
+	set_error_fn(error_fn);
+
+	if (output) {
+		out_buf = output;
+	} else if (!flush) {
+		error("NULL output pointer and no flush function provided");
+		goto exit;
+	} else {
+		out_buf = large_malloc(LZ4_LEGACY_BLOCK_SIZE);
+		if (!out_buf) {
+			error("Could not allocate output buffer");
+			goto exit;
+		}
+	}
+
+	if (input && fill) {
+		error("Both input pointer and fill function provided, don't know what to do");
+		goto exit_1;
+	} else if (input) {
+		in_buf = input;
+		avail = in_len;
+	} else if (!fill || !posp) {
+		error("NULL input pointer and missing position pointer or fill function");
+		goto exit_1;
+	} else {
+		in_buf = large_malloc(in_size);
+		if (!in_buf) {
+			error("Could not allocate input buffer");
+			goto exit_1;
+		}
+		avail = 0;
+	}
+
+	if (posp)
+		*posp = 0;
+
+	if (fill) {
+		r = fill(in_buf, in_size);
+		if (r < 0) {
+			error("read error");
+			goto exit_2;
+		}
+		avail = r;
+	}
+
+	if (avail < 4 || get_unaligned_le32(in_buf) != LZ4_LEGACY_MAGIC) {
+		error("invalid header");
+		goto exit_2;
+	}
+	pos = 4;
+
+	for (;;) {
+		/*
+		 * Move what is left of the buffer to its start and refill
+		 * when the next block is not complete. The copy runs
+		 * forward by hand: memmove() is not there before boot.
+		 */
+		if (fill && (avail - pos < 4 ||
+			     get_unaligned_le32(in_buf + pos) > avail - pos - 4)) {
+			for (i = 0; i < avail - pos; i++)
+				in_buf[i] = in_buf[pos + i];
+			base += pos;
+			avail -= pos;
+			pos = 0;
+			r = fill(in_buf + avail, in_size - avail);
+			if (r < 0) {
+				error("read error");
+				goto exit_2;
+			}
+			avail += r;
+		}
+
+		/* no block is this short, so what is left is the image size */
+		if (avail - pos <= 4)
+			break;
+
+		src_len = get_unaligned_le32(in_buf + pos);
+		if (src_len == LZ4_LEGACY_MAGIC) {
+			/* concatenated streams */
+			pos += 4;
+			continue;
+		}
+		if (!src_len)
+			break;
+		if (src_len > avail - pos - 4) {
+			error("file corrupted");
+			goto exit_2;
+		}
+
+		dst_len = LZ4_LEGACY_BLOCK_SIZE;
+		if (lz4_decompress_safe(in_buf + pos + 4, src_len,
+					out_buf, &dst_len) != LZ4_E_OK) {
+			error("Compressed data violation");
+			goto exit_2;
+		}
+
+		if (flush && flush(out_buf, dst_len) != dst_len) {
+			error("write error");
+			goto exit_2;
+		}
+		if (output)
+			out_buf += dst_len;
+		pos += 4 + src_len;
+		if (posp)
+			*posp = base + pos;
+	}
+
+	ret = 0;
+exit_2:
+	if (!input)
+		large_free(in_buf);
+exit_1:
+	if (!output)
+		large_free(out_buf);
+exit:
+	return ret;
+}
+
+#define decompress unlz4
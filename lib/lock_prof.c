@@ -0,0 +1,197 @@
+/*
+ * lib/lock_prof.c
+ *
+ * Sampling contention profiler for individual hot locks.
+ *
+ * Each registered lock gets a directory under debugfs lock_prof/ with:
+ *  sample - 0 to stop profiling, N to time one in N contended acquisitions
+ *  stats  - contention counts, a wait time histogram and the call sites
+ *           that waited longest in total; any write clears them
+ *
+ * The contention count itself is not locked and may lose updates; it
+ * only paces the sampling. Recording a sample happens with the profiled
+ * lock held, so it adds a little to that hold time.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <linux/lock_prof.h>
+
+static DEFINE_MUTEX(lock_prof_mutex);
+static LIST_HEAD(lock_prof_list);
+static struct dentry *lock_prof_dir;
+
+int lock_prof_contended(struct lock_prof *prof)
+{
+	prof->contended++;
+	if (++prof->skip < prof->sample)
+		return 0;
+	prof->skip = 0;
+	return 1;
+}
+EXPORT_SYMBOL_GPL(lock_prof_contended);
+
+void lock_prof_record(struct lock_prof *prof, unsigned long long start,
+		      unsigned long ip)
+{
+	u64 ns = sched_clock() - start;
+	struct lock_prof_site *site, *victim = NULL;
+	unsigned long flags;
+	unsigned int us;
+	int i;
+
+	us = ns >> 32 ? UINT_MAX : (u32)ns / NSEC_PER_USEC;
+
+	spin_lock_irqsave(&prof->lock, flags);
+	prof->sampled++;
+	prof->wait_ns += ns;
+	if (ns > prof->max_ns)
+		prof->max_ns = ns;
+	prof->hist[min_t(int, fls(us), LOCK_PROF_HIST_BUCKETS - 1)]++;
+
+	/* keep the sites seen most often, replacing the rarest */
+	for (i = 0; i < LOCK_PROF_SITES; i++) {
+		site = &prof->sites[i];
+		if (site->ip == ip || !site->ip)
+			break;
+		if (!victim || site->count < victim->count)
+			victim = site;
+	}
+	if (i == LOCK_PROF_SITES) {
+		site = victim;
+		site->count = 0;
+		site->wait_ns = 0;
+	}
+	site->ip = ip;
+	site->count++;
+	site->wait_ns += ns;
+	spin_unlock_irqrestore(&prof->lock, flags);
+}
+EXPORT_SYMBOL_GPL(lock_prof_record);
+
+static int lock_prof_stats_show(struct seq_file *m, void *unused)
+{
+	struct lock_prof *prof = m->private;
+	struct lock_prof snap;
+	unsigned long flags;
+	int i, j;
+
+	spin_lock_irqsave(&prof->lock, flags);
+	snap = *prof;
+	spin_unlock_irqrestore(&prof->lock, flags);
+
+	seq_printf(m, "contended %lu sampled %lu wait %llu us max %llu us\n",
+		   snap.contended, snap.sampled,
+		   div_u64(snap.wait_ns, NSEC_PER_USEC),
+		   div_u64(snap.max_ns, NSEC_PER_USEC));
+
+	seq_printf(m, "wait histogram:\n");
+	seq_printf(m, "  %8s us  %u\n", "< 1", snap.hist[0]);
+	for (i = 1; i < LOCK_PROF_HIST_BUCKETS - 1; i++)
+		seq_printf(m, "  %8u us+ %u\n", 1U << (i - 1), snap.hist[i]);
+	seq_printf(m, "  %8u us+ %u\n", 1U << (i - 1), snap.hist[i]);
+
+	/* call sites by total wait, longest first */
+	seq_printf(m, "call sites:\n");
+	for (i = 0; i < LOCK_PROF_SITES && snap.sites[i].ip; i++) {
+		int max = i;
+
+		for (j = i + 1; j < LOCK_PROF_SITES && snap.sites[j].ip; j++)
+			if (snap.sites[j].wait_ns > snap.sites[max].wait_ns)
+				max = j;
+		swap(snap.sites[i], snap.sites[max]);
+
+		seq_printf(m, "  %8u %10llu us  %pS\n", snap.sites[i].count,
+			   div_u64(snap.sites[i].wait_ns, NSEC_PER_USEC),
+			   (void *)snap.sites[i].ip);
+	}
+	return 0;
+}
+
+static int lock_prof_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lock_prof_stats_show, inode->i_private);
+}
+
+static ssize_t lock_prof_stats_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct lock_prof *prof =
+		((struct seq_file *)file->private_data)->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&prof->lock, flags);
+	prof->contended = 0;
+	prof->sampled = 0;
+	prof->wait_ns = 0;
+	prof->max_ns = 0;
+	memset(prof->hist, 0, sizeof(prof->hist));
+	memset(prof->sites, 0, sizeof(prof->sites));
+	spin_unlock_irqrestore(&prof->lock, flags);
+	return count;
+}
+
+static const struct file_operations lock_prof_stats_fops = {
+	.open		= lock_prof_stats_open,
+	.read		= seq_read,
+	.write		= lock_prof_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* Must hold lock_prof_mutex */
+static void lock_prof_add_debugfs(struct lock_prof *prof)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir(prof->name, lock_prof_dir);
+	if (!dir)
+		return;
+	debugfs_create_u32("sample", 0600, dir, &prof->sample);
+	debugfs_create_file("stats", 0600, dir, prof, &lock_prof_stats_fops);
+}
+
+/**
+ * lock_prof_register - make a lock's profile visible in debugfs
+ * @prof: the profile, defined with DEFINE_LOCK_PROF
+ *
+ * Profiles are never removed, so a module registering one must not be
+ * unloadable.
+ */
+void lock_prof_register(struct lock_prof *prof)
+{
+	mutex_lock(&lock_prof_mutex);
+	list_add_tail(&prof->list, &lock_prof_list);
+	if (lock_prof_dir)
+		lock_prof_add_debugfs(prof);
+	mutex_unlock(&lock_prof_mutex);
+}
+EXPORT_SYMBOL_GPL(lock_prof_register);
+
+static int __init lock_prof_init(void)
+{
+	struct lock_prof *prof;
+
+	mutex_lock(&lock_prof_mutex);
+	lock_prof_dir = debugfs_create_dir("lock_prof", NULL);
+	if (lock_prof_dir)
+		list_for_each_entry(prof, &lock_prof_list, list)
+			lock_prof_add_debugfs(prof);
+	mutex_unlock(&lock_prof_mutex);
+	return 0;
+}
+core_initcall_sync(lock_prof_init);
@@ -0,0 +1,129 @@
+/*
+ *  LZ4 Compressor
+ *
+ *  Greedy single pass encoder for the LZ4 block format, with one hash
+ *  table slot per 4-byte sequence. The output decodes with any LZ4
+ *  block decoder, including the reference one by Yann Collet,
+ *  http://code.google.com/p/lz4/
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+static inline u32 lz4_hash(const unsigned char *p)
+{
+	return (get_unaligned_le32(p) * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+/* Bytes a length of @len takes after its nibble in the token */
+static inline size_t lz4_len_bytes(size_t len, size_t mask)
+{
+	return len < mask ? 0 : (len - mask) / 255 + 1;
+}
+
+static inline unsigned char *lz4_write_len(unsigned char *op, size_t len)
+{
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = len;
+	return op;
+}
+
+int lz4_compress(const unsigned char *in, size_t in_len,
+			unsigned char *out, size_t *out_len, void *wrkmem)
+{
+	const unsigned char * const in_end = in + in_len;
+	const unsigned char * const mf_limit = in_end - LZ4_MF_LIMIT;
+	const unsigned char * const match_limit = in_end - LZ4_LAST_LITERALS;
+	const unsigned char *ip = in, *anchor = in, *ref;
+	unsigned char *op = out;
+	unsigned char * const op_end = out + *out_len;
+	u32 * const dict = wrkmem;
+	size_t lit, len;
+	unsigned char *token;
+
+	if (in_len <= LZ4_MF_LIMIT)
+		goto last_literals;
+
+	memset(dict, 0, LZ4_MEM_COMPRESS);
+	dict[lz4_hash(ip++)] = 0;
+
+	while (ip < mf_limit) {
+		u32 h = lz4_hash(ip);
+
+		ref = in + dict[h];
+		dict[h] = ip - in;
+		if (ref >= ip || ip - ref > LZ4_MAX_DISTANCE ||
+		    get_unaligned((const u32 *)ref) !=
+		    get_unaligned((const u32 *)ip)) {
+			/* step faster the longer nothing has matched */
+			ip += 1 + ((ip - anchor) >> LZ4_SKIP_STRENGTH);
+			continue;
+		}
+
+		while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+		len = LZ4_MIN_MATCH;
+		while (ip + len < match_limit && ip[len] == ref[len])
+			len++;
+
+		lit = ip - anchor;
+		if ((size_t)(op_end - op) < 1 + lz4_len_bytes(lit, LZ4_RUN_MASK) +
+		    lit + 2 + lz4_len_bytes(len - LZ4_MIN_MATCH, LZ4_ML_MASK))
+			return LZ4_E_OUTPUT_OVERRUN;
+
+		token = op++;
+		if (lit >= LZ4_RUN_MASK) {
+			*token = LZ4_RUN_MASK << LZ4_RUN_BITS;
+			op = lz4_write_len(op, lit - LZ4_RUN_MASK);
+		} else
+			*token = lit << LZ4_RUN_BITS;
+		memcpy(op, anchor, lit);
+		op += lit;
+
+		put_unaligned_le16(ip - ref, op);
+		op += 2;
+
+		len -= LZ4_MIN_MATCH;
+		if (len >= LZ4_ML_MASK) {
+			*token |= LZ4_ML_MASK;
+			op = lz4_write_len(op, len - LZ4_ML_MASK);
+		} else
+			*token |= len;
+
+		ip += len + LZ4_MIN_MATCH;
+		anchor = ip;
+	}
+
+last_literals:
+	lit = in_end - anchor;
+	if ((size_t)(op_end - op) < 1 + lz4_len_bytes(lit, LZ4_RUN_MASK) + lit)
+		return LZ4_E_OUTPUT_OVERRUN;
+
+	if (lit >= LZ4_RUN_MASK) {
+		*op++ = LZ4_RUN_MASK << LZ4_RUN_BITS;
+		op = lz4_write_len(op, lit - LZ4_RUN_MASK);
+	} else
+		*op++ = lit << LZ4_RUN_BITS;
+	memcpy(op, anchor, lit);
+	op += lit;
+
+	*out_len = op - out;
+	return LZ4_E_OK;
+}
+EXPORT_SYMBOL_GPL(lz4_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Compressor");
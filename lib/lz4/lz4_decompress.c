@@ -0,0 +1,133 @@
+/*
+ *  LZ4 Decompressor
+ *
+ *  Decoder for the LZ4 block format of the reference implementation
+ *  by Yann Collet, http://code.google.com/p/lz4/
+ *
+ *  Every length is checked against both buffers, so corrupt or
+ *  malicious input can fail but never reads or writes out of bounds.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#ifndef STATIC
+#include <linux/module.h>
+#include <linux/kernel.h>
+
+#endif
+
+#include <asm/unaligned.h>
+#include <linux/lz4.h>
+#include "lz4defs.h"
+
+/*
+ * Most runs are a few bytes long, where a call to memcpy() costs more
+ * than the copy itself.
+ */
+static inline void lz4_copy(unsigned char *op, const unsigned char *ip,
+			    size_t len)
+{
+	if (len >= 16) {
+		memcpy(op, ip, len);
+		return;
+	}
+	while (len--)
+		*op++ = *ip++;
+}
+
+/* Returns 0 with *len increased, or -1 if the input ends first */
+static inline int lz4_read_len(const unsigned char **ip,
+			       const unsigned char *ip_end, size_t *len)
+{
+	unsigned int s;
+
+	do {
+		if (*ip >= ip_end)
+			return -1;
+		s = *(*ip)++;
+		*len += s;
+	} while (s == 255);
+
+	return 0;
+}
+
+int lz4_decompress_safe(const unsigned char *in, size_t in_len,
+			unsigned char *out, size_t *out_len)
+{
+	const unsigned char *ip = in;
+	const unsigned char * const ip_end = in + in_len;
+	unsigned char *op = out;
+	unsigned char * const op_end = out + *out_len;
+	const unsigned char *m_pos;
+	unsigned int token;
+	size_t len, offset;
+
+	for (;;) {
+		if (ip >= ip_end)
+			goto input_overrun;
+		token = *ip++;
+
+		len = token >> LZ4_RUN_BITS;
+		if (len == LZ4_RUN_MASK && lz4_read_len(&ip, ip_end, &len))
+			goto input_overrun;
+		if (len > (size_t)(ip_end - ip))
+			goto input_overrun;
+		if (len > (size_t)(op_end - op))
+			goto output_overrun;
+		lz4_copy(op, ip, len);
+		op += len;
+		ip += len;
+
+		/* only the last sequence stops after its literals */
+		if (ip == ip_end)
+			break;
+
+		if (ip_end - ip < 2)
+			goto input_overrun;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (!offset || offset > (size_t)(op - out))
+			goto lookbehind_overrun;
+		m_pos = op - offset;
+
+		len = token & LZ4_ML_MASK;
+		if (len == LZ4_ML_MASK && lz4_read_len(&ip, ip_end, &len))
+			goto input_overrun;
+		len += LZ4_MIN_MATCH;
+		if (len > (size_t)(op_end - op))
+			goto output_overrun;
+
+		if (offset >= len) {
+			lz4_copy(op, m_pos, len);
+			op += len;
+		} else {
+			/* overlapping match: repeats the last offset bytes */
+			while (len--)
+				*op++ = *m_pos++;
+		}
+	}
+
+	*out_len = op - out;
+	return LZ4_E_OK;
+
+input_overrun:
+	*out_len = op - out;
+	return LZ4_E_INPUT_OVERRUN;
+
+output_overrun:
+	*out_len = op - out;
+	return LZ4_E_OUTPUT_OVERRUN;
+
+lookbehind_overrun:
+	*out_len = op - out;
+	return LZ4_E_LOOKBEHIND_OVERRUN;
+}
+#ifndef STATIC
+EXPORT_SYMBOL_GPL(lz4_decompress_safe);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
+
+#endif
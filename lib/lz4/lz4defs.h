@@ -0,0 +1,25 @@
+/*
+ *  lz4defs.h -- constants of the LZ4 block format
+ *
+ *  A sequence is a token byte, an optional literal length extension,
+ *  the literals, a 16-bit little endian match offset and an optional
+ *  match length extension. The high nibble of the token is the literal
+ *  length and the low nibble the match length less LZ4_MIN_MATCH; a
+ *  nibble of 15 is continued by bytes that are added in until one is
+ *  not 255. The last sequence of a block carries literals only.
+ */
+
+#define LZ4_MIN_MATCH		4
+#define LZ4_MAX_DISTANCE	0xffff
+
+#define LZ4_RUN_BITS		4
+#define LZ4_RUN_MASK		((1U << LZ4_RUN_BITS) - 1)
+#define LZ4_ML_MASK		LZ4_RUN_MASK
+
+/* the last match must start this far before the end of the block... */
+#define LZ4_MF_LIMIT		12
+/* ...and the block must end with at least this many literals */
+#define LZ4_LAST_LITERALS	5
+
+/* larger values skip incompressible data faster */
+#define LZ4_SKIP_STRENGTH	6
@@ -0,0 +1,151 @@
+/*
+ * Memory copy throughput benchmark
+ *
+ * Times memcpy(), copy_page(), memset() and the user copies for a range
+ * of sizes, once on a buffer that stays in the cache and once walking a
+ * span larger than the L2 so that every source line comes from memory.
+ * The results go to the kernel log in MB/s; the module refuses to stay
+ * loaded so it can simply be loaded again, for instance on kernels
+ * built with different CONFIG_ARM_PLD_EXTRA_LINES.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/math64.h>
+#include <asm/page.h>
+
+static unsigned int iters = 2000;
+module_param(iters, uint, 0);
+MODULE_PARM_DESC(iters, "Copies timed per size and function");
+
+static unsigned int span_kb = 2048;
+module_param(span_kb, uint, 0);
+MODULE_PARM_DESC(span_kb, "Buffer walked by the cold runs, in kB");
+
+enum {
+	BENCH_MEMCPY,
+	BENCH_COPY_PAGE,
+	BENCH_MEMSET,
+	BENCH_TO_USER,
+	BENCH_FROM_USER,
+};
+
+static const char * const names[] __initconst = {
+	"memcpy", "copy_page", "memset", "copy_to_user", "copy_from_user",
+};
+
+static const size_t sizes[] __initconst = {
+	64, 256, 1024, 4096, 16384, 65536,
+};
+
+static char *src, *dst;
+static size_t span;
+
+static void __init bench_one(int fn, size_t size, size_t off)
+{
+	switch (fn) {
+	case BENCH_MEMCPY:
+		memcpy(dst + off, src + off, size);
+		break;
+	case BENCH_COPY_PAGE:
+		copy_page(dst + off, src + off);
+		break;
+	case BENCH_MEMSET:
+		memset(dst + off, 0, size);
+		break;
+	case BENCH_TO_USER:
+		if (__copy_to_user((void __user *)(dst + off), src + off, size))
+			pr_warning("test_copy_bench: copy_to_user faulted\n");
+		break;
+	case BENCH_FROM_USER:
+		if (__copy_from_user(dst + off,
+				     (const void __user *)(src + off), size))
+			pr_warning("test_copy_bench: copy_from_user faulted\n");
+		break;
+	}
+}
+
+/* MB/s, with MB = 10^6 bytes */
+static unsigned long long __init rate(size_t size, unsigned long long ns)
+{
+	return div64_u64((u64)size * iters * 1000, max(ns, 1ULL));
+}
+
+static void __init bench_size(int fn, size_t size)
+{
+	unsigned long long start, hot, cold;
+	size_t off = 0;
+	unsigned int i;
+
+	bench_one(fn, size, 0);
+
+	start = sched_clock();
+	for (i = 0; i < iters; i++)
+		bench_one(fn, size, 0);
+	hot = sched_clock() - start;
+
+	start = sched_clock();
+	for (i = 0; i < iters; i++) {
+		bench_one(fn, size, off);
+		off += size;
+		if (off + size > span)
+			off = 0;
+	}
+	cold = sched_clock() - start;
+
+	pr_info("test_copy_bench: %-14s %6zu bytes: hot %5llu MB/s, "
+		"cold %5llu MB/s\n", names[fn], size, rate(size, hot),
+		rate(size, cold));
+	cond_resched();
+}
+
+static int __init test_copy_bench_init(void)
+{
+	mm_segment_t fs;
+	unsigned int i;
+	int fn;
+
+	span = (size_t)span_kb * 1024;
+	if (!iters || span < sizes[ARRAY_SIZE(sizes) - 1])
+		return -EINVAL;
+
+	src = vmalloc(span);
+	dst = vmalloc(span);
+	if (!src || !dst) {
+		vfree(src);
+		vfree(dst);
+		return -ENOMEM;
+	}
+	memset(src, 0x5a, span);
+
+	pr_info("test_copy_bench: %u iterations, %u kB cold span\n",
+		iters, span_kb);
+
+	/* the user copies are pointed at kernel buffers */
+	fs = get_fs();
+	set_fs(KERNEL_DS);
+	for (fn = BENCH_MEMCPY; fn <= BENCH_FROM_USER; fn++) {
+		if (fn == BENCH_COPY_PAGE) {
+			bench_size(fn, PAGE_SIZE);
+			continue;
+		}
+		for (i = 0; i < ARRAY_SIZE(sizes); i++)
+			bench_size(fn, sizes[i]);
+	}
+	set_fs(fs);
+
+	vfree(src);
+	vfree(dst);
+	return -EAGAIN;
+}
+module_init(test_copy_bench_init);
+MODULE_LICENSE("GPL");
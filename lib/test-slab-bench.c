@@ -0,0 +1,97 @@
+/*
+ * Slab allocator latency benchmark
+ *
+ * Times kmalloc()/kfree() for each kmalloc size, once back to back so
+ * every allocation is served from the per-CPU queue, and once in
+ * batches large enough to overflow it. The results go to the kernel
+ * log; the module refuses to stay loaded so it can simply be loaded
+ * again for another run.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/math64.h>
+
+static unsigned int iters = 10000;
+module_param(iters, uint, 0);
+MODULE_PARM_DESC(iters, "Allocations timed per size and pattern");
+
+static unsigned int batch = 1024;
+module_param(batch, uint, 0);
+MODULE_PARM_DESC(batch, "Objects held at once in the batch pattern");
+
+static const size_t sizes[] __initconst = {
+	8, 16, 32, 64, 96, 128, 192, 256, 512, 1024, 2048, 4096,
+};
+
+static void **objs;
+
+static void __init bench_size(size_t size)
+{
+	unsigned long long start, mid, pair, alloc = 0, free = 0;
+	unsigned int i, j, rounds, failed = 0;
+	void *p;
+
+	/* fill the queue once so the first timed pairs are not misses */
+	kfree(kmalloc(size, GFP_KERNEL));
+
+	start = sched_clock();
+	for (i = 0; i < iters; i++) {
+		p = kmalloc(size, GFP_KERNEL);
+		if (!p)
+			failed++;
+		kfree(p);
+	}
+	pair = sched_clock() - start;
+
+	rounds = max(iters / batch, 1U);
+	for (i = 0; i < rounds; i++) {
+		start = sched_clock();
+		for (j = 0; j < batch; j++) {
+			objs[j] = kmalloc(size, GFP_KERNEL);
+			if (!objs[j])
+				failed++;
+		}
+		mid = sched_clock();
+		for (j = 0; j < batch; j++)
+			kfree(objs[j]);
+		free += sched_clock() - mid;
+		alloc += mid - start;
+		cond_resched();
+	}
+
+	pr_info("test_slab_bench: %4zu bytes: pair %5llu ns, "
+		"batch alloc %5llu ns free %5llu ns%s\n", size,
+		div_u64(pair, iters), div_u64(alloc, rounds * batch),
+		div_u64(free, rounds * batch),
+		failed ? " (allocations failed)" : "");
+}
+
+static int __init test_slab_bench_init(void)
+{
+	unsigned int i;
+
+	if (!iters || !batch)
+		return -EINVAL;
+
+	objs = kmalloc(batch * sizeof(*objs), GFP_KERNEL);
+	if (!objs)
+		return -ENOMEM;
+
+	pr_info("test_slab_bench: %u iterations, batches of %u\n",
+		iters, batch);
+	for (i = 0; i < ARRAY_SIZE(sizes); i++)
+		bench_size(sizes[i]);
+
+	kfree(objs);
+	return -EAGAIN;
+}
+module_init(test_slab_bench_init);
+MODULE_LICENSE("GPL");
@@ -14,6 +14,9 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/timer.h>
 #include "internal.h"
 
 /*
@@ -583,6 +586,165 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * kcompactd keeps free blocks of sysctl_compact_reserve_order pages in
+ * every zone. Drivers needing a few physically contiguous pages often
+ * allocate them atomically, or at orders below the direct compaction
+ * cut-off, so without it their failures grow with uptime. It is woken by
+ * high-order allocations entering the slowpath and by a deferrable timer,
+ * so the periodic check never wakes an idle CPU.
+ */
+int sysctl_compact_reserve_order = 4;
+int sysctl_compact_interval = 30;
+
+static struct task_struct *kcompactd_task;
+static DECLARE_WAIT_QUEUE_HEAD(kcompactd_wait);
+static struct timer_list kcompactd_timer;
+static int kcompactd_pending;
+
+/* Is it worth compacting the zone to have a free block of this order? */
+static bool kcompactd_zone_suitable(struct zone *zone, int order)
+{
+	int fragindex;
+
+	/* The reserve is already there */
+	if (zone_watermark_ok(zone, order, low_wmark_pages(zone), 0, 0))
+		return false;
+
+	/* Too little free memory to migrate into: that is kswapd's job */
+	if (!zone_watermark_ok(zone, 0, low_wmark_pages(zone) + (2UL << order),
+									0, 0))
+		return false;
+
+	/* Only compact if the shortage is due to fragmentation */
+	fragindex = fragmentation_index(zone, order);
+	if (fragindex >= 0 && fragindex <= sysctl_extfrag_threshold)
+		return false;
+
+	return !compaction_deferred(zone);
+}
+
+static void kcompactd_do_work(int order)
+{
+	struct zone *zone;
+	bool drained = false;
+
+	for_each_populated_zone(zone) {
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = order,
+			.migratetype = MIGRATE_UNMOVABLE,
+			.zone = zone,
+		};
+
+		if (!kcompactd_zone_suitable(zone, order))
+			continue;
+
+		if (!drained) {
+			lru_add_drain_all();
+			drained = true;
+		}
+
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+		compact_zone(zone, &cc);
+
+		/* Page migration frees to the PCP lists but we want merging */
+		drain_local_pages(NULL);
+
+		if (zone_watermark_ok(zone, order, low_wmark_pages(zone), 0, 0)) {
+			zone->compact_considered = 0;
+			zone->compact_defer_shift = 0;
+		} else
+			defer_compaction(zone);
+
+		if (kthread_should_stop())
+			break;
+	}
+}
+
+static void kcompactd_timer_fn(unsigned long data)
+{
+	kcompactd_pending = 1;
+	wake_up_interruptible(&kcompactd_wait);
+}
+
+static int kcompactd(void *p)
+{
+	set_freezable();
+	set_user_nice(current, 19);
+
+	while (!kthread_should_stop()) {
+		int order = sysctl_compact_reserve_order;
+
+		kcompactd_pending = 0;
+		if (order)
+			kcompactd_do_work(order);
+
+		if (sysctl_compact_interval)
+			mod_timer(&kcompactd_timer,
+				  jiffies + sysctl_compact_interval * HZ);
+
+		wait_event_freezable(kcompactd_wait,
+				kcompactd_pending || kthread_should_stop());
+	}
+
+	del_timer_sync(&kcompactd_timer);
+	return 0;
+}
+
+/**
+ * wakeup_kcompactd - ask for the high-order reserve to be refilled
+ * @order: the order of an allocation that found its free lists short
+ *
+ * Cheap enough to be called from the allocator slowpath in any context.
+ */
+void wakeup_kcompactd(int order)
+{
+	if (!kcompactd_task || order > sysctl_compact_reserve_order ||
+	    kcompactd_pending)
+		return;
+
+	kcompactd_pending = 1;
+	if (waitqueue_active(&kcompactd_wait))
+		wake_up_interruptible(&kcompactd_wait);
+}
+
+/* A changed order or interval takes effect straight away */
+int sysctl_kcompactd_handler(struct ctl_table *table, int write,
+			void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (ret || !write || !kcompactd_task)
+		return ret;
+
+	kcompactd_pending = 1;
+	wake_up_interruptible(&kcompactd_wait);
+
+	return 0;
+}
+
+static int __init kcompactd_init(void)
+{
+	struct task_struct *task;
+
+	init_timer_deferrable(&kcompactd_timer);
+	kcompactd_timer.function = kcompactd_timer_fn;
+
+	task = kthread_run(kcompactd, NULL, "kcompactd");
+	if (IS_ERR(task)) {
+		printk(KERN_ERR "kcompactd: failed to start thread\n");
+		return PTR_ERR(task);
+	}
+	kcompactd_task = task;
+
+	return 0;
+}
+module_init(kcompactd_init)
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct sys_device *dev,
 			struct sysdev_attribute *attr,
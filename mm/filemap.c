@@ -34,6 +34,7 @@
 #include <linux/hardirq.h> /* for BUG_ON(!in_atomic()) only */
 #include <linux/memcontrol.h>
 #include <linux/mm_inline.h> /* for page_is_file_cache() */
+#include <linux/launch_prefetch.h>
 #include "internal.h"
 
 /*
@@ -1546,6 +1547,7 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		}
 	} else {
 		/* No page in the page cache at all */
+		launch_prefetch_fault(vma, offset);
 		do_sync_mmap_readahead(vma, ra, file, offset);
 		count_vm_event(PGMAJFAULT);
 		ret = VM_FAULT_MAJOR;
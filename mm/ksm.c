@@ -33,6 +33,7 @@
 #include <linux/mmu_notifier.h>
 #include <linux/swap.h>
 #include <linux/ksm.h>
+#include <linux/earlysuspend.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -83,12 +84,22 @@
  * @mm_list: link into the mm_slots list, rooted in ksm_mm_head
  * @rmap_list: head for this mm_slot's singly-linked list of rmap_items
  * @mm: the mm that this information is valid for
+ * @pages_scanned: pages scanned in this mm during the current full scan
+ * @pages_merged: of those, pages newly merged
+ * @scanned: set once this mm has been through a full scan
+ * @idle_scans: consecutive full scans with a low merge yield
+ * @skip: full scans to pass this mm over before scanning it again
  */
 struct mm_slot {
 	struct hlist_node link;
 	struct list_head mm_list;
 	struct rmap_item *rmap_list;
 	struct mm_struct *mm;
+	unsigned long pages_scanned;
+	unsigned long pages_merged;
+	unsigned int scanned;
+	unsigned int idle_scans;
+	unsigned int skip;
 };
 
 /**
@@ -185,6 +196,28 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/*
+ * An mm yielding fewer than one new merge per KSM_YIELD_PAGES scanned is
+ * passed over for 1, 2, 4... up to ksm_backoff_max full scans.
+ */
+#define KSM_YIELD_PAGES	64
+static unsigned int ksm_backoff_max = 8;
+
+/*
+ * Scan only areas inherited through fork (zygote children's heaps) on
+ * most full scans, and everything else every KSM_COLD_SCAN_INTERVAL.
+ */
+#define KSM_COLD_SCAN_INTERVAL	4
+static unsigned int ksm_scan_inherited;
+
+/* Don't scan while the screen is on */
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static unsigned int ksm_pause_screen_on = 1;
+#else
+static unsigned int ksm_pause_screen_on;
+#endif
+static int ksm_screen_on = 1;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -1256,6 +1289,62 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * The mm scanned after @slot, passing over those backed off for low
+ * yield. Exiting mms are never passed over, ksmd has to free them.
+ * Called with ksm_mmlist_lock held.
+ */
+static struct mm_slot *next_scan_slot(struct mm_slot *slot)
+{
+	for (;;) {
+		slot = list_entry(slot->mm_list.next, struct mm_slot, mm_list);
+		if (slot == &ksm_mm_head || !slot->skip ||
+		    ksm_test_exit(slot->mm))
+			return slot;
+		slot->skip--;
+	}
+}
+
+/*
+ * Judge the merge yield of the full scan of @slot just completed, and
+ * back it off if it was low. The first scan only computes checksums,
+ * so it is not judged.
+ */
+static void update_slot_yield(struct mm_slot *slot)
+{
+	if (!slot->scanned)
+		slot->scanned = 1;
+	else if (slot->pages_merged * KSM_YIELD_PAGES < slot->pages_scanned) {
+		slot->idle_scans = min(slot->idle_scans + 1, 31U);
+		slot->skip = min(1U << (slot->idle_scans - 1), ksm_backoff_max);
+	} else
+		slot->idle_scans = 0;
+
+	slot->pages_scanned = 0;
+	slot->pages_merged = 0;
+}
+
+/*
+ * Does this full scan pass over @vma? In scan_inherited mode only areas
+ * whose anon_vma is shared with the mm's ancestors are scanned, except
+ * on every KSM_COLD_SCAN_INTERVAL-th full scan.
+ */
+static inline int skip_cold_vma(struct vm_area_struct *vma)
+{
+	return ksm_scan_inherited &&
+		(ksm_scan.seqnr % KSM_COLD_SCAN_INTERVAL) &&
+		list_is_singular(&vma->anon_vma_chain);
+}
+
+/* Step the cursor over @vma keeping its rmap_items, unlike scanning it */
+static void skip_rmap_items(struct vm_area_struct *vma)
+{
+	while (*ksm_scan.rmap_list &&
+	       (*ksm_scan.rmap_list)->address < vma->vm_end)
+		ksm_scan.rmap_list = &(*ksm_scan.rmap_list)->rmap_list;
+	ksm_scan.address = vma->vm_end;
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1283,7 +1372,7 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 		root_unstable_tree = RB_ROOT;
 
 		spin_lock(&ksm_mmlist_lock);
-		slot = list_entry(slot->mm_list.next, struct mm_slot, mm_list);
+		slot = next_scan_slot(slot);
 		ksm_scan.mm_slot = slot;
 		spin_unlock(&ksm_mmlist_lock);
 		/*
@@ -1311,6 +1400,8 @@ next_mm:
 			ksm_scan.address = vma->vm_start;
 		if (!vma->anon_vma)
 			ksm_scan.address = vma->vm_end;
+		else if (skip_cold_vma(vma))
+			skip_rmap_items(vma);
 
 		while (ksm_scan.address < vma->vm_end) {
 			if (ksm_test_exit(mm))
@@ -1346,10 +1437,10 @@ next_mm:
 	 * because there were no VM_MERGEABLE vmas with such addresses.
 	 */
 	remove_trailing_rmap_items(slot, ksm_scan.rmap_list);
+	update_slot_yield(slot);
 
 	spin_lock(&ksm_mmlist_lock);
-	ksm_scan.mm_slot = list_entry(slot->mm_list.next,
-						struct mm_slot, mm_list);
+	ksm_scan.mm_slot = next_scan_slot(slot);
 	if (ksm_scan.address == 0) {
 		/*
 		 * We've completed a full scan of all vmas, holding mmap_sem
@@ -1396,17 +1487,42 @@ static void ksm_do_scan(unsigned int scan_npages)
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
-		if (!PageKsm(page) || !in_stable_tree(rmap_item))
+		/* the cursor is still on the mm the page came from */
+		ksm_scan.mm_slot->pages_scanned++;
+		if (!PageKsm(page) || !in_stable_tree(rmap_item)) {
 			cmp_and_merge_page(page, rmap_item);
+			if (in_stable_tree(rmap_item))
+				ksm_scan.mm_slot->pages_merged++;
+		}
 		put_page(page);
 	}
 }
 
 static int ksmd_should_run(void)
 {
-	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
+	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list) &&
+		!(ksm_pause_screen_on && ksm_screen_on);
 }
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static void ksm_early_suspend(struct early_suspend *h)
+{
+	ksm_screen_on = 0;
+	wake_up_interruptible(&ksm_thread_wait);
+}
+
+static void ksm_late_resume(struct early_suspend *h)
+{
+	ksm_screen_on = 1;
+}
+
+static struct early_suspend ksm_early_suspend_desc = {
+	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB,
+	.suspend = ksm_early_suspend,
+	.resume = ksm_late_resume,
+};
+#endif
+
 static int ksm_scan_thread(void *nothing)
 {
 	set_user_nice(current, 5);
@@ -1848,6 +1964,82 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t backoff_max_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_backoff_max);
+}
+
+static ssize_t backoff_max_store(struct kobject *kobj,
+				 struct kobj_attribute *attr,
+				 const char *buf, size_t count)
+{
+	int err;
+	unsigned long scans;
+
+	err = strict_strtoul(buf, 10, &scans);
+	if (err || scans > UINT_MAX)
+		return -EINVAL;
+
+	ksm_backoff_max = scans;
+
+	return count;
+}
+KSM_ATTR(backoff_max);
+
+static ssize_t scan_inherited_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_scan_inherited);
+}
+
+static ssize_t scan_inherited_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	int err;
+	unsigned long flag;
+
+	err = strict_strtoul(buf, 10, &flag);
+	if (err || flag > 1)
+		return -EINVAL;
+
+	ksm_scan_inherited = flag;
+
+	return count;
+}
+KSM_ATTR(scan_inherited);
+
+static ssize_t pause_screen_on_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_pause_screen_on);
+}
+
+static ssize_t pause_screen_on_store(struct kobject *kobj,
+				     struct kobj_attribute *attr,
+				     const char *buf, size_t count)
+{
+	int err;
+	unsigned long flag;
+
+	err = strict_strtoul(buf, 10, &flag);
+	if (err || flag > 1)
+		return -EINVAL;
+#ifndef CONFIG_HAS_EARLYSUSPEND
+	/* the screen would never be seen to go off */
+	if (flag)
+		return -EINVAL;
+#endif
+
+	ksm_pause_screen_on = flag;
+	if (ksmd_should_run())
+		wake_up_interruptible(&ksm_thread_wait);
+
+	return count;
+}
+KSM_ATTR(pause_screen_on);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -1944,6 +2136,9 @@ static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
 	&run_attr.attr,
+	&backoff_max_attr.attr,
+	&scan_inherited_attr.attr,
+	&pause_screen_on_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
@@ -1996,6 +2191,9 @@ static int __init ksm_init(void)
 	 * later callbacks could only be taking locks which nest within that.
 	 */
 	hotplug_memory_notifier(ksm_memory_callback, 100);
+#endif
+#ifdef CONFIG_HAS_EARLYSUSPEND
+	register_early_suspend(&ksm_early_suspend_desc);
 #endif
 	return 0;
 
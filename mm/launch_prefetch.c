@@ -0,0 +1,361 @@
+/*
+ * mm/launch_prefetch.c
+ *
+ * App launch prefetch.
+ *
+ * A launcher arms a trace with LAUNCH_PREFETCH_TRACE on
+ * /dev/launch_prefetch and starts the program. For the given number of
+ * seconds after that exec, the file pages the new mm faults in and does
+ * not find in the page cache are recorded, and reading the device lists
+ * them as "path start nr_pages" lines. On a later cold start the launcher
+ * opens those files and hands the ranges to LAUNCH_PREFETCH_REPLAY, which
+ * sorts and merges them and starts readahead on each merged range, so
+ * their reads reach the eMMC as one batch of large requests rather than
+ * one fault at a time.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/capability.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/jiffies.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/path.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/launch_prefetch.h>
+
+/* Longest trace that can be asked for, in seconds */
+#define LAUNCH_PREFETCH_MAX_SECS	600
+
+struct launch_prefetch_entry {
+	struct path path;
+	pgoff_t start;
+	unsigned long nr_pages;
+};
+
+/* Serialises arming, stopping and reading the trace */
+static DEFINE_MUTEX(launch_prefetch_mutex);
+
+/* Protects the trace state below against the fault path */
+static DEFINE_SPINLOCK(launch_prefetch_lock);
+static struct launch_prefetch_entry *trace;
+static unsigned int trace_len;
+static unsigned int trace_secs;		/* armed for the next exec */
+static unsigned long trace_until;
+
+/* The mm being traced, holding a reference on its mm_count */
+struct mm_struct *launch_prefetch_mm;
+
+void launch_prefetch_exec(struct mm_struct *mm)
+{
+	if (likely(!trace_secs))
+		return;
+
+	spin_lock(&launch_prefetch_lock);
+	if (trace_secs) {
+		atomic_inc(&mm->mm_count);
+		launch_prefetch_mm = mm;
+		trace_until = jiffies + trace_secs * HZ;
+		trace_secs = 0;
+	}
+	spin_unlock(&launch_prefetch_lock);
+}
+
+/* Called by filemap_fault() for a page that was not in the page cache */
+void __launch_prefetch_fault(struct vm_area_struct *vma, unsigned long index)
+{
+	struct path *path = &vma->vm_file->f_path;
+	struct launch_prefetch_entry *e;
+	struct mm_struct *done = NULL;
+
+	spin_lock(&launch_prefetch_lock);
+	if (vma->vm_mm != launch_prefetch_mm)
+		goto out;
+
+	if (time_after_eq(jiffies, trace_until) ||
+	    trace_len == LAUNCH_PREFETCH_MAX_RANGES) {
+		done = launch_prefetch_mm;
+		launch_prefetch_mm = NULL;
+		goto out;
+	}
+
+	/* extend the last range if this follows on from it */
+	if (trace_len) {
+		e = &trace[trace_len - 1];
+		if (e->path.dentry == path->dentry &&
+		    e->path.mnt == path->mnt &&
+		    index >= e->start && index <= e->start + e->nr_pages) {
+			if (index == e->start + e->nr_pages)
+				e->nr_pages++;
+			goto out;
+		}
+	}
+
+	e = &trace[trace_len];
+	e->path = *path;
+	path_get(&e->path);
+	e->start = index;
+	e->nr_pages = 1;
+	trace_len++;
+out:
+	spin_unlock(&launch_prefetch_lock);
+	if (done)
+		mmdrop(done);
+}
+
+/* Must hold launch_prefetch_mutex */
+static void launch_prefetch_stop(void)
+{
+	struct mm_struct *mm;
+
+	spin_lock(&launch_prefetch_lock);
+	mm = launch_prefetch_mm;
+	launch_prefetch_mm = NULL;
+	trace_secs = 0;
+	spin_unlock(&launch_prefetch_lock);
+
+	if (mm)
+		mmdrop(mm);
+}
+
+/* Must hold launch_prefetch_mutex, with the trace stopped */
+static void launch_prefetch_clear(void)
+{
+	unsigned int i, len;
+
+	spin_lock(&launch_prefetch_lock);
+	len = trace_len;
+	trace_len = 0;
+	spin_unlock(&launch_prefetch_lock);
+
+	for (i = 0; i < len; i++)
+		path_put(&trace[i].path);
+}
+
+static int launch_prefetch_trace(unsigned int secs)
+{
+	int ret = 0;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+	if (secs > LAUNCH_PREFETCH_MAX_SECS)
+		return -EINVAL;
+
+	mutex_lock(&launch_prefetch_mutex);
+	launch_prefetch_stop();
+	if (!secs)
+		goto out;
+
+	launch_prefetch_clear();
+	if (!trace) {
+		trace = vmalloc(sizeof(*trace) * LAUNCH_PREFETCH_MAX_RANGES);
+		if (!trace) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	spin_lock(&launch_prefetch_lock);
+	trace_secs = secs;
+	spin_unlock(&launch_prefetch_lock);
+out:
+	mutex_unlock(&launch_prefetch_mutex);
+	return ret;
+}
+
+struct launch_prefetch_req {
+	struct file *file;
+	pgoff_t start;
+	unsigned long nr_pages;
+};
+
+static int launch_prefetch_cmp(const void *a, const void *b)
+{
+	const struct launch_prefetch_req *ra = a, *rb = b;
+
+	if (ra->file->f_mapping != rb->file->f_mapping)
+		return ra->file->f_mapping < rb->file->f_mapping ? -1 : 1;
+	if (ra->start != rb->start)
+		return ra->start < rb->start ? -1 : 1;
+	return 0;
+}
+
+static long launch_prefetch_replay(void __user *argp)
+{
+	struct launch_prefetch_replay arg;
+	struct launch_prefetch_range __user *uranges;
+	struct launch_prefetch_req *reqs;
+	unsigned int i, j, n = 0;
+	long ret = 0;
+
+	if (copy_from_user(&arg, argp, sizeof(arg)))
+		return -EFAULT;
+	if (arg.nr_ranges > LAUNCH_PREFETCH_MAX_RANGES)
+		return -EINVAL;
+	if (!arg.nr_ranges)
+		return 0;
+
+	reqs = vmalloc(sizeof(*reqs) * arg.nr_ranges);
+	if (!reqs)
+		return -ENOMEM;
+
+	uranges = (struct launch_prefetch_range __user *)(unsigned long)
+		  arg.ranges;
+	for (i = 0; i < arg.nr_ranges; i++) {
+		struct launch_prefetch_range range;
+		struct file *file;
+
+		if (copy_from_user(&range, &uranges[i], sizeof(range))) {
+			ret = -EFAULT;
+			goto out;
+		}
+		if (!range.nr_pages || range.start > ULONG_MAX)
+			continue;
+
+		/* files that went away since the trace are skipped */
+		file = fget(range.fd);
+		if (!file)
+			continue;
+		if (!(file->f_mode & FMODE_READ)) {
+			fput(file);
+			continue;
+		}
+
+		reqs[n].file = file;
+		reqs[n].start = range.start;
+		reqs[n].nr_pages = range.nr_pages;
+		n++;
+	}
+
+	sort(reqs, n, sizeof(*reqs), launch_prefetch_cmp, NULL);
+
+	for (i = 0; i < n; i = j) {
+		struct address_space *mapping = reqs[i].file->f_mapping;
+		pgoff_t end = reqs[i].start + reqs[i].nr_pages;
+
+		/* merge the ranges that overlap or touch */
+		for (j = i + 1; j < n; j++) {
+			if (reqs[j].file->f_mapping != mapping ||
+			    reqs[j].start > end)
+				break;
+			end = max_t(pgoff_t, end,
+				    reqs[j].start + reqs[j].nr_pages);
+		}
+
+		force_page_cache_readahead(mapping, reqs[i].file,
+					   reqs[i].start, end - reqs[i].start);
+	}
+out:
+	for (i = 0; i < n; i++)
+		fput(reqs[i].file);
+	vfree(reqs);
+	return ret;
+}
+
+static long launch_prefetch_ioctl(struct file *file, unsigned int cmd,
+				  unsigned long arg)
+{
+	switch (cmd) {
+	case LAUNCH_PREFETCH_TRACE:
+		return launch_prefetch_trace(arg);
+	case LAUNCH_PREFETCH_REPLAY:
+		return launch_prefetch_replay((void __user *)arg);
+	}
+	return -ENOTTY;
+}
+
+static void *launch_prefetch_seq_start(struct seq_file *m, loff_t *pos)
+{
+	unsigned int len;
+
+	mutex_lock(&launch_prefetch_mutex);
+	spin_lock(&launch_prefetch_lock);
+	len = trace_len;
+	spin_unlock(&launch_prefetch_lock);
+
+	return *pos < len ? &trace[*pos] : NULL;
+}
+
+static void *launch_prefetch_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	unsigned int len;
+
+	++*pos;
+	spin_lock(&launch_prefetch_lock);
+	len = trace_len;
+	spin_unlock(&launch_prefetch_lock);
+
+	return *pos < len ? &trace[*pos] : NULL;
+}
+
+static void launch_prefetch_seq_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&launch_prefetch_mutex);
+}
+
+static int launch_prefetch_seq_show(struct seq_file *m, void *v)
+{
+	struct launch_prefetch_entry *e = v;
+	unsigned long start, nr_pages;
+
+	/* the last range may still be growing */
+	spin_lock(&launch_prefetch_lock);
+	start = e->start;
+	nr_pages = e->nr_pages;
+	spin_unlock(&launch_prefetch_lock);
+
+	seq_path(m, &e->path, " \t\n\\");
+	seq_printf(m, " %lu %lu\n", start, nr_pages);
+	return 0;
+}
+
+static const struct seq_operations launch_prefetch_seq_ops = {
+	.start	= launch_prefetch_seq_start,
+	.next	= launch_prefetch_seq_next,
+	.stop	= launch_prefetch_seq_stop,
+	.show	= launch_prefetch_seq_show,
+};
+
+static int launch_prefetch_open(struct inode *inode, struct file *file)
+{
+	/* misc_open() left the miscdevice here, seq_open() wants it clear */
+	file->private_data = NULL;
+	return seq_open(file, &launch_prefetch_seq_ops);
+}
+
+static const struct file_operations launch_prefetch_fops = {
+	.owner		= THIS_MODULE,
+	.open		= launch_prefetch_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+	.unlocked_ioctl	= launch_prefetch_ioctl,
+};
+
+static struct miscdevice launch_prefetch_misc = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= "launch_prefetch",
+	.fops	= &launch_prefetch_fops,
+};
+
+static int __init launch_prefetch_init(void)
+{
+	return misc_register(&launch_prefetch_misc);
+}
+device_initcall(launch_prefetch_init);
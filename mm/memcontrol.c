@@ -2881,6 +2881,29 @@ unsigned long mem_cgroup_soft_limit_reclaim(struct zone *zone, int order,
 	return nr_reclaimed;
 }
 
+/*
+ * Pages by which the memory cgroup charged for 'mm' is over its soft
+ * limit, for the low memory killer to prefer victims in such groups.
+ * The root cgroup has no soft limit and always reports 0.
+ */
+unsigned long mm_mem_cgroup_soft_limit_excess(struct mm_struct *mm)
+{
+	struct mem_cgroup *mem;
+	unsigned long long excess = 0;
+
+	if (mem_cgroup_disabled())
+		return 0;
+
+	rcu_read_lock();
+	mem = mem_cgroup_from_task(rcu_dereference(mm->owner));
+	if (mem && !mem_cgroup_is_root(mem))
+		excess = res_counter_soft_limit_excess(&mem->res);
+	rcu_read_unlock();
+
+	return excess >> PAGE_SHIFT;
+}
+EXPORT_SYMBOL_GPL(mm_mem_cgroup_soft_limit_excess);
+
 /*
  * This routine traverse page_cgroup in given list and drop them all.
  * *And* this routine doesn't reclaim page itself, just removes page_cgroup.
@@ -34,6 +34,7 @@
 #include <linux/syscalls.h>
 #include <linux/buffer_head.h>
 #include <linux/pagevec.h>
+#include <linux/earlysuspend.h>
 
 /*
  * After a CPU has dirtied this many pages, balance_dirty_pages_ratelimited
@@ -95,6 +96,19 @@ unsigned int dirty_writeback_interval = 300; /* centiseconds */
  */
 unsigned int dirty_expire_interval = 50; /* centiseconds */
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+/*
+ * The settings above are used while the screen is on and writeback
+ * competes with foreground reads. These replace them while the screen
+ * is off, letting dirty data build up and go out in rare large batches
+ * rather than waking the eMMC every few seconds.
+ */
+int dirty_background_ratio_screen_off = 5;
+int vm_dirty_ratio_screen_off = 10;
+unsigned int dirty_writeback_interval_screen_off = 6000; /* centiseconds */
+unsigned int dirty_expire_interval_screen_off = 6000; /* centiseconds */
+#endif
+
 /*
  * Flag that makes the machine dump writes/reads and block dirtyings.
  */
@@ -685,6 +699,68 @@ void throttle_vm_writeout(gfp_t gfp_mask)
         }
 }
 
+#ifdef CONFIG_HAS_EARLYSUSPEND
+static int screen_on_background_ratio;
+static int screen_on_dirty_ratio;
+static unsigned int screen_on_writeback_interval;
+static unsigned int screen_on_expire_interval;
+
+static void writeback_early_suspend(struct early_suspend *h)
+{
+	screen_on_background_ratio = dirty_background_ratio;
+	screen_on_dirty_ratio = vm_dirty_ratio;
+	screen_on_writeback_interval = dirty_writeback_interval;
+	screen_on_expire_interval = dirty_expire_interval;
+
+	/* limits set in bytes are left alone */
+	if (!dirty_background_bytes)
+		dirty_background_ratio = dirty_background_ratio_screen_off;
+	if (!vm_dirty_bytes) {
+		vm_dirty_ratio = vm_dirty_ratio_screen_off;
+		update_completion_period();
+	}
+	dirty_writeback_interval = dirty_writeback_interval_screen_off;
+	dirty_expire_interval = dirty_expire_interval_screen_off;
+	bdi_arm_supers_timer();
+
+	/* write out what the screen-on period left dirty, then stay quiet */
+	wakeup_flusher_threads(0);
+}
+
+/*
+ * Put the screen-on settings back, except those that were changed
+ * through sysctl while the screen was off.
+ */
+static void writeback_late_resume(struct early_suspend *h)
+{
+	if (!dirty_background_bytes &&
+	    dirty_background_ratio == dirty_background_ratio_screen_off)
+		dirty_background_ratio = screen_on_background_ratio;
+	if (!vm_dirty_bytes && vm_dirty_ratio == vm_dirty_ratio_screen_off) {
+		vm_dirty_ratio = screen_on_dirty_ratio;
+		update_completion_period();
+	}
+	if (dirty_writeback_interval == dirty_writeback_interval_screen_off)
+		dirty_writeback_interval = screen_on_writeback_interval;
+	if (dirty_expire_interval == dirty_expire_interval_screen_off)
+		dirty_expire_interval = screen_on_expire_interval;
+	bdi_arm_supers_timer();
+}
+
+static struct early_suspend writeback_early_suspend_desc = {
+	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB,
+	.suspend = writeback_early_suspend,
+	.resume = writeback_late_resume,
+};
+
+static int __init writeback_early_suspend_init(void)
+{
+	register_early_suspend(&writeback_early_suspend_desc);
+	return 0;
+}
+late_initcall(writeback_early_suspend_init);
+#endif
+
 /*
  * sysctl handler for /proc/sys/vm/dirty_writeback_centisecs
  */
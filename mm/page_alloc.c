@@ -50,6 +50,8 @@
 #include <linux/kmemleak.h>
 #include <linux/memory.h>
 #include <linux/compaction.h>
+#include <linux/migrate.h>
+#include <linux/mm_inline.h>
 #include <trace/events/kmem.h>
 #include <linux/ftrace_event.h>
 
@@ -817,7 +819,9 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
 
 /*
  * This array describes the order lists are fallen back to when
- * the free lists for the desirable migrate type are depleted
+ * the free lists for the desirable migrate type are depleted.
+ * MIGRATE_CMA is never fallen back to, only movable allocations are
+ * served from it in __rmqueue().
  */
 static int fallbacks[MIGRATE_TYPES][MIGRATE_TYPES-1] = {
 	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE,   MIGRATE_RESERVE },
@@ -924,7 +928,7 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 
 			/* MIGRATE_RESERVE handled later if necessary */
 			if (migratetype == MIGRATE_RESERVE)
-				continue;
+				break;
 
 			area = &(zone->free_area[current_order]);
 			if (list_empty(&area->free_list[migratetype]))
@@ -989,6 +993,12 @@ static struct page *__rmqueue(struct zone *zone, unsigned int order,
 retry_reserve:
 	page = __rmqueue_smallest(zone, order, migratetype);
 
+#ifdef CONFIG_CMA
+	/* Lent memory before stealing blocks of other types */
+	if (unlikely(!page) && migratetype == MIGRATE_MOVABLE)
+		page = __rmqueue_smallest(zone, order, MIGRATE_CMA);
+#endif
+
 	if (unlikely(!page) && migratetype != MIGRATE_RESERVE) {
 		page = __rmqueue_fallback(zone, order, migratetype);
 
@@ -1038,6 +1048,11 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 		else
 			list_add_tail(&page->lru, list);
 		set_page_private(page, migratetype);
+#ifdef CONFIG_CMA
+		/* drained from the pcp list back to the lent block */
+		if (is_migrate_cma(get_pageblock_migratetype(page)))
+			set_page_private(page, MIGRATE_CMA);
+#endif
 		list = &page->lru;
 	}
 	__mod_zone_page_state(zone, NR_FREE_PAGES, -(i << order));
@@ -2015,6 +2030,8 @@ __alloc_pages_slowpath(gfp_t gfp_mask, unsigned int order,
 
 restart:
 	wake_all_kswapd(order, zonelist, high_zoneidx);
+	if (order)
+		wakeup_kcompactd(order);
 
 	/*
 	 * OK, we're below the kswapd watermark and have kicked background
@@ -5322,6 +5339,7 @@ int set_migratetype_isolate(struct page *page)
 
 	spin_lock_irqsave(&zone->lock, flags);
 	if (get_pageblock_migratetype(page) == MIGRATE_MOVABLE ||
+	    is_migrate_cma(get_pageblock_migratetype(page)) ||
 	    zone_idx == ZONE_MOVABLE) {
 		ret = 0;
 		goto out;
@@ -5388,6 +5406,166 @@ out:
 	spin_unlock_irqrestore(&zone->lock, flags);
 }
 
+#ifdef CONFIG_CMA
+/*
+ * Hand a pageblock reserved at boot over to the page allocator as
+ * MIGRATE_CMA. Its owner gets it back with alloc_contig_range().
+ */
+void init_cma_reserved_pageblock(struct page *page)
+{
+	unsigned i = pageblock_nr_pages;
+	struct page *p = page;
+
+	do {
+		__ClearPageReserved(p);
+		set_page_count(p, 0);
+	} while (++p, --i);
+
+	set_page_refcounted(page);
+	set_pageblock_migratetype(page, MIGRATE_CMA);
+	__free_pages(page, pageblock_order);
+	totalram_pages += pageblock_nr_pages;
+}
+
+#define ALLOC_CONTIG_RETRIES	5
+
+static struct page *
+alloc_contig_migrate_alloc(struct page *page, unsigned long private, int **x)
+{
+	return alloc_page(GFP_HIGHUSER_MOVABLE);
+}
+
+/*
+ * Migrate whatever is on the LRU out of [start, end). Pages that cannot
+ * be moved keep the range busy, alloc_contig_range() retries.
+ */
+static void alloc_contig_migrate_range(unsigned long start, unsigned long end)
+{
+	unsigned long pfn;
+	struct page *page;
+	LIST_HEAD(source);
+
+	for (pfn = start; pfn < end; pfn++) {
+		if (!pfn_valid_within(pfn))
+			continue;
+		page = pfn_to_page(pfn);
+		if (!get_page_unless_zero(page))
+			continue;
+		if (!isolate_lru_page(page)) {
+			list_add_tail(&page->lru, &source);
+			inc_zone_page_state(page, NR_ISOLATED_ANON +
+					    page_is_file_cache(page));
+		}
+		put_page(page);
+	}
+
+	if (!list_empty(&source))
+		migrate_pages(&source, alloc_contig_migrate_alloc, 0, 0);
+}
+
+/*
+ * Pull the free pages of an isolated [start, end) out of the buddy
+ * lists as order-0 pages with a reference each. Nothing is taken
+ * unless the whole range is free. Call with zone->lock held.
+ *
+ * Free chunks never cross a pageblock (pageblock_order is MAX_ORDER-1
+ * here) so a pageblock aligned range splits along chunk boundaries.
+ */
+static int __alloc_contig_take_free(struct zone *zone, unsigned long start,
+				    unsigned long end)
+{
+	unsigned long pfn;
+	struct page *page;
+	int order;
+
+	for (pfn = start; pfn < end; pfn += 1 << page_order(page)) {
+		page = pfn_to_page(pfn);
+		if (!PageBuddy(page))
+			return -EBUSY;
+	}
+
+	for (pfn = start; pfn < end; pfn += 1 << order) {
+		page = pfn_to_page(pfn);
+		order = page_order(page);
+		list_del(&page->lru);
+		rmv_page_order(page);
+		zone->free_area[order].nr_free--;
+		__mod_zone_page_state(zone, NR_FREE_PAGES, -(1UL << order));
+		set_page_refcounted(page);
+		split_page(page, order);
+	}
+	return 0;
+}
+
+/*
+ * Set the pageblocks of [start, end) to migratetype, moving any free
+ * pages in them to the matching free list.
+ */
+static void alloc_contig_set_migratetype(struct zone *zone,
+		unsigned long start, unsigned long end, int migratetype)
+{
+	unsigned long pfn, flags;
+	struct page *page;
+
+	spin_lock_irqsave(&zone->lock, flags);
+	for (pfn = start; pfn < end; pfn += pageblock_nr_pages) {
+		page = pfn_to_page(pfn);
+		set_pageblock_migratetype(page, migratetype);
+		move_freepages_block(zone, page, migratetype);
+	}
+	spin_unlock_irqrestore(&zone->lock, flags);
+}
+
+/**
+ * alloc_contig_range() -- take back memory lent as MIGRATE_CMA
+ * @start: first pfn, pageblock aligned
+ * @end: one past the last pfn, pageblock aligned
+ *
+ * Isolates the range, migrates whatever was allocated from it and
+ * removes it from the buddy allocator. On success every page in the
+ * range has a reference and is released with free_contig_range().
+ * Returns -EBUSY if some page could not be moved away. May sleep.
+ */
+int alloc_contig_range(unsigned long start, unsigned long end)
+{
+	struct zone *zone = page_zone(pfn_to_page(start));
+	unsigned long flags;
+	int tries, ret;
+
+	ret = start_isolate_page_range(start, end);
+	if (ret)
+		return ret;
+
+	for (tries = 0; tries < ALLOC_CONTIG_RETRIES; tries++) {
+		alloc_contig_migrate_range(start, end);
+		lru_add_drain_all();
+		drain_all_pages();
+
+		/*
+		 * Pages drained from the pcp lists went back to the free
+		 * list they were allocated from, not the isolated one.
+		 */
+		alloc_contig_set_migratetype(zone, start, end,
+					     MIGRATE_ISOLATE);
+
+		spin_lock_irqsave(&zone->lock, flags);
+		ret = __alloc_contig_take_free(zone, start, end);
+		spin_unlock_irqrestore(&zone->lock, flags);
+		if (!ret)
+			break;
+	}
+
+	alloc_contig_set_migratetype(zone, start, end, MIGRATE_CMA);
+	return ret;
+}
+
+void free_contig_range(unsigned long pfn, unsigned long nr_pages)
+{
+	for (; nr_pages--; pfn++)
+		__free_page(pfn_to_page(pfn));
+}
+#endif /* CONFIG_CMA */
+
 #ifdef CONFIG_MEMORY_HOTREMOVE
 /*
  * All pages in the range must be isolated before calling this.
@@ -91,6 +91,14 @@ static inline int slab_freebatch(struct kmem_cache *s)
 	return s->freebatch;
 }
 
+/*
+ * Per-CPU freelists start at the cache's hiwater and are adapted once
+ * every SLQB_ADAPT_WINDOW allocations: a list that flushed objects only
+ * to miss on later allocations grows, a deep list that never missed
+ * shrinks and gives its cold objects back to their pages.
+ */
+#define SLQB_ADAPT_WINDOW	256
+
 /*
  * Lock order:
  * kmem_cache_node->list_lock
@@ -1492,6 +1500,35 @@ static noinline void *__remote_slab_alloc(struct kmem_cache *s,
 }
 #endif
 
+/*
+ * Move the per-CPU list's hiwater by what the last window's hit rate
+ * says, see SLQB_ADAPT_WINDOW.
+ *
+ * Must be called with interrupts disabled, by the owner CPU.
+ */
+static noinline void adapt_queue_depth(struct kmem_cache *s,
+				struct kmem_cache_list *l)
+{
+	int hiwater = l->hiwater;
+
+	if (l->adapt_flushes && l->adapt_misses * 8 > l->adapt_allocs) {
+		/* flushed objects had to be fetched back from the pages */
+		hiwater += max(hiwater >> 1, 1);
+	} else if (!l->adapt_misses && l->freelist.nr > (hiwater >> 1)) {
+		/* the queue is deeper than anyone draws from */
+		hiwater -= hiwater >> 2;
+		hiwater = max(hiwater, min(slab_freebatch(s), slab_hiwater(s)));
+	}
+	l->hiwater = min(hiwater, slab_hiwater(s));
+
+	l->adapt_allocs = 0;
+	l->adapt_misses = 0;
+	l->adapt_flushes = 0;
+
+	while (l->freelist.nr > l->hiwater)
+		flush_free_list(s, l);
+}
+
 /*
  * Main allocation path. Return an object, or NULL on allocation failure.
  *
@@ -1514,6 +1551,8 @@ try_remote:
 	c = get_cpu_slab(s, smp_processor_id());
 	VM_BUG_ON(!c);
 	l = &c->list;
+	if (unlikely(++l->adapt_allocs >= SLQB_ADAPT_WINDOW))
+		adapt_queue_depth(s, l);
 	object = __cache_list_get_object(s, l);
 	if (unlikely(!object)) {
 #ifdef CONFIG_NUMA
@@ -1529,6 +1568,7 @@ try_remote:
 		if (unlikely(!node_state(thisnode, N_HIGH_MEMORY)))
 			object = __remote_slab_alloc(s, gfpflags, thisnode);
 #endif
+		l->adapt_misses++;
 
 		if (!object) {
 			object = cache_list_get_page(s, l);
@@ -1765,8 +1805,10 @@ static __always_inline void __slab_free(struct kmem_cache *s,
 			l->freelist.tail = object;
 		l->freelist.nr++;
 
-		if (unlikely(l->freelist.nr > slab_hiwater(s)))
+		if (unlikely(l->freelist.nr > l->hiwater)) {
+			l->adapt_flushes++;
 			flush_free_list(s, l);
+		}
 
 	} else {
 #ifdef CONFIG_SMP
@@ -1922,6 +1964,11 @@ static void init_kmem_cache_list(struct kmem_cache *s,
 	INIT_LIST_HEAD(&l->partial);
 	spin_lock_init(&l->page_lock);
 
+	l->hiwater		= slab_hiwater(s);
+	l->adapt_allocs		= 0;
+	l->adapt_misses		= 0;
+	l->adapt_flushes	= 0;
+
 #ifdef CONFIG_SMP
 	l->remote_free_check	= 0;
 	spin_lock_init(&l->remote_free.lock);
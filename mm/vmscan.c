@@ -2232,6 +2232,7 @@ loop_again:
 		for (i = 0; i <= end_zone; i++) {
 			struct zone *zone = pgdat->node_zones + i;
 			int nr_slab;
+			unsigned long nr_soft, wmark;
 			int nid, zid;
 
 			if (!populated_zone(zone))
@@ -2247,17 +2248,25 @@ loop_again:
 			nid = pgdat->node_id;
 			zid = zone_idx(zone);
 			/*
-			 * Call soft limit reclaim before calling shrink_zone.
-			 * For now we ignore the return value
+			 * Call soft limit reclaim before calling shrink_zone,
+			 * taking from the groups furthest over their soft
+			 * limits first.
 			 */
-			mem_cgroup_soft_limit_reclaim(zone, order, sc.gfp_mask,
-							nid, zid);
+			nr_soft = mem_cgroup_soft_limit_reclaim(zone, order,
+							sc.gfp_mask, nid, zid);
+			sc.nr_reclaimed += nr_soft;
 			/*
 			 * We put equal pressure on every zone, unless one
-			 * zone has way too many pages free already.
+			 * zone has way too many pages free already, or soft
+			 * limit reclaim alone brought it back to its high
+			 * watermark; then the groups within their soft
+			 * limits keep their pages.
 			 */
-			if (!zone_watermark_ok_safe(zone, order,
-					8*high_wmark_pages(zone), end_zone, 0))
+			wmark = high_wmark_pages(zone);
+			if (!nr_soft)
+				wmark *= 8;
+			if (!zone_watermark_ok_safe(zone, order, wmark,
+						    end_zone, 0))
 				shrink_zone(priority, zone, &sc);
 			reclaim_state->reclaimed_slab = 0;
 			nr_slab = shrink_slab(&shrink, sc.nr_scanned, lru_pages);
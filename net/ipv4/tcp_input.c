@@ -65,6 +65,7 @@
 #include <linux/slab.h>
 #include <linux/module.h>
 #include <linux/sysctl.h>
+#include <linux/inetdevice.h>
 #include <linux/kernel.h>
 #include <net/dst.h>
 #include <net/tcp.h>
@@ -291,7 +292,7 @@ static int __tcp_grow_window(const struct sock *sk, const struct sk_buff *skb)
 	struct tcp_sock *tp = tcp_sk(sk);
 	/* Optimize this! */
 	int truesize = tcp_win_from_space(skb->truesize) >> 1;
-	int window = tcp_win_from_space(sysctl_tcp_rmem[2]) >> 1;
+	int window = tcp_win_from_space(tcp_rmem_max(sk)) >> 1;
 
 	while (tp->rcv_ssthresh <= window) {
 		if (truesize <= skb->len)
@@ -343,7 +344,44 @@ static void tcp_fixup_rcvbuf(struct sock *sk)
 	while (tcp_win_from_space(rcvmem) < tp->advmss)
 		rcvmem += 128;
 	if (sk->sk_rcvbuf < 4 * rcvmem)
-		sk->sk_rcvbuf = min(4 * rcvmem, sysctl_tcp_rmem[2]);
+		sk->sk_rcvbuf = min(4 * rcvmem, tcp_rmem_max(sk));
+}
+
+/* Per-interface receive buffer profile, conf/<dev>/tcp_rmem_def and
+ * tcp_rmem_max, for the interface the socket is routed through. The
+ * default seeds the receive buffer, and with it the initial window, the
+ * max caps autotuning in place of tcp_rmem[2]. Once established, the
+ * buffer is only ever raised, the peer may already use the window
+ * advertised in the SYN-ACK.
+ */
+void tcp_init_rmem_profile(struct sock *sk, int established)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct dst_entry *dst = __sk_dst_get(sk);
+	struct in_device *in_dev;
+	int def = 0, max = 0;
+
+	if (!dst || !dst->dev)
+		return;
+
+	rcu_read_lock();
+	in_dev = __in_dev_get_rcu(dst->dev);
+	if (in_dev) {
+		def = IN_DEV_CONF_GET(in_dev, TCP_RMEM_DEF);
+		max = IN_DEV_CONF_GET(in_dev, TCP_RMEM_MAX);
+	}
+	rcu_read_unlock();
+
+	/* the window scale is sized for the global limits */
+	if (max > 0)
+		tp->rcv_rmem_max = min_t(int, max,
+				max_t(u32, sysctl_tcp_rmem[2], sysctl_rmem_max));
+	if (def <= 0 || (sk->sk_userlocks & SOCK_RCVBUF_LOCK))
+		return;
+
+	def = min(def, tcp_rmem_max(sk));
+	if (!established || def > sk->sk_rcvbuf)
+		sk->sk_rcvbuf = def;
 }
 
 /* 4. Try to fixup all. It is made immediately after connection enters
@@ -354,6 +392,7 @@ static void tcp_init_buffer_space(struct sock *sk)
 	struct tcp_sock *tp = tcp_sk(sk);
 	int maxwin;
 
+	tcp_init_rmem_profile(sk, 1);
 	if (!(sk->sk_userlocks & SOCK_RCVBUF_LOCK))
 		tcp_fixup_rcvbuf(sk);
 	if (!(sk->sk_userlocks & SOCK_SNDBUF_LOCK))
@@ -390,12 +429,12 @@ static void tcp_clamp_window(struct sock *sk)
 
 	icsk->icsk_ack.quick = 0;
 
-	if (sk->sk_rcvbuf < sysctl_tcp_rmem[2] &&
+	if (sk->sk_rcvbuf < tcp_rmem_max(sk) &&
 	    !(sk->sk_userlocks & SOCK_RCVBUF_LOCK) &&
 	    !tcp_memory_pressure &&
 	    atomic_read(&tcp_memory_allocated) < sysctl_tcp_mem[0]) {
 		sk->sk_rcvbuf = min(atomic_read(&sk->sk_rmem_alloc),
-				    sysctl_tcp_rmem[2]);
+				    tcp_rmem_max(sk));
 	}
 	if (atomic_read(&sk->sk_rmem_alloc) > sk->sk_rcvbuf)
 		tp->rcv_ssthresh = min(tp->window_clamp, 2U * tp->advmss);
@@ -529,7 +568,7 @@ void tcp_rcv_space_adjust(struct sock *sk)
 			while (tcp_win_from_space(rcvmem) < tp->advmss)
 				rcvmem += 128;
 			space *= rcvmem;
-			space = min(space, sysctl_tcp_rmem[2]);
+			space = min(space, tcp_rmem_max(sk));
 			if (space > sk->sk_rcvbuf) {
 				sk->sk_rcvbuf = space;
 
@@ -11,7 +11,11 @@
 #define __XT_QTAGUID_INTERNAL_H__
 
 #include <linux/types.h>
+#include <linux/cpumask.h>
+#include <linux/list.h>
 #include <linux/rbtree.h>
+#include <linux/rcupdate.h>
+#include <linux/string.h>
 #include <linux/spinlock_types.h>
 #include <linux/workqueue.h>
 
@@ -185,16 +189,50 @@ struct tag_node {
 	tag_t tag;
 };
 
+/*
+ * The packet path finds tag_stats, tag_counter_sets and sock_tags through
+ * these hashes under RCU. The trees next to them are only used under the
+ * list locks, for updates and for walking the entries in order.
+ */
+#define TAG_STAT_HASH_BITS 6
+#define TAG_COUNTER_SET_HASH_BITS 6
+#define SOCK_TAG_HASH_BITS 8
+
 struct tag_stat {
 	struct tag_node tn;
-	struct data_counters counters;
+	struct hlist_node hnode;  /* in iface_stat.tag_stat_hash */
+	struct rcu_head rcu;
 	/*
 	 * If this tag is acct_tag based, we need to count against the
 	 * matching parent uid_tag.
 	 */
 	struct data_counters *parent_counters;
+	/*
+	 * One per possible cpu, so the packet path needs no lock.
+	 * They are summed when the stats are read.
+	 */
+	struct data_counters counters[0];
 };
 
+static inline void tag_stat_fold_counters(struct data_counters *counters,
+					  struct data_counters *sum)
+{
+	const int n = sizeof(*sum) / sizeof(struct byte_packet_counters);
+	struct byte_packet_counters *to = &sum->bpc[0][0][0];
+	int cpu, i;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		struct byte_packet_counters *from =
+			&counters[cpu].bpc[0][0][0];
+
+		for (i = 0; i < n; i++) {
+			to[i].bytes += from[i].bytes;
+			to[i].packets += from[i].packets;
+		}
+	}
+}
+
 struct iface_stat {
 	struct list_head list;  /* in iface_stat_list */
 	char *ifname;
@@ -218,6 +256,7 @@ struct iface_stat {
 	struct proc_dir_entry *proc_ptr;
 
 	struct rb_root tag_stat_tree;
+	struct hlist_head tag_stat_hash[1 << TAG_STAT_HASH_BITS];
 	spinlock_t tag_stat_list_lock;
 };
 
@@ -235,6 +274,8 @@ struct iface_stat_work {
  */
 struct sock_tag {
 	struct rb_node sock_node;
+	struct hlist_node hnode;  /* in sock_tag_hash */
+	struct rcu_head rcu;
 	struct sock *sk;  /* Only used as a number, never dereferenced */
 	/* The socket is needed for sockfd_put() */
 	struct socket *socket;
@@ -278,6 +319,8 @@ struct qtaguid_event_counts {
 /* Track the set active_set for the given tag. */
 struct tag_counter_set {
 	struct tag_node tn;
+	struct hlist_node hnode;  /* in tag_counter_set_hash */
+	struct rcu_head rcu;
 	int active_set;
 };
 
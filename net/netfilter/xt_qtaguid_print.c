@@ -154,6 +154,7 @@ char *pp_tag_stat(struct tag_stat *ts)
 	char *tn_str;
 	char *counters_str;
 	char *parent_counters_str;
+	struct data_counters sum, parent_sum;
 	char *res;
 
 	if (!ts) {
@@ -162,8 +163,12 @@ char *pp_tag_stat(struct tag_stat *ts)
 		return res;
 	}
 	tn_str = pp_tag_node(&ts->tn);
-	counters_str = pp_data_counters(&ts->counters, true);
-	parent_counters_str = pp_data_counters(ts->parent_counters, false);
+	tag_stat_fold_counters(ts->counters, &sum);
+	counters_str = pp_data_counters(&sum, true);
+	if (ts->parent_counters)
+		tag_stat_fold_counters(ts->parent_counters, &parent_sum);
+	parent_counters_str = pp_data_counters(
+		ts->parent_counters ? &parent_sum : NULL, false);
 	res = kasprintf(GFP_ATOMIC,
 			"tag_stat@%p{%s, counters=%s, parent_counters=%s}",
 			ts, tn_str, counters_str, parent_counters_str);
@@ -1718,7 +1718,15 @@ static int unix_dgram_recvmsg(struct kiocb *iocb, struct socket *sock,
 		goto out_unlock;
 	}
 
-	wake_up_interruptible_sync(&u->peer_wait);
+	/*
+	 * Only senders waiting for room in our queue sleep on peer_wait,
+	 * and they check the queue after queueing themselves; this pairs
+	 * with the barrier in prepare_to_wait_exclusive().  Saves taking
+	 * the wait queue lock for every message when nobody waits.
+	 */
+	smp_mb();
+	if (waitqueue_active(&u->peer_wait))
+		wake_up_interruptible_sync(&u->peer_wait);
 
 	if (msg->msg_name)
 		unix_copy_addr(msg, skb->sk);